@@ -24,9 +24,35 @@
 #include <string.h>
 #include <math.h>
 #include "WString.h"
+#include "numfmt.h"
 
 #include "Print.h"
 
+// Collects the characters of a formatted value on the stack, so that they
+// reach the device in one write() call (a few for very long values).
+class PrintBuffer
+{
+  public:
+    PrintBuffer(Print &p) : _p(p), _n(0), _len(0) {}
+    void put(char c) {
+      if (_len == sizeof(_buf)) flush();
+      _buf[_len++] = c;
+    }
+    void put(const char *str) {
+      while (*str) put(*str++);
+    }
+    size_t flush() {
+      if (_len) _n += _p.write((const uint8_t *)_buf, _len);
+      _len = 0;
+      return _n;
+    }
+  private:
+    Print &_p;
+    size_t _n;
+    uint8_t _len;
+    char _buf[32];
+};
+
 // Public Methods //////////////////////////////////////////////////////////////
 
 /* default implementation: may be overridden */
@@ -41,23 +67,14 @@ size_t Print::write(const uint8_t *buffer, size_t size)
 
 size_t Print::print(const __FlashStringHelper *ifsh)
 {
-  const prog_char *p = (const prog_char *)ifsh;
-  size_t n = 0;
-  while (1) {
-    unsigned char c = pgm_read_byte(p++);
-    if (c == 0) break;
-    n += write(c);
-  }
-  return n;
+  // the flash is in the address space, pgm_read_byte() is a plain load
+  return write((const prog_char *)ifsh);
 }
 
 size_t Print::print(const String &s)
 {
-  size_t n = 0;
-  for (uint16_t i = 0; i < s.length(); i++) {
-    n += write(s[i]);
-  }
-  return n;
+  if (s.length() == 0) return 0;
+  return write((const uint8_t *)s.c_str(), s.length());
 }
 
 size_t Print::print(const char str[])
@@ -91,9 +108,7 @@ size_t Print::print(long n, int base)
     return write(n);
   } else if (base == 10) {
     if (n < 0) {
-      int t = print('-');
-      n = -n;
-      return printNumber(n, 10) + t;
+      return printNumber(0UL - n, 10, true);
     }
     return printNumber(n, 10);
   } else {
@@ -109,6 +124,10 @@ size_t Print::print(unsigned long n, int base)
 
 size_t Print::print(double n, int digits)
 {
+  if (digits < 0) {
+    char buf[NUMFMT_SHORTEST_SIZE];
+    return write((const uint8_t *)buf, numfmt_shortest(n, buf));
+  }
   return printFloat(n, digits);
 }
 
@@ -126,9 +145,7 @@ size_t Print::print(const Printable& x)
 
 size_t Print::println(void)
 {
-  size_t n = print('\r');
-  n += print('\n');
-  return n;
+  return write((const uint8_t *)"\r\n", 2);
 }
 
 size_t Print::println(const String &s)
@@ -203,61 +220,52 @@ size_t Print::println(const Printable& x)
 
 // Private Methods /////////////////////////////////////////////////////////////
 
-size_t Print::printNumber(unsigned long n, uint8_t base) {
-  char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-  char *str = &buf[sizeof(buf) - 1];
-
-  *str = '\0';
+size_t Print::printNumber(unsigned long n, uint8_t base, bool negative) {
+  char buf[NUMFMT_DIGITS_SIZE + 1];
+  char *end = &buf[sizeof(buf)];
 
   // prevent crash if called with base == 1
   if (base < 2) base = 10;
 
-  do {
-    unsigned long m = n;
-    n /= base;
-    char c = m - base * n;
-    *--str = c < 10 ? c + '0' : c + 'A' - 10;
-  } while(n);
+  char *str = numfmt_radix(n, end, base, 1);
+  if (negative) *--str = '-';
 
-  return write(str);
+  return write((const uint8_t *)str, end - str);
 }
 
 size_t Print::printFloat(double number, uint8_t digits) 
 { 
-  size_t n = 0;
+  PrintBuffer out(*this);
   
+  if (isnan(number)) {
+    out.put("nan");
+    return out.flush();
+  }
+  if (isinf(number)) {
+    out.put(number < 0 ? "-inf" : "inf");
+    return out.flush();
+  }
+
   // Handle negative numbers
   if (number < 0.0)
   {
-     n += print('-');
+     out.put('-');
      number = -number;
   }
 
-  // Round correctly so that print(1.999, 2) prints as "2.00"
-  double rounding = 0.5;
-  for (uint8_t i=0; i<digits; ++i)
-    rounding /= 10.0;
-  
-  number += rounding;
-
-  // Extract the integer part of the number and print it
-  unsigned long int_part = (unsigned long)number;
-  double remainder = number - (double)int_part;
-  n += print(int_part);
-
-  // Print the decimal point, but only if there are digits beyond
-  if (digits > 0) {
-    n += print("."); 
+  // Rounded half up, so that print(1.999, 2) prints as "2.00"
+  char buf[NUMFMT_FIXED_SIZE + 1];
+  char *end = &buf[sizeof(buf) - 1];
+  unsigned int zeroes;
+  char *str = numfmt_fixed(number, digits, end, &zeroes);
+  if (str == NULL) {
+    out.put("ovf");
+    return out.flush();
   }
-
-  // Extract digits from the remainder one at a time
-  while (digits-- > 0)
-  {
-    remainder *= 10.0;
-    int toPrint = int(remainder);
-    n += print(toPrint);
-    remainder -= toPrint; 
-  } 
+  *end = '\0';
+  out.put(str);
+  while (zeroes-- > 0)
+    out.put('0');
   
-  return n;
+  return out.flush();
 }
@@ -35,7 +35,7 @@ class Print
 {
   private:
     int write_error;
-    size_t printNumber(unsigned long, uint8_t);
+    size_t printNumber(unsigned long, uint8_t, bool negative = false);
     size_t printFloat(double, uint8_t);
   protected:
     void setWriteError(int err = 1) { write_error = err; }
@@ -47,6 +47,9 @@ class Print
   
     virtual size_t write(uint8_t) = 0;
     size_t write(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+    // Every print() and println() formats its value on the stack and hands
+    // it over in one call to this method, which devices should override to
+    // take the whole buffer at once: the default writes it byte by byte.
     virtual size_t write(const uint8_t *buffer, size_t size);
     
     size_t print(const __FlashStringHelper *);
@@ -58,8 +61,14 @@ class Print
     size_t print(unsigned int, int = DEC);
     size_t print(long, int = DEC);
     size_t print(unsigned long, int = DEC);
+    // digits < 0 prints the fewest digits that read back as the same float
     size_t print(double, int = 2);
     size_t print(const Printable&);
+    #ifdef __GXX_EXPERIMENTAL_CXX0X__
+    // a + b, while its operands live (see STRING_SUM_TEMPORARY)
+    size_t print(StringSum &&s) { return print((const Printable &)s); }
+    size_t print(const StringSum &) = delete;
+    #endif
 
     size_t println(const __FlashStringHelper *);
     size_t println(const String &s);
@@ -72,6 +81,10 @@ class Print
     size_t println(unsigned long, int = DEC);
     size_t println(double, int = 2);
     size_t println(const Printable&);
+    #ifdef __GXX_EXPERIMENTAL_CXX0X__
+    size_t println(StringSum &&s) { return println((const Printable &)s); }
+    size_t println(const StringSum &) = delete;
+    #endif
     size_t println(void);
 };
 
@@ -21,35 +21,43 @@
  */
 
 #include "Stream.h"
+#include "wiring.h"
 
 #define PARSE_TIMEOUT 1000  // default number of milli-seconds to wait
 #define NO_SKIP_CHAR  1  // a magic char not found in a valid ASCII numeric field
 
-// XXX millis not implemented.
-#define millis() 0 
-
 // private method to read stream with timeout
 int Stream::timedRead()
 {
   int c;
+  unsigned long elapsed;
+  c = read();
+  if (c >= 0) return c;  // the clock is only read when there is nothing to read
   _startMillis = millis();
   do {
+    elapsed = millis() - _startMillis;
+    if (elapsed >= _timeout) return -1;     // -1 indicates timeout
+    if (!waitAvailable(_timeout - elapsed)) return -1;  // sleeps until data comes, if the port can
     c = read();
-    if (c >= 0) return c;
-  } while(millis() - _startMillis < _timeout);
-  return -1;     // -1 indicates timeout
+  } while(c < 0);
+  return c;
 }
 
 // private method to peek stream with timeout
 int Stream::timedPeek()
 {
   int c;
+  unsigned long elapsed;
+  c = peek();
+  if (c >= 0) return c;  // the clock is only read when there is nothing to peek
   _startMillis = millis();
   do {
+    elapsed = millis() - _startMillis;
+    if (elapsed >= _timeout) return -1;     // -1 indicates timeout
+    if (!waitAvailable(_timeout - elapsed)) return -1;  // sleeps until data comes, if the port can
     c = peek();
-    if (c >= 0) return c;
-  } while(millis() - _startMillis < _timeout);
-  return -1;     // -1 indicates timeout
+  } while(c < 0);
+  return c;
 }
 
 // returns peek of the next digit in the stream or -1 if timeout
@@ -90,7 +98,155 @@ bool Stream::find(char *target, size_t length)
 // as find but search ends if the terminator string is found
 bool  Stream::findUntil(char *target, char *terminator)
 {
-  return findUntil(target, strlen(target), terminator, strlen(terminator));
+  return findUntil(target, strlen(target), terminator, terminator ? strlen(terminator) : 0);
+}
+
+// Search engine of findUntil.  Each string is matched with a KMP automaton,
+// so a partial match that fails falls back to the longest prefix still
+// matching instead of starting over.  Bytes lent by rxAcquire() are scanned
+// in place: while nothing is matched, memchr() skips to the next first
+// character, or for a longer target without terminator a Horspool search
+// skips whole windows.  Other streams are fed through timedRead().
+
+#define SEARCH_TABLE  32  // prefixes with a precomputed fallback; longer ones compute it when needed
+#define SEARCH_SKIP   4   // shortest target searched with Horspool
+
+struct SearchString {
+  const char *text;
+  size_t length;
+  size_t matched;                  // characters matched so far
+  uint8_t failure[SEARCH_TABLE];   // failure[i]: longest proper prefix that ends text[0..i]
+
+  void init(const char *s, size_t n)
+  {
+    size_t i, k = 0;
+
+    text = s;
+    length = n;
+    matched = 0;
+    failure[0] = 0;
+    for (i = 1; i < n && i < SEARCH_TABLE; i++) {
+      while (k > 0 && text[i] != text[k])
+        k = failure[k - 1];
+      if (text[i] == text[k])
+        k++;
+      failure[i] = k;
+    }
+  }
+
+  // longest proper prefix of text that ends text[0..n)
+  size_t fallback(size_t n)
+  {
+    size_t k;
+
+    if (n <= SEARCH_TABLE)
+      return failure[n - 1];
+    for (k = n - 1; k > 0; k--)
+      if (memcmp(text, text + n - k, k) == 0)
+        break;
+    return k;
+  }
+
+  // returns true when c completes the string
+  bool step(char c)
+  {
+    while (c != text[matched]) {
+      if (matched == 0)
+        return false;
+      matched = fallback(matched);
+    }
+    return ++matched == length;
+  }
+};
+
+// Horspool search of the target in p[0..n), for a target of at least
+// SEARCH_SKIP characters.  Returns the offset past the first match, or 0 and
+// the offset from which a match could still start, too close to the end.
+static size_t horspool(const SearchString &target, const uint8_t *p, size_t n, size_t *resume)
+{
+  const uint8_t *text = (const uint8_t *)target.text;
+  size_t m = target.length;
+  uint8_t last = text[m - 1];
+  uint32_t present[8] = { 0 };  // characters of text[0..m-1), for the shift
+  size_t pos = 0;
+  size_t i, j;
+
+  for (i = 0; i + 1 < m; i++)
+    present[text[i] >> 5] |= 1UL << (text[i] & 31);
+
+  while (pos + m <= n) {
+    uint8_t c = p[pos + m - 1];
+
+    if (c == last && memcmp(p + pos, text, m - 1) == 0)
+      return pos + m;
+    // slide the last occurrence of c in text[0..m-1) under it
+    if (present[c >> 5] & (1UL << (c & 31))) {
+      for (j = m - 1; text[j - 1] != c; j--)
+        ;
+      pos += m - j;
+    } else {
+      pos += m;
+    }
+  }
+  *resume = pos;
+  return 0;
+}
+
+// Feeds p[0..n) to the automatons.  Returns the number of bytes consumed, and
+// sets result to 1 if the target was found, -1 if the terminator was.
+static size_t scan(SearchString &target, SearchString *terminator,
+                   const uint8_t *p, size_t n, int *result)
+{
+  const uint8_t *nextTarget = NULL;
+  const uint8_t *nextTerminator = NULL;
+  size_t i = 0;
+
+  while (i < n) {
+    if (target.matched == 0 && (!terminator || terminator->matched == 0)) {
+      // nothing under way: skip to where a match could start
+      if (!terminator) {
+        if (target.length >= SEARCH_SKIP && n - i >= target.length) {
+          size_t resume = 0;
+          size_t end = horspool(target, p + i, n - i, &resume);
+
+          if (end) {
+            *result = 1;
+            return i + end;
+          }
+          i += resume;
+        }
+        const uint8_t *q = (const uint8_t *)memchr(p + i, target.text[0], n - i);
+        if (!q)
+          return n;
+        i = q - p;
+      } else {
+        // the nearer of the next first characters of both strings
+        if (!nextTarget || nextTarget < p + i) {
+          nextTarget = (const uint8_t *)memchr(p + i, target.text[0], n - i);
+          if (!nextTarget)
+            nextTarget = p + n;
+        }
+        if (!nextTerminator || nextTerminator < p + i) {
+          nextTerminator = (const uint8_t *)memchr(p + i, terminator->text[0], n - i);
+          if (!nextTerminator)
+            nextTerminator = p + n;
+        }
+        i = (nextTarget < nextTerminator ? nextTarget : nextTerminator) - p;
+        if (i == n)
+          return n;
+      }
+    }
+    char c = p[i++];
+    if (target.step(c)) {
+      *result = 1;
+      return i;
+    }
+    if (terminator && terminator->step(c)) {
+      *result = -1;
+      return i;
+    }
+  }
+  return n;
 }
 
 // reads data from the stream until the target string of the given length is found
@@ -98,30 +254,50 @@ bool  Stream::findUntil(char *target, char *terminator)
 // returns true if target string is found, false if terminated or timed out
 bool Stream::findUntil(char *target, size_t targetLen, char *terminator, size_t termLen)
 {
-  size_t index = 0;  // maximum target string length is 64k bytes!
-  size_t termIndex = 0;
+  SearchString targetString;
+  SearchString terminatorString;
+  SearchString *term = NULL;
+  bool lends = true;
+  const uint8_t *p;
+  size_t count;
+  int result;
   int c;
 
-  if( *target == 0)
+  if (targetLen == 0 || *target == 0)
      return true;   // return true if target is a null string
-  while( (c = timedRead()) > 0){
-    if( c == target[index]){
-    //////Serial.print("found "); Serial.write(c); Serial.print("index now"); Serial.println(index+1);
-      if(++index >= targetLen){ // return true if all chars in the target match
-        return true;
+  targetString.init(target, targetLen);
+  if (termLen > 0) {
+    terminatorString.init(terminator, termLen);
+    term = &terminatorString;
+  }
+
+  for (;;) {
+    // scan what the stream lends in place
+    if (lends) {
+      count = 0;
+      p = rxAcquire(&count);
+      if (p) {
+        result = 0;
+        rxRelease(count > 0 ? scan(targetString, term, p, count, &result) : 0);
+        if (result)
+          return result > 0;
+        if (count > 0)
+          continue;
+      } else if (available() > 0) {
+        lends = false;  // data is waiting but not lent: the stream has no buffer to lend
       }
     }
-    else{
-      index = 0;  // reset index if any char does not match
-    }
-    if(termLen > 0 && c == terminator[termIndex]){
-       if(++termIndex >= termLen)
-         return false;       // return false if terminate string found before target string
-    }
-    else
-        termIndex = 0;
+    // wait for more, or read what is not lent, one byte at a time
+    do {
+      c = read();
+      if (c < 0 && (c = timedRead()) < 0)
+        return false;
+      if (targetString.step(c))
+        return true;
+      if (term && term->step(c))
+        return false;
+    } while (!lends);
   }
-  return false;
 }
 
 
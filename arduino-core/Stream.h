@@ -50,6 +50,18 @@ class Stream : public Print
     virtual int peek() = 0;
     virtual void flush() = 0;
 
+    // waits up to timeout milliseconds for data to read, and returns false if none came
+    // ports that can block override it, so that a task waiting for input sleeps
+    // the default returns true at once, and the timed reads poll until millis() passes the timeout
+    virtual bool waitAvailable(unsigned long timeout) { return true; }
+
+    // lends the bytes waiting in the receive buffer, so that find() can scan them in place
+    // count is set to the number of contiguous bytes; returns NULL if the stream has no buffer to lend, which is the default
+    // the stream is reserved to the caller until rxRelease()
+    virtual const uint8_t *rxAcquire(size_t *count) { return NULL; }
+
+    virtual void rxRelease(size_t used) {}  // consumes the first used bytes of the lent buffer
+
     Stream() {_timeout=1000;}
 
 // parsing methods
@@ -65,6 +77,7 @@ class Stream : public Print
   bool findUntil(char *target, char *terminator);   // as find but search ends if the terminator string is found
 
   bool findUntil(char *target, size_t targetLen, char *terminate, size_t termLen);   // as above but search ends if the terminate string is found
+  // the input is consumed up to the end of the target or terminator, scanned in place if the stream lends its receive buffer
 
 
   long parseInt(); // returns the first valid (long) integer value from the current position.
@@ -20,6 +20,7 @@
 */
 
 #include "WString.h"
+#include "Print.h"
 #include "itoa.h"
 
 /*********************************************/
@@ -51,6 +52,12 @@ String::String(StringSumHelper &&rval)
 }
 #endif
 
+String::String(STRING_SUM_ARG sum)
+{
+	init();
+	copy(sum);
+}
+
 String::String(char c)
 {
 	init();
@@ -102,7 +109,7 @@ String::String(unsigned long value, unsigned char base)
 
 String::~String()
 {
-	free(buffer);
+	if (!isInline()) free(buffer);
 }
 
 /*********************************************/
@@ -119,7 +126,7 @@ inline void String::init(void)
 
 void String::invalidate(void)
 {
-	if (buffer) free(buffer);
+	if (buffer && !isInline()) free(buffer);
 	buffer = NULL;
 	capacity = len = 0;
 }
@@ -134,9 +141,49 @@ unsigned char String::reserve(unsigned int size)
 	return 0;
 }
 
+// grows the buffer by half its size at least, so that appending n
+// characters one at a time costs O(log n) reallocations and O(n) copies.
+unsigned char String::grow(unsigned int maxStrLen)
+{
+	if (buffer && capacity >= maxStrLen) return 1;
+	unsigned int newCapacity = capacity + (capacity >> 1);
+	if (newCapacity < maxStrLen) newCapacity = maxStrLen;
+	newCapacity |= 7; // allocate whole malloc granules (multiples of 8)
+	if (changeBuffer(newCapacity) || changeBuffer(maxStrLen)) {
+		if (len == 0) buffer[0] = 0;
+		return 1;
+	}
+	return 0;
+}
+
+unsigned char String::shrink_to_fit(void)
+{
+	if (!buffer || isInline() || capacity == len) return 1;
+	return changeBuffer(len);
+}
+
 unsigned char String::changeBuffer(unsigned int maxStrLen)
 {
-	char *newbuffer = (char *)realloc(buffer, maxStrLen + 1);
+	if (maxStrLen < STRING_INLINE_SIZE) {
+		if (buffer && !isInline()) {
+			memcpy(sbuf, buffer, len);
+			sbuf[len] = 0;
+			free(buffer);
+		}
+		buffer = sbuf;
+		capacity = STRING_INLINE_SIZE - 1;
+		return 1;
+	}
+	char *newbuffer;
+	if (isInline()) {
+		newbuffer = (char *)malloc(maxStrLen + 1);
+		if (newbuffer) {
+			memcpy(newbuffer, sbuf, len);
+			newbuffer[len] = 0;
+		}
+	} else {
+		newbuffer = (char *)realloc(buffer, maxStrLen + 1);
+	}
 	if (newbuffer) {
 		buffer = newbuffer;
 		capacity = maxStrLen;
@@ -156,23 +203,26 @@ String & String::copy(const char *cstr, unsigned int length)
 		return *this;
 	}
 	len = length;
-	strcpy(buffer, cstr);
+	memcpy(buffer, cstr, length);
+	buffer[length] = 0;
 	return *this;
 }
 
 #ifdef __GXX_EXPERIMENTAL_CXX0X__
 void String::move(String &rhs)
 {
-	if (buffer) {
-		if (capacity >= rhs.len) {
-			strcpy(buffer, rhs.buffer);
-			len = rhs.len;
-			rhs.len = 0;
-			return;
-		} else {
-			free(buffer);
-		}
+	if (!rhs.buffer) {
+		invalidate();
+		return;
+	}
+	// an inline string can't be stolen, and a short one isn't worth it
+	if (rhs.isInline() || (buffer && capacity >= rhs.len)) {
+		copy(rhs.buffer, rhs.len);
+		rhs.len = 0;
+		rhs.buffer[0] = 0;
+		return;
 	}
+	if (buffer && !isInline()) free(buffer);
 	buffer = rhs.buffer;
 	capacity = rhs.capacity;
 	len = rhs.len;
@@ -206,6 +256,29 @@ String & String::operator = (StringSumHelper &&rval)
 }
 #endif
 
+String & String::copy(const StringSum &sum)
+{
+	if (!sum.valid()) {
+		invalidate();
+	} else if (buffer && sum.refersTo(buffer, buffer + len)) {
+		// s = x + s: the result is built aside, as it moves the operands
+		String result;
+		result.copy(sum);
+		#ifdef __GXX_EXPERIMENTAL_CXX0X__
+		move(result);
+		#else
+		*this = result;
+		#endif
+	} else if (reserve(sum.len)) {
+		sum.copyTo(buffer, buffer + sum.len);
+		len = sum.len;
+		buffer[len] = 0;
+	} else {
+		invalidate();
+	}
+	return *this;
+}
+
 String & String::operator = (const char *cstr)
 {
 	if (cstr) copy(cstr, strlen(cstr));
@@ -223,14 +296,39 @@ unsigned char String::concat(const String &s)
 	return concat(s.buffer, s.len);
 }
 
+unsigned char String::append(const StringSum &sum)
+{
+	if (!sum.valid()) return 0;
+	if (buffer && sum.refersTo(buffer, buffer + len)) {
+		// s += s + x
+		String result;
+		result.copy(sum);
+		return concat(result);
+	}
+	unsigned int newlen = len + sum.len;
+	if (!grow(newlen)) return 0;
+	sum.copyTo(buffer + len, buffer + newlen);
+	len = newlen;
+	buffer[len] = 0;
+	return 1;
+}
+
 unsigned char String::concat(const char *cstr, unsigned int length)
 {
 	unsigned int newlen = len + length;
 	if (!cstr) return 0;
 	if (length == 0) return 1;
-	if (!reserve(newlen)) return 0;
-	strcpy(buffer + len, cstr);
+	if (buffer && cstr >= buffer && cstr <= buffer + len) {
+		// appending (part of) ourselves: the buffer may move
+		unsigned int offset = cstr - buffer;
+		if (!grow(newlen)) return 0;
+		cstr = buffer + offset;
+	} else if (!grow(newlen)) {
+		return 0;
+	}
+	memcpy(buffer + len, cstr, length);
 	len = newlen;
+	buffer[len] = 0;
 	return 1;
 }
 
@@ -287,60 +385,191 @@ unsigned char String::concat(unsigned long num)
 /*  Concatenate                              */
 /*********************************************/
 
-StringSumHelper & operator + (const StringSumHelper &lhs, const String &rhs)
+static unsigned int digits(unsigned long num)
 {
-	StringSumHelper &a = const_cast<StringSumHelper&>(lhs);
-	if (!a.concat(rhs.buffer, rhs.len)) a.invalidate();
-	return a;
+	unsigned int n = 1;
+	while (num >= 10) {
+		num /= 10;
+		n++;
+	}
+	return n;
 }
 
-StringSumHelper & operator + (const StringSumHelper &lhs, const char *cstr)
+StringSum::Part::Part(const String &s) : len(s.len), kind(TEXT)
 {
-	StringSumHelper &a = const_cast<StringSumHelper&>(lhs);
-	if (!cstr || !a.concat(cstr, strlen(cstr))) a.invalidate();
-	return a;
+	value.text = s.buffer;
+	if (!s.buffer) kind = INVALID;
 }
 
-StringSumHelper & operator + (const StringSumHelper &lhs, char c)
+StringSum::Part::Part(const StringSum &sum) : len(sum.len), kind(SUM)
 {
-	StringSumHelper &a = const_cast<StringSumHelper&>(lhs);
-	if (!a.concat(c)) a.invalidate();
-	return a;
+	value.sum = &sum;
 }
 
-StringSumHelper & operator + (const StringSumHelper &lhs, unsigned char num)
+StringSum::Part::Part(const char *cstr) : len(0), kind(TEXT)
 {
-	StringSumHelper &a = const_cast<StringSumHelper&>(lhs);
-	if (!a.concat(num)) a.invalidate();
-	return a;
+	value.text = cstr;
+	if (cstr) len = strlen(cstr);
+	else kind = INVALID;
 }
 
-StringSumHelper & operator + (const StringSumHelper &lhs, int num)
+StringSum::Part::Part(char c) : len(1), kind(CHAR)
 {
-	StringSumHelper &a = const_cast<StringSumHelper&>(lhs);
-	if (!a.concat(num)) a.invalidate();
-	return a;
+	value.c = c;
 }
 
-StringSumHelper & operator + (const StringSumHelper &lhs, unsigned int num)
+StringSum::Part::Part(unsigned char num) : len(digits(num)), kind(UNSIGNED)
 {
-	StringSumHelper &a = const_cast<StringSumHelper&>(lhs);
-	if (!a.concat(num)) a.invalidate();
-	return a;
+	value.number = num;
 }
 
-StringSumHelper & operator + (const StringSumHelper &lhs, long num)
+StringSum::Part::Part(int num) : kind(SIGNED)
 {
-	StringSumHelper &a = const_cast<StringSumHelper&>(lhs);
-	if (!a.concat(num)) a.invalidate();
-	return a;
+	value.number = num;
+	len = num < 0 ? 1 + digits(0UL - num) : digits(num);
+}
+
+StringSum::Part::Part(unsigned int num) : len(digits(num)), kind(UNSIGNED)
+{
+	value.number = num;
+}
+
+StringSum::Part::Part(long num) : kind(SIGNED)
+{
+	value.number = num;
+	len = num < 0 ? 1 + digits(0UL - num) : digits(num);
+}
+
+StringSum::Part::Part(unsigned long num) : len(digits(num)), kind(UNSIGNED)
+{
+	value.number = num;
+}
+
+unsigned char StringSum::Part::isValid(void) const
+{
+	if (kind == SUM) return value.sum->valid();
+	return kind != INVALID;
+}
+
+unsigned char StringSum::Part::refersTo(const char *begin, const char *end) const
+{
+	if (kind == SUM) return value.sum->refersTo(begin, end);
+	return kind == TEXT && value.text >= begin && value.text <= end;
+}
+
+char * StringSum::Part::copyTo(char *dest, char *end) const
+{
+	char buf[12];
+	const char *src = buf;
+	unsigned int n = len;
+	switch (kind) {
+	case TEXT: src = value.text; break;
+	case CHAR: buf[0] = value.c; break;
+	case SIGNED: ltoa(value.number, buf, 10); break;
+	case UNSIGNED: ultoa(value.number, buf, 10); break;
+	case SUM: return value.sum->copyTo(dest, end);
+	default: return dest;
+	}
+	if (n > (unsigned int)(end - dest)) n = end - dest;
+	memcpy(dest, src, n);
+	return dest + n;
+}
+
+size_t StringSum::Part::printTo(Print &p) const
+{
+	char buf[12];
+	switch (kind) {
+	case TEXT: return p.write((const uint8_t *)value.text, len);
+	case CHAR: return p.write(value.c);
+	case SIGNED: ltoa(value.number, buf, 10); break;
+	case UNSIGNED: ultoa(value.number, buf, 10); break;
+	case SUM: return value.sum->printTo(p);
+	default: return 0;
+	}
+	return p.write((const uint8_t *)buf, len);
+}
+
+// the result of a sum that could not be copied out
+static const String invalidString((const char *)NULL);
+
+StringSum::StringSum(const Part &lhs, const Part &rhs)
+	: pLeft(NULL), left(lhs), right(rhs), len(lhs.length() + rhs.length()),
+	  pResult(NULL)
+{
+}
+
+StringSum::StringSum(const StringSum &lhs, const Part &rhs)
+	: pLeft(&lhs), left((char)0), right(rhs), len(lhs.len + rhs.length()),
+	  pResult(NULL)
+{
+}
+
+StringSum::StringSum(const StringSum &sum)
+	: Printable(), pLeft(sum.pLeft), left(sum.left), right(sum.right),
+	  len(sum.len), pResult(NULL)
+{
+}
+
+StringSum::~StringSum(void)
+{
+	delete pResult;
+}
+
+const String & StringSum::result(void) const
+{
+	if (!pResult) {
+		pResult = new String;
+		if (!pResult) return invalidString;
+		pResult->copy(*this);
+	}
+	return *pResult;
+}
+
+unsigned char StringSum::valid(void) const
+{
+	if (pLeft) return pLeft->valid() && right.isValid();
+	return left.isValid() && right.isValid();
+}
+
+unsigned char StringSum::refersTo(const char *begin, const char *end) const
+{
+	if (right.refersTo(begin, end)) return 1;
+	if (pLeft) return pLeft->refersTo(begin, end);
+	return left.refersTo(begin, end);
+}
+
+char * StringSum::copyTo(char *dest, char *end) const
+{
+	if (pLeft) dest = pLeft->copyTo(dest, end);
+	else dest = left.copyTo(dest, end);
+	return right.copyTo(dest, end);
+}
+
+void StringSum::copyOut(char *buf, unsigned int bufsize, unsigned int index) const
+{
+	if (index) {
+		result().toCharArray(buf, bufsize, index);
+		return;
+	}
+	if (!bufsize || !buf) return;
+	*copyTo(buf, buf + bufsize - 1) = 0;
+}
+
+size_t StringSum::printTo(Print &p) const
+{
+	// a short result is assembled on the stack and written in one call
+	char buf[64];
+	if (len <= sizeof(buf)) {
+		copyTo(buf, buf + len);
+		return p.write((const uint8_t *)buf, len);
+	}
+	return printParts(p);
 }
 
-StringSumHelper & operator + (const StringSumHelper &lhs, unsigned long num)
+size_t StringSum::printParts(Print &p) const
 {
-	StringSumHelper &a = const_cast<StringSumHelper&>(lhs);
-	if (!a.concat(num)) a.invalidate();
-	return a;
+	size_t n = pLeft ? pLeft->printParts(p) : left.printTo(p);
+	return n + right.printTo(p);
 }
 
 /*********************************************/
@@ -27,6 +27,8 @@
 #include <string.h>
 #include <ctype.h>
 
+#include "Printable.h"
+
 // When compiling programs with this class, the following gcc parameters
 // dramatically increase performance and memory (RAM) efficiency, typically
 // with little or no increase in code size.
@@ -39,10 +41,35 @@ class __FlashStringHelper;
 #define pgm_read_byte(a) *(a)
 #define prog_char char 
 
+// Strings up to STRING_INLINE_SIZE - 1 characters long are held in the
+// String object itself and never touch the heap.  Longer strings go to the
+// heap, and grow geometrically when appended to, so a loop of concat() or
+// += copies each character a bounded number of times.  The default holds any
+// number printed in base 10.  The size must be at least 1 (in which case only
+// the empty string is held inline).
+#ifndef STRING_INLINE_SIZE
+#define STRING_INLINE_SIZE 12
+#endif
+
 // An inherited class for holding the result of a concatenation.  These
 // result objects are assumed to be writable by subsequent concatenations.
 class StringSumHelper;
 
+// The result of a concatenation, copied out when its length is known.
+class StringSum;
+
+// A StringSum refers to its operands, which may be temporaries, so it is
+// only good within the expression that built it.  From C++11 on, it can
+// only be used as a temporary: "auto s = a + b;" fails to compile where
+// s is used, instead of reading operands that are gone.
+#ifdef __GXX_EXPERIMENTAL_CXX0X__
+#define STRING_SUM_ARG StringSum &&
+#define STRING_SUM_TEMPORARY &&
+#else
+#define STRING_SUM_ARG const StringSum &
+#define STRING_SUM_TEMPORARY
+#endif
+
 // The string class
 class String
 {
@@ -64,6 +91,7 @@ public:
 	String(String &&rval);
 	String(StringSumHelper &&rval);
 	#endif
+	String(STRING_SUM_ARG sum);
 	explicit String(char c);
 	explicit String(unsigned char, unsigned char base=10);
 	explicit String(int, unsigned char base=10);
@@ -77,6 +105,10 @@ public:
 	// is left unchanged).  reserve(0), if successful, will validate an
 	// invalid string (i.e., "if (s)" will be true afterwards)
 	unsigned char reserve(unsigned int size);
+	// releases the capacity beyond the current length, moving the string
+	// back inline if it fits.  returns true on success, false if the
+	// smaller buffer could not be allocated (the string is unchanged).
+	unsigned char shrink_to_fit(void);
 	inline unsigned int length(void) const {return len;}
 
 	// creates a copy of the assigned value.  if the value is null or
@@ -88,6 +120,7 @@ public:
 	String & operator = (String &&rval);
 	String & operator = (StringSumHelper &&rval);
 	#endif
+	String & operator = (STRING_SUM_ARG sum) {return copy(sum);}
 
 	// concatenate (works w/ built-in types)
 	
@@ -95,6 +128,7 @@ public:
 	// is left unchanged).  if the argument is null or invalid, the 
 	// concatenation is considered unsucessful.  
 	unsigned char concat(const String &str);
+	unsigned char concat(STRING_SUM_ARG sum) {return append(sum);}
 	unsigned char concat(const char *cstr);
 	unsigned char concat(char c);
 	unsigned char concat(unsigned char c);
@@ -106,6 +140,7 @@ public:
 	// if there's not enough memory for the concatenated value, the string
 	// will be left unchanged (but this isn't signalled in any way)
 	String & operator += (const String &rhs)	{concat(rhs); return (*this);}
+	String & operator += (STRING_SUM_ARG rhs)	{append(rhs); return (*this);}
 	String & operator += (const char *cstr)		{concat(cstr); return (*this);}
 	String & operator += (char c)			{concat(c); return (*this);}
 	String & operator += (unsigned char num)		{concat(num); return (*this);}
@@ -114,14 +149,9 @@ public:
 	String & operator += (long num)			{concat(num); return (*this);}
 	String & operator += (unsigned long num)	{concat(num); return (*this);}
 
-	friend StringSumHelper & operator + (const StringSumHelper &lhs, const String &rhs);
-	friend StringSumHelper & operator + (const StringSumHelper &lhs, const char *cstr);
-	friend StringSumHelper & operator + (const StringSumHelper &lhs, char c);
-	friend StringSumHelper & operator + (const StringSumHelper &lhs, unsigned char num);
-	friend StringSumHelper & operator + (const StringSumHelper &lhs, int num);
-	friend StringSumHelper & operator + (const StringSumHelper &lhs, unsigned int num);
-	friend StringSumHelper & operator + (const StringSumHelper &lhs, long num);
-	friend StringSumHelper & operator + (const StringSumHelper &lhs, unsigned long num);
+	// a + b + ... (see StringSum below) allocates once for the whole
+	// result, and copies each operand once.
+	friend class StringSum;
 
 	// comparison (only works w/ Strings and "strings")
 	operator StringIfHelperType() const { return buffer ? &String::StringIfHelper : 0; }
@@ -149,6 +179,8 @@ public:
 	void getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index=0) const;
 	void toCharArray(char *buf, unsigned int bufsize, unsigned int index=0) const
 		{getBytes((unsigned char *)buf, bufsize, index);}
+	// the characters, NULL if the string is invalid
+	const char * c_str() const {return buffer;}
 
 	// search
 	int indexOf( char ch ) const;
@@ -177,19 +209,25 @@ protected:
 	unsigned int capacity;  // the array length minus one (for the '\0')
 	unsigned int len;       // the String length (not counting the '\0')
 	unsigned char flags;    // unused, for future features
+	char sbuf[STRING_INLINE_SIZE];  // inline storage for short strings
 protected:
 	void init(void);
 	void invalidate(void);
+	inline unsigned char isInline(void) const {return buffer == sbuf;}
 	unsigned char changeBuffer(unsigned int maxStrLen);
+	unsigned char grow(unsigned int maxStrLen);
 	unsigned char concat(const char *cstr, unsigned int length);
 
 	// copy and move
 	String & copy(const char *cstr, unsigned int length);
+	String & copy(const StringSum &sum);
+	unsigned char append(const StringSum &sum);
 	#ifdef __GXX_EXPERIMENTAL_CXX0X__
 	void move(String &rhs);
 	#endif
 };
 
+// No longer returned by operator +, kept for code that names it.
 class StringSumHelper : public String
 {
 public:
@@ -203,5 +241,154 @@ public:
 	StringSumHelper(unsigned long num) : String(num) {}
 };
 
+// The result of a concatenation.  a + b + c builds a chain of StringSum
+// temporaries, one per "+", that refer to their operands (numbers are kept
+// by value and formatted in base 10).  Nothing is copied until the chain
+// is assigned to, or used to construct, a String, which then allocates
+// once for the total length; printing it writes the operands straight to
+// the Print, and toCharArray() copies them to a caller's buffer.
+//
+// The other const methods of String are there too, so that (a + b).toInt()
+// and the like still work: the first of them copies the result out to a
+// String that the sum keeps until the end of the expression.
+class StringSum : public Printable
+{
+	typedef void (StringSum::*StringSumIfHelperType)() const;
+	void StringSumIfHelper() const {}
+
+public:
+	// one operand of a concatenation
+	class Part
+	{
+	public:
+		Part(const String &s);
+		Part(const StringSum &sum);
+		Part(const char *cstr);
+		Part(char c);
+		Part(unsigned char num);
+		Part(int num);
+		Part(unsigned int num);
+		Part(long num);
+		Part(unsigned long num);
+		inline unsigned int length(void) const {return len;}
+		unsigned char isValid(void) const;
+		unsigned char refersTo(const char *begin, const char *end) const;
+		char * copyTo(char *dest, char *end) const;
+		size_t printTo(Print &p) const;
+	private:
+		enum {INVALID, TEXT, CHAR, SIGNED, UNSIGNED, SUM};
+		union {
+			const char *text;
+			const StringSum *sum;
+			long number;
+			char c;
+		} value;
+		unsigned int len;
+		unsigned char kind;
+	};
+
+	StringSum(const Part &lhs, const Part &rhs);
+	StringSum(const StringSum &lhs, const Part &rhs);
+	// copies the operands, not the result
+	StringSum(const StringSum &sum);
+	~StringSum(void);
+
+	inline unsigned int length(void) const STRING_SUM_TEMPORARY {return len;}
+	// false if an operand is an invalid String or a null pointer, or
+	// (when copied to a String) if the allocation fails
+	unsigned char isValid(void) const STRING_SUM_TEMPORARY {return valid();}
+	operator StringSumIfHelperType() const STRING_SUM_TEMPORARY { return valid() ? &StringSum::StringSumIfHelper : 0; }
+	// copies the result, truncated to bufsize - 1 characters, to buf
+	void toCharArray(char *buf, unsigned int bufsize, unsigned int index=0) const STRING_SUM_TEMPORARY
+		{copyOut(buf, bufsize, index);}
+	void getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index=0) const STRING_SUM_TEMPORARY
+		{copyOut((char *)buf, bufsize, index);}
+	virtual size_t printTo(Print &p) const;
+
+	// the const methods of String, on the result
+	int compareTo(const String &s) const STRING_SUM_TEMPORARY {return result().compareTo(s);}
+	unsigned char equals(const String &s) const STRING_SUM_TEMPORARY {return result().equals(s);}
+	unsigned char equals(const char *cstr) const STRING_SUM_TEMPORARY {return result().equals(cstr);}
+	unsigned char operator == (const String &rhs) const STRING_SUM_TEMPORARY {return result().equals(rhs);}
+	unsigned char operator == (const char *cstr) const STRING_SUM_TEMPORARY {return result().equals(cstr);}
+	unsigned char operator != (const String &rhs) const STRING_SUM_TEMPORARY {return !result().equals(rhs);}
+	unsigned char operator != (const char *cstr) const STRING_SUM_TEMPORARY {return !result().equals(cstr);}
+	unsigned char operator <  (const String &rhs) const STRING_SUM_TEMPORARY {return result() < rhs;}
+	unsigned char operator >  (const String &rhs) const STRING_SUM_TEMPORARY {return result() > rhs;}
+	unsigned char operator <= (const String &rhs) const STRING_SUM_TEMPORARY {return result() <= rhs;}
+	unsigned char operator >= (const String &rhs) const STRING_SUM_TEMPORARY {return result() >= rhs;}
+	unsigned char equalsIgnoreCase(const String &s) const STRING_SUM_TEMPORARY {return result().equalsIgnoreCase(s);}
+	unsigned char startsWith(const String &prefix) const STRING_SUM_TEMPORARY {return result().startsWith(prefix);}
+	unsigned char startsWith(const String &prefix, unsigned int offset) const STRING_SUM_TEMPORARY {return result().startsWith(prefix, offset);}
+	unsigned char endsWith(const String &suffix) const STRING_SUM_TEMPORARY {return result().endsWith(suffix);}
+	char charAt(unsigned int index) const STRING_SUM_TEMPORARY {return result().charAt(index);}
+	char operator [] (unsigned int index) const STRING_SUM_TEMPORARY {return result()[index];}
+	// valid until the end of the expression
+	const char * c_str() const STRING_SUM_TEMPORARY {return result().c_str();}
+	int indexOf(char ch) const STRING_SUM_TEMPORARY {return result().indexOf(ch);}
+	int indexOf(char ch, unsigned int fromIndex) const STRING_SUM_TEMPORARY {return result().indexOf(ch, fromIndex);}
+	int indexOf(const String &str) const STRING_SUM_TEMPORARY {return result().indexOf(str);}
+	int indexOf(const String &str, unsigned int fromIndex) const STRING_SUM_TEMPORARY {return result().indexOf(str, fromIndex);}
+	int lastIndexOf(char ch) const STRING_SUM_TEMPORARY {return result().lastIndexOf(ch);}
+	int lastIndexOf(char ch, unsigned int fromIndex) const STRING_SUM_TEMPORARY {return result().lastIndexOf(ch, fromIndex);}
+	int lastIndexOf(const String &str) const STRING_SUM_TEMPORARY {return result().lastIndexOf(str);}
+	int lastIndexOf(const String &str, unsigned int fromIndex) const STRING_SUM_TEMPORARY {return result().lastIndexOf(str, fromIndex);}
+	String substring(unsigned int beginIndex) const STRING_SUM_TEMPORARY {return result().substring(beginIndex);}
+	String substring(unsigned int beginIndex, unsigned int endIndex) const STRING_SUM_TEMPORARY {return result().substring(beginIndex, endIndex);}
+	long toInt(void) const STRING_SUM_TEMPORARY {return result().toInt();}
+
+private:
+	const StringSum *pLeft;  // left operand if it is a sum, otherwise left
+	Part left;
+	Part right;
+	unsigned int len;
+	mutable String *pResult; // copied out by the first call to result()
+
+	StringSum & operator = (const StringSum &);
+	unsigned char valid(void) const;
+	const String & result(void) const;
+	unsigned char refersTo(const char *begin, const char *end) const;
+	char * copyTo(char *dest, char *end) const;
+	void copyOut(char *buf, unsigned int bufsize, unsigned int index) const;
+	size_t printParts(Print &p) const;
+	friend class String;
+};
+
+inline StringSum operator + (const String &lhs, const String &rhs) {return StringSum(lhs, rhs);}
+inline StringSum operator + (const String &lhs, STRING_SUM_ARG rhs) {return StringSum(lhs, rhs);}
+inline StringSum operator + (const String &lhs, const char *cstr) {return StringSum(lhs, cstr);}
+inline StringSum operator + (const String &lhs, char c) {return StringSum(lhs, c);}
+inline StringSum operator + (const String &lhs, unsigned char num) {return StringSum(lhs, num);}
+inline StringSum operator + (const String &lhs, int num) {return StringSum(lhs, num);}
+inline StringSum operator + (const String &lhs, unsigned int num) {return StringSum(lhs, num);}
+inline StringSum operator + (const String &lhs, long num) {return StringSum(lhs, num);}
+inline StringSum operator + (const String &lhs, unsigned long num) {return StringSum(lhs, num);}
+
+inline StringSum operator + (STRING_SUM_ARG lhs, const String &rhs) {return StringSum(lhs, rhs);}
+inline StringSum operator + (STRING_SUM_ARG lhs, STRING_SUM_ARG rhs) {return StringSum(lhs, rhs);}
+inline StringSum operator + (STRING_SUM_ARG lhs, const char *cstr) {return StringSum(lhs, cstr);}
+inline StringSum operator + (STRING_SUM_ARG lhs, char c) {return StringSum(lhs, c);}
+inline StringSum operator + (STRING_SUM_ARG lhs, unsigned char num) {return StringSum(lhs, num);}
+inline StringSum operator + (STRING_SUM_ARG lhs, int num) {return StringSum(lhs, num);}
+inline StringSum operator + (STRING_SUM_ARG lhs, unsigned int num) {return StringSum(lhs, num);}
+inline StringSum operator + (STRING_SUM_ARG lhs, long num) {return StringSum(lhs, num);}
+inline StringSum operator + (STRING_SUM_ARG lhs, unsigned long num) {return StringSum(lhs, num);}
+
+inline StringSum operator + (const char *cstr, const String &rhs) {return StringSum(cstr, rhs);}
+inline StringSum operator + (char c, const String &rhs) {return StringSum(c, rhs);}
+inline StringSum operator + (unsigned char num, const String &rhs) {return StringSum(num, rhs);}
+inline StringSum operator + (int num, const String &rhs) {return StringSum(num, rhs);}
+inline StringSum operator + (unsigned int num, const String &rhs) {return StringSum(num, rhs);}
+inline StringSum operator + (long num, const String &rhs) {return StringSum(num, rhs);}
+inline StringSum operator + (unsigned long num, const String &rhs) {return StringSum(num, rhs);}
+
+inline StringSum operator + (const char *cstr, STRING_SUM_ARG rhs) {return StringSum(cstr, rhs);}
+inline StringSum operator + (char c, STRING_SUM_ARG rhs) {return StringSum(c, rhs);}
+inline StringSum operator + (unsigned char num, STRING_SUM_ARG rhs) {return StringSum(num, rhs);}
+inline StringSum operator + (int num, STRING_SUM_ARG rhs) {return StringSum(num, rhs);}
+inline StringSum operator + (unsigned int num, STRING_SUM_ARG rhs) {return StringSum(num, rhs);}
+inline StringSum operator + (long num, STRING_SUM_ARG rhs) {return StringSum(num, rhs);}
+inline StringSum operator + (unsigned long num, STRING_SUM_ARG rhs) {return StringSum(num, rhs);}
+
 #endif  // __cplusplus
 #endif  // String_class_h
@@ -17,6 +17,7 @@
 */
 
 #include "itoa.h"
+#include "numfmt.h"
 #include <string.h>
 
 #ifdef __cplusplus
@@ -73,9 +74,8 @@ extern char* itoa( int value, char *string, int radix )
 
 extern char* ltoa( long value, char *string, int radix )
 {
-  char tmp[33];
-  char *tp = tmp;
-  long i;
+  char tmp[NUMFMT_DIGITS_SIZE];
+  char *tp;
   unsigned long v;
   int sign;
   char *sp;
@@ -100,23 +100,14 @@ extern char* ltoa( long value, char *string, int radix )
     v = (unsigned long)value;
   }
 
-  while (v || tp == tmp)
-  {
-    i = v % radix;
-    v = v / radix;
-    if (i < 10)
-      *tp++ = i+'0';
-    else
-      *tp++ = i + 'a' - 10;
-  }
+  tp = numfmt_radix(v, tmp + sizeof(tmp), radix, 0);
 
   sp = string;
 
   if (sign)
     *sp++ = '-';
-  while (tp > tmp)
-    *sp++ = *--tp;
-  *sp = 0;
+  memcpy(sp, tp, tmp + sizeof(tmp) - tp);
+  sp[tmp + sizeof(tmp) - tp] = 0;
 
   return string;
 }
@@ -128,11 +119,8 @@ extern char* utoa( unsigned long value, char *string, int radix )
 
 extern char* ultoa( unsigned long value, char *string, int radix )
 {
-  char tmp[33];
-  char *tp = tmp;
-  long i;
-  unsigned long v = value;
-  char *sp;
+  char tmp[NUMFMT_DIGITS_SIZE];
+  char *tp;
 
   if ( string == NULL )
   {
@@ -143,23 +131,10 @@ extern char* ultoa( unsigned long value, char *string, int radix )
   {
     return 0;
   }
- 
-  while (v || tp == tmp)
-  {
-    i = v % radix;
-    v = v / radix;
-    if (i < 10)
-      *tp++ = i+'0';
-    else
-      *tp++ = i + 'a' - 10;
-  }
-
-  sp = string;
 
- 
-  while (tp > tmp)
-    *sp++ = *--tp;
-  *sp = 0;
+  tp = numfmt_radix(value, tmp + sizeof(tmp), radix, 0);
+  memcpy(string, tp, tmp + sizeof(tmp) - tp);
+  string[tmp + sizeof(tmp) - tp] = 0;
 
   return string;
 }
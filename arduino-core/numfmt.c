@@ -0,0 +1,334 @@
+/*
+  Number to text conversions for Print, itoa and printf.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "numfmt.h"
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif // __cplusplus
+
+static const char pairs[201] =
+  "0001020304050607080910111213141516171819"
+  "2021222324252627282930313233343536373839"
+  "4041424344454647484950515253545556575859"
+  "6061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899" ;
+
+static const char lowerDigits[] = "0123456789abcdefghijklmnopqrstuvwxyz" ;
+static const char upperDigits[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ" ;
+
+static const uint64_t powers64[20] =
+{
+  1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+  100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL,
+  1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+  1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+  1000000000000000000ULL, 10000000000000000000ULL
+} ;
+
+/* The powers of ten that are exact as doubles. */
+static const double scales[23] =
+{
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+} ;
+
+/* value / 100 for any uint32_t, as a UMULL and a shift */
+static inline uint32_t div100( uint32_t value )
+{
+  return (uint32_t)(((uint64_t)value * 1374389535u) >> 37) ;
+}
+
+/* value / 10 for any uint32_t */
+static inline uint32_t div10( uint32_t value )
+{
+  return (uint32_t)(((uint64_t)value * 3435973837u) >> 35) ;
+}
+
+static double power10( unsigned int n )
+{
+  double scale = 1 ;
+
+  while ( n > 22 )
+  {
+    scale *= scales[22] ;
+    n -= 22 ;
+  }
+  return scale * scales[n] ;
+}
+
+extern char *numfmt_dec( uint32_t value, char *end )
+{
+  while ( value >= 100 )
+  {
+    uint32_t q = div100( value ) ;
+
+    end -= 2 ;
+    memcpy( end, &pairs[2 * (value - 100 * q)], 2 ) ;
+    value = q ;
+  }
+  if ( value >= 10 )
+  {
+    end -= 2 ;
+    memcpy( end, &pairs[2 * value], 2 ) ;
+  }
+  else
+  {
+    *--end = '0' + value ;
+  }
+  return end ;
+}
+
+extern char *numfmt_dec_width( uint32_t value, char *end, unsigned int count )
+{
+  for ( ; count >= 2 ; count -= 2 )
+  {
+    uint32_t q = div100( value ) ;
+
+    end -= 2 ;
+    memcpy( end, &pairs[2 * (value - 100 * q)], 2 ) ;
+    value = q ;
+  }
+  if ( count )
+  {
+    *--end = '0' + (value - 10 * div10( value )) ;
+  }
+  return end ;
+}
+
+extern char *numfmt_dec64( uint64_t value, char *end )
+{
+  while ( value >> 32 )
+  {
+    uint64_t q = value / 1000000000u ;
+
+    end = numfmt_dec_width( (uint32_t)(value - q * 1000000000u), end, 9 ) ;
+    value = q ;
+  }
+  return numfmt_dec( (uint32_t)value, end ) ;
+}
+
+extern char *numfmt_radix( uint32_t value, char *end, unsigned int radix, int upper )
+{
+  const char *digits = upper ? upperDigits : lowerDigits ;
+
+  if ( radix == 10 || radix < 2 || radix > 36 )
+  {
+    return numfmt_dec( value, end ) ;
+  }
+
+  if ( (radix & (radix - 1)) == 0 )
+  {
+    unsigned int shift = __builtin_ctz( radix ) ;
+
+    do
+    {
+      *--end = digits[value & (radix - 1)] ;
+      value >>= shift ;
+    } while ( value ) ;
+  }
+  else
+  {
+    do
+    {
+      uint32_t q = value / radix ;
+
+      *--end = digits[value - q * radix] ;
+      value = q ;
+    } while ( value ) ;
+  }
+  return end ;
+}
+
+extern char *numfmt_fixed( double value, unsigned int digits, char *end, unsigned int *zeroes )
+{
+  unsigned int computed = digits > 19 ? 19 : digits ;
+  uint64_t integer, fraction ;
+
+  if ( !(value < 18446744073709551616.0) )
+  {
+    return 0 ;
+  }
+
+  /* the subtraction is exact, so the scaled fraction only carries the
+     rounding of one multiply */
+  integer = (uint64_t)value ;
+  fraction = (uint64_t)((value - (double)integer) * scales[computed] + 0.5) ;
+  if ( fraction >= powers64[computed] )
+  {
+    fraction -= powers64[computed] ;
+    integer++ ;
+  }
+  *zeroes = digits - computed ;
+
+  for ( ; computed > 9 ; computed -= 9 )
+  {
+    uint64_t q = fraction / 1000000000u ;
+
+    end = numfmt_dec_width( (uint32_t)(fraction - q * 1000000000u), end, 9 ) ;
+    fraction = q ;
+  }
+  end = numfmt_dec_width( (uint32_t)fraction, end, computed ) ;
+  if ( digits > 0 )
+  {
+    *--end = '.' ;
+  }
+  return numfmt_dec64( integer, end ) ;
+}
+
+extern int numfmt_shortest( float value, char *buf )
+{
+  union { float f ; uint32_t u ; } bits, neighbour ;
+  char digits[12] ;
+  char *d ;
+  char *p = buf ;
+  double x, below, above, scale ;
+  uint32_t low, high, nearest, t, c ;
+  int k, j, n, e ;
+
+  bits.f = value ;
+  if ( bits.u >> 31 )
+  {
+    *p++ = '-' ;
+  }
+  bits.u &= 0x7fffffff ;
+  if ( bits.u >= 0x7f800000 )
+  {
+    strcpy( p, bits.u == 0x7f800000 ? "inf" : "nan" ) ;
+    return p + 3 - buf ;
+  }
+  if ( bits.u == 0 )
+  {
+    strcpy( p, "0" ) ;
+    return p + 1 - buf ;
+  }
+
+  /* the values halfway to the neighbouring floats bound the decimals that
+     read back as value */
+  x = bits.f ;
+  neighbour.u = bits.u - 1 ;
+  below = (x + neighbour.f) * 0.5 ;
+  neighbour.u = bits.u + 1 ;
+  above = neighbour.u == 0x7f800000 ? x + (x - below) : (x + neighbour.f) * 0.5 ;
+
+  /* scale by 10^(8 - k) to nine digits before the point, from an estimate of
+     k = floor(log10(x)) made from the binary exponent */
+  k = (((int)(bits.u >> 23) - 127) * 1233) >> 12 ;
+  for ( ;; )
+  {
+    double scaled ;
+
+    scale = power10( k > 8 ? k - 8 : 8 - k ) ;
+    scaled = k > 8 ? x / scale : x * scale ;
+    if ( scaled >= 1e9 )
+      k++ ;
+    else if ( scaled < 1e8 )
+      k-- ;
+    else
+      break ;
+  }
+  if ( k > 8 )
+  {
+    x /= scale ;
+    below /= scale ;
+    above /= scale ;
+  }
+  else
+  {
+    x *= scale ;
+    below *= scale ;
+    above *= scale ;
+  }
+
+  /* reading rounds ties to even: the bounds read back as value when its
+     mantissa is even */
+  low = (uint32_t)below ;
+  if ( (double)low != below || (bits.u & 1) )
+    low++ ;
+  high = (uint32_t)above ;
+  if ( (double)high == above && (bits.u & 1) )
+    high-- ;
+  nearest = (uint32_t)(x + 0.5) ;
+
+  /* the largest power of ten with a multiple between the bounds, and its
+     multiple nearest to value */
+  for ( j = 0, t = 1 ; j < 9 ; j++, t *= 10 )
+  {
+    c = (low + 10 * t - 1) / (10 * t) * (10 * t) ;
+    if ( c > high )
+      break ;
+  }
+  c = (nearest + t / 2) / t * t ;
+  if ( c > high )
+    c -= t ;
+  if ( c < low )
+    c += t ;
+
+  /* c / t has n digits, the first worth 10^e */
+  d = numfmt_dec( c / t, digits + sizeof(digits) ) ;
+  n = digits + sizeof(digits) - d ;
+  e = n - 1 + j + k - 8 ;
+
+  if ( e >= -5 && e <= 8 )
+  {
+    if ( e < 0 )
+    {
+      *p++ = '0' ;
+      *p++ = '.' ;
+      memset( p, '0', -e - 1 ) ;
+      p += -e - 1 ;
+      memcpy( p, d, n ) ;
+      p += n ;
+    }
+    else if ( n <= e + 1 )
+    {
+      memcpy( p, d, n ) ;
+      p += n ;
+      memset( p, '0', e + 1 - n ) ;
+      p += e + 1 - n ;
+    }
+    else
+    {
+      memcpy( p, d, e + 1 ) ;
+      p += e + 1 ;
+      *p++ = '.' ;
+      memcpy( p, d + e + 1, n - e - 1 ) ;
+      p += n - e - 1 ;
+    }
+  }
+  else
+  {
+    *p++ = d[0] ;
+    if ( n > 1 )
+    {
+      *p++ = '.' ;
+      memcpy( p, d + 1, n - 1 ) ;
+      p += n - 1 ;
+    }
+    *p++ = 'e' ;
+    *p++ = e < 0 ? '-' : '+' ;
+    p = numfmt_dec_width( e < 0 ? -e : e, p + 2, 2 ) + 2 ;
+  }
+  *p = 0 ;
+  return p - buf ;
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
@@ -0,0 +1,77 @@
+/*
+  Number to text conversions for Print, itoa and printf.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _NUMFMT_
+#define _NUMFMT_
+
+#include <stdint.h>
+
+/*
+  The integer conversions write their digits backwards, ending just before
+  end, and return the first digit; nothing is terminated.  Decimal digits
+  are produced two at a time from a table, dividing by 100 with a multiply
+  by its reciprocal; powers of two radixes use shifts.  Only other radixes
+  divide.
+
+  The floating point conversions do their soft-float arithmetic once per
+  number, to scale it to an integer, and produce the digits from that
+  integer.
+*/
+
+/* Room for the digits of any uint32_t in any radix, and of any uint64_t in
+   decimal. */
+#define NUMFMT_DIGITS_SIZE 32
+
+/* Room for what numfmt_fixed() writes. */
+#define NUMFMT_FIXED_SIZE 44
+
+/* Room for what numfmt_shortest() writes, with the terminating zero. */
+#define NUMFMT_SHORTEST_SIZE 18
+
+#ifdef __cplusplus
+extern "C"{
+#endif // __cplusplus
+
+/* Decimal digits of value. */
+extern char *numfmt_dec( uint32_t value, char *end ) ;
+
+/* Exactly count decimal digits of value, with leading zeroes. */
+extern char *numfmt_dec_width( uint32_t value, char *end, unsigned int count ) ;
+
+extern char *numfmt_dec64( uint64_t value, char *end ) ;
+
+/* Digits of value in radix 2 to 36, in lower or upper case. */
+extern char *numfmt_radix( uint32_t value, char *end, unsigned int radix, int upper ) ;
+
+/* Value, positive or zero, rounded half up to digits decimals, as the
+   integer part, a point if digits > 0, and the fraction digits.  Decimals
+   past the 19th are not written; *zeroes is set to their number, for the
+   caller to append.  Returns 0 if the integer part does not fit 64 bits, or
+   value is not a number. */
+extern char *numfmt_fixed( double value, unsigned int digits, char *end, unsigned int *zeroes ) ;
+
+/* The fewest significant digits that read back as value, in plain notation
+   when the exponent is between -5 and 8, in scientific notation otherwise.
+   Writes a terminated string to buf and returns its length. */
+extern int numfmt_shortest( float value, char *buf ) ;
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // _NUMFMT_
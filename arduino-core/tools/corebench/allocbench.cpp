@@ -0,0 +1,281 @@
+//------------------------------------------------------------------------------
+// Allocation benchmark: operator new and delete under a mixed C++ workload.
+//
+// A task keeps a set of live objects and replaces them at random, as a
+// long-running sketch does: Strings made with new, lists and maps of a few
+// entries, vectors, and char arrays of up to 200 bytes. Objects are checked
+// for corruption when they are deleted. The workload runs in two builds of
+// the C++ runtime: allocbench links the pools of cplusplus/new.cpp, and
+// allocbench-heap the same file built with NEW_POOL_SIZE at 0, so that new
+// and delete go to malloc() and free() as before.
+//
+// For each build, the time per operation and the malloc() calls are reported,
+// and after the run the bytes allocated in the heap, against the free bytes
+// caught between them: the holes that fragmentation leaves. The pool figures
+// come from newPoolStats(). A page goes back to the arena once its blocks
+// have all been freed, so the pages of classes that are busy only for a
+// while (vectors growing through 4, 8, 16, 32 and 64 bytes) serve the other
+// classes after them; pages that keep a single block live still tie up
+// their class, and small allocations still spill to the heap.
+//
+// The heap is the C library's, not newlib's, and host objects hold 8 byte
+// pointers: the times say little about the target, but the allocations that
+// the pools keep from the heap, and the holes, do.
+//
+//   ./allocbench
+//   ./allocbench-heap
+//------------------------------------------------------------------------------
+
+#include "corebench.h"
+
+#include <WString.h>
+#include <new.h>
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include <malloc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Live objects, and operations on them.
+#define SLOTS           32
+#define OPERATIONS      2000000
+
+/// Kinds of objects.
+enum {
+    KIND_STRING,
+    KIND_LIST,
+    KIND_MAP,
+    KIND_VECTOR,
+    KIND_ARRAY,
+    KIND_COUNT
+};
+
+/// A live object, and the value it was filled with.
+struct Slot {
+    int kind;
+    unsigned int size;
+    uint8_t value;
+    void *pObject;
+};
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+static unsigned int errors;
+static uint32_t seed = 12345;
+static Slot slots[SLOTS];
+
+//------------------------------------------------------------------------------
+//         Local functions
+//------------------------------------------------------------------------------
+
+static uint32_t Random(void)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+static void Create(Slot *pSlot)
+{
+    unsigned int i;
+
+    pSlot->kind = Random() % KIND_COUNT;
+    pSlot->size = 1 + Random() % 8;
+    pSlot->value = Random();
+    switch (pSlot->kind) {
+
+        case KIND_STRING: {
+
+            // mostly short enough to stay inline
+            char text[48];
+
+            memset(text, 'a' + pSlot->value % 26, sizeof(text));
+            text[pSlot->size * (Random() % 4 == 0 ? 5 : 1)] = 0;
+            pSlot->pObject = new String(text);
+            break;
+        }
+        case KIND_LIST: {
+
+            std::list<int> *pList = new std::list<int>;
+
+            for (i = 0; i < pSlot->size; i++) {
+
+                pList->push_back(pSlot->value + i);
+            }
+            pSlot->pObject = pList;
+            break;
+        }
+        case KIND_MAP: {
+
+            std::map<int, int> *pMap = new std::map<int, int>;
+
+            for (i = 0; i < pSlot->size; i++) {
+
+                (*pMap)[i] = pSlot->value + i;
+            }
+            pSlot->pObject = pMap;
+            break;
+        }
+        case KIND_VECTOR: {
+
+            std::vector<int> *pVector = new std::vector<int>;
+
+            for (i = 0; i < pSlot->size * 4; i++) {
+
+                pVector->push_back(pSlot->value + i);
+            }
+            pSlot->pObject = pVector;
+            break;
+        }
+        case KIND_ARRAY:
+            pSlot->size = 1 + Random() % 200;
+            pSlot->pObject = new uint8_t[pSlot->size];
+            memset(pSlot->pObject, pSlot->value, pSlot->size);
+            break;
+    }
+}
+
+static void Destroy(Slot *pSlot)
+{
+    unsigned int i;
+    bool intact = true;
+
+    switch (pSlot->kind) {
+
+        case KIND_STRING: {
+
+            String *pString = (String *) pSlot->pObject;
+
+            for (i = 0; i < pString->length(); i++) {
+
+                intact &= (*pString)[i] == 'a' + pSlot->value % 26;
+            }
+            delete pString;
+            break;
+        }
+        case KIND_LIST: {
+
+            std::list<int> *pList = (std::list<int> *) pSlot->pObject;
+
+            i = 0;
+            for (int value : *pList) {
+
+                intact &= value == (int) (pSlot->value + i++);
+            }
+            intact &= i == pSlot->size;
+            delete pList;
+            break;
+        }
+        case KIND_MAP: {
+
+            std::map<int, int> *pMap = (std::map<int, int> *) pSlot->pObject;
+
+            i = 0;
+            for (auto &entry : *pMap) {
+
+                intact &= entry.first == (int) i
+                          && entry.second == (int) (pSlot->value + i);
+                i++;
+            }
+            intact &= i == pSlot->size;
+            delete pMap;
+            break;
+        }
+        case KIND_VECTOR: {
+
+            std::vector<int> *pVector = (std::vector<int> *) pSlot->pObject;
+
+            intact &= pVector->size() == pSlot->size * 4;
+            for (i = 0; i < pVector->size(); i++) {
+
+                intact &= (*pVector)[i] == (int) (pSlot->value + i);
+            }
+            delete pVector;
+            break;
+        }
+        case KIND_ARRAY: {
+
+            uint8_t *pArray = (uint8_t *) pSlot->pObject;
+
+            for (i = 0; i < pSlot->size; i++) {
+
+                intact &= pArray[i] == pSlot->value;
+            }
+            delete[] pArray;
+            break;
+        }
+    }
+    if (!intact) {
+
+        printf("kind %d object of %u corrupted\n", pSlot->kind, pSlot->size);
+        errors++;
+    }
+    pSlot->pObject = 0;
+}
+
+//------------------------------------------------------------------------------
+//         Main function
+//------------------------------------------------------------------------------
+
+int main(void)
+{
+    NewPoolStats stats;
+    struct mallinfo2 base;
+    struct mallinfo2 heap;
+    size_t holes;
+    unsigned int i;
+
+    // the C++ library allocates for itself before main()
+    base = mallinfo2();
+    for (i = 0; i < SLOTS; i++) {
+
+        Create(&slots[i]);
+    }
+    CoreBench_Begin();
+    for (i = 0; i < OPERATIONS; i++) {
+
+        Slot *pSlot = &slots[Random() % SLOTS];
+
+        Destroy(pSlot);
+        Create(pSlot);
+    }
+    CoreBench_End(NEW_POOL_SIZE ? "mixed workload, pools" : "mixed workload, heap",
+                  OPERATIONS);
+
+    heap = mallinfo2();
+    newPoolStats(&stats);
+    // the free space at the top of the heap can be returned; the rest is holes
+    holes = heap.fordblks - heap.keepcost;
+    heap.uordblks -= base.uordblks;
+    printf("heap %7zu allocated, %7zu in holes (%4.1f%%) in %zu chunks\n",
+           heap.uordblks, holes, 100.0 * holes / (heap.uordblks + holes),
+           heap.ordblks);
+    printf("pools %5zu of %d bytes used, %5zu allocated | %zu heap allocations, "
+           "%zu small ones\n", stats.pagesUsed * NEW_POOL_PAGE, NEW_POOL_SIZE,
+           stats.bytesInUse, stats.heapAllocations, stats.poolMisses);
+
+    for (i = 0; i < SLOTS; i++) {
+
+        Destroy(&slots[i]);
+    }
+    newPoolStats(&stats);
+    if (stats.bytesInUse != 0) {
+
+        printf("%zu bytes still allocated from the pools\n", stats.bytesInUse);
+        errors++;
+    }
+    printf("operator new, %u errors\n", errors);
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,239 @@
+//------------------------------------------------------------------------------
+// Concatenation benchmark: chains of 4 to 16 operands.
+//
+// Each chain mixes the operands a sketch puts together to report a reading:
+// String names, literal separators and numbers. It is assigned to a String,
+// printed to a Print that copies to a buffer (as a serial driver queues its
+// output), and copied to a char array. The results are checked against
+// snprintf() before timing.
+//
+//   ./concatbench
+//------------------------------------------------------------------------------
+
+#include "corebench.h"
+
+#include <Print.h>
+#include <WString.h>
+
+#include <stdio.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Iterations of each test.
+#define ITERATIONS      200000
+
+/// Print copying its output to a buffer.
+class BufferPrint : public Print
+{
+public:
+    BufferPrint(void) : length(0) {}
+    virtual size_t write(uint8_t c)
+    {
+        if (length < sizeof(buffer)) {
+
+            buffer[length++] = c;
+        }
+        return 1;
+    }
+    virtual size_t write(const uint8_t *pData, size_t size)
+    {
+        if (size > sizeof(buffer) - length) {
+
+            size = sizeof(buffer) - length;
+        }
+        memcpy(buffer + length, pData, size);
+        length += size;
+        return size;
+    }
+    char buffer[256];
+    unsigned int length;
+};
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+static String name("node7");
+static String unit("mV");
+static unsigned int errors;
+
+//------------------------------------------------------------------------------
+//         Chains
+//------------------------------------------------------------------------------
+
+/// Chains of 4, 8, 12 and 16 operands, each used as a String, a Printable
+/// and a char array by the SINK macro.
+#define CHAIN4(i)   name + ":" + (i) + unit
+#define CHAIN8(i)   CHAIN4(i) + ",t=" + 1000000UL + ",s=" + (int) -(i)
+#define CHAIN12(i)  CHAIN8(i) + ",x=" + 12 + ",y=" + -981
+#define CHAIN16(i)  CHAIN12(i) + ",z=" + (i) + ',' + unit
+
+static const char *formats[] = {
+    "%s:%u%s",
+    "%s:%u%s,t=1000000,s=%d",
+    "%s:%u%s,t=1000000,s=%d,x=12,y=-981",
+    "%s:%u%s,t=1000000,s=%d,x=12,y=-981,z=%u,%s"
+};
+
+static void Expected(char *buffer, unsigned int size, unsigned int operands,
+                     unsigned int i)
+{
+    snprintf(buffer, size, formats[operands / 4 - 1], "node7", i, "mV",
+             -(int) i, i, "mV");
+}
+
+static void Check(const char *test, const char *result, unsigned int operands,
+                  unsigned int i)
+{
+    char expected[256];
+
+    Expected(expected, sizeof(expected), operands, i);
+    if (strcmp(result, expected) != 0) {
+
+        printf("%u operands, %s: got \"%s\", expected \"%s\"\n",
+               operands, test, result, expected);
+        errors++;
+    }
+}
+
+/// Runs a chain in the given way for the given operands.
+#define RUN(chain, operands, way, iterations) \
+    switch (way) { \
+    case 0: \
+        for (i = 0; i < iterations; i++) { \
+            String s = chain(i); \
+            CoreBench_Consume(&i, s.length() > 0); \
+        } \
+        break; \
+    case 1: \
+        for (i = 0; i < iterations; i++) { \
+            sink.length = 0; \
+            sink.print(chain(i)); \
+            CoreBench_Consume(&i, sink.length > 0); \
+        } \
+        break; \
+    default: \
+        for (i = 0; i < iterations; i++) { \
+            (chain(i)).toCharArray(buffer, sizeof(buffer)); \
+            CoreBench_Consume(buffer, 1); \
+        } \
+        break; \
+    }
+
+static void Run(unsigned int operands, unsigned int way,
+                unsigned int iterations)
+{
+    BufferPrint sink;
+    char buffer[256];
+    unsigned int i;
+
+    switch (operands) {
+    case 4: RUN(CHAIN4, 4, way, iterations); break;
+    case 8: RUN(CHAIN8, 8, way, iterations); break;
+    case 12: RUN(CHAIN12, 12, way, iterations); break;
+    default: RUN(CHAIN16, 16, way, iterations); break;
+    }
+}
+
+//------------------------------------------------------------------------------
+//         Checks
+//------------------------------------------------------------------------------
+
+static void CheckAll(void)
+{
+    unsigned int i = 4294967295U;
+    char buffer[256];
+
+    // Each length and way of using the chain
+    {
+        String s = CHAIN4(i);
+        s.toCharArray(buffer, sizeof(buffer));
+        Check("String", buffer, 4, i);
+    }
+    {
+        String s = CHAIN16(i);
+        s.toCharArray(buffer, sizeof(buffer));
+        Check("String", buffer, 16, i);
+    }
+    {
+        BufferPrint sink;
+        sink.print(CHAIN12(i));
+        sink.buffer[sink.length] = 0;
+        Check("Print", sink.buffer, 12, i);
+    }
+    (CHAIN8(i)).toCharArray(buffer, sizeof(buffer));
+    Check("char array", buffer, 8, i);
+
+    // Truncation, assignment to an operand, and invalid operands
+    (CHAIN4(i)).toCharArray(buffer, 6);
+    if (strcmp(buffer, "node7") != 0) {
+
+        printf("truncated: got \"%s\"\n", buffer);
+        errors++;
+    }
+    String s("x");
+    s = s + "=" + s + s;
+    s.toCharArray(buffer, sizeof(buffer));
+    if (strcmp(buffer, "x=xx") != 0) {
+
+        printf("assignment to an operand: got \"%s\"\n", buffer);
+        errors++;
+    }
+    s += "," + s + ";";
+    s.toCharArray(buffer, sizeof(buffer));
+    if (strcmp(buffer, "x=xx,x=xx;") != 0) {
+
+        printf("append of an operand: got \"%s\"\n", buffer);
+        errors++;
+    }
+    s = name + (const char *) 0;
+    if (s || (s.length() != 0) || (name + (const char *) 0)) {
+
+        printf("null operand: result is valid\n");
+        errors++;
+    }
+
+    // The const methods of String, on the result
+    if (((name + unit).indexOf('m') != 5) || ((name + 12).toInt() != 0)
+        || ((String(12) + 34).toInt() != 1234)
+        || !(name + ":" + i).startsWith("node7:4")
+        || !(name + unit).endsWith(unit) || ((name + unit) != "node7mV")
+        || ((name + unit).substring(4, 6) != "7m")
+        || (strcmp((name + ':' + unit).c_str(), "node7:mV") != 0)) {
+
+        printf("String methods on a sum: wrong result\n");
+        errors++;
+    }
+}
+
+//------------------------------------------------------------------------------
+//         Main function
+//------------------------------------------------------------------------------
+
+int main(void)
+{
+    static const char *ways[] = {"String", "Print", "char array"};
+    unsigned int operands, way;
+    char label[32];
+
+    CheckAll();
+    printf("Concatenation, %u-byte StringSum per \"+\", %u errors\n",
+           (unsigned int) sizeof(StringSum), errors);
+
+    for (operands = 4; operands <= 16; operands += 4) {
+
+        for (way = 0; way < 3; way++) {
+
+            snprintf(label, sizeof(label), "%u operands, %s",
+                     operands, ways[way]);
+            CoreBench_Begin();
+            Run(operands, way, ITERATIONS);
+            CoreBench_End(label, ITERATIONS);
+        }
+    }
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,143 @@
+//------------------------------------------------------------------------------
+// Timing and heap accounting of the host benchmarks. See corebench.h.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+//         Headers
+//------------------------------------------------------------------------------
+
+#include "corebench.h"
+
+#include <wiring.h>
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+static unsigned long long allocations;
+static unsigned long long requested;
+static unsigned long long inUse;
+static unsigned long long peak;
+
+static unsigned long long startTime;
+static unsigned long long startAllocations;
+static unsigned long long startRequested;
+static unsigned long long startInUse;
+
+static volatile unsigned char sink;
+
+//------------------------------------------------------------------------------
+//         Allocator wrappers
+//------------------------------------------------------------------------------
+
+extern "C" {
+
+void *__real_malloc(size_t size);
+void *__real_realloc(void *pointer, size_t size);
+void __real_free(void *pointer);
+
+void *__wrap_malloc(size_t size)
+{
+    void *pointer = __real_malloc(size);
+
+    allocations++;
+    requested += size;
+    if (pointer) {
+
+        inUse += malloc_usable_size(pointer);
+        if (inUse > peak) {
+
+            peak = inUse;
+        }
+    }
+    return pointer;
+}
+
+void *__wrap_realloc(void *pointer, size_t size)
+{
+    size_t before = pointer ? malloc_usable_size(pointer) : 0;
+    void *newPointer = __real_realloc(pointer, size);
+
+    allocations++;
+    requested += size;
+    if (newPointer) {
+
+        inUse += malloc_usable_size(newPointer) - before;
+        if (inUse > peak) {
+
+            peak = inUse;
+        }
+    }
+    return newPointer;
+}
+
+void __wrap_free(void *pointer)
+{
+    if (pointer) {
+
+        inUse -= malloc_usable_size(pointer);
+    }
+    __real_free(pointer);
+}
+
+}
+
+//------------------------------------------------------------------------------
+//         Exported functions
+//------------------------------------------------------------------------------
+
+unsigned long long CoreBench_GetTime(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// The time base of the core, from the host clock.
+unsigned long millis(void)
+{
+    return (unsigned long) (CoreBench_GetTime() / 1000000);
+}
+
+unsigned long micros(void)
+{
+    return (unsigned long) (CoreBench_GetTime() / 1000);
+}
+
+void CoreBench_Consume(const void *pData, unsigned int length)
+{
+    const unsigned char *pBytes = (const unsigned char *) pData;
+    unsigned int i;
+
+    for (i = 0; i < length; i++) {
+
+        sink ^= pBytes[i];
+    }
+}
+
+void CoreBench_Begin(void)
+{
+    startAllocations = allocations;
+    startRequested = requested;
+    startInUse = inUse;
+    peak = inUse;
+    startTime = CoreBench_GetTime();
+}
+
+void CoreBench_End(const char *label, unsigned int iterations)
+{
+    unsigned long long time = CoreBench_GetTime() - startTime;
+
+    printf("%-28s %9.1f ns | %7.2f allocs %9.1f bytes | peak %7llu bytes\n",
+           label,
+           (double) time / iterations,
+           (double) (allocations - startAllocations) / iterations,
+           (double) (requested - startRequested) / iterations,
+           peak - startInUse);
+}
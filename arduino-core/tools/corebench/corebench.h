@@ -0,0 +1,33 @@
+//------------------------------------------------------------------------------
+// Timing and heap accounting shared by the host benchmarks of the Arduino
+// core.
+//
+// The programs are linked with malloc(), realloc() and free() wrapped, so
+// that every allocation made by the code under test is counted. A
+// measurement is bracketed by CoreBench_Begin() and CoreBench_End(), which
+// prints one line with the time per iteration, the allocations (malloc and
+// realloc calls) and the bytes requested per iteration, and the peak growth of
+// the heap in use during the measurement.
+//
+// millis() and micros() are defined from the host clock, for the Stream
+// timed reads.
+//------------------------------------------------------------------------------
+
+#ifndef COREBENCH_H
+#define COREBENCH_H
+
+//------------------------------------------------------------------------------
+//         Exported functions
+//------------------------------------------------------------------------------
+
+extern void CoreBench_Begin(void);
+
+extern void CoreBench_End(const char *label, unsigned int iterations);
+
+/// Host time in ns.
+extern unsigned long long CoreBench_GetTime(void);
+
+/// Keeps the compiler from optimizing away a result.
+extern void CoreBench_Consume(const void *pData, unsigned int length);
+
+#endif //#ifndef COREBENCH_H
@@ -0,0 +1,343 @@
+//------------------------------------------------------------------------------
+// Search benchmark: Stream::find() and findUntil() on protocol-like input.
+//
+// A port holds a megabyte of NMEA sentences. It either only gives bytes
+// through read(), so that the search goes through timedRead() a byte at a
+// time, or also lends them with rxAcquire() in 512 byte regions, as USBSerial
+// lends its receive buffers. The searches are repeated until the input is
+// used up, and each test reports the bytes scanned per second. The previous
+// findUntil() is kept as a reference; it read a byte at a time and started
+// over on a failed partial match.
+//
+// First, the results of both paths, and the bytes they consume, are checked
+// against a plain search over random input with a small alphabet, with lent
+// regions of random sizes, and targets and terminators that overlap
+// themselves and each other.
+//
+//   ./findbench
+//------------------------------------------------------------------------------
+
+#include "corebench.h"
+
+#include <Stream.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Size of the benchmark input.
+#define INPUT_SIZE      (1024 * 1024)
+
+/// Random inputs checked, and their size.
+#define CHECKS          20000
+#define CHECK_SIZE      400
+
+/// Port reading from a buffer, and lending regions of it if asked to.
+class Device : public Stream
+{
+public:
+    Device(const uint8_t *pData, size_t length, size_t region)
+        : pData(pData), length(length), pos(0), region(region)
+    {
+        setTimeout(0);
+    }
+    virtual int available(void) { return length - pos; }
+    virtual int read(void) { return pos < length ? pData[pos++] : -1; }
+    virtual int peek(void) { return pos < length ? pData[pos] : -1; }
+    virtual void flush(void) {}
+    virtual size_t write(uint8_t c) { return 0; }
+    using Print::write;
+    virtual const uint8_t *rxAcquire(size_t *count)
+    {
+        size_t end;
+
+        if (region == 0 || pos == length) {
+
+            return 0;
+        }
+        // regions end on multiples of the region size, like ring wraps
+        end = (pos / region + 1) * region;
+        *count = (end < length ? end : length) - pos;
+        return pData + pos;
+    }
+    virtual void rxRelease(size_t used) { pos += used; }
+
+    const uint8_t *pData;
+    size_t length;
+    size_t pos;
+    size_t region;
+};
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+static unsigned int errors;
+static uint32_t seed = 12345;
+static uint8_t input[INPUT_SIZE];
+
+//------------------------------------------------------------------------------
+//         Previous search
+//------------------------------------------------------------------------------
+
+/// Stream::timedRead(), with millis() at 0.
+static int __attribute__((noinline)) OldTimedRead(Stream &stream)
+{
+    return stream.read();
+}
+
+static bool OldFindUntil(Stream &stream, const char *target, size_t targetLen,
+                         const char *terminator, size_t termLen)
+{
+    size_t index = 0;
+    size_t termIndex = 0;
+    int c;
+
+    if (*target == 0)
+        return true;
+    while ((c = OldTimedRead(stream)) > 0) {
+        if (c == target[index]) {
+            if (++index >= targetLen) {
+                return true;
+            }
+        }
+        else {
+            index = 0;
+        }
+        if (termLen > 0 && c == terminator[termIndex]) {
+            if (++termIndex >= termLen)
+                return false;
+        }
+        else
+            termIndex = 0;
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+//         Local functions
+//------------------------------------------------------------------------------
+
+static uint32_t Random(void)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+/// The target is found where it first ends, unless the terminator ends first.
+static bool Expected(const uint8_t *pData, size_t length, size_t *pPos,
+                     const char *target, size_t targetLen,
+                     const char *terminator, size_t termLen)
+{
+    size_t start = *pPos;
+    size_t end;
+
+    for (end = start + 1; end <= length; end++) {
+
+        if (end - start >= targetLen
+            && memcmp(pData + end - targetLen, target, targetLen) == 0) {
+
+            *pPos = end;
+            return true;
+        }
+        if (termLen > 0 && end - start >= termLen
+            && memcmp(pData + end - termLen, terminator, termLen) == 0) {
+
+            *pPos = end;
+            return false;
+        }
+    }
+    *pPos = length;
+    return false;
+}
+
+static void RandomString(char *s, size_t length, const char *alphabet)
+{
+    size_t n = strlen(alphabet);
+    size_t i;
+
+    for (i = 0; i < length; i++) {
+
+        s[i] = alphabet[Random() % n];
+    }
+    s[length] = 0;
+}
+
+static void Check(void)
+{
+    static const char *alphabets[] = { "ab", "abc", "ab\r\n", "abcdefgh" };
+    uint8_t data[CHECK_SIZE];
+    char target[48];
+    char terminator[48];
+    unsigned int oldWrong = 0;
+    unsigned int i;
+
+    for (i = 0; i < CHECKS; i++) {
+
+        const char *alphabet = alphabets[i % 4];
+        // targets past 32 characters compute their fallbacks when needed
+        size_t targetLen = 1 + Random() % (i % 8 == 0 ? 40 : 8);
+        size_t termLen = i % 3 == 0 ? 0 : 1 + Random() % 6;
+        size_t n = strlen(alphabet);
+        size_t j;
+        int pass;
+
+        RandomString(target, targetLen, alphabet);
+        RandomString(terminator, termLen, alphabet);
+        for (j = 0; j < sizeof(data); j++) {
+
+            data[j] = alphabet[Random() % n];
+        }
+        // plant the target, most of the time
+        if (Random() % 4) {
+
+            j = Random() % (sizeof(data) - targetLen);
+            memcpy(data + j, target, targetLen);
+        }
+
+        for (pass = 0; pass < 2; pass++) {
+
+            size_t region = pass ? 1 + Random() % 64 : 0;
+            Device device(data, sizeof(data), region);
+            size_t expectedPos = 0;
+
+            // search repeatedly, as a parser does
+            while (expectedPos < sizeof(data)) {
+
+                bool expected = Expected(data, sizeof(data), &expectedPos,
+                                         target, targetLen,
+                                         terminator, termLen);
+                bool found = device.findUntil(target, targetLen,
+                                              terminator, termLen);
+
+                if (found != expected || device.pos != expectedPos) {
+
+                    printf("findUntil(\"%s\", \"%s\"), %u byte regions: got %d at %u, "
+                           "expected %d at %u\n", target, terminator,
+                           (unsigned int) region, found,
+                           (unsigned int) device.pos, expected,
+                           (unsigned int) expectedPos);
+                    errors++;
+                    break;
+                }
+            }
+        }
+
+        Device old(data, sizeof(data), 0);
+        size_t expectedPos = 0;
+        bool expected = Expected(data, sizeof(data), &expectedPos, target,
+                                 targetLen, terminator, termLen);
+
+        if (OldFindUntil(old, target, targetLen, terminator, termLen) != expected
+            || old.pos != expectedPos) {
+
+            oldWrong++;
+        }
+    }
+    printf("previous findUntil: %u of %u first searches wrong\n",
+           oldWrong, CHECKS);
+}
+
+/// NMEA sentences, with one RMC sentence in ten.
+static void MakeInput(void)
+{
+    static const char *sentences[] = {
+        "$GPGGA,%06u,4807.%03u,N,01131.%03u,E,1,08,0.9,545.4,M,46.9,M,,*%02X\r\n",
+        "$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*%02X\r\n",
+        "$GPGSV,2,1,08,01,40,083,%02u,02,17,308,%02u,12,07,344,39,14,22,228,45*%02X\r\n",
+        "$GPRMC,%06u,A,4807.%03u,N,01131.%03u,E,022.4,084.4,230394,003.1,W*%02X\r\n"
+    };
+    size_t length = 0;
+    unsigned int line = 0;
+    char buffer[128];
+    int n = 0;
+
+    while (length < sizeof(input)) {
+
+        unsigned int kind = line % 10 == 9 ? 3 : line % 3;
+
+        switch (kind) {
+
+            case 0: case 3:
+                n = snprintf(buffer, sizeof(buffer), sentences[kind], line,
+                             Random() % 1000, Random() % 1000, Random() % 256);
+                break;
+            case 1:
+                n = snprintf(buffer, sizeof(buffer), sentences[kind],
+                             Random() % 256);
+                break;
+            case 2:
+                n = snprintf(buffer, sizeof(buffer), sentences[kind],
+                             Random() % 100, Random() % 100, Random() % 256);
+                break;
+        }
+        if ((size_t) n > sizeof(input) - length) {
+
+            n = sizeof(input) - length;
+        }
+        memcpy(input + length, buffer, n);
+        length += n;
+        line++;
+    }
+}
+
+static void Run(const char *label, int method, const char *target,
+                const char *terminator)
+{
+    size_t targetLen = strlen(target);
+    size_t termLen = terminator ? strlen(terminator) : 0;
+    Device device(input, sizeof(input), method == 2 ? 512 : 0);
+    unsigned long long start;
+    unsigned long long time;
+    unsigned int found = 0;
+
+    start = CoreBench_GetTime();
+    while (device.pos < device.length) {
+
+        if (method == 0) {
+
+            found += OldFindUntil(device, target, targetLen, terminator,
+                                  termLen);
+        } else {
+
+            found += device.findUntil((char *) target, targetLen,
+                                      (char *) terminator, termLen);
+        }
+    }
+    time = CoreBench_GetTime() - start;
+    printf("%-34s %8.1f MB/s, %6u found\n", label,
+           (double) sizeof(input) * 1000 / time, found);
+}
+
+//------------------------------------------------------------------------------
+//         Main function
+//------------------------------------------------------------------------------
+
+int main(void)
+{
+    Check();
+    printf("Stream::findUntil, %u errors\n", errors);
+
+    MakeInput();
+    Run("\"\\n\", previous", 0, "\n", 0);
+    Run("\"\\n\", read()", 1, "\n", 0);
+    Run("\"\\n\", rxAcquire()", 2, "\n", 0);
+    Run("\"$GPRMC\", previous", 0, "$GPRMC", 0);
+    Run("\"$GPRMC\", read()", 1, "$GPRMC", 0);
+    Run("\"$GPRMC\", rxAcquire()", 2, "$GPRMC", 0);
+    Run("\"$GPRMC\" until \"*\", previous", 0, "$GPRMC", "*");
+    Run("\"$GPRMC\" until \"*\", read()", 1, "$GPRMC", "*");
+    Run("\"$GPRMC\" until \"*\", rxAcquire()", 2, "$GPRMC", "*");
+    Run("absent 27 chars, previous", 0, "$GPZDA,000000.00,01,01,2000", 0);
+    Run("absent 27 chars, read()", 1, "$GPZDA,000000.00,01,01,2000", 0);
+    Run("absent 27 chars, rxAcquire()", 2, "$GPZDA,000000.00,01,01,2000", 0);
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,246 @@
+//------------------------------------------------------------------------------
+// Formatting benchmark: BetterStream::printf against vsnprintf.
+//
+// A telemetry record is formatted to a serial device, with integers only and
+// with a float, by the C library's vsnprintf into a stack buffer handed to
+// write(), by the variadic BetterStream::printf, and by the printf checked at
+// compile time, both from its stack buffer and straight into a transmit
+// buffer lent by the device, as USBSerial does. The float is also given as a
+// Q16 FixedPoint. Each test reports the time per record and the calls made to
+// write() and txAcquire(). The output of both printf is first checked
+// against vsnprintf over the supported conversions.
+//
+// On the host, vsnprintf is the C library's rather than newlib's, and the
+// times do not model the Cortex-M3, where the floating point arithmetic of
+// both is in software.
+//
+//   ./formatbench
+//------------------------------------------------------------------------------
+
+#include "corebench.h"
+
+#include <BetterStream.h>
+#include <WString.h>
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Records formatted by each test.
+#define ITERATIONS      200000
+
+/// Device copying its output to a buffer, and lending it if asked to.
+class Device : public BetterStream
+{
+public:
+    Device(bool lend) : lend(lend), length(0), spanCalls(0), acquires(0) {}
+    virtual int available(void) { return 0; }
+    virtual int read(void) { return -1; }
+    virtual int peek(void) { return -1; }
+    virtual void flush(void) {}
+    virtual size_t write(uint8_t c) { return write(&c, 1); }
+    virtual size_t write(const uint8_t *pData, size_t size)
+    {
+        spanCalls++;
+        if (size > sizeof(buffer) - 1 - length) {
+
+            size = sizeof(buffer) - 1 - length;
+        }
+        memcpy(buffer + length, pData, size);
+        length += size;
+        return size;
+    }
+    using Print::write;
+    virtual uint8_t *txAcquire(size_t *space)
+    {
+        if (!lend) {
+
+            return BetterStream::txAcquire(space);
+        }
+        acquires++;
+        *space = sizeof(buffer) - 1 - length;
+        return (uint8_t *) buffer + length;
+    }
+    virtual void txRelease(size_t used)
+    {
+        length += used;
+    }
+    bool lend;
+    char buffer[256];
+    unsigned int length;
+    unsigned long long spanCalls;
+    unsigned long long acquires;
+};
+
+/// Checks a format with vsnprintf, the variadic printf and the checked printf.
+#define CHECK(format, ...) \
+    do { \
+        Expect(format, __VA_ARGS__); \
+        stack.printf(format, __VA_ARGS__); \
+        Check(stack, format); \
+        stack.printf(FMT(format), __VA_ARGS__); \
+        Check(stack, format); \
+        lent.printf(FMT(format), __VA_ARGS__); \
+        Check(lent, format); \
+    } while (0)
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+static char expected[256];
+static unsigned int errors;
+
+//------------------------------------------------------------------------------
+//         Local functions
+//------------------------------------------------------------------------------
+
+static void Expect(const char *format, ...)
+    __attribute__ ((format(__printf__, 1, 2)));
+
+static void Expect(const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    vsnprintf(expected, sizeof(expected), format, ap);
+    va_end(ap);
+}
+
+static void Check(Device &device, const char *format)
+{
+    device.buffer[device.length] = 0;
+    if (strcmp(device.buffer, expected) != 0) {
+
+        printf("%s: got \"%s\", expected \"%s\"\n",
+               format, device.buffer, expected);
+        errors++;
+    }
+    device.length = 0;
+}
+
+static void Validate(void)
+{
+    Device stack(false);
+    Device lent(true);
+    String name("node7");
+
+    CHECK("%d|%5d|%-5d|%05d|%+d|% d|%.3d|%.0d|", 42, -42, 42, -42, 42, 42, 7, 0);
+    CHECK("%u %x %X %08x %o %i", 4000000000u, 0xbeefu, 0xbeefu, 0x1fu, 8u, -1);
+    CHECK("%ld %lu %lx %hd", -2147483647L - 1, 4294967295UL, 0xdeadbeefUL,
+          (short) -300);
+    CHECK("%c|%3c|%-3c|", 'a', 'b', 'c');
+    CHECK("%s|%8s|%-8s|%.2s|%s", "abc", "abc", "abc", "abc", "");
+    CHECK("%f %.3f %.0f %10.2f %-10.2f| %010.3f %+.1f", 3.14159, -2.71828,
+          0.4, 99.125001, -1.5, -3.14159, 0.05001);
+    CHECK("%.9f %.12f %f %f", 1.0 / 3, 0.5, 4294967296.5, -0.0);
+    CHECK("%e %.2e %E %.0e %12.3e %e", 12345.678, 0.000123, 1e300, 7e-310,
+          -6.02e23, 0.0);
+    CHECK("%f %f %5.1f", (double) NAN, (double) -INFINITY, (double) INFINITY);
+    CHECK("%lu%% done%s", 99UL, "");
+
+    // arguments that only the checked printf takes
+    Expect("%s %.4f %.2f %.0f %f", "node7", 1.5, -2.75,
+           0x7fffffff / 65536.0, 1 / 65536.0);
+    lent.printf(FMT("%s %.4f %.2f %.0f %f"), name, FixedPoint(0x18000, 16),
+                FixedPoint(-176, 6), FixedPoint(0x7fffffff, 16),
+                FixedPoint(1, 16));
+    Check(lent, "FixedPoint");
+
+    // output longer than the stack buffer and the lent space
+    Expect("%200s|%-40d|", "wide", 1);
+    stack.printf(FMT("%200s|%-40d|"), "wide", 1);
+    Check(stack, "%200s|%-40d|");
+    lent.length = 200;
+    lent.printf(FMT("%100d"), 1);
+    if (lent.length != sizeof(lent.buffer) - 1) {
+
+        printf("lent buffer overflowed: %u bytes\n", lent.length);
+        errors++;
+    }
+    lent.length = 0;
+}
+
+static void Run(const char *label, int method, bool lend)
+{
+    Device device(lend);
+    char buffer[96];
+    unsigned long time;
+    long value = -12345;
+    double level = 3.14159;
+    FixedPoint fixed((int32_t) (3.14159 * 65536), 16);
+    unsigned int i;
+    int n;
+
+    CoreBench_Begin();
+    for (i = 0; i < ITERATIONS; i++) {
+
+        time = 1000000UL + i;
+        device.length = 0;
+        switch (method) {
+
+            case 0:
+                n = snprintf(buffer, sizeof(buffer), "t=%lu v=%6ld x=%08lx\r\n",
+                             time, value, (unsigned long) value & 0xffffffff);
+                device.write((const uint8_t *) buffer, n);
+                break;
+            case 1:
+                device.printf("t=%lu v=%6ld x=%08lx\r\n",
+                              time, value, (unsigned long) value & 0xffffffff);
+                break;
+            case 2:
+                device.printf(FMT("t=%lu v=%6ld x=%08lx\r\n"),
+                              time, value, (unsigned long) value & 0xffffffff);
+                break;
+            case 3:
+                n = snprintf(buffer, sizeof(buffer), "t=%lu v=%6ld l=%.3f s=%s\r\n",
+                             time, value, level, "OK");
+                device.write((const uint8_t *) buffer, n);
+                break;
+            case 4:
+                device.printf("t=%lu v=%6ld l=%.3f s=%s\r\n",
+                              time, value, level, "OK");
+                break;
+            case 5:
+                device.printf(FMT("t=%lu v=%6ld l=%.3f s=%s\r\n"),
+                              time, value, level, "OK");
+                break;
+            case 6:
+                device.printf(FMT("t=%lu v=%6ld l=%.3f s=%s\r\n"),
+                              time, value, fixed, "OK");
+                break;
+        }
+        CoreBench_Consume(device.buffer, device.length);
+    }
+    CoreBench_End(label, ITERATIONS);
+    printf("%-28s %9.1f writes, %.1f acquires\n", "",
+           (double) device.spanCalls / ITERATIONS,
+           (double) device.acquires / ITERATIONS);
+}
+
+//------------------------------------------------------------------------------
+//         Main function
+//------------------------------------------------------------------------------
+
+int main(void)
+{
+    Validate();
+    printf("BetterStream::printf, %u errors\n", errors);
+
+    Run("integers, vsnprintf", 0, false);
+    Run("integers, printf", 1, false);
+    Run("integers, FMT printf", 2, false);
+    Run("integers, FMT printf, lent", 2, true);
+    Run("float, vsnprintf", 3, false);
+    Run("float, printf", 4, false);
+    Run("float, FMT printf", 5, false);
+    Run("float, FMT printf, lent", 5, true);
+    Run("fixed point, FMT printf, lent", 6, true);
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,391 @@
+//------------------------------------------------------------------------------
+// Number conversion benchmark: the numfmt module against the loops it
+// replaced.
+//
+// The previous ultoa(), Print::printNumber() and Print::printFloat() are kept
+// here as references. Each is run against the numfmt version over random
+// and edge values, in decimal, hex and binary, and with 0 to 9 decimals. Where
+// the float outputs differ, both are compared with the correctly rounded
+// value from the C library. numfmt_shortest() is checked to read back as the
+// same float, with no more digits than the shortest "%.*g" that does. Last,
+// each conversion is timed, per call.
+//
+// The times are host times, with a hardware FPU. On the Cortex-M3 the old
+// float loop costs a soft-float divide per decimal, then a soft-float
+// multiply, conversion and subtract per digit; numfmt_fixed() does one
+// subtract, multiply and add per number.
+//
+//   ./numberbench
+//------------------------------------------------------------------------------
+
+#include "corebench.h"
+
+#include <Print.h>
+#include <itoa.h>
+#include <numfmt.h>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Values checked, and conversions timed, per test.
+#define VALUES          1000000
+#define ITERATIONS      1000000
+
+/// Device collecting what is printed.
+class Device : public Print
+{
+public:
+    Device() : length(0) {}
+    virtual size_t write(uint8_t c) { return write(&c, 1); }
+    virtual size_t write(const uint8_t *pData, size_t size)
+    {
+        if (size > sizeof(buffer) - 1 - length) {
+
+            size = sizeof(buffer) - 1 - length;
+        }
+        memcpy(buffer + length, pData, size);
+        length += size;
+        buffer[length] = 0;
+        return size;
+    }
+    using Print::write;
+    char buffer[128];
+    unsigned int length;
+};
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+static unsigned int errors;
+static uint32_t seed = 12345;
+
+//------------------------------------------------------------------------------
+//         Previous conversions
+//------------------------------------------------------------------------------
+
+static char *OldUltoa(uint32_t value, char *string, int radix)
+{
+    char tmp[33];
+    char *tp = tmp;
+    long i;
+    uint32_t v = value;
+    char *sp;
+
+    while (v || tp == tmp) {
+
+        i = v % radix;
+        v = v / radix;
+        if (i < 10)
+            *tp++ = i + '0';
+        else
+            *tp++ = i + 'a' - 10;
+    }
+    sp = string;
+    while (tp > tmp)
+        *sp++ = *--tp;
+    *sp = 0;
+    return string;
+}
+
+static void OldPrintNumber(uint32_t n, uint8_t base, char *out)
+{
+    char buf[8 * sizeof(long) + 2];
+    char *str = &buf[sizeof(buf) - 1];
+
+    *str = '\0';
+    if (base < 2) base = 10;
+    do {
+        uint32_t m = n;
+        n /= base;
+        char c = m - base * n;
+        *--str = c < 10 ? c + '0' : c + 'A' - 10;
+    } while (n);
+    strcpy(out, str);
+}
+
+static void OldPrintFloat(double number, uint8_t digits, char *out)
+{
+    if (number < 0.0) {
+
+        *out++ = '-';
+        number = -number;
+    }
+    double rounding = 0.5;
+    for (uint8_t i = 0; i < digits; ++i)
+        rounding /= 10.0;
+    number += rounding;
+
+    uint32_t int_part = (uint32_t) number;
+    double remainder = number - (double) int_part;
+    char buf[8 * sizeof(long) + 1];
+    char *str = &buf[sizeof(buf) - 1];
+    *str = '\0';
+    do {
+        uint32_t m = int_part;
+        int_part /= 10;
+        *--str = m - 10 * int_part + '0';
+    } while (int_part);
+    strcpy(out, str);
+    out += strlen(out);
+    if (digits > 0) {
+
+        *out++ = '.';
+    }
+    while (digits-- > 0) {
+
+        remainder *= 10.0;
+        int toPrint = int(remainder);
+        *out++ = '0' + toPrint;
+        remainder -= toPrint;
+    }
+    *out = 0;
+}
+
+//------------------------------------------------------------------------------
+//         Local functions
+//------------------------------------------------------------------------------
+
+static uint32_t Random(void)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+/// Random integers with a uniform number of digits, and edge values.
+static uint32_t RandomInteger(unsigned int i)
+{
+    static const uint32_t edges[] = {
+        0, 1, 9, 10, 99, 100, 999, 1000, 65535, 65536, 99999999, 100000000,
+        999999999, 1000000000, 2147483647, 2147483648u, 4294967295u
+    };
+
+    if (i < sizeof(edges) / sizeof(edges[0])) {
+
+        return edges[i];
+    }
+    return Random() >> (Random() % 32);
+}
+
+/// Random doubles below 2^32 with a uniform number of digits.
+static double RandomDouble(void)
+{
+    return (double) Random() / 4294967296.0
+           * pow(10, (int) (Random() % 10) - 1);
+}
+
+static float RandomFloat(void)
+{
+    union { uint32_t u; float f; } bits;
+
+    do {
+
+        bits.u = Random();
+    } while ((bits.u & 0x7f800000) == 0x7f800000);
+    return bits.f;
+}
+
+static void CheckIntegers(void)
+{
+    static const int radixes[] = { 10, 16, 2, 8, 36 };
+    Device device;
+    char expected[40];
+    char got[40];
+    unsigned int i, r;
+
+    for (i = 0; i < VALUES; i++) {
+
+        uint32_t value = RandomInteger(i);
+
+        for (r = 0; r < sizeof(radixes) / sizeof(radixes[0]); r++) {
+
+            OldUltoa(value, expected, radixes[r]);
+            ultoa(value, got, radixes[r]);
+            if (strcmp(got, expected) != 0) {
+
+                printf("ultoa(%u, %d): got %s, expected %s\n",
+                       value, radixes[r], got, expected);
+                errors++;
+            }
+            OldPrintNumber(value, radixes[r], expected);
+            device.length = 0;
+            device.print((unsigned long) value, radixes[r]);
+            if (strcmp(device.buffer, expected) != 0) {
+
+                printf("print(%u, %d): got %s, expected %s\n",
+                       value, radixes[r], device.buffer, expected);
+                errors++;
+            }
+        }
+    }
+}
+
+static void CheckFloats(void)
+{
+    Device device;
+    char expected[64];
+    char exact[64];
+    unsigned int differ = 0;
+    unsigned int newRight = 0;
+    unsigned int oldRight = 0;
+    unsigned int i;
+
+    for (i = 0; i < VALUES; i++) {
+
+        double value = (Random() & 1 ? -1 : 1) * RandomDouble();
+        uint8_t digits = i % 10;
+
+        OldPrintFloat(value, digits, expected);
+        device.length = 0;
+        device.print(value, digits);
+        if (strcmp(device.buffer, expected) != 0) {
+
+            // the C library rounds the exact binary value
+            snprintf(exact, sizeof(exact), "%.*f", digits, value);
+            differ++;
+            newRight += strcmp(device.buffer, exact) == 0;
+            oldRight += strcmp(expected, exact) == 0;
+        }
+    }
+    printf("print(double): %u of %u differ from the old loop; "
+           "correctly rounded: %u new, %u old\n",
+           differ, VALUES, newRight, oldRight);
+    if (newRight < oldRight) {
+
+        errors++;
+    }
+}
+
+static void CheckShortest(void)
+{
+    char got[NUMFMT_SHORTEST_SIZE];
+    char reference[32];
+    unsigned int longer = 0;
+    unsigned int i;
+    int precision;
+
+    for (i = 0; i < VALUES; i++) {
+
+        float value = RandomFloat();
+
+        numfmt_shortest(value, got);
+        if (strtof(got, 0) != value) {
+
+            printf("numfmt_shortest(%.9g): %s reads back as %.9g\n",
+                   value, got, strtof(got, 0));
+            errors++;
+        }
+        for (precision = 1; precision < 9; precision++) {
+
+            snprintf(reference, sizeof(reference), "%.*g", precision, value);
+            if (strtof(reference, 0) == value) {
+
+                break;
+            }
+        }
+        // significant digits: skip the sign, point, leading zeroes and exponent
+        const char *p = got;
+        int digits = 0;
+        bool leading = true;
+        for (; *p && *p != 'e'; p++) {
+
+            if (*p >= '1' && *p <= '9') leading = false;
+            if (*p >= '0' && *p <= '9' && !leading) digits++;
+        }
+        // trailing zeroes of an integer are not significant
+        if (!strchr(got, '.') && !strchr(got, 'e')) {
+
+            while (p > got && p[-1] == '0') {
+
+                p--;
+                digits--;
+            }
+        }
+        if (digits > precision) {
+
+            longer++;
+        }
+    }
+    printf("numfmt_shortest: %u of %u longer than the shortest %%g\n",
+           longer, VALUES);
+    if (longer) {
+
+        errors++;
+    }
+}
+
+static void Time(const char *label, int method)
+{
+    static uint32_t integers[1024];
+    static double doubles[1024];
+    static float floats[1024];
+    char buffer[64];
+    unsigned int zeroes;
+    unsigned int i;
+
+    for (i = 0; i < 1024; i++) {
+
+        integers[i] = RandomInteger(100);
+        doubles[i] = RandomDouble() * 1000;
+        floats[i] = (float) doubles[i];
+    }
+    CoreBench_Begin();
+    for (i = 0; i < ITERATIONS; i++) {
+
+        switch (method) {
+
+            case 0: OldUltoa(integers[i & 1023], buffer, 10); break;
+            case 1: ultoa(integers[i & 1023], buffer, 10); break;
+            case 2: OldUltoa(integers[i & 1023], buffer, 16); break;
+            case 3: ultoa(integers[i & 1023], buffer, 16); break;
+            case 4: OldPrintFloat(doubles[i & 1023], 2, buffer); break;
+            case 5: OldPrintFloat(doubles[i & 1023], 6, buffer); break;
+            case 6:
+                numfmt_fixed(doubles[i & 1023], 2, buffer + sizeof(buffer), &zeroes);
+                break;
+            case 7:
+                numfmt_fixed(doubles[i & 1023], 6, buffer + sizeof(buffer), &zeroes);
+                break;
+            case 8:
+                snprintf(buffer, sizeof(buffer), "%.9g", floats[i & 1023]);
+                break;
+            case 9: numfmt_shortest(floats[i & 1023], buffer); break;
+        }
+        CoreBench_Consume(buffer, 1);
+    }
+    CoreBench_End(label, ITERATIONS);
+}
+
+//------------------------------------------------------------------------------
+//         Main function
+//------------------------------------------------------------------------------
+
+int main(void)
+{
+    CheckIntegers();
+    CheckFloats();
+    CheckShortest();
+    printf("numfmt, %u errors\n", errors);
+
+    Time("decimal, old ultoa", 0);
+    Time("decimal, ultoa", 1);
+    Time("hex, old ultoa", 2);
+    Time("hex, ultoa", 3);
+    Time("2 decimals, old printFloat", 4);
+    Time("6 decimals, old printFloat", 5);
+    Time("2 decimals, numfmt_fixed", 6);
+    Time("6 decimals, numfmt_fixed", 7);
+    Time("float, %.9g", 8);
+    Time("float, numfmt_shortest", 9);
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,159 @@
+//------------------------------------------------------------------------------
+// Print benchmark: a telemetry record printed to a serial device.
+//
+// The record mixes literals, integers, a float, a String and a
+// concatenation. It is printed field by field, then as one concatenation, to
+// two devices: one that only implements write(uint8_t), as a device without
+// a bulk path does, and one that also takes whole spans, as RTOSSerial and
+// USBSerial do. Each test reports the time per record and the calls made to
+// each write() method, which on the target each cost a virtual call and a
+// queue operation or a lock. The output is checked before timing.
+//
+//   ./printbench
+//------------------------------------------------------------------------------
+
+#include "corebench.h"
+
+#include <Print.h>
+#include <WString.h>
+
+#include <stdio.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Records printed by each test.
+#define ITERATIONS      200000
+
+/// Device copying its output to a buffer, with or without a bulk path.
+class Device : public Print
+{
+public:
+    Device(bool bulk) : bulk(bulk), length(0), byteCalls(0), spanCalls(0) {}
+    virtual size_t write(uint8_t c)
+    {
+        byteCalls++;
+        if (length < sizeof(buffer)) {
+
+            buffer[length++] = c;
+        }
+        return 1;
+    }
+    virtual size_t write(const uint8_t *pData, size_t size)
+    {
+        if (!bulk) {
+
+            return Print::write(pData, size);
+        }
+        spanCalls++;
+        if (size > sizeof(buffer) - length) {
+
+            size = sizeof(buffer) - length;
+        }
+        memcpy(buffer + length, pData, size);
+        length += size;
+        return size;
+    }
+    bool bulk;
+    char buffer[256];
+    unsigned int length;
+    unsigned long long byteCalls;
+    unsigned long long spanCalls;
+};
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+static String status("OK");
+static unsigned int errors;
+
+//------------------------------------------------------------------------------
+//         Local functions
+//------------------------------------------------------------------------------
+
+static void Fields(Device &device, unsigned long time, long value, double level)
+{
+    device.print("t=");
+    device.print(time);
+    device.print(",v=");
+    device.print(value);
+    device.print(",x=");
+    device.print(value, HEX);
+    device.print(",l=");
+    device.print(level, 3);
+    device.print(",s=");
+    device.println(status);
+}
+
+static void Sum(Device &device, unsigned long time, long value)
+{
+    device.println(String("t=") + time + ",v=" + value + ",s=" + status);
+}
+
+static void Check(Device &device, const char *expected)
+{
+    device.buffer[device.length] = 0;
+    if (strcmp(device.buffer, expected) != 0) {
+
+        printf("got \"%s\", expected \"%s\"\n", device.buffer, expected);
+        errors++;
+    }
+    device.length = 0;
+}
+
+static void Run(const char *label, bool bulk, bool sum)
+{
+    Device device(bulk);
+    unsigned int i;
+
+    CoreBench_Begin();
+    for (i = 0; i < ITERATIONS; i++) {
+
+        device.length = 0;
+        if (sum) {
+
+            Sum(device, 1000000UL + i, -12345L);
+        }
+        else {
+
+            Fields(device, 1000000UL + i, -12345L, 3.14159);
+        }
+    }
+    CoreBench_End(label, ITERATIONS);
+    printf("%-28s %9.1f byte writes, %.1f span writes\n",
+           "", (double) device.byteCalls / ITERATIONS,
+           (double) device.spanCalls / ITERATIONS);
+}
+
+//------------------------------------------------------------------------------
+//         Main function
+//------------------------------------------------------------------------------
+
+int main(void)
+{
+    Device device(true);
+
+    Fields(device, 4000000000UL, 2147483647L, -0.0005);
+    Check(device, "t=4000000000,v=2147483647,x=7FFFFFFF,l=-0.001,s=OK\r\n");
+    device.print(-2147483647L - 1);
+    Check(device, "-2147483648");
+    Fields(device, 0, 255, 1.9999);
+    Check(device, "t=0,v=255,x=FF,l=2.000,s=OK\r\n");
+    Sum(device, 42, -7);
+    Check(device, "t=42,v=-7,s=OK\r\n");
+    device.print(12.5, 0);
+    device.print(' ');
+    device.print(1e9, 12);
+    Check(device, "13 1000000000.000000000000");
+    printf("Print, %u errors\n", errors);
+
+    Run("fields, byte device", false, false);
+    Run("fields, span device", true, false);
+    Run("concatenation, byte device", false, true);
+    Run("concatenation, span device", true, true);
+
+    return errors ? 1 : 0;
+}
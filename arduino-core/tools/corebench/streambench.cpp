@@ -0,0 +1,255 @@
+//------------------------------------------------------------------------------
+// Stream benchmark: the CPU a parser burns waiting for input.
+//
+// A task parses integers from a port with Stream::parseInt(), once from a
+// quiet port, until the timeout, and once from a port that another thread
+// writes a number to after a delay. The port either keeps the default
+// Stream::waitAvailable(), so that the timed reads poll, or overrides it with
+// a wait on a condition variable, as RTOSSerial waits on its receive queue and
+// USBSerial on its receive semaphore. Each test reports the CPU time of the
+// parser as a share of the time it waited, the read() calls it made, and for
+// the second test, how long after the data was written it was parsed.
+//
+// Before the time base existed, millis() was 0 and the timed reads never timed
+// out: a quiet port kept the parser polling at 100% CPU forever.
+//
+//   ./streambench
+//------------------------------------------------------------------------------
+
+#include "corebench.h"
+
+#include <Stream.h>
+#include <wiring.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Stream timeout, in ms.
+#define TIMEOUT         200
+
+/// Delay before the writer sends its number, in ms.
+#define DELAY           50
+
+/// Parses per test.
+#define ITERATIONS      10
+
+/// Port receiving what the writer thread sends.
+class Device : public Stream
+{
+public:
+    Device(bool blocking) : blocking(blocking), head(0), tail(0), reads(0)
+    {
+        pthread_condattr_t attr;
+
+        pthread_mutex_init(&mutex, 0);
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&cond, &attr);
+        pthread_condattr_destroy(&attr);
+    }
+    virtual int available(void)
+    {
+        int count;
+
+        pthread_mutex_lock(&mutex);
+        count = tail - head;
+        pthread_mutex_unlock(&mutex);
+        return count;
+    }
+    virtual int read(void) { return Take(true); }
+    virtual int peek(void) { return Take(false); }
+    virtual void flush(void) {}
+    virtual size_t write(uint8_t c) { return 0; }
+    using Print::write;
+    virtual bool waitAvailable(unsigned long timeout)
+    {
+        struct timespec until;
+        bool ready;
+
+        if (!blocking) {
+
+            return Stream::waitAvailable(timeout);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &until);
+        until.tv_sec += timeout / 1000;
+        until.tv_nsec += (timeout % 1000) * 1000000;
+        if (until.tv_nsec >= 1000000000) {
+
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000;
+        }
+        pthread_mutex_lock(&mutex);
+        while (head == tail
+               && pthread_cond_timedwait(&cond, &mutex, &until) == 0);
+        ready = head != tail;
+        pthread_mutex_unlock(&mutex);
+        return ready;
+    }
+
+    /// Called by the writer thread.
+    void Send(const char *s)
+    {
+        pthread_mutex_lock(&mutex);
+        while (*s && tail < sizeof(data)) {
+
+            data[tail++] = *s++;
+        }
+        sent = CoreBench_GetTime();
+        pthread_cond_signal(&cond);
+        pthread_mutex_unlock(&mutex);
+    }
+
+    void Reset(void)
+    {
+        head = tail = 0;
+        reads = 0;
+    }
+
+    bool blocking;
+    unsigned char data[64];
+    unsigned int head;
+    unsigned int tail;
+    unsigned long long reads;
+    unsigned long long sent;
+
+private:
+    int Take(bool remove)
+    {
+        int c = -1;
+
+        pthread_mutex_lock(&mutex);
+        reads++;
+        if (head != tail) {
+
+            c = data[head];
+            if (remove) {
+
+                head++;
+            }
+        }
+        pthread_mutex_unlock(&mutex);
+        return c;
+    }
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+};
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+static unsigned int errors;
+
+//------------------------------------------------------------------------------
+//         Local functions
+//------------------------------------------------------------------------------
+
+/// CPU time of the calling thread in ns.
+static unsigned long long CpuTime(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static void *Writer(void *pArg)
+{
+    Device *device = (Device *) pArg;
+
+    usleep(DELAY * 1000);
+    device->Send("12345\n");
+    return 0;
+}
+
+static void Run(const char *label, bool blocking, bool quiet)
+{
+    Device device(blocking);
+    unsigned long long wall = 0;
+    unsigned long long cpu = 0;
+    unsigned long long reads = 0;
+    unsigned long long latency = 0;
+    unsigned long long worst = 0;
+    unsigned int i;
+
+    device.setTimeout(TIMEOUT);
+    for (i = 0; i < ITERATIONS; i++) {
+
+        pthread_t writer;
+        unsigned long long startCpu;
+        unsigned long long start;
+        unsigned long long end;
+        unsigned long startMillis;
+        unsigned long elapsed;
+        long value;
+
+        device.Reset();
+        if (!quiet) {
+
+            pthread_create(&writer, 0, Writer, &device);
+        }
+        startMillis = millis();
+        start = CoreBench_GetTime();
+        startCpu = CpuTime();
+        value = device.parseInt();
+        cpu += CpuTime() - startCpu;
+        end = CoreBench_GetTime();
+        elapsed = millis() - startMillis;
+        wall += end - start;
+        reads += device.reads;
+        if (quiet) {
+
+            // no data: the parse gives 0 once the timeout has passed
+            if (value != 0 || elapsed < TIMEOUT || elapsed > TIMEOUT + 50) {
+
+                printf("%s: got %ld after %lu ms\n", label, value, elapsed);
+                errors++;
+            }
+        } else {
+
+            pthread_join(writer, 0);
+            if (value != 12345) {
+
+                printf("%s: got %ld\n", label, value);
+                errors++;
+            }
+            // the parse ends on the '\n', which comes with the digits
+            latency += end - device.sent;
+            if (end - device.sent > worst) {
+
+                worst = end - device.sent;
+            }
+        }
+    }
+    printf("%-28s %6.1f%% CPU %12.1f reads", label,
+           100.0 * cpu / wall, (double) reads / ITERATIONS);
+    if (!quiet) {
+
+        printf(" | parsed %6.1f us after the data, worst %6.1f us",
+               latency / 1000.0 / ITERATIONS, worst / 1000.0);
+    }
+    printf("\n");
+}
+
+//------------------------------------------------------------------------------
+//         Main function
+//------------------------------------------------------------------------------
+
+int main(void)
+{
+    Run("quiet, polling", false, true);
+    Run("quiet, waitAvailable", true, true);
+    Run("data at 50 ms, polling", false, false);
+    Run("data at 50 ms, waitAvailable", true, false);
+    printf("Stream timed reads, %u errors\n", errors);
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,291 @@
+//------------------------------------------------------------------------------
+// String benchmark: the formatting done by a telemetry loop.
+//
+// Each test builds the strings a sketch typically builds when it reports its
+// sensors over a serial port: short tokens and numbers, a line of
+// "name=value" fields appended one by one (with and without reserve()), a
+// line read one character at a time, a log of such lines accumulated in one
+// String, and the fields of a CSV line taken apart with indexOf() and
+// substring(). The results are checked against snprintf() before timing.
+//
+//   ./stringbench
+//------------------------------------------------------------------------------
+
+#include "corebench.h"
+
+#include <WString.h>
+
+#include <stdio.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Iterations of each test.
+#define ITERATIONS      200000
+
+/// Lines accumulated by the log test, and characters by the read test.
+#define LOGLINES        100
+#define LINECHARS       1024
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+static unsigned int errors;
+
+//------------------------------------------------------------------------------
+//         Local functions
+//------------------------------------------------------------------------------
+
+static void Check(const char *test, const String &result, const char *expected)
+{
+    char buffer[8192];
+
+    result.toCharArray(buffer, sizeof(buffer));
+    if ((result.length() != strlen(expected))
+        || (strcmp(buffer, expected) != 0)) {
+
+        printf("%s: got \"%.60s\" (%u), expected \"%.60s\"\n",
+               test, buffer, result.length(), expected);
+        errors++;
+    }
+}
+
+/// A telemetry line, as a sketch would format it.
+static void FormatLine(String &line, unsigned long time, int x, int y, int z,
+                       unsigned int battery)
+{
+    line += "t=";
+    line += time;
+    line += ",ax=";
+    line += x;
+    line += ",ay=";
+    line += y;
+    line += ",az=";
+    line += z;
+    line += ",bat=";
+    line += battery;
+    line += ",ok";
+    line += '\n';
+}
+
+static void ExpectedLine(char *buffer, unsigned int size, unsigned long time,
+                         int x, int y, int z, unsigned int battery)
+{
+    snprintf(buffer, size, "t=%lu,ax=%d,ay=%d,az=%d,bat=%u,ok\n",
+             time, x, y, z, battery);
+}
+
+//------------------------------------------------------------------------------
+//         Tests
+//------------------------------------------------------------------------------
+
+static void Tokens(unsigned int iterations)
+{
+    unsigned int i;
+
+    for (i = 0; i < iterations; i++) {
+
+        String number((int) i);
+        String letter((char) ('a' + (i & 15)));
+        String word("ok");
+        String copy = number;
+        String empty;
+
+        CoreBench_Consume(&i, number.length() + letter.length()
+                              + word.length() + copy.length()
+                              + empty.length() > 0);
+    }
+}
+
+static void Line(unsigned int iterations, unsigned char reserved)
+{
+    unsigned int i;
+
+    for (i = 0; i < iterations; i++) {
+
+        String line;
+
+        if (reserved) {
+
+            line.reserve(64);
+        }
+        FormatLine(line, 1000000UL + i, (int) i - 500, 12, -981, 3700);
+        CoreBench_Consume(&i, line.length() > 0);
+    }
+}
+
+static void Read(unsigned int iterations)
+{
+    unsigned int i, j;
+
+    for (i = 0; i < iterations; i++) {
+
+        String line;
+
+        for (j = 0; j < LINECHARS; j++) {
+
+            line += (char) ('0' + (j % 10));
+        }
+        CoreBench_Consume(&i, line.length() > 0);
+    }
+}
+
+static void Log(unsigned int iterations, unsigned char shrink)
+{
+    unsigned int i, j;
+
+    for (i = 0; i < iterations; i++) {
+
+        String log;
+
+        for (j = 0; j < LOGLINES; j++) {
+
+            FormatLine(log, 1000000UL + j, (int) j - 50, 12, -981, 3700);
+        }
+        if (shrink) {
+
+            log.shrink_to_fit();
+        }
+        CoreBench_Consume(&i, log.length() > 0);
+    }
+}
+
+static void Parse(unsigned int iterations)
+{
+    String csv("1000123,-500,12,-981,3700");
+    unsigned int i;
+    long sum = 0;
+
+    for (i = 0; i < iterations; i++) {
+
+        int start = 0;
+        int comma;
+
+        while ((comma = csv.indexOf(',', start)) >= 0) {
+
+            sum += csv.substring(start, comma).toInt();
+            start = comma + 1;
+        }
+        String last = csv.substring(start);
+        last.trim();
+        sum += last.toInt();
+    }
+    CoreBench_Consume(&sum, sizeof(sum));
+}
+
+//------------------------------------------------------------------------------
+//         Checks
+//------------------------------------------------------------------------------
+
+static void CheckAll(void)
+{
+    char expected[8192];
+    unsigned int length = 0;
+    unsigned int j;
+
+    // Tokens and numbers
+    Check("int", String(-1234), "-1234");
+    Check("char", String('x'), "x");
+    Check("empty", String(), "");
+    Check("long", String(-2147483647L), "-2147483647");
+    Check("hex", String(255, 16), "ff");
+
+    // Lines, log and shrinking
+    String line;
+    FormatLine(line, 4000000000UL, -32768, 0, 32767, 4200);
+    ExpectedLine(expected, sizeof(expected), 4000000000UL, -32768, 0, 32767,
+                 4200);
+    Check("line", line, expected);
+
+    String log;
+    for (j = 0; j < LOGLINES; j++) {
+
+        FormatLine(log, 1000000UL + j, (int) j - 50, 12, -981, 3700);
+        ExpectedLine(expected + length, sizeof(expected) - length,
+                     1000000UL + j, (int) j - 50, 12, -981, 3700);
+        length += strlen(expected + length);
+    }
+    Check("log", log, expected);
+    log.shrink_to_fit();
+    Check("shrunk log", log, expected);
+
+    // Copies and moves between inline and heap strings
+    String small("abc");
+    String big(log);
+    String copy(small);
+    copy = big;
+    Check("inline = heap", copy, expected);
+    copy = small;
+    Check("heap = inline", copy, "abc");
+    String moved(static_cast<String &&>(big));
+    Check("moved heap", moved, expected);
+    moved = static_cast<String &&>(small);
+    Check("moved inline", moved, "abc");
+
+    // Self append across the inline limit, and back down
+    String twice("0123456789");
+    twice += twice;
+    Check("self append", twice, "01234567890123456789");
+    twice += twice;
+    Check("self append heap",
+          twice, "0123456789012345678901234567890123456789");
+    twice = twice.substring(5, 8);
+    Check("substring", twice, "567");
+    twice.shrink_to_fit();
+    Check("shrunk inline", twice, "567");
+
+    // Replacement growing out of the inline buffer
+    String csv("a,b,c,d,e");
+    csv.replace(",", " -> ");
+    Check("replace", csv, "a -> b -> c -> d -> e");
+    csv.replace(" -> ", ",");
+    Check("replace back", csv, "a,b,c,d,e");
+    csv.toUpperCase();
+    Check("upper", csv, "A,B,C,D,E");
+    String sum = String("x=") + 12 + ", y=" + String(-3) + '!';
+    Check("sum", sum, "x=12, y=-3!");
+}
+
+//------------------------------------------------------------------------------
+//         Main function
+//------------------------------------------------------------------------------
+
+int main(void)
+{
+    CheckAll();
+    printf("String, %u-byte objects, %u errors\n",
+           (unsigned int) sizeof(String), errors);
+
+    CoreBench_Begin();
+    Tokens(ITERATIONS);
+    CoreBench_End("short tokens (x5)", ITERATIONS);
+
+    CoreBench_Begin();
+    Line(ITERATIONS, 0);
+    CoreBench_End("telemetry line", ITERATIONS);
+
+    CoreBench_Begin();
+    Line(ITERATIONS, 1);
+    CoreBench_End("telemetry line, reserved", ITERATIONS);
+
+    CoreBench_Begin();
+    Read(ITERATIONS / 100);
+    CoreBench_End("1 KB read char by char", ITERATIONS / 100);
+
+    CoreBench_Begin();
+    Log(ITERATIONS / 100, 0);
+    CoreBench_End("log of 100 lines", ITERATIONS / 100);
+
+    CoreBench_Begin();
+    Log(ITERATIONS / 100, 1);
+    CoreBench_End("log of 100 lines, shrunk", ITERATIONS / 100);
+
+    CoreBench_Begin();
+    Parse(ITERATIONS);
+    CoreBench_End("CSV line parsed", ITERATIONS);
+
+    return errors ? 1 : 0;
+}
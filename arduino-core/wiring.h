@@ -0,0 +1,43 @@
+/*
+  Time base of the Arduino core.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+  See the GNU Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _WIRING_
+#define _WIRING_
+
+/*
+  The core only declares the time base; the platform defines it.  With
+  FreeRTOS it is wiring.c of the serial library, which reads the port's tick
+  count and SysTick counter.  Both clocks are monotonic and wrap around at
+  2^32, so intervals are measured by subtracting unsigned values.
+*/
+
+#ifdef __cplusplus
+extern "C"{
+#endif // __cplusplus
+
+/* Milliseconds since the scheduler started, to a tick. */
+extern unsigned long millis( void ) ;
+
+/* Microseconds since the scheduler started. */
+extern unsigned long micros( void ) ;
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // _WIRING_
@@ -258,13 +258,15 @@ void MEDDdram_Initialize(Media *media,
     media->unlock = 0;
     media->handler = 0;
     media->flush = 0;
+    media->discard = 0;
 
     media->blockSize = blockSize;
     media->baseAddress = baseAddress;
     media->size = size;
 
-    media->mappedRD  = 0;
-    media->mappedWR  = 0;
+    // USB transfers are done directly from and to the DDRAM
+    media->mappedRD  = 1;
+    media->mappedWR  = 1;
     media->protected = 0;
     media->removable = 0;
     media->state = MED_STATE_READY;
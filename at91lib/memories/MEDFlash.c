@@ -212,6 +212,7 @@ void FLA_Initialize(Media *media, AT91S_EFC *efc)
     media->lock = FLASHD_Lock;
     media->unlock = FLASHD_Unlock;
     media->flush = 0;
+    media->discard = 0;
     media->handler = 0;
 
     media->blockSize = 1;
@@ -219,7 +220,9 @@ void FLA_Initialize(Media *media, AT91S_EFC *efc)
     media->size = AT91C_IFLASH_SIZE;
     media->interface = efc;
 
-    media->mappedRD  = 0;
+    // The flash is in the memory space and is sent directly by the USB DMA;
+    // writes must go through the EEFC
+    media->mappedRD  = 1;
     media->mappedWR  = 0;
     media->protected = 0;
     media->removable = 0;
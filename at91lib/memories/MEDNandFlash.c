@@ -437,6 +437,98 @@ static unsigned char MEDNandFlash_Flush(Media *media)
     return MED_STATUS_SUCCESS;
 }
 
+//------------------------------------------------------------------------------
+/// Discards the data at the specified address of a NandFlash media, so that
+/// the translation layer does not copy it anymore when the blocks around it
+/// are rewritten. Whole blocks are unmapped; single pages are only discarded
+/// in the block being written. Partially covered pages are kept.
+/// Returns MED_STATUS_SUCCESS if successful; otherwise MED_STATUS_ERROR.
+/// \param media  Pointer to the NandFlash Media instance.
+/// \param address  Address of the first byte to discard.
+/// \param length  Number of bytes to discard.
+//------------------------------------------------------------------------------
+static unsigned char MEDNandFlash_Discard(
+    Media *media,
+    unsigned int address,
+    unsigned int length)
+{
+    unsigned short pageDataSize =
+                NandFlashModel_GetPageDataSize(MODEL(media->interface));
+    unsigned short blockSizeInPages =
+                NandFlashModel_GetBlockSizeInPages(MODEL(media->interface));
+    unsigned int first, last, page;
+    unsigned short block;
+
+    TRACE_INFO("MEDNandFlash_Discard(0x%08X, %d)\n\r", address, length);
+
+    // Check the range
+    if (NandFlashModel_TranslateAccess(MODEL(media->interface),
+                                       address,
+                                       length,
+                                       0,
+                                       0,
+                                       0)) {
+
+        TRACE_ERROR("MEDNandFlash_Discard: Cannot perform access\n\r");
+        return MED_STATUS_ERROR;
+    }
+
+    // Pages entirely inside the range, [first, last[
+    first = (address + pageDataSize - 1) / pageDataSize;
+    last = (address + length) / pageDataSize;
+    if (first >= last) {
+
+        return MED_STATUS_SUCCESS;
+    }
+
+    // Forget the buffered pages in the range
+    if (currentWritePage != -1) {
+
+        page = currentWriteBlock * blockSizeInPages + currentWritePage;
+        if ((page >= first) && (page < last)) {
+
+            currentWriteBlock = -1;
+            currentWritePage = -1;
+        }
+    }
+    if (currentReadPage != -1) {
+
+        page = currentReadBlock * blockSizeInPages + currentReadPage;
+        if ((page >= first) && (page < last)) {
+
+            currentReadBlock = -1;
+            currentReadPage = -1;
+        }
+    }
+
+    // Discard whole blocks at once, single pages otherwise
+    page = first;
+    while (page < last) {
+
+        block = page / blockSizeInPages;
+        if (((page % blockSizeInPages) == 0)
+            && (last - page >= blockSizeInPages)) {
+
+            if (TranslatedNandFlash_DiscardBlock(TRANSLATED(media->interface),
+                                                 block)) {
+
+                TRACE_ERROR("MEDNandFlash_Discard: Could not discard block\n\r");
+                return MED_STATUS_ERROR;
+            }
+            page += blockSizeInPages;
+        }
+        else {
+
+            TranslatedNandFlash_DiscardPage(TRANSLATED(media->interface),
+                                            block,
+                                            page % blockSizeInPages);
+            page++;
+        }
+    }
+
+    return MED_STATUS_SUCCESS;
+}
+
 //------------------------------------------------------------------------------
 /// Interrupt handler for the nandflash media. Triggered when the flush timer
 /// expires, initiating a MEDNandFlash_Flush().
@@ -472,6 +564,7 @@ void MEDNandFlash_Initialize(Media *media,
     media->lock = 0;
     media->unlock = 0;
     media->flush = MEDNandFlash_Flush;
+    media->discard = MEDNandFlash_Discard;
     media->handler = MEDNandFlash_InterruptHandler;
 
     media->interface = translated;
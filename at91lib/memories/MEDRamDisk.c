@@ -263,13 +263,16 @@ unsigned char MEDRamDisk_Initialize(Media *media,
     media->unlock = 0;
     media->handler = 0;
     media->flush = 0;
+    media->discard = 0;
 
     media->blockSize = blockSize;
     media->baseAddress = baseAddress;
     media->size = size;
 
-    media->mappedRD  = 0;
-    media->mappedWR  = 0;
+    // The disk is plain memory: USB transfers are done directly from and to
+    // it, without copying through the MSD FIFO
+    media->mappedRD  = 1;
+    media->mappedWR  = 1;
     media->protected = 0;
     media->removable = 0;
     media->state = MED_STATE_READY;
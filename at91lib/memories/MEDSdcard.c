@@ -500,6 +500,7 @@ unsigned char MEDSdcard_Initialize(Media *media, unsigned char mciID)
     media->unlock = 0;
     media->handler = 0;
     media->flush = 0;
+    media->discard = 0;
 
     media->blockSize = SD_BLOCK_SIZE;
     media->baseAddress = 0;
@@ -581,6 +582,7 @@ unsigned char MEDSdusb_Initialize(Media *media, unsigned char mciID)
     media->unlock = 0;
     media->handler = 0;
     media->flush = 0;
+    media->discard = 0;
 
     media->blockSize = SD_BLOCK_SIZE;
     media->baseAddress = 0;
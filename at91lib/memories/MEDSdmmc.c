@@ -340,6 +340,7 @@ void MEDSdcard_Initialize(Media *media, SdCard * sdDrv, unsigned char protected)
     media->unlock = 0;
     media->handler = 0;
     media->flush = 0;
+    media->discard = 0;
 
     media->blockSize = SD_BLOCK_SIZE;
     media->baseAddress = 0;
@@ -383,6 +384,7 @@ void MEDSdusb_Initialize(Media *media, SdCard * sdDrv, unsigned char protected)
     media->unlock = 0;
     media->handler = 0;
     media->flush = 0;
+    media->discard = 0;
 
     media->blockSize = SD_BLOCK_SIZE;
     media->baseAddress = 0;
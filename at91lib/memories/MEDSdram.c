@@ -251,6 +251,7 @@ void MEDSdram_Initialize(Media *media,
     media->unlock = 0;
     media->handler = 0;
     media->flush = 0;
+    media->discard = 0;
 
     media->blockSize = blockSize;
     media->baseAddress = baseAddress;
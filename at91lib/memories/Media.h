@@ -106,6 +106,10 @@ typedef unsigned char (*Media_ioctl)(Media *media,
 
 typedef unsigned char (*Media_flush)(Media *media);
 
+typedef unsigned char (*Media_discard)(Media *media,
+                                       unsigned int address,
+                                       unsigned int length);
+
 typedef void (*Media_handler)(Media *media);
 
 //! \brief  Media transfer
@@ -130,6 +134,7 @@ struct _Media {
   Media_lock     lock;        //!< lock method if possible
   Media_unlock   unlock;      //!< unlock method if possible
   Media_flush    flush;       //!< Flush method
+  Media_discard  discard;     //!< Discard method if possible
   Media_handler  handler;     //!< Interrupt handler
   unsigned int   blockSize;   //!< Block size in bytes (1, 512, 1K, 2K ...)
   unsigned int   baseAddress; //!< Base address of media in number of blocks
@@ -262,6 +267,30 @@ static inline unsigned char MED_Flush(Media *media)
     }
 }
 
+//------------------------------------------------------------------------------
+//! \brief  Tells the media that the data in the given address range is no
+//!         longer used, so that it does not have to be preserved. Reading the
+//!         range afterwards returns unspecified data. Media that cannot make
+//!         use of this information ignore it.
+//! \param  media    Pointer to the Media instance to use
+//! \param  address  Address of the first unused block
+//! \param  length   Number of unused blocks
+//! \return Operation result code
+//------------------------------------------------------------------------------
+static inline unsigned char MED_Discard(Media        *media,
+                                       unsigned int address,
+                                       unsigned int length)
+{
+    if (media->discard) {
+
+        return media->discard(media, address, length);
+    }
+    else {
+
+        return MED_STATUS_SUCCESS;
+    }
+}
+
 //------------------------------------------------------------------------------
 //! \brief  Invokes the interrupt handler of the specified media
 //! \param  media Pointer to the Media instance to use
@@ -116,13 +116,46 @@ static void MarkPageDirty(
 }
 
 //------------------------------------------------------------------------------
-/// Marks all pages as being clean.
+/// Returns 1 if the data of the given page inside the currently written block
+/// has been discarded; otherwise returns 0.
+/// \param translated  Pointer to a TranslatedNandFlash instance.
+/// \param page  Page number.
+//------------------------------------------------------------------------------
+static unsigned char PageIsDiscarded(
+    const struct TranslatedNandFlash *translated,
+    unsigned short page)
+{
+    ASSERT(page < NandFlashModel_GetBlockSizeInPages(MODEL(translated)),
+           "PageIsDiscarded: Page out-of-bounds\n\r");
+
+    return (translated->currentBlockDiscardedPages[page / 8] >> (page % 8)) & 1;
+}
+
+//------------------------------------------------------------------------------
+/// Marks the given page as being discarded (i.e. not to be copied back).
+/// \param translated  Pointer to a TranslatedNandFlash instance.
+/// \param page  Page number.
+//------------------------------------------------------------------------------
+static void MarkPageDiscarded(
+    struct TranslatedNandFlash *translated,
+    unsigned short page)
+{
+    ASSERT(page < NandFlashModel_GetBlockSizeInPages(MODEL(translated)),
+           "MarkPageDiscarded: Page out-of-bounds\n\r");
+
+    translated->currentBlockDiscardedPages[page / 8] |= 1 << (page % 8);
+}
+
+//------------------------------------------------------------------------------
+/// Marks all pages as being clean, and none as being discarded.
 /// \param translated  Pointer to a TranslatedNandFlash instance.
 //------------------------------------------------------------------------------
 static void MarkAllPagesClean(struct TranslatedNandFlash *translated)
 {
     memset(translated->currentBlockPageStatuses, 0,
            sizeof(translated->currentBlockPageStatuses));
+    memset(translated->currentBlockDiscardedPages, 0,
+           sizeof(translated->currentBlockDiscardedPages));
 }
 
 //------------------------------------------------------------------------------
@@ -137,6 +170,7 @@ static unsigned char AllocateBlock(
     unsigned short block)
 {
     unsigned short freeBlock, liveBlock;
+    signed short logicalBlock;
     unsigned char error;
     signed int eraseDifference;
 
@@ -188,20 +222,34 @@ static unsigned char AllocateBlock(
         TRACE_DEBUG("Live block erase count = %d\n\r", MANAGED(translated)->blockStatuses[liveBlock].eraseCount);
         eraseDifference = absv(MANAGED(translated)->blockStatuses[freeBlock].eraseCount
                               - MANAGED(translated)->blockStatuses[liveBlock].eraseCount);
+        logicalBlock = MappedNandFlash_PhysicalToLogical(MAPPED(translated),
+                                                         liveBlock);
 
-        // Check if it is too big
-        if (eraseDifference > MAXERASEDIFFERENCE) {
+        // Check if it is too big. The block holding the logical mapping is
+        // not mapped, and the previous block of the one being written is
+        // released anyway (moving it would have it erased before the pages
+        // are copied back from it).
+        if ((eraseDifference > MAXERASEDIFFERENCE)
+            && (logicalBlock != -1)
+            && (liveBlock != translated->previousPhysicalBlock)) {
 
             TRACE_WARNING("Erase difference too big, switching blocks\n\r");
-            MappedNandFlash_Map(
-                MAPPED(translated),
-                MappedNandFlash_PhysicalToLogical(
-                    MAPPED(translated),
-                    liveBlock),
-                freeBlock);
-            ManagedNandFlash_CopyBlock(MANAGED(translated),
-                                       liveBlock,
-                                       freeBlock);
+            error = MappedNandFlash_Map(MAPPED(translated),
+                                        logicalBlock,
+                                        freeBlock);
+            if (error) {
+
+                TRACE_ERROR("AllocateBlock: Could not map block\n\r");
+                return error;
+            }
+            error = ManagedNandFlash_CopyBlock(MANAGED(translated),
+                                               liveBlock,
+                                               freeBlock);
+            if (error) {
+
+                TRACE_ERROR("AllocateBlock: Could not copy block\n\r");
+                return error;
+            }
 
             // Allocate a new block
             return AllocateBlock(translated, block);
@@ -289,6 +337,20 @@ unsigned char TranslatedNandFlash_ReadPage(
         && (translated->previousPhysicalBlock != -1)
         && (PageIsClean(translated, page))) {
 
+        // Discarded page: its old data is not there anymore
+        if (PageIsDiscarded(translated, page)) {
+
+            if (data) {
+
+                memset(data, 0xFF, NandFlashModel_GetPageDataSize(MODEL(translated)));
+            }
+            if (spare) {
+
+                memset(spare, 0xFF, NandFlashModel_GetPageSpareSize(MODEL(translated)));
+            }
+            return 0;
+        }
+
         TRACE_DEBUG("Reading page from current block\n\r");
         return ManagedNandFlash_ReadPage(MANAGED(translated),
                                          translated->previousPhysicalBlock,
@@ -431,7 +493,7 @@ unsigned char TranslatedNandFlash_WritePage(
 
 //------------------------------------------------------------------------------
 /// Terminates the current write operation by copying all the missing pages from
-/// the previous physical block.
+/// the previous physical block, except the ones which have been discarded.
 /// \param translated  Pointer to a TranslatedNandFlash instance.
 //------------------------------------------------------------------------------
 unsigned char TranslatedNandFlash_Flush(struct TranslatedNandFlash *translated)
@@ -457,7 +519,7 @@ unsigned char TranslatedNandFlash_Flush(struct TranslatedNandFlash *translated)
 
     for (i=0; i < NandFlashModel_GetBlockSizeInPages(MODEL(translated)); i++) {
 
-        if (PageIsClean(translated, i)) {
+        if (PageIsClean(translated, i) && !PageIsDiscarded(translated, i)) {
 
             TRACE_DEBUG("Copying back page #%d of block #%d\n\r", i,
                       translated->previousPhysicalBlock);
@@ -481,6 +543,64 @@ unsigned char TranslatedNandFlash_Flush(struct TranslatedNandFlash *translated)
     return 0;
 }
 
+//------------------------------------------------------------------------------
+/// Discards the data of a page, which does not need to be preserved anymore.
+/// Only the pages of the block currently being written can be discarded one
+/// by one: their old data is then not copied from the previous physical block
+/// when the write terminates. The data of other pages is kept.
+/// Returns 0 if successful; otherwise returns a NandCommon_ERROR code.
+/// \param translated  Pointer to a TranslatedNandFlash instance.
+/// \param block  Logical block number.
+/// \param page  Number of the page to discard inside the logical block.
+//------------------------------------------------------------------------------
+unsigned char TranslatedNandFlash_DiscardPage(
+    struct TranslatedNandFlash *translated,
+    unsigned short block,
+    unsigned short page)
+{
+    TRACE_INFO("TranslatedNandFlash_DiscardPage(B#%d:P#%d)\n\r", block, page);
+
+    if ((block == translated->currentLogicalBlock)
+        && (translated->previousPhysicalBlock != -1)
+        && PageIsClean(translated, page)) {
+
+        MarkPageDiscarded(translated, page);
+    }
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+/// Discards the data of a whole logical block. The block is unmapped, its
+/// physical block becomes dirty and is erased by the next clean-up instead of
+/// being copied, and reading it returns erased data until it is written again.
+/// Returns 0 if successful; otherwise returns a NandCommon_ERROR code.
+/// \param translated  Pointer to a TranslatedNandFlash instance.
+/// \param block  Logical block number.
+//------------------------------------------------------------------------------
+unsigned char TranslatedNandFlash_DiscardBlock(
+    struct TranslatedNandFlash *translated,
+    unsigned short block)
+{
+    TRACE_INFO("TranslatedNandFlash_DiscardBlock(B#%d)\n\r", block);
+
+    // The previous physical block of the current one is already dirty, none of
+    // its pages have to be copied anymore
+    if (block == translated->currentLogicalBlock) {
+
+        translated->currentLogicalBlock = -1;
+        translated->previousPhysicalBlock = -1;
+        MarkAllPagesClean(translated);
+    }
+
+    if (MappedNandFlash_LogicalToPhysical(MAPPED(translated), block) == -1) {
+
+        return 0;
+    }
+
+    return MappedNandFlash_Unmap(MAPPED(translated), block);
+}
+
 //------------------------------------------------------------------------------
 /// Erase all blocks in the tranalated area of nand flash.
 /// \param managed  Pointer to a TranslatedNandFlash instance.
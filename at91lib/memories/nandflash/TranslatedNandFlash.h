@@ -54,6 +54,9 @@ struct TranslatedNandFlash {
     signed short currentLogicalBlock;
     signed short previousPhysicalBlock;
     unsigned char currentBlockPageStatuses[NandCommon_MAXNUMPAGESPERBLOCK / 8];
+    /// Clean pages of the current block whose data has been discarded, and
+    /// which must not be copied from the previous physical block.
+    unsigned char currentBlockDiscardedPages[NandCommon_MAXNUMPAGESPERBLOCK / 8];
 };
 
 //------------------------------------------------------------------------------
@@ -88,6 +91,15 @@ extern unsigned char TranslatedNandFlash_WritePage(
 extern unsigned char TranslatedNandFlash_Flush(
     struct TranslatedNandFlash *translated);
 
+extern unsigned char TranslatedNandFlash_DiscardPage(
+    struct TranslatedNandFlash *translated,
+    unsigned short block,
+    unsigned short page);
+
+extern unsigned char TranslatedNandFlash_DiscardBlock(
+    struct TranslatedNandFlash *translated,
+    unsigned short block);
+
 extern unsigned char TranslatedNandFlash_EraseAll(
     struct TranslatedNandFlash *translated,
     unsigned char level);
@@ -82,6 +82,44 @@
 /// Used to read from MCI registers.
 #define READ_MCI(pMci, regName)             (pMci->regName)
 
+//------------------------------------------------------------------------------
+//         Local functions
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Completes the current command of a MCI driver instance: releases the
+/// driver and invokes the callback of the command.
+/// \param pMci  Pointer to a MCI driver instance.
+//------------------------------------------------------------------------------
+static void MCI_Complete(Mci *pMci)
+{
+    MciCmd *pCommand = pMci->pCommand;
+
+    // If no error occured, the transfer is successful
+    if (pCommand->status == MCI_STATUS_PENDING) {
+        pCommand->status = 0;
+    }
+
+    // Release the semaphore
+    pMci->semaphore++;
+
+    // Invoke the callback associated with the current command (if any)
+    if (pCommand->callback) {
+        (pCommand->callback)(pCommand->status, (void*)pCommand);
+    }
+}
+
+#if (MCI_DEFERRED == 1)
+//------------------------------------------------------------------------------
+/// Bottom half of the MCI interrupt, completes a command with a callback.
+/// \param pArgument  Pointer to the MCI driver instance.
+//------------------------------------------------------------------------------
+static void MCI_BottomHalf(void *pArgument)
+{
+    MCI_Complete((Mci *) pArgument);
+}
+#endif
+
 //------------------------------------------------------------------------------
 //         Global functions
 //------------------------------------------------------------------------------
@@ -133,6 +171,10 @@ void MCI_Init(
     pMci->mciMode = mode;
     pMci->semaphore = 1;
     pMci->pCommand  = 0;
+#if (MCI_DEFERRED == 1)
+    DEFER_Initialize(&(pMci->bottomHalf), MCI_BottomHalf, pMci,
+                     MCI_DEFER_PRIORITY);
+#endif
 
     // Enable the MCI clock
     WRITE_PMC(AT91C_BASE_PMC, PMC_PCER, (1 << mciId));
@@ -526,10 +568,6 @@ void MCI_Handler(Mci *pMci)
         }
         #endif
 
-        // If no error occured, the transfer is successful
-        if (pCommand->status == MCI_STATUS_PENDING) {
-            pCommand->status = 0;
-        }
 #if 0
         if ((status & AT91C_MCI_CMDRDY) != 0)
             TRACE_DEBUG_WP(".");
@@ -587,13 +625,14 @@ void MCI_Handler(Mci *pMci)
         // Disable interrupts
         WRITE_MCI(pMciHw, MCI_IDR, READ_MCI(pMciHw, MCI_IMR));
 
-        // Release the semaphore
-        pMci->semaphore++;
-
-        // Invoke the callback associated with the current command (if any)
+#if (MCI_DEFERRED == 1)
+        // The command stays pending until the bottom half invokes its callback
         if (pCommand->callback) {
-            (pCommand->callback)(pCommand->status, pCommand);
+            DEFER_Schedule(&(pMci->bottomHalf));
+            return;
         }
+#endif
+        MCI_Complete(pMci);
     }
 }
 
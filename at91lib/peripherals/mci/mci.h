@@ -41,7 +41,9 @@
 /// -# Use MCI_SetSpeed() to set the MCI clock.
 /// -# Use MCI_SetBusWidth() to set the bus width between MCI controller and device.
 /// -# MCI_SendCommand() is used for host to send command to device through MCI interface.
-/// -# MCI_Handler() is the interrupt service routine.
+/// -# MCI_Handler() is the interrupt service routine. With MCI_DEFERRED, it
+///    leaves the completion of the commands that have a callback to a bottom
+///    half run by DEFER_Run() (see utility/defer.h).
 ///
 /// !Functions
 ///
@@ -62,6 +64,21 @@
 
 #include <board.h>
 
+/// Invoke the command callbacks from a bottom half scheduled with
+/// utility/defer.h rather than from MCI_Handler().
+#if !defined(MCI_DEFERRED)
+#define MCI_DEFERRED            0
+#endif
+
+/// Priority of the bottom half.
+#if !defined(MCI_DEFER_PRIORITY)
+#define MCI_DEFER_PRIORITY      1
+#endif
+
+#if (MCI_DEFERRED == 1)
+#include <utility/defer.h>
+#endif
+
 //------------------------------------------------------------------------------
 //         Constants
 //------------------------------------------------------------------------------
@@ -176,6 +193,10 @@ typedef struct {
     unsigned char mciMode;
     /// Mutex.
     volatile char semaphore;
+#if (MCI_DEFERRED == 1)
+    /// Bottom half completing a command with a callback.
+    DeferredWork bottomHalf;
+#endif
 } Mci;
 
 //------------------------------------------------------------------------------
@@ -39,7 +39,9 @@
 /// -# MCI_Init: Initializes a MCI driver instance and the underlying peripheral.
 /// -# MCI_SetSpeed : Configure the  MCI CLKDIV in the MCI_MR register.
 /// -# MCI_SendCommand: Starts a MCI  transfer.
-/// -# MCI_Handler : Interrupt handler which is called by ISR handler.
+/// -# MCI_Handler : Interrupt handler which is called by ISR handler. With
+///    MCI_DEFERRED, the commands that have a callback are completed by a
+///    bottom half run by DEFER_Run() (see utility/defer.h).
 /// -# MCI_SetBusWidth : Configure the  MCI SDCBUS in the MCI_SDCR register.
 //------------------------------------------------------------------------------
 
@@ -57,6 +59,17 @@
 /// MCI BUSY Check Fix
 #define MCI_BUSY_CHECK_FIX      1
 
+/// Invoke the command callbacks from a bottom half scheduled with
+/// utility/defer.h rather than from MCI_Handler().
+#if !defined(MCI_DEFERRED)
+#define MCI_DEFERRED            0
+#endif
+
+/// Priority of the bottom half.
+#if !defined(MCI_DEFER_PRIORITY)
+#define MCI_DEFER_PRIORITY      1
+#endif
+
 //------------------------------------------------------------------------------
 //         Headers
 //------------------------------------------------------------------------------
@@ -65,6 +78,9 @@
 #if MCI_BUSY_CHECK_FIX
 #include <pio/pio.h>
 #endif
+#if (MCI_DEFERRED == 1)
+#include <utility/defer.h>
+#endif
 
 //------------------------------------------------------------------------------
 //         Constants
@@ -183,6 +199,10 @@ typedef struct {
     unsigned char mciMode;
     /// Mutex.
     volatile char semaphore;
+#if (MCI_DEFERRED == 1)
+    /// Bottom half completing a command with a callback.
+    DeferredWork bottomHalf;
+#endif
 } Mci;
 
 //------------------------------------------------------------------------------
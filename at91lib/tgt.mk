@@ -44,6 +44,7 @@ at91lib_utility_path := $(AT91LIB)
 at91lib_utility_objs := $(addprefix utility/,\
 													bmp.o \
 													clock.o \
+													defer.o \
 													hamming.o \
 													led.o \
 													math.o \
@@ -52,9 +53,89 @@ at91lib_utility_objs := $(addprefix utility/,\
 													stdio.o \
 													string.o \
 													trace.o \
+													tracedefer.o \
 													video.o \
 													wav.o)
 at91lib_utility_cflags := -I$(AT91LIB)/boards/$(BOARD) \
 													-I$(AT91LIB)/peripherals \
 													-I$(AT91LIB)
 
+# USB device stack. USBDCallbacks_RequestReceived.o is left out, the class
+# drivers provide that callback.
+libs += at91lib_usb_device at91lib_usb_cdc at91lib_usb_msd at91lib_usb_audio
+
+at91lib_usb_device_path := $(AT91LIB)/usb
+at91lib_usb_device_objs := common/core/USBConfigurationDescriptor.o \
+                           common/core/USBEndpointDescriptor.o \
+                           common/core/USBFeatureRequest.o \
+                           common/core/USBGenericDescriptor.o \
+                           common/core/USBGenericRequest.o \
+                           common/core/USBGetDescriptorRequest.o \
+                           common/core/USBInterfaceRequest.o \
+                           common/core/USBSetAddressRequest.o \
+                           common/core/USBSetConfigurationRequest.o \
+                           device/core/USBD_UDPHS.o \
+                           device/core/USBDCallbacks_Initialized.o \
+                           device/core/USBDCallbacks_Reset.o \
+                           device/core/USBDCallbacks_Resumed.o \
+                           device/core/USBDCallbacks_Suspended.o \
+                           device/core/USBDDriver.o \
+                           device/core/USBDDriverCb_CfgChanged.o \
+                           device/core/USBDDriverCb_IfSettingChanged.o
+at91lib_usb_device_cflags := -I$(AT91LIB)/boards/$(BOARD) \
+															-I$(AT91LIB)/peripherals \
+															-I$(AT91LIB)
+
+at91lib_usb_cdc_path := $(AT91LIB)/usb
+at91lib_usb_cdc_objs := common/cdc/CDCLineCoding.o \
+                        common/cdc/CDCSetControlLineStateRequest.o \
+                        device/cdc-serial/CDCDSerialDriver.o \
+                        device/cdc-serial/CDCDSerialDriverDescriptors.o
+at91lib_usb_cdc_cflags := -I$(AT91LIB)/boards/$(BOARD) \
+												-I$(AT91LIB)/peripherals \
+												-I$(AT91LIB)
+
+at91lib_usb_msd_path := $(AT91LIB)/usb/device/massstorage
+at91lib_usb_msd_objs := MSDDStateMachine.o \
+                        MSDDriver.o \
+                        MSDDriverDescriptors.o \
+                        MSDIOFifo.o \
+                        MSDLun.o \
+                        SBCMethods.o
+at91lib_usb_msd_cflags := -I$(AT91LIB)/boards/$(BOARD) \
+												-I$(AT91LIB)/peripherals \
+												-I$(AT91LIB)
+
+at91lib_usb_audio_path := $(AT91LIB)/usb
+at91lib_usb_audio_objs := common/audio/AUDFeatureUnitRequest.o \
+                          common/audio/AUDGenericRequest.o \
+                          device/audio-speaker/AUDDSpeakerChannel.o \
+                          device/audio-speaker/AUDDSpeakerDriver.o \
+                          device/audio-speaker/AUDDSpeakerDriverDescriptors.o \
+                          device/audio-speaker/AUDDSpeakerPlayer.o \
+                          device/audio-speaker/AUDDSpeakerStream.o
+at91lib_usb_audio_cflags := -I$(AT91LIB)/boards/$(BOARD) \
+												-I$(AT91LIB)/peripherals \
+												-I$(AT91LIB)
+
+# Composite CDC + MSD device, with the scheduler of its functions
+libs += at91lib_usb_composite
+
+at91lib_usb_composite_path := $(AT91LIB)/usb/device/composite
+at91lib_usb_composite_objs := CDCDFunctionDriver.o \
+                              CDCMSDDDriver.o \
+                              CDCMSDDDriverDescriptors.o \
+                              COMPOSITEDScheduler.o \
+                              MSDDFunctionDriver.o
+at91lib_usb_composite_cflags := -I$(AT91LIB)/boards/$(BOARD) \
+												-I$(AT91LIB)/peripherals \
+												-I$(AT91LIB)
+
+libs += at91lib_memories
+
+at91lib_memories_path := $(AT91LIB)/memories
+at91lib_memories_objs := Media.o \
+                         MEDRamDisk.o
+at91lib_memories_cflags := -I$(AT91LIB)/boards/$(BOARD) \
+													-I$(AT91LIB)/peripherals \
+													-I$(AT91LIB)
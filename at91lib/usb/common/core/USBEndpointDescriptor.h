@@ -118,6 +118,31 @@
 #define USBEndpointDescriptor_INTERRUPT     3
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// \page "USB Isochronous endpoint attributes"
+///
+/// This page lists the synchronization types and usage types of isochronous
+/// endpoints, to be or'ed with USBEndpointDescriptor_ISOCHRONOUS.
+///
+/// !Attributes
+/// - USBEndpointDescriptor_ASYNCHRONOUS
+/// - USBEndpointDescriptor_ADAPTIVE
+/// - USBEndpointDescriptor_SYNCHRONOUS
+/// - USBEndpointDescriptor_FEEDBACK
+/// - USBEndpointDescriptor_IMPLICITFEEDBACK
+
+/// Asynchronous endpoint, clocked independently of the USB frames.
+#define USBEndpointDescriptor_ASYNCHRONOUS      (1 << 2)
+/// Adaptive endpoint, which follows the data rate of the other side.
+#define USBEndpointDescriptor_ADAPTIVE          (2 << 2)
+/// Synchronous endpoint, locked to the USB frames.
+#define USBEndpointDescriptor_SYNCHRONOUS       (3 << 2)
+/// Explicit feedback endpoint.
+#define USBEndpointDescriptor_FEEDBACK          (1 << 4)
+/// Data endpoint which also provides implicit feedback.
+#define USBEndpointDescriptor_IMPLICITFEEDBACK  (2 << 4)
+//------------------------------------------------------------------------------
+
 //------------------------------------------------------------------------------
 /// \page "USB Endpoint maximun sizes"
 ///
@@ -39,6 +39,23 @@
 #include <usb/common/audio/AUDGenericRequest.h>
 #include <usb/common/audio/AUDFeatureUnitRequest.h>
 #include <usb/device/core/USBDDriver.h>
+#include <usb/device/audio-speaker/AUDDSpeakerStream.h>
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Number of packet buffers queued on the data out endpoint. Without the
+/// transfer queues of the UDPHS, a single buffer is re-armed from its
+/// completion callback.
+#if defined(BOARD_USB_UDPHS)
+    #define NUMPACKETS          4
+#else
+    #define NUMPACKETS          1
+#endif
+
+/// Size of the playback ring, in bytes.
+#define RINGSIZE    (AUDDLoopRecDriver_PERIODS * AUDDLoopRecDriver_BYTESPERFRAME)
 
 //------------------------------------------------------------------------------
 //         Internal types
@@ -55,6 +72,14 @@ typedef struct {
     AUDDLoopRecChannel channels[AUDDLoopRecDriver_NUMCHANNELS+1];
     /// List of AUDDLoopRecChannel instances for record.
     AUDDLoopRecChannel recChannels[1];
+    /// Playback ring between the data out endpoint and the codec.
+    AUDDSpeakerStream stream;
+    /// Indicates the streaming out interface is active.
+    volatile unsigned char streaming;
+    /// Indicates which packet buffers are queued on the data out endpoint.
+    volatile unsigned char packetQueued[NUMPACKETS];
+    /// Indicates a feedback packet is waiting for the host.
+    volatile unsigned char feedbackQueued;
 
 } AUDDLoopRecDriver;
 
@@ -65,9 +90,18 @@ typedef struct {
 /// Global USB audio LoopRec driver instance.
 static AUDDLoopRecDriver auddLoopRecDriver;
 /// Array for storing the current setting of each interface.
-static unsigned char auddLoopRecDriverInterfaces[2];
+static unsigned char auddLoopRecDriverInterfaces[3];
 /// Intermediate storage variable for the mute status of a channel.
 static unsigned char muted;
+/// Playback ring (word aligned for the DMA).
+static unsigned int ring[(RINGSIZE + 3) / 4];
+/// Period of silence, played when the ring is empty or the master channel
+/// is muted.
+static unsigned int silence[(AUDDLoopRecDriver_BYTESPERFRAME + 3) / 4];
+/// Buffers for the packets received on the data out endpoint.
+static unsigned int packets[NUMPACKETS][(AUDDLoopRecDriver_MAXPACKETSIZE + 3) / 4];
+/// Buffer for the packet sent on the feedback endpoint.
+static unsigned char feedback[4];
 
 //------------------------------------------------------------------------------
 //         Internal functions
@@ -175,6 +209,133 @@ static void AUDDLoopRecDriver_GetFeatureCurrentValue(unsigned char entity,
     }
 }
 
+//------------------------------------------------------------------------------
+/// Queues a packet buffer on the data out endpoint.
+/// \param i Index of the packet buffer.
+//------------------------------------------------------------------------------
+static void AUDDLoopRecDriver_ReadPacket(unsigned int i);
+
+//------------------------------------------------------------------------------
+/// Callback invoked when a packet has been received on the data out endpoint.
+/// Appends it to the playback ring and queues the buffer again.
+/// \param argument Index of the packet buffer.
+/// \param status Transfer status.
+/// \param transferred Size of the packet in bytes.
+/// \param remaining Unused space left in the buffer.
+//------------------------------------------------------------------------------
+static void AUDDLoopRecDriver_PacketReceived(void *argument,
+                                             unsigned char status,
+                                             unsigned int transferred,
+                                             unsigned int remaining)
+{
+    unsigned int i = (unsigned int) argument;
+
+    auddLoopRecDriver.packetQueued[i] = 0;
+    if (status == USBD_STATUS_SUCCESS) {
+
+        AUDDSpeakerStream_Write(&(auddLoopRecDriver.stream),
+                                packets[i],
+                                transferred);
+        if (auddLoopRecDriver.streaming) {
+
+            AUDDLoopRecDriver_ReadPacket(i);
+        }
+    }
+}
+
+static void AUDDLoopRecDriver_ReadPacket(unsigned int i)
+{
+    unsigned char status;
+
+    auddLoopRecDriver.packetQueued[i] = 1;
+#if defined(BOARD_USB_UDPHS)
+    status = USBD_QueueRead(AUDDLoopRecDriverDescriptors_DATAOUT,
+                            packets[i],
+                            AUDDLoopRecDriver_MAXPACKETSIZE,
+                            AUDDLoopRecDriver_PacketReceived,
+                            (void *) i);
+#else
+    status = USBD_Read(AUDDLoopRecDriverDescriptors_DATAOUT,
+                       packets[i],
+                       AUDDLoopRecDriver_MAXPACKETSIZE,
+                       AUDDLoopRecDriver_PacketReceived,
+                       (void *) i);
+#endif
+    if (status != USBD_STATUS_SUCCESS) {
+
+        TRACE_WARNING("AUDDLoopRecDriver_ReadPacket: %d\n\r", status);
+        auddLoopRecDriver.packetQueued[i] = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+/// Queues the current rate feedback on the feedback endpoint, for the host
+/// to read at its next refresh.
+//------------------------------------------------------------------------------
+static void AUDDLoopRecDriver_SendFeedback(void);
+
+//------------------------------------------------------------------------------
+/// Callback invoked when the host has read the rate feedback. Queues the
+/// next value.
+//------------------------------------------------------------------------------
+static void AUDDLoopRecDriver_FeedbackSent(void *argument,
+                                           unsigned char status,
+                                           unsigned int transferred,
+                                           unsigned int remaining)
+{
+    auddLoopRecDriver.feedbackQueued = 0;
+    if ((status == USBD_STATUS_SUCCESS) && auddLoopRecDriver.streaming) {
+
+        AUDDLoopRecDriver_SendFeedback();
+    }
+}
+
+static void AUDDLoopRecDriver_SendFeedback(void)
+{
+    unsigned int size;
+
+    size = AUDDSpeakerStream_GetFeedback(&(auddLoopRecDriver.stream),
+                                         USBD_IsHighSpeed(),
+                                         feedback);
+    auddLoopRecDriver.feedbackQueued = 1;
+    if (USBD_Write(AUDDLoopRecDriverDescriptors_FEEDBACK,
+                   feedback,
+                   size,
+                   AUDDLoopRecDriver_FeedbackSent,
+                   0) != USBD_STATUS_SUCCESS) {
+
+        auddLoopRecDriver.feedbackQueued = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+/// Starts or stops the reception of the audio stream, when the host selects
+/// an alternate setting of the streaming out interface. The ring is not
+/// flushed: the codec plays what is left and then silence, until the stream
+/// restarts and fills half of the ring again.
+/// \param enable Indicates the streaming out interface is active.
+//------------------------------------------------------------------------------
+static void AUDDLoopRecDriver_EnableStream(unsigned char enable)
+{
+    unsigned int i;
+
+    auddLoopRecDriver.streaming = enable;
+    if (enable) {
+
+        for (i = 0; i < NUMPACKETS; i++) {
+
+            if (!auddLoopRecDriver.packetQueued[i]) {
+
+                AUDDLoopRecDriver_ReadPacket(i);
+            }
+        }
+        if (!auddLoopRecDriver.feedbackQueued) {
+
+            AUDDLoopRecDriver_SendFeedback();
+        }
+    }
+}
+
 ///*
 //    Function: AUDDLoopRecDriver_SetInterface
 //        Changes the current active alternate setting of the given interface.
@@ -226,15 +387,34 @@ void USBDCallbacks_RequestReceived(const USBGenericRequest *request)
 }
 #endif
 
+//------------------------------------------------------------------------------
+/// Invoked when the configuration of the device changes. All the interfaces
+/// are back to their first alternate setting, so the stream is stopped.
+/// \param cfgnum New configuration number.
+//------------------------------------------------------------------------------
+void USBDDriverCallbacks_ConfigurationChanged(unsigned char cfgnum)
+{
+    auddLoopRecDriverInterfaces[AUDDLoopRecDriverDescriptors_STREAMING] = 0;
+    auddLoopRecDriverInterfaces[AUDDLoopRecDriverDescriptors_STREAMINGIN] = 0;
+    AUDDLoopRecDriver_EnableStream(0);
+    LED_Clear(USBD_LEDOTHER);
+}
+
 //------------------------------------------------------------------------------
 /// Invoked whenever the active setting of an interface is changed by the
-/// host. Changes the status of the third LED accordingly.
+/// host. Starts or stops the audio stream from the host, and changes the
+/// status of the third LED accordingly.
 /// \param interface Interface number.
 /// \param setting Newly active setting.
 //------------------------------------------------------------------------------
 void USBDDriverCallbacks_InterfaceSettingChanged(unsigned char interface,
                                                  unsigned char setting)
 {
+    if (interface == AUDDLoopRecDriverDescriptors_STREAMING) {
+
+        AUDDLoopRecDriver_EnableStream(setting != 0);
+    }
+
     if ((interface == AUDDLoopRecDriverDescriptors_STREAMING)
         && (setting == 0)) {
 
@@ -269,6 +449,15 @@ void AUDDLoopRecDriver_Initialize()
     AUDDLoopRecChannel_Initialize(&(auddLoopRecDriver.recChannels[0]),
                                   AUDDLoopRecDriver_RECCHANNEL,
                                   0);
+
+    // Initialize the playback ring
+    AUDDSpeakerStream_Initialize(&(auddLoopRecDriver.stream),
+                                 (unsigned char *) ring,
+                                 RINGSIZE,
+                                 (unsigned char *) silence,
+                                 AUDDLoopRecDriver_BYTESPERFRAME,
+                                 AUDDLoopRecDriver_BYTESPERSUBFRAME,
+                                 AUDDLoopRecDriver_SAMPLERATE);
     
     // Initialize the USB driver
     USBDDriver_Initialize(&(auddLoopRecDriver.usbdDriver),
@@ -379,7 +568,8 @@ void AUDDLoopRecDriver_RequestHandler(const USBGenericRequest *request)
 //------------------------------------------------------------------------------
 /// Reads incoming audio data sent by the USB host into the provided
 /// buffer. When the transfer is complete, an optional callback function is
-/// invoked.
+/// invoked. This bypasses the playback ring, and may only be used while the
+/// host has not activated the streaming out interface.
 /// \param buffer Pointer to the data storage buffer.
 /// \param length Size of the buffer in bytes.
 /// \param callback Optional callback function.
@@ -420,4 +610,54 @@ unsigned char AUDDLoopRecDriver_Write(void *buffer,
                       length,
                       callback,
                       argument);
-}
\ No newline at end of file
+}
+
+//------------------------------------------------------------------------------
+/// Returns the next period of audio to play, one millisecond of samples
+/// (AUDDLoopRecDriver_BYTESPERFRAME bytes), to be queued to the codec DMA.
+/// The period is silence while the ring fills up, after an underrun, or
+/// while the master channel is muted. Call from the codec DMA interrupt.
+/// \return Pointer to the period, or 0 if the codec already owns eight
+///         periods.
+//------------------------------------------------------------------------------
+void * AUDDLoopRecDriver_AcquirePeriod(void)
+{
+    void *pPeriod = AUDDSpeakerStream_AcquirePeriod(&(auddLoopRecDriver.stream));
+
+    if (pPeriod
+        && AUDDLoopRecChannel_IsMuted(&(auddLoopRecDriver.channels[
+                                          AUDDLoopRecDriver_MASTERCHANNEL]))) {
+
+        pPeriod = silence;
+    }
+    return pPeriod;
+}
+
+//------------------------------------------------------------------------------
+/// Gives back the oldest period returned by AUDDLoopRecDriver_AcquirePeriod,
+/// once the codec has played it.
+//------------------------------------------------------------------------------
+void AUDDLoopRecDriver_ReleasePeriod(void)
+{
+    AUDDSpeakerStream_ReleasePeriod(&(auddLoopRecDriver.stream));
+}
+
+//------------------------------------------------------------------------------
+/// Returns the underrun and overrun counters and the fill level of the
+/// playback ring.
+/// \param pStatistics Pointer to the structure to fill.
+//------------------------------------------------------------------------------
+void AUDDLoopRecDriver_GetStreamStatistics(
+    AUDDSpeakerStreamStatistics *pStatistics)
+{
+    AUDDSpeakerStream_GetStatistics(&(auddLoopRecDriver.stream), pStatistics);
+}
+
+//------------------------------------------------------------------------------
+/// Clears the counters of the playback ring.
+//------------------------------------------------------------------------------
+void AUDDLoopRecDriver_ResetStreamStatistics(void)
+{
+    AUDDSpeakerStream_ResetStatistics(&(auddLoopRecDriver.stream));
+}
+
@@ -40,8 +40,13 @@
     -# Enable and setup USB related pins (see pio & board.h).
     -# Configure the USB Audio Loop Record driver using
        AUDDLoopRecDriver_Initialize
-    -# To get %audio stream frames from host, use
-       AUDDLoopRecDriver_Read
+    -# The %audio stream from the host is collected in a ring of several
+       periods while the streaming out interface is active, and the host is
+       told through the feedback endpoint how fast to send it. Play it with
+       AUDDSpeakerPlayer, giving it AUDDLoopRecDriver_AcquirePeriod and
+       AUDDLoopRecDriver_ReleasePeriod (see AUDDSpeakerPlayer.h).
+    -# Underruns and overruns of the ring are reported by
+       AUDDLoopRecDriver_GetStreamStatistics
     -# To send %audio sampling stream to host, use
        AUDDLoopRecDriver_Write
 
@@ -57,6 +62,7 @@
 #include <board.h>
 #include <usb/common/core/USBGenericRequest.h>
 #include <usb/device/core/USBD.h>
+#include <usb/device/audio-speaker/AUDDSpeakerStream.h>
 
 //------------------------------------------------------------------------------
 //         Definitions
@@ -74,6 +80,8 @@
 /// - AUDDLoopRecDriver_BITSPERSAMPLE
 /// - AUDDLoopRecDriver_SAMPLESPERFRAME
 /// - AUDDLoopRecDriver_BYTESPERFRAME
+/// - AUDDLoopRecDriver_MAXPACKETSIZE
+/// - AUDDLoopRecDriver_PERIODS
 
 #if defined(at91sam7s) || defined(at91sam9xe)
  /// Sample rate in Hz.
@@ -101,6 +109,14 @@
 /// Number of bytes in one USB frame.
 #define AUDDLoopRecDriver_BYTESPERFRAME     (AUDDLoopRecDriver_SAMPLESPERFRAME * \
                                              AUDDLoopRecDriver_BYTESPERSAMPLE)
+/// Largest packet sent by the host, which may add one sample per channel to
+/// a frame when following the rate feedback.
+#define AUDDLoopRecDriver_MAXPACKETSIZE     (AUDDLoopRecDriver_BYTESPERFRAME + \
+                                             AUDDLoopRecDriver_BYTESPERSUBFRAME)
+/// Number of 1ms periods in the playback ring.
+#ifndef AUDDLoopRecDriver_PERIODS
+ #define AUDDLoopRecDriver_PERIODS          8
+#endif
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
@@ -144,6 +160,15 @@ extern unsigned char AUDDLoopRecDriver_Write(void *buffer,
                                              TransferCallback callback,
                                              void *argument);
 
+extern void * AUDDLoopRecDriver_AcquirePeriod(void);
+
+extern void AUDDLoopRecDriver_ReleasePeriod(void);
+
+extern void AUDDLoopRecDriver_GetStreamStatistics(
+    AUDDSpeakerStreamStatistics *pStatistics);
+
+extern void AUDDLoopRecDriver_ResetStreamStatistics(void);
+
 #endif //#ifndef AUDDLoopRecDriver_H
 
 //#ifndef Loop Record_DRIVER_H
@@ -175,6 +175,8 @@ typedef struct {
     AUDEndpointDescriptor streamingOutEndpoint;
     /// Audio class descriptor for the streaming out endpoint.
     AUDDataEndpointDescriptor streamingOutDataEndpoint; 
+    /// Rate feedback endpoint descriptor for the streaming out endpoint.
+    AUDEndpointDescriptor streamingOutFeedbackEndpoint;
     //- AUDIO IN
     /// Streaming in interface descriptor (with no endpoint, required).
     USBInterfaceDescriptor streamingInNoIsochronous;
@@ -387,7 +389,7 @@ const AUDDLoopRecDriverConfigurationDescriptors hsConfigurationDescriptors = {
         USBGenericDescriptor_INTERFACE,
         AUDDLoopRecDriverDescriptors_STREAMING,
         1, // This is alternate setting #1
-        1, // This interface uses 1 endpoint
+        2, // This interface uses 2 endpoints (data and feedback)
         AUDStreamingInterfaceDescriptor_CLASS,
         AUDStreamingInterfaceDescriptor_SUBCLASS,
         AUDStreamingInterfaceDescriptor_PROTOCOL,
@@ -427,11 +429,14 @@ const AUDDLoopRecDriverConfigurationDescriptors hsConfigurationDescriptors = {
         USBEndpointDescriptor_ADDRESS(
             USBEndpointDescriptor_OUT,
             AUDDLoopRecDriverDescriptors_DATAOUT),
-        USBEndpointDescriptor_ISOCHRONOUS,
-        AUDDLoopRecDriver_BYTESPERFRAME,
+        USBEndpointDescriptor_ISOCHRONOUS
+        | USBEndpointDescriptor_ASYNCHRONOUS,
+        AUDDLoopRecDriver_MAXPACKETSIZE,
         AUDDLoopRecDriverDescriptors_HS_INTERVAL, // Polling interval = 1 ms
         0, // This is not a synchronization endpoint
-        0 // No associated synchronization endpoint
+        USBEndpointDescriptor_ADDRESS(
+            USBEndpointDescriptor_IN,
+            AUDDLoopRecDriverDescriptors_FEEDBACK)
     },
     // Audio streaming endpoint class-specific descriptor
     {
@@ -442,6 +447,20 @@ const AUDDLoopRecDriverConfigurationDescriptors hsConfigurationDescriptors = {
         0, // Endpoint is not synchronized
         0 // Endpoint is not synchronized
     },
+    // Rate feedback endpoint standard descriptor
+    {
+        sizeof(AUDEndpointDescriptor),
+        USBGenericDescriptor_ENDPOINT,
+        USBEndpointDescriptor_ADDRESS(
+            USBEndpointDescriptor_IN,
+            AUDDLoopRecDriverDescriptors_FEEDBACK),
+        USBEndpointDescriptor_ISOCHRONOUS
+        | USBEndpointDescriptor_FEEDBACK,
+        4, // 16.16 samples per microframe
+        AUDDLoopRecDriverDescriptors_HS_INTERVAL, // Polling interval = 1 ms
+        AUDDLoopRecDriverDescriptors_REFRESH,
+        0 // No associated synchronization endpoint
+    },
     //- AUDIO IN
     // Audio streaming interface with 0 endpoints
     {
@@ -672,7 +691,7 @@ const AUDDLoopRecDriverConfigurationDescriptors fsConfigurationDescriptors = {
         USBGenericDescriptor_INTERFACE,
         AUDDLoopRecDriverDescriptors_STREAMING,
         1, // This is alternate setting #1
-        1, // This interface uses 1 endpoint
+        2, // This interface uses 2 endpoints (data and feedback)
         AUDStreamingInterfaceDescriptor_CLASS,
         AUDStreamingInterfaceDescriptor_SUBCLASS,
         AUDStreamingInterfaceDescriptor_PROTOCOL,
@@ -712,11 +731,14 @@ const AUDDLoopRecDriverConfigurationDescriptors fsConfigurationDescriptors = {
         USBEndpointDescriptor_ADDRESS(
             USBEndpointDescriptor_OUT,
             AUDDLoopRecDriverDescriptors_DATAOUT),
-        USBEndpointDescriptor_ISOCHRONOUS,
-        AUDDLoopRecDriver_BYTESPERFRAME,
+        USBEndpointDescriptor_ISOCHRONOUS
+        | USBEndpointDescriptor_ASYNCHRONOUS,
+        AUDDLoopRecDriver_MAXPACKETSIZE,
         AUDDLoopRecDriverDescriptors_FS_INTERVAL, // Polling interval = 1 ms
         0, // This is not a synchronization endpoint
-        0 // No associated synchronization endpoint
+        USBEndpointDescriptor_ADDRESS(
+            USBEndpointDescriptor_IN,
+            AUDDLoopRecDriverDescriptors_FEEDBACK)
     },
     // Audio streaming endpoint class-specific descriptor
     {
@@ -727,6 +749,20 @@ const AUDDLoopRecDriverConfigurationDescriptors fsConfigurationDescriptors = {
         0, // Endpoint is not synchronized
         0 // Endpoint is not synchronized
     },
+    // Rate feedback endpoint standard descriptor
+    {
+        sizeof(AUDEndpointDescriptor),
+        USBGenericDescriptor_ENDPOINT,
+        USBEndpointDescriptor_ADDRESS(
+            USBEndpointDescriptor_IN,
+            AUDDLoopRecDriverDescriptors_FEEDBACK),
+        USBEndpointDescriptor_ISOCHRONOUS
+        | USBEndpointDescriptor_FEEDBACK,
+        3, // 10.14 samples per frame
+        AUDDLoopRecDriverDescriptors_FS_INTERVAL, // Polling interval = 1 ms
+        AUDDLoopRecDriverDescriptors_REFRESH,
+        0 // No associated synchronization endpoint
+    },
     //- AUDIO IN
     // Audio streaming interface with 0 endpoints
     {
@@ -62,25 +62,33 @@
 /// !Endpoints
 /// - AUDDLoopRecDriverDescriptors_DATAOUT
 /// - AUDDLoopRecDriverDescriptors_DATAIN
+/// - AUDDLoopRecDriverDescriptors_FEEDBACK
 /// - AUDDLoopRecDriverDescriptors_HS_INTERVAL
 /// - AUDDLoopRecDriverDescriptors_FS_INTERVAL
+/// - AUDDLoopRecDriverDescriptors_REFRESH
 
 #if defined(BOARD_USB_UDPHS) || defined(at91sam7s) || defined(at91sam9xe)
     /// Data out endpoint number.
     #define AUDDLoopRecDriverDescriptors_DATAOUT        0x01
     /// Data in endpoint number (1 or 2 will cause timing pb).
     #define AUDDLoopRecDriverDescriptors_DATAIN         0x03
+    /// Rate feedback endpoint number (IN), for the data out endpoint.
+    #define AUDDLoopRecDriverDescriptors_FEEDBACK       0x02
 #else
     /// Data out endpoint number.
     #define AUDDLoopRecDriverDescriptors_DATAOUT        0x04
     /// Data in endpoint number.
     #define AUDDLoopRecDriverDescriptors_DATAIN         0x05
+    /// Rate feedback endpoint number (IN), for the data out endpoint.
+    #define AUDDLoopRecDriverDescriptors_FEEDBACK       0x03
 #endif
 
 /// Endpoint polling interval 2^(x-1) * 125us
 #define AUDDLoopRecDriverDescriptors_HS_INTERVAL    0x04
 /// Endpoint polling interval 2^(x-1) * ms
 #define AUDDLoopRecDriverDescriptors_FS_INTERVAL    0x01
+/// Feedback refresh period 2^x * ms
+#define AUDDLoopRecDriverDescriptors_REFRESH        0x03
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
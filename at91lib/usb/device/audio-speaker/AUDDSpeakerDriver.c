@@ -34,12 +34,29 @@
 #include "AUDDSpeakerDriver.h"
 #include "AUDDSpeakerDriverDescriptors.h"
 #include "AUDDSpeakerChannel.h"
+#include "AUDDSpeakerStream.h"
 #include <utility/trace.h>
 #include <utility/led.h>
 #include <usb/common/audio/AUDGenericRequest.h>
 #include <usb/common/audio/AUDFeatureUnitRequest.h>
 #include <usb/device/core/USBDDriver.h>
 
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Number of packet buffers queued on the data out endpoint. Without the
+/// transfer queues of the UDPHS, a single buffer is re-armed from its
+/// completion callback.
+#if defined(BOARD_USB_UDPHS)
+    #define NUMPACKETS          4
+#else
+    #define NUMPACKETS          1
+#endif
+
+/// Size of the playback ring, in bytes.
+#define RINGSIZE    (AUDDSpeakerDriver_PERIODS * AUDDSpeakerDriver_BYTESPERFRAME)
+
 //------------------------------------------------------------------------------
 //         Internal types
 //------------------------------------------------------------------------------
@@ -53,6 +70,14 @@ typedef struct {
     USBDDriver usbdDriver;
     /// List of AUDDSpeakerChannel instances for playback.
     AUDDSpeakerChannel channels[AUDDSpeakerDriver_NUMCHANNELS+1];
+    /// Playback ring between the data out endpoint and the codec.
+    AUDDSpeakerStream stream;
+    /// Indicates the streaming interface is active.
+    volatile unsigned char streaming;
+    /// Indicates which packet buffers are queued on the data out endpoint.
+    volatile unsigned char packetQueued[NUMPACKETS];
+    /// Indicates a feedback packet is waiting for the host.
+    volatile unsigned char feedbackQueued;
 
 } AUDDSpeakerDriver;
 
@@ -66,6 +91,15 @@ static AUDDSpeakerDriver auddSpeakerDriver;
 static unsigned char auddSpeakerDriverInterfaces[2];
 /// Intermediate storage variable for the mute status of a channel.
 static unsigned char muted;
+/// Playback ring (word aligned for the DMA).
+static unsigned int ring[(RINGSIZE + 3) / 4];
+/// Period of silence, played when the ring is empty or the master channel
+/// is muted.
+static unsigned int silence[(AUDDSpeakerDriver_BYTESPERFRAME + 3) / 4];
+/// Buffers for the packets received on the data out endpoint.
+static unsigned int packets[NUMPACKETS][(AUDDSpeakerDriver_MAXPACKETSIZE + 3) / 4];
+/// Buffer for the packet sent on the feedback endpoint.
+static unsigned char feedback[4];
 
 //------------------------------------------------------------------------------
 //         Internal functions
@@ -157,6 +191,133 @@ static void AUDDSpeakerDriver_GetFeatureCurrentValue(unsigned char entity,
     }
 }
 
+//------------------------------------------------------------------------------
+/// Queues a packet buffer on the data out endpoint.
+/// \param i Index of the packet buffer.
+//------------------------------------------------------------------------------
+static void AUDDSpeakerDriver_ReadPacket(unsigned int i);
+
+//------------------------------------------------------------------------------
+/// Callback invoked when a packet has been received on the data out endpoint.
+/// Appends it to the playback ring and queues the buffer again.
+/// \param argument Index of the packet buffer.
+/// \param status Transfer status.
+/// \param transferred Size of the packet in bytes.
+/// \param remaining Unused space left in the buffer.
+//------------------------------------------------------------------------------
+static void AUDDSpeakerDriver_PacketReceived(void *argument,
+                                             unsigned char status,
+                                             unsigned int transferred,
+                                             unsigned int remaining)
+{
+    unsigned int i = (unsigned int) argument;
+
+    auddSpeakerDriver.packetQueued[i] = 0;
+    if (status == USBD_STATUS_SUCCESS) {
+
+        AUDDSpeakerStream_Write(&(auddSpeakerDriver.stream),
+                                packets[i],
+                                transferred);
+        if (auddSpeakerDriver.streaming) {
+
+            AUDDSpeakerDriver_ReadPacket(i);
+        }
+    }
+}
+
+static void AUDDSpeakerDriver_ReadPacket(unsigned int i)
+{
+    unsigned char status;
+
+    auddSpeakerDriver.packetQueued[i] = 1;
+#if defined(BOARD_USB_UDPHS)
+    status = USBD_QueueRead(AUDDSpeakerDriverDescriptors_DATAOUT,
+                            packets[i],
+                            AUDDSpeakerDriver_MAXPACKETSIZE,
+                            AUDDSpeakerDriver_PacketReceived,
+                            (void *) i);
+#else
+    status = USBD_Read(AUDDSpeakerDriverDescriptors_DATAOUT,
+                       packets[i],
+                       AUDDSpeakerDriver_MAXPACKETSIZE,
+                       AUDDSpeakerDriver_PacketReceived,
+                       (void *) i);
+#endif
+    if (status != USBD_STATUS_SUCCESS) {
+
+        TRACE_WARNING("AUDDSpeakerDriver_ReadPacket: %d\n\r", status);
+        auddSpeakerDriver.packetQueued[i] = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+/// Queues the current rate feedback on the feedback endpoint, for the host
+/// to read at its next refresh.
+//------------------------------------------------------------------------------
+static void AUDDSpeakerDriver_SendFeedback(void);
+
+//------------------------------------------------------------------------------
+/// Callback invoked when the host has read the rate feedback. Queues the
+/// next value.
+//------------------------------------------------------------------------------
+static void AUDDSpeakerDriver_FeedbackSent(void *argument,
+                                           unsigned char status,
+                                           unsigned int transferred,
+                                           unsigned int remaining)
+{
+    auddSpeakerDriver.feedbackQueued = 0;
+    if ((status == USBD_STATUS_SUCCESS) && auddSpeakerDriver.streaming) {
+
+        AUDDSpeakerDriver_SendFeedback();
+    }
+}
+
+static void AUDDSpeakerDriver_SendFeedback(void)
+{
+    unsigned int size;
+
+    size = AUDDSpeakerStream_GetFeedback(&(auddSpeakerDriver.stream),
+                                         USBD_IsHighSpeed(),
+                                         feedback);
+    auddSpeakerDriver.feedbackQueued = 1;
+    if (USBD_Write(AUDDSpeakerDriverDescriptors_FEEDBACK,
+                   feedback,
+                   size,
+                   AUDDSpeakerDriver_FeedbackSent,
+                   0) != USBD_STATUS_SUCCESS) {
+
+        auddSpeakerDriver.feedbackQueued = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+/// Starts or stops the reception of the audio stream, when the host selects
+/// an alternate setting of the streaming interface. The ring is not flushed:
+/// the codec plays what is left and then silence, until the stream restarts
+/// and fills half of the ring again.
+/// \param enable Indicates the streaming interface is active.
+//------------------------------------------------------------------------------
+static void AUDDSpeakerDriver_EnableStream(unsigned char enable)
+{
+    unsigned int i;
+
+    auddSpeakerDriver.streaming = enable;
+    if (enable) {
+
+        for (i = 0; i < NUMPACKETS; i++) {
+
+            if (!auddSpeakerDriver.packetQueued[i]) {
+
+                AUDDSpeakerDriver_ReadPacket(i);
+            }
+        }
+        if (!auddSpeakerDriver.feedbackQueued) {
+
+            AUDDSpeakerDriver_SendFeedback();
+        }
+    }
+}
+
 ///*
 //    Function: AUDDSpeakerDriver_SetInterface
 //        Changes the current active alternate setting of the given interface.
@@ -208,15 +369,33 @@ void USBDCallbacks_RequestReceived(const USBGenericRequest *request)
 }
 #endif
 
+//------------------------------------------------------------------------------
+/// Invoked when the configuration of the device changes. All the interfaces
+/// are back to their first alternate setting, so the stream is stopped.
+/// \param cfgnum New configuration number.
+//------------------------------------------------------------------------------
+void USBDDriverCallbacks_ConfigurationChanged(unsigned char cfgnum)
+{
+    auddSpeakerDriverInterfaces[AUDDSpeakerDriverDescriptors_STREAMING] = 0;
+    AUDDSpeakerDriver_EnableStream(0);
+    LED_Clear(USBD_LEDOTHER);
+}
+
 //------------------------------------------------------------------------------
 /// Invoked whenever the active setting of an interface is changed by the
-/// host. Changes the status of the third LED accordingly.
+/// host. Starts or stops the audio stream, and changes the status of the
+/// third LED accordingly.
 /// \param interface Interface number.
 /// \param setting Newly active setting.
 //------------------------------------------------------------------------------
 void USBDDriverCallbacks_InterfaceSettingChanged(unsigned char interface,
                                                  unsigned char setting)
 {
+    if (interface == AUDDSpeakerDriverDescriptors_STREAMING) {
+
+        AUDDSpeakerDriver_EnableStream(setting != 0);
+    }
+
     if ((interface == AUDDSpeakerDriverDescriptors_STREAMING)
         && (setting == 0)) {
 
@@ -248,6 +427,15 @@ void AUDDSpeakerDriver_Initialize()
     AUDDSpeakerChannel_Initialize(&(auddSpeakerDriver.channels[2]),
                                   AUDDSpeakerDriver_RIGHTCHANNEL,
                                   0);
+
+    // Initialize the playback ring
+    AUDDSpeakerStream_Initialize(&(auddSpeakerDriver.stream),
+                                 (unsigned char *) ring,
+                                 RINGSIZE,
+                                 (unsigned char *) silence,
+                                 AUDDSpeakerDriver_BYTESPERFRAME,
+                                 AUDDSpeakerDriver_BYTESPERSUBFRAME,
+                                 AUDDSpeakerDriver_SAMPLERATE);
     
     // Initialize the USB driver
     USBDDriver_Initialize(&(auddSpeakerDriver.usbdDriver),
@@ -356,7 +544,8 @@ void AUDDSpeakerDriver_RequestHandler(const USBGenericRequest *request)
 //------------------------------------------------------------------------------
 /// Reads incoming audio data sent by the USB host into the provided
 /// buffer. When the transfer is complete, an optional callback function is
-/// invoked.
+/// invoked. This bypasses the playback ring, and may only be used while the
+/// host has not activated the streaming interface.
 /// \param buffer Pointer to the data storage buffer.
 /// \param length Size of the buffer in bytes.
 /// \param callback Optional callback function.
@@ -376,3 +565,52 @@ unsigned char AUDDSpeakerDriver_Read(void *buffer,
                      argument);
 }
 
+//------------------------------------------------------------------------------
+/// Returns the next period of audio to play, one millisecond of samples
+/// (AUDDSpeakerDriver_BYTESPERFRAME bytes), to be queued to the codec DMA.
+/// The period is silence while the ring fills up, after an underrun, or
+/// while the master channel is muted. Call from the codec DMA interrupt.
+/// \return Pointer to the period, or 0 if the codec already owns eight
+///         periods.
+//------------------------------------------------------------------------------
+void * AUDDSpeakerDriver_AcquirePeriod(void)
+{
+    void *pPeriod = AUDDSpeakerStream_AcquirePeriod(&(auddSpeakerDriver.stream));
+
+    if (pPeriod
+        && AUDDSpeakerChannel_IsMuted(&(auddSpeakerDriver.channels[
+                                          AUDDSpeakerDriver_MASTERCHANNEL]))) {
+
+        pPeriod = silence;
+    }
+    return pPeriod;
+}
+
+//------------------------------------------------------------------------------
+/// Gives back the oldest period returned by AUDDSpeakerDriver_AcquirePeriod,
+/// once the codec has played it.
+//------------------------------------------------------------------------------
+void AUDDSpeakerDriver_ReleasePeriod(void)
+{
+    AUDDSpeakerStream_ReleasePeriod(&(auddSpeakerDriver.stream));
+}
+
+//------------------------------------------------------------------------------
+/// Returns the underrun and overrun counters and the fill level of the
+/// playback ring.
+/// \param pStatistics Pointer to the structure to fill.
+//------------------------------------------------------------------------------
+void AUDDSpeakerDriver_GetStreamStatistics(
+    AUDDSpeakerStreamStatistics *pStatistics)
+{
+    AUDDSpeakerStream_GetStatistics(&(auddSpeakerDriver.stream), pStatistics);
+}
+
+//------------------------------------------------------------------------------
+/// Clears the counters of the playback ring.
+//------------------------------------------------------------------------------
+void AUDDSpeakerDriver_ResetStreamStatistics(void)
+{
+    AUDDSpeakerStream_ResetStatistics(&(auddSpeakerDriver.stream));
+}
+
@@ -40,8 +40,13 @@
     -# Enable and setup USB related pins (see pio & board.h).
     -# Configure the USB Audio Speaker driver using
        AUDDSpeakerDriver_Initialize
-    -# To get %audio stream frames from host, use
-       AUDDSpeakerDriver_Read
+    -# The %audio stream from the host is collected in a ring of several
+       periods while the streaming interface is active, and the host is told
+       through the feedback endpoint how fast to send it. Play it with
+       AUDDSpeakerPlayer, giving it AUDDSpeakerDriver_AcquirePeriod and
+       AUDDSpeakerDriver_ReleasePeriod (see AUDDSpeakerPlayer.h).
+    -# Underruns and overruns of the ring are reported by
+       AUDDSpeakerDriver_GetStreamStatistics
     -# To send %audio sampling stream to host, use
        AUDDSpeakerDriver_Write
 
@@ -57,6 +62,7 @@
 #include <board.h>
 #include <usb/common/core/USBGenericRequest.h>
 #include <usb/device/core/USBD.h>
+#include "AUDDSpeakerStream.h"
 
 //------------------------------------------------------------------------------
 //         Definitions
@@ -74,6 +80,8 @@
 /// - AUDDSpeakerDriver_BITSPERSAMPLE
 /// - AUDDSpeakerDriver_SAMPLESPERFRAME
 /// - AUDDSpeakerDriver_BYTESPERFRAME
+/// - AUDDSpeakerDriver_MAXPACKETSIZE
+/// - AUDDSpeakerDriver_PERIODS
 
 #if defined(at91sam7s)
  /// Sample rate in Hz.
@@ -101,6 +109,14 @@
 /// Number of bytes in one USB frame.
 #define AUDDSpeakerDriver_BYTESPERFRAME     (AUDDSpeakerDriver_SAMPLESPERFRAME * \
                                              AUDDSpeakerDriver_BYTESPERSAMPLE)
+/// Largest packet sent by the host, which may add one sample per channel to
+/// a frame when following the rate feedback.
+#define AUDDSpeakerDriver_MAXPACKETSIZE     (AUDDSpeakerDriver_BYTESPERFRAME + \
+                                             AUDDSpeakerDriver_BYTESPERSUBFRAME)
+/// Number of 1ms periods in the playback ring.
+#ifndef AUDDSpeakerDriver_PERIODS
+ #define AUDDSpeakerDriver_PERIODS          8
+#endif
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
@@ -139,6 +155,15 @@ extern unsigned char AUDDSpeakerDriver_Read(void *buffer,
                                             TransferCallback callback,
                                             void *argument);
 
+extern void * AUDDSpeakerDriver_AcquirePeriod(void);
+
+extern void AUDDSpeakerDriver_ReleasePeriod(void);
+
+extern void AUDDSpeakerDriver_GetStreamStatistics(
+    AUDDSpeakerStreamStatistics *pStatistics);
+
+extern void AUDDSpeakerDriver_ResetStreamStatistics(void);
+
 #endif //#ifndef AUDDSPEAKERDRIVER_H
 
 //#ifndef SPEAKER_DRIVER_H
@@ -167,6 +167,8 @@ typedef struct {
     AUDEndpointDescriptor streamingOutEndpoint;
     /// Audio class descriptor for the streaming out endpoint.
     AUDDataEndpointDescriptor streamingOutDataEndpoint; 
+    /// Rate feedback endpoint descriptor for the streaming out endpoint.
+    AUDEndpointDescriptor streamingOutFeedbackEndpoint;
 
 } __attribute__ ((packed)) AUDDSpeakerDriverConfigurationDescriptors; // GCC
 
@@ -316,7 +318,7 @@ const AUDDSpeakerDriverConfigurationDescriptors fsConfigurationDescriptors = {
         USBGenericDescriptor_INTERFACE,
         AUDDSpeakerDriverDescriptors_STREAMING,
         1, // This is alternate setting #1
-        1, // This interface uses 1 endpoint
+        2, // This interface uses 2 endpoints (data and feedback)
         AUDStreamingInterfaceDescriptor_CLASS,
         AUDStreamingInterfaceDescriptor_SUBCLASS,
         AUDStreamingInterfaceDescriptor_PROTOCOL,
@@ -356,11 +358,14 @@ const AUDDSpeakerDriverConfigurationDescriptors fsConfigurationDescriptors = {
         USBEndpointDescriptor_ADDRESS(
             USBEndpointDescriptor_OUT,
             AUDDSpeakerDriverDescriptors_DATAOUT),
-        USBEndpointDescriptor_ISOCHRONOUS,
+        USBEndpointDescriptor_ISOCHRONOUS
+        | USBEndpointDescriptor_ASYNCHRONOUS,
         BOARD_USB_ENDPOINTS_MAXPACKETSIZE(AUDDSpeakerDriverDescriptors_DATAOUT),
         AUDDSpeakerDriverDescriptors_FS_INTERVAL, // Polling interval = 1 ms
         0, // This is not a synchronization endpoint
-        0 // No associated synchronization endpoint
+        USBEndpointDescriptor_ADDRESS(
+            USBEndpointDescriptor_IN,
+            AUDDSpeakerDriverDescriptors_FEEDBACK)
     },
     // Audio streaming endpoint class-specific descriptor
     {
@@ -370,6 +375,20 @@ const AUDDSpeakerDriverConfigurationDescriptors fsConfigurationDescriptors = {
         0, // No attributes
         0, // Endpoint is not synchronized
         0 // Endpoint is not synchronized
+    },
+    // Rate feedback endpoint standard descriptor
+    {
+        sizeof(AUDEndpointDescriptor),
+        USBGenericDescriptor_ENDPOINT,
+        USBEndpointDescriptor_ADDRESS(
+            USBEndpointDescriptor_IN,
+            AUDDSpeakerDriverDescriptors_FEEDBACK),
+        USBEndpointDescriptor_ISOCHRONOUS
+        | USBEndpointDescriptor_FEEDBACK,
+        3, // 10.14 samples per frame
+        AUDDSpeakerDriverDescriptors_FS_INTERVAL, // Polling interval = 1 ms
+        AUDDSpeakerDriverDescriptors_REFRESH,
+        0 // No associated synchronization endpoint
     }
 };
 
@@ -475,7 +494,7 @@ const AUDDSpeakerDriverConfigurationDescriptors hsConfigurationDescriptors = {
         USBGenericDescriptor_INTERFACE,
         AUDDSpeakerDriverDescriptors_STREAMING,
         1, // This is alternate setting #1
-        1, // This interface uses 1 endpoint
+        2, // This interface uses 2 endpoints (data and feedback)
         AUDStreamingInterfaceDescriptor_CLASS,
         AUDStreamingInterfaceDescriptor_SUBCLASS,
         AUDStreamingInterfaceDescriptor_PROTOCOL,
@@ -515,11 +534,14 @@ const AUDDSpeakerDriverConfigurationDescriptors hsConfigurationDescriptors = {
         USBEndpointDescriptor_ADDRESS(
             USBEndpointDescriptor_OUT,
             AUDDSpeakerDriverDescriptors_DATAOUT),
-        USBEndpointDescriptor_ISOCHRONOUS,
+        USBEndpointDescriptor_ISOCHRONOUS
+        | USBEndpointDescriptor_ASYNCHRONOUS,
         BOARD_USB_ENDPOINTS_MAXPACKETSIZE(AUDDSpeakerDriverDescriptors_DATAOUT),
         AUDDSpeakerDriverDescriptors_HS_INTERVAL, // Polling interval = 1 ms
         0, // This is not a synchronization endpoint
-        0 // No associated synchronization endpoint
+        USBEndpointDescriptor_ADDRESS(
+            USBEndpointDescriptor_IN,
+            AUDDSpeakerDriverDescriptors_FEEDBACK)
     },
     // Audio streaming endpoint class-specific descriptor
     {
@@ -529,6 +551,20 @@ const AUDDSpeakerDriverConfigurationDescriptors hsConfigurationDescriptors = {
         0, // No attributes
         0, // Endpoint is not synchronized
         0 // Endpoint is not synchronized
+    },
+    // Rate feedback endpoint standard descriptor
+    {
+        sizeof(AUDEndpointDescriptor),
+        USBGenericDescriptor_ENDPOINT,
+        USBEndpointDescriptor_ADDRESS(
+            USBEndpointDescriptor_IN,
+            AUDDSpeakerDriverDescriptors_FEEDBACK),
+        USBEndpointDescriptor_ISOCHRONOUS
+        | USBEndpointDescriptor_FEEDBACK,
+        4, // 16.16 samples per microframe
+        AUDDSpeakerDriverDescriptors_HS_INTERVAL, // Polling interval = 1 ms
+        AUDDSpeakerDriverDescriptors_REFRESH,
+        0 // No associated synchronization endpoint
     }
 };
 #endif // defined(BOARD_USB_UDPHS)
@@ -62,8 +62,10 @@
 /// !Endpoints
 /// - AUDDSpeakerDriverDescriptors_DATAOUT
 /// - AUDDSpeakerDriverDescriptors_DATAIN
+/// - AUDDSpeakerDriverDescriptors_FEEDBACK
 /// - AUDDSpeakerDriverDescriptors_FS_INTERVAL
 /// - AUDDSpeakerDriverDescriptors_HS_INTERVAL
+/// - AUDDSpeakerDriverDescriptors_REFRESH
 
 #if defined(BOARD_USB_UDPHS) || defined(at91sam7s)
     /// Data out endpoint number.
@@ -76,11 +78,15 @@
     /// Data in endpoint number.
     #define AUDDSpeakerDriverDescriptors_DATAIN         0x05
 #endif
+/// Rate feedback endpoint number (IN), for the data out endpoint.
+#define AUDDSpeakerDriverDescriptors_FEEDBACK           0x03
 
 /// Endpoint polling interval 2^(x-1) * 125us
 #define AUDDSpeakerDriverDescriptors_HS_INTERVAL       0x04
 /// Endpoint polling interval 2^(x-1) * ms
 #define AUDDSpeakerDriverDescriptors_FS_INTERVAL       0x01
+/// Feedback refresh period 2^x * ms
+#define AUDDSpeakerDriverDescriptors_REFRESH           0x03
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
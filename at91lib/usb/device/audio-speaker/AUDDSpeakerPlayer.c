@@ -0,0 +1,420 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2008, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+//------------------------------------------------------------------------------
+//         Headers
+//------------------------------------------------------------------------------
+
+#include "AUDDSpeakerPlayer.h"
+#include <utility/trace.h>
+#if defined(CHIP_SSC_DMA)
+#include <dma/dma.h>
+#include <drivers/dmad/dmad.h>
+#endif
+#if defined(AT91C_BASE_AC97C)
+#include <ac97c/ac97c.h>
+#endif
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Number of periods owned by the SSC at the same time.
+#define QUEUED              2
+
+/// Size of a sample, in bytes.
+#define SAMPLESIZE          2
+
+//------------------------------------------------------------------------------
+//         Internal types
+//------------------------------------------------------------------------------
+
+/// State of the player.
+typedef struct {
+
+    /// Hands out the periods to play.
+    AUDDSpeakerPlayerAcquire acquire;
+    /// Takes back the periods played.
+    AUDDSpeakerPlayerRelease release;
+    /// Size of a period, in bytes.
+    unsigned int periodSize;
+    /// SSC in use, or 0.
+    AT91S_SSC *ssc;
+    /// Indicates if the AC97C is in use.
+    unsigned char ac97c;
+    /// Number of periods handed out and not taken back yet.
+    unsigned char owned;
+    /// Period played by each queue slot, for when the next one is missing.
+    void *periods[QUEUED];
+    /// Indicates if the period of each queue slot was handed out by the
+    /// acquire function, and must be taken back.
+    unsigned char acquired[QUEUED];
+    /// Queue slot being played.
+    unsigned char current;
+
+} AUDDSpeakerPlayer;
+
+//------------------------------------------------------------------------------
+//         Internal variables
+//------------------------------------------------------------------------------
+
+/// Player instance.
+static AUDDSpeakerPlayer player;
+
+#if defined(CHIP_SSC_DMA)
+/// Circular list of the two descriptors played by the DMA channel.
+static DmaLinkList descriptors[QUEUED];
+#endif
+
+//------------------------------------------------------------------------------
+//         Internal functions
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Puts the next period in a queue slot, after giving back the period it
+/// held. If there is no next period, the slot plays its period again, so the
+/// codec repeats a period rather than stopping.
+/// \param slot  Queue slot.
+/// \return The period of the slot.
+//------------------------------------------------------------------------------
+static void * AUDDSpeakerPlayer_Refill(unsigned char slot)
+{
+    void *period;
+
+    if (player.acquired[slot]) {
+
+        player.release();
+        player.acquired[slot] = 0;
+        player.owned--;
+    }
+
+    period = player.acquire();
+    if (period) {
+
+        player.periods[slot] = period;
+        player.acquired[slot] = 1;
+        player.owned++;
+    }
+    else {
+
+        TRACE_WARNING("AUDDSpeakerPlayer: no period\n\r");
+    }
+
+    return player.periods[slot];
+}
+
+//------------------------------------------------------------------------------
+/// Gives back the periods still owned by the codec interface.
+//------------------------------------------------------------------------------
+static void AUDDSpeakerPlayer_ReleaseAll(void)
+{
+    unsigned char slot;
+
+    for (slot = 0; slot < QUEUED; slot++) {
+
+        player.acquired[slot] = 0;
+        player.periods[slot] = 0;
+    }
+    while (player.owned > 0) {
+
+        player.release();
+        player.owned--;
+    }
+}
+
+//------------------------------------------------------------------------------
+/// Fills the queue slots with the first periods to play.
+/// \return 1 if there is a period for each slot; otherwise 0, and the periods
+///         acquired are given back.
+//------------------------------------------------------------------------------
+static unsigned char AUDDSpeakerPlayer_Prime(void)
+{
+    unsigned char slot;
+
+    for (slot = 0; slot < QUEUED; slot++) {
+
+        if (AUDDSpeakerPlayer_Refill(slot) == 0) {
+
+            AUDDSpeakerPlayer_ReleaseAll();
+            return 0;
+        }
+    }
+    player.current = 0;
+
+    return 1;
+}
+
+#if defined(CHIP_SSC_DMA)
+//------------------------------------------------------------------------------
+/// Writes a period in a descriptor of the circular list.
+/// \param slot  Queue slot of the descriptor.
+/// \param period  Period to play.
+//------------------------------------------------------------------------------
+static void AUDDSpeakerPlayer_SetDescriptor(unsigned char slot, void *period)
+{
+    descriptors[slot].sourceAddress = (unsigned int) period;
+    descriptors[slot].controlA = (player.periodSize / SAMPLESIZE)
+                                 | AT91C_HDMA_SRC_WIDTH_HALFWORD
+                                 | AT91C_HDMA_DST_WIDTH_HALFWORD
+                                 | AT91C_HDMA_SCSIZE_1
+                                 | AT91C_HDMA_DCSIZE_1;
+}
+#endif
+
+#if defined(AT91C_BASE_AC97C)
+//------------------------------------------------------------------------------
+/// Sends the period of the current queue slot to the AC97C channel A.
+//------------------------------------------------------------------------------
+static void AUDDSpeakerPlayer_Ac97cSend(void);
+
+//------------------------------------------------------------------------------
+/// Callback invoked when the AC97C has sent a period: gives it back, and
+/// sends the next one.
+//------------------------------------------------------------------------------
+static void AUDDSpeakerPlayer_Ac97cSent(void *pArg,
+                                        unsigned char status,
+                                        unsigned int remaining)
+{
+    if (!player.ac97c) {
+
+        return;
+    }
+    AUDDSpeakerPlayer_Refill(player.current);
+    player.current = (player.current + 1) % QUEUED;
+    AUDDSpeakerPlayer_Ac97cSend();
+}
+
+static void AUDDSpeakerPlayer_Ac97cSend(void)
+{
+    AC97C_Transfer(AC97C_CHANNEL_A_TRANSMIT,
+                   (unsigned char *) player.periods[player.current],
+                   player.periodSize / SAMPLESIZE,
+                   (Ac97Callback) AUDDSpeakerPlayer_Ac97cSent,
+                   0);
+}
+#endif
+
+//------------------------------------------------------------------------------
+//         Exported functions
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Initializes the player.
+/// \param acquire  Function handing out the periods to play.
+/// \param release  Function taking back the periods played, oldest first.
+/// \param periodSize  Size of a period in bytes, a multiple of the 16-bit
+///                    sample size.
+//------------------------------------------------------------------------------
+void AUDDSpeakerPlayer_Initialize(AUDDSpeakerPlayerAcquire acquire,
+                                  AUDDSpeakerPlayerRelease release,
+                                  unsigned int periodSize)
+{
+    unsigned char slot;
+
+    player.acquire = acquire;
+    player.release = release;
+    player.periodSize = periodSize;
+    player.ssc = 0;
+    player.ac97c = 0;
+    player.owned = 0;
+    player.current = 0;
+    for (slot = 0; slot < QUEUED; slot++) {
+
+        player.periods[slot] = 0;
+        player.acquired[slot] = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+/// Starts playing through a SSC, whose transmitter must be configured for
+/// 16-bit data. On chips with CHIP_SSC_DMA, the DMA controller is enabled and
+/// BOARD_SSC_DMA_CHANNEL is used; AUDDSpeakerPlayer_DmaHandler must be called
+/// from the DMA interrupt handler. Otherwise the SSC PDC is used, and
+/// AUDDSpeakerPlayer_SscHandler must be called from the SSC interrupt
+/// handler.
+/// \param ssc  Pointer to an AT91S_SSC instance.
+/// \return 1 if playing started; otherwise 0 (no period to play).
+//------------------------------------------------------------------------------
+unsigned char AUDDSpeakerPlayer_StartSsc(AT91S_SSC *ssc)
+{
+    if (!AUDDSpeakerPlayer_Prime()) {
+
+        return 0;
+    }
+    player.ssc = ssc;
+
+#if defined(CHIP_SSC_DMA)
+    {
+        unsigned char slot;
+
+        // Circular list: each buffer end raises the interrupt, and the
+        // descriptor just played is rewritten while the other one plays
+        for (slot = 0; slot < QUEUED; slot++) {
+
+            AUDDSpeakerPlayer_SetDescriptor(slot, player.periods[slot]);
+            descriptors[slot].destAddress = (unsigned int) &ssc->SSC_THR;
+            descriptors[slot].controlB = AT91C_HDMA_DST_DSCR_FETCH_DISABLE
+                                         | AT91C_HDMA_DST_ADDRESS_MODE_FIXED
+                                         | AT91C_HDMA_SRC_DSCR_FETCH_FROM_MEM
+                                         | AT91C_HDMA_SRC_ADDRESS_MODE_INCR
+                                         | AT91C_HDMA_FC_MEM2PER;
+            descriptors[slot].descriptor =
+                (unsigned int) &descriptors[(slot + 1) % QUEUED];
+        }
+
+        AT91C_BASE_PMC->PMC_PCER = 1 << AT91C_ID_HDMA;
+        DMA_Enable();
+        DMA_DisableChannel(BOARD_SSC_DMA_CHANNEL);
+        DMA_GetStatus();
+        DMA_SetDescriptorAddr(BOARD_SSC_DMA_CHANNEL,
+                              (unsigned int) &descriptors[0]);
+        DMA_SetSourceBufferMode(BOARD_SSC_DMA_CHANNEL, DMA_TRANSFER_LLI,
+                                (AT91C_HDMA_SRC_ADDRESS_MODE_INCR >> 24));
+        DMA_SetDestBufferMode(BOARD_SSC_DMA_CHANNEL, DMA_TRANSFER_LLI,
+                              (AT91C_HDMA_DST_ADDRESS_MODE_FIXED >> 28));
+        DMA_SetFlowControl(BOARD_SSC_DMA_CHANNEL, AT91C_HDMA_FC_MEM2PER >> 21);
+        DMA_SetConfiguration(BOARD_SSC_DMA_CHANNEL,
+                             BOARD_SSC_DMA_HW_SRC_REQ_ID
+                             | BOARD_SSC_DMA_HW_DEST_REQ_ID
+                             | AT91C_HDMA_SRC_H2SEL_SW
+                             | AT91C_HDMA_DST_H2SEL_HW
+                             | AT91C_HDMA_SOD_DISABLE
+                             | AT91C_HDMA_FIFOCFG_LARGESTBURST);
+        DMA_EnableIt(DMA_BTC << BOARD_SSC_DMA_CHANNEL);
+        DMA_EnableChannel(BOARD_SSC_DMA_CHANNEL);
+    }
+#else
+    // The PDC plays its current buffer, then its next one; ENDTX is raised
+    // when the next one becomes current, and is cleared by writing TNCR
+    ssc->SSC_PTCR = AT91C_PDC_TXTDIS;
+    ssc->SSC_TPR = (unsigned int) player.periods[0];
+    ssc->SSC_TCR = player.periodSize / SAMPLESIZE;
+    ssc->SSC_TNPR = (unsigned int) player.periods[1];
+    ssc->SSC_TNCR = player.periodSize / SAMPLESIZE;
+    ssc->SSC_PTCR = AT91C_PDC_TXTEN;
+    ssc->SSC_IER = AT91C_SSC_ENDTX;
+#endif
+
+    return 1;
+}
+
+#if defined(CHIP_SSC_DMA)
+//------------------------------------------------------------------------------
+/// Handles the end of a buffer on the SSC DMA channel: gives back the period
+/// played, and puts the next one in its descriptor. Must be called from the
+/// DMA interrupt handler with the status read by DMA_GetStatus, which clears
+/// the status of every channel, within a period, or a period is played
+/// again.
+/// \param status  DMA controller status.
+//------------------------------------------------------------------------------
+void AUDDSpeakerPlayer_DmaHandler(unsigned int status)
+{
+    unsigned char slot;
+
+    if ((status & (DMA_BTC << BOARD_SSC_DMA_CHANNEL)) == 0) {
+
+        return;
+    }
+    if (player.ssc == 0) {
+
+        return;
+    }
+
+    slot = player.current;
+    AUDDSpeakerPlayer_SetDescriptor(slot, AUDDSpeakerPlayer_Refill(slot));
+    player.current = (slot + 1) % QUEUED;
+}
+#else
+//------------------------------------------------------------------------------
+/// Handles the end of the current PDC buffer of the SSC: gives back the
+/// period played, and queues the next one. Must be called from the SSC
+/// interrupt handler, within a period, or the transmitter runs dry.
+//------------------------------------------------------------------------------
+void AUDDSpeakerPlayer_SscHandler(void)
+{
+    AT91S_SSC *ssc = player.ssc;
+    unsigned char slot;
+
+    if ((ssc == 0) || ((ssc->SSC_SR & ssc->SSC_IMR & AT91C_SSC_ENDTX) == 0)) {
+
+        return;
+    }
+
+    slot = player.current;
+    ssc->SSC_TNPR = (unsigned int) AUDDSpeakerPlayer_Refill(slot);
+    ssc->SSC_TNCR = player.periodSize / SAMPLESIZE;
+    player.current = (slot + 1) % QUEUED;
+}
+#endif
+
+#if defined(AT91C_BASE_AC97C)
+//------------------------------------------------------------------------------
+/// Starts playing through the channel A of the AC97C, which must be
+/// configured for 16-bit samples. AC97C_Handler must be called from the
+/// AC97C interrupt handler.
+/// \return 1 if playing started; otherwise 0 (no period to play).
+//------------------------------------------------------------------------------
+unsigned char AUDDSpeakerPlayer_StartAc97c(void)
+{
+    if (!AUDDSpeakerPlayer_Prime()) {
+
+        return 0;
+    }
+    player.ac97c = 1;
+    AUDDSpeakerPlayer_Ac97cSend();
+
+    return 1;
+}
+#endif
+
+//------------------------------------------------------------------------------
+/// Stops playing, and gives back the periods owned by the codec interface.
+//------------------------------------------------------------------------------
+void AUDDSpeakerPlayer_Stop(void)
+{
+    if (player.ssc) {
+
+#if defined(CHIP_SSC_DMA)
+        DMA_DisableIt(DMA_BTC << BOARD_SSC_DMA_CHANNEL);
+        DMA_DisableChannel(BOARD_SSC_DMA_CHANNEL);
+#else
+        player.ssc->SSC_IDR = AT91C_SSC_ENDTX;
+        player.ssc->SSC_PTCR = AT91C_PDC_TXTDIS;
+#endif
+        player.ssc = 0;
+    }
+#if defined(AT91C_BASE_AC97C)
+    if (player.ac97c) {
+
+        player.ac97c = 0;
+        AC97C_CancelTransfer(AC97C_CHANNEL_A_TRANSMIT);
+    }
+#endif
+    AUDDSpeakerPlayer_ReleaseAll();
+}
@@ -0,0 +1,125 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2008, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ \unit
+
+ !!!Purpose
+
+    Plays the periods of an audio stream ring (see AUDDSpeakerStream.h)
+    through the SSC or the AC97C, from the interrupt that signals the end of
+    each DMA transfer.
+
+    Two periods are owned by the codec interface at any time: the one being
+    played, and the next one, already queued to the DMA. When the first has
+    been played, it is given back to the stream and a new period is queued
+    behind the second, so the codec never waits for the processor as long as
+    the interrupt is served within a period.
+
+    - On chips where the SSC uses the DMA controller (CHIP_SSC_DMA), the two
+      periods are the buffers of a circular linked list of two descriptors on
+      BOARD_SSC_DMA_CHANNEL; the end of each buffer raises the DMA interrupt.
+    - On the other chips, they are the current and next buffers of the SSC
+      PDC; the end of a buffer raises the SSC ENDTX interrupt.
+    - On the AC97C, each period is sent with AC97C_Transfer, and the next one
+      from its callback. The channel stops between two periods for as long as
+      the callback takes.
+
+    The periods come from a pair of functions, e.g.
+    AUDDSpeakerDriver_AcquirePeriod and AUDDSpeakerDriver_ReleasePeriod.
+
+ !!!Usage
+
+    -# Configure the codec and its interface (SSC_Configure,
+       SSC_ConfigureTransmitter, or AC97C_Configure and AC97C_ConfigureChannel)
+       for 16-bit samples.
+    -# Initialize the player with AUDDSpeakerPlayer_Initialize, giving it the
+       functions that hand out and take back the periods.
+    -# Start playing with AUDDSpeakerPlayer_StartSsc or
+       AUDDSpeakerPlayer_StartAc97c.
+    -# Call AUDDSpeakerPlayer_DmaHandler from the DMA interrupt handler with
+       the status returned by DMA_GetStatus (CHIP_SSC_DMA),
+       AUDDSpeakerPlayer_SscHandler from the SSC interrupt handler, or
+       AC97C_Handler from the AC97C interrupt handler, and enable that
+       interrupt:
+\code
+       void HDMA_IrqHandler(void)
+       {
+           AUDDSpeakerPlayer_DmaHandler(DMA_GetStatus());
+       }
+       ...
+       IRQ_ConfigureIT(AT91C_ID_HDMA, 0, HDMA_IrqHandler);
+       IRQ_EnableIT(AT91C_ID_HDMA);
+\endcode
+    -# Stop playing with AUDDSpeakerPlayer_Stop. The periods owned by the
+       codec interface are given back.
+*/
+
+#ifndef AUDDSPEAKERPLAYER_H
+#define AUDDSPEAKERPLAYER_H
+
+//------------------------------------------------------------------------------
+//         Headers
+//------------------------------------------------------------------------------
+
+#include <board.h>
+
+//------------------------------------------------------------------------------
+//         Types
+//------------------------------------------------------------------------------
+
+/// Hands out the next period to play, or returns 0 if there is none.
+typedef void * (*AUDDSpeakerPlayerAcquire)(void);
+
+/// Takes back the oldest period handed out, once played.
+typedef void (*AUDDSpeakerPlayerRelease)(void);
+
+//------------------------------------------------------------------------------
+//         Exported functions
+//------------------------------------------------------------------------------
+
+extern void AUDDSpeakerPlayer_Initialize(AUDDSpeakerPlayerAcquire acquire,
+                                         AUDDSpeakerPlayerRelease release,
+                                         unsigned int periodSize);
+
+extern unsigned char AUDDSpeakerPlayer_StartSsc(AT91S_SSC *ssc);
+
+#if defined(CHIP_SSC_DMA)
+extern void AUDDSpeakerPlayer_DmaHandler(unsigned int status);
+#else
+extern void AUDDSpeakerPlayer_SscHandler(void);
+#endif
+
+#if defined(AT91C_BASE_AC97C)
+extern unsigned char AUDDSpeakerPlayer_StartAc97c(void);
+#endif
+
+extern void AUDDSpeakerPlayer_Stop(void);
+
+#endif //#ifndef AUDDSPEAKERPLAYER_H
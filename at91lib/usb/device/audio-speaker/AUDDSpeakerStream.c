@@ -0,0 +1,364 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2008, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+//------------------------------------------------------------------------------
+//         Headers
+//------------------------------------------------------------------------------
+
+#include "AUDDSpeakerStream.h"
+#include <string.h>
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Maximum number of periods the codec may own at the same time.
+#define MAXPENDING          (sizeof(unsigned char) * 8)
+
+//------------------------------------------------------------------------------
+//         Internal functions
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Moves a ring position forward. Positions run modulo twice the size of the
+/// ring, so that a full ring can be told from an empty one.
+/// \param pStream  Pointer to an AUDDSpeakerStream instance.
+/// \param position  Ring position.
+/// \param length  Number of bytes to move forward.
+/// \return The new position.
+//------------------------------------------------------------------------------
+static unsigned int Advance(const AUDDSpeakerStream *pStream,
+                            unsigned int position,
+                            unsigned int length)
+{
+    position += length;
+    if (position >= 2 * pStream->size) {
+
+        position -= 2 * pStream->size;
+    }
+    return position;
+}
+
+//------------------------------------------------------------------------------
+/// Returns the number of bytes between two ring positions.
+/// \param pStream  Pointer to an AUDDSpeakerStream instance.
+/// \param from  Oldest position.
+/// \param to  Newest position.
+//------------------------------------------------------------------------------
+static unsigned int Distance(const AUDDSpeakerStream *pStream,
+                             unsigned int from,
+                             unsigned int to)
+{
+    if (to >= from) {
+
+        return to - from;
+    }
+    return to + 2 * pStream->size - from;
+}
+
+//------------------------------------------------------------------------------
+/// Returns the offset in the ring buffer of a ring position.
+/// \param pStream  Pointer to an AUDDSpeakerStream instance.
+/// \param position  Ring position.
+//------------------------------------------------------------------------------
+static unsigned int Offset(const AUDDSpeakerStream *pStream,
+                           unsigned int position)
+{
+    if (position >= pStream->size) {
+
+        return position - pStream->size;
+    }
+    return position;
+}
+
+//------------------------------------------------------------------------------
+//         Exported functions
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Initializes an audio stream.
+/// \param pStream  Pointer to the AUDDSpeakerStream instance to initialize.
+/// \param pRing  Ring buffer; should be at least four periods.
+/// \param size  Size of the ring buffer in bytes, a multiple of the period
+///              size.
+/// \param pSilence  Buffer of one period, played when the ring runs empty.
+/// \param periodSize  Size of the buffers handed to the codec, in bytes.
+/// \param sampleSize  Size of one sample on all channels, in bytes.
+/// \param sampleRate  Nominal sample rate, in Hz.
+//------------------------------------------------------------------------------
+void AUDDSpeakerStream_Initialize(AUDDSpeakerStream *pStream,
+                                  unsigned char *pRing,
+                                  unsigned int size,
+                                  unsigned char *pSilence,
+                                  unsigned int periodSize,
+                                  unsigned int sampleSize,
+                                  unsigned int sampleRate)
+{
+    pStream->pRing = pRing;
+    pStream->pSilence = pSilence;
+    pStream->size = size - (size % periodSize);
+    pStream->periodSize = periodSize;
+    pStream->sampleSize = sampleSize;
+
+    // Samples per 1ms frame, in 16.16
+    pStream->nominal = ((sampleRate / 1000) << 16)
+                       + (((sampleRate % 1000) << 16) / 1000);
+
+    memset(pSilence, 0, periodSize);
+    AUDDSpeakerStream_Reset(pStream);
+}
+
+//------------------------------------------------------------------------------
+/// Empties the ring and clears the counters. Must not be called while the
+/// codec owns periods of the stream, nor while packets are being written.
+/// \param pStream  Pointer to an AUDDSpeakerStream instance.
+//------------------------------------------------------------------------------
+void AUDDSpeakerStream_Reset(AUDDSpeakerStream *pStream)
+{
+    pStream->in = 0;
+    pStream->acquired = 0;
+    pStream->out = 0;
+    pStream->pending = 0;
+    pStream->silence = 0;
+    pStream->running = 0;
+    pStream->filtered = (pStream->size / 2) << AUDDSpeakerStream_FEEDBACKFILTER;
+    AUDDSpeakerStream_ResetStatistics(pStream);
+    pStream->statistics.feedback = pStream->nominal;
+}
+
+//------------------------------------------------------------------------------
+/// Appends a packet received from the host to the ring. The packet is
+/// dropped, and an overrun counted, if it does not fit. Must be called from a
+/// single context, usually the USB transfer callback.
+/// \param pStream  Pointer to an AUDDSpeakerStream instance.
+/// \param pData  Packet data.
+/// \param length  Packet size in bytes.
+/// \return The number of bytes written, either length or 0.
+//------------------------------------------------------------------------------
+unsigned int AUDDSpeakerStream_Write(AUDDSpeakerStream *pStream,
+                                     const void *pData,
+                                     unsigned int length)
+{
+    unsigned int in = pStream->in;
+    unsigned int level = Distance(pStream, pStream->out, in);
+    unsigned int offset;
+    unsigned int count;
+
+    if (level + length > pStream->size) {
+
+        pStream->statistics.overruns++;
+        return 0;
+    }
+
+    // Copy the packet, in two parts if it wraps around the end of the ring
+    offset = Offset(pStream, in);
+    count = pStream->size - offset;
+    if (count > length) {
+
+        count = length;
+    }
+    memcpy(&pStream->pRing[offset], pData, count);
+    memcpy(pStream->pRing, (const unsigned char *) pData + count, length - count);
+    pStream->in = Advance(pStream, in, length);
+
+    level += length;
+    pStream->statistics.bytesIn += length;
+    if (level > pStream->statistics.maxLevel) {
+
+        pStream->statistics.maxLevel = level;
+    }
+
+    // Average the data not yet handed to the codec, for the feedback
+    pStream->filtered -= pStream->filtered >> AUDDSpeakerStream_FEEDBACKFILTER;
+    pStream->filtered += Distance(pStream, pStream->acquired, pStream->in);
+
+    return length;
+}
+
+//------------------------------------------------------------------------------
+/// Hands the next period to the codec. This is a period of the ring if the
+/// stream is playing, or a period of silence while the ring fills up to the
+/// middle, after it was started or after an underrun. Must be called from a
+/// single context, usually the codec DMA interrupt.
+/// \param pStream  Pointer to an AUDDSpeakerStream instance.
+/// \return Pointer to the period to play, or 0 if the codec already owns
+///         eight periods.
+//------------------------------------------------------------------------------
+void * AUDDSpeakerStream_AcquirePeriod(AUDDSpeakerStream *pStream)
+{
+    unsigned int available;
+    void *pPeriod;
+
+    if (pStream->pending >= MAXPENDING) {
+
+        return 0;
+    }
+
+    available = Distance(pStream, pStream->acquired, pStream->in);
+    if (pStream->running && (available < pStream->periodSize)) {
+
+        pStream->statistics.underruns++;
+        pStream->running = 0;
+    }
+    if (!pStream->running && (available >= pStream->size / 2)) {
+
+        pStream->running = 1;
+    }
+
+    if (pStream->running) {
+
+        if (available < pStream->statistics.minLevel) {
+
+            pStream->statistics.minLevel = available;
+        }
+        pPeriod = &pStream->pRing[Offset(pStream, pStream->acquired)];
+        pStream->acquired = Advance(pStream,
+                                    pStream->acquired,
+                                    pStream->periodSize);
+        pStream->statistics.periodsOut++;
+    }
+    else {
+
+        pPeriod = pStream->pSilence;
+        pStream->silence |= 1 << pStream->pending;
+    }
+    pStream->pending++;
+
+    return pPeriod;
+}
+
+//------------------------------------------------------------------------------
+/// Gives back to the stream the oldest period acquired by the codec, once it
+/// has been played.
+/// \param pStream  Pointer to an AUDDSpeakerStream instance.
+//------------------------------------------------------------------------------
+void AUDDSpeakerStream_ReleasePeriod(AUDDSpeakerStream *pStream)
+{
+    unsigned char silence;
+
+    if (pStream->pending == 0) {
+
+        return;
+    }
+
+    silence = pStream->silence & 1;
+    pStream->silence >>= 1;
+    pStream->pending--;
+    if (!silence) {
+
+        pStream->out = Advance(pStream, pStream->out, pStream->periodSize);
+    }
+}
+
+//------------------------------------------------------------------------------
+/// Returns the number of bytes in the ring, including the periods owned by
+/// the codec.
+/// \param pStream  Pointer to an AUDDSpeakerStream instance.
+//------------------------------------------------------------------------------
+unsigned int AUDDSpeakerStream_GetLevel(const AUDDSpeakerStream *pStream)
+{
+    return Distance(pStream, pStream->out, pStream->in);
+}
+
+//------------------------------------------------------------------------------
+/// Computes the rate feedback from the fill level of the ring, and formats it
+/// for the feedback endpoint: samples per frame in 10.14 format on 3 bytes at
+/// full speed, samples per microframe in 16.16 format on 4 bytes at high
+/// speed. The value stays within one sample per frame of the nominal rate.
+/// \param pStream  Pointer to an AUDDSpeakerStream instance.
+/// \param highSpeed  Indicates the device runs at high speed.
+/// \param pBuffer  Buffer of at least 4 bytes for the feedback packet.
+/// \return Size of the feedback packet in bytes.
+//------------------------------------------------------------------------------
+unsigned int AUDDSpeakerStream_GetFeedback(AUDDSpeakerStream *pStream,
+                                           unsigned char highSpeed,
+                                           unsigned char *pBuffer)
+{
+    int level = pStream->filtered >> AUDDSpeakerStream_FEEDBACKFILTER;
+    int target = (pStream->size - pStream->pending * pStream->periodSize) / 2;
+    int error = (target - level) / (int) pStream->sampleSize;
+    int correction = (error * 65536) / AUDDSpeakerStream_FEEDBACKGAIN;
+    unsigned int value;
+
+    if (correction > 65536) {
+
+        correction = 65536;
+    }
+    else if (correction < -65536) {
+
+        correction = -65536;
+    }
+    value = pStream->nominal + correction;
+    pStream->statistics.feedback = value;
+
+    if (highSpeed) {
+
+        value /= 8;
+        pBuffer[0] = value & 0xFF;
+        pBuffer[1] = (value >> 8) & 0xFF;
+        pBuffer[2] = (value >> 16) & 0xFF;
+        pBuffer[3] = (value >> 24) & 0xFF;
+        return 4;
+    }
+    else {
+
+        value >>= 2;
+        pBuffer[0] = value & 0xFF;
+        pBuffer[1] = (value >> 8) & 0xFF;
+        pBuffer[2] = (value >> 16) & 0xFF;
+        return 3;
+    }
+}
+
+//------------------------------------------------------------------------------
+/// Returns the counters of an audio stream.
+/// \param pStream  Pointer to an AUDDSpeakerStream instance.
+/// \param pStatistics  Pointer to the structure to fill.
+//------------------------------------------------------------------------------
+void AUDDSpeakerStream_GetStatistics(AUDDSpeakerStream *pStream,
+                                     AUDDSpeakerStreamStatistics *pStatistics)
+{
+    *pStatistics = pStream->statistics;
+    pStatistics->level = AUDDSpeakerStream_GetLevel(pStream);
+}
+
+//------------------------------------------------------------------------------
+/// Clears the counters of an audio stream, and restarts the tracking of the
+/// lowest and highest fill levels.
+/// \param pStream  Pointer to an AUDDSpeakerStream instance.
+//------------------------------------------------------------------------------
+void AUDDSpeakerStream_ResetStatistics(AUDDSpeakerStream *pStream)
+{
+    pStream->statistics.underruns = 0;
+    pStream->statistics.overruns = 0;
+    pStream->statistics.bytesIn = 0;
+    pStream->statistics.periodsOut = 0;
+    pStream->statistics.minLevel = pStream->size;
+    pStream->statistics.maxLevel = 0;
+}
@@ -0,0 +1,202 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2008, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+/**
+ \unit
+
+ !!!Purpose
+
+    Ring buffer between the isochronous OUT endpoint of an audio %device and
+    the DMA of the codec interface (SSC or AC97C), with the rate feedback of
+    an asynchronous audio endpoint.
+
+    The host writes packets of any size into the ring; the codec side plays
+    it back one period at a time, directly from the ring. The feedback value
+    tells the host how many samples to send per frame so that the data not
+    yet handed to the codec fills half of the ring space the codec does not
+    own: it is the nominal rate, corrected in proportion to the distance
+    between the (filtered) level and that target.
+
+    When the codec finds less than a period in the ring it plays silence and
+    counts an underrun; the stream then waits until the ring is half full
+    again before resuming. A packet that does not fit in the ring is dropped
+    and counted as an overrun.
+
+    The module does not depend on the USB or codec drivers, so that it can be
+    exercised on the host (see tools/streamsim.c).
+
+ !!!Usage
+
+    -# Initialize an AUDDSpeakerStream instance with
+       AUDDSpeakerStream_Initialize, giving it a ring of several periods.
+    -# Pass every packet received on the isochronous OUT endpoint to
+       AUDDSpeakerStream_Write.
+    -# Answer the feedback endpoint with the value returned by
+       AUDDSpeakerStream_GetFeedback.
+    -# On the codec side, queue the buffers returned by
+       AUDDSpeakerStream_AcquirePeriod to the DMA, and give each one back with
+       AUDDSpeakerStream_ReleasePeriod once it has been played, from the
+       interrupt that ends its transfer. AUDDSpeakerPlayer does so for the SSC
+       and the AC97C.
+    -# Check the underrun and overrun counters with
+       AUDDSpeakerStream_GetStatistics.
+*/
+
+#ifndef AUDDSPEAKERSTREAM_H
+#define AUDDSPEAKERSTREAM_H
+
+//------------------------------------------------------------------------------
+//         Definitions
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// \page "Audio Stream Feedback"
+///
+/// This page lists the settings of the rate feedback.
+///
+/// !Settings
+/// - AUDDSpeakerStream_FEEDBACKGAIN
+/// - AUDDSpeakerStream_FEEDBACKFILTER
+
+/// Fill level error, in samples, that changes the feedback by one sample per
+/// frame. Larger values react more slowly to drift but with less jitter.
+#ifndef AUDDSpeakerStream_FEEDBACKGAIN
+    #define AUDDSpeakerStream_FEEDBACKGAIN      128
+#endif
+/// Weight of the fill level filter, as a power of two: the level is averaged
+/// over about 2^x packets.
+#ifndef AUDDSpeakerStream_FEEDBACKFILTER
+    #define AUDDSpeakerStream_FEEDBACKFILTER    4
+#endif
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+//         Types
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Counters of an audio stream, returned by AUDDSpeakerStream_GetStatistics.
+//------------------------------------------------------------------------------
+typedef struct {
+
+    /// Number of periods played as silence because the ring was empty.
+    unsigned int underruns;
+    /// Number of packets dropped because the ring was full.
+    unsigned int overruns;
+    /// Number of bytes received from the host.
+    unsigned int bytesIn;
+    /// Number of periods played from the ring.
+    unsigned int periodsOut;
+    /// Current fill level of the ring, in bytes.
+    unsigned int level;
+    /// Lowest fill level seen while playing, in bytes.
+    unsigned int minLevel;
+    /// Highest fill level seen, in bytes.
+    unsigned int maxLevel;
+    /// Last feedback value, in samples per frame (16.16 fixed point).
+    unsigned int feedback;
+
+} AUDDSpeakerStreamStatistics;
+
+//------------------------------------------------------------------------------
+/// Ring buffer and rate feedback state of an audio stream.
+//------------------------------------------------------------------------------
+typedef struct {
+
+    /// Ring buffer, a whole number of periods.
+    unsigned char *pRing;
+    /// Buffer of one period of silence.
+    unsigned char *pSilence;
+    /// Size of the ring in bytes.
+    unsigned int size;
+    /// Size of a period in bytes.
+    unsigned int periodSize;
+    /// Size of one sample on all channels, in bytes.
+    unsigned int sampleSize;
+    /// Nominal rate, in samples per frame (16.16 fixed point).
+    unsigned int nominal;
+    /// Write position, modulo twice the ring size (host side).
+    volatile unsigned int in;
+    /// Position of the next period handed to the codec, modulo twice the
+    /// ring size.
+    volatile unsigned int acquired;
+    /// Position of the oldest period still owned by the codec, modulo twice
+    /// the ring size.
+    volatile unsigned int out;
+    /// Number of periods owned by the codec.
+    volatile unsigned char pending;
+    /// Periods owned by the codec that are silence, one bit per period, the
+    /// oldest first.
+    volatile unsigned char silence;
+    /// Indicates the ring has filled up to the middle and is being played.
+    volatile unsigned char running;
+    /// Fill level averaged over the last packets, in bytes scaled by
+    /// 2^AUDDSpeakerStream_FEEDBACKFILTER.
+    unsigned int filtered;
+    /// Counters.
+    AUDDSpeakerStreamStatistics statistics;
+
+} AUDDSpeakerStream;
+
+//------------------------------------------------------------------------------
+//         Exported functions
+//------------------------------------------------------------------------------
+
+extern void AUDDSpeakerStream_Initialize(AUDDSpeakerStream *pStream,
+                                         unsigned char *pRing,
+                                         unsigned int size,
+                                         unsigned char *pSilence,
+                                         unsigned int periodSize,
+                                         unsigned int sampleSize,
+                                         unsigned int sampleRate);
+
+extern void AUDDSpeakerStream_Reset(AUDDSpeakerStream *pStream);
+
+extern unsigned int AUDDSpeakerStream_Write(AUDDSpeakerStream *pStream,
+                                            const void *pData,
+                                            unsigned int length);
+
+extern void * AUDDSpeakerStream_AcquirePeriod(AUDDSpeakerStream *pStream);
+
+extern void AUDDSpeakerStream_ReleasePeriod(AUDDSpeakerStream *pStream);
+
+extern unsigned int AUDDSpeakerStream_GetLevel(
+    const AUDDSpeakerStream *pStream);
+
+extern unsigned int AUDDSpeakerStream_GetFeedback(AUDDSpeakerStream *pStream,
+                                                  unsigned char highSpeed,
+                                                  unsigned char *pBuffer);
+
+extern void AUDDSpeakerStream_GetStatistics(AUDDSpeakerStream *pStream,
+                                            AUDDSpeakerStreamStatistics *pStatistics);
+
+extern void AUDDSpeakerStream_ResetStatistics(AUDDSpeakerStream *pStream);
+
+#endif //#ifndef AUDDSPEAKERSTREAM_H
+
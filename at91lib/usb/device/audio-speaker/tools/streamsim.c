@@ -0,0 +1,120 @@
+//------------------------------------------------------------------------------
+// Host-side simulation of the audio speaker stream (AUDDSpeakerStream).
+//
+// A simulated host sends one isochronous packet per USB frame, sized from the
+// last feedback value it read, and a simulated codec plays the ring one
+// period at a time with two periods queued to its DMA, as with the SSC PDC.
+// The codec clock runs off the USB frame clock by the given amount, so
+// without feedback the ring slowly drains or fills up.
+//
+// Build and run on the host:
+//
+//   cc -O2 -I.. -o streamsim streamsim.c ../AUDDSpeakerStream.c
+//   ./streamsim [codec ppm] [seconds] [feedback refresh, frames; 0 = none]
+//
+// One line is printed per simulated second with the fill level, the feedback
+// value and the underrun and overrun counters.
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "AUDDSpeakerStream.h"
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Stream format, as in AUDDSpeakerDriver.h.
+#define SAMPLERATE      48000
+#define SAMPLESIZE      4
+/// One period is 1ms of audio.
+#define PERIODSIZE      (SAMPLERATE / 1000 * SAMPLESIZE)
+/// Ring of eight periods.
+#define RINGSIZE        (8 * PERIODSIZE)
+/// Largest packet the host may send, one sample more than nominal.
+#define MAXPACKETSIZE   (PERIODSIZE + SAMPLESIZE)
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+static AUDDSpeakerStream stream;
+static unsigned char ring[RINGSIZE];
+static unsigned char silence[PERIODSIZE];
+static unsigned char packet[MAXPACKETSIZE];
+
+//------------------------------------------------------------------------------
+//         Main function
+//------------------------------------------------------------------------------
+
+int main(int argc, char **argv)
+{
+    double ppm = (argc > 1) ? atof(argv[1]) : 200.0;
+    int seconds = (argc > 2) ? atoi(argv[2]) : 30;
+    int refresh = (argc > 3) ? atoi(argv[3]) : 8;
+    // Length of a codec period, in USB frames
+    double period = 1.0 / (1.0 + ppm / 1000000.0);
+    double nextPeriod = period;
+    unsigned int feedback;
+    unsigned int accumulator = 0;
+    unsigned char buffer[4];
+    AUDDSpeakerStreamStatistics statistics;
+    long frame;
+
+    AUDDSpeakerStream_Initialize(&stream, ring, RINGSIZE, silence,
+                                 PERIODSIZE, SAMPLESIZE, SAMPLERATE);
+    feedback = stream.nominal;
+
+    // The codec starts with two periods queued
+    AUDDSpeakerStream_AcquirePeriod(&stream);
+    AUDDSpeakerStream_AcquirePeriod(&stream);
+
+    printf("codec %+.0f ppm, feedback %s\n", ppm,
+           refresh ? "on" : "off");
+    printf("  time  level  min  max  feedback  underruns  overruns\n");
+
+    for (frame = 1; frame <= (long) seconds * 1000; frame++) {
+
+        unsigned int samples;
+
+        // Host: one packet per frame, at the rate of the last feedback
+        if (refresh && (frame % refresh) == 0) {
+
+            // Full speed feedback, 10.14 on 3 bytes
+            AUDDSpeakerStream_GetFeedback(&stream, 0, buffer);
+            feedback = (buffer[0] | (buffer[1] << 8) | (buffer[2] << 16)) << 2;
+        }
+        accumulator += feedback;
+        samples = accumulator >> 16;
+        accumulator &= 0xFFFF;
+        if (samples * SAMPLESIZE > MAXPACKETSIZE) {
+
+            samples = MAXPACKETSIZE / SAMPLESIZE;
+        }
+        AUDDSpeakerStream_Write(&stream, packet, samples * SAMPLESIZE);
+
+        // Codec: every period that ended during this frame
+        while (nextPeriod <= frame) {
+
+            AUDDSpeakerStream_ReleasePeriod(&stream);
+            AUDDSpeakerStream_AcquirePeriod(&stream);
+            nextPeriod += period;
+        }
+
+        if ((frame % 1000) == 0) {
+
+            AUDDSpeakerStream_GetStatistics(&stream, &statistics);
+            printf("%5lds  %5u %4u %4u  %8.4f  %9u  %8u\n",
+                   frame / 1000,
+                   statistics.level,
+                   statistics.minLevel,
+                   statistics.maxLevel,
+                   statistics.feedback / 65536.0,
+                   statistics.underruns,
+                   statistics.overruns);
+            stream.statistics.minLevel = stream.size;
+            stream.statistics.maxLevel = 0;
+        }
+    }
+    return 0;
+}
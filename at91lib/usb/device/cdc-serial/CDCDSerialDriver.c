@@ -261,6 +261,53 @@ unsigned char CDCDSerialDriver_Write(void *data,
                       argument);
 }
 
+//------------------------------------------------------------------------------
+/// Queues a receive buffer on the virtual COM port. This function behaves
+/// like USBD_QueueRead: several buffers can be queued, and they are filled
+/// one after the other without waiting for the application.
+/// \param data Pointer to the data buffer to put received data.
+/// \param size Size of the data buffer in bytes.
+/// \param callback Optional callback function to invoke when the buffer
+///                 has been filled or a short packet has been received.
+/// \param argument Optional argument to the callback function.
+/// \return USBD_STATUS_SUCCESS if the buffer has been queued; otherwise, the
+///         corresponding error code.
+//------------------------------------------------------------------------------
+unsigned char CDCDSerialDriver_QueueRead(void *data,
+                                         unsigned int size,
+                                         TransferCallback callback,
+                                         void *argument)
+{
+    return USBD_QueueRead(CDCDSerialDriverDescriptors_DATAOUT,
+                          data,
+                          size,
+                          callback,
+                          argument);
+}
+
+//------------------------------------------------------------------------------
+/// Queues a data buffer to send through the virtual COM port. This function
+/// behaves like USBD_QueueWrite: queued buffers are sent back to back.
+/// \param data Pointer to the data buffer to send.
+/// \param size Size of the data buffer in bytes.
+/// \param callback Optional callback function to invoke when the transfer
+///                 finishes.
+/// \param argument Optional argument to the callback function.
+/// \return USBD_STATUS_SUCCESS if the buffer has been queued; otherwise, the
+///         corresponding error code.
+//------------------------------------------------------------------------------
+unsigned char CDCDSerialDriver_QueueWrite(void *data,
+                                          unsigned int size,
+                                          TransferCallback callback,
+                                          void *argument)
+{
+    return USBD_QueueWrite(CDCDSerialDriverDescriptors_DATAIN,
+                           data,
+                           size,
+                           callback,
+                           argument);
+}
+
 //------------------------------------------------------------------------------
 /// Returns the current status of the RS-232 line.
 //------------------------------------------------------------------------------
@@ -44,6 +44,9 @@
  -# Logically connect the device to the host using USBD_Connect.
  -# Send serial data to the USB host using CDCDSerialDriver_Write.
  -# Receive serial data from the USB host using CDCDSerialDriver_Read.
+ -# For sustained transfers, queue several buffers with
+    CDCDSerialDriver_QueueWrite and CDCDSerialDriver_QueueRead; the queued
+    buffers are processed back to back by the DMA.
 */
 
 #ifndef CDCDSERIALDRIVER_H
@@ -109,6 +112,18 @@ extern unsigned char CDCDSerialDriver_Read(
     TransferCallback callback,
     void *argument);
 
+extern unsigned char CDCDSerialDriver_QueueWrite(
+    void *data,
+    unsigned int size,
+    TransferCallback callback,
+    void *argument);
+
+extern unsigned char CDCDSerialDriver_QueueRead(
+    void *data,
+    unsigned int size,
+    TransferCallback callback,
+    void *argument);
+
 extern unsigned short CDCDSerialDriver_GetSerialState();
 
 extern void CDCDSerialDriver_SetSerialState(unsigned short serialState);
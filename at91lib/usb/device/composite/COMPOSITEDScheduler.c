@@ -0,0 +1,192 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2008, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+//-----------------------------------------------------------------------------
+//      Headers
+//-----------------------------------------------------------------------------
+
+#include "COMPOSITEDScheduler.h"
+#include <utility/assert.h>
+
+//-----------------------------------------------------------------------------
+//         Internal variables
+//-----------------------------------------------------------------------------
+
+/// Registered functions, by decreasing priority.
+static COMPOSITEDFunction *pFunctions = 0;
+
+/// Priority of the function being run by COMPOSITEDScheduler_Step().
+static signed short runningPriority = COMPOSITEDScheduler_IDLE;
+
+//-----------------------------------------------------------------------------
+//      Exported functions
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+/// Registers a function. It starts signaled, so that it runs once to start
+/// its work.
+/// \param pFunction  Function instance.
+/// \param run  Run method.
+/// \param pArgument  Argument of the run method.
+/// \param priority  Functions of higher priority run first.
+/// \param share  Consecutive steps among the functions of the same priority.
+//-----------------------------------------------------------------------------
+void COMPOSITEDScheduler_Add(COMPOSITEDFunction *pFunction,
+                             COMPOSITEDRunMethod run,
+                             void *pArgument,
+                             unsigned char priority,
+                             unsigned char share)
+{
+    COMPOSITEDFunction **ppLink = &pFunctions;
+
+    SANITY_CHECK(pFunction && run);
+
+    pFunction->run = run;
+    pFunction->pArgument = pArgument;
+    pFunction->priority = priority;
+    pFunction->share = (share > 0) ? share : 1;
+    pFunction->credit = pFunction->share;
+    pFunction->signaled = 1;
+    pFunction->wakeUp = 0;
+    pFunction->pTask = 0;
+
+    // After the functions of the same priority, which take turns in the
+    // order they were registered
+    while (*ppLink && ((*ppLink)->priority >= priority)) {
+
+        ppLink = &((*ppLink)->pNext);
+    }
+    pFunction->pNext = *ppLink;
+    *ppLink = pFunction;
+}
+
+//-----------------------------------------------------------------------------
+/// Indicates a function has work to do. Can be called from an interrupt
+/// handler.
+/// \param pFunction  Function instance.
+//-----------------------------------------------------------------------------
+void COMPOSITEDScheduler_Signal(COMPOSITEDFunction *pFunction)
+{
+    pFunction->signaled = 1;
+    if (pFunction->wakeUp) {
+
+        pFunction->wakeUp(pFunction);
+    }
+}
+
+//-----------------------------------------------------------------------------
+/// Runs one step of a function, regardless of its priority. Used by the
+/// task running the function under an RTOS.
+/// \param pFunction  Function instance.
+/// \return 1 if the function is still signaled, 0 otherwise.
+//-----------------------------------------------------------------------------
+unsigned char COMPOSITEDScheduler_Step(COMPOSITEDFunction *pFunction)
+{
+    signed short previous = runningPriority;
+
+    // A signal raised while the function runs is not lost
+    pFunction->signaled = 0;
+    runningPriority = pFunction->priority;
+    if (pFunction->run(pFunction->pArgument)) {
+
+        pFunction->signaled = 1;
+    }
+    runningPriority = previous;
+
+    return pFunction->signaled;
+}
+
+//-----------------------------------------------------------------------------
+/// Runs one step of the signaled function of highest priority, if its
+/// priority is above the given one. Among the functions of that priority,
+/// each one runs its share of steps in turn.
+/// \param priority  Priority the function must exceed.
+/// \return 1 if a function ran, 0 otherwise.
+//-----------------------------------------------------------------------------
+unsigned char COMPOSITEDScheduler_RunAbove(signed short priority)
+{
+    COMPOSITEDFunction *pGroup = pFunctions;
+    COMPOSITEDFunction *pFunction;
+    COMPOSITEDFunction *pSelected;
+
+    while (pGroup && (pGroup->priority > priority)) {
+
+        // First signaled function of the group with steps left in its turn,
+        // or the first signaled one when all turns are over
+        pSelected = 0;
+        for (pFunction = pGroup;
+             pFunction && (pFunction->priority == pGroup->priority);
+             pFunction = pFunction->pNext) {
+
+            if (pFunction->signaled) {
+
+                if (pFunction->credit > 0) {
+
+                    pSelected = pFunction;
+                    break;
+                }
+                if (!pSelected) {
+
+                    pSelected = pFunction;
+                }
+            }
+        }
+
+        if (pSelected) {
+
+            // New turn for the whole group
+            if (pSelected->credit == 0) {
+
+                for (pFunction = pGroup;
+                     pFunction && (pFunction->priority == pGroup->priority);
+                     pFunction = pFunction->pNext) {
+
+                    pFunction->credit = pFunction->share;
+                }
+            }
+            pSelected->credit--;
+            COMPOSITEDScheduler_Step(pSelected);
+            return 1;
+        }
+        pGroup = pFunction;
+    }
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+/// Runs one step of the signaled function of highest priority. To be called
+/// from the main loop; when called from the run method of a function, e.g.
+/// while waiting for a media, only the functions of higher priority run.
+/// \return 1 if a function ran, 0 if none is signaled.
+//-----------------------------------------------------------------------------
+unsigned char COMPOSITEDScheduler_Run(void)
+{
+    return COMPOSITEDScheduler_RunAbove(runningPriority);
+}
@@ -0,0 +1,126 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2008, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+//-----------------------------------------------------------------------------
+/// \unit
+///
+/// !Purpose
+///
+/// Event driven scheduling of the functions of a composite device, with
+/// priorities and shares.
+///
+/// Each function (the MSD state machine, or the application code serving a
+/// CDC port or a HID interface) is described by a COMPOSITEDFunction whose run
+/// method performs one step of its work. A function runs when it has been
+/// signaled, typically from the completion callback of its USB transfers, and
+/// stays signaled as long as its run method returns 1. The signaled function
+/// of highest priority runs first; functions of the same priority take turns,
+/// each running up to its share of consecutive steps. A long step can let
+/// more urgent functions progress by calling COMPOSITEDScheduler_RunAbove()
+/// with its own priority, which is what preemption gives under an RTOS.
+///
+/// !Usage
+///
+/// -# Register the functions with COMPOSITEDScheduler_Add(), before the USB
+///    device is connected. MSDDFunctionDriver_Initialize() registers the mass
+///    storage function with MSDDFunctionDriver_PRIORITY and
+///    MSDDFunctionDriver_SHARE.
+/// -# Call COMPOSITEDScheduler_Signal() when a function has work to do. It
+///    can be called from the interrupt handlers.
+/// -# Call COMPOSITEDScheduler_Run() from the main loop, instead of polling
+///    the state machines of the functions. Under FreeRTOS, create one task
+///    per function with xCompositeTaskCreate() (freertos/usb) instead.
+//-----------------------------------------------------------------------------
+
+#ifndef COMPOSITEDSCHEDULER_H
+#define COMPOSITEDSCHEDULER_H
+
+//-----------------------------------------------------------------------------
+//         Definitions
+//-----------------------------------------------------------------------------
+
+/// Priority of a scheduler not running any function.
+#define COMPOSITEDScheduler_IDLE        (-1)
+
+//-----------------------------------------------------------------------------
+//         Types
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+/// Performs one step of the work of a function. Returns 1 if the function
+/// should run again, 0 if it waits for its next signal.
+//-----------------------------------------------------------------------------
+typedef unsigned char (*COMPOSITEDRunMethod)(void *pArgument);
+
+//-----------------------------------------------------------------------------
+/// Function of a composite device, as seen by the scheduler.
+//-----------------------------------------------------------------------------
+typedef struct _COMPOSITEDFunction {
+
+    /// Run method and its argument.
+    COMPOSITEDRunMethod run;
+    void *pArgument;
+    /// Functions of higher priority run first.
+    unsigned char priority;
+    /// Number of consecutive steps when functions of the same priority are
+    /// signaled, at least 1.
+    unsigned char share;
+    /// Set when the function has work to do.
+    volatile unsigned char signaled;
+    /// Steps left in the current turn.
+    unsigned char credit;
+    /// Invoked by COMPOSITEDScheduler_Signal() when not null, to wake up the
+    /// task running the function under an RTOS.
+    void (*wakeUp)(struct _COMPOSITEDFunction *pFunction);
+    /// Data of the RTOS task running the function.
+    void *pTask;
+    /// Next registered function.
+    struct _COMPOSITEDFunction *pNext;
+
+} COMPOSITEDFunction;
+
+//-----------------------------------------------------------------------------
+//         Exported functions
+//-----------------------------------------------------------------------------
+
+extern void COMPOSITEDScheduler_Add(COMPOSITEDFunction *pFunction,
+                                    COMPOSITEDRunMethod run,
+                                    void *pArgument,
+                                    unsigned char priority,
+                                    unsigned char share);
+
+extern void COMPOSITEDScheduler_Signal(COMPOSITEDFunction *pFunction);
+
+extern unsigned char COMPOSITEDScheduler_Step(COMPOSITEDFunction *pFunction);
+
+extern unsigned char COMPOSITEDScheduler_RunAbove(signed short priority);
+
+extern unsigned char COMPOSITEDScheduler_Run(void);
+
+#endif //#ifndef COMPOSITEDSCHEDULER_H
@@ -34,6 +34,7 @@
 // GENERAL
 #include <utility/trace.h>
 #include <utility/assert.h>
+#include <string.h>
 // USB
 #include <usb/common/core/USBGenericRequest.h>
 #include <usb/common/core/USBFeatureRequest.h>
@@ -42,6 +43,7 @@
 // MSD
 #include <usb/device/massstorage/SBCMethods.h>
 #include <usb/device/massstorage/MSDDStateMachine.h>
+#include "MSDDFunctionDriver.h"
 #include "MSDDFunctionDriverDescriptors.h"
 
 //-----------------------------------------------------------------------------
@@ -61,9 +63,27 @@ typedef struct {
     unsigned char bulkInEndpoint;
     /// Interrupt OUT endpoint address
     unsigned char bulkOutEndpoint;
+    /// Scheduling of the state machine
+    COMPOSITEDFunction function;
 
 } MSDFunctionDriver;
 
+/// State of the MSD driver that a step of the state machine changes when it
+/// makes progress.
+typedef struct {
+
+    unsigned int length;
+    unsigned int inputTotal;
+    unsigned int outputTotal;
+    unsigned short semaphore;
+    unsigned short diskSemaphore;
+    unsigned char state;
+    unsigned char commandState;
+    unsigned char inputState;
+    unsigned char outputState;
+
+} MSDProgress;
+
 //-----------------------------------------------------------------------------
 //         Internal variables
 //-----------------------------------------------------------------------------
@@ -90,6 +110,50 @@ static void MSDD_Reset()
     msdDriver.commandState.state = 0;
 }
 
+//-----------------------------------------------------------------------------
+/// Takes a snapshot of the progress of the MSD driver.
+/// \param pProgress  Snapshot to fill.
+//-----------------------------------------------------------------------------
+static void MSDD_GetProgress(MSDProgress *pProgress)
+{
+    MSDCommandState *commandState = &(msdDriver.commandState);
+    unsigned char lun = commandState->cbw.bCBWLUN;
+
+    memset(pProgress, 0, sizeof(MSDProgress));
+    pProgress->length = commandState->length;
+    pProgress->semaphore = commandState->transfer.semaphore;
+    pProgress->diskSemaphore = commandState->disktransfer.semaphore;
+    pProgress->state = msdDriver.state;
+    pProgress->commandState = commandState->state;
+    if (lun <= msdDriver.maxLun) {
+
+        MSDIOFifo *fifo = &(msdDriver.luns[lun].ioFifo);
+
+        pProgress->inputTotal = fifo->inputTotal;
+        pProgress->outputTotal = fifo->outputTotal;
+        pProgress->inputState = fifo->inputState;
+        pProgress->outputState = fifo->outputState;
+    }
+}
+
+//-----------------------------------------------------------------------------
+/// Run method of the MSD function: one step of the state machine.
+/// \return 1 to run again, 0 when the step made no progress: the state
+///         machine then waits for the end of a transfer, or for a request of
+///         the host, which signal the function.
+//-----------------------------------------------------------------------------
+static unsigned char MSDD_Run(void *pArgument)
+{
+    MSDProgress before;
+    MSDProgress after;
+
+    MSDD_GetProgress(&before);
+    MSDD_StateMachine(&msdDriver);
+    MSDD_GetProgress(&after);
+
+    return (memcmp(&before, &after, sizeof(MSDProgress)) != 0);
+}
+
 //-----------------------------------------------------------------------------
 //      Exported functions
 //-----------------------------------------------------------------------------
@@ -128,6 +192,21 @@ void MSDDFunctionDriver_Initialize(USBDDriver * pUsbdDriver,
 
     // Reset BOT driver
     MSDD_Reset();
+
+    // Scheduling
+    COMPOSITEDScheduler_Add(&(msdFunDriver.function),
+                            MSDD_Run,
+                            0,
+                            MSDDFunctionDriver_PRIORITY,
+                            MSDDFunctionDriver_SHARE);
+}
+
+//-----------------------------------------------------------------------------
+/// Returns the MSD function, as registered in the composite scheduler.
+//-----------------------------------------------------------------------------
+COMPOSITEDFunction * MSDDFunctionDriver_GetFunction(void)
+{
+    return &(msdFunDriver.function);
 }
 
 //-----------------------------------------------------------------------------
@@ -139,6 +218,9 @@ void MSDDFunctionDriver_Initialize(USBDDriver * pUsbdDriver,
 unsigned char MSDDFunctionDriver_RequestHandler(
     const USBGenericRequest *request)
 {
+    // A halt may be cleared or the transport reset
+    COMPOSITEDScheduler_Signal(&(msdFunDriver.function));
+
     // Handle requests
     switch (USBGenericRequest_GetRequest(request)) {
     //---------------------
@@ -241,6 +323,7 @@ void MSDDFunctionCallbacks_ConfigurationChanged(unsigned char cfgnum)
 
         MSDD_Reset();
     }
+    COMPOSITEDScheduler_Signal(&(msdFunDriver.function));
 }
 
 //-----------------------------------------------------------------------------
@@ -319,7 +402,17 @@ unsigned int MSDD_IsHalted(void)
 }
 
 //-----------------------------------------------------------------------------
-/// State machine for the MSD driver
+/// Invoked at the end of a USB or media transfer of the state machine,
+/// possibly from an interrupt handler. Signals the MSD function.
+//-----------------------------------------------------------------------------
+void MSDD_TransferDone(void)
+{
+    COMPOSITEDScheduler_Signal(&(msdFunDriver.function));
+}
+
+//-----------------------------------------------------------------------------
+/// State machine for the MSD driver, polled from the main loop. Not to be
+/// used with COMPOSITEDScheduler_Run(), which runs it when needed.
 //-----------------------------------------------------------------------------
 void MSDDriver_StateMachine(void)
 {
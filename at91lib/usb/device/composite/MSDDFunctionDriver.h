@@ -34,7 +34,16 @@
 /// Mass storage function driver implementation.
 /// 
 /// !Usage
-/// TODO
+///
+/// -# Initialize the function with MSDDFunctionDriver_Initialize(). The
+///    state machine is registered in the composite scheduler with
+///    MSDDFunctionDriver_PRIORITY and MSDDFunctionDriver_SHARE.
+/// -# Either call COMPOSITEDScheduler_Run() from the main loop (or run the
+///    function returned by MSDDFunctionDriver_GetFunction() in its own RTOS
+///    task), or poll MSDDriver_StateMachine() from the main loop as before.
+///    With the scheduler, long media operations should call
+///    COMPOSITEDScheduler_Run() while they wait, so that the functions of
+///    higher priority are served.
 //-----------------------------------------------------------------------------
 
 #ifndef MSDDFUNCTIONDRIVER_H
@@ -48,6 +57,23 @@
 #include <usb/device/core/USBDDriver.h>
 #include <usb/device/massstorage/MSD.h>
 #include <usb/device/massstorage/MSDLun.h>
+#include "COMPOSITEDScheduler.h"
+
+//-----------------------------------------------------------------------------
+//         Definitions
+//-----------------------------------------------------------------------------
+
+#ifndef MSDDFunctionDriver_PRIORITY
+/// Scheduling priority of the MSD function. The functions with lower latency
+/// needs, such as CDC or HID, should have a higher one.
+#define MSDDFunctionDriver_PRIORITY     0
+#endif
+
+#ifndef MSDDFunctionDriver_SHARE
+/// Consecutive steps of the MSD state machine among the functions of the same
+/// priority.
+#define MSDDFunctionDriver_SHARE        4
+#endif
 
 //-----------------------------------------------------------------------------
 //      Exported functions
@@ -65,6 +91,8 @@ extern unsigned char MSDDFunctionDriver_RequestHandler(
 
 extern void MSDDFunctionCallbacks_ConfigurationChanged(unsigned char cfgnum);
 
+extern COMPOSITEDFunction * MSDDFunctionDriver_GetFunction(void);
+
 //- MSD APIs
 extern void MSDDriver_StateMachine(void);
 
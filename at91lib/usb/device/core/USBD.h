@@ -139,6 +139,31 @@ typedef void (*TransferCallback)(void *pArg,
                                  unsigned int transferred,
                                  unsigned int remaining);
 
+//------------------------------------------------------------------------------
+/// Activity counters of an endpoint, returned by USBD_GetEndpointStatistics().
+//------------------------------------------------------------------------------
+typedef struct {
+
+    /// Number of transfers currently queued, including the one in progress.
+    unsigned char queueDepth;
+    /// Highest number of transfers queued at the same time.
+    unsigned char maxQueueDepth;
+    /// Number of transfers completed successfully.
+    unsigned int transfers;
+    /// Number of bytes transferred by the successful transfers.
+    unsigned int bytes;
+    /// Number of submissions refused because the queue was full.
+    unsigned int queueFull;
+    /// Number of times the DMA channel ran out of linked descriptors while
+    /// transfers were still queued, leaving a gap on the bus.
+    unsigned int underruns;
+    /// Number of STALL handshakes sent by the endpoint.
+    unsigned int stalls;
+    /// Number of times the endpoint was halted.
+    unsigned int halts;
+
+} USBDEndpointStatistics;
+
 //------------------------------------------------------------------------------
 //         Exported functions
 //------------------------------------------------------------------------------
@@ -167,6 +192,26 @@ extern char USBD_Read(
     TransferCallback fCallback,
     void *pArg);
 
+extern char USBD_QueueWrite(
+    unsigned char bEndpoint,
+    const void *pData,
+    unsigned int dLength,
+    TransferCallback fCallback,
+    void *pArg);
+
+extern char USBD_QueueRead(
+    unsigned char bEndpoint,
+    void *pData,
+    unsigned int dLength,
+    TransferCallback fCallback,
+    void *pArg);
+
+extern void USBD_GetEndpointStatistics(
+    unsigned char bEndpoint,
+    USBDEndpointStatistics *pStatistics);
+
+extern void USBD_ResetEndpointStatistics(unsigned char bEndpoint);
+
 extern unsigned char USBD_Stall(unsigned char bEndpoint);
 
 extern void USBD_Halt(unsigned char bEndpoint);
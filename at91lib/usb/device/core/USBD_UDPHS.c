@@ -44,6 +44,18 @@
 
 #include <stdio.h>
 
+/// Compile option, runs the UDPHS interrupt processing, callbacks included,
+/// in a bottom half scheduled with utility/defer.h. UDPD_IrqHandler() then
+/// only masks the UDPHS interrupt until the bottom half has run.
+#if !defined(USBD_DEFERRED)
+#define USBD_DEFERRED         0
+#endif
+
+#if (USBD_DEFERRED == 1)
+#include <irq/irq.h>
+#include <utility/defer.h>
+#endif
+
 #ifdef BOARD_USB_UDPHS
 
 //------------------------------------------------------------------------------
@@ -69,6 +81,17 @@
 
 #define EPT_VIRTUAL_SIZE      16384
 
+/// Priority of the bottom half of the UDPHS interrupt.
+#if !defined(USBD_DEFER_PRIORITY)
+#define USBD_DEFER_PRIORITY   2
+#endif
+
+/// Number of transfers that can be queued on an endpoint with USBD_QueueWrite()
+/// or USBD_QueueRead(), including the one in progress.
+#if !defined(USBD_QUEUE_DEPTH)
+#define USBD_QUEUE_DEPTH      4
+#endif
+
 //------------------------------------------------------------------------------
 /// \page "Endpoint states"
 /// This page lists the endpoint states.
@@ -78,6 +101,7 @@
 //  - UDP_ENDPOINT_IDLE
 //  - UDP_ENDPOINT_SENDING
 //  - UDP_ENDPOINT_RECEIVING
+//  - UDP_ENDPOINT_QUEUED
 
 /// Endpoint states: Endpoint is disabled
 #define UDP_ENDPOINT_DISABLED       0
@@ -89,6 +113,8 @@
 #define UDP_ENDPOINT_SENDING        3
 /// Endpoint states: Endpoint is receiving data
 #define UDP_ENDPOINT_RECEIVING      4
+/// Endpoint states: Endpoint is processing queued transfers
+#define UDP_ENDPOINT_QUEUED         5
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
@@ -113,6 +139,34 @@ typedef struct
     void             *pArgument;
 } Transfer;
 
+/// Describes a transfer submitted with USBD_QueueWrite() or USBD_QueueRead().
+typedef struct
+{
+    /// Pointer to the data buffer.
+    char             *pData;
+    /// Size of the transfer in bytes.
+    unsigned int     length;
+    /// Optional callback to invoke when the transfer completes.
+    TransferCallback fCallback;
+    /// Optional argument to the callback function.
+    void             *pArgument;
+} QueuedTransfer;
+
+/// UDPHS DMA transfer descriptor. When LDNXT_DSC is set in its control word,
+/// the DMA channel loads the next descriptor into its registers as soon as
+/// the current buffer ends, without software intervention.
+typedef struct
+{
+    /// Address of the next descriptor (UDPHS_DMANXTDSC).
+    unsigned int nextDescriptor;
+    /// Address of the buffer (UDPHS_DMAADDRESS).
+    unsigned int address;
+    /// Channel control word (UDPHS_DMACONTROL).
+    unsigned int control;
+    /// Pads the descriptor to 16 bytes, the alignment required by the DMA.
+    unsigned int reserved;
+} DmaDescriptor;
+
 //------------------------------------------------------------------------------
 /// Describes the state of an endpoint of the UDP controller.
 //------------------------------------------------------------------------------
@@ -129,6 +183,14 @@ typedef struct
     Transfer       transfer;
     /// Special case for send a ZLP
     unsigned char  sendZLP;
+    /// Index in queue[] of the oldest queued transfer.
+    unsigned char  queueHead;
+    /// Number of queued transfers, including the one in progress.
+    volatile unsigned char queueCount;
+    /// Transfers queued in <UDP_ENDPOINT_QUEUED> state.
+    QueuedTransfer queue[USBD_QUEUE_DEPTH];
+    /// Activity counters.
+    USBDEndpointStatistics statistics;
 } Endpoint;
 
 //------------------------------------------------------------------------------
@@ -137,6 +199,9 @@ typedef struct
 
 /// Holds the internal state for each endpoint of the UDP.
 static Endpoint      endpoints[BOARD_USB_NUMENDPOINTS];
+/// DMA descriptors of the queued transfers, one per queue entry.
+static DmaDescriptor dmaDescriptors[BOARD_USB_NUMENDPOINTS][USBD_QUEUE_DEPTH]
+    __attribute__((aligned(16)));
 /// Device current state.
 static unsigned char deviceState;
 /// Indicates the previous device state
@@ -156,6 +221,11 @@ static const char test_packet_buffer[] = {
 // Force HS
 static const unsigned char forceUsbFS = 0;
 
+#if (USBD_DEFERRED == 1)
+/// Bottom half of the UDPHS interrupt.
+static DeferredWork bottomHalf;
+#endif
+
 //------------------------------------------------------------------------------
 //      Internal Functions
 //------------------------------------------------------------------------------
@@ -210,6 +280,79 @@ static inline void UDPHS_DisableUsbClock( void )
 #endif
 }
 
+//------------------------------------------------------------------------------
+/// Masks interrupts while the transfer queue of an endpoint is updated, since
+/// it is shared between the application and the UDPHS interrupt.
+/// \return Previous interrupt mask, to be given to UDPHS_Unlock()
+//------------------------------------------------------------------------------
+static inline unsigned int UDPHS_Lock( void )
+{
+    unsigned int primask = 0;
+
+    // Host builds (tools/usbsim) never preempt the application
+#if defined(__arm__)
+    __asm volatile ("mrs %0, primask\n\t"
+                    "cpsid i" : "=r" (primask) :: "memory");
+#endif
+    return primask;
+}
+
+//------------------------------------------------------------------------------
+/// Restores the interrupt mask saved by UDPHS_Lock()
+/// \param primask Previous interrupt mask
+//------------------------------------------------------------------------------
+static inline void UDPHS_Unlock( unsigned int primask )
+{
+#if defined(__arm__)
+    __asm volatile ("msr primask, %0" :: "r" (primask) : "memory");
+#endif
+}
+
+//------------------------------------------------------------------------------
+/// Stops the DMA channel of an endpoint in Queued state and aborts all its
+/// queued transfers, invoking their callbacks oldest first.
+/// \param bEndpoint Index of endpoint
+/// \param bStatus   Status code given to the callbacks
+//------------------------------------------------------------------------------
+static void UDPHS_AbortQueue( unsigned char bEndpoint, char bStatus )
+{
+    Endpoint       *pEndpoint = &(endpoints[bEndpoint]);
+    QueuedTransfer aborted[USBD_QUEUE_DEPTH];
+    unsigned char  numAborted = 0;
+    unsigned char  i;
+    unsigned int   primask;
+
+    TRACE_DEBUG_WP("AbortQ%d ", bEndpoint);
+
+    primask = UDPHS_Lock();
+
+    AT91C_BASE_UDPHS->UDPHS_DMA[bEndpoint].UDPHS_DMACONTROL = 0; // STOP command
+    AT91C_BASE_UDPHS->UDPHS_IEN &= ~(1 << SHIFT_DMA << bEndpoint);
+
+    // Empty the queue before invoking the callbacks, which may submit new
+    // transfers
+    while (pEndpoint->queueCount > 0) {
+
+        aborted[numAborted++] = pEndpoint->queue[pEndpoint->queueHead];
+        pEndpoint->queueHead = (pEndpoint->queueHead + 1) % USBD_QUEUE_DEPTH;
+        pEndpoint->queueCount--;
+    }
+    pEndpoint->state = UDP_ENDPOINT_IDLE;
+
+    UDPHS_Unlock(primask);
+
+    for (i = 0; i < numAborted; i++) {
+
+        if (aborted[i].fCallback != 0) {
+
+            aborted[i].fCallback(aborted[i].pArgument,
+                                 bStatus,
+                                 0,
+                                 aborted[i].length);
+        }
+    }
+}
+
 //------------------------------------------------------------------------------
 /// Handles a completed transfer on the given endpoint, invoking the
 /// configured callback if any.
@@ -232,6 +375,12 @@ static void UDPHS_EndOfTransfer( unsigned char bEndpoint, char bStatus )
         // Endpoint returns in Idle state
         pEndpoint->state = UDP_ENDPOINT_IDLE;
 
+        if (bStatus == USBD_STATUS_SUCCESS) {
+
+            pEndpoint->statistics.transfers++;
+            pEndpoint->statistics.bytes += pTransfer->transferred;
+        }
+
         // Invoke callback is present
         if (pTransfer->fCallback != 0) {
 
@@ -245,6 +394,11 @@ static void UDPHS_EndOfTransfer( unsigned char bEndpoint, char bStatus )
             TRACE_DEBUG_WP("No callBack\n\r");
         }
     }
+    // Abort the queued transfers
+    else if (pEndpoint->state == UDP_ENDPOINT_QUEUED) {
+
+        UDPHS_AbortQueue(bEndpoint, bStatus);
+    }
 }
 
 //------------------------------------------------------------------------------
@@ -347,7 +501,8 @@ static void UDPHS_ReadRequest( USBGenericRequest *pRequest )
 }
 
 //------------------------------------------------------------------------------
-/// Reset all endpoint transfer descriptors
+/// Reset all endpoint transfer descriptors, aborting the transfers in progress
+/// with USBD_STATUS_RESET
 //------------------------------------------------------------------------------
 static void UDPHS_ResetEndpoints( void )
 {
@@ -361,6 +516,22 @@ static void UDPHS_ResetEndpoints( void )
         pEndpoint = &(endpoints[bEndpoint]);
         pTransfer = &(pEndpoint->transfer);
 
+        // Abort the transfers in progress, stopping their DMA, so that their
+        // callbacks give the buffers back before the descriptors are cleared
+        if( (pEndpoint->state == UDP_ENDPOINT_RECEIVING)
+         || (pEndpoint->state == UDP_ENDPOINT_SENDING) ) {
+
+            if (bEndpoint != 0) {
+
+                AT91C_BASE_UDPHS->UDPHS_DMA[bEndpoint].UDPHS_DMACONTROL = 0; // STOP command
+            }
+            UDPHS_EndOfTransfer(bEndpoint, USBD_STATUS_RESET);
+        }
+        else if (pEndpoint->state == UDP_ENDPOINT_QUEUED) {
+
+            UDPHS_AbortQueue(bEndpoint, USBD_STATUS_RESET);
+        }
+
         // Reset endpoint transfer descriptor
         pTransfer->pData = 0;
         pTransfer->transferred = -1;
@@ -374,6 +545,9 @@ static void UDPHS_ResetEndpoints( void )
         pEndpoint->state = UDP_ENDPOINT_DISABLED;
         // Reset ZLP
         pEndpoint->sendZLP = 0;
+        // Reset queue
+        pEndpoint->queueHead = 0;
+        pEndpoint->queueCount = 0;
     }
 }
 
@@ -536,6 +710,7 @@ static void UDPHS_EndpointHandler( unsigned char bEndpoint )
     if( AT91C_UDPHS_STALL_SNT == (status & AT91C_UDPHS_STALL_SNT) ) {
 
         TRACE_WARNING( "Sta 0x%X [%d] ", status, bEndpoint);
+        pEndpoint->statistics.stalls++;
 
         // Acknowledge the stall flag
         AT91C_BASE_UDPHS->UDPHS_EPT[bEndpoint].UDPHS_EPTCLRSTA = AT91C_UDPHS_STALL_SNT;
@@ -578,6 +753,187 @@ static void UDPHS_EndpointHandler( unsigned char bEndpoint )
 //      Interrupt service routine
 //------------------------------------------------------------------------------
 #ifdef DMA
+//------------------------------------------------------------------------------
+/// Indicates if an endpoint is configured in the IN direction.
+/// \param bEndpoint Index of endpoint
+/// \return 1 for an IN endpoint; otherwise 0
+//------------------------------------------------------------------------------
+static inline unsigned char UDPHS_IsInEndpoint( unsigned char bEndpoint )
+{
+    return ((AT91C_BASE_UDPHS->UDPHS_EPT[bEndpoint].UDPHS_EPTCFG
+             & AT91C_UDPHS_EPT_DIR) != 0);
+}
+
+//------------------------------------------------------------------------------
+/// Fills the DMA descriptor of a queued transfer. On an IN endpoint the
+/// descriptor is also linked after the previous queued transfer, so that the
+/// DMA channel loads it as soon as the previous buffer ends. The link is only
+/// followed if the channel has not loaded the previous descriptor yet;
+/// otherwise the channel stops and UDPHS_QueueDmaHandler() restarts it.
+/// OUT transfers are never linked, because the number of bytes received in
+/// a buffer closed by a short packet is lost once the next descriptor is
+/// loaded; they are started one by one from the DMA interrupt instead.
+/// Must be called with the queue locked.
+/// \param bEndpoint Index of endpoint
+/// \param bIndex    Index of the transfer in the queue
+//------------------------------------------------------------------------------
+static void UDPHS_PrepareDescriptor( unsigned char bEndpoint,
+                                     unsigned char bIndex )
+{
+    Endpoint       *pEndpoint = &(endpoints[bEndpoint]);
+    QueuedTransfer *pQueued = &(pEndpoint->queue[bIndex]);
+    DmaDescriptor  *pDescriptor = &(dmaDescriptors[bEndpoint][bIndex]);
+    unsigned char  bPrevious = (bIndex + USBD_QUEUE_DEPTH - 1) % USBD_QUEUE_DEPTH;
+
+    // The next descriptor address always points to the following entry, so
+    // that UDPHS_DMANXTDSC tells which descriptor the channel has loaded
+    pDescriptor->nextDescriptor =
+        (unsigned int) &(dmaDescriptors[bEndpoint][(bIndex + 1) % USBD_QUEUE_DEPTH]);
+    pDescriptor->address = (unsigned int) pQueued->pData;
+
+    if (UDPHS_IsInEndpoint(bEndpoint)) {
+
+        pDescriptor->control = ((pQueued->length << 16) & AT91C_UDPHS_BUFF_COUNT)
+                             | AT91C_UDPHS_END_B_EN
+                             | AT91C_UDPHS_END_BUFFIT
+                             | AT91C_UDPHS_CHANN_ENB;
+
+        // Link the descriptor once it is complete
+        if (pEndpoint->queueCount > 1) {
+
+            __sync_synchronize();
+            dmaDescriptors[bEndpoint][bPrevious].control |= AT91C_UDPHS_LDNXT_DSC;
+        }
+    }
+    else {
+
+        pDescriptor->control = ((pQueued->length << 16) & AT91C_UDPHS_BUFF_COUNT)
+                             | AT91C_UDPHS_END_TR_EN
+                             | AT91C_UDPHS_END_TR_IT
+                             | AT91C_UDPHS_END_B_EN
+                             | AT91C_UDPHS_END_BUFFIT
+                             | AT91C_UDPHS_CHANN_ENB;
+    }
+}
+
+//------------------------------------------------------------------------------
+/// Starts the DMA channel of an endpoint on the oldest queued transfer, by
+/// making it load the corresponding descriptor.
+/// Must be called with the queue locked.
+/// \param bEndpoint Index of endpoint
+//------------------------------------------------------------------------------
+static void UDPHS_StartQueue( unsigned char bEndpoint )
+{
+    Endpoint *pEndpoint = &(endpoints[bEndpoint]);
+
+    __sync_synchronize();
+
+    // Clear unwanted interrupts
+    AT91C_BASE_UDPHS->UDPHS_DMA[bEndpoint].UDPHS_DMASTATUS;
+
+    // Enable DMA endpoint interrupt
+    AT91C_BASE_UDPHS->UDPHS_IEN |= (1 << SHIFT_DMA << bEndpoint);
+
+    // Load the descriptor; it enables the channel
+    AT91C_BASE_UDPHS->UDPHS_DMA[bEndpoint].UDPHS_DMANXTDSC =
+        (unsigned int) &(dmaDescriptors[bEndpoint][pEndpoint->queueHead]);
+    AT91C_BASE_UDPHS->UDPHS_DMA[bEndpoint].UDPHS_DMACONTROL = 0; // raz
+    AT91C_BASE_UDPHS->UDPHS_DMA[bEndpoint].UDPHS_DMACONTROL = AT91C_UDPHS_LDNXT_DSC;
+}
+
+//------------------------------------------------------------------------------
+/// DMA interrupt handler of an endpoint in Queued state. Retires the
+/// transfers the channel has completed, restarts the channel if it stopped
+/// with transfers still queued, then invokes the completion callbacks.
+/// \param bEndpoint Index of endpoint
+//------------------------------------------------------------------------------
+static void UDPHS_QueueDmaHandler( unsigned char bEndpoint )
+{
+    Endpoint       *pEndpoint = &(endpoints[bEndpoint]);
+    QueuedTransfer completed[USBD_QUEUE_DEPTH];
+    unsigned int   transferred[USBD_QUEUE_DEPTH];
+    unsigned char  numCompleted = 0;
+    unsigned char  current;
+    unsigned char  i;
+    unsigned int   status;
+    unsigned int   primask;
+
+    status = AT91C_BASE_UDPHS->UDPHS_DMA[bEndpoint].UDPHS_DMASTATUS;
+    TRACE_DEBUG_WP("DmaQ Ept%d ", bEndpoint);
+
+    primask = UDPHS_Lock();
+
+    if (UDPHS_IsInEndpoint(bEndpoint)) {
+
+        // UDPHS_DMANXTDSC holds the address of the entry following the loaded
+        // descriptor. Every transfer before the loaded one is complete, and so
+        // is the loaded one once the channel has stopped (CHANN_ENB cleared
+        // in the status register).
+        current = (((AT91C_BASE_UDPHS->UDPHS_DMA[bEndpoint].UDPHS_DMANXTDSC
+                     - (unsigned int) &(dmaDescriptors[bEndpoint][0]))
+                    / sizeof(DmaDescriptor)) + USBD_QUEUE_DEPTH - 1) % USBD_QUEUE_DEPTH;
+        numCompleted = (current + USBD_QUEUE_DEPTH - pEndpoint->queueHead) % USBD_QUEUE_DEPTH;
+        if ((status & AT91C_UDPHS_CHANN_ENB) == 0) {
+
+            numCompleted++;
+        }
+        if (numCompleted > pEndpoint->queueCount) {
+
+            numCompleted = pEndpoint->queueCount;
+        }
+        for (i = 0; i < numCompleted; i++) {
+
+            transferred[i] = pEndpoint->queue[(pEndpoint->queueHead + i) % USBD_QUEUE_DEPTH].length;
+        }
+    }
+    else if ((status & (AT91C_UDPHS_END_BF_ST | AT91C_UDPHS_END_TR_ST)) != 0) {
+
+        // BUFF_COUNT holds the number of bytes not received
+        numCompleted = 1;
+        transferred[0] = pEndpoint->queue[pEndpoint->queueHead].length
+                         - ((status & AT91C_UDPHS_BUFF_COUNT) >> 16);
+    }
+
+    for (i = 0; i < numCompleted; i++) {
+
+        completed[i] = pEndpoint->queue[pEndpoint->queueHead];
+        pEndpoint->queueHead = (pEndpoint->queueHead + 1) % USBD_QUEUE_DEPTH;
+        pEndpoint->queueCount--;
+    }
+
+    if (pEndpoint->queueCount == 0) {
+
+        // Endpoint returns in Idle state
+        AT91C_BASE_UDPHS->UDPHS_IEN &= ~(1 << SHIFT_DMA << bEndpoint);
+        pEndpoint->state = UDP_ENDPOINT_IDLE;
+    }
+    else if ((numCompleted > 0) && ((status & AT91C_UDPHS_CHANN_ENB) == 0)) {
+
+        // The channel stopped before reaching the next transfer
+        if (UDPHS_IsInEndpoint(bEndpoint)) {
+
+            pEndpoint->statistics.underruns++;
+        }
+        UDPHS_StartQueue(bEndpoint);
+    }
+
+    UDPHS_Unlock(primask);
+
+    for (i = 0; i < numCompleted; i++) {
+
+        TRACE_DEBUG_WP("EOT ");
+        pEndpoint->statistics.transfers++;
+        pEndpoint->statistics.bytes += transferred[i];
+        if (completed[i].fCallback != 0) {
+
+            completed[i].fCallback(completed[i].pArgument,
+                                   USBD_STATUS_SUCCESS,
+                                   transferred[i],
+                                   completed[i].length - transferred[i]);
+        }
+    }
+}
+
 //----------------------------------------------------------------------------
 /// Endpoint DMA interrupt handler.
 /// This function (ISR) handles dma interrupts
@@ -591,6 +947,13 @@ static void UDPHS_DmaHandler( unsigned char bEndpoint )
     unsigned int  status;
     unsigned char result = USBD_STATUS_SUCCESS;
 
+    // Transfers submitted with USBD_QueueWrite() or USBD_QueueRead()
+    if (pEndpoint->state == UDP_ENDPOINT_QUEUED) {
+
+        UDPHS_QueueDmaHandler(bEndpoint);
+        return;
+    }
+
     status = AT91C_BASE_UDPHS->UDPHS_DMA[bEndpoint].UDPHS_DMASTATUS;
     TRACE_DEBUG_WP("Dma Ept%d ", bEndpoint);
 
@@ -675,17 +1038,12 @@ static void UDPHS_DmaHandler( unsigned char bEndpoint )
 }
 #endif
 
-
 //------------------------------------------------------------------------------
-//      Exported functions
-//------------------------------------------------------------------------------
-
-//------------------------------------------------------------------------------
-/// USB interrupt handler
+/// Processes the pending UDPHS interrupts.
 /// Manages device resume, suspend, end of bus reset. 
 /// Forwards endpoint interrupts to the appropriate handler.
 //------------------------------------------------------------------------------
-void UDPD_IrqHandler(void)
+static void UDPHS_Handler( void )
 {
     unsigned int  status;
     unsigned char numIT;
@@ -863,6 +1221,39 @@ void UDPD_IrqHandler(void)
     }
 }
 
+#if (USBD_DEFERRED == 1)
+//------------------------------------------------------------------------------
+/// Bottom half of the UDPHS interrupt. Processes the interrupts, then unmasks
+/// the UDPHS interrupt; one raised meanwhile is still pending in the NVIC.
+/// \param pArgument Unused
+//------------------------------------------------------------------------------
+static void UDPHS_BottomHalf( void *pArgument )
+{
+    UDPHS_Handler();
+    IRQ_EnableIT(AT91C_ID_UDPHS);
+}
+#endif
+
+
+//------------------------------------------------------------------------------
+//      Exported functions
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// USB interrupt handler
+/// Processes the UDPHS interrupts, or with USBD_DEFERRED, masks the UDPHS
+/// interrupt and schedules its bottom half.
+//------------------------------------------------------------------------------
+void UDPD_IrqHandler(void)
+{
+#if (USBD_DEFERRED == 1)
+    IRQ_DisableIT(AT91C_ID_UDPHS);
+    DEFER_Schedule(&bottomHalf);
+#else
+    UDPHS_Handler();
+#endif
+}
+
 //------------------------------------------------------------------------------
 /// Configure an endpoint with the provided endpoint descriptor
 /// \param pDdescriptor Pointer to the endpoint descriptor
@@ -905,7 +1296,8 @@ void USBD_ConfigureEndpoint(const USBEndpointDescriptor *pDescriptor)
     // Abort the current transfer is the endpoint was configured and in
     // Write or Read state
     if( (pEndpoint->state == UDP_ENDPOINT_RECEIVING)
-     || (pEndpoint->state == UDP_ENDPOINT_SENDING) ) {
+     || (pEndpoint->state == UDP_ENDPOINT_SENDING)
+     || (pEndpoint->state == UDP_ENDPOINT_QUEUED) ) {
 
         UDPHS_EndOfTransfer(bEndpoint, USBD_STATUS_RESET);
     }
@@ -1190,6 +1582,183 @@ char USBD_Read( unsigned char    bEndpoint,
     return USBD_STATUS_SUCCESS;
 }
 
+#ifdef DMA
+//------------------------------------------------------------------------------
+/// Adds a transfer to the queue of a DMA endpoint, starting the DMA channel if
+/// the endpoint was idle.
+/// \param bEndpoint Index of endpoint
+/// \param pData     Data buffer
+/// \param dLength   Data length
+/// \param fCallback Callback to be call when the transfer completes
+/// \param pArgument Callback argument
+/// \param bIn       1 for an IN (write) transfer, 0 for an OUT (read) one
+/// \return USBD_STATUS_SUCCESS, USBD_STATUS_LOCKED or
+/// USBD_STATUS_INVALID_PARAMETER
+//------------------------------------------------------------------------------
+static char UDPHS_Queue( unsigned char    bEndpoint,
+                         void             *pData,
+                         unsigned int     dLength,
+                         TransferCallback fCallback,
+                         void             *pArgument,
+                         unsigned char    bIn )
+{
+    Endpoint       *pEndpoint = &(endpoints[bEndpoint]);
+    QueuedTransfer *pQueued;
+    unsigned char  bIndex;
+    unsigned int   primask;
+    char           result = USBD_STATUS_SUCCESS;
+
+    // Only the non control endpoints with a DMA channel have a queue; the
+    // DMA cannot send a ZLP
+    if( (bEndpoint == 0)
+     || (bEndpoint > NUM_IT_MAX_DMA)
+     || (AT91C_UDPHS_EPT_TYPE_CTL_EPT == (AT91C_UDPHS_EPT_TYPE&(AT91C_BASE_UDPHS->UDPHS_EPT[bEndpoint].UDPHS_EPTCFG)))
+     || (UDPHS_IsInEndpoint(bEndpoint) != bIn)
+     || (dLength == 0)
+     || (dLength > DMA_MAX_FIFO_SIZE) ) {
+
+        return USBD_STATUS_INVALID_PARAMETER;
+    }
+
+    TRACE_DEBUG_WP("Queue%d(%d) ", bEndpoint, dLength);
+
+    primask = UDPHS_Lock();
+
+    if( (pEndpoint->state != UDP_ENDPOINT_IDLE)
+     && (pEndpoint->state != UDP_ENDPOINT_QUEUED) ) {
+
+        result = USBD_STATUS_LOCKED;
+    }
+    else if (pEndpoint->queueCount >= USBD_QUEUE_DEPTH) {
+
+        pEndpoint->statistics.queueFull++;
+        result = USBD_STATUS_LOCKED;
+    }
+    else {
+
+        bIndex = (pEndpoint->queueHead + pEndpoint->queueCount) % USBD_QUEUE_DEPTH;
+        pQueued = &(pEndpoint->queue[bIndex]);
+        pQueued->pData = pData;
+        pQueued->length = dLength;
+        pQueued->fCallback = fCallback;
+        pQueued->pArgument = pArgument;
+        pEndpoint->queueCount++;
+        if (pEndpoint->queueCount > pEndpoint->statistics.maxQueueDepth) {
+
+            pEndpoint->statistics.maxQueueDepth = pEndpoint->queueCount;
+        }
+
+        UDPHS_PrepareDescriptor(bEndpoint, bIndex);
+
+        // Start the channel if the endpoint was idle
+        if (pEndpoint->state == UDP_ENDPOINT_IDLE) {
+
+            pEndpoint->state = UDP_ENDPOINT_QUEUED;
+            UDPHS_StartQueue(bEndpoint);
+        }
+    }
+
+    UDPHS_Unlock(primask);
+
+    return result;
+}
+#endif
+
+//------------------------------------------------------------------------------
+/// Queues a transfer on an IN endpoint which has a DMA channel.
+/// Unlike USBD_Write(), the function can be called while earlier transfers
+/// are still in progress. Queued IN transfers are linked through the DMA
+/// descriptors, so the controller streams them back to back without waiting
+/// for the software; at least two transfers must be queued to keep the bus
+/// busy. Each transfer ends with a short packet if its length is not a
+/// multiple of the endpoint size, and completes with its own callback.
+/// USBD_Write() returns USBD_STATUS_LOCKED until the queue is empty.
+/// \param bEndpoint Index of endpoint
+/// \param *pData    Data to be written, must stay valid until the callback
+/// \param dLength   Data length to be send, from 1 to DMA_MAX_FIFO_SIZE
+/// \param fCallback Callback to be call when the transfer completes
+/// \param *pArgument Callback argument
+/// \return USBD_STATUS_SUCCESS, USBD_STATUS_LOCKED if the endpoint is busy
+/// with USBD_Write(), halted or its queue is full, or
+/// USBD_STATUS_INVALID_PARAMETER
+//------------------------------------------------------------------------------
+char USBD_QueueWrite( unsigned char    bEndpoint,
+                      const void       *pData,
+                      unsigned int     dLength,
+                      TransferCallback fCallback,
+                      void             *pArgument )
+{
+#ifdef DMA
+    return UDPHS_Queue(bEndpoint, (void *) pData, dLength, fCallback, pArgument, 1);
+#else
+    return USBD_STATUS_HW_NOT_SUPPORTED;
+#endif
+}
+
+//------------------------------------------------------------------------------
+/// Queues a transfer on an OUT endpoint which has a DMA channel.
+/// Each transfer completes when its buffer is full or a short packet is
+/// received. OUT transfers are started one after the other from the DMA
+/// interrupt, before the completion callback of the previous one is invoked.
+/// \param bEndpoint Index of endpoint
+/// \param *pData    Data buffer, must stay valid until the callback
+/// \param dLength   Data length to be receive, from 1 to DMA_MAX_FIFO_SIZE
+/// \param fCallback Callback to be call when the transfer completes
+/// \param *pArgument Callback argument
+/// \return USBD_STATUS_SUCCESS, USBD_STATUS_LOCKED if the endpoint is busy
+/// with USBD_Read(), halted or its queue is full, or
+/// USBD_STATUS_INVALID_PARAMETER
+//------------------------------------------------------------------------------
+char USBD_QueueRead( unsigned char    bEndpoint,
+                     void             *pData,
+                     unsigned int     dLength,
+                     TransferCallback fCallback,
+                     void             *pArgument )
+{
+#ifdef DMA
+    return UDPHS_Queue(bEndpoint, pData, dLength, fCallback, pArgument, 0);
+#else
+    return USBD_STATUS_HW_NOT_SUPPORTED;
+#endif
+}
+
+//------------------------------------------------------------------------------
+/// Returns the activity counters of an endpoint.
+/// \param bEndpoint Index of endpoint
+/// \param pStatistics Pointer to the structure to fill
+//------------------------------------------------------------------------------
+void USBD_GetEndpointStatistics( unsigned char bEndpoint,
+                                 USBDEndpointStatistics *pStatistics )
+{
+    Endpoint *pEndpoint = &(endpoints[bEndpoint]);
+    unsigned int primask;
+
+    primask = UDPHS_Lock();
+    *pStatistics = pEndpoint->statistics;
+    pStatistics->queueDepth = pEndpoint->queueCount;
+    UDPHS_Unlock(primask);
+}
+
+//------------------------------------------------------------------------------
+/// Clears the activity counters of an endpoint.
+/// \param bEndpoint Index of endpoint
+//------------------------------------------------------------------------------
+void USBD_ResetEndpointStatistics( unsigned char bEndpoint )
+{
+    Endpoint *pEndpoint = &(endpoints[bEndpoint]);
+    unsigned int primask;
+
+    primask = UDPHS_Lock();
+    pEndpoint->statistics.maxQueueDepth = pEndpoint->queueCount;
+    pEndpoint->statistics.transfers = 0;
+    pEndpoint->statistics.bytes = 0;
+    pEndpoint->statistics.queueFull = 0;
+    pEndpoint->statistics.underruns = 0;
+    pEndpoint->statistics.stalls = 0;
+    pEndpoint->statistics.halts = 0;
+    UDPHS_Unlock(primask);
+}
+
 //------------------------------------------------------------------------------
 /// Put endpoint into Halt state
 /// \param bEndpoint Index of endpoint
@@ -1204,6 +1773,7 @@ void USBD_Halt( unsigned char bEndpoint )
      && (pEndpoint->state != UDP_ENDPOINT_HALTED) ) {
 
         TRACE_INFO("Halt%d ", bEndpoint);
+        pEndpoint->statistics.halts++;
 
         // Abort the current transfer if necessary
         UDPHS_EndOfTransfer(bEndpoint, USBD_STATUS_ABORTED);
@@ -1663,6 +2233,10 @@ void USBD_Init(void)
     // Disable USB clocks
     UDPHS_DisableUsbClock();
 
+#if (USBD_DEFERRED == 1)
+    DEFER_Initialize(&bottomHalf, UDPHS_BottomHalf, 0, USBD_DEFER_PRIORITY);
+#endif
+
     // Configure interrupts
     USBDCallbacks_Initialized();
 }
@@ -35,6 +35,7 @@
 #include "HIDDTransferDriverDesc.h"
 #include <utility/trace.h>
 #include <usb/common/core/USBGetDescriptorRequest.h>
+#include <usb/common/core/USBEndpointDescriptor.h>
 #include <usb/common/hid/HIDGenericDescriptor.h>
 #include <usb/common/hid/HIDDescriptor.h>
 #include <usb/common/hid/HIDGenericRequest.h>
@@ -44,6 +45,18 @@
 
 #include <string.h>
 
+//------------------------------------------------------------------------------
+//         Internal definitions
+//------------------------------------------------------------------------------
+
+/// Number of reports in the IN queue.
+#define INQUEUESIZE \
+    (HIDDTransferDriver_QUEUEDEPTH * HIDDTransferDriver_REPORTSPERPACKET)
+
+#if (HIDDTransferDriver_QUEUEDEPTH & (HIDDTransferDriver_QUEUEDEPTH - 1)) != 0
+#error HIDDTransferDriver_QUEUEDEPTH must be a power of two
+#endif
+
 //------------------------------------------------------------------------------
 //         Internal types
 //------------------------------------------------------------------------------
@@ -58,19 +71,44 @@ typedef struct {
 
     // OUT Report - block input
     unsigned short iReportLen;
-    unsigned char  iReportBuf[HIDDTransferDriver_REPORTSIZE];
+    unsigned char  iReportBuf[HIDDTransferDriver_PACKETSIZE];
     
     // IN Report - block output
     unsigned short oReportLen;
-    unsigned char  oReportBuf[HIDDTransferDriver_REPORTSIZE];
-
-    // Interrupt OUT Data - input
-    /// Input data length
-    unsigned short iLen;
-    /// Input (report) Buffer
-    unsigned char iBuf[HIDDTransferDriver_REPORTSIZE];
-
-    // Nothing more now...
+    unsigned char  oReportBuf[HIDDTransferDriver_PACKETSIZE];
+
+    // Interrupt IN queue - output
+    /// Queued reports, sent in order from inHead. A transaction carries the
+    /// reports which follow each other in the buffer, up to inReportsPerPacket.
+    unsigned char inReports[INQUEUESIZE][HIDDTransferDriver_REPORTSIZE];
+    TransferCallback inCallbacks[INQUEUESIZE];
+    void *inArguments[INQUEUESIZE];
+    /// Free running indexes of the first queued report and of the first free
+    /// slot, only written by the USB interrupt and by
+    /// HIDDTransferDriver_Write respectively.
+    volatile unsigned short inHead;
+    volatile unsigned short inTail;
+    /// Number of reports in the transaction in progress, 0 if none.
+    volatile unsigned char inSending;
+    /// Number of reports fitting in the interrupt IN endpoint.
+    unsigned char inReportsPerPacket;
+
+    // Interrupt OUT queue - input
+    /// Received transactions, read report by report from outHead.
+    unsigned char outPackets[HIDDTransferDriver_QUEUEDEPTH]
+                            [HIDDTransferDriver_PACKETSIZE];
+    unsigned short outLengths[HIDDTransferDriver_QUEUEDEPTH];
+    /// Free running indexes of the first received transaction and of the one
+    /// being received, only written by HIDDTransferDriver_Read and by the USB
+    /// interrupt respectively.
+    volatile unsigned short outHead;
+    volatile unsigned short outTail;
+    /// Number of bytes already read in the first transaction.
+    unsigned short outOffset;
+    /// Whether a transfer is pending on the interrupt OUT endpoint.
+    volatile unsigned char outReceiving;
+    /// Size of the interrupt OUT endpoint.
+    unsigned short outPacketSize;
 
 } HIDDTransferDriver;
 
@@ -95,6 +133,7 @@ static unsigned char HIDDTransferDriver_GetDescriptor(unsigned char type,
                                                       unsigned char length)
 {
     const USBConfigurationDescriptor *pConfiguration;
+    USBGenericDescriptor *pOthers[2];
     HIDDescriptor *hidDescriptor;
 
     switch (type) {
@@ -126,8 +165,8 @@ static unsigned char HIDDTransferDriver_GetDescriptor(unsigned char type,
             }
 
             // Parse the device configuration to get the HID descriptor
-            USBConfigurationDescriptor_Parse(pConfiguration, 0, 0,
-                                     (USBGenericDescriptor **) &hidDescriptor);
+            USBConfigurationDescriptor_Parse(pConfiguration, 0, 0, pOthers);
+            hidDescriptor = (HIDDescriptor *) pOthers[0];
 
             // Adjust length and send HID descriptor
             if (length > sizeof(HIDDescriptor)) {
@@ -175,6 +214,142 @@ static void HIDDTransferDriver_ReportSent(void *pArg,
     USBD_Read(0, 0, 0, 0, 0);
 }
 
+//------------------------------------------------------------------------------
+/// Returns the active configuration descriptor, which depends on the speed.
+//------------------------------------------------------------------------------
+static const USBConfigurationDescriptor *HIDDTransferDriver_GetConfiguration(
+    void)
+{
+    if (USBD_IsHighSpeed()) {
+
+        return hiddTransferDriver.usbdDriver.pDescriptors->pHsConfiguration;
+    }
+    else {
+
+        return hiddTransferDriver.usbdDriver.pDescriptors->pFsConfiguration;
+    }
+}
+
+static void HIDDTransferDriver_DataSent(void *pArg,
+                                        unsigned char status,
+                                        unsigned int transferred,
+                                        unsigned int remaining);
+
+//------------------------------------------------------------------------------
+/// Starts sending the next queued reports on the interrupt IN endpoint, if
+/// any. Must be called while no transaction is in progress.
+//------------------------------------------------------------------------------
+static void HIDDTransferDriver_StartWrite(void)
+{
+    unsigned short count = hiddTransferDriver.inTail - hiddTransferDriver.inHead;
+    unsigned short first = hiddTransferDriver.inHead % INQUEUESIZE;
+
+    if (count == 0) {
+
+        return;
+    }
+
+    // Send the reports which follow each other in the queue, up to the size
+    // of the endpoint
+    if (count > hiddTransferDriver.inReportsPerPacket) {
+
+        count = hiddTransferDriver.inReportsPerPacket;
+    }
+    if (count > INQUEUESIZE - first) {
+
+        count = INQUEUESIZE - first;
+    }
+    hiddTransferDriver.inSending = count;
+    if (USBD_Write(HIDDTransferDriverDescriptors_INTERRUPTIN,
+                   hiddTransferDriver.inReports[first],
+                   count * HIDDTransferDriver_REPORTSIZE,
+                   HIDDTransferDriver_DataSent,
+                   0) != USBD_STATUS_SUCCESS) {
+
+        hiddTransferDriver.inSending = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+/// Callback function when interrupt IN data sent to host. Releases the
+/// reports of the transaction, invokes their callbacks and sends the next
+/// ones.
+/// \param pArg Pointer to additional argument
+/// \param status Result status
+/// \param transferred Number of bytes transferred
+/// \param remaining Number of bytes that are not transferred yet
+//------------------------------------------------------------------------------
+static void HIDDTransferDriver_DataSent(void *pArg,
+                                        unsigned char status,
+                                        unsigned int transferred,
+                                        unsigned int remaining)
+{
+    TransferCallback callbacks[HIDDTransferDriver_REPORTSPERPACKET];
+    void *arguments[HIDDTransferDriver_REPORTSPERPACKET];
+    unsigned char count = hiddTransferDriver.inSending;
+    unsigned short slot;
+    unsigned char i;
+
+    // Release the reports before invoking the callbacks, which may queue new
+    // ones
+    for (i = 0; i < count; i++) {
+
+        slot = (hiddTransferDriver.inHead + i) % INQUEUESIZE;
+        callbacks[i] = hiddTransferDriver.inCallbacks[slot];
+        arguments[i] = hiddTransferDriver.inArguments[slot];
+    }
+    hiddTransferDriver.inHead += count;
+    hiddTransferDriver.inSending = 0;
+
+    for (i = 0; i < count; i++) {
+
+        if (callbacks[i]) {
+
+            callbacks[i](arguments[i],
+                         status,
+                         (status == USBD_STATUS_SUCCESS) ?
+                                HIDDTransferDriver_REPORTSIZE : 0,
+                         0);
+        }
+    }
+
+    // Reports queued while the endpoint is not usable wait for the next write
+    if ((status == USBD_STATUS_SUCCESS) && !hiddTransferDriver.inSending) {
+
+        HIDDTransferDriver_StartWrite();
+    }
+}
+
+static void HIDDTransferDriver_DataReceived(void *pArg,
+                                            unsigned char status,
+                                            unsigned int transferred,
+                                            unsigned int remaining);
+
+//------------------------------------------------------------------------------
+/// Starts receiving a transaction on the interrupt OUT endpoint if the queue
+/// is not full. Otherwise the endpoint NAKs until reports are read.
+//------------------------------------------------------------------------------
+static void HIDDTransferDriver_StartRead(void)
+{
+    unsigned short slot = hiddTransferDriver.outTail
+                          % HIDDTransferDriver_QUEUEDEPTH;
+
+    if ((unsigned short) (hiddTransferDriver.outTail - hiddTransferDriver.outHead)
+        >= HIDDTransferDriver_QUEUEDEPTH) {
+
+        return;
+    }
+    hiddTransferDriver.outReceiving = 1;
+    if (USBD_Read(HIDDTransferDriverDescriptors_INTERRUPTOUT,
+                  hiddTransferDriver.outPackets[slot],
+                  hiddTransferDriver.outPacketSize,
+                  HIDDTransferDriver_DataReceived,
+                  0) != USBD_STATUS_SUCCESS) {
+
+        hiddTransferDriver.outReceiving = 0;
+    }
+}
+
 //------------------------------------------------------------------------------
 /// Callback function when interrupt OUT data received from host
 /// \param pArg Pointer to additional argument
@@ -187,13 +362,20 @@ static void HIDDTransferDriver_DataReceived(void *pArg,
                                             unsigned int transferred,
                                             unsigned int remaining)
 {
-    hiddTransferDriver.iLen = transferred;
+    unsigned short slot = hiddTransferDriver.outTail
+                          % HIDDTransferDriver_QUEUEDEPTH;
+
+    hiddTransferDriver.outReceiving = 0;
+    if (status != USBD_STATUS_SUCCESS) {
 
-    USBD_Read(HIDDTransferDriverDescriptors_INTERRUPTOUT,
-              hiddTransferDriver.iBuf,
-              HIDDTransferDriver_REPORTSIZE,
-              (TransferCallback)HIDDTransferDriver_DataReceived,
-              0);
+        return;
+    }
+    if (transferred > 0) {
+
+        hiddTransferDriver.outLengths[slot] = transferred;
+        hiddTransferDriver.outTail++;
+    }
+    HIDDTransferDriver_StartRead();
 }
 
 //------------------------------------------------------------------------------
@@ -222,14 +404,30 @@ void USBDCallbacks_RequestReceived(const USBGenericRequest *request)
 //------------------------------------------------------------------------------
 void USBDDriverCallbacks_ConfigurationChanged(unsigned char cfgnum)
 {
+    USBEndpointDescriptor *pEndpoints[3];
+    unsigned short size;
+
     if (cfgnum > 0) {
 
-        hiddTransferDriver.iLen = 0;
-        USBD_Read(HIDDTransferDriverDescriptors_INTERRUPTOUT,
-                  hiddTransferDriver.iBuf,
-                  HIDDTransferDriver_REPORTSIZE,
-                  HIDDTransferDriver_DataReceived,
-                  0);
+        // Number of reports per transaction allowed by the endpoints
+        USBConfigurationDescriptor_Parse(HIDDTransferDriver_GetConfiguration(),
+                                         0, pEndpoints, 0);
+        size = USBEndpointDescriptor_GetMaxPacketSize(pEndpoints[0]);
+        hiddTransferDriver.inReportsPerPacket =
+                                        size / HIDDTransferDriver_REPORTSIZE;
+        if (hiddTransferDriver.inReportsPerPacket == 0) {
+
+            hiddTransferDriver.inReportsPerPacket = 1;
+        }
+        hiddTransferDriver.outPacketSize =
+                       USBEndpointDescriptor_GetMaxPacketSize(pEndpoints[1]);
+
+        // Reports queued for a previous configuration are dropped
+        hiddTransferDriver.inHead = hiddTransferDriver.inTail;
+        hiddTransferDriver.inSending = 0;
+        hiddTransferDriver.outTail = hiddTransferDriver.outHead;
+        hiddTransferDriver.outOffset = 0;
+        HIDDTransferDriver_StartRead();
     }
 }
 
@@ -244,6 +442,14 @@ void USBDDriverCallbacks_ConfigurationChanged(unsigned char cfgnum)
 void HIDDTransferDriver_Initialize()
 {
     hiddTransferDriver.iReportLen = 0;
+    hiddTransferDriver.inHead = 0;
+    hiddTransferDriver.inTail = 0;
+    hiddTransferDriver.inSending = 0;
+    hiddTransferDriver.inReportsPerPacket = 1;
+    hiddTransferDriver.outHead = 0;
+    hiddTransferDriver.outTail = 0;
+    hiddTransferDriver.outOffset = 0;
+    hiddTransferDriver.outReceiving = 0;
 
     USBDDriver_Initialize(&(hiddTransferDriver.usbdDriver),
                           &hiddTransferDriverDescriptors,
@@ -292,8 +498,10 @@ void HIDDTransferDriver_RequestHandler(const USBGenericRequest *request)
 
             case HIDGenericRequest_SETREPORT:
 
-                if (length <= HIDDTransferDriver_REPORTSIZE &&
-                    type == HIDReportRequest_OUTPUT) {
+                // The previous report must have been read
+                if (length <= HIDDTransferDriver_PACKETSIZE &&
+                    type == HIDReportRequest_OUTPUT &&
+                    hiddTransferDriver.iReportLen == 0) {
 
                     USBD_Read(0,
                               hiddTransferDriver.iReportBuf,
@@ -309,7 +517,7 @@ void HIDDTransferDriver_RequestHandler(const USBGenericRequest *request)
 
             case HIDGenericRequest_GETREPORT:
 
-                if (length <= HIDDTransferDriver_REPORTSIZE &&
+                if (length <= HIDDTransferDriver_PACKETSIZE &&
                     type == HIDReportRequest_INPUT) {
                     
                     USBD_Write(0,
@@ -353,9 +561,9 @@ unsigned short HIDDTransferDriver_ReadReport(void *pData,
         return hiddTransferDriver.iReportLen;
     }
 
-    if (dLength > HIDDTransferDriver_REPORTSIZE) {
+    if (dLength > HIDDTransferDriver_PACKETSIZE) {
 
-        dLength = HIDDTransferDriver_REPORTSIZE;
+        dLength = HIDDTransferDriver_PACKETSIZE;
     }
     if (dLength > hiddTransferDriver.iReportLen) {
 
@@ -368,30 +576,55 @@ unsigned short HIDDTransferDriver_ReadReport(void *pData,
 }
 
 //------------------------------------------------------------------------------
-/// Try to read request buffer of interrupt OUT EP.
-/// Set pData to 0 to get current data length only.
+/// Try to read the next report received on the interrupt OUT EP.
+/// Set pData to 0 to get the length of the next report only.
 /// \param pData Pointer to data buffer
 /// \param dLength Data buffer length
-/// \return Number of bytes read
+/// \return Number of bytes read, 0 if no report has been received
 //------------------------------------------------------------------------------
 unsigned short HIDDTransferDriver_Read(void *pData,
                                        unsigned int dLength)
 {
+    unsigned short slot = hiddTransferDriver.outHead
+                          % HIDDTransferDriver_QUEUEDEPTH;
+    unsigned short length;
+
+    if (hiddTransferDriver.outHead == hiddTransferDriver.outTail) {
+
+        return 0;
+    }
+
+    // Length of the next report of the transaction
+    length = hiddTransferDriver.outLengths[slot] - hiddTransferDriver.outOffset;
+    if (length > HIDDTransferDriver_REPORTSIZE) {
+
+        length = HIDDTransferDriver_REPORTSIZE;
+    }
     if (pData == 0) {
 
-        return hiddTransferDriver.iLen;
+        return length;
     }
 
-    if (dLength > HIDDTransferDriver_REPORTSIZE) {
+    if (dLength > length) {
 
-        dLength = HIDDTransferDriver_REPORTSIZE;
+        dLength = length;
     }
-    if (dLength > hiddTransferDriver.iLen) {
+    memcpy(pData,
+           &(hiddTransferDriver.outPackets[slot][hiddTransferDriver.outOffset]),
+           dLength);
+
+    // Release the transaction once all its reports are read, and resume the
+    // reception if the queue was full
+    hiddTransferDriver.outOffset += length;
+    if (hiddTransferDriver.outOffset >= hiddTransferDriver.outLengths[slot]) {
+
+        hiddTransferDriver.outOffset = 0;
+        hiddTransferDriver.outHead++;
+        if (!hiddTransferDriver.outReceiving) {
 
-        dLength = hiddTransferDriver.iLen;
+            HIDDTransferDriver_StartRead();
+        }
     }
-    hiddTransferDriver.iLen = 0;
-    memcpy(pData, hiddTransferDriver.iBuf, dLength);
 
     return dLength;
 }
@@ -407,35 +640,61 @@ void HIDDTransferDriver_SetReport(const void *pData,
 {
     if (pData == 0 || dLength == 0)
         return;
-    if (dLength != HIDDTransferDriver_REPORTSIZE) {
-        dLength = HIDDTransferDriver_REPORTSIZE;
+    if (dLength > HIDDTransferDriver_PACKETSIZE) {
+        dLength = HIDDTransferDriver_PACKETSIZE;
     }
     if (hiddTransferDriver.oReportLen) {
         TRACE_INFO("Changing IN report!\n\r");
     }
+    memset(hiddTransferDriver.oReportBuf, 0, HIDDTransferDriver_PACKETSIZE);
     memcpy(hiddTransferDriver.oReportBuf, pData, dLength);
-    hiddTransferDriver.oReportLen = dLength;
+    hiddTransferDriver.oReportLen = HIDDTransferDriver_PACKETSIZE;
 }
 
 //------------------------------------------------------------------------------
-/// Write data through USB interrupt IN EP.
-/// \param pData Pointer to the data sent.
+/// Queues a report to be sent through the USB interrupt IN EP. Reports are
+/// sent in order, as many per transaction as the endpoint allows; a report
+/// shorter than HIDDTransferDriver_REPORTSIZE is padded with zeros.
+/// The function must always be called from the same context, either the main
+/// loop or the transfer callbacks.
+/// \param pData Pointer to the data sent, copied in the queue.
 /// \param dLength The data length.
-/// \param fCallback Callback function invoked when transferring done.
+/// \param fCallback Callback function invoked when the report has been sent.
 /// \param pArg Pointer to additional arguments.
+/// \return USBD_STATUS_SUCCESS, or USBD_STATUS_LOCKED if the queue is full.
 //------------------------------------------------------------------------------
 unsigned char HIDDTransferDriver_Write(const void *pData,
                                        unsigned int dLength,
                                        TransferCallback fCallback,
                                        void *pArg)
 {
-    if (dLength != HIDDTransferDriver_REPORTSIZE) {
+    unsigned short tail = hiddTransferDriver.inTail;
+    unsigned short slot = tail % INQUEUESIZE;
+
+    if ((unsigned short) (tail - hiddTransferDriver.inHead) >= INQUEUESIZE) {
+
+        return USBD_STATUS_LOCKED;
+    }
+    if (dLength > HIDDTransferDriver_REPORTSIZE) {
 
         dLength = HIDDTransferDriver_REPORTSIZE;
     }
-    return USBD_Write(HIDDTransferDriverDescriptors_INTERRUPTIN,
-                      pData, dLength,
-                      fCallback, pArg);
+    memcpy(hiddTransferDriver.inReports[slot], pData, dLength);
+    memset(&(hiddTransferDriver.inReports[slot][dLength]),
+           0,
+           HIDDTransferDriver_REPORTSIZE - dLength);
+    hiddTransferDriver.inCallbacks[slot] = fCallback;
+    hiddTransferDriver.inArguments[slot] = pArg;
+    hiddTransferDriver.inTail = tail + 1;
+
+    // Start sending if the endpoint is idle, the interrupt sends the report
+    // otherwise
+    if (!hiddTransferDriver.inSending) {
+
+        HIDDTransferDriver_StartWrite();
+    }
+
+    return USBD_STATUS_SUCCESS;
 }
 
 //------------------------------------------------------------------------------
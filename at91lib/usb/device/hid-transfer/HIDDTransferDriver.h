@@ -43,8 +43,11 @@
  -# Initialize the driver using HIDDTransferDriver_Initialize. The
     USB driver is automatically initialized by this method.
  -# Call the HIDDTransferDriver_Write method when sendint data to host.
+    Reports are queued and sent one interrupt transaction after the other;
+    HIDDTransferDriver_Write only fails when the queue is full.
  -# Call the HIDDTransferRead, HIDDTransferReadReport when checking and getting
-    received data from host.
+    received data from host. Reports received on the interrupt OUT endpoint
+    are queued until read; the endpoint NAKs while the queue is full.
 */
 
 #ifndef HIDDKEYBOARDDRIVER_H
@@ -54,6 +57,7 @@
 //         Headers
 //------------------------------------------------------------------------------
 
+#include "HIDDTransferDriverDesc.h"
 #include <usb/common/core/USBGenericRequest.h>
 #include <usb/device/core/USBD.h>
 
@@ -61,6 +65,13 @@
 //         Definitions
 //------------------------------------------------------------------------------
 
+#ifndef HIDDTransferDriver_QUEUEDEPTH
+/// Number of interrupt transactions buffered in each direction, a power of
+/// two. The IN queue holds that many times HIDDTransferDriver_REPORTSPERPACKET
+/// reports.
+#define HIDDTransferDriver_QUEUEDEPTH       8
+#endif
+
 //------------------------------------------------------------------------------
 //         Exported functions
 //------------------------------------------------------------------------------
@@ -83,6 +83,17 @@
 /// Returns the minimum between two values.
 #define MIN(a, b)       ((a < b) ? a : b)
 
+/// Report Count item of the input and output reports, which carry up to
+/// HIDDTransferDriver_REPORTSPERPACKET reports.
+#if HIDDTransferDriver_PACKETSIZE > 255
+#define REPORTCOUNT     HIDReport_GLOBAL_REPORTCOUNT + 2, \
+                        (HIDDTransferDriver_PACKETSIZE & 0xFF), \
+                        (HIDDTransferDriver_PACKETSIZE >> 8)
+#else
+#define REPORTCOUNT     HIDReport_GLOBAL_REPORTCOUNT + 1, \
+                        HIDDTransferDriver_PACKETSIZE
+#endif
+
 //------------------------------------------------------------------------------
 //         Internal types
 //------------------------------------------------------------------------------
@@ -145,8 +156,8 @@ static const USBDeviceQualifierDescriptor qualifierDescriptor = {
 };
 #endif
 
-/// Configuration descriptor.
-static const HIDDTransferDriverConfigurationDescriptors configurationDescriptors = {
+/// Full-speed configuration descriptor.
+static const HIDDTransferDriverConfigurationDescriptors configurationDescriptorsFS = {
 
     // Configuration descriptor
     {
@@ -192,8 +203,8 @@ static const HIDDTransferDriverConfigurationDescriptors configurationDescriptors
         MIN(BOARD_USB_ENDPOINTS_MAXPACKETSIZE(
                         HIDDTransferDriverDescriptors_INTERRUPTIN),
             MIN(USBEndpointDescriptor_MAXINTERRUPTSIZE_FS,
-                                   HIDDTransferDriver_REPORTSIZE)),
-        HIDDTransferDriverDescriptors_INTERRUPTIN_POLLING
+                                   HIDDTransferDriver_PACKETSIZE)),
+        HIDDTransferDriverDescriptors_POLLING_FS
     },
     // Interrupt OUT endpoint descriptor
     {
@@ -206,14 +217,14 @@ static const HIDDTransferDriverConfigurationDescriptors configurationDescriptors
         MIN(BOARD_USB_ENDPOINTS_MAXPACKETSIZE(
                         HIDDTransferDriverDescriptors_INTERRUPTOUT),
             MIN(USBEndpointDescriptor_MAXINTERRUPTSIZE_FS,
-                                    HIDDTransferDriver_REPORTSIZE)),
-        HIDDTransferDriverDescriptors_INTERRUPTOUT_POLLING
+                                    HIDDTransferDriver_PACKETSIZE)),
+        HIDDTransferDriverDescriptors_POLLING_FS
     }
 };
 
 #ifdef BOARD_USB_UDPHS
-/// Other-speed configuration descriptor.
-static const HIDDTransferDriverConfigurationDescriptors otherSpeedDescriptors = {
+/// Full-speed other speed configuration descriptor.
+static const HIDDTransferDriverConfigurationDescriptors otherSpeedDescriptorsFS = {
 
     // Configuration descriptor
     {
@@ -259,8 +270,8 @@ static const HIDDTransferDriverConfigurationDescriptors otherSpeedDescriptors =
         MIN(BOARD_USB_ENDPOINTS_MAXPACKETSIZE(
                         HIDDTransferDriverDescriptors_INTERRUPTIN),
             MIN(USBEndpointDescriptor_MAXINTERRUPTSIZE_HS,
-                                    HIDDTransferDriver_REPORTSIZE)),
-        HIDDTransferDriverDescriptors_INTERRUPTIN_POLLING
+                                   HIDDTransferDriver_PACKETSIZE)),
+        HIDDTransferDriverDescriptors_POLLING_HS
     },
     // Interrupt OUT endpoint descriptor
     {
@@ -268,13 +279,145 @@ static const HIDDTransferDriverConfigurationDescriptors otherSpeedDescriptors =
         USBGenericDescriptor_ENDPOINT,
         USBEndpointDescriptor_ADDRESS(
             USBEndpointDescriptor_OUT,
+            HIDDTransferDriverDescriptors_INTERRUPTOUT),
+        USBEndpointDescriptor_INTERRUPT,
+        MIN(BOARD_USB_ENDPOINTS_MAXPACKETSIZE(
+                        HIDDTransferDriverDescriptors_INTERRUPTOUT),
+            MIN(USBEndpointDescriptor_MAXINTERRUPTSIZE_HS,
+                                    HIDDTransferDriver_PACKETSIZE)),
+        HIDDTransferDriverDescriptors_POLLING_HS
+    }
+};
+
+/// High-speed configuration descriptor.
+static const HIDDTransferDriverConfigurationDescriptors configurationDescriptorsHS = {
+
+    // Configuration descriptor
+    {
+        sizeof(USBConfigurationDescriptor),
+        USBGenericDescriptor_CONFIGURATION,
+        sizeof(HIDDTransferDriverConfigurationDescriptors),
+        1, // One interface in this configuration
+        1, // This is configuration #1
+        0, // No associated string descriptor
+        BOARD_USB_BMATTRIBUTES,
+        USBConfigurationDescriptor_POWER(100)
+    },
+    // Interface descriptor
+    {
+        sizeof(USBInterfaceDescriptor),
+        USBGenericDescriptor_INTERFACE,
+        0, // This is interface #0
+        0, // This is alternate setting #0
+        2, // Two endpoints used
+        HIDInterfaceDescriptor_CLASS,
+        HIDInterfaceDescriptor_SUBCLASS_NONE,
+        HIDInterfaceDescriptor_PROTOCOL_NONE,
+        0  // No associated string descriptor
+    },
+    // HID descriptor
+    {
+        sizeof(HIDDescriptor),
+        HIDGenericDescriptor_HID,
+        HIDDescriptor_HID1_11,
+        0, // Device is not localized, no country code
+        1, // One HID-specific descriptor (apart from this one)
+        HIDGenericDescriptor_REPORT,
+        HIDDTransferDriverDescriptors_REPORTSIZE
+    },
+    // Interrupt IN endpoint descriptor
+    {
+        sizeof(USBEndpointDescriptor),
+        USBGenericDescriptor_ENDPOINT,
+        USBEndpointDescriptor_ADDRESS(
+            USBEndpointDescriptor_IN,
             HIDDTransferDriverDescriptors_INTERRUPTIN),
         USBEndpointDescriptor_INTERRUPT,
+        MIN(BOARD_USB_ENDPOINTS_MAXPACKETSIZE(
+                        HIDDTransferDriverDescriptors_INTERRUPTIN),
+            MIN(USBEndpointDescriptor_MAXINTERRUPTSIZE_HS,
+                                   HIDDTransferDriver_PACKETSIZE)),
+        HIDDTransferDriverDescriptors_POLLING_HS
+    },
+    // Interrupt OUT endpoint descriptor
+    {
+        sizeof(USBEndpointDescriptor),
+        USBGenericDescriptor_ENDPOINT,
+        USBEndpointDescriptor_ADDRESS(
+            USBEndpointDescriptor_OUT,
+            HIDDTransferDriverDescriptors_INTERRUPTOUT),
+        USBEndpointDescriptor_INTERRUPT,
         MIN(BOARD_USB_ENDPOINTS_MAXPACKETSIZE(
                         HIDDTransferDriverDescriptors_INTERRUPTOUT),
             MIN(USBEndpointDescriptor_MAXINTERRUPTSIZE_HS,
-                                    HIDDTransferDriver_REPORTSIZE)),
-        HIDDTransferDriverDescriptors_INTERRUPTIN_POLLING
+                                    HIDDTransferDriver_PACKETSIZE)),
+        HIDDTransferDriverDescriptors_POLLING_HS
+    }
+};
+
+/// High-speed other speed configuration descriptor.
+static const HIDDTransferDriverConfigurationDescriptors otherSpeedDescriptorsHS = {
+
+    // Configuration descriptor
+    {
+        sizeof(USBConfigurationDescriptor),
+        USBGenericDescriptor_OTHERSPEEDCONFIGURATION,
+        sizeof(HIDDTransferDriverConfigurationDescriptors),
+        1, // One interface in this configuration
+        1, // This is configuration #1
+        0, // No associated string descriptor
+        BOARD_USB_BMATTRIBUTES,
+        USBConfigurationDescriptor_POWER(100)
+    },
+    // Interface descriptor
+    {
+        sizeof(USBInterfaceDescriptor),
+        USBGenericDescriptor_INTERFACE,
+        0, // This is interface #0
+        0, // This is alternate setting #0
+        2, // Two endpoints used
+        HIDInterfaceDescriptor_CLASS,
+        HIDInterfaceDescriptor_SUBCLASS_NONE,
+        HIDInterfaceDescriptor_PROTOCOL_NONE,
+        0  // No associated string descriptor
+    },
+    // HID descriptor
+    {
+        sizeof(HIDDescriptor),
+        HIDGenericDescriptor_HID,
+        HIDDescriptor_HID1_11,
+        0, // Device is not localized, no country code
+        1, // One HID-specific descriptor (apart from this one)
+        HIDGenericDescriptor_REPORT,
+        HIDDTransferDriverDescriptors_REPORTSIZE
+    },
+    // Interrupt IN endpoint descriptor
+    {
+        sizeof(USBEndpointDescriptor),
+        USBGenericDescriptor_ENDPOINT,
+        USBEndpointDescriptor_ADDRESS(
+            USBEndpointDescriptor_IN,
+            HIDDTransferDriverDescriptors_INTERRUPTIN),
+        USBEndpointDescriptor_INTERRUPT,
+        MIN(BOARD_USB_ENDPOINTS_MAXPACKETSIZE(
+                        HIDDTransferDriverDescriptors_INTERRUPTIN),
+            MIN(USBEndpointDescriptor_MAXINTERRUPTSIZE_FS,
+                                   HIDDTransferDriver_PACKETSIZE)),
+        HIDDTransferDriverDescriptors_POLLING_FS
+    },
+    // Interrupt OUT endpoint descriptor
+    {
+        sizeof(USBEndpointDescriptor),
+        USBGenericDescriptor_ENDPOINT,
+        USBEndpointDescriptor_ADDRESS(
+            USBEndpointDescriptor_OUT,
+            HIDDTransferDriverDescriptors_INTERRUPTOUT),
+        USBEndpointDescriptor_INTERRUPT,
+        MIN(BOARD_USB_ENDPOINTS_MAXPACKETSIZE(
+                        HIDDTransferDriverDescriptors_INTERRUPTOUT),
+            MIN(USBEndpointDescriptor_MAXINTERRUPTSIZE_FS,
+                                    HIDDTransferDriver_PACKETSIZE)),
+        HIDDTransferDriverDescriptors_POLLING_FS
     }
 };
 #endif
@@ -368,14 +511,14 @@ static const unsigned char *stringDescriptors[] = {
 USBDDriverDescriptors hiddTransferDriverDescriptors = {
 
     &deviceDescriptor,
-    (USBConfigurationDescriptor *) &configurationDescriptors,
+    (USBConfigurationDescriptor *) &configurationDescriptorsFS,
 #ifdef BOARD_USB_UDPHS
     &qualifierDescriptor,
-    (USBConfigurationDescriptor *) &otherSpeedDescriptors,
+    (USBConfigurationDescriptor *) &otherSpeedDescriptorsFS,
     &deviceDescriptor,
-    (USBConfigurationDescriptor *) &configurationDescriptors,
+    (USBConfigurationDescriptor *) &configurationDescriptorsHS,
     &qualifierDescriptor,
-    (USBConfigurationDescriptor *) &otherSpeedDescriptors,
+    (USBConfigurationDescriptor *) &otherSpeedDescriptorsHS,
 #else
     0, // No full-speed device qualifier descriptor
     0, // No full-speed other speed configuration
@@ -398,7 +541,7 @@ const unsigned char hiddReportDescriptor[] = {
     HIDReport_COLLECTION + 1, HIDReport_COLLECTION_APPLICATION,
         // Input report: Vendor-defined
         HIDReport_LOCAL_USAGE + 1, 0xFF, // Vendor-defined usage
-        HIDReport_GLOBAL_REPORTCOUNT + 1, HIDDTransferDriver_REPORTSIZE,
+        REPORTCOUNT,
         HIDReport_GLOBAL_REPORTSIZE + 1, 8,
         HIDReport_GLOBAL_LOGICALMINIMUM + 1, (unsigned char) -128,
         HIDReport_GLOBAL_LOGICALMAXIMUM + 1, (unsigned char)  127,
@@ -406,7 +549,7 @@ const unsigned char hiddReportDescriptor[] = {
 
         // Output report: vendor-defined
         HIDReport_LOCAL_USAGE + 1, 0xFF, // Vendor-defined usage
-        HIDReport_GLOBAL_REPORTCOUNT + 1, HIDDTransferDriver_REPORTSIZE,
+        REPORTCOUNT,
         HIDReport_GLOBAL_REPORTSIZE + 1, 8,
         HIDReport_GLOBAL_LOGICALMINIMUM + 1, (unsigned char) -128,
         HIDReport_GLOBAL_LOGICALMAXIMUM + 1, (unsigned char)  127,
@@ -58,19 +58,54 @@
 
 /// Interrupt IN endpoint number.
 #define HIDDTransferDriverDescriptors_INTERRUPTIN           1
-/// Polling rate in ms
-#define HIDDTransferDriverDescriptors_INTERRUPTIN_POLLING   50
-/// Interrupt IN endpoint polling rate (in milliseconds).
+/// Interrupt OUT endpoint number.
 #define HIDDTransferDriverDescriptors_INTERRUPTOUT          2
-/// Polling rate in ms
-#define HIDDTransferDriverDescriptors_INTERRUPTOUT_POLLING  50
 
-/// Size of the report descriptor in bytes.
-#define HIDDTransferDriverDescriptors_REPORTSIZE        32
+//------------------------------------------------------------------------------
+/// \page "HID Transfer Polling Intervals"
+/// bInterval of the interrupt endpoints. At full speed it is the polling
+/// period in ms; at high speed the period is 2^(bInterval-1) microframes of
+/// 125 us. The defaults poll every frame at full speed and every microframe
+/// at high speed.
+///
+/// !Intervals
+/// - HIDDTransferDriverDescriptors_POLLING_FS
+/// - HIDDTransferDriverDescriptors_POLLING_HS
+
+#ifndef HIDDTransferDriverDescriptors_POLLING_FS
+/// Full-speed polling interval, 1 ms.
+#define HIDDTransferDriverDescriptors_POLLING_FS            1
+#endif
+#ifndef HIDDTransferDriverDescriptors_POLLING_HS
+/// High-speed polling interval, 125 us.
+#define HIDDTransferDriverDescriptors_POLLING_HS            1
+#endif
+//------------------------------------------------------------------------------
 
 /// Size of the input and output report, in bytes
 #define HIDDTransferDriver_REPORTSIZE               32
 
+#ifndef HIDDTransferDriver_REPORTSPERPACKET
+/// Maximum number of reports carried by one interrupt transaction. When it is
+/// more than 1, the report descriptor declares input and output reports of
+/// that many times HIDDTransferDriver_REPORTSIZE bytes, and a transaction may
+/// carry fewer reports than declared: the host gets the number of reports from
+/// the transaction length. The interrupt endpoints are still limited to 64
+/// bytes at full speed.
+#define HIDDTransferDriver_REPORTSPERPACKET         1
+#endif
+
+/// Size of the largest interrupt transaction, in bytes.
+#define HIDDTransferDriver_PACKETSIZE \
+    (HIDDTransferDriver_REPORTSIZE * HIDDTransferDriver_REPORTSPERPACKET)
+
+/// Size of the report descriptor in bytes.
+#if HIDDTransferDriver_PACKETSIZE > 255
+#define HIDDTransferDriverDescriptors_REPORTSIZE        34
+#else
+#define HIDDTransferDriverDescriptors_REPORTSIZE        32
+#endif
+
 //------------------------------------------------------------------------------
 //         Exported variables
 //------------------------------------------------------------------------------
@@ -212,6 +212,28 @@ typedef struct {
 
 } MSDDriver;
 
+//-----------------------------------------------------------------------------
+//      Driver functions
+//-----------------------------------------------------------------------------
+//- MSD General support function
+extern char MSDD_Read(
+    void* pData,
+    unsigned int dLength,
+    TransferCallback fCallback,
+    void* pArgument);
+
+extern char MSDD_Write(
+    void* pData,
+    unsigned int dLength,
+    TransferCallback fCallback,
+    void* pArgument);
+
+extern void MSDD_Halt(unsigned int stallCase);
+
+extern unsigned int MSDD_IsHalted(void);
+
+extern void MSDD_TransferDone(void);
+
 //-----------------------------------------------------------------------------
 //      Inline functions
 //-----------------------------------------------------------------------------
@@ -232,28 +254,9 @@ static inline void MSDDriver_Callback(MSDTransfer *transfer,
     transfer->status = status;
     transfer->transferred = transferred;
     transfer->remaining = remaining;
+    MSDD_TransferDone();
 }
 
-//-----------------------------------------------------------------------------
-//      Driver functions
-//-----------------------------------------------------------------------------
-//- MSD General support function
-extern char MSDD_Read(
-    void* pData,
-    unsigned int dLength,
-    TransferCallback fCallback,
-    void* pArgument);
-
-extern char MSDD_Write(
-    void* pData,
-    unsigned int dLength,
-    TransferCallback fCallback,
-    void* pArgument);
-
-extern void MSDD_Halt(unsigned int stallCase);
-
-extern unsigned int MSDD_IsHalted(void);
-
 //-----------------------------------------------------------------------------
 //      Exported functions
 //-----------------------------------------------------------------------------
@@ -175,6 +175,14 @@ unsigned int MSDD_IsHalted(void)
     return stallCASE;
 }
 
+//-----------------------------------------------------------------------------
+/// Invoked at the end of a USB or media transfer of the state machine. Nothing
+/// to do, MSDDriver_StateMachine() is polled.
+//-----------------------------------------------------------------------------
+void MSDD_TransferDone(void)
+{
+}
+
 //-----------------------------------------------------------------------------
 //      Exported functions
 //-----------------------------------------------------------------------------
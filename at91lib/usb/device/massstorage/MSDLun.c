@@ -364,3 +364,50 @@ unsigned char LUN_Read(MSDLun        *lun,
 
     return status;
 }
+
+//------------------------------------------------------------------------------
+//! \brief  Tells the media of a LUN that a range of blocks is not used
+//!         anymore (UNMAP). Media without discard support ignore it.
+//! \param  lun          Pointer to a MSDLun instance
+//! \param  blockAddress First block address to discard
+//! \param  length       Number of blocks to discard
+//! \return Operation result code
+//------------------------------------------------------------------------------
+unsigned char LUN_Discard(MSDLun       *lun,
+                          unsigned int blockAddress,
+                          unsigned int length)
+{
+    unsigned char status;
+
+    TRACE_INFO_WP("LUNDiscard(%u) ", blockAddress);
+
+    // Check that the range is inside the LUN
+    if ((length + blockAddress) * lun->blockSize > lun->size) {
+
+        TRACE_WARNING("LUN_Discard: Range too big\n\r");
+        status = USBD_STATUS_ABORTED;
+    }
+    else if (lun->media == 0 || lun->status != LUN_READY) {
+
+        TRACE_WARNING("LUN_Discard: Media not ready\n\r");
+        status = USBD_STATUS_ABORTED;
+    }
+    else if (lun->protected) {
+
+        TRACE_WARNING("LUN_Discard: LUN is readonly\n\r");
+        status = USBD_STATUS_ABORTED;
+    }
+    else if (MED_Discard(lun->media,
+                         lun->baseAddress + blockAddress * lun->blockSize,
+                         length * lun->blockSize) != MED_STATUS_SUCCESS) {
+
+        TRACE_WARNING("LUN_Discard: Cannot discard media\n\r");
+        status = USBD_STATUS_ABORTED;
+    }
+    else {
+
+        status = USBD_STATUS_SUCCESS;
+    }
+
+    return status;
+}
@@ -40,6 +40,7 @@
 /// -# Initlalize the LUN with LUN_Init, and link to the initialized Media.
 /// -# To read data from the LUN linked media, uses LUN_Read.
 /// -# To write data to the LUN linked media, uses LUN_Write.
+/// -# To tell the LUN linked media that data is unused, uses LUN_Discard.
 /// -# To unlink the media, uses LUN_Eject.
 //------------------------------------------------------------------------------
 
@@ -148,5 +149,9 @@ extern unsigned char LUN_Read(MSDLun        *lun,
                               TransferCallback   callback,
                               void         *argument);
 
+extern unsigned char LUN_Discard(MSDLun       *lun,
+                                 unsigned int blockAddress,
+                                 unsigned int length);
+
 #endif //#ifndef MSDLUN_H
 
@@ -71,6 +71,13 @@
 /// - SBC_MODE_SENSE_6
 /// - SBC_VERIFY_10
 /// - SBC_READ_FORMAT_CAPACITIES
+///
+/// !Optional Codes for thin provisioning and large media
+/// - SBC_READ_16
+/// - SBC_WRITE_16
+/// - SBC_SERVICE_ACTION_IN_16
+/// - SBC_UNMAP
+/// - SBC_WRITE_SAME_10
 
 /// Request information regarding parameters of the target and Logical Unit.
 #define SBC_INQUIRY                                     0x12
@@ -94,6 +101,21 @@
 #define SBC_VERIFY_10                                   0x2F
 /// Request a list of the possible capacities that can be formatted on medium
 #define SBC_READ_FORMAT_CAPACITIES                      0x23
+
+/// Request the transfer data to the host (64-bit block address).
+#define SBC_READ_16                                     0x88
+/// Request that the device write the data transferred by the host (64-bit
+/// block address).
+#define SBC_WRITE_16                                    0x8A
+/// Service action commands, including READ CAPACITY (16).
+#define SBC_SERVICE_ACTION_IN_16                        0x9E
+/// Request that the device release blocks it does not need to store.
+#define SBC_UNMAP                                       0x42
+/// Request that the device write one block of data over a range of blocks.
+#define SBC_WRITE_SAME_10                               0x41
+
+/// SBC_SERVICE_ACTION_IN_16 service action: READ CAPACITY (16).
+#define SBC_READ_CAPACITY_16                            0x10
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
@@ -301,6 +323,26 @@
 #define SBC_PAGE_VENDOR_SPECIFIC                      0x00
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+/// \page "SBC VPD Page Codes"
+/// This page lists the vital product data pages returned by an INQUIRY
+/// command with the EVPD bit set.
+/// \see    sbc3r25.pdf - Section 6.5
+/// \see    SBCInquiry
+///
+/// !Codes
+/// - SBC_VPD_SUPPORTED_PAGES
+/// - SBC_VPD_BLOCK_LIMITS
+/// - SBC_VPD_LOGICAL_BLOCK_PROVISIONING
+
+#define SBC_VPD_SUPPORTED_PAGES                       0x00
+#define SBC_VPD_BLOCK_LIMITS                          0xB0
+#define SBC_VPD_LOGICAL_BLOCK_PROVISIONING            0xB2
+
+/// Provisioning type reported in the logical block provisioning page.
+#define SBC_PROVISIONING_TYPE_THIN                    0x02
+//------------------------------------------------------------------------------
+
 //------------------------------------------------------------------------------
 /// \page "MSD Endian Macros"
 /// This page lists the macros for endianness conversion.
@@ -620,6 +662,204 @@ typedef struct {
 
 } __attribute__ ((packed)) SBCReadWriteErrorRecovery; // GCC
 
+//------------------------------------------------------------------------------
+/// \brief  Data structure for the READ (16) command
+/// \see    sbc3r25.pdf - Section 5.15 - Table 50
+//------------------------------------------------------------------------------
+typedef struct {
+
+    unsigned char bOperationCode;          //!< 0x88 : SBC_READ_16
+    unsigned char bReserved1:1,            //!< Reserved bit
+                  isFUA_NV:1,              //!< Cache control bit
+                  bReserved2:1,            //!< Reserved bit
+                  isFUA:1,                 //!< Cache control bit
+                  isDPO:1,                 //!< Cache control bit
+                  bRdProtect:3;            //!< Protection information to send
+    unsigned char pLogicalBlockAddress[8]; //!< Index of first block to read
+    unsigned char pTransferLength[4];      //!< Number of blocks to transmit
+    unsigned char bGroupNumber:5,          //!< Information grouping
+                  bReserved3:3;            //!< Reserved bits
+    unsigned char bControl;                //!< 0x00
+
+} __attribute__ ((packed)) SBCRead16; // GCC
+
+//------------------------------------------------------------------------------
+/// \brief  Structure for the WRITE (16) command
+/// \see    sbc3r25.pdf - Section 5.34 - Table 95
+//------------------------------------------------------------------------------
+typedef struct {
+
+    unsigned char bOperationCode;          //!< 0x8A : SBC_WRITE_16
+    unsigned char bReserved1:1,            //!< Reserved bit
+                  isFUA_NV:1,              //!< Cache control bit
+                  bReserved2:1,            //!< Reserved bit
+                  isFUA:1,                 //!< Cache control bit
+                  isDPO:1,                 //!< Cache control bit
+                  bWrProtect:3;            //!< Protection information to send
+    unsigned char pLogicalBlockAddress[8]; //!< First block to write
+    unsigned char pTransferLength[4];      //!< Number of blocks to write
+    unsigned char bGroupNumber:5,          //!< Information grouping
+                  bReserved3:3;            //!< Reserved bits
+    unsigned char bControl;                //!< 0x00
+
+} __attribute__ ((packed)) SBCWrite16; // GCC
+
+//------------------------------------------------------------------------------
+/// \brief  Structure for the READ CAPACITY (16) command
+/// \see    sbc3r25.pdf - Section 5.16.1 - Table 59
+//------------------------------------------------------------------------------
+typedef struct {
+
+    unsigned char bOperationCode;          //!< 0x9E : SBC_SERVICE_ACTION_IN_16
+    unsigned char bServiceAction:5,        //!< 0x10 : SBC_READ_CAPACITY_16
+                  bReserved1:3;            //!< Reserved bits
+    unsigned char pLogicalBlockAddress[8]; //!< Block to evaluate if PMI is set
+    unsigned char pAllocationLength[4];    //!< Size of host buffer
+    unsigned char isPMI:1,                 //!< Partial medium indicator bit
+                  bReserved2:7;            //!< Reserved bits
+    unsigned char bControl;                //!< 0x00
+
+} __attribute__ ((packed)) SBCReadCapacity16; // GCC
+
+//------------------------------------------------------------------------------
+/// \brief  Data returned by the device after a READ CAPACITY (16) command
+/// \see    sbc3r25.pdf - Section 5.16.2 - Table 60
+//------------------------------------------------------------------------------
+typedef struct {
+
+    unsigned char pLogicalBlockAddress[8]; //!< Address of last logical block
+    unsigned char pLogicalBlockLength[4];  //!< Length of each logical block
+    unsigned char isProtEn:1,              //!< Protection information enabled ?
+                  bProtType:3,             //!< Type of protection
+                  bReserved1:4;            //!< Reserved bits
+    unsigned char bLogicalBlocksPerPhysicalBlockExponent:4, //!< Physical block size
+                  bPInformationIntervalExponent:4;          //!< Protection interval
+    unsigned char bLowestAlignedLogicalBlockAddressHigh:6,  //!< Alignment, MSB
+                  isLBPRZ:1,               //!< Unmapped blocks read as zero ?
+                  isLBPME:1;               //!< Thin provisioning enabled ?
+    unsigned char bLowestAlignedLogicalBlockAddressLow;     //!< Alignment, LSB
+    unsigned char pReserved2[16];          //!< Reserved bytes
+
+} __attribute__ ((packed)) SBCReadCapacity16Data; // GCC
+
+//------------------------------------------------------------------------------
+/// \brief  Structure for the UNMAP command
+/// \see    sbc3r25.pdf - Section 5.28.1 - Table 83
+//------------------------------------------------------------------------------
+typedef struct {
+
+    unsigned char bOperationCode;          //!< 0x42 : SBC_UNMAP
+    unsigned char isAnchor:1,              //!< Anchor the blocks
+                  bReserved1:7;            //!< Reserved bits
+    unsigned char pReserved2[4];           //!< Reserved bytes
+    unsigned char bGroupNumber:5,          //!< Information grouping
+                  bReserved3:3;            //!< Reserved bits
+    unsigned char pParameterListLength[2]; //!< Size of the parameter list
+    unsigned char bControl;                //!< 0x00
+
+} __attribute__ ((packed)) SBCUnmap; // GCC
+
+//------------------------------------------------------------------------------
+/// \brief  Header of the parameter list sent after an UNMAP command
+/// \see    sbc3r25.pdf - Section 5.28.2 - Table 84
+//------------------------------------------------------------------------------
+typedef struct {
+
+    unsigned char pDataLength[2];                //!< Length of data to follow
+    unsigned char pBlockDescriptorDataLength[2]; //!< Length of all descriptors
+    unsigned char pReserved1[4];                 //!< Reserved bytes
+
+} __attribute__ ((packed)) SBCUnmapParameterHeader; // GCC
+
+//------------------------------------------------------------------------------
+/// \brief  Block descriptor of the UNMAP parameter list
+/// \see    sbc3r25.pdf - Section 5.28.2 - Table 85
+//------------------------------------------------------------------------------
+typedef struct {
+
+    unsigned char pLogicalBlockAddress[8]; //!< First block to unmap
+    unsigned char pNumberOfBlocks[4];      //!< Number of blocks to unmap
+    unsigned char pReserved1[4];           //!< Reserved bytes
+
+} __attribute__ ((packed)) SBCUnmapBlockDescriptor; // GCC
+
+//------------------------------------------------------------------------------
+/// \brief  Structure for the WRITE SAME (10) command
+/// \see    sbc3r25.pdf - Section 5.41 - Table 106
+//------------------------------------------------------------------------------
+typedef struct {
+
+    unsigned char bOperationCode;          //!< 0x41 : SBC_WRITE_SAME_10
+    unsigned char bObsolete1:1,            //!< Obsolete bit
+                  bReserved1:2,            //!< Reserved bits
+                  isUnmap:1,               //!< Unmap the blocks if possible
+                  isAnchor:1,              //!< Anchor the blocks
+                  bWrProtect:3;            //!< Protection information to send
+    unsigned char pLogicalBlockAddress[4]; //!< First block to write
+    unsigned char bGroupNumber:5,          //!< Information grouping
+                  bReserved2:3;            //!< Reserved bits
+    unsigned char pNumberOfBlocks[2];      //!< Number of blocks to write
+    unsigned char bControl;                //!< 0x00
+
+} __attribute__ ((packed)) SBCWriteSame10; // GCC
+
+//------------------------------------------------------------------------------
+/// \brief  Header of the vital product data pages
+/// \see    spc4r23.pdf - Section 7.7.1 - Table 466
+//------------------------------------------------------------------------------
+typedef struct {
+
+    unsigned char bPeripheralDeviceType:5, //!< Peripheral device type
+                  bPeripheralQualifier :3; //!< Peripheral qualifier
+    unsigned char bPageCode;               //!< Page returned
+    unsigned char pPageLength[2];          //!< Length of data to follow
+
+} __attribute__ ((packed)) SBCVPDPageHeader; // GCC
+
+//------------------------------------------------------------------------------
+/// \brief  Block limits VPD page
+/// \see    sbc3r25.pdf - Section 6.5.3 - Table 141
+//------------------------------------------------------------------------------
+typedef struct {
+
+    SBCVPDPageHeader header;                          //!< Page 0xB0, length 0x3C
+    unsigned char isWSNZ:1,                           //!< Zero WRITE SAME length refused ?
+                  bReserved1:7;                       //!< Reserved bits
+    unsigned char bMaximumCompareAndWriteLength;      //!< Unsupported (0)
+    unsigned char pOptimalTransferLengthGranularity[2]; //!< Preferred alignment
+    unsigned char pMaximumTransferLength[4];          //!< Largest READ/WRITE
+    unsigned char pOptimalTransferLength[4];          //!< Preferred READ/WRITE size
+    unsigned char pMaximumPrefetchLength[4];          //!< Unsupported (0)
+    unsigned char pMaximumUnmapLbaCount[4];           //!< Blocks per UNMAP command
+    unsigned char pMaximumUnmapBlockDescriptorCount[4]; //!< Descriptors per command
+    unsigned char pOptimalUnmapGranularity[4];        //!< Preferred UNMAP size
+    unsigned char pUnmapGranularityAlignment[4];      //!< Alignment, bit 31 UGAVALID
+    unsigned char pMaximumWriteSameLength[8];         //!< Largest WRITE SAME
+    unsigned char pReserved2[20];                     //!< Reserved bytes
+
+} __attribute__ ((packed)) SBCBlockLimitsPage; // GCC
+
+//------------------------------------------------------------------------------
+/// \brief  Logical block provisioning VPD page
+/// \see    sbc3r25.pdf - Section 6.5.4 - Table 143
+//------------------------------------------------------------------------------
+typedef struct {
+
+    SBCVPDPageHeader header;           //!< Page 0xB2, length 0x04
+    unsigned char bThresholdExponent;  //!< Unsupported (0)
+    unsigned char isDP:1,              //!< Provisioning group descriptor ?
+                  isANC_SUP:1,         //!< Anchored blocks supported ?
+                  isLBPRZ:1,           //!< Unmapped blocks read as zero ?
+                  bReserved1:2,        //!< Reserved bits
+                  isLBPWS10:1,         //!< WRITE SAME (10) can unmap ?
+                  isLBPWS:1,           //!< WRITE SAME (16) can unmap ?
+                  isLBPU:1;            //!< UNMAP supported ?
+    unsigned char bProvisioningType:3, //!< SBC_PROVISIONING_TYPE_THIN
+                  bReserved2:5;        //!< Reserved bits
+    unsigned char bReserved3;          //!< Reserved byte
+
+} __attribute__ ((packed)) SBCLogicalBlockProvisioningPage; // GCC
+
 //------------------------------------------------------------------------------
 /// \brief  Generic structure for holding information about SBC commands
 /// \see    SBCInquiry
@@ -630,6 +870,11 @@ typedef struct {
 /// \see    SBCWrite10
 /// \see    SBCMediumRemoval
 /// \see    SBCModeSense6
+/// \see    SBCRead16
+/// \see    SBCWrite16
+/// \see    SBCReadCapacity16
+/// \see    SBCUnmap
+/// \see    SBCWriteSame10
 //------------------------------------------------------------------------------
 typedef union {
 
@@ -642,6 +887,11 @@ typedef union {
     SBCWrite10        write10;        //!< WRITE (10) command
     SBCMediumRemoval  mediumRemoval;  //!< PREVENT/ALLOW MEDIUM REMOVAL command
     SBCModeSense6     modeSense6;     //!< MODE SENSE (6) command
+    SBCRead16         read16;         //!< READ (16) command
+    SBCWrite16        write16;        //!< WRITE (16) command
+    SBCReadCapacity16 readCapacity16; //!< READ CAPACITY (16) command
+    SBCUnmap          unmap;          //!< UNMAP command
+    SBCWriteSame10    writeSame10;    //!< WRITE SAME (10) command
 
 } SBCCommand;
 
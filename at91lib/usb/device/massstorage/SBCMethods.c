@@ -36,6 +36,7 @@
 #include <usb/device/core/USBD.h>
 
 #include "MSDIOFifo.h"
+#include <string.h>
 
 //------------------------------------------------------------------------------
 //      Global variables
@@ -157,7 +158,188 @@ static unsigned char SBCLunCanBeWritten(MSDLun *lun)
 }
 
 //------------------------------------------------------------------------------
-//! \brief  Performs a WRITE (10) command on the specified LUN.
+//! \brief  Returns the address of a range of blocks of a LUN in the memory
+//!         space, for media that are mapped (Media.mappedRD/mappedWR). The
+//!         USB transfer is then done directly to or from the media.
+//! \param  lun     Pointer to the LUN affected by the command
+//! \param  lba     Logical block address of the first block
+//! \param  length  Length of the range in bytes
+//! \return Address of the first block, or 0 if the range is outside of the
+//!         LUN
+//! \see    MSDLun
+//------------------------------------------------------------------------------
+static void * SBCLunMappedAddress(MSDLun       *lun,
+                                  unsigned int lba,
+                                  unsigned int length)
+{
+    unsigned int numBlocks = length / (lun->blockSize * lun->media->blockSize);
+
+    if ((lba + numBlocks) * lun->blockSize > lun->size) {
+
+        TRACE_WARNING("SBCLunMappedAddress: Out of range %u+%u\n\r",
+                      lba, numBlocks);
+        SBC_UpdateSenseData(&(lun->requestSenseData),
+                            SBC_SENSE_KEY_ILLEGAL_REQUEST,
+                            SBC_ASC_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE,
+                            0);
+        return 0;
+    }
+
+    return (void *) ((lun->media->baseAddress
+                      + lun->baseAddress
+                      + lba * lun->blockSize)
+                     * lun->media->blockSize);
+}
+
+//------------------------------------------------------------------------------
+//! \brief  Returns the low 32 bits of the logical block address of a READ or
+//!         WRITE command, (10) or (16). The address is stored big endian so
+//!         that it can be accessed with DWORDB and updated in place with
+//!         STORE_DWORDB as the transfer progresses.
+//! \param  pCommand  Pointer to the command block
+//! \return Pointer to the last four bytes of the logical block address
+//------------------------------------------------------------------------------
+static unsigned char * SBCLogicalBlockAddress(unsigned char *pCommand)
+{
+    if ((pCommand[0] == SBC_READ_16) || (pCommand[0] == SBC_WRITE_16)) {
+
+        return &(((SBCRead16 *) pCommand)->pLogicalBlockAddress[4]);
+    }
+
+    return ((SBCRead10 *) pCommand)->pLogicalBlockAddress;
+}
+
+//------------------------------------------------------------------------------
+//! \brief  Check that the logical block address of a READ (16) or WRITE (16)
+//!         command fits in 32 bits, as all LUN addresses do.
+//! \param  lun       Pointer to the LUN affected by the command
+//! \param  pCommand  Pointer to the command block
+//! \return 1 if the address is valid
+//! \see    MSDLun
+//------------------------------------------------------------------------------
+static unsigned char SBCLogicalBlockAddressIsValid(MSDLun        *lun,
+                                                   unsigned char *pCommand)
+{
+    unsigned char *pHigh = ((SBCRead16 *) pCommand)->pLogicalBlockAddress;
+
+    if (((pCommand[0] == SBC_READ_16) || (pCommand[0] == SBC_WRITE_16))
+        && (DWORDB(pHigh) != 0)) {
+
+        TRACE_WARNING("SBCLogicalBlockAddressIsValid: 64-bit LBA\n\r");
+        SBC_UpdateSenseData(&(lun->requestSenseData),
+                            SBC_SENSE_KEY_ILLEGAL_REQUEST,
+                            SBC_ASC_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE,
+                            0);
+        return 0;
+    }
+
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+//! \brief  Check that a range of blocks is inside a LUN.
+//! \param  lun          Pointer to the LUN affected by the command
+//! \param  lba          Logical block address of the first block
+//! \param  numBlocks    Number of blocks in the range
+//! \return 1 if the range is valid
+//! \see    MSDLun
+//------------------------------------------------------------------------------
+static unsigned char SBCLunRangeIsValid(MSDLun       *lun,
+                                        unsigned int lba,
+                                        unsigned int numBlocks)
+{
+    unsigned int lunBlocks = lun->size / lun->blockSize;
+
+    if ((numBlocks > lunBlocks) || (lba > lunBlocks - numBlocks)) {
+
+        TRACE_WARNING("SBCLunRangeIsValid: Out of range %u+%u\n\r",
+                      lba, numBlocks);
+        SBC_UpdateSenseData(&(lun->requestSenseData),
+                            SBC_SENSE_KEY_ILLEGAL_REQUEST,
+                            SBC_ASC_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE,
+                            0);
+        return 0;
+    }
+
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+//! \brief  Sends a buffer built by the device to the host, for the commands
+//!         returning data that is not stored in the LUN (VPD pages, READ
+//!         CAPACITY (16)). At most the length requested by the host is sent;
+//!         the rest is reported as residue.
+//!
+//!         This function operates asynchronously and must be called multiple
+//!         times to complete. A result code of MSDD_STATUS_INCOMPLETE
+//!         indicates that at least another call of the method is necessary.
+//! \param  commandState Current state of the command
+//! \param  pData        Data to send
+//! \param  size         Size of the data in bytes
+//! \return Operation result code (SUCCESS, ERROR or INCOMPLETE)
+//! \see    MSDCommandState
+//------------------------------------------------------------------------------
+static unsigned char SBCSendData(MSDCommandState *commandState,
+                                 void            *pData,
+                                 unsigned int    size)
+{
+    unsigned char result = MSDD_STATUS_INCOMPLETE;
+    unsigned char status;
+    MSDTransfer *transfer = &(commandState->transfer);
+
+    switch (commandState->state) {
+    //-------------------
+    case SBC_STATE_WRITE:
+    //-------------------
+        if (size > commandState->length) {
+
+            size = commandState->length;
+        }
+        status = MSDD_Write(pData,
+                            size,
+                            (TransferCallback) MSDDriver_Callback,
+                            (void *) transfer);
+
+        // Check operation result code
+        if (status != USBD_STATUS_SUCCESS) {
+
+            TRACE_WARNING("SBCSendData: Cannot start sending data\n\r");
+            result = MSDD_STATUS_ERROR;
+        }
+        else {
+
+            TRACE_INFO_WP("Sending ");
+            commandState->state = SBC_STATE_WAIT_WRITE;
+        }
+        break;
+
+    //------------------------
+    case SBC_STATE_WAIT_WRITE:
+    //------------------------
+        if (transfer->semaphore > 0) {
+
+            transfer->semaphore--;
+
+            if (transfer->status != USBD_STATUS_SUCCESS) {
+
+                TRACE_WARNING("SBCSendData: Cannot send data\n\r");
+                result = MSDD_STATUS_ERROR;
+            }
+            else {
+
+                TRACE_INFO_WP("Sent ");
+                result = MSDD_STATUS_SUCCESS;
+            }
+            commandState->length -= transfer->transferred;
+        }
+        break;
+    }
+
+    return result;
+}
+
+//------------------------------------------------------------------------------
+//! \brief  Performs a WRITE (10) or WRITE (16) command on the specified LUN.
 //!
 //!         The data to write is first received from the USB host and then
 //!         actually written on the media.
@@ -175,7 +357,7 @@ static unsigned char SBC_Write10(MSDLun          *lun,
 {
     unsigned char status;
     unsigned char result = MSDD_STATUS_INCOMPLETE;
-    SBCRead10 *command = (SBCRead10 *) commandState->cbw.pCommand;
+    unsigned char *pLba = SBCLogicalBlockAddress(commandState->cbw.pCommand);
     MSDTransfer *transfer = &(commandState->transfer);
     MSDTransfer *disktransfer = &(commandState->disktransfer);
     MSDIOFifo   *fifo = &lun->ioFifo;
@@ -186,7 +368,8 @@ static unsigned char SBC_Write10(MSDLun          *lun,
         commandState->state = SBC_STATE_WRITE;
 
         // The command should not be proceeded if READONLY
-        if (!SBCLunCanBeWritten(lun)) {
+        if (!SBCLunCanBeWritten(lun)
+            || !SBCLogicalBlockAddressIsValid(lun, commandState->cbw.pCommand)) {
 
             return MSDD_STATUS_RW;
         }
@@ -258,18 +441,20 @@ static unsigned char SBC_Write10(MSDLun          *lun,
         // Read one block of data sent by the host
         if (lun->media->mappedWR) {
 
-            // Directly read to memory
-            status = MSDD_Read((void*)
-                                ((lun->media->baseAddress
-                                  + (lun->baseAddress
-                                      + DWORDB(command->pLogicalBlockAddress)
-                                        * lun->blockSize
-                                    )
-                                  ) * lun->media->blockSize
-                                ),
-                                fifo->dataTotal,
-                                (TransferCallback) MSDDriver_Callback,
-                                (void *) transfer);
+            void *pMapped = SBCLunMappedAddress(lun,
+                                     DWORDB(pLba),
+                                     fifo->dataTotal);
+            if (pMapped == 0) {
+
+                result = MSDD_STATUS_ERROR;
+                break;
+            }
+
+            // Directly read to memory, in a single USB transfer
+            status = MSDD_Read(pMapped,
+                               fifo->dataTotal,
+                               (TransferCallback) MSDDriver_Callback,
+                               (void *) transfer);
         }
         else {
           #ifdef MSDIO_WRITE10_CHUNK_SIZE
@@ -418,11 +603,11 @@ static unsigned char SBC_Write10(MSDLun          *lun,
         }
         else {
           #ifdef MSDIO_WRITE10_CHUNK_SIZE
-            status = SBC_WRITE_CHUNK(lun, DWORDB(command->pLogicalBlockAddress),
+            status = SBC_WRITE_CHUNK(lun, DWORDB(pLba),
                                      fifo, MSDDriver_Callback, disktransfer);
           #else
             status = LUN_Write(lun,
-                               DWORDB(command->pLogicalBlockAddress),
+                               DWORDB(pLba),
                                &fifo->pBuffer[fifo->outputNdx],
                                1,
                                (TransferCallback) MSDDriver_Callback,
@@ -498,16 +683,16 @@ static unsigned char SBC_Write10(MSDLun          *lun,
 
                 // Update output index
               #ifdef MSDIO_WRITE10_CHUNK_SIZE
-                STORE_DWORDB(DWORDB(command->pLogicalBlockAddress)
+                STORE_DWORDB(DWORDB(pLba)
                                  + fifo->chunkSize/fifo->blockSize,
-                             command->pLogicalBlockAddress);
+                             pLba);
                 MSDIOFifo_IncNdx(fifo->outputNdx,
                                  fifo->chunkSize,
                                  fifo->bufferSize);
                 fifo->outputTotal += fifo->chunkSize;
               #else
-                STORE_DWORDB(DWORDB(command->pLogicalBlockAddress) + 1,
-                             command->pLogicalBlockAddress);
+                STORE_DWORDB(DWORDB(pLba) + 1,
+                             pLba);
                 MSDIOFifo_IncNdx(fifo->outputNdx,
                                  fifo->blockSize,
                                  fifo->bufferSize);
@@ -549,7 +734,7 @@ static unsigned char SBC_Write10(MSDLun          *lun,
 }
 
 //------------------------------------------------------------------------------
-//! \brief  Performs a READ (10) command on specified LUN.
+//! \brief  Performs a READ (10) or READ (16) command on specified LUN.
 //!
 //!         The data is first read from the media and then sent to the USB host.
 //!         This function operates asynchronously and must be called multiple
@@ -566,7 +751,7 @@ static unsigned char SBC_Read10(MSDLun          *lun,
 {
     unsigned char status;
     unsigned char result = MSDD_STATUS_INCOMPLETE;
-    SBCRead10 *command = (SBCRead10 *) commandState->cbw.pCommand;
+    unsigned char *pLba = SBCLogicalBlockAddress(commandState->cbw.pCommand);
     MSDTransfer *transfer = &(commandState->transfer);
     MSDTransfer *disktransfer = &(commandState->disktransfer);
     MSDIOFifo   *fifo = &lun->ioFifo;
@@ -576,7 +761,8 @@ static unsigned char SBC_Read10(MSDLun          *lun,
 
         commandState->state = SBC_STATE_READ;
 
-        if (!SBCLunIsReady(lun)) {
+        if (!SBCLunIsReady(lun)
+            || !SBCLogicalBlockAddressIsValid(lun, commandState->cbw.pCommand)) {
 
             return MSDD_STATUS_RW;
         }
@@ -653,11 +839,11 @@ static unsigned char SBC_Read10(MSDLun          *lun,
         }
         else {
           #ifdef MSDIO_READ10_CHUNK_SIZE
-            status = SBC_READ_CHUNK(lun, DWORDB(command->pLogicalBlockAddress),
+            status = SBC_READ_CHUNK(lun, DWORDB(pLba),
                                     fifo, MSDDriver_Callback, disktransfer);
           #else
             status = LUN_Read(lun,
-                              DWORDB(command->pLogicalBlockAddress),
+                              DWORDB(pLba),
                               &fifo->pBuffer[fifo->inputNdx],
                               1,
                               (TransferCallback) MSDDriver_Callback,
@@ -731,9 +917,9 @@ static unsigned char SBC_Read10(MSDLun          *lun,
 
                 // Update block address
               #ifdef MSDIO_READ10_CHUNK_SIZE
-                STORE_DWORDB(DWORDB(command->pLogicalBlockAddress)
+                STORE_DWORDB(DWORDB(pLba)
                                  + fifo->chunkSize/fifo->blockSize,
-                             command->pLogicalBlockAddress);
+                             pLba);
 
                 // Update input index
                 MSDIOFifo_IncNdx(fifo->inputNdx,
@@ -742,8 +928,8 @@ static unsigned char SBC_Read10(MSDLun          *lun,
                 fifo->inputTotal += fifo->chunkSize;
               #else
                 // Update block address
-                STORE_DWORDB(DWORDB(command->pLogicalBlockAddress) + 1,
-                             command->pLogicalBlockAddress);
+                STORE_DWORDB(DWORDB(pLba) + 1,
+                             pLba);
 
                 // Update input index
                 MSDIOFifo_IncNdx(fifo->inputNdx,
@@ -818,14 +1004,17 @@ static unsigned char SBC_Read10(MSDLun          *lun,
         // Send the block to the host
         if (lun->media->mappedRD) {
 
-            status = MSDD_Write((void*)
-                                 ((lun->media->baseAddress
-                                    + (lun->baseAddress
-                                       + DWORDB(command->pLogicalBlockAddress)
-                                         * lun->blockSize
-                                      )
-                                   ) * lun->media->blockSize
-                                 ),
+            void *pMapped = SBCLunMappedAddress(lun,
+                                     DWORDB(pLba),
+                                     commandState->length);
+            if (pMapped == 0) {
+
+                result = MSDD_STATUS_ERROR;
+                break;
+            }
+
+            // Directly send from memory, in a single USB transfer
+            status = MSDD_Write(pMapped,
                                 commandState->length,
                                 (TransferCallback) MSDDriver_Callback,
                                 (void *) transfer);
@@ -1360,6 +1549,444 @@ static unsigned char SBC_TestUnitReady(MSDLun *lun)
     return result;
 }
 
+//------------------------------------------------------------------------------
+//! \brief  Performs a READ CAPACITY (16) command. The data is built in the
+//!         I/O FIFO of the LUN; LBPME is set when the media can discard
+//!         blocks, so that the host looks for the provisioning VPD pages.
+//!
+//!         This function operates asynchronously and must be called multiple
+//!         times to complete. A result code of MSDD_STATUS_INCOMPLETE
+//!         indicates that at least another call of the method is necessary.
+//! \param  lun          Pointer to the LUN affected by the command
+//! \param  commandState Current state of the command
+//! \return Operation result code (SUCCESS, ERROR, INCOMPLETE or PARAMETER)
+//! \see    MSDLun
+//! \see    MSDCommandState
+//------------------------------------------------------------------------------
+static unsigned char SBC_ReadCapacity16(MSDLun          *lun,
+                                        MSDCommandState *commandState)
+{
+    SBCReadCapacity16Data *data = (SBCReadCapacity16Data *) lun->ioFifo.pBuffer;
+
+    if (!SBCLunIsReady(lun)) {
+
+        TRACE_INFO("SBC_ReadCapacity16: Not Ready!\n\r");
+        return MSDD_STATUS_RW;
+    }
+
+    // Initialize command state if needed
+    if (commandState->state == 0) {
+
+        commandState->state = SBC_STATE_WRITE;
+
+        memset(data, 0, sizeof(SBCReadCapacity16Data));
+        memcpy(&(data->pLogicalBlockAddress[4]),
+               lun->readCapacityData.pLogicalBlockAddress, 4);
+        memcpy(data->pLogicalBlockLength,
+               lun->readCapacityData.pLogicalBlockLength, 4);
+        data->isLBPME = (lun->media->discard != 0);
+    }
+
+    return SBCSendData(commandState, data, sizeof(SBCReadCapacity16Data));
+}
+
+//------------------------------------------------------------------------------
+//! \brief  Handles an INQUIRY command with the EVPD bit set. The supported
+//!         pages, block limits and logical block provisioning pages are
+//!         built in the I/O FIFO of the LUN; other pages are refused.
+//!
+//!         This function operates asynchronously and must be called multiple
+//!         times to complete. A result code of MSDD_STATUS_INCOMPLETE
+//!         indicates that at least another call of the method is necessary.
+//! \param  lun          Pointer to the LUN affected by the command
+//! \param  commandState Current state of the command
+//! \return Operation result code (SUCCESS, ERROR, INCOMPLETE or PARAMETER)
+//! \see    MSDLun
+//! \see    MSDCommandState
+//------------------------------------------------------------------------------
+static unsigned char SBC_InquiryVPD(MSDLun          *lun,
+                                    MSDCommandState *commandState)
+{
+    SBCInquiry *command = (SBCInquiry *) commandState->cbw.pCommand;
+    MSDIOFifo *fifo = &lun->ioFifo;
+    SBCVPDPageHeader *header = (SBCVPDPageHeader *) fifo->pBuffer;
+    SBCBlockLimitsPage *limits = (SBCBlockLimitsPage *) fifo->pBuffer;
+    SBCLogicalBlockProvisioningPage *provisioning =
+        (SBCLogicalBlockProvisioningPage *) fifo->pBuffer;
+    unsigned char canDiscard = (lun->media != 0) && (lun->media->discard != 0);
+    unsigned int size;
+
+    // Check if required length is 0
+    if (commandState->length == 0) {
+
+        return MSDD_STATUS_SUCCESS;
+    }
+
+    // Build the page in the FIFO when the command starts
+    if (commandState->state == 0) {
+
+        commandState->state = SBC_STATE_WRITE;
+
+        memset(fifo->pBuffer, 0, sizeof(SBCBlockLimitsPage));
+        header->bPeripheralDeviceType = lun->inquiryData->bPeripheralDeviceType;
+        header->bPeripheralQualifier = lun->inquiryData->bPeripheralQualifier;
+        header->bPageCode = command->bPageCode;
+
+        switch (command->bPageCode) {
+        //---------------------------
+        case SBC_VPD_SUPPORTED_PAGES:
+        //---------------------------
+            fifo->pBuffer[4] = SBC_VPD_SUPPORTED_PAGES;
+            fifo->pBuffer[5] = SBC_VPD_BLOCK_LIMITS;
+            fifo->pBuffer[6] = SBC_VPD_LOGICAL_BLOCK_PROVISIONING;
+            size = 7;
+            break;
+
+        //------------------------
+        case SBC_VPD_BLOCK_LIMITS:
+        //------------------------
+            limits->isWSNZ = 1;
+            if (canDiscard) {
+
+                STORE_DWORDB(0xFFFFFFFF, limits->pMaximumUnmapLbaCount);
+                STORE_DWORDB((fifo->bufferSize - sizeof(SBCUnmapParameterHeader))
+                                 / sizeof(SBCUnmapBlockDescriptor),
+                             limits->pMaximumUnmapBlockDescriptorCount);
+            }
+            STORE_DWORDB(0xFFFF, (&(limits->pMaximumWriteSameLength[4])));
+            size = sizeof(SBCBlockLimitsPage);
+            break;
+
+        //--------------------------------------
+        case SBC_VPD_LOGICAL_BLOCK_PROVISIONING:
+        //--------------------------------------
+            provisioning->isLBPU = canDiscard;
+            provisioning->isLBPWS10 = canDiscard;
+            provisioning->bProvisioningType = SBC_PROVISIONING_TYPE_THIN;
+            size = sizeof(SBCLogicalBlockProvisioningPage);
+            break;
+
+        //------
+        default:
+        //------
+            TRACE_WARNING("SBC_InquiryVPD: Page %x not supported\n\r",
+                          command->bPageCode);
+            return MSDD_STATUS_PARAMETER;
+        }
+        STORE_WORDB(size - sizeof(SBCVPDPageHeader), header->pPageLength);
+    }
+
+    return SBCSendData(commandState,
+                       fifo->pBuffer,
+                       WORDB(header->pPageLength) + sizeof(SBCVPDPageHeader));
+}
+
+//------------------------------------------------------------------------------
+//! \brief  Performs an UNMAP command on the specified LUN.
+//!
+//!         The parameter list is received from the host in the I/O FIFO of
+//!         the LUN, all its block descriptors are checked, then each range is
+//!         passed to LUN_Discard.
+//!         This function operates asynchronously and must be called multiple
+//!         times to complete. A result code of MSDD_STATUS_INCOMPLETE
+//!         indicates that at least another call of the method is necessary.
+//! \param  lun          Pointer to the LUN affected by the command
+//! \param  commandState Current state of the command
+//! \return Operation result code (SUCCESS, ERROR, INCOMPLETE, PARAMETER or RW)
+//! \see    MSDLun
+//! \see    MSDCommandState
+//------------------------------------------------------------------------------
+static unsigned char SBC_Unmap(MSDLun          *lun,
+                               MSDCommandState *commandState)
+{
+    unsigned char result = MSDD_STATUS_INCOMPLETE;
+    unsigned char status;
+    MSDTransfer *transfer = &(commandState->transfer);
+    MSDIOFifo *fifo = &lun->ioFifo;
+    SBCUnmapParameterHeader *header = (SBCUnmapParameterHeader *) fifo->pBuffer;
+    SBCUnmapBlockDescriptor *descriptors =
+        (SBCUnmapBlockDescriptor *) (fifo->pBuffer
+                                     + sizeof(SBCUnmapParameterHeader));
+    unsigned char *pLba;
+    unsigned int lba;
+    unsigned int numDescriptors;
+    unsigned int i;
+
+    // Initialize command state if needed
+    if (commandState->state == 0) {
+
+        commandState->state = SBC_STATE_READ;
+
+        if (!SBCLunCanBeWritten(lun)) {
+
+            return MSDD_STATUS_RW;
+        }
+        if (commandState->length == 0) {
+
+            // Nothing to unmap
+            return MSDD_STATUS_SUCCESS;
+        }
+        if (commandState->length > fifo->bufferSize) {
+
+            TRACE_WARNING("SBC_Unmap: Parameter list too long\n\r");
+            return MSDD_STATUS_PARAMETER;
+        }
+    }
+
+    switch (commandState->state) {
+    //------------------
+    case SBC_STATE_READ:
+    //------------------
+        // Receive the parameter list
+        status = MSDD_Read(fifo->pBuffer,
+                           commandState->length,
+                           (TransferCallback) MSDDriver_Callback,
+                           (void *) transfer);
+
+        if (status != USBD_STATUS_SUCCESS) {
+
+            TRACE_WARNING("SBC_Unmap: Cannot start receiving data\n\r");
+            result = MSDD_STATUS_ERROR;
+        }
+        else {
+
+            commandState->state = SBC_STATE_WAIT_READ;
+        }
+        break;
+
+    //-----------------------
+    case SBC_STATE_WAIT_READ:
+    //-----------------------
+        if (transfer->semaphore == 0) {
+
+            break;
+        }
+        transfer->semaphore--;
+        commandState->length -= transfer->transferred;
+
+        if (transfer->status != USBD_STATUS_SUCCESS) {
+
+            TRACE_WARNING("SBC_Unmap: Cannot receive data\n\r");
+            result = MSDD_STATUS_ERROR;
+            break;
+        }
+
+        // A list shorter than its header holds no descriptor
+        numDescriptors = 0;
+        if (transfer->transferred >= sizeof(SBCUnmapParameterHeader)) {
+
+            numDescriptors = WORDB(header->pBlockDescriptorDataLength);
+            if (numDescriptors > transfer->transferred
+                                 - sizeof(SBCUnmapParameterHeader)) {
+
+                numDescriptors = transfer->transferred
+                                 - sizeof(SBCUnmapParameterHeader);
+            }
+            numDescriptors /= sizeof(SBCUnmapBlockDescriptor);
+        }
+
+        // Check all ranges before releasing any; 64-bit addresses are
+        // always out of range
+        for (i = 0; i < numDescriptors; i++) {
+
+            pLba = descriptors[i].pLogicalBlockAddress;
+            lba = (DWORDB(pLba) != 0) ? 0xFFFFFFFF : DWORDB((pLba + 4));
+            if (!SBCLunRangeIsValid(lun,
+                                    lba,
+                                    DWORDB(descriptors[i].pNumberOfBlocks))) {
+
+                return MSDD_STATUS_RW;
+            }
+        }
+
+        result = MSDD_STATUS_SUCCESS;
+        for (i = 0; i < numDescriptors; i++) {
+
+            pLba = descriptors[i].pLogicalBlockAddress;
+            if (LUN_Discard(lun,
+                            DWORDB((pLba + 4)),
+                            DWORDB(descriptors[i].pNumberOfBlocks))
+                != USBD_STATUS_SUCCESS) {
+
+                TRACE_WARNING("SBC_Unmap: Discard failed\n\r");
+                result = MSDD_STATUS_ERROR;
+                break;
+            }
+        }
+        break;
+    }
+
+    return result;
+}
+
+//------------------------------------------------------------------------------
+//! \brief  Performs a WRITE SAME (10) command on the specified LUN.
+//!
+//!         The block sent by the host is received in the I/O FIFO of the LUN.
+//!         If the UNMAP bit is set, the media can discard blocks and the block
+//!         is all zeros, the range is discarded instead of written. Otherwise
+//!         the block is written to each address of the range in turn; the
+//!         address and count of the command are updated in place as for a
+//!         WRITE (10).
+//!         This function operates asynchronously and must be called multiple
+//!         times to complete. A result code of MSDD_STATUS_INCOMPLETE
+//!         indicates that at least another call of the method is necessary.
+//! \param  lun          Pointer to the LUN affected by the command
+//! \param  commandState Current state of the command
+//! \return Operation result code (SUCCESS, ERROR, INCOMPLETE, PARAMETER or RW)
+//! \see    MSDLun
+//! \see    MSDCommandState
+//------------------------------------------------------------------------------
+static unsigned char SBC_WriteSame10(MSDLun          *lun,
+                                     MSDCommandState *commandState)
+{
+    unsigned char result = MSDD_STATUS_INCOMPLETE;
+    unsigned char status;
+    SBCWriteSame10 *command = (SBCWriteSame10 *) commandState->cbw.pCommand;
+    MSDTransfer *transfer = &(commandState->transfer);
+    MSDTransfer *disktransfer = &(commandState->disktransfer);
+    MSDIOFifo *fifo = &lun->ioFifo;
+    unsigned int blockSize = lun->blockSize * lun->media->blockSize;
+    unsigned int i;
+
+    // Initialize command state if needed
+    if (commandState->state == 0) {
+
+        commandState->state = SBC_STATE_READ;
+
+        if (!SBCLunCanBeWritten(lun)) {
+
+            return MSDD_STATUS_RW;
+        }
+        if (WORDB(command->pNumberOfBlocks) == 0) {
+
+            // Whole medium not supported (WSNZ)
+            TRACE_WARNING("SBC_WriteSame10: No block count\n\r");
+            return MSDD_STATUS_PARAMETER;
+        }
+        if (!SBCLunRangeIsValid(lun,
+                                DWORDB(command->pLogicalBlockAddress),
+                                WORDB(command->pNumberOfBlocks))) {
+
+            return MSDD_STATUS_RW;
+        }
+        if (commandState->length != blockSize) {
+
+            TRACE_WARNING("SBC_WriteSame10: Bad data length\n\r");
+            return MSDD_STATUS_PARAMETER;
+        }
+    }
+
+    switch (commandState->state) {
+    //------------------
+    case SBC_STATE_READ:
+    //------------------
+        // Receive the block to write
+        status = MSDD_Read(fifo->pBuffer,
+                           blockSize,
+                           (TransferCallback) MSDDriver_Callback,
+                           (void *) transfer);
+
+        if (status != USBD_STATUS_SUCCESS) {
+
+            TRACE_WARNING("SBC_WriteSame10: Cannot start receiving data\n\r");
+            result = MSDD_STATUS_ERROR;
+        }
+        else {
+
+            commandState->state = SBC_STATE_WAIT_READ;
+        }
+        break;
+
+    //-----------------------
+    case SBC_STATE_WAIT_READ:
+    //-----------------------
+        if (transfer->semaphore == 0) {
+
+            break;
+        }
+        transfer->semaphore--;
+        commandState->length -= transfer->transferred;
+
+        if (transfer->status != USBD_STATUS_SUCCESS) {
+
+            TRACE_WARNING("SBC_WriteSame10: Cannot receive data\n\r");
+            result = MSDD_STATUS_ERROR;
+            break;
+        }
+
+        // Zeros can be discarded instead of written
+        commandState->state = SBC_STATE_NEXT_BLOCK;
+        if (command->isUnmap && lun->media->discard) {
+
+            for (i = 0; (i < blockSize) && (fifo->pBuffer[i] == 0); i++);
+            if (i == blockSize) {
+
+                result = (LUN_Discard(lun,
+                                      DWORDB(command->pLogicalBlockAddress),
+                                      WORDB(command->pNumberOfBlocks))
+                          == USBD_STATUS_SUCCESS) ?
+                             MSDD_STATUS_SUCCESS : MSDD_STATUS_ERROR;
+            }
+        }
+        break;
+
+    //------------------------
+    case SBC_STATE_NEXT_BLOCK:
+    //------------------------
+        status = LUN_Write(lun,
+                           DWORDB(command->pLogicalBlockAddress),
+                           fifo->pBuffer,
+                           1,
+                           (TransferCallback) MSDDriver_Callback,
+                           (void *) disktransfer);
+
+        if (status != USBD_STATUS_SUCCESS) {
+
+            TRACE_WARNING("SBC_WriteSame10: Failed to start write\n\r");
+            result = MSDD_STATUS_ERROR;
+        }
+        else {
+
+            commandState->state = SBC_STATE_WAIT_WRITE;
+        }
+        break;
+
+    //------------------------
+    case SBC_STATE_WAIT_WRITE:
+    //------------------------
+        if (disktransfer->semaphore == 0) {
+
+            break;
+        }
+        disktransfer->semaphore--;
+
+        if (disktransfer->status != USBD_STATUS_SUCCESS) {
+
+            TRACE_WARNING("SBC_WriteSame10: Failed to write\n\r");
+            result = MSDD_STATUS_ERROR;
+            break;
+        }
+
+        // Move to the next block of the range
+        STORE_DWORDB(DWORDB(command->pLogicalBlockAddress) + 1,
+                     command->pLogicalBlockAddress);
+        STORE_WORDB(WORDB(command->pNumberOfBlocks) - 1,
+                    command->pNumberOfBlocks);
+        if (WORDB(command->pNumberOfBlocks) == 0) {
+
+            result = MSDD_STATUS_SUCCESS;
+        }
+        else {
+
+            commandState->state = SBC_STATE_NEXT_BLOCK;
+        }
+        break;
+    }
+
+    return result;
+}
+
 //------------------------------------------------------------------------------
 //      Exported functions
 //------------------------------------------------------------------------------
@@ -1449,6 +2076,22 @@ unsigned char SBC_GetCommandInformation(void          *command,
         (*length) = sizeof(SBCReadCapacity10Data);
         break;
 
+    //----------------------------
+    case SBC_SERVICE_ACTION_IN_16:
+    //----------------------------
+        if (sbcCommand->readCapacity16.bServiceAction != SBC_READ_CAPACITY_16) {
+
+            isCommandSupported = 0;
+            break;
+        }
+        (*type) = MSDD_DEVICE_TO_HOST;
+        (*length) = DWORDB(sbcCommand->readCapacity16.pAllocationLength);
+        if ((*length) > sizeof(SBCReadCapacity16Data)) {
+
+            (*length) = sizeof(SBCReadCapacity16Data);
+        }
+        break;
+
     //---------------
     case SBC_READ_10:
     //---------------
@@ -1465,6 +2108,36 @@ unsigned char SBC_GetCommandInformation(void          *command,
                      * lun->blockSize * lun->media->blockSize;
         break;
 
+    //---------------
+    case SBC_READ_16:
+    //---------------
+        (*type) = MSDD_DEVICE_TO_HOST;
+        (*length) = DWORDB(sbcCommand->read16.pTransferLength)
+                     * lun->blockSize * lun->media->blockSize;
+        break;
+
+    //----------------
+    case SBC_WRITE_16:
+    //----------------
+        (*type) = MSDD_HOST_TO_DEVICE;
+        (*length) = DWORDB(sbcCommand->write16.pTransferLength)
+                     * lun->blockSize * lun->media->blockSize;
+        break;
+
+    //-------------
+    case SBC_UNMAP:
+    //-------------
+        (*type) = MSDD_HOST_TO_DEVICE;
+        (*length) = WORDB(sbcCommand->unmap.pParameterListLength);
+        break;
+
+    //---------------------
+    case SBC_WRITE_SAME_10:
+    //---------------------
+        (*type) = MSDD_HOST_TO_DEVICE;
+        (*length) = lun->blockSize * lun->media->blockSize;
+        break;
+
     //-----------------
     case SBC_VERIFY_10:
     //-----------------
@@ -1525,6 +2198,42 @@ unsigned char SBC_ProcessCommand(MSDLun               *lun,
         result = SBC_Write10(lun, commandState);
         break;
 
+    //---------------
+    case SBC_READ_16:
+    //---------------
+        TRACE_DEBUG_WP("Read(16) ");
+
+        // Same as Read10, with a 64-bit address
+        result = SBC_Read10(lun, commandState);
+        break;
+
+    //----------------
+    case SBC_WRITE_16:
+    //----------------
+        TRACE_DEBUG_WP("Write(16) ");
+
+        // Same as Write10, with a 64-bit address
+        result = SBC_Write10(lun, commandState);
+        break;
+
+    //-------------
+    case SBC_UNMAP:
+    //-------------
+        TRACE_INFO_WP("Unmap ");
+
+        // Release the blocks listed by the host
+        result = SBC_Unmap(lun, commandState);
+        break;
+
+    //---------------------
+    case SBC_WRITE_SAME_10:
+    //---------------------
+        TRACE_INFO_WP("WriteSame(10) ");
+
+        // Write or discard a range of blocks
+        result = SBC_WriteSame10(lun, commandState);
+        break;
+
     //---------------------
     case SBC_READ_CAPACITY_10:
     //---------------------
@@ -1534,6 +2243,15 @@ unsigned char SBC_ProcessCommand(MSDLun               *lun,
         result = SBC_ReadCapacity10(lun, commandState);
         break;
 
+    //----------------------------
+    case SBC_SERVICE_ACTION_IN_16:
+    //----------------------------
+        TRACE_INFO_WP("RdCapacity(16) ");
+
+        // Only READ CAPACITY (16) is accepted by SBC_GetCommandInformation
+        result = SBC_ReadCapacity16(lun, commandState);
+        break;
+
     //---------------------
     case SBC_VERIFY_10:
     //---------------------
@@ -1550,7 +2268,14 @@ unsigned char SBC_ProcessCommand(MSDLun               *lun,
         TRACE_INFO_WP("Inquiry ");
 
         // Process Inquiry command
-        result = SBC_Inquiry(lun, commandState);
+        if (command->inquiry.isEVPD) {
+
+            result = SBC_InquiryVPD(lun, commandState);
+        }
+        else {
+
+            result = SBC_Inquiry(lun, commandState);
+        }
         break;
 
     //--------------------
@@ -0,0 +1,428 @@
+//------------------------------------------------------------------------------
+// Audio speaker benchmark on the simulated UDPHS controller.
+//
+// Runs the AUDDSpeakerDriver stream end to end, or the AUDDLoopRecDriver one
+// when built with LOOPREC defined (looprecbench): the host selects the
+// streaming alternate setting, then sends one isochronous packet per
+// millisecond sized from the last value read on the feedback endpoint, as
+// streamsim does without the USB stack. The codec is played on the device
+// side by AUDDSpeakerPlayer through the SSC DMA channel, simulated here: at
+// the end of each period, the channel fetches the next descriptor of its list
+// and the player is called from the DMA interrupt. The codec clock is off the
+// USB frame clock by the given amount, and the bytes played are checked to
+// follow each other as the host sent them, and to be all the periods taken
+// from the ring but the two still queued. One line is printed per simulated
+// second with the fill level of the ring, the feedback, the underrun, overrun
+// and isochronous error counters, and the number of breaks in the bytes
+// played.
+//
+//   ./audiobench [fs] [codec ppm] [seconds]
+//------------------------------------------------------------------------------
+
+#include "simboard.h"
+#include "udphssim.h"
+#include "vhost.h"
+
+#include <board.h>
+#include <usb/device/core/USBD.h>
+#if defined(LOOPREC)
+#include <usb/device/audio-looprec/AUDDLoopRecChannel.h>
+#include <usb/device/audio-looprec/AUDDLoopRecDriver.h>
+#include <usb/device/audio-looprec/AUDDLoopRecDriverDescriptors.h>
+#else
+#include <usb/device/audio-speaker/AUDDSpeakerChannel.h>
+#include <usb/device/audio-speaker/AUDDSpeakerDriver.h>
+#include <usb/device/audio-speaker/AUDDSpeakerDriverDescriptors.h>
+#endif
+#include <usb/device/audio-speaker/AUDDSpeakerPlayer.h>
+#include <dma/dma.h>
+#include <drivers/dmad/dmad.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Driver under test.
+#if defined(LOOPREC)
+#define NAME                "Audio loop record"
+#define SAMPLERATE          AUDDLoopRecDriver_SAMPLERATE
+#define SAMPLESIZE          AUDDLoopRecDriver_BYTESPERSUBFRAME
+#define PERIODSIZE          AUDDLoopRecDriver_BYTESPERFRAME
+#define MAXPACKETSIZE       AUDDLoopRecDriver_MAXPACKETSIZE
+#define STREAMING           AUDDLoopRecDriverDescriptors_STREAMING
+#define DRIVER_DATAOUT      AUDDLoopRecDriverDescriptors_DATAOUT
+#define DRIVER_FEEDBACK     AUDDLoopRecDriverDescriptors_FEEDBACK
+#define Initialize          AUDDLoopRecDriver_Initialize
+#define AcquirePeriod       AUDDLoopRecDriver_AcquirePeriod
+#define ReleasePeriod       AUDDLoopRecDriver_ReleasePeriod
+#define GetStreamStatistics AUDDLoopRecDriver_GetStreamStatistics
+#else
+#define NAME                "Audio speaker"
+#define SAMPLERATE          AUDDSpeakerDriver_SAMPLERATE
+#define SAMPLESIZE          AUDDSpeakerDriver_BYTESPERSUBFRAME
+#define PERIODSIZE          AUDDSpeakerDriver_BYTESPERFRAME
+#define MAXPACKETSIZE       AUDDSpeakerDriver_MAXPACKETSIZE
+#define STREAMING           AUDDSpeakerDriverDescriptors_STREAMING
+#define DRIVER_DATAOUT      AUDDSpeakerDriverDescriptors_DATAOUT
+#define DRIVER_FEEDBACK     AUDDSpeakerDriverDescriptors_FEEDBACK
+#define Initialize          AUDDSpeakerDriver_Initialize
+#define AcquirePeriod       AUDDSpeakerDriver_AcquirePeriod
+#define ReleasePeriod       AUDDSpeakerDriver_ReleasePeriod
+#define GetStreamStatistics AUDDSpeakerDriver_GetStreamStatistics
+#endif
+
+/// Packets the host keeps in flight.
+#define NUMPACKETS          4
+
+/// Endpoints seen from the host.
+#define DATAOUT             DRIVER_DATAOUT
+#define FEEDBACK            (0x80 | DRIVER_FEEDBACK)
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+/// Codec: length of a period in USB frames, and end of the current one.
+static double period;
+static double nextPeriod;
+static unsigned long long frames;
+
+/// Simulated DMA channel of the SSC: descriptor fetched, and status.
+static unsigned char dmaEnabled;
+static DmaLinkList *pDmaDescriptor;
+static unsigned int dmaInterrupts;
+static unsigned int dmaStatus;
+
+/// Bytes played: last one, breaks in their sequence, and periods of them.
+static unsigned char lastByte;
+static unsigned char started;
+static unsigned int breaks;
+static unsigned int periodsPlayed;
+
+/// Host stream state.
+static unsigned char packets[NUMPACKETS][MAXPACKETSIZE];
+static VHostTransfer packetTransfers[NUMPACKETS];
+static unsigned char feedbackBuffer[4];
+static VHostTransfer feedbackTransfer;
+static unsigned int feedback;
+static unsigned int accumulator;
+static unsigned int sample;
+static unsigned int feedbackReads;
+
+//------------------------------------------------------------------------------
+//         Simulated DMA controller
+//------------------------------------------------------------------------------
+
+void DMA_Enable(void)
+{
+}
+
+void DMA_EnableChannel(unsigned int channel)
+{
+    dmaEnabled = 1;
+}
+
+void DMA_DisableChannel(unsigned int channel)
+{
+    dmaEnabled = 0;
+}
+
+unsigned int DMA_GetStatus(void)
+{
+    unsigned int status = dmaStatus;
+
+    dmaStatus = 0;
+    return status;
+}
+
+void DMA_EnableIt(unsigned int flag)
+{
+    dmaInterrupts |= flag;
+}
+
+void DMA_DisableIt(unsigned int flag)
+{
+    dmaInterrupts &= ~flag;
+}
+
+void DMA_SetDescriptorAddr(unsigned char channel, unsigned int address)
+{
+    pDmaDescriptor = (DmaLinkList *) (unsigned long) address;
+}
+
+void DMA_SetSourceBufferMode(unsigned char channel,
+                             unsigned char transferMode,
+                             unsigned char addressingType)
+{
+}
+
+void DMA_SetDestBufferMode(unsigned char channel,
+                           unsigned char transferMode,
+                           unsigned char addressingType)
+{
+}
+
+void DMA_SetConfiguration(unsigned char channel, unsigned int value)
+{
+}
+
+void DMA_SetFlowControl(unsigned char channel, unsigned int flow)
+{
+}
+
+void HDMA_IrqHandler(void)
+{
+    AUDDSpeakerPlayer_DmaHandler(DMA_GetStatus());
+}
+
+//------------------------------------------------------------------------------
+//         Device
+//------------------------------------------------------------------------------
+
+/// Mute requests are applied by the AcquirePeriod() function of the driver.
+#if defined(LOOPREC)
+void AUDDLoopRecChannel_MuteChanged(AUDDLoopRecChannel *channel,
+                                    unsigned char muted)
+{
+}
+#else
+void AUDDSpeakerChannel_MuteChanged(AUDDSpeakerChannel *channel,
+                                    unsigned char muted)
+{
+}
+#endif
+
+/// Checks the bytes of a buffer played by the DMA channel. Silence is all
+/// zeros; the other bytes count up from one buffer to the next.
+static void CheckPlayed(const DmaLinkList *pDescriptor)
+{
+    const unsigned char *pData =
+        (const unsigned char *) (unsigned long) pDescriptor->sourceAddress;
+    unsigned int length = (pDescriptor->controlA & 0xFFFF) * 2;
+    unsigned int i;
+
+    for (i = 0; (i < length) && (pData[i] == 0); i++);
+    if (i == length) {
+
+        return;
+    }
+    if (started && (pData[0] != (unsigned char) (lastByte + 1))) {
+
+        breaks++;
+    }
+    for (i = 1; i < length; i++) {
+
+        if (pData[i] != (unsigned char) (pData[i - 1] + 1)) {
+
+            breaks++;
+        }
+    }
+    lastByte = pData[length - 1];
+    started = 1;
+    periodsPlayed++;
+}
+
+/// Plays every codec period that ended during the current frame: the buffer
+/// of the current descriptor is played, the next descriptor is fetched, and
+/// the DMA interrupt is raised.
+static void CodecTick(void)
+{
+    unsigned int channel = DMA_BTC << BOARD_SSC_DMA_CHANNEL;
+
+    while (dmaEnabled && (nextPeriod <= frames)) {
+
+        CheckPlayed(pDmaDescriptor);
+        pDmaDescriptor =
+            (DmaLinkList *) (unsigned long) pDmaDescriptor->descriptor;
+        dmaStatus |= channel;
+        if (dmaInterrupts & channel) {
+
+            HDMA_IrqHandler();
+        }
+        nextPeriod += period;
+    }
+}
+
+//------------------------------------------------------------------------------
+//         Host
+//------------------------------------------------------------------------------
+
+static void FeedbackReceived(VHostTransfer *pTransfer)
+{
+    if ((pTransfer->status == VHOST_DONE) && VHost_IsHighSpeed()
+        && (pTransfer->actual == 4)) {
+
+        // 16.16 samples per microframe
+        feedback = (feedbackBuffer[0] | (feedbackBuffer[1] << 8)
+                    | (feedbackBuffer[2] << 16) | (feedbackBuffer[3] << 24)) * 8;
+        feedbackReads++;
+    }
+    else if ((pTransfer->status == VHOST_DONE) && (pTransfer->actual == 3)) {
+
+        // 10.14 samples per frame
+        feedback = (feedbackBuffer[0] | (feedbackBuffer[1] << 8)
+                    | (feedbackBuffer[2] << 16)) << 2;
+        feedbackReads++;
+    }
+    VHost_Submit(pTransfer);
+}
+
+/// Sends the packet of the frame starting, and runs the codec.
+static void FrameStarted(unsigned int microframe)
+{
+    unsigned int samples;
+    unsigned int i;
+    VHostTransfer *pTransfer = 0;
+
+    if ((microframe & 7) != 0) {
+
+        return;
+    }
+    frames++;
+    UDPHSSim_Call(CodecTick);
+
+    for (i = 0; i < NUMPACKETS; i++) {
+
+        if (packetTransfers[i].status != VHOST_PENDING) {
+
+            pTransfer = &(packetTransfers[i]);
+            break;
+        }
+    }
+    if (pTransfer == 0) {
+
+        return;
+    }
+
+    accumulator += feedback;
+    samples = accumulator >> 16;
+    accumulator &= 0xFFFF;
+    if (samples * SAMPLESIZE > MAXPACKETSIZE) {
+
+        samples = MAXPACKETSIZE / SAMPLESIZE;
+    }
+    for (i = 0; i < samples * SAMPLESIZE; i++) {
+
+        pTransfer->pData[i] = sample++;
+    }
+    pTransfer->length = samples * SAMPLESIZE;
+    VHost_Submit(pTransfer);
+}
+
+//------------------------------------------------------------------------------
+//         Main function
+//------------------------------------------------------------------------------
+
+int main(int argc, char **argv)
+{
+    unsigned char highSpeed = 1;
+    double ppm = 200.0;
+    unsigned int seconds = 10;
+    unsigned int second;
+    unsigned int arg = 1;
+    unsigned int i;
+    AUDDSpeakerStreamStatistics stream;
+    UDPHSSimStatistics controller;
+
+    if ((argc > arg) && (strcmp(argv[arg], "fs") == 0)) {
+
+        highSpeed = 0;
+        arg++;
+    }
+    if (argc > arg) {
+
+        ppm = atof(argv[arg++]);
+    }
+    if (argc > arg) {
+
+        seconds = atoi(argv[arg++]);
+    }
+    period = 1.0 / (1.0 + ppm / 1000000.0);
+
+    SimBoard_Initialize(highSpeed, 0);
+    Initialize();
+    USBD_Connect();
+
+    if (!VHost_Enumerate()) {
+
+        return 1;
+    }
+    if (!VHost_SetInterface(STREAMING, 1)) {
+
+        printf("SET_INTERFACE(streaming, 1) failed\n");
+        return 1;
+    }
+    printf(NAME ", %s speed, codec %+.0f ppm\n",
+           VHost_IsHighSpeed() ? "high" : "full", ppm);
+    printf("  time  level  min  max  feedback  underruns  overruns  iso errors"
+           "  breaks\n");
+
+    // Nominal rate until the first feedback
+    feedback = (SAMPLERATE / 1000) << 16;
+    for (i = 0; i < NUMPACKETS; i++) {
+
+        memset(&packetTransfers[i], 0, sizeof(VHostTransfer));
+        packetTransfers[i].endpoint = DATAOUT;
+        packetTransfers[i].pData = packets[i];
+    }
+    memset(&feedbackTransfer, 0, sizeof(feedbackTransfer));
+    feedbackTransfer.endpoint = FEEDBACK;
+    feedbackTransfer.pData = feedbackBuffer;
+    feedbackTransfer.length = sizeof(feedbackBuffer);
+    feedbackTransfer.callback = FeedbackReceived;
+    VHost_Submit(&feedbackTransfer);
+
+    // The codec starts with two periods queued
+    AUDDSpeakerPlayer_Initialize(AcquirePeriod,
+                                 ReleasePeriod,
+                                 PERIODSIZE);
+    if (!AUDDSpeakerPlayer_StartSsc(AT91C_BASE_SSC0)) {
+
+        printf("AUDDSpeakerPlayer_StartSsc failed\n");
+        return 1;
+    }
+    nextPeriod = period;
+    VHost_SetFrameHandler(FrameStarted);
+
+    SimBoard_Begin();
+    for (second = 1; second <= seconds; second++) {
+
+        while (frames < second * 1000ULL) {
+
+            VHost_RunFrame();
+        }
+        GetStreamStatistics(&stream);
+        UDPHSSim_GetStatistics(&controller);
+        printf("%5us  %5u %4u %4u  %8.4f  %9u  %8u  %10llu  %6u\n",
+               second,
+               stream.level,
+               stream.minLevel,
+               stream.maxLevel,
+               stream.feedback / 65536.0,
+               stream.underruns,
+               stream.overruns,
+               controller.isoErrors,
+               breaks);
+    }
+    GetStreamStatistics(&stream);
+    SimBoard_End("stream", stream.bytesIn);
+    printf("%-24s %u feedback reads, %u periods played\n", "",
+           feedbackReads, periodsPlayed);
+    AUDDSpeakerPlayer_Stop();
+
+    // Every period taken from the ring is played, but the queued ones, and
+    // the bytes only break where the ring ran dry or over
+    if ((periodsPlayed + 2 < stream.periodsOut)
+        || (breaks > stream.underruns + stream.overruns)) {
+
+        printf("%u of %u periods played, %u breaks\n", periodsPlayed,
+               stream.periodsOut, breaks);
+        return 1;
+    }
+
+    return 0;
+}
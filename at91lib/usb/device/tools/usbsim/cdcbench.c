@@ -0,0 +1,355 @@
+//------------------------------------------------------------------------------
+// CDC serial benchmark on the simulated UDPHS controller.
+//
+// The device echoes everything it receives. By default it keeps four buffers
+// queued with CDCDSerialDriver_QueueRead() and sends each one back with
+// CDCDSerialDriver_QueueWrite() as soon as it is filled, all from the
+// transfer callbacks; with "simple" it uses a single buffer and the plain
+// CDCDSerialDriver_Read()/Write() calls, as the usb-device-cdc-serial
+// example does. The host streams 1 MB with four transfers in flight in each
+// direction and checks the echo, then measures the round trip of 64 bytes.
+// Last, the host enumerates the device again while it has reads armed and
+// writes that the host never reads: every one of them must be called back
+// with USBD_STATUS_RESET, and the echo must work again once restarted.
+//
+//   ./cdcbench [fs] [simple]
+//------------------------------------------------------------------------------
+
+#include "simboard.h"
+#include "udphssim.h"
+#include "vhost.h"
+
+#include <board.h>
+#include <usb/device/core/USBD.h>
+#include <usb/device/cdc-serial/CDCDSerialDriver.h>
+#include <usb/device/cdc-serial/CDCDSerialDriverDescriptors.h>
+
+#include <stdio.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Device buffers.
+#define NUMBUFFERS          4
+#define BUFFERSIZE          2048
+
+/// Stream length and host transfer size.
+#define STREAMSIZE          (1024 * 1024)
+#define CHUNKSIZE           BUFFERSIZE
+#define INFLIGHT            4
+
+/// Round trips of the latency test.
+#define PINGS               200
+#define PINGSIZE            64
+
+/// Endpoints seen from the host.
+#define DATAOUT             CDCDSerialDriverDescriptors_DATAOUT
+#define DATAIN              (0x80 | CDCDSerialDriverDescriptors_DATAIN)
+
+/// One second of bus time, in ns.
+#define TIMEOUT             1000000000ULL
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+/// Device side.
+static unsigned char buffers[NUMBUFFERS][BUFFERSIZE];
+static unsigned char pending[2][BUFFERSIZE];
+static unsigned char simple;
+/// Transfers ended by a bus reset.
+static unsigned int resetCallbacks;
+
+/// Host side.
+static unsigned char source[STREAMSIZE];
+static unsigned char sink[STREAMSIZE];
+static VHostTransfer outTransfers[INFLIGHT];
+static VHostTransfer inTransfers[INFLIGHT];
+static unsigned int nextOut;
+static unsigned int nextIn;
+static unsigned int received;
+static unsigned char failed;
+
+//------------------------------------------------------------------------------
+//         Device
+//------------------------------------------------------------------------------
+
+static void DataReceived(void *pArg,
+                         unsigned char status,
+                         unsigned int transferred,
+                         unsigned int remaining);
+
+static void DataSent(void *pArg,
+                     unsigned char status,
+                     unsigned int transferred,
+                     unsigned int remaining)
+{
+    if (status != USBD_STATUS_SUCCESS) {
+
+        resetCallbacks += status == USBD_STATUS_RESET;
+        return;
+    }
+    if (simple) {
+
+        CDCDSerialDriver_Read(pArg, BUFFERSIZE, DataReceived, pArg);
+    }
+    else {
+
+        CDCDSerialDriver_QueueRead(pArg, BUFFERSIZE, DataReceived, pArg);
+    }
+}
+
+static void DataReceived(void *pArg,
+                         unsigned char status,
+                         unsigned int transferred,
+                         unsigned int remaining)
+{
+    if (status != USBD_STATUS_SUCCESS) {
+
+        resetCallbacks += status == USBD_STATUS_RESET;
+        return;
+    }
+    if (simple) {
+
+        CDCDSerialDriver_Write(pArg, transferred, DataSent, pArg);
+    }
+    else {
+
+        CDCDSerialDriver_QueueWrite(pArg, transferred, DataSent, pArg);
+    }
+}
+
+/// Starts the echo once the host has configured the device.
+static void StartEcho(void)
+{
+    unsigned int i;
+
+    if (simple) {
+
+        CDCDSerialDriver_Read(buffers[0], BUFFERSIZE, DataReceived, buffers[0]);
+    }
+    else {
+
+        for (i = 0; i < NUMBUFFERS; i++) {
+
+            CDCDSerialDriver_QueueRead(buffers[i], BUFFERSIZE, DataReceived, buffers[i]);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+//         Host
+//------------------------------------------------------------------------------
+
+static void OutDone(VHostTransfer *pTransfer)
+{
+    if (pTransfer->status != VHOST_DONE) {
+
+        failed = 1;
+        return;
+    }
+    if (nextOut < STREAMSIZE) {
+
+        pTransfer->pData = &source[nextOut];
+        nextOut += CHUNKSIZE;
+        VHost_Submit(pTransfer);
+    }
+}
+
+static void InDone(VHostTransfer *pTransfer)
+{
+    if ((pTransfer->status != VHOST_DONE) || (pTransfer->actual != CHUNKSIZE)) {
+
+        failed = 1;
+        return;
+    }
+    received += pTransfer->actual;
+    if (nextIn < STREAMSIZE) {
+
+        pTransfer->pData = &sink[nextIn];
+        nextIn += CHUNKSIZE;
+        VHost_Submit(pTransfer);
+    }
+}
+
+static unsigned char Stream(void)
+{
+    unsigned long long end;
+    unsigned int i;
+
+    for (i = 0; i < STREAMSIZE; i++) {
+
+        source[i] = (i * 13 + (i >> 11)) & 0xFF;
+    }
+    nextOut = 0;
+    nextIn = 0;
+    received = 0;
+
+    SimBoard_Begin();
+    for (i = 0; i < INFLIGHT; i++) {
+
+        memset(&inTransfers[i], 0, sizeof(VHostTransfer));
+        inTransfers[i].endpoint = DATAIN;
+        inTransfers[i].pData = &sink[nextIn];
+        inTransfers[i].length = CHUNKSIZE;
+        inTransfers[i].callback = InDone;
+        nextIn += CHUNKSIZE;
+        VHost_Submit(&inTransfers[i]);
+
+        memset(&outTransfers[i], 0, sizeof(VHostTransfer));
+        outTransfers[i].endpoint = DATAOUT;
+        outTransfers[i].pData = &source[nextOut];
+        outTransfers[i].length = CHUNKSIZE;
+        outTransfers[i].callback = OutDone;
+        nextOut += CHUNKSIZE;
+        VHost_Submit(&outTransfers[i]);
+    }
+    end = VHost_GetTime() + 10 * TIMEOUT;
+    while ((received < STREAMSIZE) && !failed && (VHost_GetTime() < end)) {
+
+        VHost_RunFrame();
+    }
+    SimBoard_End(simple ? "simple loopback" : "queued loopback", 2ULL * received);
+
+    if (received < STREAMSIZE) {
+
+        printf("loopback stalled after %u bytes\n", received);
+        return 0;
+    }
+    if (memcmp(source, sink, STREAMSIZE) != 0) {
+
+        printf("loopback data mismatch\n");
+        return 0;
+    }
+    return 1;
+}
+
+static unsigned char Ping(void)
+{
+    unsigned char out[PINGSIZE];
+    unsigned char in[PINGSIZE];
+    VHostTransfer outTransfer;
+    VHostTransfer inTransfer;
+    unsigned long long total = 0;
+    unsigned long long worst = 0;
+    unsigned int i;
+
+    SimBoard_Begin();
+    for (i = 0; i < PINGS; i++) {
+
+        unsigned long long time;
+
+        memset(out, i, sizeof(out));
+        memset(&outTransfer, 0, sizeof(outTransfer));
+        outTransfer.endpoint = DATAOUT;
+        outTransfer.pData = out;
+        outTransfer.length = sizeof(out);
+        outTransfer.zlp = 1;
+        memset(&inTransfer, 0, sizeof(inTransfer));
+        inTransfer.endpoint = DATAIN;
+        inTransfer.pData = in;
+        inTransfer.length = sizeof(in);
+        VHost_Submit(&outTransfer);
+        VHost_Submit(&inTransfer);
+        if ((VHost_Wait(&inTransfer, TIMEOUT) != VHOST_DONE)
+            || (inTransfer.actual != sizeof(in))
+            || (memcmp(in, out, sizeof(in)) != 0)) {
+
+            printf("ping %u failed\n", i);
+            return 0;
+        }
+        time = inTransfer.completed - outTransfer.submitted;
+        total += time;
+        if (time > worst) {
+
+            worst = time;
+        }
+    }
+    SimBoard_End("64-byte ping-pong", 2ULL * PINGS * PINGSIZE);
+    printf("%-24s %8.1f us average, %.1f us worst round trip\n",
+           "", total / 1000.0 / PINGS, worst / 1000.0);
+    return 1;
+}
+
+/// Enumerates the device again with transfers in flight, then checks the echo.
+static unsigned char Reenumerate(void)
+{
+    unsigned int expected;
+
+    if (simple) {
+
+        CDCDSerialDriver_Write(pending[0], BUFFERSIZE, DataSent, pending[0]);
+        expected = 2;
+    }
+    else {
+
+        CDCDSerialDriver_QueueWrite(pending[0], BUFFERSIZE, DataSent, pending[0]);
+        CDCDSerialDriver_QueueWrite(pending[1], BUFFERSIZE, DataSent, pending[1]);
+        expected = NUMBUFFERS + 2;
+    }
+    resetCallbacks = 0;
+    if (!VHost_Enumerate()) {
+
+        return 0;
+    }
+    printf("bus reset: %u of %u transfers in flight called back\n",
+           resetCallbacks, expected);
+    if (resetCallbacks != expected) {
+
+        return 0;
+    }
+    StartEcho();
+    return Ping();
+}
+
+//------------------------------------------------------------------------------
+//         Main function
+//------------------------------------------------------------------------------
+
+int main(int argc, char **argv)
+{
+    unsigned char highSpeed = 1;
+    unsigned char lineCoding[7] = {0x00, 0xC2, 0x01, 0x00, 0, 0, 8};
+    int i;
+
+    for (i = 1; i < argc; i++) {
+
+        if (strcmp(argv[i], "fs") == 0) {
+
+            highSpeed = 0;
+        }
+        else if (strcmp(argv[i], "simple") == 0) {
+
+            simple = 1;
+        }
+    }
+
+    SimBoard_Initialize(highSpeed, 0);
+    CDCDSerialDriver_Initialize();
+    USBD_Connect();
+
+    if (!VHost_Enumerate()) {
+
+        return 1;
+    }
+    printf("CDC serial, %s speed, %s echo\n",
+           VHost_IsHighSpeed() ? "high" : "full", simple ? "single buffer" : "queued");
+
+    // 115200 8N1, DTR and RTS
+    if ((VHost_Control(0x21, 0x20, 0, 0, sizeof(lineCoding), lineCoding)
+         != sizeof(lineCoding))
+        || (VHost_Control(0x21, 0x22, 3, 0, 0, 0) != 0)) {
+
+        printf("CDC requests failed\n");
+        return 1;
+    }
+
+    StartEcho();
+    if (!Stream() || !Ping() || !Reenumerate()) {
+
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,463 @@
+//------------------------------------------------------------------------------
+// Composite CDC + MSD benchmark on the simulated UDPHS controller.
+//
+// The device is the CDCMSDDDriver composite: a CDC serial port whose data are
+// echoed by the application, and a mass storage function on a RAM disk made
+// as slow as an SD card: each media read or write keeps the device busy for
+// an access time, plus MEDIATIME ns per byte. The virtual host measures the round trip of
+// small CDC pings sent every millisecond, first on an idle device, then while
+// it keeps the MSD function busy with READ(10) and WRITE(10) commands.
+//
+// Two devices are compared. The polled one runs MSDDriver_StateMachine() and
+// the CDC echo from its main loop, which does not run while the media is
+// busy. The scheduled one calls COMPOSITEDScheduler_Run() from its main loop
+// and from the media driver while it waits, the CDC function having a higher
+// priority than the MSD one.
+//
+//   ./compositebench [fs]
+//------------------------------------------------------------------------------
+
+#include "simboard.h"
+#include "udphssim.h"
+#include "vhost.h"
+
+#include <board.h>
+#include <memories/MEDRamDisk.h>
+#include <usb/device/core/USBD.h>
+#include <usb/device/composite/CDCMSDDDriver.h>
+#include <usb/device/composite/CDCMSDDDriverDescriptors.h>
+#include <usb/device/composite/COMPOSITEDScheduler.h>
+#include <usb/device/massstorage/MSDLun.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+#define DISKBLOCK           512
+#define DISKSIZE            (1024 * 1024)
+#define MSDBUFFERSIZE       (16 * DISKBLOCK)
+
+/// Media busy time: access time of a read and of a write, in ns, and
+/// transfer time in ns per byte (20 MB/s).
+#define READACCESS          100000ULL
+#define WRITEACCESS         1000000ULL
+#define MEDIATIME           50
+
+/// Size of the READ(10)/WRITE(10) commands of the load.
+#define COMMANDSIZE         (64 * 1024)
+
+/// Size of a ping, period of the pings in ns, and pings measured by each test.
+#define PINGSIZE            8
+#define PINGPERIOD          1000000ULL
+#define NUMPINGS            500
+
+/// Scheduling priority of the CDC function, above the MSD one.
+#define CDCPRIORITY         (MSDDFunctionDriver_PRIORITY + 1)
+
+/// Endpoints seen from the host.
+#define CDCOUT              CDCD_Descriptors_DATAOUT0
+#define CDCIN               (0x80 | CDCD_Descriptors_DATAIN0)
+#define BULKOUT             MSDD_Descriptors_BULKOUT
+#define BULKIN              (0x80 | MSDD_Descriptors_BULKIN)
+
+/// One second of bus time, in ns.
+#define TIMEOUT             1000000000ULL
+
+/// States of the CDC echo.
+#define CDC_IDLE            0
+#define CDC_READING         1
+#define CDC_RECEIVED        2
+#define CDC_WRITING         3
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+/// Device side.
+Media medias[1];
+static MSDLun lun;
+static unsigned char msdBuffer[MSDBUFFERSIZE];
+static unsigned char disk[DISKSIZE] __attribute__((aligned(DISKBLOCK)));
+static Media_read diskRead;
+static Media_write diskWrite;
+static unsigned char scheduled;
+static unsigned char inMedia;
+
+static COMPOSITEDFunction cdcFunction;
+static unsigned char cdcBuffer[64];
+static volatile unsigned char cdcState;
+static unsigned int cdcLength;
+
+/// Host side.
+static unsigned char pattern[COMMANDSIZE];
+static unsigned char readBack[COMMANDSIZE];
+static unsigned int tag;
+static unsigned char ping[PINGSIZE];
+static unsigned char echo[PINGSIZE];
+static VHostTransfer pingTransfer;
+static VHostTransfer echoTransfer;
+static unsigned char pinging;
+static unsigned long long nextPing;
+static unsigned int pings;
+static unsigned int pingErrors;
+static unsigned long long totalRoundTrip;
+static unsigned long long worstRoundTrip;
+
+//------------------------------------------------------------------------------
+//         Device
+//------------------------------------------------------------------------------
+
+/// Keeps the device busy in the media driver. A media driver of the
+/// scheduled device lets the functions of higher priority run meanwhile,
+/// which the main loop below does when it sees it is nested.
+static void Busy(unsigned long long access, unsigned int blocks)
+{
+    inMedia = 1;
+    VHost_Spend(access + (unsigned long long) blocks * DISKBLOCK * MEDIATIME);
+    inMedia = 0;
+}
+
+static unsigned char SlowRead(Media *media,
+                              unsigned int address,
+                              void *data,
+                              unsigned int length,
+                              MediaCallback callback,
+                              void *argument)
+{
+    Busy(READACCESS, length);
+    return diskRead(media, address, data, length, callback, argument);
+}
+
+static unsigned char SlowWrite(Media *media,
+                               unsigned int address,
+                               void *data,
+                               unsigned int length,
+                               MediaCallback callback,
+                               void *argument)
+{
+    Busy(WRITEACCESS, length);
+    return diskWrite(media, address, data, length, callback, argument);
+}
+
+static void CdcReceived(void *pArgument,
+                        unsigned char status,
+                        unsigned int transferred,
+                        unsigned int remaining)
+{
+    cdcLength = transferred;
+    cdcState = (status == USBD_STATUS_SUCCESS) ? CDC_RECEIVED : CDC_IDLE;
+    COMPOSITEDScheduler_Signal(&cdcFunction);
+}
+
+static void CdcSent(void *pArgument,
+                    unsigned char status,
+                    unsigned int transferred,
+                    unsigned int remaining)
+{
+    cdcState = CDC_IDLE;
+    COMPOSITEDScheduler_Signal(&cdcFunction);
+}
+
+/// Run method of the CDC function: echoes what the host sends.
+static unsigned char CdcRun(void *pArgument)
+{
+    if (cdcState == CDC_IDLE) {
+
+        cdcState = CDC_READING;
+        if (CDCDSerialDriver_Read(0, cdcBuffer, sizeof(cdcBuffer),
+                                  CdcReceived, 0) != USBD_STATUS_SUCCESS) {
+
+            cdcState = CDC_IDLE;
+        }
+    }
+    else if (cdcState == CDC_RECEIVED) {
+
+        cdcState = CDC_WRITING;
+        if (CDCDSerialDriver_Write(0, cdcBuffer, cdcLength,
+                                   CdcSent, 0) != USBD_STATUS_SUCCESS) {
+
+            cdcState = CDC_RECEIVED;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void DeviceLoop(void)
+{
+    if (scheduled) {
+
+        COMPOSITEDScheduler_Run();
+    }
+    else if (!inMedia) {
+
+        MSDDriver_StateMachine();
+        CdcRun(0);
+    }
+}
+
+//------------------------------------------------------------------------------
+//         Host
+//------------------------------------------------------------------------------
+
+static void Submit(VHostTransfer *pTransfer,
+                   unsigned char endpoint,
+                   void *pData,
+                   unsigned int length)
+{
+    memset(pTransfer, 0, sizeof(VHostTransfer));
+    pTransfer->endpoint = endpoint;
+    pTransfer->pData = pData;
+    pTransfer->length = length;
+    VHost_Submit(pTransfer);
+}
+
+static void EchoReceived(VHostTransfer *pTransfer);
+
+static void SendPing(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < PINGSIZE; i++) {
+
+        ping[i] = (unsigned char) (pings + i);
+    }
+    Submit(&echoTransfer, CDCIN, echo, PINGSIZE);
+    echoTransfer.callback = EchoReceived;
+    Submit(&pingTransfer, CDCOUT, ping, PINGSIZE);
+}
+
+static void EchoReceived(VHostTransfer *pTransfer)
+{
+    unsigned long long roundTrip = pTransfer->completed
+                                   - pingTransfer.submitted;
+
+    if ((pTransfer->status != VHOST_DONE)
+        || (pTransfer->actual != PINGSIZE)
+        || (memcmp(echo, ping, PINGSIZE) != 0)) {
+
+        pingErrors++;
+    }
+    pings++;
+    totalRoundTrip += roundTrip;
+    if (roundTrip > worstRoundTrip) {
+
+        worstRoundTrip = roundTrip;
+    }
+}
+
+/// Sends the next ping when it is due and the previous one has come back.
+static void FrameStarted(unsigned int microframe)
+{
+    if (pinging
+        && (echoTransfer.status != VHOST_PENDING)
+        && (VHost_GetTime() >= nextPing)) {
+
+        nextPing += PINGPERIOD;
+        SendPing();
+    }
+}
+
+/// Runs a Bulk-Only Transport command, as msdbench does.
+/// \return Status of the CSW, or -1 on a transport error
+static int Command(const unsigned char *pCommand,
+                   unsigned char commandLength,
+                   unsigned char in,
+                   void *pData,
+                   unsigned int length)
+{
+    unsigned char cbw[31];
+    unsigned char csw[13];
+    VHostTransfer transfers[3];
+
+    memset(cbw, 0, sizeof(cbw));
+    cbw[0] = 'U'; cbw[1] = 'S'; cbw[2] = 'B'; cbw[3] = 'C';
+    tag++;
+    memcpy(&cbw[4], &tag, 4);
+    memcpy(&cbw[8], &length, 4);
+    cbw[12] = in ? 0x80 : 0x00;
+    cbw[14] = commandLength;
+    memcpy(&cbw[15], pCommand, commandLength);
+
+    Submit(&transfers[0], BULKOUT, cbw, sizeof(cbw));
+    if (length > 0) {
+
+        Submit(&transfers[1], in ? BULKIN : BULKOUT, pData, length);
+    }
+    Submit(&transfers[2], BULKIN, csw, sizeof(csw));
+
+    if ((VHost_Wait(&transfers[2], TIMEOUT) != VHOST_DONE)
+        || (transfers[0].status != VHOST_DONE)
+        || ((length > 0)
+            && ((transfers[1].status != VHOST_DONE) || (transfers[1].actual != length)))
+        || (transfers[2].actual != sizeof(csw))
+        || (memcmp(csw, "USBS", 4) != 0)
+        || (memcmp(&csw[4], &tag, 4) != 0)) {
+
+        return -1;
+    }
+    return csw[12];
+}
+
+static int ReadWrite(unsigned char in,
+                     unsigned int block,
+                     void *pData,
+                     unsigned int length)
+{
+    unsigned char command[10];
+    unsigned int blocks = length / DISKBLOCK;
+
+    memset(command, 0, sizeof(command));
+    command[0] = in ? 0x28 : 0x2A;
+    command[2] = block >> 24;
+    command[3] = block >> 16;
+    command[4] = block >> 8;
+    command[5] = block;
+    command[7] = blocks >> 8;
+    command[8] = blocks;
+
+    return Command(command, sizeof(command), in, pData, length);
+}
+
+/// Measures the CDC round trip while the host keeps the MSD function busy
+/// with READ(10) (load 1) or WRITE(10) (load 2) commands, or idle (load 0).
+static unsigned char Run(const char *mode, unsigned char load)
+{
+    static const char *loads[] = {"idle", "MSD read", "MSD write"};
+    char label[48];
+    unsigned long long bytes = 0;
+    unsigned int block = 0;
+
+    pings = 0;
+    pingErrors = 0;
+    totalRoundTrip = 0;
+    worstRoundTrip = 0;
+    nextPing = VHost_GetTime();
+    pinging = 1;
+
+    SimBoard_Begin();
+    while (pings < NUMPINGS) {
+
+        if (load == 0) {
+
+            VHost_RunFrame();
+            continue;
+        }
+        if (ReadWrite(load == 1, block, (load == 1) ? readBack : pattern,
+                      COMMANDSIZE) != 0) {
+
+            printf("%s: %s failed\n", mode, loads[load]);
+            return 0;
+        }
+        if ((load == 1)
+            && (memcmp(readBack, &disk[block * DISKBLOCK], COMMANDSIZE) != 0)) {
+
+            printf("%s: data mismatch\n", mode);
+            return 0;
+        }
+        bytes += COMMANDSIZE;
+        block = (block + COMMANDSIZE / DISKBLOCK) % (DISKSIZE / DISKBLOCK);
+    }
+    snprintf(label, sizeof(label), "%s, %s", mode, loads[load]);
+    SimBoard_End(label, bytes);
+
+    pinging = 0;
+    if (VHost_Wait(&echoTransfer, TIMEOUT) != VHOST_DONE) {
+
+        printf("%s: ping lost\n", mode);
+        return 0;
+    }
+    printf("%-24s %8.1f us average, %.1f us worst CDC round trip, "
+           "%u errors\n",
+           "", totalRoundTrip / 1000.0 / pings, worstRoundTrip / 1000.0,
+           pingErrors);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+//         Main function
+//------------------------------------------------------------------------------
+
+int main(int argc, char **argv)
+{
+    unsigned char highSpeed = !((argc > 1) && (strcmp(argv[1], "fs") == 0));
+    unsigned char command[10];
+    unsigned char data[8];
+    unsigned int i;
+
+    SimBoard_Initialize(highSpeed, DeviceLoop);
+
+    // Device: the RAM disk is copied through the MSD buffer, by the slow
+    // media methods
+    MEDRamDisk_Initialize(&medias[0],
+                          DISKBLOCK,
+                          (unsigned int) (uintptr_t) disk / DISKBLOCK,
+                          DISKSIZE / DISKBLOCK);
+    numMedias = 1;
+    medias[0].mappedRD = 0;
+    medias[0].mappedWR = 0;
+    diskRead = medias[0].read;
+    diskWrite = medias[0].write;
+    medias[0].read = SlowRead;
+    medias[0].write = SlowWrite;
+    LUN_Init(&lun, &medias[0], msdBuffer, MSDBUFFERSIZE, 0, 0, 1, 0, 0);
+    CDCMSDDDriver_Initialize(&lun, 1);
+    COMPOSITEDScheduler_Add(&cdcFunction, CdcRun, 0, CDCPRIORITY, 1);
+    USBD_Connect();
+
+    // Host
+    VHost_SetFrameHandler(FrameStarted);
+    if (!VHost_Enumerate()) {
+
+        return 1;
+    }
+    printf("CDC + MSD, %s speed, media access %llu/%llu us (read/write) "
+           "+ %u ns/byte, %u-byte pings\n",
+           VHost_IsHighSpeed() ? "high" : "full", READACCESS / 1000,
+           WRITEACCESS / 1000, MEDIATIME, PINGSIZE);
+
+    // The first command after the reset reports a unit attention
+    memset(command, 0, sizeof(command));
+    for (i = 0; Command(command, 6, 0, 0, 0) != 0; i++) {
+
+        if (i > 8) {
+
+            printf("MSD not ready\n");
+            return 1;
+        }
+    }
+    memset(command, 0, sizeof(command));
+    command[0] = 0x25;
+    if ((Command(command, 10, 1, data, 8) != 0)
+        || ((unsigned int) ((data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3])
+            != DISKSIZE / DISKBLOCK - 1)) {
+
+        printf("READ CAPACITY failed\n");
+        return 1;
+    }
+    for (i = 0; i < COMMANDSIZE; i++) {
+
+        pattern[i] = (i * 7 + (i >> 9)) & 0xFF;
+    }
+
+    // The CDC echo starts once the device is configured, as the application
+    // does from its configuration callback
+    COMPOSITEDScheduler_Signal(&cdcFunction);
+
+    scheduled = 0;
+    if (!Run("polled", 0) || !Run("polled", 1) || !Run("polled", 2)) {
+
+        return 1;
+    }
+    scheduled = 1;
+    if (!Run("scheduled", 0) || !Run("scheduled", 1) || !Run("scheduled", 2)) {
+
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,265 @@
+//------------------------------------------------------------------------------
+// HID transfer benchmark on the simulated UDPHS controller.
+//
+// The device main loop echoes each report read with HIDDTransferDriver_Read()
+// through HIDDTransferDriver_Write(), as the usb-device-hid-transfer example
+// does with its buttons and LEDs. The host keeps an IN transfer pending on
+// the interrupt IN endpoint and sends numbered output reports, first one at
+// a time, then with several queued on the interrupt OUT endpoint. Last, the
+// device streams numbered reports as fast as the driver queue accepts them,
+// as a telemetry source does. Each test reports the report rate, the reports
+// lost and the latency from the report being sent (or queued by the device)
+// to its reception by the host.
+//
+// hidbatchbench is the same program built with 4 reports per transaction.
+//
+//   ./hidbench [fs]
+//------------------------------------------------------------------------------
+
+#include "simboard.h"
+#include "udphssim.h"
+#include "vhost.h"
+
+#include <board.h>
+#include <usb/device/core/USBD.h>
+#include <usb/device/hid-transfer/HIDDTransferDriver.h>
+#include <usb/device/hid-transfer/HIDDTransferDriverDesc.h>
+
+#include <stdio.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+#define REPORTSIZE          HIDDTransferDriver_REPORTSIZE
+#define PACKETSIZE          HIDDTransferDriver_PACKETSIZE
+
+/// Reports sent by each test, and reports queued by the burst test.
+#define NUMREPORTS          1000
+#define QUEUED              4
+
+/// Endpoints seen from the host.
+#define INTERRUPTOUT        HIDDTransferDriverDescriptors_INTERRUPTOUT
+#define INTERRUPTIN         (0x80 | HIDDTransferDriverDescriptors_INTERRUPTIN)
+
+/// Idle time after the last report, in ns.
+#define DRAIN               10000000000ULL
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+/// Device side.
+static unsigned char deviceReport[REPORTSIZE];
+static unsigned int deviceDropped;
+static unsigned char streaming;
+static unsigned int streamed;
+static unsigned int queueFull;
+
+/// Host side.
+static unsigned char outReports[QUEUED][REPORTSIZE];
+static unsigned char inReport[PACKETSIZE];
+static VHostTransfer outTransfers[QUEUED];
+static VHostTransfer inTransfer;
+static unsigned long long sentAt[NUMREPORTS];
+static unsigned int nextReport;
+static unsigned int received;
+static unsigned int outOfOrder;
+static unsigned long long totalLatency;
+static unsigned long long worstLatency;
+static unsigned long long lastReceived;
+
+//------------------------------------------------------------------------------
+//         Device
+//------------------------------------------------------------------------------
+
+static void DeviceLoop(void)
+{
+    unsigned short length;
+
+    // Telemetry: queue reports until the driver refuses them
+    if (streaming) {
+
+        while (streamed < NUMREPORTS) {
+
+            memset(deviceReport, streamed & 0xFF, REPORTSIZE);
+            memcpy(deviceReport, &streamed, sizeof(streamed));
+            sentAt[streamed] = VHost_GetTime();
+            if (HIDDTransferDriver_Write(deviceReport, REPORTSIZE, 0, 0)
+                != USBD_STATUS_SUCCESS) {
+
+                queueFull++;
+                break;
+            }
+            streamed++;
+        }
+        return;
+    }
+
+    // Echo
+    length = HIDDTransferDriver_Read(deviceReport, REPORTSIZE);
+    if (length > 0) {
+
+        if (HIDDTransferDriver_Write(deviceReport, length, 0, 0)
+            != USBD_STATUS_SUCCESS) {
+
+            deviceDropped++;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+//         Host
+//------------------------------------------------------------------------------
+
+static void SendReport(VHostTransfer *pTransfer)
+{
+    unsigned int number = nextReport++;
+
+    memset(pTransfer->pData, number & 0xFF, REPORTSIZE);
+    memcpy(pTransfer->pData, &number, sizeof(number));
+    pTransfer->endpoint = INTERRUPTOUT;
+    pTransfer->length = REPORTSIZE;
+    sentAt[number] = VHost_GetTime();
+    VHost_Submit(pTransfer);
+}
+
+static void ReportSent(VHostTransfer *pTransfer)
+{
+    if (nextReport < NUMREPORTS) {
+
+        SendReport(pTransfer);
+    }
+}
+
+static void ReportReceived(VHostTransfer *pTransfer)
+{
+    unsigned int number;
+    unsigned int offset;
+
+    // A transaction carries one or more reports
+    if (pTransfer->status == VHOST_DONE) {
+
+        for (offset = 0;
+             offset + REPORTSIZE <= pTransfer->actual;
+             offset += REPORTSIZE) {
+
+            memcpy(&number, pTransfer->pData + offset, sizeof(number));
+            if (number < NUMREPORTS) {
+
+                unsigned long long latency = pTransfer->completed
+                                             - sentAt[number];
+
+                if (number != received) {
+
+                    outOfOrder++;
+                }
+                received++;
+                lastReceived = pTransfer->completed;
+                totalLatency += latency;
+                if (latency > worstLatency) {
+
+                    worstLatency = latency;
+                }
+            }
+        }
+    }
+    VHost_Submit(pTransfer);
+}
+
+static void Run(const char *label, unsigned int queued, unsigned char stream)
+{
+    unsigned long long start;
+    unsigned int dropped = deviceDropped;
+    unsigned int i;
+
+    nextReport = 0;
+    received = 0;
+    outOfOrder = 0;
+    totalLatency = 0;
+    worstLatency = 0;
+    streamed = 0;
+    queueFull = 0;
+
+    SimBoard_Begin();
+    start = VHost_GetTime();
+    if (stream) {
+
+        streaming = 1;
+        while ((received < NUMREPORTS)
+               && ((streamed < NUMREPORTS)
+                   || (VHost_GetTime() < sentAt[NUMREPORTS - 1] + DRAIN))) {
+
+            VHost_RunFrame();
+        }
+        streaming = 0;
+    }
+    else {
+
+        for (i = 0; i < queued; i++) {
+
+            memset(&outTransfers[i], 0, sizeof(VHostTransfer));
+            outTransfers[i].pData = outReports[i];
+            outTransfers[i].callback = ReportSent;
+            SendReport(&outTransfers[i]);
+        }
+        while ((received < NUMREPORTS)
+               && ((nextReport < NUMREPORTS)
+                   || (VHost_GetTime() < sentAt[NUMREPORTS - 1] + DRAIN))) {
+
+            VHost_RunFrame();
+        }
+    }
+    SimBoard_End(label, (stream ? 1ULL : 2ULL) * received * REPORTSIZE);
+    printf("%-24s %8.1f reports/s, %u lost (%u by the device), "
+           "%u out of order, %.1f us average, %.1f us worst latency",
+           "",
+           received ? received * 1e9 / (lastReceived - start) : 0.0,
+           NUMREPORTS - received,
+           deviceDropped - dropped,
+           outOfOrder,
+           received ? totalLatency / 1000.0 / received : 0.0,
+           worstLatency / 1000.0);
+    if (stream) {
+
+        printf(", queue full %u times", queueFull);
+    }
+    printf("\n");
+}
+
+//------------------------------------------------------------------------------
+//         Main function
+//------------------------------------------------------------------------------
+
+int main(int argc, char **argv)
+{
+    unsigned char highSpeed = !((argc > 1) && (strcmp(argv[1], "fs") == 0));
+
+    SimBoard_Initialize(highSpeed, DeviceLoop);
+    HIDDTransferDriver_Initialize();
+    USBD_Connect();
+
+    if (!VHost_Enumerate()) {
+
+        return 1;
+    }
+    printf("HID transfer, %s speed, %u-byte reports, up to %u per %u-byte "
+           "transaction, %u-deep queues\n",
+           VHost_IsHighSpeed() ? "high" : "full", REPORTSIZE,
+           VHost_GetMaxPacketSize(INTERRUPTIN) / REPORTSIZE,
+           VHost_GetMaxPacketSize(INTERRUPTIN),
+           HIDDTransferDriver_QUEUEDEPTH);
+
+    memset(&inTransfer, 0, sizeof(inTransfer));
+    inTransfer.endpoint = INTERRUPTIN;
+    inTransfer.pData = inReport;
+    inTransfer.length = VHost_GetMaxPacketSize(INTERRUPTIN);
+    inTransfer.callback = ReportReceived;
+    VHost_Submit(&inTransfer);
+
+    Run("paced reports", 1, 0);
+    Run("queued reports", QUEUED, 0);
+    Run("device stream", 0, 1);
+    return 0;
+}
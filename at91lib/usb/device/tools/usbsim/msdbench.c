@@ -0,0 +1,312 @@
+//------------------------------------------------------------------------------
+// Mass storage benchmark on the simulated UDPHS controller.
+//
+// The device exposes two RAM disks, as msd-ramdisk does on the board: LUN 0
+// uses the mapped path (the USB DMA moves the data between the host and the
+// disk) and LUN 1 copies every block through the MSD FIFO. The virtual host
+// speaks Bulk-Only Transport to them: sequential writes and reads with
+// verification, then single-block reads at random places for the command
+// latency.
+//
+//   ./msdbench [fs]
+//------------------------------------------------------------------------------
+
+#include "simboard.h"
+#include "udphssim.h"
+#include "vhost.h"
+
+#include <board.h>
+#include <memories/MEDRamDisk.h>
+#include <usb/device/core/USBD.h>
+#include <usb/device/massstorage/MSDDriver.h>
+#include <usb/device/massstorage/MSDDriverDescriptors.h>
+#include <usb/device/massstorage/MSDLun.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+#define DISKBLOCK           512
+#define DISKSIZE            (1024 * 1024)
+#define MSDBUFFERSIZE       (16 * DISKBLOCK)
+
+/// Size of the READ(10)/WRITE(10) commands of the sequential tests.
+#define COMMANDSIZE         (64 * 1024)
+/// Single-block reads of the latency test.
+#define LATENCYREADS        200
+
+/// Endpoints seen from the host.
+#define BULKOUT             MSDDriverDescriptors_BULKOUT
+#define BULKIN              (0x80 | MSDDriverDescriptors_BULKIN)
+
+/// One second of bus time, in ns.
+#define TIMEOUT             1000000000ULL
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+Media medias[2];
+static MSDLun luns[2];
+static unsigned char msdBuffer[2][MSDBUFFERSIZE];
+static unsigned char disks[2][DISKSIZE] __attribute__((aligned(DISKBLOCK)));
+
+/// Host buffers.
+static unsigned char pattern[DISKSIZE];
+static unsigned char readBack[DISKSIZE];
+static unsigned int tag;
+/// Bus time from the CBW submission to the CSW reception of the last command.
+static unsigned long long commandTime;
+
+//------------------------------------------------------------------------------
+//         Local functions
+//------------------------------------------------------------------------------
+
+static void DeviceLoop(void)
+{
+    MSDDriver_StateMachine();
+}
+
+static void Submit(VHostTransfer *pTransfer,
+                   unsigned char endpoint,
+                   void *pData,
+                   unsigned int length)
+{
+    memset(pTransfer, 0, sizeof(VHostTransfer));
+    pTransfer->endpoint = endpoint;
+    pTransfer->pData = pData;
+    pTransfer->length = length;
+    VHost_Submit(pTransfer);
+}
+
+/// Runs a Bulk-Only Transport command. The three stages are queued at once,
+/// as a host controller driver does, so that the device is never waiting
+/// for the host to submit the next one.
+/// \return Status of the CSW, or -1 on a transport error
+static int Command(unsigned char lun,
+                   const unsigned char *pCommand,
+                   unsigned char commandLength,
+                   unsigned char in,
+                   void *pData,
+                   unsigned int length)
+{
+    unsigned char cbw[31];
+    unsigned char csw[13];
+    VHostTransfer transfers[3];
+
+    memset(cbw, 0, sizeof(cbw));
+    cbw[0] = 'U'; cbw[1] = 'S'; cbw[2] = 'B'; cbw[3] = 'C';
+    tag++;
+    memcpy(&cbw[4], &tag, 4);
+    memcpy(&cbw[8], &length, 4);
+    cbw[12] = in ? 0x80 : 0x00;
+    cbw[13] = lun;
+    cbw[14] = commandLength;
+    memcpy(&cbw[15], pCommand, commandLength);
+
+    Submit(&transfers[0], BULKOUT, cbw, sizeof(cbw));
+    if (length > 0) {
+
+        Submit(&transfers[1], in ? BULKIN : BULKOUT, pData, length);
+    }
+    Submit(&transfers[2], BULKIN, csw, sizeof(csw));
+
+    if ((VHost_Wait(&transfers[2], TIMEOUT) != VHOST_DONE)
+        || (transfers[0].status != VHOST_DONE)
+        || ((length > 0)
+            && ((transfers[1].status != VHOST_DONE) || (transfers[1].actual != length)))
+        || (transfers[2].actual != sizeof(csw))
+        || (memcmp(csw, "USBS", 4) != 0)
+        || (memcmp(&csw[4], &tag, 4) != 0)) {
+
+        return -1;
+    }
+    commandTime = transfers[2].completed - transfers[0].submitted;
+    return csw[12];
+}
+
+static int ReadWrite(unsigned char lun,
+                     unsigned char in,
+                     unsigned int block,
+                     void *pData,
+                     unsigned int length)
+{
+    unsigned char command[10];
+    unsigned int blocks = length / DISKBLOCK;
+
+    memset(command, 0, sizeof(command));
+    command[0] = in ? 0x28 : 0x2A;
+    command[2] = block >> 24;
+    command[3] = block >> 16;
+    command[4] = block >> 8;
+    command[5] = block;
+    command[7] = blocks >> 8;
+    command[8] = blocks;
+
+    return Command(lun, command, sizeof(command), in, pData, length);
+}
+
+static unsigned char Sequential(unsigned char lun, const char *name)
+{
+    char label[32];
+    unsigned int i;
+
+    SimBoard_Begin();
+    for (i = 0; i < DISKSIZE; i += COMMANDSIZE) {
+
+        if (ReadWrite(lun, 0, i / DISKBLOCK, &pattern[i], COMMANDSIZE) != 0) {
+
+            printf("LUN %u: WRITE(10) failed at %u\n", lun, i);
+            return 0;
+        }
+    }
+    snprintf(label, sizeof(label), "%s write", name);
+    SimBoard_End(label, DISKSIZE);
+
+    memset(readBack, 0, sizeof(readBack));
+    SimBoard_Begin();
+    for (i = 0; i < DISKSIZE; i += COMMANDSIZE) {
+
+        if (ReadWrite(lun, 1, i / DISKBLOCK, &readBack[i], COMMANDSIZE) != 0) {
+
+            printf("LUN %u: READ(10) failed at %u\n", lun, i);
+            return 0;
+        }
+    }
+    snprintf(label, sizeof(label), "%s read", name);
+    SimBoard_End(label, DISKSIZE);
+
+    if ((memcmp(readBack, pattern, DISKSIZE) != 0)
+        || (memcmp(disks[lun], pattern, DISKSIZE) != 0)) {
+
+        printf("LUN %u: data mismatch\n", lun);
+        return 0;
+    }
+    return 1;
+}
+
+static unsigned char Latency(unsigned char lun, const char *name)
+{
+    unsigned long long total = 0;
+    unsigned long long worst = 0;
+    unsigned int i;
+
+    srand(lun + 1);
+    SimBoard_Begin();
+    for (i = 0; i < LATENCYREADS; i++) {
+
+        unsigned int block = rand() % (DISKSIZE / DISKBLOCK);
+
+        if ((ReadWrite(lun, 1, block, readBack, DISKBLOCK) != 0)
+            || (memcmp(readBack, &pattern[block * DISKBLOCK], DISKBLOCK) != 0)) {
+
+            printf("LUN %u: READ(10) of block %u failed\n", lun, block);
+            return 0;
+        }
+        total += commandTime;
+        if (commandTime > worst) {
+
+            worst = commandTime;
+        }
+    }
+    SimBoard_End(name, LATENCYREADS * DISKBLOCK);
+    printf("%-24s %8.1f us average, %.1f us worst per 512-byte READ(10)\n",
+           "", total / 1000.0 / LATENCYREADS, worst / 1000.0);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+//         Main function
+//------------------------------------------------------------------------------
+
+int main(int argc, char **argv)
+{
+    unsigned char highSpeed = !((argc > 1) && (strcmp(argv[1], "fs") == 0));
+    unsigned char command[10];
+    unsigned char data[36];
+    unsigned char maxLun = 0;
+    unsigned int i;
+
+    SimBoard_Initialize(highSpeed, DeviceLoop);
+
+    // Device, as msd-ramdisk
+    for (i = 0; i < 2; i++) {
+
+        MEDRamDisk_Initialize(&medias[i],
+                              DISKBLOCK,
+                              (unsigned int) (uintptr_t) disks[i] / DISKBLOCK,
+                              DISKSIZE / DISKBLOCK);
+    }
+    numMedias = 2;
+    medias[1].mappedRD = 0;
+    medias[1].mappedWR = 0;
+    for (i = 0; i < 2; i++) {
+
+        LUN_Init(&luns[i], &medias[i], msdBuffer[i], MSDBUFFERSIZE, 0, 0, 1, 0, 0);
+    }
+    MSDDriver_Initialize(luns, 2);
+    USBD_Connect();
+
+    // Host
+    if (!VHost_Enumerate()) {
+
+        return 1;
+    }
+    printf("MSD, %s speed, %u KB RAM disks\n",
+           VHost_IsHighSpeed() ? "high" : "full", DISKSIZE / 1024);
+
+    if ((VHost_Control(0xA1, 0xFE, 0, 0, 1, &maxLun) != 1) || (maxLun != 1)) {
+
+        printf("GET_MAX_LUN failed\n");
+        return 1;
+    }
+    for (i = 0; i <= maxLun; i++) {
+
+        memset(command, 0, sizeof(command));
+        command[0] = 0x12;
+        command[4] = sizeof(data);
+        if (Command(i, command, 6, 1, data, sizeof(data)) != 0) {
+
+            printf("LUN %u: INQUIRY failed\n", i);
+            return 1;
+        }
+        // The first command after the reset reports a unit attention
+        memset(command, 0, sizeof(command));
+        while (Command(i, command, 6, 0, 0, 0) != 0) {
+
+            if (++maxLun > 8) {
+
+                printf("LUN %u: not ready\n", i);
+                return 1;
+            }
+        }
+        maxLun = 1;
+        memset(command, 0, sizeof(command));
+        command[0] = 0x25;
+        if ((Command(i, command, 10, 1, data, 8) != 0)
+            || ((unsigned int) ((data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3])
+                != DISKSIZE / DISKBLOCK - 1)) {
+
+            printf("LUN %u: READ CAPACITY failed\n", i);
+            return 1;
+        }
+    }
+
+    for (i = 0; i < DISKSIZE; i++) {
+
+        pattern[i] = (i * 7 + (i >> 9)) & 0xFF;
+    }
+    if (!Sequential(0, "mapped")
+        || !Sequential(1, "copy")
+        || !Latency(0, "mapped latency")
+        || !Latency(1, "copy latency")) {
+
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,512 @@
+//------------------------------------------------------------------------------
+// NandFlash translation layer benchmark on the simulated UDPHS controller.
+//
+// The device exposes a MEDNandFlash LUN over a simulated 2 KB page, 128 KB
+// block chip, as msd-nandflash does on the board. The virtual host first
+// writes the whole LUN, so that every logical block is mapped, then runs a
+// file system like workload over Bulk-Only Transport: files of 16 to 256 KB
+// are written in 4 KB clusters allocated first-fit, and random files are
+// deleted whenever more than 70% of the clusters are used. A deleted file is
+// read back and checked first.
+//
+// The chip is aged and the workload run twice with the same random sequence:
+// once as a host that never tells the device about free sectors, and once as
+// a host that sends UNMAP for the whole LUN after the aging (as mkfs does) and
+// for the clusters of every deleted file. The pages programmed and copied by
+// the translation layer are reported for the workload alone.
+//
+//   ./nandbench [fs]
+//------------------------------------------------------------------------------
+
+#include "nandsim.h"
+#include "simboard.h"
+#include "udphssim.h"
+#include "vhost.h"
+
+#include <board.h>
+#include <memories/MEDNandFlash.h>
+#include <memories/nandflash/NandSpareScheme.h>
+#include <memories/nandflash/TranslatedNandFlash.h>
+#include <usb/device/core/USBD.h>
+#include <usb/device/massstorage/MSDDriver.h>
+#include <usb/device/massstorage/MSDDriverDescriptors.h>
+#include <usb/device/massstorage/MSDLun.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Blocks of the chip managed by the translation layer.
+#define NANDBLOCKS          256
+#define SECTORSIZE          512
+#define MSDBUFFERSIZE       (16 * SECTORSIZE)
+
+/// File system geometry and workload.
+#define CLUSTERSIZE         (4 * 1024)
+#define SECTORSPERCLUSTER   (CLUSTERSIZE / SECTORSIZE)
+#define MAXFILECLUSTERS     (256 * 1024 / CLUSTERSIZE)
+#define MINFILECLUSTERS     (16 * 1024 / CLUSTERSIZE)
+#define MAXFILES            4096
+#define USAGELIMIT          70
+/// Host data written by the workload, in LUN sizes.
+#define WORKLOADPASSES      3
+/// Clusters per WRITE command during the aging.
+#define AGINGCLUSTERS       16
+
+/// Endpoints seen from the host.
+#define BULKOUT             MSDDriverDescriptors_BULKOUT
+#define BULKIN              (0x80 | MSDDriverDescriptors_BULKIN)
+
+/// One second of bus time, in ns.
+#define TIMEOUT             1000000000ULL
+
+//------------------------------------------------------------------------------
+//         Local types
+//------------------------------------------------------------------------------
+
+typedef struct {
+
+    unsigned int id;
+    unsigned int numClusters;
+    unsigned int clusters[MAXFILECLUSTERS];
+
+} File;
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+/// Chip: 128 MB, 2 KB pages, 128 KB blocks, copy-back supported.
+static const struct NandFlashModel model = {
+
+    0xF1, NandFlashModel_DATABUS8 | NandFlashModel_COPYBACK,
+    2048, 128, 128, &nandSpareScheme2048
+};
+
+Media medias[1];
+static struct TranslatedNandFlash translatedNf;
+static MSDLun lun;
+static unsigned char msdBuffer[MSDBUFFERSIZE];
+
+/// Host state.
+static unsigned int tag;
+static unsigned int numClusters;
+static unsigned int usedClusters;
+static unsigned char *pClusterUsed;
+static File files[MAXFILES];
+static unsigned int numFiles;
+static unsigned int nextId;
+static unsigned int seed;
+static unsigned char buffer[MAXFILECLUSTERS * CLUSTERSIZE];
+static unsigned char readBack[CLUSTERSIZE];
+static unsigned long long hostBytes;
+
+//------------------------------------------------------------------------------
+//         Local functions
+//------------------------------------------------------------------------------
+
+static void DeviceLoop(void)
+{
+    MSDDriver_StateMachine();
+}
+
+static unsigned int Random(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) & 0xFFFFFF;
+}
+
+static void StoreDword(unsigned char *pBytes, unsigned int value)
+{
+    pBytes[0] = value >> 24;
+    pBytes[1] = value >> 16;
+    pBytes[2] = value >> 8;
+    pBytes[3] = value;
+}
+
+static void Submit(VHostTransfer *pTransfer,
+                   unsigned char endpoint,
+                   void *pData,
+                   unsigned int length)
+{
+    memset(pTransfer, 0, sizeof(VHostTransfer));
+    pTransfer->endpoint = endpoint;
+    pTransfer->pData = pData;
+    pTransfer->length = length;
+    VHost_Submit(pTransfer);
+}
+
+/// Runs a Bulk-Only Transport command.
+/// \return Status of the CSW, or -1 on a transport error
+static int Command(const unsigned char *pCommand,
+                   unsigned char commandLength,
+                   unsigned char in,
+                   void *pData,
+                   unsigned int length)
+{
+    unsigned char cbw[31];
+    unsigned char csw[13];
+    VHostTransfer transfers[3];
+
+    memset(cbw, 0, sizeof(cbw));
+    cbw[0] = 'U'; cbw[1] = 'S'; cbw[2] = 'B'; cbw[3] = 'C';
+    tag++;
+    memcpy(&cbw[4], &tag, 4);
+    memcpy(&cbw[8], &length, 4);
+    cbw[12] = in ? 0x80 : 0x00;
+    cbw[14] = commandLength;
+    memcpy(&cbw[15], pCommand, commandLength);
+
+    Submit(&transfers[0], BULKOUT, cbw, sizeof(cbw));
+    if (length > 0) {
+
+        Submit(&transfers[1], in ? BULKIN : BULKOUT, pData, length);
+    }
+    Submit(&transfers[2], BULKIN, csw, sizeof(csw));
+
+    if ((VHost_Wait(&transfers[2], TIMEOUT) != VHOST_DONE)
+        || (transfers[0].status != VHOST_DONE)
+        || (transfers[2].actual != sizeof(csw))
+        || (memcmp(csw, "USBS", 4) != 0)
+        || (memcmp(&csw[4], &tag, 4) != 0)) {
+
+        return -1;
+    }
+    return csw[12];
+}
+
+/// READ (16) or WRITE (16) of whole clusters.
+static int ReadWrite(unsigned char in,
+                     unsigned int cluster,
+                     unsigned int count,
+                     void *pData)
+{
+    unsigned char command[16];
+
+    memset(command, 0, sizeof(command));
+    command[0] = in ? 0x88 : 0x8A;
+    StoreDword(&command[6], cluster * SECTORSPERCLUSTER);
+    StoreDword(&command[10], count * SECTORSPERCLUSTER);
+    if (!in) {
+
+        hostBytes += count * CLUSTERSIZE;
+    }
+
+    return Command(command, sizeof(command), in, pData, count * CLUSTERSIZE);
+}
+
+/// UNMAP of a list of cluster runs, one descriptor per run.
+static int Unmap(const unsigned int *pClusters, unsigned int count)
+{
+    unsigned char command[10];
+    unsigned char list[8 + 16 * MAXFILECLUSTERS];
+    unsigned int length = 8;
+    unsigned int i, j;
+
+    memset(list, 0, sizeof(list));
+    for (i = 0; i < count; i = j) {
+
+        for (j = i + 1; (j < count) && (pClusters[j] == pClusters[j - 1] + 1); j++);
+        StoreDword(&list[length + 4], pClusters[i] * SECTORSPERCLUSTER);
+        StoreDword(&list[length + 8], (j - i) * SECTORSPERCLUSTER);
+        length += 16;
+    }
+    list[0] = (length - 2) >> 8;
+    list[1] = length - 2;
+    list[2] = (length - 8) >> 8;
+    list[3] = length - 8;
+
+    memset(command, 0, sizeof(command));
+    command[0] = 0x42;
+    command[7] = length >> 8;
+    command[8] = length;
+
+    return Command(command, sizeof(command), 0, list, length);
+}
+
+static void Fill(unsigned char *pData, unsigned int id, unsigned int index)
+{
+    unsigned int i;
+
+    for (i = 0; i < CLUSTERSIZE; i += 4) {
+
+        StoreDword(&pData[i], (id << 12) ^ (index << 20) ^ i);
+    }
+}
+
+/// Writes a new file of the given size, in runs of contiguous clusters.
+static unsigned char CreateFile(unsigned int size)
+{
+    File *pFile = &files[numFiles];
+    unsigned int cluster = 0;
+    unsigned int i, j;
+
+    pFile->id = nextId++;
+    pFile->numClusters = size;
+    for (i = 0; i < size; i++) {
+
+        while (pClusterUsed[cluster]) {
+
+            cluster++;
+        }
+        pClusterUsed[cluster] = 1;
+        pFile->clusters[i] = cluster;
+    }
+    usedClusters += size;
+    numFiles++;
+
+    for (i = 0; i < size; i = j) {
+
+        for (j = i;
+             (j < size) && ((j == i) || (pFile->clusters[j] == pFile->clusters[j - 1] + 1));
+             j++) {
+
+            Fill(&buffer[(j - i) * CLUSTERSIZE], pFile->id, j);
+        }
+        if (ReadWrite(0, pFile->clusters[i], j - i, buffer) != 0) {
+
+            printf("WRITE(16) failed\n");
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/// Checks and deletes a random file.
+static unsigned char DeleteFile(unsigned char unmap)
+{
+    unsigned int index = Random() % numFiles;
+    File *pFile = &files[index];
+    unsigned int i;
+
+    for (i = 0; i < pFile->numClusters; i += pFile->numClusters - 1) {
+
+        Fill(buffer, pFile->id, i);
+        if ((ReadWrite(1, pFile->clusters[i], 1, readBack) != 0)
+            || (memcmp(buffer, readBack, CLUSTERSIZE) != 0)) {
+
+            printf("File %u: cluster %u corrupted\n", pFile->id, i);
+            return 0;
+        }
+        if (pFile->numClusters == 1) {
+
+            break;
+        }
+    }
+    if (unmap && (Unmap(pFile->clusters, pFile->numClusters) != 0)) {
+
+        printf("UNMAP failed\n");
+        return 0;
+    }
+    for (i = 0; i < pFile->numClusters; i++) {
+
+        pClusterUsed[pFile->clusters[i]] = 0;
+    }
+    usedClusters -= pFile->numClusters;
+    *pFile = files[--numFiles];
+
+    return 1;
+}
+
+/// Writes the whole LUN, as a previously used device.
+static unsigned char Age(void)
+{
+    unsigned int cluster;
+    unsigned int count;
+    unsigned int i;
+
+    for (cluster = 0; cluster < numClusters; cluster += count) {
+
+        count = numClusters - cluster;
+        if (count > AGINGCLUSTERS) {
+
+            count = AGINGCLUSTERS;
+        }
+        for (i = 0; i < count; i++) {
+
+            Fill(&buffer[i * CLUSTERSIZE], 0xFFF, cluster + i);
+        }
+        if (ReadWrite(0, cluster, count, buffer) != 0) {
+
+            printf("Aging: WRITE(16) failed\n");
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static unsigned char Workload(unsigned char unmap)
+{
+    unsigned int i;
+    unsigned int size;
+    NandSimStatistics start, end;
+    unsigned long long hostPages, programs, copies;
+
+    memset(pClusterUsed, 0, numClusters);
+    usedClusters = 0;
+    numFiles = 0;
+    nextId = 0;
+    seed = 1;
+
+    MED_Flush(&medias[0]);
+    NandSim_GetStatistics(&start);
+    hostBytes = 0;
+    if (unmap) {
+
+        // As mkfs, release the whole LUN in runs of 64K sectors
+        for (i = 0; i < numClusters; i += 0xFFFF / SECTORSPERCLUSTER) {
+
+            unsigned char command[10];
+            unsigned char list[24];
+            unsigned int count = numClusters - i;
+
+            if (count > 0xFFFF / SECTORSPERCLUSTER) {
+
+                count = 0xFFFF / SECTORSPERCLUSTER;
+            }
+            memset(list, 0, sizeof(list));
+            list[1] = 22;
+            list[3] = 16;
+            StoreDword(&list[12], i * SECTORSPERCLUSTER);
+            StoreDword(&list[16], count * SECTORSPERCLUSTER);
+            memset(command, 0, sizeof(command));
+            command[0] = 0x42;
+            command[8] = sizeof(list);
+            if (Command(command, sizeof(command), 0, list, sizeof(list)) != 0) {
+
+                printf("UNMAP failed\n");
+                return 0;
+            }
+        }
+    }
+
+    while (hostBytes < (unsigned long long) WORKLOADPASSES * numClusters * CLUSTERSIZE) {
+
+        size = MINFILECLUSTERS
+               + Random() % (MAXFILECLUSTERS - MINFILECLUSTERS + 1);
+        while ((numFiles == MAXFILES)
+               || ((usedClusters + size) * 100 > numClusters * USAGELIMIT)) {
+
+            if (!DeleteFile(unmap)) {
+
+                return 0;
+            }
+        }
+        if (!CreateFile(size)) {
+
+            return 0;
+        }
+    }
+    MED_Flush(&medias[0]);
+    NandSim_GetStatistics(&end);
+
+    hostPages = hostBytes / NandFlashModel_GetPageDataSize(&model);
+    programs = end.pagePrograms - start.pagePrograms;
+    copies = end.pageCopies - start.pageCopies;
+    printf("%-10s %10llu %10llu %10llu %10llu %8llu %6.2f\n",
+           unmap ? "unmap" : "no unmap",
+           hostPages,
+           programs,
+           copies,
+           programs + copies - hostPages,
+           end.blockErases - start.blockErases,
+           (double) (programs + copies) / hostPages);
+
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+//         Main function
+//------------------------------------------------------------------------------
+
+int main(int argc, char **argv)
+{
+    unsigned char highSpeed = !((argc > 1) && (strcmp(argv[1], "fs") == 0));
+    unsigned char command[16];
+    unsigned char data[64];
+    unsigned int size;
+    unsigned int pass;
+
+    SimBoard_Initialize(highSpeed, DeviceLoop);
+
+    for (pass = 0; pass < 2; pass++) {
+
+        // Device, as msd-nandflash, on a blank chip
+        NandSim_Initialize(&model);
+        if (TranslatedNandFlash_Initialize(&translatedNf, &model, 0, 0, 0,
+                                           (Pin) {0}, (Pin) {0}, 0, NANDBLOCKS)) {
+
+            printf("TranslatedNandFlash_Initialize failed\n");
+            return 1;
+        }
+        MEDNandFlash_Initialize(&medias[0], &translatedNf);
+        numMedias = 1;
+        LUN_Init(&lun, &medias[0], msdBuffer, MSDBUFFERSIZE, 0, 0, SECTORSIZE, 0, 0);
+        if (pass == 0) {
+
+            MSDDriver_Initialize(&lun, 1);
+            USBD_Connect();
+            if (!VHost_Enumerate()) {
+
+                return 1;
+            }
+        }
+
+        // The first command after a media change reports a unit attention
+        memset(command, 0, sizeof(command));
+        Command(command, 6, 0, 0, 0);
+        if (Command(command, 6, 0, 0, 0) != 0) {
+
+            printf("TEST UNIT READY failed\n");
+            return 1;
+        }
+
+        // READ CAPACITY (16), then the provisioning page
+        memset(command, 0, sizeof(command));
+        command[0] = 0x9E;
+        command[1] = 0x10;
+        command[13] = 32;
+        if ((Command(command, 16, 1, data, 32) != 0) || ((data[14] & 0x80) == 0)) {
+
+            printf("READ CAPACITY(16) failed or LBPME not set\n");
+            return 1;
+        }
+        size = ((data[4] << 24) | (data[5] << 16) | (data[6] << 8) | data[7]) + 1;
+        memset(command, 0, sizeof(command));
+        command[0] = 0x12;
+        command[1] = 0x01;
+        command[2] = 0xB2;
+        command[4] = 8;
+        if ((Command(command, 6, 1, data, 8) != 0) || ((data[5] & 0x80) == 0)) {
+
+            printf("Provisioning VPD page failed or LBPU not set\n");
+            return 1;
+        }
+
+        if (pass == 0) {
+
+            numClusters = size / SECTORSPERCLUSTER;
+            pClusterUsed = malloc(numClusters);
+            printf("NAND FTL, %s speed, %u blocks of %u KB, %u MB LUN, "
+                   "%u%% full, %ux LUN written\n",
+                   VHost_IsHighSpeed() ? "high" : "full",
+                   NANDBLOCKS, model.blockSizeInKBytes,
+                   size / (1024 * 1024 / SECTORSIZE), USAGELIMIT,
+                   WORKLOADPASSES);
+            printf("           host pages   programs     copies   GC pages"
+                   "   erases     WA\n");
+        }
+        if (!Age() || !Workload(pass)) {
+
+            return 1;
+        }
+    }
+
+    return 0;
+}
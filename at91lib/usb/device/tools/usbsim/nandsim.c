@@ -0,0 +1,216 @@
+//------------------------------------------------------------------------------
+// Simulated NandFlash chip. See nandsim.h.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+//         Headers
+//------------------------------------------------------------------------------
+
+#include "nandsim.h"
+
+#include <memories/nandflash/NandCommon.h>
+#include <memories/nandflash/RawNandFlash.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+/// Chip contents, pages of data followed by their spare.
+static unsigned char *pChip;
+static unsigned int pageSize;
+static unsigned int spareSize;
+static unsigned int pagesPerBlock;
+static unsigned int numBlocks;
+
+static NandSimStatistics statistics;
+
+//------------------------------------------------------------------------------
+//         Local functions
+//------------------------------------------------------------------------------
+
+static unsigned char *Page(unsigned short block, unsigned short page)
+{
+    return pChip + ((unsigned long) block * pagesPerBlock + page)
+                   * (pageSize + spareSize);
+}
+
+/// Programs bytes of a page: bits can only go from 1 to 0.
+static void Program(unsigned char *pDest, const unsigned char *pSource,
+                    unsigned int length)
+{
+    unsigned int i;
+
+    for (i = 0; i < length; i++) {
+
+        pDest[i] &= pSource[i];
+    }
+}
+
+//------------------------------------------------------------------------------
+//         Exported functions
+//------------------------------------------------------------------------------
+
+/// Allocates an erased chip of the given model.
+void NandSim_Initialize(const struct NandFlashModel *model)
+{
+    pageSize = NandFlashModel_GetPageDataSize(model);
+    spareSize = NandFlashModel_GetPageSpareSize(model);
+    pagesPerBlock = NandFlashModel_GetBlockSizeInPages(model);
+    numBlocks = NandFlashModel_GetDeviceSizeInBlocks(model);
+
+    free(pChip);
+    pChip = malloc((unsigned long) numBlocks * pagesPerBlock
+                   * (pageSize + spareSize));
+    if (pChip == 0) {
+
+        printf("NandSim_Initialize: out of memory\n");
+        exit(1);
+    }
+    memset(pChip, 0xFF, (unsigned long) numBlocks * pagesPerBlock
+                        * (pageSize + spareSize));
+    memset(&statistics, 0, sizeof(statistics));
+}
+
+void NandSim_GetStatistics(NandSimStatistics *pStatistics)
+{
+    *pStatistics = statistics;
+}
+
+unsigned char RawNandFlash_Initialize(
+    struct RawNandFlash *raw,
+    const struct NandFlashModel *model,
+    unsigned int commandAddress,
+    unsigned int addressAddress,
+    unsigned int dataAddress,
+    const Pin pinChipEnable,
+    const Pin pinReadyBusy)
+{
+    if (model == 0) {
+
+        return NandCommon_ERROR_UNKNOWNMODEL;
+    }
+    raw->model = *model;
+    raw->commandAddress = commandAddress;
+    raw->addressAddress = addressAddress;
+    raw->dataAddress = dataAddress;
+    raw->pinChipEnable = pinChipEnable;
+    raw->pinReadyBusy = pinReadyBusy;
+
+    return 0;
+}
+
+void RawNandFlash_Reset(const struct RawNandFlash *raw)
+{
+}
+
+unsigned int RawNandFlash_ReadId(const struct RawNandFlash *raw)
+{
+    return raw->model.deviceId << 8;
+}
+
+unsigned char RawNandFlash_EraseBlock(
+    const struct RawNandFlash *raw,
+    unsigned short block)
+{
+    if (block >= numBlocks) {
+
+        return NandCommon_ERROR_CANNOTERASE;
+    }
+    memset(Page(block, 0), 0xFF, pagesPerBlock * (pageSize + spareSize));
+    statistics.blockErases++;
+
+    return 0;
+}
+
+unsigned char RawNandFlash_ReadPage(
+    const struct RawNandFlash *raw,
+    unsigned short block,
+    unsigned short page,
+    void *data,
+    void *spare)
+{
+    if ((block >= numBlocks) || (page >= pagesPerBlock)) {
+
+        return NandCommon_ERROR_CANNOTREAD;
+    }
+    if (data) {
+
+        memcpy(data, Page(block, page), pageSize);
+    }
+    if (spare) {
+
+        memcpy(spare, Page(block, page) + pageSize, spareSize);
+    }
+    statistics.pageReads++;
+
+    return 0;
+}
+
+unsigned char RawNandFlash_WritePage(
+    const struct RawNandFlash *raw,
+    unsigned short block,
+    unsigned short page,
+    void *data,
+    void *spare)
+{
+    if ((block >= numBlocks) || (page >= pagesPerBlock)) {
+
+        return NandCommon_ERROR_CANNOTWRITE;
+    }
+    if (data) {
+
+        Program(Page(block, page), data, pageSize);
+        statistics.pagePrograms++;
+    }
+    else {
+
+        statistics.sparePrograms++;
+    }
+    if (spare) {
+
+        Program(Page(block, page) + pageSize, spare, spareSize);
+    }
+
+    return 0;
+}
+
+unsigned char RawNandFlash_CopyPage(
+    const struct RawNandFlash *raw,
+    unsigned short sourceBlock,
+    unsigned short sourcePage,
+    unsigned short destBlock,
+    unsigned short destPage)
+{
+    if ((sourceBlock >= numBlocks) || (destBlock >= numBlocks)
+        || (sourcePage >= pagesPerBlock) || (destPage >= pagesPerBlock)) {
+
+        return NandCommon_ERROR_CANNOTCOPY;
+    }
+    Program(Page(destBlock, destPage), Page(sourceBlock, sourcePage),
+            pageSize + spareSize);
+    statistics.pageCopies++;
+
+    return 0;
+}
+
+unsigned char RawNandFlash_CopyBlock(
+    const struct RawNandFlash *raw,
+    unsigned short sourceBlock,
+    unsigned short destBlock)
+{
+    unsigned short i;
+
+    for (i = 0; i < pagesPerBlock; i++) {
+
+        if (RawNandFlash_CopyPage(raw, sourceBlock, i, destBlock, i)) {
+
+            return NandCommon_ERROR_BADBLOCK;
+        }
+    }
+
+    return 0;
+}
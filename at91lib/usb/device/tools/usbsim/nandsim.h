@@ -0,0 +1,50 @@
+//------------------------------------------------------------------------------
+// Simulated NandFlash chip, to run the NandFlash translation layers in a host
+// process.
+//
+// Replaces RawNandFlash.c: the RawNandFlash_xxx functions work on a copy of
+// the chip kept in host memory, with the semantics of the NandFlash (a page
+// program can only clear bits, an erase sets the whole block to 0xFF). The
+// operations are counted so that the write amplification of the upper layers
+// can be measured.
+//------------------------------------------------------------------------------
+
+#ifndef NANDSIM_H
+#define NANDSIM_H
+
+//------------------------------------------------------------------------------
+//         Headers
+//------------------------------------------------------------------------------
+
+#include <memories/nandflash/NandFlashModel.h>
+
+//------------------------------------------------------------------------------
+//         Types
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Operation counters of the simulated NandFlash.
+//------------------------------------------------------------------------------
+typedef struct {
+
+    /// Pages programmed with data, and spare-only programs.
+    unsigned long long pagePrograms;
+    unsigned long long sparePrograms;
+    /// Pages moved inside the chip by the copy-back command.
+    unsigned long long pageCopies;
+    /// Blocks erased.
+    unsigned long long blockErases;
+    /// Page reads, data or spare.
+    unsigned long long pageReads;
+
+} NandSimStatistics;
+
+//------------------------------------------------------------------------------
+//         Exported functions
+//------------------------------------------------------------------------------
+
+extern void NandSim_Initialize(const struct NandFlashModel *model);
+
+extern void NandSim_GetStatistics(NandSimStatistics *pStatistics);
+
+#endif //#ifndef NANDSIM_H
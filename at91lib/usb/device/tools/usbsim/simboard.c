@@ -0,0 +1,127 @@
+//------------------------------------------------------------------------------
+// Board glue and reporting shared by the benchmarks (see simboard.h).
+//------------------------------------------------------------------------------
+
+#include "simboard.h"
+#include "udphssim.h"
+#include "vhost.h"
+
+#include <board.h>
+#include <usb/device/core/USBD.h>
+#include <usb/device/core/USBDCallbacks.h>
+#include <utility/defer.h>
+
+#include <stdio.h>
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+static UDPHSSimStatistics startDevice;
+static VHostStatistics startBus;
+static unsigned long long startTime;
+
+//------------------------------------------------------------------------------
+//         Board functions
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Hooks the interrupt handler of the USB driver to the simulated controller,
+/// and the deferred work of the drivers built with USBD_DEFERRED.
+//------------------------------------------------------------------------------
+void USBDCallbacks_Initialized(void)
+{
+    UDPHSSim_SetIrqHandler(UDPD_IrqHandler);
+    UDPHSSim_SetDeferredHandler(DEFER_Run);
+}
+
+void IRQ_EnableIT(unsigned int source)
+{
+    if (source == AT91C_ID_UDPHS) {
+
+        UDPHSSim_EnableIrq(1);
+    }
+}
+
+void IRQ_DisableIT(unsigned int source)
+{
+    if (source == AT91C_ID_UDPHS) {
+
+        UDPHSSim_EnableIrq(0);
+    }
+}
+
+unsigned char LED_Configure(unsigned int led)
+{
+    return 1;
+}
+
+unsigned char LED_Set(unsigned int led)
+{
+    return 1;
+}
+
+unsigned char LED_Clear(unsigned int led)
+{
+    return 1;
+}
+
+unsigned char LED_Toggle(unsigned int led)
+{
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+//         Exported functions
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Maps the simulated controller and initializes the virtual host. Must be
+/// called before the USB driver is initialized.
+//------------------------------------------------------------------------------
+void SimBoard_Initialize(unsigned char highSpeed, void (*deviceLoop)(void))
+{
+    UDPHSSim_Initialize();
+    VHost_Initialize(highSpeed, deviceLoop);
+}
+
+//------------------------------------------------------------------------------
+/// Starts a measurement.
+//------------------------------------------------------------------------------
+void SimBoard_Begin(void)
+{
+    UDPHSSim_GetStatistics(&startDevice);
+    UDPHSSim_ClearLongestIrq();
+    VHost_GetStatistics(&startBus);
+    startTime = VHost_GetTime();
+}
+
+//------------------------------------------------------------------------------
+/// Ends a measurement and prints its figures.
+/// \param label Name of the measurement.
+/// \param bytes Payload moved during the measurement.
+//------------------------------------------------------------------------------
+void SimBoard_End(const char *label, unsigned long long bytes)
+{
+    UDPHSSimStatistics device;
+    VHostStatistics bus;
+    unsigned long long time = VHost_GetTime() - startTime;
+    double kilobytes = (bytes > 0) ? bytes / 1024.0 : 1.0;
+
+    UDPHSSim_GetStatistics(&device);
+    VHost_GetStatistics(&bus);
+
+    printf("%-24s %8.0f KB/s | CPU %7.1f us/KB | regs %6.1f/KB | "
+           "IRQ %5.2f/KB %5.1f us/KB %6.1f us max | NAK %4.1f%%\n",
+           label,
+           (time > 0) ? bytes * 1e9 / 1024.0 / time : 0.0,
+           (device.cpuTime - startDevice.cpuTime) / 1000.0 / kilobytes,
+           (device.registerReads + device.registerWrites
+            - startDevice.registerReads - startDevice.registerWrites) / kilobytes,
+           (device.interrupts - startDevice.interrupts) / kilobytes,
+           (device.irqTime - startDevice.irqTime) / 1000.0 / kilobytes,
+           device.longestIrq / 1000.0,
+           (bus.transactions > startBus.transactions) ?
+               (bus.naks - startBus.naks) * 100.0
+               / (bus.transactions - startBus.transactions) : 0.0);
+}
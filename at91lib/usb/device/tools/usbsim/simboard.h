@@ -0,0 +1,27 @@
+//------------------------------------------------------------------------------
+// Board glue and reporting shared by the benchmarks of the USB simulator.
+//
+// Provides what the board and the startup code provide on the SAM3U: the
+// UDPHS interrupt is hooked by USBDCallbacks_Initialized(), masked and
+// unmasked with IRQ_DisableIT() and IRQ_EnableIT(), and the LEDs are
+// ignored. A measurement is bracketed by SimBoard_Begin() and SimBoard_End(),
+// which prints one line with the throughput in bus time, the device time per
+// KB, the controller activity per KB, and the time spent in the interrupt
+// handler per KB and in its longest call, which is the worst latency it adds
+// to the other interrupts of the same or a lower priority.
+//------------------------------------------------------------------------------
+
+#ifndef SIMBOARD_H
+#define SIMBOARD_H
+
+//------------------------------------------------------------------------------
+//         Exported functions
+//------------------------------------------------------------------------------
+
+extern void SimBoard_Initialize(unsigned char highSpeed, void (*deviceLoop)(void));
+
+extern void SimBoard_Begin(void);
+
+extern void SimBoard_End(const char *label, unsigned long long bytes);
+
+#endif //#ifndef SIMBOARD_H
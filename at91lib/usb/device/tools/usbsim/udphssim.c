@@ -0,0 +1,1357 @@
+//------------------------------------------------------------------------------
+// Simulated UDPHS controller (see udphssim.h).
+//
+// Model of the controller:
+// - Each endpoint has up to three banks. A bank holds a packet received from
+//   the host, or a packet validated by the device for the host to fetch. The
+//   device reads and writes the oldest bank through the FIFO window of the
+//   endpoint, whose address is ignored: every access moves the data pointer
+//   of the bank, as in UDPHS_ReadRequest().
+// - EPTSTA and INTSTA are derived from the banks, the endpoint flags and the
+//   DMA channels after every change, so that reads only have to be trapped
+//   for the clear-on-read DMA status.
+// - A DMA channel moves data as soon as it is enabled and a bank is free (IN)
+//   or ready (OUT). A buffer length of zero stands for 64 KB, as used by
+//   USBD_UDPHS.c for DMA_MAX_FIFO_SIZE. Descriptors are read from memory when
+//   they are loaded, like the hardware: a link added to a descriptor after it
+//   has been loaded is not seen.
+// - Isochronous packets are not handshaked: an OUT packet finding no free
+//   bank and an IN token finding no packet are counted as isoErrors.
+//------------------------------------------------------------------------------
+
+#define _GNU_SOURCE
+
+#include <board.h>
+#include "udphssim.h"
+
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+
+#if !defined(__x86_64__) || !defined(__linux__)
+#error The UDPHS simulator runs on x86-64 Linux only.
+#endif
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+#define PAGESIZE            4096
+
+/// Register block, one page.
+#define UDPHS_ADDRESS       ((unsigned long) AT91C_BASE_UDPHS)
+#define UDPHS_SIZE          PAGESIZE
+/// Endpoint FIFO windows, 64 KB each.
+#define FIFO_ADDRESS        ((unsigned long) AT91C_BASE_UDPHS_EPTFIFO)
+#define FIFO_WINDOW         sizeof(AT91C_BASE_UDPHS_EPTFIFO->UDPHS_READEPT0)
+#define FIFO_SIZE           (BOARD_USB_NUMENDPOINTS * FIFO_WINDOW)
+/// PMC and PIO controllers, plain memory.
+#define SYSTEM_ADDRESS      0x400E0000UL
+#define SYSTEM_SIZE         (2 * PAGESIZE)
+
+#define NUMENDPOINTS        BOARD_USB_NUMENDPOINTS
+#define MAXBANKS            3
+#define MAXBANKSIZE         1024
+
+/// Register offsets.
+#define OFFSET(field)       offsetof(AT91S_UDPHS, field)
+#define EPT_OFFSET          OFFSET(UDPHS_EPT)
+#define EPT_SIZE            sizeof(AT91S_UDPHS_EPT)
+#define DMA_OFFSET          OFFSET(UDPHS_DMA)
+#define DMA_SIZE            sizeof(AT91S_UDPHS_DMA)
+
+/// Registers of an endpoint and of a DMA channel, through the alias. The
+/// header declares UDPHS_DMA[6], so channel 6 is addressed past the array.
+#define EPT(ep)             (&(pUdphs->UDPHS_EPT[ep]))
+#define DMA(ch)             ((volatile AT91PS_UDPHS_DMA) \
+                             ((volatile unsigned char *) pUdphs + DMA_OFFSET \
+                              + (ch) * DMA_SIZE))
+
+/// INTSTA bits not derived from the endpoints and DMA channels.
+#define INTSTA_EVENTS       (AT91C_UDPHS_DET_SUSPD | AT91C_UDPHS_MICRO_SOF \
+                             | AT91C_UDPHS_IEN_SOF | AT91C_UDPHS_ENDRESET \
+                             | AT91C_UDPHS_WAKE_UP | AT91C_UDPHS_ENDOFRSM \
+                             | AT91C_UDPHS_UPSTR_RES)
+/// EPTSTA bits kept by the endpoints.
+#define EPTSTA_FLAGS        (AT91C_UDPHS_FRCESTALL | AT91C_UDPHS_ERR_OVFLW \
+                             | AT91C_UDPHS_TX_COMPLT | AT91C_UDPHS_STALL_SNT \
+                             | AT91C_UDPHS_NAK_IN | AT91C_UDPHS_NAK_OUT)
+/// EPTCTL bits enabling an interrupt on the same EPTSTA bit.
+#define EPTCTL_INTERRUPTS   (AT91C_UDPHS_ERR_OVFLW | AT91C_UDPHS_RX_BK_RDY \
+                             | AT91C_UDPHS_TX_COMPLT | AT91C_UDPHS_RX_SETUP \
+                             | AT91C_UDPHS_STALL_SNT | AT91C_UDPHS_NAK_IN \
+                             | AT91C_UDPHS_NAK_OUT)
+/// DMASTATUS bits cleared when the register is read.
+#define DMASTATUS_EVENTS    (AT91C_UDPHS_END_TR_ST | AT91C_UDPHS_END_BF_ST \
+                             | AT91C_UDPHS_DESC_LDST)
+
+/// Register and FIFO accesses allowed in one call of the device code, to
+/// catch a device polling a bit the model never sets.
+#define MAXACCESSES         200000
+
+//------------------------------------------------------------------------------
+//         Local types
+//------------------------------------------------------------------------------
+
+/// Packet buffer of an endpoint.
+typedef struct {
+
+    unsigned char data[MAXBANKSIZE];
+    unsigned int count;
+    /// Validated by the device, for the host to fetch.
+    unsigned char in;
+    /// Holds a SETUP packet.
+    unsigned char setup;
+
+} Bank;
+
+/// State of an endpoint besides its registers.
+typedef struct {
+
+    Bank banks[MAXBANKS];
+    /// Oldest busy bank.
+    unsigned char head;
+    /// Busy banks, starting at head.
+    unsigned char busy;
+    /// Data toggle.
+    unsigned char toggle;
+    /// Bytes already read from the oldest bank.
+    unsigned int read;
+    /// Bytes written in the first free bank.
+    unsigned int fill;
+    /// EPTSTA_FLAGS.
+    unsigned int flags;
+
+} Endpoint;
+
+/// Progress of a DMA channel.
+typedef struct {
+
+    unsigned int address;
+    unsigned int count;
+
+} Channel;
+
+/// Access being single stepped.
+typedef struct {
+
+    unsigned char pending;
+    unsigned char write;
+    unsigned char fifo;
+    unsigned long address;
+    unsigned int size;
+    unsigned int previous;
+
+} Access;
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+/// Writable aliases of the register block and of the FIFO windows.
+static volatile AT91PS_UDPHS pUdphs;
+static unsigned char *pFifo;
+
+static Endpoint endpoints[NUMENDPOINTS];
+static Channel channels[NUMENDPOINTS];
+/// INTSTA_EVENTS bits set.
+static unsigned int events;
+static unsigned char highSpeed;
+static void (*irqHandler)(void);
+static unsigned char irqEnabled = 1;
+static unsigned int (*deferredHandler)(void);
+static unsigned int deferredRuns;
+
+static Access trapped;
+static UDPHSSimStatistics statistics;
+
+/// Device code timing.
+static unsigned char inDevice;
+static unsigned long long resumed;
+static unsigned int accesses;
+
+//------------------------------------------------------------------------------
+//         Local functions
+//------------------------------------------------------------------------------
+
+static unsigned long long Now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/// Device time so far, including the device code running now.
+static unsigned long long DeviceTime(void)
+{
+    return statistics.cpuTime + (inDevice ? Now() - resumed : 0);
+}
+
+static void Fatal(const char *message, unsigned long value)
+{
+    fprintf(stderr, "udphssim: %s (0x%lX)\n", message, value);
+    fprintf(stderr, "udphssim: CTRL %08X IEN %08X INTSTA %08X\n",
+            pUdphs->UDPHS_CTRL, pUdphs->UDPHS_IEN, pUdphs->UDPHS_INTSTA);
+    exit(2);
+}
+
+//------------------------------------------------------------------------------
+// Endpoint configuration
+//------------------------------------------------------------------------------
+
+static unsigned int MaxPacketSize(unsigned char ep)
+{
+    return 8 << (EPT(ep)->UDPHS_EPTCFG & AT91C_UDPHS_EPT_SIZE);
+}
+
+static unsigned int NumBanks(unsigned char ep)
+{
+    return (EPT(ep)->UDPHS_EPTCFG & AT91C_UDPHS_BK_NUMBER) >> 6;
+}
+
+static unsigned int Type(unsigned char ep)
+{
+    return EPT(ep)->UDPHS_EPTCFG & AT91C_UDPHS_EPT_TYPE;
+}
+
+static unsigned char IsIn(unsigned char ep)
+{
+    return (EPT(ep)->UDPHS_EPTCFG & AT91C_UDPHS_EPT_DIR) != 0;
+}
+
+static unsigned char IsEnabled(unsigned char ep)
+{
+    return ((EPT(ep)->UDPHS_EPTCTL & AT91C_UDPHS_EPT_ENABL) != 0)
+           && ((EPT(ep)->UDPHS_EPTCFG & AT91C_UDPHS_EPT_MAPD) != 0);
+}
+
+static unsigned char IsConnected(void)
+{
+    return (pUdphs->UDPHS_CTRL & (AT91C_UDPHS_EN_UDPHS | AT91C_UDPHS_DETACH))
+           == AT91C_UDPHS_EN_UDPHS;
+}
+
+//------------------------------------------------------------------------------
+// Derived registers
+//------------------------------------------------------------------------------
+
+static void Update(void)
+{
+    unsigned int intsta = events;
+    unsigned char ep;
+
+    for (ep = 0; ep < NUMENDPOINTS; ep++) {
+
+        Endpoint *pEndpoint = &(endpoints[ep]);
+        Bank *pHead = &(pEndpoint->banks[pEndpoint->head]);
+        unsigned int ctl = EPT(ep)->UDPHS_EPTCTL;
+        unsigned int sta = pEndpoint->flags;
+
+        sta |= (pEndpoint->toggle << 6) & AT91C_UDPHS_TOGGLESQ_STA;
+        sta |= (pEndpoint->head << 16) & AT91C_UDPHS_CURRENT_BANK;
+        sta |= (pEndpoint->busy << 18) & AT91C_UDPHS_BUSY_BANK_STA;
+        if (pEndpoint->busy > 0) {
+
+            if (pHead->in) {
+
+                sta |= AT91C_UDPHS_TX_PK_RDY;
+            }
+            else {
+
+                sta |= pHead->setup ? AT91C_UDPHS_RX_SETUP : AT91C_UDPHS_RX_BK_RDY;
+                sta |= (pHead->count << 20) & AT91C_UDPHS_BYTE_COUNT;
+            }
+        }
+        EPT(ep)->UDPHS_EPTSTA = sta;
+
+        if (((ctl & AT91C_UDPHS_EPT_ENABL) != 0)
+            && (((ctl & sta & EPTCTL_INTERRUPTS) != 0)
+                || (((ctl & AT91C_UDPHS_TX_PK_RDY) != 0)
+                    && ((sta & AT91C_UDPHS_TX_PK_RDY) == 0)))) {
+
+            intsta |= 1 << 8 << ep;
+        }
+    }
+
+    for (ep = 1; ep < NUMENDPOINTS; ep++) {
+
+        unsigned int status = DMA(ep)->UDPHS_DMASTATUS;
+        unsigned int control = DMA(ep)->UDPHS_DMACONTROL;
+
+        if ((((status & AT91C_UDPHS_END_TR_ST) != 0)
+             && ((control & AT91C_UDPHS_END_TR_IT) != 0))
+            || (((status & AT91C_UDPHS_END_BF_ST) != 0)
+                && ((control & AT91C_UDPHS_END_BUFFIT) != 0))
+            || (((status & AT91C_UDPHS_DESC_LDST) != 0)
+                && ((control & AT91C_UDPHS_DESC_LD_IT) != 0))) {
+
+            intsta |= 1 << 24 << ep;
+        }
+    }
+
+    if (highSpeed) {
+
+        intsta |= AT91C_UDPHS_SPEED;
+    }
+    pUdphs->UDPHS_INTSTA = intsta;
+}
+
+//------------------------------------------------------------------------------
+// Banks
+//------------------------------------------------------------------------------
+
+static void ResetEndpoint(unsigned char ep)
+{
+    Endpoint *pEndpoint = &(endpoints[ep]);
+
+    pEndpoint->head = 0;
+    pEndpoint->busy = 0;
+    pEndpoint->read = 0;
+    pEndpoint->fill = 0;
+    pEndpoint->flags &= AT91C_UDPHS_FRCESTALL;
+}
+
+/// Frees the oldest bank.
+static void Release(unsigned char ep)
+{
+    Endpoint *pEndpoint = &(endpoints[ep]);
+
+    if (pEndpoint->busy > 0) {
+
+        pEndpoint->busy--;
+        pEndpoint->head = (pEndpoint->head + 1) % NumBanks(ep);
+        pEndpoint->read = 0;
+    }
+}
+
+/// Hands the bank being filled to the host.
+static void Validate(unsigned char ep)
+{
+    Endpoint *pEndpoint = &(endpoints[ep]);
+    unsigned int numBanks = NumBanks(ep);
+    Bank *pBank;
+
+    if (pEndpoint->busy >= numBanks) {
+
+        pEndpoint->flags |= AT91C_UDPHS_ERR_OVFLW;
+        return;
+    }
+    pBank = &(pEndpoint->banks[(pEndpoint->head + pEndpoint->busy) % numBanks]);
+    pBank->count = pEndpoint->fill;
+    pBank->in = 1;
+    pBank->setup = 0;
+    pEndpoint->busy++;
+    pEndpoint->fill = 0;
+}
+
+static unsigned char FifoRead(unsigned char ep)
+{
+    Endpoint *pEndpoint = &(endpoints[ep]);
+    Bank *pBank = &(pEndpoint->banks[pEndpoint->head]);
+
+    statistics.fifoReads++;
+    if ((pEndpoint->busy == 0) || pBank->in || (pEndpoint->read >= pBank->count)) {
+
+        return 0;
+    }
+    return pBank->data[pEndpoint->read++];
+}
+
+static void FifoWrite(unsigned char ep, unsigned char value)
+{
+    Endpoint *pEndpoint = &(endpoints[ep]);
+    unsigned int numBanks = NumBanks(ep);
+
+    statistics.fifoWrites++;
+    if ((numBanks == 0)
+        || (pEndpoint->busy >= numBanks)
+        || (pEndpoint->fill >= MaxPacketSize(ep))) {
+
+        pEndpoint->flags |= AT91C_UDPHS_ERR_OVFLW;
+        return;
+    }
+    pEndpoint->banks[(pEndpoint->head + pEndpoint->busy) % numBanks]
+        .data[pEndpoint->fill++] = value;
+}
+
+//------------------------------------------------------------------------------
+// DMA channels
+//------------------------------------------------------------------------------
+
+static unsigned char *Memory(unsigned int address)
+{
+    if (address < PAGESIZE) {
+
+        Fatal("DMA to an invalid address", address);
+    }
+    return (unsigned char *) (uintptr_t) address;
+}
+
+static void Start(unsigned char ch)
+{
+    unsigned int length = DMA(ch)->UDPHS_DMACONTROL >> 16;
+
+    channels[ch].address = DMA(ch)->UDPHS_DMAADDRESS;
+    channels[ch].count = (length == 0) ? 0x10000 : length;
+    DMA(ch)->UDPHS_DMASTATUS = (DMA(ch)->UDPHS_DMASTATUS & DMASTATUS_EVENTS)
+                               | AT91C_UDPHS_CHANN_ENB
+                               | AT91C_UDPHS_CHANN_ACT
+                               | (length << 16);
+}
+
+static void Stop(unsigned char ch)
+{
+    DMA(ch)->UDPHS_DMACONTROL &= ~AT91C_UDPHS_CHANN_ENB;
+    DMA(ch)->UDPHS_DMASTATUS &= ~(AT91C_UDPHS_CHANN_ENB | AT91C_UDPHS_CHANN_ACT);
+}
+
+static void LoadDescriptor(unsigned char ch)
+{
+    unsigned int links = 0;
+
+    do {
+        unsigned int address = DMA(ch)->UDPHS_DMANXTDSC & AT91C_UDPHS_NXT_DSC_ADD;
+        const unsigned int *pDescriptor;
+
+        // USBD_Init() loads from address 0 to clear the channel registers;
+        // the boot memory there is taken as zeroes
+        if (address == 0) {
+
+            DMA(ch)->UDPHS_DMAADDRESS = 0;
+            DMA(ch)->UDPHS_DMACONTROL = 0;
+            break;
+        }
+        pDescriptor = (const unsigned int *) Memory(address);
+        if (++links > 64) {
+
+            Fatal("DMA descriptor loop", DMA(ch)->UDPHS_DMANXTDSC);
+        }
+        DMA(ch)->UDPHS_DMANXTDSC = pDescriptor[0];
+        DMA(ch)->UDPHS_DMAADDRESS = pDescriptor[1];
+        DMA(ch)->UDPHS_DMACONTROL = pDescriptor[2];
+        DMA(ch)->UDPHS_DMASTATUS |= AT91C_UDPHS_DESC_LDST;
+        statistics.dmaDescriptors++;
+    }
+    while ((DMA(ch)->UDPHS_DMACONTROL
+            & (AT91C_UDPHS_CHANN_ENB | AT91C_UDPHS_LDNXT_DSC))
+           == AT91C_UDPHS_LDNXT_DSC);
+
+    if ((DMA(ch)->UDPHS_DMACONTROL & AT91C_UDPHS_CHANN_ENB) != 0) {
+
+        Start(ch);
+    }
+    else {
+
+        Stop(ch);
+    }
+}
+
+/// Closes the current buffer of a channel, then stops the channel or loads
+/// the next descriptor.
+static void EndOfBuffer(unsigned char ch, unsigned char endOfTransfer)
+{
+    unsigned int status = DMA(ch)->UDPHS_DMASTATUS & ~AT91C_UDPHS_BUFF_COUNT;
+
+    status |= (channels[ch].count << 16) & AT91C_UDPHS_BUFF_COUNT;
+    if (channels[ch].count == 0) {
+
+        status |= AT91C_UDPHS_END_BF_ST;
+    }
+    if (endOfTransfer) {
+
+        status |= AT91C_UDPHS_END_TR_ST;
+    }
+    DMA(ch)->UDPHS_DMASTATUS = status;
+
+    if ((DMA(ch)->UDPHS_DMACONTROL & AT91C_UDPHS_LDNXT_DSC) != 0) {
+
+        LoadDescriptor(ch);
+    }
+    else {
+
+        Stop(ch);
+    }
+}
+
+static void RunChannel(unsigned char ch)
+{
+    Endpoint *pEndpoint = &(endpoints[ch]);
+    Channel *pChannel = &(channels[ch]);
+    unsigned int numBanks = NumBanks(ch);
+    unsigned int size = MaxPacketSize(ch);
+    unsigned int length;
+
+    if (!IsEnabled(ch) || (numBanks == 0)) {
+
+        return;
+    }
+
+    while ((DMA(ch)->UDPHS_DMASTATUS & AT91C_UDPHS_CHANN_ENB) != 0) {
+
+        if (IsIn(ch)) {
+
+            Bank *pBank;
+
+            if ((pChannel->count == 0) || (pEndpoint->busy >= numBanks)) {
+
+                break;
+            }
+            pBank = &(pEndpoint->banks[(pEndpoint->head + pEndpoint->busy) % numBanks]);
+            length = size - pEndpoint->fill;
+            if (length > pChannel->count) {
+
+                length = pChannel->count;
+            }
+            memcpy(pBank->data + pEndpoint->fill, Memory(pChannel->address), length);
+            pEndpoint->fill += length;
+            pChannel->address += length;
+            pChannel->count -= length;
+            statistics.dmaBytes += length;
+
+            // Full packets are validated, and the last one of the buffer
+            // if END_B_EN is set; the DMA never sends a zero length packet
+            if ((pEndpoint->fill == size)
+                || ((pChannel->count == 0)
+                    && (pEndpoint->fill > 0)
+                    && ((DMA(ch)->UDPHS_DMACONTROL & AT91C_UDPHS_END_B_EN) != 0))) {
+
+                Validate(ch);
+            }
+            if (pChannel->count == 0) {
+
+                EndOfBuffer(ch, 0);
+            }
+        }
+        else {
+
+            Bank *pBank = &(pEndpoint->banks[pEndpoint->head]);
+            unsigned char shortPacket = 0;
+
+            if ((pChannel->count == 0)
+                || (pEndpoint->busy == 0)
+                || pBank->in
+                || pBank->setup) {
+
+                break;
+            }
+            length = pBank->count - pEndpoint->read;
+            if (length > pChannel->count) {
+
+                length = pChannel->count;
+            }
+            memcpy(Memory(pChannel->address), pBank->data + pEndpoint->read, length);
+            pEndpoint->read += length;
+            pChannel->address += length;
+            pChannel->count -= length;
+            statistics.dmaBytes += length;
+
+            if (pEndpoint->read == pBank->count) {
+
+                shortPacket = (pBank->count < size);
+                Release(ch);
+            }
+            if (shortPacket
+                && ((DMA(ch)->UDPHS_DMACONTROL & AT91C_UDPHS_END_TR_EN) != 0)) {
+
+                EndOfBuffer(ch, 1);
+            }
+            else if (pChannel->count == 0) {
+
+                EndOfBuffer(ch, 0);
+            }
+        }
+    }
+
+    DMA(ch)->UDPHS_DMAADDRESS = pChannel->address;
+    if ((DMA(ch)->UDPHS_DMASTATUS & AT91C_UDPHS_CHANN_ENB) != 0) {
+
+        DMA(ch)->UDPHS_DMASTATUS = (DMA(ch)->UDPHS_DMASTATUS & ~AT91C_UDPHS_BUFF_COUNT)
+                                   | ((pChannel->count << 16) & AT91C_UDPHS_BUFF_COUNT);
+    }
+}
+
+static void RunDma(void)
+{
+    unsigned char ch;
+
+    for (ch = 1; ch < NUMENDPOINTS; ch++) {
+
+        RunChannel(ch);
+    }
+}
+
+//------------------------------------------------------------------------------
+// Register writes
+//------------------------------------------------------------------------------
+
+static void ResetController(void)
+{
+    unsigned char i;
+
+    for (i = 0; i < NUMENDPOINTS; i++) {
+
+        ResetEndpoint(i);
+        endpoints[i].flags = 0;
+        endpoints[i].toggle = 0;
+        EPT(i)->UDPHS_EPTCTL = 0;
+        if (i > 0) {
+
+            Stop(i);
+        }
+    }
+    events = 0;
+}
+
+static void WriteEndpoint(unsigned char ep,
+                          unsigned int offset,
+                          unsigned int value,
+                          unsigned int previous)
+{
+    volatile AT91PS_UDPHS_EPT pEpt = EPT(ep);
+    Endpoint *pEndpoint = &(endpoints[ep]);
+
+    switch (offset) {
+
+        case offsetof(AT91S_UDPHS_EPT, UDPHS_EPTCFG):
+            value &= ~AT91C_UDPHS_EPT_MAPD;
+            if (((value & AT91C_UDPHS_BK_NUMBER) != 0)
+                && ((8 << (value & AT91C_UDPHS_EPT_SIZE)) <= MAXBANKSIZE)) {
+
+                value |= AT91C_UDPHS_EPT_MAPD;
+            }
+            pEpt->UDPHS_EPTCFG = value;
+            ResetEndpoint(ep);
+            break;
+
+        case offsetof(AT91S_UDPHS_EPT, UDPHS_EPTCTLENB):
+            pEpt->UDPHS_EPTCTL |= value;
+            pEpt->UDPHS_EPTCTLENB = 0;
+            break;
+
+        case offsetof(AT91S_UDPHS_EPT, UDPHS_EPTCTLDIS):
+            pEpt->UDPHS_EPTCTL &= ~value;
+            pEpt->UDPHS_EPTCTLDIS = 0;
+            break;
+
+        case offsetof(AT91S_UDPHS_EPT, UDPHS_EPTSETSTA):
+            if ((value & AT91C_UDPHS_FRCESTALL) != 0) {
+
+                pEndpoint->flags |= AT91C_UDPHS_FRCESTALL;
+            }
+            if ((value & AT91C_UDPHS_TX_PK_RDY) != 0) {
+
+                Validate(ep);
+            }
+            if (((value & AT91C_UDPHS_KILL_BANK) != 0) && (pEndpoint->busy > 0)) {
+
+                pEndpoint->busy--;
+            }
+            pEpt->UDPHS_EPTSETSTA = 0;
+            break;
+
+        case offsetof(AT91S_UDPHS_EPT, UDPHS_EPTCLRSTA):
+            if ((value & AT91C_UDPHS_TOGGLESQ) != 0) {
+
+                pEndpoint->toggle = 0;
+            }
+            if ((pEndpoint->busy > 0) && !pEndpoint->banks[pEndpoint->head].in) {
+
+                unsigned int clear = pEndpoint->banks[pEndpoint->head].setup ?
+                                     AT91C_UDPHS_RX_SETUP : AT91C_UDPHS_RX_BK_RDY;
+
+                if ((value & clear) != 0) {
+
+                    Release(ep);
+                }
+            }
+            pEndpoint->flags &= ~(value & EPTSTA_FLAGS);
+            pEpt->UDPHS_EPTCLRSTA = 0;
+            break;
+
+        default:
+            // EPTCTL and EPTSTA are read-only
+            *(volatile unsigned int *) ((volatile unsigned char *) pEpt + offset) = previous;
+    }
+}
+
+static void WriteChannel(unsigned char ch,
+                         unsigned int offset,
+                         unsigned int value,
+                         unsigned int previous)
+{
+    switch (offset) {
+
+        case offsetof(AT91S_UDPHS_DMA, UDPHS_DMANXTDSC):
+            break;
+
+        case offsetof(AT91S_UDPHS_DMA, UDPHS_DMAADDRESS):
+            channels[ch].address = value;
+            break;
+
+        case offsetof(AT91S_UDPHS_DMA, UDPHS_DMACONTROL):
+            if ((value & AT91C_UDPHS_CHANN_ENB) != 0) {
+
+                // Run; a running channel only takes the new control bits
+                if ((DMA(ch)->UDPHS_DMASTATUS & AT91C_UDPHS_CHANN_ENB) == 0) {
+
+                    Start(ch);
+                }
+            }
+            else if ((value & AT91C_UDPHS_LDNXT_DSC) != 0) {
+
+                LoadDescriptor(ch);
+            }
+            else {
+
+                Stop(ch);
+            }
+            break;
+
+        default:
+            DMA(ch)->UDPHS_DMASTATUS = previous;
+    }
+}
+
+static void WriteRegister(unsigned int offset,
+                          unsigned int value,
+                          unsigned int previous)
+{
+    volatile unsigned int *pRegister =
+        (volatile unsigned int *) ((volatile unsigned char *) pUdphs + offset);
+    unsigned char i;
+
+    statistics.registerWrites++;
+
+    if (offset == OFFSET(UDPHS_CTRL)) {
+
+        if ((value & AT91C_UDPHS_REWAKEUP) != 0) {
+
+            // The resume signal is over by the time the bit is polled
+            statistics.remoteWakeups++;
+            pUdphs->UDPHS_CTRL = value & ~AT91C_UDPHS_REWAKEUP;
+        }
+        if (((previous & AT91C_UDPHS_EN_UDPHS) != 0)
+            && ((value & AT91C_UDPHS_EN_UDPHS) == 0)) {
+
+            ResetController();
+        }
+    }
+    else if ((offset == OFFSET(UDPHS_IEN)) || (offset == OFFSET(UDPHS_TST))) {
+
+        // Plain registers
+    }
+    else if (offset == OFFSET(UDPHS_CLRINT)) {
+
+        events &= ~value;
+        *pRegister = 0;
+    }
+    else if (offset == OFFSET(UDPHS_EPTRST)) {
+
+        for (i = 0; i < NUMENDPOINTS; i++) {
+
+            if ((value & (1 << i)) != 0) {
+
+                ResetEndpoint(i);
+            }
+        }
+        *pRegister = 0;
+    }
+    else if ((offset >= EPT_OFFSET)
+             && (offset < EPT_OFFSET + NUMENDPOINTS * EPT_SIZE)) {
+
+        WriteEndpoint((offset - EPT_OFFSET) / EPT_SIZE,
+                      (offset - EPT_OFFSET) % EPT_SIZE,
+                      value,
+                      previous);
+    }
+    else if ((offset >= DMA_OFFSET + DMA_SIZE)
+             && (offset < DMA_OFFSET + NUMENDPOINTS * DMA_SIZE)) {
+
+        WriteChannel((offset - DMA_OFFSET) / DMA_SIZE,
+                     (offset - DMA_OFFSET) % DMA_SIZE,
+                     value,
+                     previous);
+    }
+    else {
+
+        // Read-only or reserved
+        *pRegister = previous;
+    }
+
+    RunDma();
+    Update();
+}
+
+static void ReadRegister(unsigned int offset)
+{
+    statistics.registerReads++;
+
+    if ((offset >= DMA_OFFSET + DMA_SIZE)
+        && (offset < DMA_OFFSET + NUMENDPOINTS * DMA_SIZE)
+        && ((offset - DMA_OFFSET) % DMA_SIZE
+            == offsetof(AT91S_UDPHS_DMA, UDPHS_DMASTATUS))) {
+
+        DMA((offset - DMA_OFFSET) / DMA_SIZE)->UDPHS_DMASTATUS &= ~DMASTATUS_EVENTS;
+        Update();
+    }
+}
+
+//------------------------------------------------------------------------------
+// Access trapping
+//------------------------------------------------------------------------------
+
+/// Returns the size of the memory operand of the instruction at pc, for the
+/// moves and compares compilers emit for byte and word accesses, or 0.
+static unsigned int OperandSize(const unsigned char *pc)
+{
+    unsigned int size = 4;
+
+    // Legacy prefixes
+    for (;; pc++) {
+
+        if (*pc == 0x66) {
+
+            size = 2;
+        }
+        else if ((*pc != 0xF2) && (*pc != 0xF3) && (*pc != 0x2E) && (*pc != 0x36)
+                 && (*pc != 0x3E) && (*pc != 0x26) && (*pc != 0x64)
+                 && (*pc != 0x65) && (*pc != 0x67)) {
+
+            break;
+        }
+    }
+    // REX prefix
+    if ((*pc & 0xF0) == 0x40) {
+
+        if ((*pc & 0x08) != 0) {
+
+            size = 8;
+        }
+        pc++;
+    }
+
+    switch (*pc) {
+
+        case 0x88: case 0x8A: case 0xC6: case 0xA4: case 0xAA: case 0xAC:
+        case 0x80: case 0x38: case 0x3A: case 0x84: case 0xF6:
+            return 1;
+
+        case 0x89: case 0x8B: case 0xC7: case 0xA5: case 0xAB: case 0xAD:
+        case 0x81: case 0x83: case 0x39: case 0x3B: case 0x85: case 0xF7:
+            return size;
+
+        case 0x0F:
+            switch (pc[1]) {
+
+                case 0xB6: case 0xBE: return 1;
+                case 0xB7: case 0xBF: return 2;
+            }
+    }
+    return 0;
+}
+
+static void Protect(int protection)
+{
+    unsigned long first = trapped.address & ~(unsigned long) (PAGESIZE - 1);
+    unsigned long last = (trapped.address + trapped.size - 1)
+                         & ~(unsigned long) (PAGESIZE - 1);
+
+    mprotect((void *) first, last - first + PAGESIZE, protection);
+}
+
+static void SegvHandler(int number, siginfo_t *pInfo, void *pContext)
+{
+    ucontext_t *pUcontext = (ucontext_t *) pContext;
+    unsigned long address = (unsigned long) pInfo->si_addr;
+    unsigned int i;
+
+    if (inDevice) {
+
+        statistics.cpuTime += Now() - resumed;
+        if (++accesses > MAXACCESSES) {
+
+            Fatal("device code stuck on the controller", address);
+        }
+    }
+
+    trapped.address = address;
+    trapped.write = (pUcontext->uc_mcontext.gregs[REG_ERR] & 2) != 0;
+
+    if ((address >= UDPHS_ADDRESS) && (address < UDPHS_ADDRESS + UDPHS_SIZE)) {
+
+        trapped.fifo = 0;
+        trapped.size = 1;
+        trapped.previous = *(volatile unsigned int *)
+            ((volatile unsigned char *) pUdphs + ((address - UDPHS_ADDRESS) & ~3UL));
+    }
+    else if ((address >= FIFO_ADDRESS) && (address < FIFO_ADDRESS + FIFO_SIZE)) {
+
+        unsigned char ep = (address - FIFO_ADDRESS) / FIFO_WINDOW;
+
+        trapped.fifo = 1;
+        trapped.size = OperandSize((const unsigned char *)
+                                  pUcontext->uc_mcontext.gregs[REG_RIP]);
+        if (trapped.size == 0) {
+
+            Fatal("unsupported FIFO access instruction",
+                  *(const unsigned long *) pUcontext->uc_mcontext.gregs[REG_RIP]);
+        }
+        if (!trapped.write) {
+
+            for (i = 0; i < trapped.size; i++) {
+
+                pFifo[address - FIFO_ADDRESS + i] = FifoRead(ep);
+            }
+        }
+    }
+    else {
+
+        // Not ours: let the access fault again and dump core
+        signal(SIGSEGV, SIG_DFL);
+        return;
+    }
+
+    if (trapped.pending) {
+
+        Fatal("instruction accessing the controller twice", address);
+    }
+    trapped.pending = 1;
+    Protect(PROT_READ | PROT_WRITE);
+    pUcontext->uc_mcontext.gregs[REG_EFL] |= 0x100;
+}
+
+static void TrapHandler(int number, siginfo_t *pInfo, void *pContext)
+{
+    ucontext_t *pUcontext = (ucontext_t *) pContext;
+    unsigned int i;
+
+    if (!trapped.pending) {
+
+        signal(SIGTRAP, SIG_DFL);
+        raise(SIGTRAP);
+        return;
+    }
+    pUcontext->uc_mcontext.gregs[REG_EFL] &= ~0x100;
+    trapped.pending = 0;
+    Protect(PROT_NONE);
+
+    if (!trapped.fifo) {
+
+        unsigned int offset = (trapped.address - UDPHS_ADDRESS) & ~3UL;
+
+        if (trapped.write) {
+
+            WriteRegister(offset,
+                          *(volatile unsigned int *) ((volatile unsigned char *) pUdphs + offset),
+                          trapped.previous);
+        }
+        else {
+
+            ReadRegister(offset);
+        }
+    }
+    else if (trapped.write) {
+
+        unsigned char ep = (trapped.address - FIFO_ADDRESS) / FIFO_WINDOW;
+
+        for (i = 0; i < trapped.size; i++) {
+
+            FifoWrite(ep, pFifo[trapped.address - FIFO_ADDRESS + i]);
+        }
+    }
+
+    if (inDevice) {
+
+        resumed = Now();
+    }
+}
+
+//------------------------------------------------------------------------------
+//         Exported functions
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Maps the controller, the FIFO windows and the PMC at their addresses and
+/// installs the access traps. The controller comes out of reset detached.
+//------------------------------------------------------------------------------
+void UDPHSSim_Initialize(void)
+{
+    struct sigaction action;
+    int fd;
+
+    fd = memfd_create("udphssim", 0);
+    if ((fd < 0) || (ftruncate(fd, UDPHS_SIZE + FIFO_SIZE) != 0)) {
+
+        perror("udphssim: memfd");
+        exit(2);
+    }
+    if ((mmap((void *) UDPHS_ADDRESS, UDPHS_SIZE, PROT_NONE,
+              MAP_SHARED | MAP_FIXED_NOREPLACE, fd, 0)
+         != (void *) UDPHS_ADDRESS)
+        || (mmap((void *) FIFO_ADDRESS, FIFO_SIZE, PROT_NONE,
+                 MAP_SHARED | MAP_FIXED_NOREPLACE, fd, UDPHS_SIZE)
+            != (void *) FIFO_ADDRESS)
+        || (mmap((void *) SYSTEM_ADDRESS, SYSTEM_SIZE, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0)
+            != (void *) SYSTEM_ADDRESS)) {
+
+        perror("udphssim: cannot map the peripherals (link with -no-pie)");
+        exit(2);
+    }
+    pUdphs = (AT91PS_UDPHS) mmap(0, UDPHS_SIZE, PROT_READ | PROT_WRITE,
+                                 MAP_SHARED, fd, 0);
+    pFifo = (unsigned char *) mmap(0, FIFO_SIZE, PROT_READ | PROT_WRITE,
+                                   MAP_SHARED, fd, UDPHS_SIZE);
+    if ((pUdphs == MAP_FAILED) || (pFifo == MAP_FAILED)) {
+
+        perror("udphssim: mmap");
+        exit(2);
+    }
+
+    // The UTMI PLL locks at once
+    AT91C_BASE_PMC->PMC_SR = AT91C_PMC_LOCKU;
+
+    // Reset values
+    pUdphs->UDPHS_CTRL = AT91C_UDPHS_DETACH;
+    pUdphs->UDPHS_IEN = AT91C_UDPHS_ENDRESET;
+    pUdphs->UDPHS_IPFEATURES = NUMENDPOINTS | ((NUMENDPOINTS - 1) << 4);
+    Update();
+
+    memset(&action, 0, sizeof(action));
+    action.sa_flags = SA_SIGINFO;
+    action.sa_sigaction = SegvHandler;
+    sigaction(SIGSEGV, &action, 0);
+    action.sa_sigaction = TrapHandler;
+    sigaction(SIGTRAP, &action, 0);
+}
+
+//------------------------------------------------------------------------------
+/// Sets the handler UDPHSSim_Interrupt invokes, as IRQ_ConfigureIT does.
+//------------------------------------------------------------------------------
+void UDPHSSim_SetIrqHandler(void (*handler)(void))
+{
+    irqHandler = handler;
+}
+
+//------------------------------------------------------------------------------
+/// Masks or unmasks the interrupt, as IRQ_DisableIT and IRQ_EnableIT do.
+//------------------------------------------------------------------------------
+void UDPHSSim_EnableIrq(unsigned char enabled)
+{
+    irqEnabled = enabled;
+}
+
+//------------------------------------------------------------------------------
+/// Sets the function UDPHSSim_Interrupt runs after the interrupt handler, as
+/// long as it returns a non-zero count, such as DEFER_Run.
+//------------------------------------------------------------------------------
+void UDPHSSim_SetDeferredHandler(unsigned int (*handler)(void))
+{
+    deferredHandler = handler;
+}
+
+static void RunDeferred(void)
+{
+    deferredRuns = deferredHandler();
+}
+
+//------------------------------------------------------------------------------
+/// Runs device code, such as the main loop of the application, accounting
+/// the time it takes in cpuTime.
+//------------------------------------------------------------------------------
+void UDPHSSim_Call(void (*function)(void))
+{
+    if (inDevice) {
+
+        function();
+        return;
+    }
+    inDevice = 1;
+    accesses = 0;
+    resumed = Now();
+    function();
+    statistics.cpuTime += Now() - resumed;
+    inDevice = 0;
+}
+
+//------------------------------------------------------------------------------
+/// Invokes the interrupt handler as long as an enabled interrupt is pending
+/// and the interrupt is not masked, then the deferred work handler, until
+/// neither has anything left to do.
+/// \return Number of calls of the interrupt handler
+//------------------------------------------------------------------------------
+unsigned int UDPHSSim_Interrupt(void)
+{
+    unsigned int calls = 0;
+    unsigned long long start;
+    unsigned long long time;
+
+    do {
+        while ((irqHandler != 0) && irqEnabled
+               && ((pUdphs->UDPHS_INTSTA & pUdphs->UDPHS_IEN & ~AT91C_UDPHS_SPEED) != 0)) {
+
+            if (++calls > 1000) {
+
+                Fatal("interrupt never acknowledged", pUdphs->UDPHS_INTSTA);
+            }
+            statistics.interrupts++;
+            start = DeviceTime();
+            UDPHSSim_Call(irqHandler);
+            time = DeviceTime() - start;
+            statistics.irqTime += time;
+            if (time > statistics.longestIrq) {
+
+                statistics.longestIrq = time;
+            }
+        }
+        deferredRuns = 0;
+        if (deferredHandler != 0) {
+
+            start = DeviceTime();
+            UDPHSSim_Call(RunDeferred);
+            statistics.deferredTime += DeviceTime() - start;
+        }
+    } while (deferredRuns > 0);
+
+    return calls;
+}
+
+//------------------------------------------------------------------------------
+/// Indicates the controller is enabled and its pull-up connected.
+//------------------------------------------------------------------------------
+unsigned char UDPHSSim_IsConnected(void)
+{
+    return IsConnected();
+}
+
+//------------------------------------------------------------------------------
+/// Resets the bus. The endpoints are disabled and the address cleared.
+/// \param highSpeed Indicates the host supports high speed.
+/// \return 1 if the device runs at high speed, 0 at full speed
+//------------------------------------------------------------------------------
+unsigned char UDPHSSim_Reset(unsigned char highSpeedHost)
+{
+    unsigned char i;
+
+    for (i = 0; i < NUMENDPOINTS; i++) {
+
+        ResetEndpoint(i);
+        endpoints[i].flags = 0;
+        endpoints[i].toggle = 0;
+        EPT(i)->UDPHS_EPTCTL = 0;
+    }
+    pUdphs->UDPHS_CTRL &= ~(AT91C_UDPHS_DEV_ADDR | AT91C_UDPHS_FADDR_EN);
+    highSpeed = highSpeedHost
+                && ((pUdphs->UDPHS_TST & AT91C_UDPHS_SPEED_CFG)
+                    != AT91C_UDPHS_SPEED_CFG_FS);
+    events = (events & ~AT91C_UDPHS_DET_SUSPD)
+             | AT91C_UDPHS_WAKE_UP | AT91C_UDPHS_ENDRESET;
+    // End of reset is always enabled after a reset
+    pUdphs->UDPHS_IEN |= AT91C_UDPHS_ENDRESET;
+    Update();
+
+    return highSpeed;
+}
+
+//------------------------------------------------------------------------------
+/// Stops the bus activity: the controller detects a suspend.
+//------------------------------------------------------------------------------
+void UDPHSSim_Suspend(void)
+{
+    events |= AT91C_UDPHS_DET_SUSPD;
+    Update();
+}
+
+//------------------------------------------------------------------------------
+/// Resumes the bus activity.
+//------------------------------------------------------------------------------
+void UDPHSSim_Resume(void)
+{
+    events |= AT91C_UDPHS_WAKE_UP | AT91C_UDPHS_ENDOFRSM;
+    Update();
+}
+
+//------------------------------------------------------------------------------
+/// Sends a start of frame.
+/// \param microframe Microframe number; at full speed, a multiple of 8
+//------------------------------------------------------------------------------
+void UDPHSSim_StartOfFrame(unsigned int microframe)
+{
+    pUdphs->UDPHS_FNUM = (microframe & AT91C_UDPHS_MICRO_FRAME_NUM)
+                         | (microframe & AT91C_UDPHS_FRAME_NUMBER);
+    events |= AT91C_UDPHS_MICRO_SOF;
+    if ((microframe & 7) == 0) {
+
+        events |= AT91C_UDPHS_IEN_SOF;
+    }
+    Update();
+}
+
+//------------------------------------------------------------------------------
+/// SETUP transaction on a control endpoint. A SETUP packet is always
+/// acknowledged; it flushes the endpoint and clears a protocol stall.
+/// \return UDPHSSim_ACK or UDPHSSim_NORESPONSE
+//------------------------------------------------------------------------------
+int UDPHSSim_Setup(unsigned char address, const void *pSetup)
+{
+    Endpoint *pEndpoint = &(endpoints[0]);
+    unsigned int deviceAddress = ((pUdphs->UDPHS_CTRL & AT91C_UDPHS_FADDR_EN) != 0) ?
+                                 (pUdphs->UDPHS_CTRL & AT91C_UDPHS_DEV_ADDR) : 0;
+
+    if (!IsConnected()
+        || (address != deviceAddress)
+        || !IsEnabled(0)
+        || (Type(0) != AT91C_UDPHS_EPT_TYPE_CTL_EPT)) {
+
+        return UDPHSSim_NORESPONSE;
+    }
+
+    ResetEndpoint(0);
+    pEndpoint->flags &= ~AT91C_UDPHS_FRCESTALL;
+    memcpy(pEndpoint->banks[0].data, pSetup, 8);
+    pEndpoint->banks[0].count = 8;
+    pEndpoint->banks[0].in = 0;
+    pEndpoint->banks[0].setup = 1;
+    pEndpoint->busy = 1;
+    pEndpoint->toggle = 1;
+    Update();
+
+    return UDPHSSim_ACK;
+}
+
+//------------------------------------------------------------------------------
+/// OUT transaction.
+/// \return UDPHSSim_ACK, UDPHSSim_NAK, UDPHSSim_STALL or UDPHSSim_NORESPONSE
+//------------------------------------------------------------------------------
+int UDPHSSim_Out(unsigned char address,
+                 unsigned char ep,
+                 const void *pData,
+                 unsigned int length)
+{
+    Endpoint *pEndpoint = &(endpoints[ep]);
+    unsigned int deviceAddress = ((pUdphs->UDPHS_CTRL & AT91C_UDPHS_FADDR_EN) != 0) ?
+                                 (pUdphs->UDPHS_CTRL & AT91C_UDPHS_DEV_ADDR) : 0;
+    unsigned int numBanks;
+    Bank *pBank;
+
+    if (!IsConnected()
+        || (address != deviceAddress)
+        || (ep >= NUMENDPOINTS)
+        || !IsEnabled(ep)
+        || ((Type(ep) != AT91C_UDPHS_EPT_TYPE_CTL_EPT) && IsIn(ep))
+        || (length > MaxPacketSize(ep))) {
+
+        return UDPHSSim_NORESPONSE;
+    }
+    if ((pEndpoint->flags & AT91C_UDPHS_FRCESTALL) != 0) {
+
+        pEndpoint->flags |= AT91C_UDPHS_STALL_SNT;
+        Update();
+        return UDPHSSim_STALL;
+    }
+
+    numBanks = NumBanks(ep);
+    if ((pEndpoint->busy >= numBanks)
+        || ((pEndpoint->busy > 0) && pEndpoint->banks[pEndpoint->head].in)) {
+
+        if (Type(ep) == AT91C_UDPHS_EPT_TYPE_ISO_EPT) {
+
+            statistics.isoErrors++;
+            return UDPHSSim_ACK;
+        }
+        pEndpoint->flags |= AT91C_UDPHS_NAK_OUT;
+        Update();
+        return UDPHSSim_NAK;
+    }
+
+    pBank = &(pEndpoint->banks[(pEndpoint->head + pEndpoint->busy) % numBanks]);
+    memcpy(pBank->data, pData, length);
+    pBank->count = length;
+    pBank->in = 0;
+    pBank->setup = 0;
+    pEndpoint->busy++;
+    pEndpoint->toggle ^= 1;
+    RunDma();
+    Update();
+
+    return UDPHSSim_ACK;
+}
+
+//------------------------------------------------------------------------------
+/// IN transaction.
+/// \return Number of bytes received, UDPHSSim_NAK, UDPHSSim_STALL or
+/// UDPHSSim_NORESPONSE
+//------------------------------------------------------------------------------
+int UDPHSSim_In(unsigned char address,
+                unsigned char ep,
+                void *pData,
+                unsigned int maxLength)
+{
+    Endpoint *pEndpoint = &(endpoints[ep]);
+    unsigned int deviceAddress = ((pUdphs->UDPHS_CTRL & AT91C_UDPHS_FADDR_EN) != 0) ?
+                                 (pUdphs->UDPHS_CTRL & AT91C_UDPHS_DEV_ADDR) : 0;
+    Bank *pBank;
+    unsigned int length;
+
+    if (!IsConnected()
+        || (address != deviceAddress)
+        || (ep >= NUMENDPOINTS)
+        || !IsEnabled(ep)
+        || ((Type(ep) != AT91C_UDPHS_EPT_TYPE_CTL_EPT) && !IsIn(ep))) {
+
+        return UDPHSSim_NORESPONSE;
+    }
+    if ((pEndpoint->flags & AT91C_UDPHS_FRCESTALL) != 0) {
+
+        pEndpoint->flags |= AT91C_UDPHS_STALL_SNT;
+        Update();
+        return UDPHSSim_STALL;
+    }
+
+    pBank = &(pEndpoint->banks[pEndpoint->head]);
+    if ((pEndpoint->busy == 0) || !pBank->in) {
+
+        if (Type(ep) == AT91C_UDPHS_EPT_TYPE_ISO_EPT) {
+
+            statistics.isoErrors++;
+            return 0;
+        }
+        pEndpoint->flags |= AT91C_UDPHS_NAK_IN;
+        Update();
+        return UDPHSSim_NAK;
+    }
+
+    length = (pBank->count < maxLength) ? pBank->count : maxLength;
+    memcpy(pData, pBank->data, length);
+    Release(ep);
+    pEndpoint->flags |= AT91C_UDPHS_TX_COMPLT;
+    pEndpoint->toggle ^= 1;
+    RunDma();
+    Update();
+
+    return length;
+}
+
+//------------------------------------------------------------------------------
+/// Returns the activity counters.
+//------------------------------------------------------------------------------
+void UDPHSSim_GetStatistics(UDPHSSimStatistics *pStatistics)
+{
+    *pStatistics = statistics;
+}
+
+//------------------------------------------------------------------------------
+/// Restarts the measure of the longest interrupt handler call.
+//------------------------------------------------------------------------------
+void UDPHSSim_ClearLongestIrq(void)
+{
+    statistics.longestIrq = 0;
+}
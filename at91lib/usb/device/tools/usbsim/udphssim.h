@@ -0,0 +1,115 @@
+//------------------------------------------------------------------------------
+// Simulated UDPHS controller, to run the USB device stack in a host process.
+//
+// The register block, the endpoint FIFO windows and the PMC are mapped at
+// their addresses on the SAM3U, so that USBD_UDPHS.c and the class drivers
+// are built unchanged for the host (x86-64 Linux, non-PIE so that static
+// buffers fit in the 32-bit DMA registers). The UDPHS and FIFO pages are kept
+// inaccessible: every access made by the device code faults, is single
+// stepped, and is then given the semantics of the controller (write-one-to-set
+// and clear registers, clear-on-read DMA status, FIFO data pointer, ...).
+//
+// The bus side is driven by the virtual host through UDPHSSim_Setup,
+// UDPHSSim_Out and UDPHSSim_In, one transaction at a time. DMA channels move
+// data as soon as a bank or a buffer is available, and the interrupt handler
+// registered by USBDCallbacks_Initialized is invoked by UDPHSSim_Interrupt
+// between transactions, never in the middle of device code: the
+// UDPHS_Lock()/UDPHS_Unlock() critical sections are not exercised. While the
+// interrupt is masked (IRQ_DisableIT), the handler is not invoked; the
+// deferred work handler, if any, then runs right after it, as a task of the
+// highest priority would.
+//------------------------------------------------------------------------------
+
+#ifndef UDPHSSIM_H
+#define UDPHSSIM_H
+
+//------------------------------------------------------------------------------
+//         Definitions
+//------------------------------------------------------------------------------
+
+/// Handshakes returned by the bus functions.
+#define UDPHSSim_ACK            0
+#define UDPHSSim_NAK            (-1)
+#define UDPHSSim_STALL          (-2)
+/// The device is detached, has another address or the endpoint is disabled.
+#define UDPHSSim_NORESPONSE     (-3)
+
+//------------------------------------------------------------------------------
+//         Types
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Activity counters of the simulated controller.
+//------------------------------------------------------------------------------
+typedef struct {
+
+    /// Register reads and writes made by the device code.
+    unsigned long long registerReads;
+    unsigned long long registerWrites;
+    /// Bytes read from and written to the FIFO windows by the device code.
+    unsigned long long fifoReads;
+    unsigned long long fifoWrites;
+    /// Bytes moved by the DMA channels, and descriptors they loaded.
+    unsigned long long dmaBytes;
+    unsigned long long dmaDescriptors;
+    /// Calls of the interrupt handler.
+    unsigned long long interrupts;
+    /// Host time spent in the device code, in ns, register and FIFO accesses
+    /// excluded.
+    unsigned long long cpuTime;
+    /// Part of cpuTime spent in the interrupt handler and in the deferred
+    /// work handler, and longest call of the interrupt handler since
+    /// UDPHSSim_ClearLongestIrq.
+    unsigned long long irqTime;
+    unsigned long long deferredTime;
+    unsigned long long longestIrq;
+    /// Isochronous packets lost because no bank was free (OUT) or ready (IN).
+    unsigned long long isoErrors;
+    /// Remote wakeups requested by the device.
+    unsigned long long remoteWakeups;
+
+} UDPHSSimStatistics;
+
+//------------------------------------------------------------------------------
+//         Exported functions
+//------------------------------------------------------------------------------
+
+extern void UDPHSSim_Initialize(void);
+
+extern void UDPHSSim_SetIrqHandler(void (*handler)(void));
+
+extern void UDPHSSim_EnableIrq(unsigned char enabled);
+
+extern void UDPHSSim_SetDeferredHandler(unsigned int (*handler)(void));
+
+extern void UDPHSSim_Call(void (*function)(void));
+
+extern unsigned int UDPHSSim_Interrupt(void);
+
+extern unsigned char UDPHSSim_IsConnected(void);
+
+extern unsigned char UDPHSSim_Reset(unsigned char highSpeed);
+
+extern void UDPHSSim_Suspend(void);
+
+extern void UDPHSSim_Resume(void);
+
+extern void UDPHSSim_StartOfFrame(unsigned int microframe);
+
+extern int UDPHSSim_Setup(unsigned char address, const void *pSetup);
+
+extern int UDPHSSim_Out(unsigned char address,
+                        unsigned char endpoint,
+                        const void *pData,
+                        unsigned int length);
+
+extern int UDPHSSim_In(unsigned char address,
+                       unsigned char endpoint,
+                       void *pData,
+                       unsigned int maxLength);
+
+extern void UDPHSSim_GetStatistics(UDPHSSimStatistics *pStatistics);
+
+extern void UDPHSSim_ClearLongestIrq(void);
+
+#endif //#ifndef UDPHSSIM_H
@@ -0,0 +1,715 @@
+//------------------------------------------------------------------------------
+// Scripted virtual USB host (see vhost.h).
+//------------------------------------------------------------------------------
+
+#include "vhost.h"
+#include "udphssim.h"
+
+#include <stdio.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Byte times per microframe (high speed) or frame (full speed), and per
+/// transaction on top of its payload.
+#define HS_BUDGET           7500
+#define HS_OVERHEAD         42
+#define FS_BUDGET           1500
+#define FS_OVERHEAD         13
+
+/// Length of a microframe, in ns.
+#define MICROFRAME          125000ULL
+
+/// Address given to the device.
+#define DEVICEADDRESS       1
+
+/// Pipes, indexed by endpoint number and direction.
+#define NUMPIPES            32
+#define PIPE(endpoint)      ((((endpoint) & 0x0F) << 1) | (((endpoint) >> 7) & 1))
+
+/// Control transfer stages.
+#define STAGE_SETUP         0
+#define STAGE_DATA          1
+#define STAGE_STATUS        2
+
+//------------------------------------------------------------------------------
+//         Local types
+//------------------------------------------------------------------------------
+
+typedef struct {
+
+    unsigned char active;
+    unsigned char type;
+    unsigned char interface;
+    unsigned short maxPacketSize;
+    /// Service interval of a periodic pipe, in microframes.
+    unsigned int interval;
+    unsigned long long due;
+    VHostTransfer *pHead;
+    VHostTransfer *pTail;
+
+} Pipe;
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+static Pipe pipes[NUMPIPES];
+static unsigned char highSpeedHost;
+static unsigned char highSpeed;
+static unsigned char address;
+static void (*loop)(void);
+static void (*frameHandler)(unsigned int microframe);
+
+/// Current microframe, its start time and the byte times used.
+static unsigned long long microframe;
+static unsigned long long frameStart;
+static unsigned int used;
+
+/// Control transfer in progress.
+static unsigned char setup[8];
+static unsigned char stage;
+static unsigned char pipe0Busy;
+
+/// Configuration descriptor of the device.
+static unsigned char configuration[1024];
+static unsigned int configurationLength;
+
+static VHostStatistics statistics;
+
+//------------------------------------------------------------------------------
+//         Local functions
+//------------------------------------------------------------------------------
+
+static unsigned int Budget(void)
+{
+    return highSpeed ? HS_BUDGET : FS_BUDGET;
+}
+
+static unsigned int Overhead(void)
+{
+    return highSpeed ? HS_OVERHEAD : FS_OVERHEAD;
+}
+
+/// Lets the device handle the transaction just made.
+static void Service(void)
+{
+    UDPHSSim_Interrupt();
+    if (loop) {
+
+        UDPHSSim_Call(loop);
+        UDPHSSim_Interrupt();
+    }
+}
+
+/// Ends the frame in progress.
+static void EndFrame(void)
+{
+    statistics.microframes++;
+    microframe += highSpeed ? 1 : 8;
+    frameStart += highSpeed ? MICROFRAME : 8 * MICROFRAME;
+    used = 0;
+}
+
+/// Accounts a transaction in the frame budget.
+static void Account(unsigned int length, int result)
+{
+    used += Overhead() + length;
+    statistics.transactions++;
+    if (result == UDPHSSim_NAK) {
+
+        statistics.naks++;
+    }
+    else if (result >= 0) {
+
+        statistics.bytes += length;
+    }
+}
+
+static void Complete(Pipe *pPipe, int status)
+{
+    VHostTransfer *pTransfer = pPipe->pHead;
+
+    pPipe->pHead = pTransfer->pNext;
+    if (pPipe->pHead == 0) {
+
+        pPipe->pTail = 0;
+    }
+    pTransfer->completed = VHost_GetTime();
+    pTransfer->status = status;
+    if (pTransfer->callback) {
+
+        pTransfer->callback(pTransfer);
+    }
+}
+
+/// Status of a transaction that did not move data.
+static int Failure(int result)
+{
+    return (result == UDPHSSim_STALL) ? VHOST_STALLED : VHOST_NORESPONSE;
+}
+
+/// Makes one transaction on a pipe with a transfer queued.
+static void Transaction(unsigned char index)
+{
+    Pipe *pPipe = &(pipes[index]);
+    VHostTransfer *pTransfer = pPipe->pHead;
+    unsigned char endpoint = index >> 1;
+    unsigned int length = pTransfer->length - pTransfer->actual;
+    int result;
+
+    if (length > pPipe->maxPacketSize) {
+
+        length = pPipe->maxPacketSize;
+    }
+
+    if ((index & 1) != 0) {
+
+        result = UDPHSSim_In(address, endpoint,
+                             pTransfer->pData + pTransfer->actual, length);
+        Account((result > 0) ? result : 0, result);
+        if (result == UDPHSSim_NAK) {
+
+            return;
+        }
+        if (result < 0) {
+
+            Complete(pPipe, Failure(result));
+        }
+        else {
+
+            pTransfer->actual += result;
+            if ((pPipe->type == VHOST_ISOCHRONOUS)
+                || (result < pPipe->maxPacketSize)
+                || (pTransfer->actual == pTransfer->length)) {
+
+                Complete(pPipe, VHOST_DONE);
+            }
+        }
+    }
+    else {
+
+        result = UDPHSSim_Out(address, endpoint,
+                              pTransfer->pData + pTransfer->actual, length);
+        Account(length, result);
+        if (result == UDPHSSim_NAK) {
+
+            return;
+        }
+        if (result < 0) {
+
+            Complete(pPipe, Failure(result));
+        }
+        else {
+
+            pTransfer->actual += length;
+            if ((pPipe->type == VHOST_ISOCHRONOUS)
+                || ((pTransfer->actual == pTransfer->length)
+                    && (!pTransfer->zlp || (length < pPipe->maxPacketSize)))) {
+
+                Complete(pPipe, VHOST_DONE);
+            }
+        }
+    }
+}
+
+/// Makes one transaction of the control transfer in progress.
+static void ControlTransaction(void)
+{
+    Pipe *pPipe = &(pipes[0]);
+    VHostTransfer *pTransfer = pPipe->pHead;
+    unsigned char in = (setup[0] & 0x80) != 0;
+    unsigned int length;
+    int result;
+
+    if (stage == STAGE_SETUP) {
+
+        result = UDPHSSim_Setup(address, setup);
+        Account(8, result);
+        if (result != UDPHSSim_ACK) {
+
+            Complete(pPipe, VHOST_NORESPONSE);
+            pipe0Busy = 0;
+            return;
+        }
+        stage = (pTransfer->length > 0) ? STAGE_DATA : STAGE_STATUS;
+        return;
+    }
+
+    if (stage == STAGE_DATA) {
+
+        length = pTransfer->length - pTransfer->actual;
+        if (length > pPipe->maxPacketSize) {
+
+            length = pPipe->maxPacketSize;
+        }
+        if (in) {
+
+            result = UDPHSSim_In(address, 0, pTransfer->pData + pTransfer->actual, length);
+            Account((result > 0) ? result : 0, result);
+            if (result >= 0) {
+
+                pTransfer->actual += result;
+                if ((result < pPipe->maxPacketSize)
+                    || (pTransfer->actual == pTransfer->length)) {
+
+                    stage = STAGE_STATUS;
+                }
+            }
+        }
+        else {
+
+            result = UDPHSSim_Out(address, 0, pTransfer->pData + pTransfer->actual, length);
+            Account(length, result);
+            if (result == UDPHSSim_ACK) {
+
+                pTransfer->actual += length;
+                if (pTransfer->actual == pTransfer->length) {
+
+                    stage = STAGE_STATUS;
+                }
+            }
+        }
+    }
+    else {
+
+        // Zero-length packet in the direction opposite to the data
+        if (in) {
+
+            result = UDPHSSim_Out(address, 0, 0, 0);
+        }
+        else {
+
+            unsigned char dummy[64];
+
+            result = UDPHSSim_In(address, 0, dummy, sizeof(dummy));
+        }
+        Account(0, result);
+        if (result >= 0) {
+
+            pipe0Busy = 0;
+            Complete(pPipe, VHOST_DONE);
+            return;
+        }
+    }
+
+    if (result == UDPHSSim_NAK) {
+
+        return;
+    }
+    if (result < 0) {
+
+        pipe0Busy = 0;
+        Complete(pPipe, Failure(result));
+    }
+}
+
+/// Activates the endpoints of an alternate setting, deactivating the other
+/// endpoints of its interface.
+static void SelectAlternate(unsigned char interface, unsigned char alternate)
+{
+    unsigned int i = 0;
+    unsigned char current = 0;
+    unsigned char selected = 0;
+
+    for (i = 0; i < NUMPIPES; i++) {
+
+        if ((i > 1) && (pipes[i].interface == interface)) {
+
+            pipes[i].active = 0;
+        }
+    }
+
+    i = 0;
+    while ((i + 2 <= configurationLength) && (configuration[i] >= 2)) {
+
+        unsigned char *pDescriptor = &(configuration[i]);
+
+        if (pDescriptor[1] == 4) {
+
+            current = pDescriptor[2];
+            selected = (pDescriptor[2] == interface) && (pDescriptor[3] == alternate);
+        }
+        else if ((pDescriptor[1] == 5) && selected) {
+
+            Pipe *pPipe = &(pipes[PIPE(pDescriptor[2])]);
+            unsigned char bInterval = pDescriptor[6];
+
+            pPipe->active = 1;
+            pPipe->interface = current;
+            pPipe->type = pDescriptor[3] & 3;
+            pPipe->maxPacketSize = (pDescriptor[4] | (pDescriptor[5] << 8)) & 0x7FF;
+            if ((pPipe->type == VHOST_ISOCHRONOUS) || highSpeed) {
+
+                if (bInterval < 1) {
+
+                    bInterval = 1;
+                }
+                if (bInterval > 16) {
+
+                    bInterval = 16;
+                }
+                pPipe->interval = 1 << (bInterval - 1);
+            }
+            else {
+
+                pPipe->interval = (bInterval < 1) ? 1 : bInterval;
+            }
+            if (!highSpeed) {
+
+                pPipe->interval *= 8;
+            }
+            pPipe->due = microframe;
+        }
+        i += configuration[i];
+    }
+}
+
+/// Starts a frame: start of frame, then the periodic pipes whose interval is
+/// due.
+static void StartFrame(void)
+{
+    unsigned int i;
+
+    used = 0;
+    if (UDPHSSim_IsConnected()) {
+
+        UDPHSSim_StartOfFrame(microframe);
+        Service();
+    }
+    if (frameHandler) {
+
+        frameHandler(microframe);
+    }
+
+    // Periodic pipes
+    for (i = 2; i < NUMPIPES; i++) {
+
+        Pipe *pPipe = &(pipes[i]);
+
+        if (pPipe->active
+            && ((pPipe->type == VHOST_ISOCHRONOUS) || (pPipe->type == VHOST_INTERRUPT))
+            && (microframe >= pPipe->due)) {
+
+            pPipe->due += pPipe->interval;
+            if (pPipe->due <= microframe) {
+
+                pPipe->due = microframe + pPipe->interval;
+            }
+            if (pPipe->pHead) {
+
+                Transaction(i);
+                Service();
+            }
+        }
+    }
+}
+
+/// Control, then bulk round-robin; NAKed transactions are retried until the
+/// given position in the frame, the end of the frame for an EHCI controller.
+static void AsyncTransactions(unsigned int limit)
+{
+    unsigned char pending;
+    unsigned int i;
+    static unsigned int next = 2;
+
+    do {
+        pending = 0;
+        if (pipe0Busy && pipes[0].pHead && (used < limit)) {
+
+            ControlTransaction();
+            pending = 1;
+            Service();
+        }
+        for (i = 0; (i < NUMPIPES - 2) && (used < limit); i++) {
+
+            Pipe *pPipe = &(pipes[next]);
+
+            if (pPipe->active && (pPipe->type == VHOST_BULK) && pPipe->pHead) {
+
+                Transaction(next);
+                pending = 1;
+                Service();
+            }
+            next = (next + 1 < NUMPIPES) ? next + 1 : 2;
+        }
+    }
+    while (pending && (used < limit));
+}
+
+//------------------------------------------------------------------------------
+//         Exported functions
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Initializes the host.
+/// \param highSpeed Indicates the host supports high speed.
+/// \param deviceLoop Main loop of the device, run after every transaction.
+//------------------------------------------------------------------------------
+void VHost_Initialize(unsigned char highSpeedCapable, void (*deviceLoop)(void))
+{
+    memset(pipes, 0, sizeof(pipes));
+    memset(&statistics, 0, sizeof(statistics));
+    highSpeedHost = highSpeedCapable;
+    highSpeed = 0;
+    address = 0;
+    loop = deviceLoop;
+    microframe = 0;
+    frameStart = 0;
+    used = 0;
+    pipe0Busy = 0;
+}
+
+//------------------------------------------------------------------------------
+/// Waits for the device to connect, resets it, gives it an address, reads its
+/// configuration descriptor and selects its first configuration.
+/// \return 1 if the device has been configured
+//------------------------------------------------------------------------------
+unsigned char VHost_Enumerate(void)
+{
+    unsigned char descriptor[18];
+    unsigned int i;
+
+    for (i = 0; !UDPHSSim_IsConnected(); i++) {
+
+        if (i == 8000) {
+
+            printf("vhost: device not connected\n");
+            return 0;
+        }
+        Service();
+        VHost_RunFrame();
+    }
+
+    // Bus reset
+    highSpeed = UDPHSSim_Reset(highSpeedHost);
+    address = 0;
+    Service();
+    pipes[0].active = 1;
+    pipes[0].type = VHOST_CONTROL;
+    pipes[0].maxPacketSize = 64;
+    pipes[1] = pipes[0];
+
+    if (VHost_Control(0x80, 6, 0x0100, 0, sizeof(descriptor), descriptor)
+        != sizeof(descriptor)) {
+
+        printf("vhost: GET_DESCRIPTOR(device) failed\n");
+        return 0;
+    }
+    pipes[0].maxPacketSize = descriptor[7];
+    pipes[1].maxPacketSize = descriptor[7];
+
+    if (VHost_Control(0x00, 5, DEVICEADDRESS, 0, 0, 0) != 0) {
+
+        printf("vhost: SET_ADDRESS failed\n");
+        return 0;
+    }
+    address = DEVICEADDRESS;
+
+    if (VHost_Control(0x80, 6, 0x0200, 0, 9, configuration) != 9) {
+
+        printf("vhost: GET_DESCRIPTOR(configuration) failed\n");
+        return 0;
+    }
+    configurationLength = configuration[2] | (configuration[3] << 8);
+    if ((configurationLength > sizeof(configuration))
+        || (VHost_Control(0x80, 6, 0x0200, 0, configurationLength, configuration)
+            != (int) configurationLength)) {
+
+        printf("vhost: GET_DESCRIPTOR(configuration) failed\n");
+        return 0;
+    }
+
+    if (VHost_Control(0x00, 9, configuration[5], 0, 0, 0) != 0) {
+
+        printf("vhost: SET_CONFIGURATION failed\n");
+        return 0;
+    }
+    for (i = 0; i < configuration[4]; i++) {
+
+        SelectAlternate(i, 0);
+    }
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+/// Indicates the device runs at high speed.
+//------------------------------------------------------------------------------
+unsigned char VHost_IsHighSpeed(void)
+{
+    return highSpeed;
+}
+
+//------------------------------------------------------------------------------
+/// Makes a control transfer on endpoint 0, running frames until it is done.
+/// \return Bytes transferred in the data stage, or a negative status
+//------------------------------------------------------------------------------
+int VHost_Control(unsigned char bmRequestType,
+                  unsigned char bRequest,
+                  unsigned short wValue,
+                  unsigned short wIndex,
+                  unsigned short wLength,
+                  void *pData)
+{
+    VHostTransfer transfer;
+    int status;
+
+    memset(&transfer, 0, sizeof(transfer));
+    transfer.endpoint = bmRequestType & 0x80;
+    transfer.pData = pData;
+    transfer.length = wLength;
+
+    setup[0] = bmRequestType;
+    setup[1] = bRequest;
+    setup[2] = wValue & 0xFF;
+    setup[3] = wValue >> 8;
+    setup[4] = wIndex & 0xFF;
+    setup[5] = wIndex >> 8;
+    setup[6] = wLength & 0xFF;
+    setup[7] = wLength >> 8;
+    stage = STAGE_SETUP;
+    pipe0Busy = 1;
+
+    transfer.endpoint = 0;
+    VHost_Submit(&transfer);
+    status = VHost_Wait(&transfer, 1000000000ULL);
+
+    return (status == VHOST_DONE) ? (int) transfer.actual : status;
+}
+
+//------------------------------------------------------------------------------
+/// Selects an alternate setting of an interface.
+/// \return 1 if the device accepted the request
+//------------------------------------------------------------------------------
+unsigned char VHost_SetInterface(unsigned char interface, unsigned char alternate)
+{
+    if (VHost_Control(0x01, 11, alternate, interface, 0, 0) != 0) {
+
+        return 0;
+    }
+    SelectAlternate(interface, alternate);
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+/// Returns the maximum packet size of an active endpoint, 0 if none.
+//------------------------------------------------------------------------------
+unsigned int VHost_GetMaxPacketSize(unsigned char endpoint)
+{
+    Pipe *pPipe = &(pipes[PIPE(endpoint)]);
+
+    return pPipe->active ? pPipe->maxPacketSize : 0;
+}
+
+//------------------------------------------------------------------------------
+/// Queues a transfer on its pipe. Control transfers go through VHost_Control.
+//------------------------------------------------------------------------------
+void VHost_Submit(VHostTransfer *pTransfer)
+{
+    Pipe *pPipe = &(pipes[PIPE(pTransfer->endpoint)]);
+
+    pTransfer->pNext = 0;
+    pTransfer->actual = 0;
+    pTransfer->status = VHOST_PENDING;
+    pTransfer->submitted = VHost_GetTime();
+    if (pPipe->pTail) {
+
+        pPipe->pTail->pNext = pTransfer;
+    }
+    else {
+
+        pPipe->pHead = pTransfer;
+    }
+    pPipe->pTail = pTransfer;
+}
+
+//------------------------------------------------------------------------------
+/// Runs frames until a transfer completes or the timeout elapses. A timed out
+/// transfer stays queued.
+/// \param timeout Bus time, in ns.
+/// \return Status of the transfer
+//------------------------------------------------------------------------------
+int VHost_Wait(VHostTransfer *pTransfer, unsigned long long timeout)
+{
+    unsigned long long end = VHost_GetTime() + timeout;
+
+    while (pTransfer->status == VHOST_PENDING) {
+
+        if (VHost_GetTime() >= end) {
+
+            return VHOST_TIMEOUT;
+        }
+        VHost_RunFrame();
+    }
+    return pTransfer->status;
+}
+
+//------------------------------------------------------------------------------
+/// Runs the bus for one microframe at high speed, one frame at full speed.
+//------------------------------------------------------------------------------
+void VHost_RunFrame(void)
+{
+    StartFrame();
+    AsyncTransactions(Budget());
+    EndFrame();
+}
+
+//------------------------------------------------------------------------------
+/// Lets bus time pass while the device code is busy, e.g. waiting for a slow
+/// media. Called from the device code: the bus runs until the given time has
+/// passed, with the device interrupts handled and its main loop run after
+/// every transaction as usual; the main loop sees it is nested and decides
+/// what it can do meanwhile. The transactions of the interrupted frame then
+/// resume, in the frame the busy time ends in.
+/// \param time Busy time in ns.
+//------------------------------------------------------------------------------
+void VHost_Spend(unsigned long long time)
+{
+    unsigned long long length = highSpeed ? MICROFRAME : 8 * MICROFRAME;
+    unsigned long long end = VHost_GetTime() + time;
+    unsigned int position;
+
+    while (end >= frameStart + length) {
+
+        AsyncTransactions(Budget());
+        EndFrame();
+        StartFrame();
+    }
+
+    // The rest of the busy time is spent in the current frame
+    position = (unsigned int) ((end - frameStart) * Budget() / length);
+    AsyncTransactions(position);
+    if (position > used) {
+
+        used = position;
+    }
+}
+
+//------------------------------------------------------------------------------
+/// Sets a function called at the start of every frame, before the periodic
+/// transactions, e.g. to queue the next isochronous packet.
+//------------------------------------------------------------------------------
+void VHost_SetFrameHandler(void (*handler)(unsigned int microframe))
+{
+    frameHandler = handler;
+}
+
+//------------------------------------------------------------------------------
+/// Returns the bus time, in ns.
+//------------------------------------------------------------------------------
+unsigned long long VHost_GetTime(void)
+{
+    unsigned long long length = highSpeed ? MICROFRAME : 8 * MICROFRAME;
+
+    return frameStart + (unsigned long long) used * length / Budget();
+}
+
+//------------------------------------------------------------------------------
+/// Returns the bus counters.
+//------------------------------------------------------------------------------
+void VHost_GetStatistics(VHostStatistics *pStatistics)
+{
+    *pStatistics = statistics;
+}
@@ -0,0 +1,119 @@
+//------------------------------------------------------------------------------
+// Scripted virtual USB host for the simulated UDPHS controller.
+//
+// The host schedules transactions the way a USB 2.0 host controller does, one
+// (micro)frame at a time: start of frame, then the periodic pipes whose
+// interval is due, then control, then the bulk pipes round-robin. NAKed
+// transactions are retried until the frame budget is used, which is counted
+// in byte times with a fixed overhead per transaction: thirteen 512-byte bulk
+// packets fit in a microframe at high speed, nineteen 64-byte packets in a
+// frame at full speed.
+//
+// After every transaction the pending interrupts of the device are handled
+// and its main loop is run once, so the device sees the bus as if its code
+// took no time; device code modelling a slow operation, such as a media
+// access, calls VHost_Spend() to let the bus run meanwhile. Times are bus
+// times in ns, derived from the position of the transaction in its frame;
+// the time the device code takes on the machine running the simulation is
+// reported by UDPHSSimStatistics.cpuTime.
+//------------------------------------------------------------------------------
+
+#ifndef VHOST_H
+#define VHOST_H
+
+//------------------------------------------------------------------------------
+//         Definitions
+//------------------------------------------------------------------------------
+
+/// Transfer status.
+#define VHOST_PENDING       1
+#define VHOST_DONE          0
+#define VHOST_STALLED       (-1)
+#define VHOST_NORESPONSE    (-2)
+#define VHOST_TIMEOUT       (-3)
+
+/// Endpoint types, as in bmAttributes.
+#define VHOST_CONTROL       0
+#define VHOST_ISOCHRONOUS   1
+#define VHOST_BULK          2
+#define VHOST_INTERRUPT     3
+
+//------------------------------------------------------------------------------
+//         Types
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Transfer queued on a pipe. Bulk and interrupt transfers span as many
+/// packets as needed and IN transfers end on a short packet; an isochronous
+/// transfer is a single packet sent or received in the next service interval.
+//------------------------------------------------------------------------------
+typedef struct _VHostTransfer {
+
+    struct _VHostTransfer *pNext;
+    /// Endpoint address, bit 7 set for IN.
+    unsigned char endpoint;
+    /// OUT: end a transfer of whole packets with a zero-length packet.
+    unsigned char zlp;
+    unsigned char *pData;
+    unsigned int length;
+    /// Bytes transferred.
+    unsigned int actual;
+    volatile int status;
+    /// Bus times of the submission and of the completion.
+    unsigned long long submitted;
+    unsigned long long completed;
+    /// Invoked on completion, may be null.
+    void (*callback)(struct _VHostTransfer *pTransfer);
+    void *pArgument;
+
+} VHostTransfer;
+
+//------------------------------------------------------------------------------
+/// Bus counters.
+//------------------------------------------------------------------------------
+typedef struct {
+
+    unsigned long long microframes;
+    unsigned long long transactions;
+    unsigned long long naks;
+    unsigned long long bytes;
+
+} VHostStatistics;
+
+//------------------------------------------------------------------------------
+//         Exported functions
+//------------------------------------------------------------------------------
+
+extern void VHost_Initialize(unsigned char highSpeed, void (*deviceLoop)(void));
+
+extern unsigned char VHost_Enumerate(void);
+
+extern unsigned char VHost_IsHighSpeed(void);
+
+extern int VHost_Control(unsigned char bmRequestType,
+                         unsigned char bRequest,
+                         unsigned short wValue,
+                         unsigned short wIndex,
+                         unsigned short wLength,
+                         void *pData);
+
+extern unsigned char VHost_SetInterface(unsigned char interface,
+                                        unsigned char alternate);
+
+extern unsigned int VHost_GetMaxPacketSize(unsigned char endpoint);
+
+extern void VHost_Submit(VHostTransfer *pTransfer);
+
+extern int VHost_Wait(VHostTransfer *pTransfer, unsigned long long timeout);
+
+extern void VHost_RunFrame(void);
+
+extern void VHost_Spend(unsigned long long time);
+
+extern void VHost_SetFrameHandler(void (*handler)(unsigned int microframe));
+
+extern unsigned long long VHost_GetTime(void);
+
+extern void VHost_GetStatistics(VHostStatistics *pStatistics);
+
+#endif //#ifndef VHOST_H
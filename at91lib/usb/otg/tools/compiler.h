@@ -0,0 +1,23 @@
+//------------------------------------------------------------------------------
+// Types of the OTG stack, for the host build of pipebench.
+//------------------------------------------------------------------------------
+
+#ifndef _COMPILER_H_
+#define _COMPILER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint8_t  U8;
+typedef uint16_t U16;
+typedef uint32_t U32;
+typedef uint8_t  bit;
+
+#define TRUE      1
+#define FALSE     0
+#define ENABLE    1
+#define DISABLE   0
+#define ENABLED   1
+#define DISABLED  0
+
+#endif /* _COMPILER_H_ */
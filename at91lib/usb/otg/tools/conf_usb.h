@@ -0,0 +1,19 @@
+//------------------------------------------------------------------------------
+// OTG stack configuration, for the host build of pipebench.
+//------------------------------------------------------------------------------
+
+#ifndef _CONF_USB_H_
+#define _CONF_USB_H_
+
+#include "compiler.h"
+
+#define USB_HOST_FEATURE                  ENABLED
+#define USB_DEVICE_FEATURE                DISABLED
+#define USB_OTG_FEATURE                   DISABLED
+#define USB_HOST_PIPE_INTERRUPT_TRANSFER  DISABLE
+#define USB_HOST_PIPE_REQUEST             ENABLE
+#define MAX_EP_NB                         8
+#define SIZEOF_DATA_STAGE                 250
+#define MAX_INTERFACE_SUPPORTED           4
+
+#endif /* _CONF_USB_H_ */
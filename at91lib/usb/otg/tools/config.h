@@ -0,0 +1,93 @@
+//------------------------------------------------------------------------------
+// Board configuration for the host build of pipebench: the registers used by
+// usb_host_pipe.c are those of the simulated controller in pipebench.c.
+//------------------------------------------------------------------------------
+
+#ifndef _CONFIG_H_
+#define _CONFIG_H_
+
+#include "compiler.h"
+
+//------------------------------------------------------------------------------
+// OTGHS register bits
+//------------------------------------------------------------------------------
+
+// HSTPIPCFG
+#define AT91C_OTGHS_PSIZE         (0x7u << 4)
+#define AT91C_OTGHS_PTOKEN        (0x3u << 8)
+#define AT91C_OTGHS_PTOKEN_SETUP  (0x0u << 8)
+#define AT91C_OTGHS_PTOKEN_IN     (0x1u << 8)
+#define AT91C_OTGHS_PTOKEN_OUT    (0x2u << 8)
+#define AT91C_OTGHS_AUTOSW        (0x1u << 10)
+// HSTPIPISR, HSTPIPIMR
+#define AT91C_OTGHS_RXINI         (0x1u << 0)
+#define AT91C_OTGHS_TXOUT         (0x1u << 1)
+#define AT91C_OTGHS_PERR          (0x1u << 3)
+#define AT91C_OTGHS_RXSTALL       (0x1u << 6)
+#define AT91C_OTGHS_FIFOCON       (0x1u << 14)
+#define AT91C_OTGHS_FREEZE        (0x1u << 17)
+#define AT91C_OTGHS_PBYCT         (0x7FFu << 20)
+// HSTPIPINRQ
+#define AT91C_OTGHS_INMOD         (0x1u << 8)
+// HSTDMACONTROL, HSTDMASTATUS
+#define AT91C_OTGHS_CHANN_ENB     (0x1u << 0)
+#define AT91C_OTGHS_END_TR_EN     (0x1u << 2)
+#define AT91C_OTGHS_END_B_EN      (0x1u << 3)
+#define AT91C_OTGHS_END_TR_IT     (0x1u << 4)
+#define AT91C_OTGHS_END_BUFFIT    (0x1u << 5)
+#define AT91C_OTGHS_END_TR_ST     (0x1u << 4)
+#define AT91C_OTGHS_END_BF_ST     (0x1u << 5)
+#define AT91C_OTGHS_BUFF_LENGTH   (0xFFFFu << 16)
+#define AT91C_OTGHS_BUFF_COUNT    (0xFFFFu << 16)
+
+//------------------------------------------------------------------------------
+// Simulated registers (pipebench.c)
+//------------------------------------------------------------------------------
+
+typedef struct {
+
+    U32 cfg;
+    U32 isr;
+    U32 imr;
+    U32 err;
+    U32 inrq;
+    unsigned long dmaAddress;
+    U32 dmaControl;
+    U32 dmaStatus;
+
+} SimPipe;
+
+extern SimPipe simPipes[];
+extern U32 simHstip;
+extern U32 simHstimr;
+extern U8 simDmaChannels;
+
+extern U32 SimHstisr(void);
+extern void SimPipeSet(U8 pipe, U32 bits);
+extern void SimPipeClear(U8 pipe, U32 bits);
+extern void SimPipeAck(U8 pipe, U32 bits);
+extern volatile U8 *SimPipeFifo(U8 pipe);
+extern U32 SimDmaStatus(U8 pipe);
+extern void SimPipeReset(U8 pipe);
+
+#define Host_pipe_cfg(p)              (simPipes[p].cfg)
+#define Host_pipe_isr(p)              (simPipes[p].isr)
+#define Host_pipe_imr(p)              (simPipes[p].imr)
+#define Host_pipe_icr(p, bits)        SimPipeAck(p, bits)
+#define Host_pipe_ier(p, bits)        SimPipeSet(p, bits)
+#define Host_pipe_idr(p, bits)        SimPipeClear(p, bits)
+#define Host_pipe_err(p)              (simPipes[p].err)
+#define Host_pipe_inrq(p)             (simPipes[p].inrq)
+#define Host_pipe_fifo(p)             SimPipeFifo(p)
+#define Is_host_pipe_enabled(p)       (simHstip & (1 << (p)))
+#define Host_pipe_reset(p)            SimPipeReset(p)
+#define Host_pipe_it_enable(bits)     (simHstimr |= (bits))
+#define Host_pipe_it_disable(bits)    (simHstimr &= ~(bits))
+#define Host_pipe_it_status()         (SimHstisr() & simHstimr)
+#define Host_dma_address(p)           (simPipes[p].dmaAddress)
+#define Host_dma_control(p)           (simPipes[p].dmaControl)
+#define Host_dma_status(p)            SimDmaStatus(p)
+
+#define HOST_PIPE_DMA_CHANNELS        simDmaChannels
+
+#endif /* _CONFIG_H_ */
@@ -0,0 +1,626 @@
+//------------------------------------------------------------------------------
+// Host-side benchmark of the asynchronous pipe requests (usb_host_pipe.c).
+//
+// usb_host_pipe.c is built against a simulated OTGHS host controller (see
+// config.h) with a high speed bulk device behind it: pipe 1 reads from a bulk
+// IN endpoint and pipe 2 writes to a bulk OUT endpoint, both 512 bytes with
+// two banks, the bus carrying up to 13 packets per microframe. The device
+// never NAKs, so the bus is only idle when the host has nothing to send or no
+// bank to receive into.
+//
+// The application keeps a number of requests queued on each pipe. Each time
+// one completes it is queued again, either from its handle (in the pipe
+// interrupt) or, to model a task woken by the handle, from the main loop a
+// given number of microframes later. With one request and a latency, this is
+// how host_get_data()/host_send_data() behave, except that those also keep
+// the CPU busy until the transfer ends.
+//
+// Build with make, and run on the host:
+//
+//   ./pipebench [requests] [request size] [latency, microframes]
+//               [DMA channels; 0 = FIFO only] [seconds]
+//
+// Printed for each pipe: the throughput, the requests completed, then the
+// pipe interrupts taken, the bytes the CPU copied through the FIFO and the
+// average time spent in host_pipe_interrupt().
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "config.h"
+#include "conf_usb.h"
+#include "usb/otg/usb_host_pipe.h"
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Pipes of the simulated device.
+#define PIPE_IN         1
+#define PIPE_OUT        2
+/// Pipe size, encoded in HSTPIPCFG.PSIZE.
+#define PIPESIZE        512
+#define PSIZE_512       (6 << 4)
+/// Banks per pipe.
+#define BANKS           2
+/// High speed bulk packets per microframe.
+#define PACKETS_PER_UFRAME  13
+/// Largest number of requests queued per pipe.
+#define MAXREQUESTS     16
+
+//------------------------------------------------------------------------------
+//         Local types
+//------------------------------------------------------------------------------
+
+/// Banks of a pipe, and the state of the transfers of the device behind it.
+typedef struct {
+
+    U8 data[BANKS][PIPESIZE];
+    U16 length[BANKS];
+    U8 full[BANKS];
+    /// Bank the CPU or the DMA works on.
+    U8 cpuBank;
+    /// Bank the USB works on.
+    U8 usbBank;
+    U8 rxini;
+    U8 txout;
+    /// DMA channel state.
+    U8 dmaRunning;
+    U8 dmaIrq;
+    U32 dmaCount;
+    U32 dmaDone;
+    /// Stream position of the device, for the data pattern.
+    unsigned long long position;
+    /// Counters.
+    unsigned long long fifoBytes;
+    unsigned long long errors;
+
+} SimBanks;
+
+/// Request of the application and its completion time.
+typedef struct {
+
+    S_pipe_request request;
+    U8 pipe;
+    U8 done;
+    unsigned long long resubmitAt;
+
+} BenchRequest;
+
+//------------------------------------------------------------------------------
+//         Simulated registers
+//------------------------------------------------------------------------------
+
+SimPipe simPipes[MAX_EP_NB];
+U32 simHstip;
+U32 simHstimr;
+U8 simDmaChannels = 7;
+
+static SimBanks banks[MAX_EP_NB];
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+static BenchRequest requests[2][MAXREQUESTS];
+static U8 *buffers[2][MAXREQUESTS];
+static unsigned int requestSize;
+static unsigned int latency;
+static unsigned long long microframe;
+static unsigned long long bytes[2];
+static unsigned long long completed[2];
+static unsigned long long interrupts;
+static unsigned long long interruptNs;
+static unsigned long long handleNs;
+static unsigned long long inPosition;
+
+//------------------------------------------------------------------------------
+//         Local functions
+//------------------------------------------------------------------------------
+
+/// Byte of the data stream at the given position; never zero, so that the
+/// length of an OUT bank written by the CPU can be found.
+static U8 Pattern(unsigned long long position)
+{
+    return (U8) (position % 251) + 1;
+}
+
+static unsigned int Index(U8 pipe)
+{
+    return (pipe == PIPE_IN) ? 0 : 1;
+}
+
+static int IsIn(U8 pipe)
+{
+    return (simPipes[pipe].cfg & AT91C_OTGHS_PTOKEN) == AT91C_OTGHS_PTOKEN_IN;
+}
+
+/// Updates the pipe status register from the bank state.
+static void Update(U8 pipe)
+{
+    SimBanks *b = &banks[pipe];
+    SimPipe *p = &simPipes[pipe];
+
+    p->isr &= ~(AT91C_OTGHS_RXINI | AT91C_OTGHS_TXOUT | AT91C_OTGHS_PBYCT);
+    if (IsIn(pipe)) {
+
+        if (b->rxini) {
+
+            p->isr |= AT91C_OTGHS_RXINI;
+        }
+        if (b->full[b->cpuBank]) {
+
+            p->isr |= b->length[b->cpuBank] << 20;
+        }
+    }
+    else if (b->txout) {
+
+        p->isr |= AT91C_OTGHS_TXOUT;
+    }
+}
+
+/// Gives the CPU bank back to the USB.
+static void Release(U8 pipe, U16 length)
+{
+    SimBanks *b = &banks[pipe];
+
+    if (IsIn(pipe)) {
+
+        b->full[b->cpuBank] = 0;
+        b->cpuBank = (b->cpuBank + 1) % BANKS;
+        b->rxini = b->full[b->cpuBank];
+    }
+    else {
+
+        b->length[b->cpuBank] = length;
+        b->full[b->cpuBank] = 1;
+        b->cpuBank = (b->cpuBank + 1) % BANKS;
+        b->txout = !b->full[b->cpuBank];
+    }
+    Update(pipe);
+}
+
+//------------------------------------------------------------------------------
+/// Register access of usb_host_pipe.c, see config.h.
+//------------------------------------------------------------------------------
+U32 SimHstisr(void)
+{
+    U32 status = 0;
+    U8 pipe;
+
+    for (pipe = 1; pipe < MAX_EP_NB; pipe++) {
+
+        SimPipe *p = &simPipes[pipe];
+        U32 events = AT91C_OTGHS_RXINI | AT91C_OTGHS_TXOUT
+                     | AT91C_OTGHS_RXSTALL | AT91C_OTGHS_PERR;
+
+        if (p->isr & p->imr & events) {
+
+            status |= 1 << 8 << pipe;
+        }
+        if (banks[pipe].dmaIrq) {
+
+            status |= 1 << 24 << pipe;
+        }
+    }
+    return status;
+}
+
+void SimPipeSet(U8 pipe, U32 bits)
+{
+    simPipes[pipe].imr |= bits & ~AT91C_OTGHS_FIFOCON;
+}
+
+void SimPipeClear(U8 pipe, U32 bits)
+{
+    SimBanks *b = &banks[pipe];
+
+    simPipes[pipe].imr &= ~(bits & ~AT91C_OTGHS_FIFOCON);
+    if (bits & AT91C_OTGHS_FIFOCON) {
+
+        U16 length = 0;
+
+        // The CPU wrote the bank up to the first zero
+        if (!IsIn(pipe)) {
+
+            while (length < PIPESIZE && b->data[b->cpuBank][length] != 0) {
+
+                length++;
+            }
+        }
+        b->fifoBytes += IsIn(pipe) ? b->length[b->cpuBank] : length;
+        Release(pipe, length);
+    }
+}
+
+void SimPipeAck(U8 pipe, U32 bits)
+{
+    if (bits & AT91C_OTGHS_RXINI) {
+
+        banks[pipe].rxini = 0;
+    }
+    if (bits & AT91C_OTGHS_TXOUT) {
+
+        banks[pipe].txout = 0;
+    }
+    simPipes[pipe].isr &= ~(bits & AT91C_OTGHS_RXSTALL);
+    Update(pipe);
+}
+
+volatile U8 *SimPipeFifo(U8 pipe)
+{
+    return banks[pipe].data[banks[pipe].cpuBank];
+}
+
+U32 SimDmaStatus(U8 pipe)
+{
+    SimBanks *b = &banks[pipe];
+    U32 status = simPipes[pipe].dmaStatus;
+
+    // Stopped by software
+    if (b->dmaRunning && !(simPipes[pipe].dmaControl & AT91C_OTGHS_CHANN_ENB)) {
+
+        b->dmaRunning = 0;
+    }
+    status = (status & ~AT91C_OTGHS_BUFF_COUNT)
+             | ((b->dmaCount - b->dmaDone) << 16);
+    simPipes[pipe].dmaStatus &= ~(AT91C_OTGHS_END_TR_ST | AT91C_OTGHS_END_BF_ST);
+    b->dmaIrq = 0;
+    return status;
+}
+
+void SimPipeReset(U8 pipe)
+{
+    SimBanks *b = &banks[pipe];
+
+    memset(b->data, 0, sizeof(b->data));
+    memset(b->full, 0, sizeof(b->full));
+    b->cpuBank = b->usbBank = 0;
+    b->rxini = 0;
+    b->txout = 1;
+    Update(pipe);
+}
+
+//------------------------------------------------------------------------------
+/// Ends the DMA transfer of a pipe.
+//------------------------------------------------------------------------------
+static void DmaEnd(U8 pipe, U32 status)
+{
+    SimBanks *b = &banks[pipe];
+    SimPipe *p = &simPipes[pipe];
+
+    b->dmaRunning = 0;
+    p->dmaControl &= ~AT91C_OTGHS_CHANN_ENB;
+    p->dmaStatus |= status;
+    if ((p->dmaControl & (AT91C_OTGHS_END_TR_IT | AT91C_OTGHS_END_BUFFIT)) != 0) {
+
+        b->dmaIrq = 1;
+    }
+}
+
+//------------------------------------------------------------------------------
+/// Moves data between the banks and the memory for the enabled DMA channels.
+//------------------------------------------------------------------------------
+static void Dma(void)
+{
+    U8 pipe;
+
+    for (pipe = 1; pipe < MAX_EP_NB; pipe++) {
+
+        SimBanks *b = &banks[pipe];
+        SimPipe *p = &simPipes[pipe];
+        U8 *memory = (U8 *) p->dmaAddress;
+
+        if (!b->dmaRunning) {
+
+            if (!(p->dmaControl & AT91C_OTGHS_CHANN_ENB) || b->dmaIrq) {
+
+                continue;
+            }
+            b->dmaRunning = 1;
+            b->dmaCount = p->dmaControl >> 16;
+            b->dmaDone = 0;
+        }
+
+        if (IsIn(pipe)) {
+
+            while (b->dmaRunning && b->full[b->cpuBank]) {
+
+                U16 length = b->length[b->cpuBank];
+
+                if (length > b->dmaCount - b->dmaDone) {
+
+                    length = b->dmaCount - b->dmaDone;
+                }
+                memcpy(memory + b->dmaDone, b->data[b->cpuBank], length);
+                b->dmaDone += length;
+                Release(pipe, 0);
+                if (length < PIPESIZE
+                    && (p->dmaControl & AT91C_OTGHS_END_TR_EN)) {
+
+                    DmaEnd(pipe, AT91C_OTGHS_END_TR_ST);
+                }
+                else if (b->dmaDone == b->dmaCount) {
+
+                    DmaEnd(pipe, AT91C_OTGHS_END_BF_ST);
+                }
+            }
+        }
+        else {
+
+            while (b->dmaRunning && !b->full[b->cpuBank]) {
+
+                U32 length = b->dmaCount - b->dmaDone;
+
+                if (length > PIPESIZE) {
+
+                    length = PIPESIZE;
+                }
+                memcpy(b->data[b->cpuBank], memory + b->dmaDone, length);
+                b->dmaDone += length;
+                Release(pipe, length);
+                if (b->dmaDone == b->dmaCount) {
+
+                    DmaEnd(pipe, AT91C_OTGHS_END_BF_ST);
+                }
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+/// The device: at most one packet on each pipe. Returns the number of packets
+/// moved on the bus, out of the given budget.
+//------------------------------------------------------------------------------
+static unsigned int Device(unsigned int budget)
+{
+    unsigned int packets = 0;
+    U8 pipe;
+
+    for (pipe = PIPE_IN; pipe <= PIPE_OUT && packets < budget; pipe++) {
+
+        SimBanks *b = &banks[pipe];
+        SimPipe *p = &simPipes[pipe];
+        unsigned int i, length;
+
+        if (IsIn(pipe)) {
+
+            if ((p->imr & AT91C_OTGHS_FREEZE) || b->full[b->usbBank]) {
+
+                continue;
+            }
+            // Transfers of the request size, ended by a short packet
+            length = requestSize - (unsigned int) (b->position % requestSize);
+            if (length > PIPESIZE) {
+
+                length = PIPESIZE;
+            }
+            for (i = 0; i < length; i++) {
+
+                b->data[b->usbBank][i] = Pattern(b->position++);
+            }
+            b->length[b->usbBank] = length;
+            b->full[b->usbBank] = 1;
+            if (b->usbBank == b->cpuBank) {
+
+                b->rxini = 1;
+            }
+            b->usbBank = (b->usbBank + 1) % BANKS;
+        }
+        else {
+
+            if (!b->full[b->usbBank]) {
+
+                continue;
+            }
+            for (i = 0; i < b->length[b->usbBank]; i++) {
+
+                if (b->data[b->usbBank][i] != Pattern(b->position++)) {
+
+                    b->errors++;
+                }
+            }
+            memset(b->data[b->usbBank], 0, PIPESIZE);
+            b->full[b->usbBank] = 0;
+            b->usbBank = (b->usbBank + 1) % BANKS;
+            if (!b->full[b->cpuBank]) {
+
+                b->txout = 1;
+            }
+        }
+        Update(pipe);
+        packets++;
+    }
+    return packets;
+}
+
+//------------------------------------------------------------------------------
+/// Fills the buffer of an OUT request with the next data of the stream.
+//------------------------------------------------------------------------------
+static unsigned long long outPosition;
+
+static void Submit(BenchRequest *r)
+{
+    unsigned int i;
+
+    r->done = 0;
+    if (r->pipe == PIPE_OUT) {
+
+        for (i = 0; i < requestSize; i++) {
+
+            r->request.buf[i] = Pattern(outPosition++);
+        }
+    }
+    host_pipe_submit(r->pipe, &r->request);
+}
+
+/// Checks the data of an IN request.
+static void Check(BenchRequest *r)
+{
+    unsigned int i;
+
+    for (i = 0; i < r->request.nb_byte_processed; i++) {
+
+        if (r->request.buf[i] != Pattern(inPosition++)) {
+
+            banks[PIPE_IN].errors++;
+        }
+    }
+}
+
+static unsigned long long Now(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (unsigned long long) t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+/// Completion of a request. The time spent here filling and checking the
+/// data is not counted as interrupt time.
+static void Handle(S_pipe_request *req)
+{
+    BenchRequest *r = (BenchRequest *) req->arg;
+    unsigned int index = Index(r->pipe);
+    unsigned long long start = Now();
+
+    if (req->status != PIPE_GOOD) {
+
+        printf("pipe %u: status 0x%02X\n", r->pipe, req->status);
+        exit(1);
+    }
+    bytes[index] += req->nb_byte_processed;
+    completed[index]++;
+    if (r->pipe == PIPE_IN) {
+
+        Check(r);
+    }
+    if (latency == 0) {
+
+        Submit(r);
+    }
+    else {
+
+        r->done = 1;
+        r->resubmitAt = microframe + latency;
+    }
+    handleNs += Now() - start;
+}
+
+/// Takes the pipe interrupts, as long as one is pending.
+static void Interrupts(void)
+{
+    unsigned int n;
+
+    for (n = 0; n < 64 && (SimHstisr() & simHstimr); n++) {
+
+        unsigned long long start = Now();
+
+        handleNs = 0;
+        host_pipe_interrupt();
+        interruptNs += Now() - start - handleNs;
+        interrupts++;
+        Dma();
+    }
+}
+
+//------------------------------------------------------------------------------
+//         Main function
+//------------------------------------------------------------------------------
+
+int main(int argc, char **argv)
+{
+    unsigned int depth = (argc > 1) ? atoi(argv[1]) : 2;
+    unsigned int seconds;
+    unsigned int budget, packets;
+    unsigned int i, j;
+    double time;
+
+    requestSize = (argc > 2) ? atoi(argv[2]) : 16384;
+    latency = (argc > 3) ? atoi(argv[3]) : 0;
+    simDmaChannels = (argc > 4) ? atoi(argv[4]) : 7;
+    seconds = (argc > 5) ? atoi(argv[5]) : 2;
+    if (depth < 1 || depth > MAXREQUESTS || requestSize == 0
+        || requestSize > 65536) {
+
+        printf("usage: pipebench [requests 1-%u] [size] [latency] "
+               "[dma channels] [seconds]\n", MAXREQUESTS);
+        return 1;
+    }
+
+    // Pipes as left by the enumeration
+    simHstip = (1 << PIPE_IN) | (1 << PIPE_OUT);
+    simPipes[PIPE_IN].cfg = AT91C_OTGHS_PTOKEN_IN | PSIZE_512;
+    simPipes[PIPE_OUT].cfg = AT91C_OTGHS_PTOKEN_OUT | PSIZE_512;
+    simPipes[PIPE_IN].imr = AT91C_OTGHS_FREEZE;
+    SimPipeReset(PIPE_IN);
+    SimPipeReset(PIPE_OUT);
+    host_pipe_init();
+
+    for (i = 0; i < 2; i++) {
+
+        for (j = 0; j < depth; j++) {
+
+            BenchRequest *r = &requests[i][j];
+
+            // Word aligned, as from malloc
+            buffers[i][j] = malloc(requestSize);
+            r->pipe = i ? PIPE_OUT : PIPE_IN;
+            r->request.buf = buffers[i][j];
+            r->request.nb_byte = requestSize;
+            r->request.handle = Handle;
+            r->request.arg = r;
+            r->request.flags = 0;
+            Submit(r);
+        }
+    }
+
+    for (microframe = 0; microframe < (unsigned long long) seconds * 8000;
+         microframe++) {
+
+        // Tasks woken by a completion
+        if (latency != 0) {
+
+            for (i = 0; i < 2; i++) {
+
+                for (j = 0; j < depth; j++) {
+
+                    BenchRequest *r = &requests[i][j];
+
+                    if (r->done && r->resubmitAt <= microframe) {
+
+                        Submit(r);
+                    }
+                }
+            }
+        }
+        // The CPU and the DMA keep up with the bus, packet by packet
+        budget = PACKETS_PER_UFRAME;
+        do {
+
+            Interrupts();
+            Dma();
+            Interrupts();
+            packets = Device(budget);
+            budget -= packets;
+        } while (packets != 0 && budget != 0);
+        Dma();
+        Interrupts();
+    }
+
+    time = (double) seconds;
+    printf("%u x %u bytes, latency %u uframes, %u DMA channels\n", depth,
+           requestSize, latency, simDmaChannels ? simDmaChannels - 1 : 0);
+    printf("  IN  %6.2f MB/s  %8llu requests  %llu errors\n",
+           bytes[0] / time / 1e6, completed[0], banks[PIPE_IN].errors);
+    printf("  OUT %6.2f MB/s  %8llu requests  %llu errors\n",
+           bytes[1] / time / 1e6, completed[1], banks[PIPE_OUT].errors);
+    printf("  %.0f interrupts/s, CPU copied %.2f MB/s, %.0f ns per interrupt\n",
+           interrupts / time,
+           (banks[PIPE_IN].fifoBytes + banks[PIPE_OUT].fifoBytes) / time / 1e6,
+           interrupts ? (double) interruptNs / interrupts : 0.0);
+    return (banks[PIPE_IN].errors + banks[PIPE_OUT].errors) ? 1 : 0;
+}
@@ -0,0 +1,533 @@
+/**
+ * @file usb_host_pipe.c
+ *
+ * Copyright (c) 2004 Atmel.
+ *
+ * Please read file license.txt for copyright notice.
+ *
+ * @brief Asynchronous, interrupt driven transfers on the host pipes.
+ *
+ * Each pipe has a queue of requests. The request at the head of the queue is
+ * the one the pipe works on: it is moved through the pipe DMA channel when
+ * the pipe has one, otherwise through the FIFO from the pipe interrupt, one
+ * bank at a time. When it is done, the next request is started before its
+ * handle is called, so that the pipe keeps streaming while the handle runs.
+ *
+ * IN pipes run in continuous IN mode while requests are queued and are
+ * frozen when the queue gets empty; a packet received meanwhile waits in the
+ * FIFO for the next request. A pipe error or a STALL fails all the requests
+ * of the pipe. NAKs are not counted: a request waits for the device as long
+ * as it takes, and host_pipe_abort() gives up on it.
+ *
+ * The registers are reached through the Host_pipe_xxx macros below, which
+ * config.h may define instead to run the module against a simulated device
+ * (see tools/pipebench.c).
+ *
+ * @todo
+ * @bug
+ */
+
+//_____  I N C L U D E S ___________________________________________________
+
+#include "config.h"
+#include "conf_usb.h"
+#include "usb/otg/usb_host_pipe.h"
+#include "usb/otg/usb_host_enum.h"
+
+#ifndef Host_pipe_cfg
+   #include "usb/otg/usb_drv.h"
+#endif
+
+#if (USB_HOST_FEATURE == ENABLED)
+
+//_____ M A C R O S ________________________________________________________
+
+#ifndef Host_pipe_cfg
+   //! Pipe registers, by pipe number
+   #define Host_pipe_cfg(p)              (AT91C_BASE_OTGHS->OTGHS_HSTPIPCFG[p])
+   #define Host_pipe_isr(p)              (AT91C_BASE_OTGHS->OTGHS_HSTPIPISR[p])
+   #define Host_pipe_imr(p)              (AT91C_BASE_OTGHS->OTGHS_HSTPIPIMR[p])
+   #define Host_pipe_icr(p, bits)        (AT91C_BASE_OTGHS->OTGHS_HSTPIPICR[p] = (bits))
+   #define Host_pipe_ier(p, bits)        (AT91C_BASE_OTGHS->OTGHS_HSTPIPIER[p] = (bits))
+   #define Host_pipe_idr(p, bits)        (AT91C_BASE_OTGHS->OTGHS_HSTPIPIDR[p] = (bits))
+   #define Host_pipe_err(p)              (AT91C_BASE_OTGHS->OTGHS_HSTPIPERR[p])
+   #define Host_pipe_inrq(p)             (AT91C_BASE_OTGHS->OTGHS_HSTPIPINRQ[p])
+   #define Host_pipe_fifo(p)             ((volatile U8 *)((unsigned int *)AT91C_BASE_OTGHS_EPTFIFO + (EPT_VIRTUAL_SIZE * (p))))
+   #define Is_host_pipe_enabled(p)       (AT91C_BASE_OTGHS->OTGHS_HSTPIP & (1<<(p)))
+   #define Host_pipe_reset(p)            AT91C_BASE_OTGHS->OTGHS_HSTPIP |= (1<<16<<(p));\
+                                         AT91C_BASE_OTGHS->OTGHS_HSTPIP &= ~(1<<16<<(p))
+   //! Host interrupt registers
+   #define Host_pipe_it_enable(bits)     (AT91C_BASE_OTGHS->OTGHS_HSTIER = (bits))
+   #define Host_pipe_it_disable(bits)    (AT91C_BASE_OTGHS->OTGHS_HSTIDR = (bits))
+   #define Host_pipe_it_status()         (AT91C_BASE_OTGHS->OTGHS_HSTISR & AT91C_BASE_OTGHS->OTGHS_HSTIMR)
+   //! Pipe DMA channel registers, by pipe number
+   #define Host_dma_address(p)           (AT91C_BASE_OTGHS->OTGHS_HSTDMA[p].OTGHS_HSTDMAADDRESS)
+   #define Host_dma_control(p)           (AT91C_BASE_OTGHS->OTGHS_HSTDMA[p].OTGHS_HSTDMACONTROL)
+   #define Host_dma_status(p)            (AT91C_BASE_OTGHS->OTGHS_HSTDMA[p].OTGHS_HSTDMASTATUS)
+#endif
+
+//! Pipe and pipe DMA bits of the host interrupt registers
+#define SHIFT_PIPE_IT         8
+#define SHIFT_PIPE_DMA        24
+#define Pipe_it(p)            (1UL<<SHIFT_PIPE_IT<<(p))
+#define Pipe_dma_it(p)        (1UL<<SHIFT_PIPE_DMA<<(p))
+
+//! Pipes 1 to HOST_PIPE_DMA_CHANNELS-1 have a DMA channel
+#ifndef HOST_PIPE_DMA_CHANNELS
+   #define HOST_PIPE_DMA_CHANNELS   7
+#endif
+//! Largest buffer of a single DMA transfer, a multiple of all pipe sizes
+#define HOST_PIPE_DMA_MAX_SIZE      32768
+
+#define Is_pipe_in(p)         ((Host_pipe_cfg(p) & AT91C_OTGHS_PTOKEN) == AT91C_OTGHS_PTOKEN_IN)
+#define Is_pipe_out(p)        ((Host_pipe_cfg(p) & AT91C_OTGHS_PTOKEN) == AT91C_OTGHS_PTOKEN_OUT)
+#define Pipe_size(p)          ((U16)8 << ((Host_pipe_cfg(p) & AT91C_OTGHS_PSIZE) >> 4))
+#define Pipe_byte_count(p)    ((U16)((Host_pipe_isr(p) & AT91C_OTGHS_PBYCT) >> 20))
+
+//_____ D E C L A R A T I O N S ____________________________________________
+
+typedef struct
+{
+   S_pipe_request *head;   //!< Request in progress
+   S_pipe_request *tail;   //!< Last request queued
+   U32 on_going;           //!< Bytes of the DMA transfer in progress
+   U8  dma;                //!< The head request runs on the DMA channel
+   U8  zlp;                //!< A zero length packet ends the head request
+} S_pipe_queue;
+
+static S_pipe_queue pipe_queue[MAX_EP_NB];
+
+//_____ L O C A L   F U N C T I O N S ______________________________________
+
+//! Masks the interrupts of a pipe, so that its queue can be changed
+static void pipe_lock(U8 pipe)
+{
+   Host_pipe_it_disable(Pipe_it(pipe) | Pipe_dma_it(pipe));
+}
+
+//! Unmasks the interrupts the pipe needs in its current state
+static void pipe_unlock(U8 pipe)
+{
+   if (pipe_queue[pipe].head != NULL)
+   {
+      Host_pipe_it_enable(Pipe_it(pipe) | (pipe_queue[pipe].dma ? Pipe_dma_it(pipe) : 0));
+   }
+}
+
+//! Copies n bytes to the FIFO of a pipe, by words when both sides are aligned
+static void pipe_write_fifo(U8 pipe, const U8 *buf, U16 n)
+{
+   volatile U8 *fifo = Host_pipe_fifo(pipe);
+
+   if ((((unsigned long)buf | (unsigned long)fifo) & 3) == 0)
+   {
+      volatile U32 *fifo32 = (volatile U32 *)fifo;
+      const U32 *buf32 = (const U32 *)buf;
+
+      for (; n >= 4; n -= 4)
+      {
+         *fifo32++ = *buf32++;
+      }
+      fifo = (volatile U8 *)fifo32;
+      buf = (const U8 *)buf32;
+   }
+   while (n--)
+   {
+      *fifo++ = *buf++;
+   }
+}
+
+//! Copies n bytes from the FIFO of a pipe, by words when both sides are aligned
+static void pipe_read_fifo(U8 pipe, U8 *buf, U16 n)
+{
+   volatile U8 *fifo = Host_pipe_fifo(pipe);
+
+   if ((((unsigned long)buf | (unsigned long)fifo) & 3) == 0)
+   {
+      volatile U32 *fifo32 = (volatile U32 *)fifo;
+      U32 *buf32 = (U32 *)buf;
+
+      for (; n >= 4; n -= 4)
+      {
+         *buf32++ = *fifo32++;
+      }
+      fifo = (volatile U8 *)fifo32;
+      buf = (U8 *)buf32;
+   }
+   while (n--)
+   {
+      *buf++ = *fifo++;
+   }
+}
+
+#if (USB_HOST_PIPE_DMA == ENABLE)
+//! Programs the DMA channel for the next part of the head request
+static void pipe_dma_next(U8 pipe)
+{
+   S_pipe_queue *q = &pipe_queue[pipe];
+   S_pipe_request *req = q->head;
+   U32 n = req->nb_byte - req->nb_byte_processed;
+
+   if (n > HOST_PIPE_DMA_MAX_SIZE)
+   {
+      n = HOST_PIPE_DMA_MAX_SIZE;
+   }
+   q->on_going = n;
+   Host_dma_address(pipe) = (unsigned long)(req->buf + req->nb_byte_processed);
+   Host_dma_status(pipe);      // Clear status
+   Host_dma_control(pipe) = 0;
+   if (Is_pipe_in(pipe))
+   {
+      // A short packet ends the request
+      Host_dma_control(pipe) = ((n << 16) & AT91C_OTGHS_BUFF_LENGTH)
+                             | AT91C_OTGHS_END_TR_EN
+                             | AT91C_OTGHS_END_TR_IT
+                             | AT91C_OTGHS_END_B_EN
+                             | AT91C_OTGHS_END_BUFFIT
+                             | AT91C_OTGHS_CHANN_ENB;
+   }
+   else
+   {
+      // The last bank is sent when the buffer ends
+      Host_dma_control(pipe) = ((n << 16) & AT91C_OTGHS_BUFF_LENGTH)
+                             | AT91C_OTGHS_END_B_EN
+                             | AT91C_OTGHS_END_BUFFIT
+                             | AT91C_OTGHS_CHANN_ENB;
+   }
+}
+
+//! Stops the DMA channel and accounts for the bytes it moved
+static void pipe_dma_stop(U8 pipe)
+{
+   S_pipe_queue *q = &pipe_queue[pipe];
+   U32 status;
+
+   if (!q->dma)
+   {
+      return;
+   }
+   Host_dma_control(pipe) = 0;
+   status = Host_dma_status(pipe);
+   q->head->nb_byte_processed += q->on_going - ((status & AT91C_OTGHS_BUFF_COUNT) >> 16);
+   q->on_going = 0;
+   q->dma = FALSE;
+   Host_pipe_cfg(pipe) &= ~AT91C_OTGHS_AUTOSW;
+}
+#else
+   #define pipe_dma_stop(pipe)
+#endif
+
+//! Starts the head request of a pipe
+static void pipe_start(U8 pipe)
+{
+   S_pipe_queue *q = &pipe_queue[pipe];
+   S_pipe_request *req = q->head;
+   U8 in = Is_pipe_in(pipe);
+
+   q->zlp = FALSE;
+   Host_pipe_ier(pipe, AT91C_OTGHS_RXSTALL | AT91C_OTGHS_PERR);
+#if (USB_HOST_PIPE_DMA == ENABLE)
+   if ((pipe < HOST_PIPE_DMA_CHANNELS) && (req->nb_byte != 0))
+   {
+      q->dma = TRUE;
+      Host_pipe_idr(pipe, AT91C_OTGHS_RXINI | AT91C_OTGHS_TXOUT);
+      Host_pipe_cfg(pipe) |= AT91C_OTGHS_AUTOSW;
+      pipe_dma_next(pipe);
+   }
+   else
+#endif
+   {
+      q->dma = FALSE;
+      // The flag is up as long as a bank is ready: the interrupt
+      // processes the banks already there, then the next ones
+      Host_pipe_ier(pipe, in ? AT91C_OTGHS_RXINI : AT91C_OTGHS_TXOUT);
+   }
+   if (in)
+   {
+      Host_pipe_inrq(pipe) |= AT91C_OTGHS_INMOD;
+      Host_pipe_idr(pipe, AT91C_OTGHS_FREEZE);
+   }
+   pipe_unlock(pipe);
+}
+
+//! Stops a pipe whose queue is empty
+static void pipe_stop(U8 pipe)
+{
+   pipe_lock(pipe);
+   Host_pipe_idr(pipe, AT91C_OTGHS_RXINI | AT91C_OTGHS_TXOUT);
+   if (Is_pipe_in(pipe))
+   {
+      Host_pipe_ier(pipe, AT91C_OTGHS_FREEZE);
+   }
+}
+
+//! Completes the head request, starts the next one and calls the handle
+static void pipe_complete(U8 pipe, U8 status)
+{
+   S_pipe_queue *q = &pipe_queue[pipe];
+   S_pipe_request *req = q->head;
+
+   q->head = req->next;
+   if (q->head == NULL)
+   {
+      q->tail = NULL;
+      pipe_stop(pipe);
+   }
+   else
+   {
+      pipe_start(pipe);
+   }
+   req->next = NULL;
+   req->status = status;
+   if (req->handle != NULL)
+   {
+      req->handle(req);
+   }
+}
+
+//! Fails all the requests of a pipe
+static void pipe_fail(U8 pipe, U8 status)
+{
+   S_pipe_queue *q = &pipe_queue[pipe];
+   S_pipe_request *req;
+
+   pipe_lock(pipe);
+   pipe_dma_stop(pipe);
+   req = q->head;
+   q->head = NULL;
+   q->tail = NULL;
+   pipe_stop(pipe);
+   while (req != NULL)
+   {
+      S_pipe_request *next = req->next;
+
+      req->next = NULL;
+      req->status = status;
+      if (req->handle != NULL)
+      {
+         req->handle(req);
+      }
+      req = next;
+   }
+}
+
+//! Reads the banks received for the head requests
+static void pipe_fifo_in(U8 pipe)
+{
+   S_pipe_queue *q = &pipe_queue[pipe];
+
+   while ((q->head != NULL) && !q->dma && (Host_pipe_isr(pipe) & AT91C_OTGHS_RXINI))
+   {
+      S_pipe_request *req = q->head;
+      U32 remaining = req->nb_byte - req->nb_byte_processed;
+      U16 count = Pipe_byte_count(pipe);
+      U16 n = (count > remaining) ? (U16)remaining : count;
+
+      Host_pipe_icr(pipe, AT91C_OTGHS_RXINI);
+      pipe_read_fifo(pipe, req->buf + req->nb_byte_processed, n);
+      Host_pipe_idr(pipe, AT91C_OTGHS_FIFOCON);    // Release the bank
+      req->nb_byte_processed += n;
+      if (count > n)
+      {
+         pipe_complete(pipe, PIPE_OVERFLOW);
+      }
+      else if ((count < Pipe_size(pipe)) || (req->nb_byte_processed == req->nb_byte))
+      {
+         pipe_complete(pipe, PIPE_GOOD);
+      }
+   }
+}
+
+//! Fills the free banks with the data of the head requests
+static void pipe_fifo_out(U8 pipe)
+{
+   S_pipe_queue *q = &pipe_queue[pipe];
+
+   while ((q->head != NULL) && !q->dma && (Host_pipe_isr(pipe) & AT91C_OTGHS_TXOUT))
+   {
+      S_pipe_request *req = q->head;
+      U32 remaining = req->nb_byte - req->nb_byte_processed;
+      U16 size = Pipe_size(pipe);
+      U16 n = (remaining > size) ? size : (U16)remaining;
+
+      Host_pipe_icr(pipe, AT91C_OTGHS_TXOUT);
+      pipe_write_fifo(pipe, req->buf + req->nb_byte_processed, n);
+      Host_pipe_idr(pipe, AT91C_OTGHS_FIFOCON);    // Send the bank
+      req->nb_byte_processed += n;
+      if (req->nb_byte_processed == req->nb_byte)
+      {
+         if ((n == size) && (req->flags & PIPE_REQ_ZLP) && !q->zlp)
+         {
+            q->zlp = TRUE;                         // Zero length packet next
+         }
+         else
+         {
+            pipe_complete(pipe, PIPE_GOOD);
+         }
+      }
+   }
+}
+
+#if (USB_HOST_PIPE_DMA == ENABLE)
+//! End of a DMA transfer
+static void pipe_dma_interrupt(U8 pipe)
+{
+   S_pipe_queue *q = &pipe_queue[pipe];
+   S_pipe_request *req = q->head;
+   U32 status = Host_dma_status(pipe);
+   U8 in = Is_pipe_in(pipe);
+
+   if (!q->dma || !(status & (AT91C_OTGHS_END_BF_ST | AT91C_OTGHS_END_TR_ST)))
+   {
+      return;
+   }
+   req->nb_byte_processed += q->on_going - ((status & AT91C_OTGHS_BUFF_COUNT) >> 16);
+   q->on_going = 0;
+   if ((req->nb_byte_processed < req->nb_byte) && !(in && (status & AT91C_OTGHS_END_TR_ST)))
+   {
+      pipe_dma_next(pipe);
+      return;
+   }
+   q->dma = FALSE;
+   Host_pipe_cfg(pipe) &= ~AT91C_OTGHS_AUTOSW;
+   if (!in && (req->flags & PIPE_REQ_ZLP) && ((req->nb_byte % Pipe_size(pipe)) == 0))
+   {
+      // Send the zero length packet from the FIFO
+      q->zlp = TRUE;
+      Host_pipe_it_disable(Pipe_dma_it(pipe));
+      Host_pipe_ier(pipe, AT91C_OTGHS_TXOUT);
+      return;
+   }
+   pipe_complete(pipe, PIPE_GOOD);
+}
+#endif
+
+//! Pipe events: errors, then FIFO banks
+static void pipe_event(U8 pipe)
+{
+   U32 status = Host_pipe_isr(pipe) & Host_pipe_imr(pipe);
+
+   if (status & AT91C_OTGHS_PERR)
+   {
+      U8 error = (U8)Host_pipe_err(pipe);
+
+      Host_pipe_err(pipe) = 0;
+      pipe_fail(pipe, error);
+      return;
+   }
+   if (status & AT91C_OTGHS_RXSTALL)
+   {
+      Host_pipe_icr(pipe, AT91C_OTGHS_RXSTALL);
+      pipe_fail(pipe, PIPE_STALL);
+      return;
+   }
+   if (Is_pipe_in(pipe))
+   {
+      pipe_fifo_in(pipe);
+   }
+   else
+   {
+      pipe_fifo_out(pipe);
+   }
+}
+
+//_____ F U N C T I O N S __________________________________________________
+
+void host_pipe_init(void)
+{
+   U8 pipe;
+
+   for (pipe = 1; pipe < MAX_EP_NB; pipe++)
+   {
+      pipe_lock(pipe);
+      pipe_queue[pipe].head = NULL;
+      pipe_queue[pipe].tail = NULL;
+      pipe_queue[pipe].on_going = 0;
+      pipe_queue[pipe].dma = FALSE;
+      pipe_queue[pipe].zlp = FALSE;
+   }
+}
+
+U8 host_pipe_submit(U8 pipe, S_pipe_request *req)
+{
+   S_pipe_queue *q;
+
+   if ((pipe == 0) || (pipe >= MAX_EP_NB)               // Not the control pipe
+       || !Is_host_pipe_enabled(pipe)
+       || (!Is_pipe_in(pipe) && !Is_pipe_out(pipe)))
+   {
+      return HOST_FALSE;
+   }
+   q = &pipe_queue[pipe];
+   req->next = NULL;
+   req->nb_byte_processed = 0;
+   req->status = PIPE_PENDING;
+
+   pipe_lock(pipe);
+   if (q->tail != NULL)
+   {
+      q->tail->next = req;
+      q->tail = req;
+      pipe_unlock(pipe);
+   }
+   else
+   {
+      q->head = req;
+      q->tail = req;
+      pipe_start(pipe);
+   }
+   return HOST_TRUE;
+}
+
+void host_pipe_abort(U8 pipe)
+{
+   if ((pipe >= MAX_EP_NB) || (pipe_queue[pipe].head == NULL))
+   {
+      return;
+   }
+   pipe_lock(pipe);
+   pipe_dma_stop(pipe);
+   Host_pipe_reset(pipe);        // Flush the banks
+   pipe_fail(pipe, PIPE_ABORTED);
+}
+
+void host_pipe_abort_all(void)
+{
+   U8 pipe;
+
+   for (pipe = 1; pipe < MAX_EP_NB; pipe++)
+   {
+      host_pipe_abort(pipe);
+   }
+}
+
+U8 host_pipe_busy(U8 pipe)
+{
+   return (pipe_queue[pipe].head != NULL) ? TRUE : FALSE;
+}
+
+void host_pipe_interrupt(void)
+{
+   U32 status = Host_pipe_it_status();
+   U8 pipe;
+
+   for (pipe = 1; pipe < MAX_EP_NB; pipe++)
+   {
+      if (pipe_queue[pipe].head == NULL)
+      {
+         continue;
+      }
+#if (USB_HOST_PIPE_DMA == ENABLE)
+      if (status & Pipe_dma_it(pipe))
+      {
+         pipe_dma_interrupt(pipe);
+      }
+#endif
+      if ((status & Pipe_it(pipe)) && (pipe_queue[pipe].head != NULL))
+      {
+         pipe_event(pipe);
+      }
+   }
+}
+
+#endif // USB_HOST_FEATURE == ENABLED
@@ -0,0 +1,151 @@
+/**
+ * @file usb_host_pipe.h
+ *
+ * Copyright (c) 2004 Atmel.
+ *
+ * Please read file license.txt for copyright notice.
+ *
+ * @brief Asynchronous, interrupt driven transfers on the host pipes.
+ *
+ * A transfer is described by a S_pipe_request owned by the caller. Requests
+ * are queued per pipe with host_pipe_submit() and the pipe interrupt moves
+ * the data from one request to the next without the main loop: through the
+ * pipe DMA channel when available, otherwise packet by packet through the
+ * FIFO. The handle of each request is called from the interrupt once it is
+ * done, with its status and byte count set.
+ *
+ * Unlike host_send_data()/host_get_data(), nothing busy-waits: with an RTOS,
+ * the handle gives a semaphore the task blocks on, e.g.
+ *
+ * @code
+ * static void done(S_pipe_request *req)
+ * {
+ *    portBASE_TYPE woken = pdFALSE;
+ *    xSemaphoreGiveFromISR((xSemaphoreHandle)req->arg, &woken);
+ *    portEND_SWITCHING_ISR(woken);
+ * }
+ * @endcode
+ *
+ * host_pipe_interrupt() is called from usb_general_interrupt() when
+ * USB_HOST_PIPE_REQUEST is ENABLE in conf_usb.h; the requests are then
+ * aborted on a device disconnection. The pipes must have been configured by
+ * the enumeration before any request is submitted.
+ *
+ * @todo
+ * @bug
+ */
+
+#ifndef _USB_HOST_PIPE_H_
+#define _USB_HOST_PIPE_H_
+
+//_____ I N C L U D E S ____________________________________________________
+#include "conf_usb.h"
+#include "usb/otg/usb_host_task.h"
+
+//_____ M A C R O S ________________________________________________________
+
+#ifndef USB_HOST_PIPE_REQUEST
+   //! Call host_pipe_interrupt() from usb_general_interrupt()
+   #define USB_HOST_PIPE_REQUEST DISABLE
+#endif
+
+#ifndef USB_HOST_PIPE_DMA
+   //! Move the data of pipes 1 to 6 with their DMA channel
+   #define USB_HOST_PIPE_DMA     ENABLE
+#endif
+
+//! @defgroup pipe_request_status Request status, besides the PIPE_xxx error codes
+//! @{
+#define PIPE_PENDING       0xFF   //!< Request queued or in progress
+#define PIPE_ABORTED       0xFE   //!< Request cancelled by host_pipe_abort() or a disconnection
+#define PIPE_OVERFLOW      0xFD   //!< Device sent more data than the request could hold
+//! @}
+
+//! @defgroup pipe_request_flags Request flags
+//! @{
+#define PIPE_REQ_ZLP       0x01   //!< OUT: end a transfer of whole packets with a zero length packet
+//! @}
+
+//_____ T Y P E S  _________________________________________________________
+
+typedef struct S_pipe_request
+{
+   struct S_pipe_request *next;   //!< Next request queued on the same pipe
+   U8  *buf;                      //!< Data to send or room for the data received
+   U32 nb_byte;                   //!< Number of bytes to transfer
+   U32 nb_byte_processed;         //!< Number of bytes transferred, set on completion
+   void (*handle)(struct S_pipe_request *req);  //!< Called from the interrupt when done, may be NULL
+   void *arg;                     //!< Free for the caller
+   U8  flags;                     //!< PIPE_REQ_xxx
+   volatile U8 status;            //!< PIPE_PENDING until done, then PIPE_GOOD or an error
+} S_pipe_request;
+
+//_____ D E C L A R A T I O N S ____________________________________________
+
+/**
+ * @brief Empties the request queues of pipes 1 and up, without calling any handle.
+ *
+ * @param none
+ *
+ * @return none
+ */
+void host_pipe_init(void);
+
+/**
+ * @brief Queues a transfer on a pipe.
+ *
+ * The direction is the token of the pipe. The request must stay untouched
+ * until its handle is called; it starts as soon as the requests queued before
+ * it on the same pipe are done. An IN request completes on a short packet or
+ * when its buffer is full; an OUT request completes once its last packet has
+ * been handed to the controller.
+ *
+ * @param pipe
+ * @param req
+ *
+ * @return HOST_TRUE, or HOST_FALSE if the pipe is not usable
+ */
+U8 host_pipe_submit(U8 pipe, S_pipe_request *req);
+
+/**
+ * @brief Stops a pipe and completes all its requests with PIPE_ABORTED.
+ *
+ * The handles are called from the caller's context.
+ *
+ * @param pipe
+ *
+ * @return none
+ */
+void host_pipe_abort(U8 pipe);
+
+/**
+ * @brief Aborts the requests of all pipes, e.g. on a device disconnection.
+ *
+ * @param none
+ *
+ * @return none
+ */
+void host_pipe_abort_all(void);
+
+/**
+ * @brief Tells if requests are queued on a pipe.
+ *
+ * @param pipe
+ *
+ * @return TRUE or FALSE
+ */
+U8 host_pipe_busy(U8 pipe);
+
+/**
+ * @brief Pipe and pipe DMA interrupt subroutine.
+ *
+ * Processes the events of every pipe with requests queued, and calls the
+ * handles of the requests done.
+ *
+ * @param none
+ *
+ * @return none
+ */
+void host_pipe_interrupt(void);
+
+#endif /* _USB_HOST_PIPE_H_ */
@@ -57,6 +57,9 @@
    #if (USB_HOST_PIPE_INTERRUPT_TRANSFER == ENABLE)
       extern U8 g_sav_int_sof_enable;
    #endif
+   #if (USB_HOST_PIPE_REQUEST == ENABLE)
+      #include "usb/otg/usb_host_pipe.h"
+   #endif
 #endif
 
 #if ((USB_DEVICE_FEATURE == ENABLED))
@@ -817,6 +820,9 @@ __interrupt void usb_general_interrupt(void)
    if(Is_device_disconnection() && Is_host_device_disconnection_interrupt_enabled())
    {
       TRACE_DEBUG("device disconnect\n\r");
+      #if (USB_HOST_PIPE_REQUEST == ENABLE)
+      host_pipe_abort_all();
+      #endif
       host_disable_all_pipe();
       Host_ack_device_disconnection();
       device_state=DEVICE_DISCONNECTED;
@@ -926,6 +932,11 @@ __interrupt void usb_general_interrupt(void)
      #endif
      Host_send_resume();
    }
+
+   #if (USB_HOST_PIPE_REQUEST == ENABLE)
+  // - Pipe and pipe DMA events of the queued requests
+   host_pipe_interrupt();
+   #endif
 #endif // End HOST FEATURE MODE
 
 }
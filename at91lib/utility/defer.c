@@ -0,0 +1,197 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2008, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+//------------------------------------------------------------------------------
+/// \unit
+///
+/// !Purpose
+///
+/// Deferred interrupt processing, see defer.h.
+///
+/// Each priority has a list of work items pushed by DEFER_Schedule() with a
+/// compare and swap, so that interrupts of any priority can schedule work
+/// without masking the others. DEFER_Run() takes the whole list at once and
+/// reverses it, which gives the items in the order they were scheduled.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+//         Headers
+//------------------------------------------------------------------------------
+
+#include "defer.h"
+
+//------------------------------------------------------------------------------
+//         Local Types
+//------------------------------------------------------------------------------
+
+/// Work items of one priority.
+typedef struct {
+
+    /// Items scheduled since the list was last taken, newest first.
+    DeferredWork * volatile pScheduled;
+    /// Items taken by DEFER_Run() and not run yet, oldest first.
+    DeferredWork *pTaken;
+
+} Queue;
+
+//------------------------------------------------------------------------------
+//         Internal variables
+//------------------------------------------------------------------------------
+
+static Queue queues[DEFER_NUM_PRIORITIES];
+
+/// Called after work has been scheduled.
+static void (*deferWakeUp)(void) = 0;
+
+//------------------------------------------------------------------------------
+//         Local Functions
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Removes the oldest work item of the highest priority.
+/// \return The work item, or 0 if there is no work.
+//------------------------------------------------------------------------------
+static DeferredWork * Next(void)
+{
+    Queue *pQueue;
+    DeferredWork *pWork;
+    DeferredWork *pNext;
+    unsigned int priority = DEFER_NUM_PRIORITIES;
+
+    while (priority-- > 0) {
+
+        pQueue = &(queues[priority]);
+        if ((pQueue->pTaken == 0) && (pQueue->pScheduled != 0)) {
+
+            pWork = __sync_lock_test_and_set(&(pQueue->pScheduled), 0);
+            while (pWork != 0) {
+
+                pNext = pWork->pNext;
+                pWork->pNext = pQueue->pTaken;
+                pQueue->pTaken = pWork;
+                pWork = pNext;
+            }
+        }
+        if (pQueue->pTaken != 0) {
+
+            pWork = pQueue->pTaken;
+            pQueue->pTaken = pWork->pNext;
+            return pWork;
+        }
+    }
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+//         Global Functions
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Initializes a work item.
+/// \param pWork  Work item to initialize.
+/// \param function  Function to run.
+/// \param pArgument  Argument of the function.
+/// \param priority  Priority of the work, below DEFER_NUM_PRIORITIES.
+//------------------------------------------------------------------------------
+void DEFER_Initialize(DeferredWork *pWork,
+                      DeferredFunction function,
+                      void *pArgument,
+                      unsigned char priority)
+{
+    pWork->pNext = 0;
+    pWork->function = function;
+    pWork->pArgument = pArgument;
+    pWork->priority = (priority < DEFER_NUM_PRIORITIES) ?
+                      priority : (DEFER_NUM_PRIORITIES - 1);
+    pWork->pending = 0;
+}
+
+//------------------------------------------------------------------------------
+/// Schedules a work item. Can be called from interrupt handlers.
+/// \param pWork  Work item to run.
+/// \return 1 if the work has been queued, 0 if it was already pending.
+//------------------------------------------------------------------------------
+unsigned char DEFER_Schedule(DeferredWork *pWork)
+{
+    Queue *pQueue = &(queues[pWork->priority]);
+    DeferredWork *pScheduled;
+
+    if (!__sync_bool_compare_and_swap(&(pWork->pending), 0, 1)) {
+
+        return 0;
+    }
+
+    do {
+        pScheduled = pQueue->pScheduled;
+        pWork->pNext = pScheduled;
+    } while (!__sync_bool_compare_and_swap(&(pQueue->pScheduled),
+                                           pScheduled, pWork));
+
+    if (deferWakeUp != 0) {
+
+        deferWakeUp();
+    }
+
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+/// Runs the scheduled work, highest priority first, until there is none
+/// left. Work scheduled meanwhile is run too, before the lower priorities.
+/// Must only be called from one context at a time, and not from the work.
+/// \return Number of work items run.
+//------------------------------------------------------------------------------
+unsigned int DEFER_Run(void)
+{
+    DeferredWork *pWork;
+    unsigned int num = 0;
+
+    while ((pWork = Next()) != 0) {
+
+        // Clear the flag first, so that the work can be scheduled again
+        // while it runs
+        pWork->pending = 0;
+        __sync_synchronize();
+        pWork->function(pWork->pArgument);
+        num++;
+    }
+
+    return num;
+}
+
+//------------------------------------------------------------------------------
+/// Sets the function called after work has been scheduled, or 0 for none.
+/// It is called from the context of DEFER_Schedule(), possibly an interrupt.
+/// \param wakeUp  Wake up function.
+//------------------------------------------------------------------------------
+void DEFER_SetWakeUp(void (*wakeUp)(void))
+{
+    deferWakeUp = wakeUp;
+}
@@ -0,0 +1,109 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2008, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+//------------------------------------------------------------------------------
+/// \unit
+///
+/// !Purpose
+///
+/// Deferred interrupt processing. Interrupt handlers keep only the work that
+/// must be done at once (reading and acknowledging the peripheral) and
+/// schedule the rest, such as user callbacks, to run later at thread level,
+/// so that they do not hold off the other interrupts.
+///
+/// !Usage
+///
+/// -# Initialize each work item once with DEFER_Initialize(), giving the
+///    function to run and its priority (0 to DEFER_NUM_PRIORITIES - 1,
+///    higher runs first).
+/// -# Call DEFER_Schedule() from an interrupt handler or from the
+///    application. It takes a few tens of cycles, does not mask interrupts
+///    and can be called from any interrupt priority. A work item scheduled
+///    again before it has run runs only once.
+/// -# Call DEFER_Run() from the main loop, or let the FreeRTOS handler task
+///    (freertos/defer/defer_task.h) do it. DEFER_SetWakeUp() installs a
+///    function called after each DEFER_Schedule(), e.g. to wake that task.
+/// -# Drivers whose interrupt is split this way (USBD_DEFERRED,
+///    MCI_DEFERRED) assume the work runs at a single thread level that the
+///    code calling the driver does not preempt.
+//------------------------------------------------------------------------------
+
+#ifndef DEFER_H
+#define DEFER_H
+
+//------------------------------------------------------------------------------
+//         Definitions
+//------------------------------------------------------------------------------
+
+/// Number of work priorities.
+#if !defined(DEFER_NUM_PRIORITIES)
+#define DEFER_NUM_PRIORITIES    4
+#endif
+
+//------------------------------------------------------------------------------
+//         Types
+//------------------------------------------------------------------------------
+
+/// Function run by a work item.
+typedef void (*DeferredFunction)(void *pArgument);
+
+//------------------------------------------------------------------------------
+/// Work scheduled with DEFER_Schedule(). The storage is provided by the
+/// driver and must stay valid as long as the work can be scheduled.
+//------------------------------------------------------------------------------
+typedef struct _DeferredWork {
+
+    /// Next work item of the same priority.
+    struct _DeferredWork *pNext;
+    /// Function to run, and its argument.
+    DeferredFunction function;
+    void *pArgument;
+    /// Priority of the work.
+    unsigned char priority;
+    /// Set while the work is queued.
+    volatile unsigned char pending;
+
+} DeferredWork;
+
+//------------------------------------------------------------------------------
+//         Global Functions
+//------------------------------------------------------------------------------
+
+extern void DEFER_Initialize(DeferredWork *pWork,
+                             DeferredFunction function,
+                             void *pArgument,
+                             unsigned char priority);
+
+extern unsigned char DEFER_Schedule(DeferredWork *pWork);
+
+extern unsigned int DEFER_Run(void);
+
+extern void DEFER_SetWakeUp(void (*wakeUp)(void));
+
+#endif //#ifndef DEFER_H
@@ -0,0 +1,17 @@
+//------------------------------------------------------------------------------
+// Board definitions for the host build of tracebench: tracedefer.c reads its
+// time stamps from a variable that tracebench.c sets, instead of the DWT.
+//------------------------------------------------------------------------------
+
+#ifndef _BOARD_H_
+#define _BOARD_H_
+
+extern volatile unsigned int hostDemcr;
+extern volatile unsigned int hostDwtCtrl;
+extern volatile unsigned int hostCycles;
+
+#define DEMCR       hostDemcr
+#define DWT_CTRL    hostDwtCtrl
+#define DWT_CYCCNT  hostCycles
+
+#endif //#ifndef _BOARD_H_
@@ -0,0 +1,3 @@
+//------------------------------------------------------------------------------
+// Host build of tracebench: trace.h needs no DBGU (see ../board.h).
+//------------------------------------------------------------------------------
@@ -0,0 +1,406 @@
+//------------------------------------------------------------------------------
+// Host-side test and benchmark of the deferred traces (tracedefer.c).
+//
+// tracedefer.c is built with TRACE_DEFERRED=1 against the board.h of this
+// directory, where the DWT cycle counter is a variable, and linked with
+// tracefmt.ld, which gathers the format strings in .trace_fmt as the target
+// linker scripts do.
+//
+// Build with make, and run on the host:
+//
+//   ./tracebench [capture file] [expected output file]
+//
+// Checks the records read back against the traces logged, the count of the
+// traces dropped when the ring is full, and the records of several threads
+// logging at once while another drains the ring. Then times TRACE_INFO()
+// against formatting the same trace with snprintf(), which is what the
+// immediate printf() does before it waits on the DBGU.
+//
+// Given file names, writes the records of the checks as TRACE_DeferredDrain()
+// sends them, and the lines tracelog.py must decode them to, formatted with
+// printf() from the format strings of the program ("make bench" compares the
+// two).
+//------------------------------------------------------------------------------
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "utility/trace.h"
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Traces timed.
+#define ITERATIONS      4000000
+/// Traces logged between two drains when timing, so that the ring of 256
+/// words never fills.
+#define BATCH           32
+/// Threads logging at once, and traces logged by each.
+#define WRITERS         3
+#define WRITER_TRACES   1000000
+/// Size of the capture.
+#define CAPTURE_SIZE    65536
+
+/// A trace of the record check.
+typedef struct {
+
+    const char *format;
+    unsigned int count;
+    unsigned int args[8];
+
+} Expected;
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+/// The DWT registers of tracedefer.c (see board.h).
+volatile unsigned int hostDemcr;
+volatile unsigned int hostDwtCtrl;
+volatile unsigned int hostCycles;
+
+/// Start of the format strings (see tracefmt.ld).
+extern const char __trace_fmt_start[];
+
+static unsigned char capture[CAPTURE_SIZE];
+static unsigned int captureLength;
+static unsigned int errors;
+
+/// Records of the threads.
+static volatile int writing;
+static unsigned int nextSequence[WRITERS];
+static unsigned long long received;
+static unsigned long long dropped;
+
+static const Expected expected[] = {
+    {"-I- no argument\n\r", 0, {0}},
+    {"-I- %d %u\n\r", 2, {-5, 7}},
+    {"-W- %x %08X %c\n\r", 3, {0xbeef, 0x1234, 'z'}},
+    {"-E- %d %d %d %d %d %d %d %d\n\r", 8, {1, 2, 3, 4, 5, 6, 7, -8}},
+    {"-D- [%5d|%-5u|%%]\n\r", 2, {42, 17}},
+    {"%u\n\r", 1, {0xffffffff}}
+};
+
+//------------------------------------------------------------------------------
+//         Local functions
+//------------------------------------------------------------------------------
+
+static unsigned long long Now(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (unsigned long long) t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+/// Appends records to the capture.
+static void Capture(const unsigned char *pData, unsigned int size)
+{
+    if (size > CAPTURE_SIZE - captureLength) {
+
+        printf("capture full\n");
+        errors++;
+        return;
+    }
+    memcpy(capture + captureLength, pData, size);
+    captureLength += size;
+}
+
+/// Discards records.
+static void Discard(const unsigned char *pData, unsigned int size)
+{
+}
+
+/// Reads a record of the capture at the given offset.
+static unsigned int Record(unsigned int offset, unsigned int *pHeader,
+                           unsigned int *pStamp, unsigned int *pArgs)
+{
+    unsigned int words[10];
+    unsigned int count;
+
+    memcpy(words, capture + offset, 8);
+    count = words[0] ? (words[0] & 0xF) : 0;
+    memcpy(words + 2, capture + offset + 8, count * 4);
+    *pHeader = words[0];
+    *pStamp = words[1];
+    memset(pArgs, 0, 8 * sizeof(unsigned int));
+    memcpy(pArgs, words + 2, count * 4);
+
+    return 8 + count * 4;
+}
+
+/// Format string of a record.
+static const char *Format(unsigned int header)
+{
+    return &__trace_fmt_start[(header >> 4) - 1];
+}
+
+//------------------------------------------------------------------------------
+//         Checks
+//------------------------------------------------------------------------------
+
+/// Logs the traces of the expected table, each with its index as time stamp,
+/// and checks the records read back.
+static void CheckRecords(void)
+{
+    unsigned int start = captureLength;
+    unsigned int header, stamp, args[8];
+    unsigned int i, j;
+
+    hostCycles = 0;
+    TRACE_INFO("no argument\n\r");
+    hostCycles = 1;
+    TRACE_INFO("%d %u\n\r", -5, 7);
+    hostCycles = 2;
+    TRACE_WARNING("%x %08X %c\n\r", 0xbeef, 0x1234, 'z');
+    hostCycles = 3;
+    TRACE_ERROR("%d %d %d %d %d %d %d %d\n\r", 1, 2, 3, 4, 5, 6, 7, -8);
+    hostCycles = 4;
+    TRACE_DEBUG("[%5d|%-5u|%%]\n\r", 42, 17);
+    hostCycles = 5;
+    TRACE_INFO_WP("%u\n\r", 0xffffffff);
+
+    if (TRACE_DeferredDrain(Capture) != sizeof(expected) / sizeof(expected[0])) {
+
+        printf("records: wrong number of records\n");
+        errors++;
+        return;
+    }
+    for (i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+
+        start += Record(start, &header, &stamp, args);
+        if (((header & 0xF) != expected[i].count) || (stamp != i)
+            || (strcmp(Format(header), expected[i].format) != 0)) {
+
+            printf("record %u: wrong header or format\n", i);
+            errors++;
+            continue;
+        }
+        for (j = 0; j < expected[i].count; j++) {
+
+            if (args[j] != expected[i].args[j]) {
+
+                printf("record %u: argument %u is 0x%x\n", i, j, args[j]);
+                errors++;
+            }
+        }
+    }
+}
+
+/// Fills the ring and checks that the traces that do not fit are dropped and
+/// reported, and that the others are intact.
+static void CheckFull(void)
+{
+    unsigned int start = captureLength;
+    unsigned int header, stamp, args[8];
+    unsigned int i;
+
+    // Records of 3 words: 85 fit in 256 words
+    for (i = 0; i < 100; i++) {
+
+        hostCycles = 1000 + i;
+        TRACE_INFO_WP("full %u\n\r", i);
+    }
+    if (TRACE_DeferredDrain(Capture) != 85) {
+
+        printf("full: wrong number of records\n");
+        errors++;
+        return;
+    }
+    start += Record(start, &header, &stamp, args);
+    if ((header != 0) || (stamp != 15)) {
+
+        printf("full: dropped traces not reported\n");
+        errors++;
+    }
+    for (i = 0; i < 85; i++) {
+
+        start += Record(start, &header, &stamp, args);
+        if ((header & 0xF) != 1 || (stamp != 1000 + i) || (args[0] != i)) {
+
+            printf("full: record %u is wrong\n", i);
+            errors++;
+        }
+    }
+}
+
+/// Logs numbered traces from one thread, giving way to the others now and
+/// then so that the reader keeps up on a single processor.
+static void * Writer(void *pArg)
+{
+    unsigned int thread = (unsigned int) (unsigned long) pArg;
+    unsigned int i;
+
+    for (i = 0; i < WRITER_TRACES; i++) {
+
+        TRACE_INFO_WP("%u %u %u\n\r", thread, i, ~i);
+        if ((i % 16) == 15) {
+
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+/// Checks the records of the writer threads as they are drained.
+static void Check(const unsigned char *pData, unsigned int size)
+{
+    unsigned int words[10];
+
+    memcpy(words, pData, size);
+    if (words[0] == 0) {
+
+        dropped += words[1];
+        return;
+    }
+    received++;
+    if ((size != 20) || (words[2] >= WRITERS) || (words[4] != ~words[3])
+        || (words[3] < nextSequence[words[2]])) {
+
+        printf("threads: record %llu is wrong\n", received);
+        errors++;
+        return;
+    }
+    nextSequence[words[2]] = words[3] + 1;
+}
+
+static void * Reader(void *pArg)
+{
+    while (writing) {
+
+        if (TRACE_DeferredDrain(Check) == 0) {
+
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+/// Logs from several threads while another drains the ring, and checks that
+/// every trace is either received intact and in order, or reported dropped.
+static void CheckThreads(void)
+{
+    pthread_t writers[WRITERS];
+    pthread_t reader;
+    unsigned long i;
+
+    writing = 1;
+    pthread_create(&reader, NULL, Reader, NULL);
+    for (i = 0; i < WRITERS; i++) {
+
+        pthread_create(&writers[i], NULL, Writer, (void *) i);
+    }
+    for (i = 0; i < WRITERS; i++) {
+
+        pthread_join(writers[i], NULL);
+    }
+    writing = 0;
+    pthread_join(reader, NULL);
+    TRACE_DeferredDrain(Check);
+
+    if (received + dropped != (unsigned long long) WRITERS * WRITER_TRACES) {
+
+        printf("threads: %llu received and %llu dropped of %u\n",
+               received, dropped, WRITERS * WRITER_TRACES);
+        errors++;
+    }
+    printf("%u threads: %llu traces received, %llu dropped\n", WRITERS,
+           received, dropped);
+}
+
+/// Writes the capture, and the lines it decodes to.
+static int WriteCapture(const char *pCapture, const char *pExpected)
+{
+    FILE *f;
+    unsigned int header, stamp, args[8];
+    unsigned int offset = 0;
+    char text[256];
+
+    f = fopen(pCapture, "wb");
+    if (f == NULL || fwrite(capture, 1, captureLength, f) != captureLength) {
+
+        printf("cannot write %s\n", pCapture);
+        return 1;
+    }
+    fclose(f);
+
+    f = fopen(pExpected, "w");
+    if (f == NULL) {
+
+        printf("cannot write %s\n", pExpected);
+        return 1;
+    }
+    while (offset < captureLength) {
+
+        offset += Record(offset, &header, &stamp, args);
+        if (header == 0) {
+
+            fprintf(f, "-W- %u traces dropped\n", stamp);
+            continue;
+        }
+        snprintf(text, sizeof(text), Format(header), args[0], args[1],
+                 args[2], args[3], args[4], args[5], args[6], args[7]);
+        text[strcspn(text, "\r\n")] = 0;
+        fprintf(f, "[%10u] %s\n", stamp, text);
+    }
+    fclose(f);
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+//         Main function
+//------------------------------------------------------------------------------
+
+int main(int argc, char **argv)
+{
+    static char line[64];
+    unsigned long long logNs = 0, drainNs = 0, formatNs = 0, start;
+    unsigned int i, j;
+
+    TRACE_DeferredStart();
+    CheckRecords();
+    CheckFull();
+    CheckThreads();
+    printf("Deferred traces, %u errors\n", errors);
+    if (argc > 2 && WriteCapture(argv[1], argv[2]) != 0) {
+
+        return 1;
+    }
+
+    for (i = 0; i < ITERATIONS; i += BATCH) {
+
+        start = Now();
+        for (j = 0; j < BATCH; j++) {
+
+            TRACE_INFO("fib %d = %d\n", j, i);
+        }
+        logNs += Now() - start;
+
+        start = Now();
+        TRACE_DeferredDrain(Discard);
+        drainNs += Now() - start;
+
+        start = Now();
+        for (j = 0; j < BATCH; j++) {
+
+            snprintf(line, sizeof(line), "-I- fib %d = %d\n", j, i);
+        }
+        formatNs += Now() - start;
+    }
+    printf("  TRACE_INFO, deferred       %6.1f ns\n",
+           (double) logNs / ITERATIONS);
+    printf("  drained                    %6.1f ns per record\n",
+           (double) drainNs / ITERATIONS);
+    printf("  formatted with snprintf()  %6.1f ns\n",
+           (double) formatNs / ITERATIONS);
+
+    return errors ? 1 : 0;
+}
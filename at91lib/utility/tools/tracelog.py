@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+#
+# Host side formatter for deferred traces (TRACE_DEFERRED=1, see
+# at91lib/utility/tracedefer.c).
+#
+# usage: tracelog.py dict <program.elf> [<dictionary.json>]
+#        tracelog.py decode <dictionary.json | program.elf> <capture.bin> [<mck Hz>]
+#
+# "dict" extracts the .trace_fmt section of the program into a dictionary
+# mapping each format string offset (the trace identifier) to its string.
+# "decode" formats a byte stream written by TRACE_DeferredDrain(), one trace
+# per line, prefixed with its time stamp in microseconds when the master clock
+# frequency is given (cycles otherwise).
+#
+# Arguments are 32-bit words. %s arguments are target addresses and are
+# printed as such, since the strings are not part of the capture.
+
+import json
+import re
+import struct
+import sys
+
+SECTION = '.trace_fmt'
+
+# printf conversion: flags, width, precision, length modifier, conversion.
+SPEC = re.compile(r'%([-+ #0]*)(\d*|\*)(?:\.(\d*|\*))?(hh|h|ll|l|z|t|j)?([diouxXcspn%])')
+
+
+def read_elf_section(path, name):
+    with open(path, 'rb') as f:
+        data = f.read()
+    if data[:4] != b'\x7fELF':
+        raise ValueError('%s is not an ELF file' % path)
+    endian = '<' if data[5] == 1 else '>'
+    if data[4] == 1:
+        shoff, = struct.unpack_from(endian + 'I', data, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + 'HHH', data, 0x2e)
+        layout = endian + 'IIIIII'
+    else:
+        shoff, = struct.unpack_from(endian + 'Q', data, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + 'HHH', data, 0x3a)
+        layout = endian + 'IIQQQQ'
+
+    def header(index):
+        # name, type, flags, address, file offset, size
+        return struct.unpack_from(layout, data, shoff + index * shentsize)
+
+    strtab = header(shstrndx)
+    for index in range(shnum):
+        sh = header(index)
+        start = strtab[4] + sh[0]
+        secname = data[start:data.index(b'\0', start)].decode()
+        if secname == name:
+            return data[sh[4]:sh[4] + sh[5]]
+    raise ValueError('%s has no %s section' % (path, name))
+
+
+def build_dictionary(elf):
+    section = read_elf_section(elf, SECTION)
+    formats = {}
+    offset = 0
+    while offset < len(section):
+        end = section.index(b'\0', offset)
+        formats[offset] = section[offset:end].decode('latin-1')
+        offset = end + 1
+        # Skip the alignment padding between strings of different objects.
+        while offset < len(section) and section[offset] == 0:
+            offset += 1
+    return formats
+
+
+def load_dictionary(path):
+    if path.endswith('.json'):
+        with open(path) as f:
+            return dict((int(k), v) for k, v in json.load(f).items())
+    return build_dictionary(path)
+
+
+def format_trace(fmt, args):
+    args = list(args)
+
+    def convert(match):
+        flags, width, precision, _, conv = match.groups()
+        if conv == '%':
+            return '%'
+        spec = '%' + flags
+        for part, prefix in ((width, ''), (precision, '.')):
+            if part == '*':
+                spec += prefix + str(struct.unpack('<i', struct.pack('<I', args.pop(0)))[0])
+            elif part is not None:
+                spec += prefix + part
+        value = args.pop(0) if args else 0
+        if conv in 'di':
+            value = struct.unpack('<i', struct.pack('<I', value))[0]
+            conv = 'd'
+        elif conv == 'u':
+            conv = 'd'
+        elif conv == 'c':
+            value = chr(value & 0xff)
+        elif conv == 's':
+            value = '<0x%08x>' % value
+        elif conv == 'p':
+            value, conv = '0x%08x' % value, 's'
+        elif conv == 'n':
+            return ''
+        return (spec + conv) % value
+
+    return SPEC.sub(convert, fmt)
+
+
+def decode(formats, data, hz):
+    out = []
+    offset = 0
+    while offset + 8 <= len(data):
+        header, stamp = struct.unpack_from('<II', data, offset)
+        offset += 8
+        if header == 0:
+            out.append('-W- %u traces dropped' % stamp)
+            continue
+        count = header & 0xf
+        ident = (header >> 4) - 1
+        args = struct.unpack_from('<%dI' % count, data, offset)
+        offset += 4 * count
+        fmt = formats.get(ident)
+        if fmt is None:
+            text = '<unknown trace %d %s>' % (ident, ' '.join('0x%x' % a for a in args))
+        else:
+            text = format_trace(fmt, args).rstrip('\r\n')
+        if hz:
+            out.append('[%12.3f] %s' % (stamp * 1e6 / hz, text))
+        else:
+            out.append('[%10u] %s' % (stamp, text))
+    return out
+
+
+def main(argv):
+    if len(argv) >= 3 and argv[1] == 'dict':
+        formats = build_dictionary(argv[2])
+        text = json.dumps(dict((str(k), v) for k, v in sorted(formats.items())), indent=1)
+        if len(argv) > 3:
+            with open(argv[3], 'w') as f:
+                f.write(text + '\n')
+        else:
+            print(text)
+        return 0
+    if len(argv) >= 4 and argv[1] == 'decode':
+        formats = load_dictionary(argv[2])
+        with open(argv[3], 'rb') as f:
+            data = f.read()
+        hz = float(argv[4]) if len(argv) > 4 else None
+        for line in decode(formats, data, hz):
+            print(line)
+        return 0
+    sys.stderr.write('usage: tracelog.py dict <program.elf> [<dictionary.json>]\n'
+                     '       tracelog.py decode <dictionary.json | program.elf> <capture.bin> [<mck Hz>]\n')
+    return 2
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
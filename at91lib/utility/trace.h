@@ -47,6 +47,9 @@
 /// -# Trace disabling can be static or dynamic. If dynamic disabling is selected
 ///    the trace level can be modified in runtime. If static disabling is selected
 ///    the disabled traces are not compiled.
+/// -# Traces can be deferred by compiling with TRACE_DEFERRED=1: they are then
+///    stored in binary form in a ring buffer and printed later by
+///    TRACE_DeferredFlush(). See tracedefer.c.
 ///
 /// !Trace level description
 /// -# TRACE_DEBUG (5): Traces whose only purpose is for debugging the program, 
@@ -110,6 +113,11 @@
 #define DYN_TRACES 0
 #endif
 
+// By default, traces are output immediately (not deferred)
+#if !defined(TRACE_DEFERRED)
+#define TRACE_DEFERRED 0
+#endif
+
 #if defined(NOTRACE)
 #error "Error: NOTRACE has to be not defined !"
 #endif
@@ -236,6 +244,30 @@
     #define TRACE_IsRxReady() USART_IsRxReady(AT91C_BASE_US2)
 #endif
 
+//------------------------------------------------------------------------------
+/// Outputs a trace. When TRACE_DEFERRED is 1, the format string is placed in
+/// the .trace_fmt section and the trace is stored in binary form by
+/// TRACE_DeferredLog() instead of being printed. The format must then be a
+/// string literal, followed by at most 8 arguments of 32 bits each.
+/// \param prefix  String literal output before the trace.
+/// \param format  Formatted string to output.
+/// \param ...  Additional parameters depending on formatted string.
+//------------------------------------------------------------------------------
+#if (TRACE_DEFERRED == 1)
+    #define TRACE_NARGS(format, ...) \
+        TRACE_NARGS_(format, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+    #define TRACE_NARGS_(format, a1, a2, a3, a4, a5, a6, a7, a8, n, ...) n
+    #define TRACE_OUTPUT(prefix, format, ...) { \
+        static const char traceFormat[] \
+            __attribute__((section(".trace_fmt"))) = prefix format; \
+        TRACE_DeferredLog(traceFormat, \
+                          TRACE_NARGS(format, ##__VA_ARGS__), \
+                          ##__VA_ARGS__); \
+    }
+#else
+    #define TRACE_OUTPUT(prefix, ...) { printf(prefix __VA_ARGS__); }
+#endif
+
 //------------------------------------------------------------------------------
 /// Outputs a formatted string using <printf> if the log level is high
 /// enough. Can be disabled by defining TRACE_LEVEL=0 during compilation.
@@ -260,48 +292,48 @@
 #elif (DYN_TRACES == 1)
 
 // Trace output depends on traceLevel value
-#define TRACE_DEBUG(...)      { if (traceLevel >= TRACE_LEVEL_DEBUG)   { printf("-D- " __VA_ARGS__); } }
-#define TRACE_INFO(...)       { if (traceLevel >= TRACE_LEVEL_INFO)    { printf("-I- " __VA_ARGS__); } }
-#define TRACE_WARNING(...)    { if (traceLevel >= TRACE_LEVEL_WARNING) { printf("-W- " __VA_ARGS__); } }
-#define TRACE_ERROR(...)      { if (traceLevel >= TRACE_LEVEL_ERROR)   { printf("-E- " __VA_ARGS__); } }
+#define TRACE_DEBUG(...)      { if (traceLevel >= TRACE_LEVEL_DEBUG)   TRACE_OUTPUT("-D- ", __VA_ARGS__) }
+#define TRACE_INFO(...)       { if (traceLevel >= TRACE_LEVEL_INFO)    TRACE_OUTPUT("-I- ", __VA_ARGS__) }
+#define TRACE_WARNING(...)    { if (traceLevel >= TRACE_LEVEL_WARNING) TRACE_OUTPUT("-W- ", __VA_ARGS__) }
+#define TRACE_ERROR(...)      { if (traceLevel >= TRACE_LEVEL_ERROR)   TRACE_OUTPUT("-E- ", __VA_ARGS__) }
 #define TRACE_FATAL(...)      { if (traceLevel >= TRACE_LEVEL_FATAL)   { printf("-F- " __VA_ARGS__); while(1); } }
 
-#define TRACE_DEBUG_WP(...)   { if (traceLevel >= TRACE_LEVEL_DEBUG)   { printf(__VA_ARGS__); } }
-#define TRACE_INFO_WP(...)    { if (traceLevel >= TRACE_LEVEL_INFO)    { printf(__VA_ARGS__); } }
-#define TRACE_WARNING_WP(...) { if (traceLevel >= TRACE_LEVEL_WARNING) { printf(__VA_ARGS__); } }
-#define TRACE_ERROR_WP(...)   { if (traceLevel >= TRACE_LEVEL_ERROR)   { printf(__VA_ARGS__); } }
+#define TRACE_DEBUG_WP(...)   { if (traceLevel >= TRACE_LEVEL_DEBUG)   TRACE_OUTPUT("", __VA_ARGS__) }
+#define TRACE_INFO_WP(...)    { if (traceLevel >= TRACE_LEVEL_INFO)    TRACE_OUTPUT("", __VA_ARGS__) }
+#define TRACE_WARNING_WP(...) { if (traceLevel >= TRACE_LEVEL_WARNING) TRACE_OUTPUT("", __VA_ARGS__) }
+#define TRACE_ERROR_WP(...)   { if (traceLevel >= TRACE_LEVEL_ERROR)   TRACE_OUTPUT("", __VA_ARGS__) }
 #define TRACE_FATAL_WP(...)   { if (traceLevel >= TRACE_LEVEL_FATAL)   { printf(__VA_ARGS__); while(1); } }
 
 #else
 
 // Trace compilation depends on TRACE_LEVEL value
 #if (TRACE_LEVEL >= TRACE_LEVEL_DEBUG)
-#define TRACE_DEBUG(...)      { printf("-D- " __VA_ARGS__); }
-#define TRACE_DEBUG_WP(...)   { printf(__VA_ARGS__); }
+#define TRACE_DEBUG(...)      TRACE_OUTPUT("-D- ", __VA_ARGS__)
+#define TRACE_DEBUG_WP(...)   TRACE_OUTPUT("", __VA_ARGS__)
 #else
 #define TRACE_DEBUG(...)      { }
 #define TRACE_DEBUG_WP(...)   { }
 #endif
 
 #if (TRACE_LEVEL >= TRACE_LEVEL_INFO)
-#define TRACE_INFO(...)       { printf("-I- " __VA_ARGS__); }
-#define TRACE_INFO_WP(...)    { printf(__VA_ARGS__); }
+#define TRACE_INFO(...)       TRACE_OUTPUT("-I- ", __VA_ARGS__)
+#define TRACE_INFO_WP(...)    TRACE_OUTPUT("", __VA_ARGS__)
 #else
 #define TRACE_INFO(...)       { }
 #define TRACE_INFO_WP(...)    { }
 #endif
 
 #if (TRACE_LEVEL >= TRACE_LEVEL_WARNING)
-#define TRACE_WARNING(...)    { printf("-W- " __VA_ARGS__); }
-#define TRACE_WARNING_WP(...) { printf(__VA_ARGS__); }
+#define TRACE_WARNING(...)    TRACE_OUTPUT("-W- ", __VA_ARGS__)
+#define TRACE_WARNING_WP(...) TRACE_OUTPUT("", __VA_ARGS__)
 #else
 #define TRACE_WARNING(...)    { }
 #define TRACE_WARNING_WP(...) { }
 #endif
 
 #if (TRACE_LEVEL >= TRACE_LEVEL_ERROR)
-#define TRACE_ERROR(...)      { printf("-E- " __VA_ARGS__); }
-#define TRACE_ERROR_WP(...)   { printf(__VA_ARGS__); }
+#define TRACE_ERROR(...)      TRACE_OUTPUT("-E- ", __VA_ARGS__)
+#define TRACE_ERROR_WP(...)   TRACE_OUTPUT("", __VA_ARGS__)
 #else
 #define TRACE_ERROR(...)      { }
 #define TRACE_ERROR_WP(...)   { }
@@ -341,5 +373,15 @@ extern unsigned char TRACE_GetIntegerMinMax(unsigned int *pValue, unsigned int m
 
 extern unsigned char TRACE_GetHexa32(unsigned int *pValue);
 
+#if (TRACE_DEFERRED == 1)
+extern void          TRACE_DeferredStart(void);
+
+extern void          TRACE_DeferredLog(const char *pFormat, unsigned int count, ...);
+
+extern unsigned int  TRACE_DeferredFlush(void);
+
+extern unsigned int  TRACE_DeferredDrain(void (*pWrite)(const unsigned char *, unsigned int));
+#endif
+
 #endif //#ifndef TRACE_H
 
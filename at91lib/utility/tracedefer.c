@@ -0,0 +1,275 @@
+/* ----------------------------------------------------------------------------
+ *         ATMEL Microcontroller Software Support
+ * ----------------------------------------------------------------------------
+ * Copyright (c) 2008, Atmel Corporation
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the disclaimer below.
+ *
+ * Atmel's name may not be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * DISCLAIMER: THIS SOFTWARE IS PROVIDED BY ATMEL "AS IS" AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT ARE
+ * DISCLAIMED. IN NO EVENT SHALL ATMEL BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * ----------------------------------------------------------------------------
+ */
+
+//------------------------------------------------------------------------------
+/// \unit
+///
+/// !Purpose
+///
+/// Deferred, binary encoded back end for the TRACE_* macros.
+///
+/// !Usage
+/// -# Compile with TRACE_DEFERRED=1. The TRACE_DEBUG(), TRACE_INFO(),
+///    TRACE_WARNING() and TRACE_ERROR() macros then store a format string
+///    identifier, a time stamp and the raw arguments into a lock-free ring
+///    buffer instead of calling printf(). This takes a few tens of cycles and
+///    is safe to do from interrupt handlers.
+/// -# Call TRACE_DeferredStart() once to start the time stamp counter.
+/// -# Call TRACE_DeferredFlush() from a low priority task or the main loop to
+///    format and print the buffered traces on the DBGU, or send the binary
+///    records to a host with TRACE_DeferredDrain() and format them there with
+///    utility/tools/tracelog.py.
+/// -# Format strings are placed in the .trace_fmt section; the identifier of a
+///    trace is the offset of its format string in that section. tracelog.py
+///    extracts the section from the ELF file into a dictionary.
+/// -# Arguments are stored as 32-bit words: integers, characters and pointers
+///    are supported. Strings passed with %s must be constant.
+/// -# TRACE_FATAL() is always printed immediately.
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+//         Headers
+//------------------------------------------------------------------------------
+
+#include "trace.h"
+
+#if (TRACE_DEFERRED == 1)
+
+#include <stdarg.h>
+
+//------------------------------------------------------------------------------
+//         Local Definitions
+//------------------------------------------------------------------------------
+
+/// Size of the ring buffer in 32-bit words. Must be a power of two.
+#if !defined(TRACE_DEFERRED_WORDS)
+#define TRACE_DEFERRED_WORDS    256
+#endif
+
+#if (TRACE_DEFERRED_WORDS & (TRACE_DEFERRED_WORDS - 1)) != 0
+#error "TRACE_DEFERRED_WORDS must be a power of two"
+#endif
+
+/// Each record is a header word, a time stamp word and the arguments. The
+/// header holds the format string offset plus one (so it is never zero) in
+/// bits 31..4 and the number of arguments in bits 3..0.
+#define RECORD_HEADER(offset, count)    ((((offset) + 1) << 4) | (count))
+#define RECORD_OFFSET(header)           (((header) >> 4) - 1)
+#define RECORD_COUNT(header)            ((header) & 0xF)
+
+/// DWT cycle counter, used as the time stamp. The host build of
+/// tools/tracebench.c defines its own.
+#if !defined(DWT_CYCCNT)
+#define DEMCR       (*(volatile unsigned int *) 0xE000EDFC)
+#define DWT_CTRL    (*(volatile unsigned int *) 0xE0001000)
+#define DWT_CYCCNT  (*(volatile unsigned int *) 0xE0001004)
+#endif
+#define DEMCR_TRCENA        (1 << 24)
+#define DWT_CTRL_CYCCNTENA  (1 << 0)
+
+//------------------------------------------------------------------------------
+//         Internal variables
+//------------------------------------------------------------------------------
+
+/// Start of the format string section, defined by the linker script.
+extern const char __trace_fmt_start[];
+
+/// Ring buffer. A slot holds zero until its record has been written.
+static volatile unsigned int traceBuffer[TRACE_DEFERRED_WORDS];
+
+/// Total number of words reserved by writers.
+static volatile unsigned int traceHead = 0;
+
+/// Total number of words consumed by the reader.
+static volatile unsigned int traceTail = 0;
+
+/// Number of traces dropped because the buffer was full.
+static volatile unsigned int traceDropped = 0;
+
+//------------------------------------------------------------------------------
+//         Local Functions
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Removes the oldest complete record from the buffer.
+/// \param pArgs  Receives the arguments of the record.
+/// \param pTimestamp  Receives the time stamp of the record.
+/// \return The record header, or 0 if there is no complete record.
+//------------------------------------------------------------------------------
+static unsigned int PopRecord(unsigned int *pArgs, unsigned int *pTimestamp)
+{
+    unsigned int tail = traceTail;
+    unsigned int header;
+    unsigned int count;
+    unsigned int i;
+
+    header = traceBuffer[tail & (TRACE_DEFERRED_WORDS - 1)];
+    if (header == 0) {
+
+        return 0;
+    }
+    __sync_synchronize();
+
+    count = RECORD_COUNT(header);
+    *pTimestamp = traceBuffer[(tail + 1) & (TRACE_DEFERRED_WORDS - 1)];
+    for (i = 0; i < count; i++) {
+
+        pArgs[i] = traceBuffer[(tail + 2 + i) & (TRACE_DEFERRED_WORDS - 1)];
+    }
+
+    // Clear the slots before handing them back, so that a record that is
+    // reserved but not yet written is never mistaken for a complete one.
+    for (i = 0; i < count + 2; i++) {
+
+        traceBuffer[(tail + i) & (TRACE_DEFERRED_WORDS - 1)] = 0;
+    }
+    __sync_synchronize();
+    traceTail = tail + count + 2;
+
+    return header;
+}
+
+//------------------------------------------------------------------------------
+//         Global Functions
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Starts the DWT cycle counter used to time stamp the traces, if it is not
+/// already running.
+//------------------------------------------------------------------------------
+void TRACE_DeferredStart(void)
+{
+    DEMCR |= DEMCR_TRCENA;
+    DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+}
+
+//------------------------------------------------------------------------------
+/// Stores a trace into the ring buffer. Called by the TRACE_* macros; can be
+/// called from interrupt handlers. The trace is dropped if the buffer is full.
+/// \param pFormat  Format string, located in the .trace_fmt section.
+/// \param count  Number of arguments that follow (at most 8).
+//------------------------------------------------------------------------------
+void TRACE_DeferredLog(const char *pFormat, unsigned int count, ...)
+{
+    va_list ap;
+    unsigned int head;
+    unsigned int i;
+
+    // Reserve the slots with a compare and swap, so concurrent writers (tasks
+    // and interrupts) never share a record.
+    do {
+        head = traceHead;
+        if ((head + count + 2 - traceTail) > TRACE_DEFERRED_WORDS) {
+
+            traceDropped++;
+            return;
+        }
+    } while (!__sync_bool_compare_and_swap(&traceHead, head, head + count + 2));
+
+    traceBuffer[(head + 1) & (TRACE_DEFERRED_WORDS - 1)] = DWT_CYCCNT;
+    va_start(ap, count);
+    for (i = 0; i < count; i++) {
+
+        traceBuffer[(head + 2 + i) & (TRACE_DEFERRED_WORDS - 1)] = va_arg(ap, unsigned int);
+    }
+    va_end(ap);
+
+    // Publish the record by writing its header last.
+    __sync_synchronize();
+    traceBuffer[head & (TRACE_DEFERRED_WORDS - 1)] =
+        RECORD_HEADER((unsigned int) (pFormat - __trace_fmt_start), count);
+}
+
+//------------------------------------------------------------------------------
+/// Formats and prints every complete trace in the buffer, using printf().
+/// Must only be called from one context at a time.
+/// \return Number of traces printed.
+//------------------------------------------------------------------------------
+unsigned int TRACE_DeferredFlush(void)
+{
+    unsigned int args[8];
+    unsigned int timestamp;
+    unsigned int header;
+    unsigned int dropped;
+    unsigned int num = 0;
+
+    dropped = traceDropped;
+    if (dropped != 0) {
+
+        __sync_fetch_and_sub(&traceDropped, dropped);
+        printf("-W- %u traces dropped\n\r", dropped);
+    }
+
+    while ((header = PopRecord(args, &timestamp)) != 0) {
+
+        printf(&__trace_fmt_start[RECORD_OFFSET(header)],
+               args[0], args[1], args[2], args[3],
+               args[4], args[5], args[6], args[7]);
+        num++;
+    }
+
+    return num;
+}
+
+//------------------------------------------------------------------------------
+/// Sends every complete trace in the buffer, in binary form, through the
+/// given function. Each record is written as little endian 32-bit words: the
+/// header, the time stamp and the arguments. A record with a zero header
+/// followed by a count word reports dropped traces.
+/// Must only be called from one context at a time.
+/// \param pWrite  Function called to output the records.
+/// \return Number of traces written.
+//------------------------------------------------------------------------------
+unsigned int TRACE_DeferredDrain(void (*pWrite)(const unsigned char *, unsigned int))
+{
+    unsigned int record[10];
+    unsigned int dropped;
+    unsigned int header;
+    unsigned int num = 0;
+
+    dropped = traceDropped;
+    if (dropped != 0) {
+
+        __sync_fetch_and_sub(&traceDropped, dropped);
+        record[0] = 0;
+        record[1] = dropped;
+        pWrite((const unsigned char *) record, 8);
+    }
+
+    while ((header = PopRecord(&record[2], &record[1])) != 0) {
+
+        record[0] = header;
+        pWrite((const unsigned char *) record, (RECORD_COUNT(header) + 2) * 4);
+        num++;
+    }
+
+    return num;
+}
+
+#endif //#if (TRACE_DEFERRED == 1)
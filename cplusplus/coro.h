@@ -0,0 +1,773 @@
+/* Stackless coroutines (C++20 co_await), run by an Executor in one FreeRTOS
+   task.
+
+   A coroutine is a function that returns Coroutine and uses co_await.  Its
+   locals live in a frame allocated with operator new, sized by the compiler
+   for what the function keeps across its co_await points, instead of in a
+   stack of its own: many coroutines, such as the sessions of a protocol,
+   then share the stack of the task that runs the Executor.  Each coroutine
+   runs until it awaits something that is not ready; the Executor then
+   resumes the next one that is.  They never preempt each other, so the data
+   they share needs no lock, but a coroutine that computes for long holds
+   all the others back.
+
+     Executor executor ;
+     Task<300> executorTask ;
+
+     Coroutine session(AsyncQueue<Request, 4> &requests)
+     {
+       Request request ;
+
+       while (co_await requests.receive(request)) {
+         ...
+         co_await delay(10) ;
+       }
+     }
+
+     executor.spawn(session(requests)) ;
+     executorTask.create(Executor::taskCode, "coro", 2, &executor) ;
+
+   What a coroutine may await:
+
+   - delay(ticks), and yield(), which lets the other ready coroutines run.
+   - AsyncQueue<T, N>::receive() and send(), with a timeout.  Tasks and
+     interrupts use the same queue through receiveFromTask()/sendFromTask()
+     and the FromISR() functions.
+   - A Completion, given as the callback and argument of an asynchronous
+     Media or USB transfer (MED_Read(), USBD_Read(), ...).
+   - Another Coroutine, which runs to its end before the caller resumes.
+
+   Coroutines may be spawned, and woken, from any task; interrupts wake them
+   through Completion and AsyncQueue.  A spawned coroutine frees its frame when
+   it returns.  If a frame cannot be allocated, spawn() and co_await of the
+   coroutine return false, as there are no exceptions.
+
+   This needs a compiler with C++20 coroutines: build the files that include
+   coro.h with -std=gnu++20 (GCC 10 or later).  The frames come from the
+   operator new of new.cpp, which gives NULL when memory runs out: build with
+   -fno-exceptions -fcheck-new, as toolchain.mk does, so that the compiler
+   neither expects a throw nor drops the NULL checks.
+ */
+
+#ifndef CORO_H
+#define CORO_H
+
+#if !defined(__cpp_impl_coroutine)
+#error "coro.h needs C++20 coroutines: build with -std=gnu++20"
+#endif
+
+#if defined(__cpp_exceptions)
+#error "coro.h allocates frames without exceptions: build with -fno-exceptions -fcheck-new"
+#endif
+
+#include <coroutine>
+#include <new>
+#include <stdlib.h>
+
+#include <rtos.h>
+
+class Executor ;
+class WaitList ;
+
+/* Coroutine frames allocated, for sizing the heap. */
+struct CoroutineStats
+{
+  size_t frames ;     // frames allocated
+  size_t bytes ;      // bytes of these frames
+  size_t maxBytes ;   // the most bytes allocated at the same time
+} ;
+
+inline CoroutineStats coroutineStats ;
+
+class Coroutine
+{
+public:
+  struct promise_type ;
+  typedef std::coroutine_handle<promise_type> Handle ;
+
+  // Resumes the coroutine awaiting this one, or frees the frame of a
+  // coroutine that was spawned.
+  struct FinalAwaiter
+  {
+    bool await_ready() noexcept { return false ; }
+
+    std::coroutine_handle<> await_suspend(Handle handle) noexcept
+    {
+      std::coroutine_handle<> caller = handle.promise().caller ;
+
+      if (caller) {
+        return caller ;
+      }
+      handle.destroy() ;
+      return std::noop_coroutine() ;
+    }
+
+    void await_resume() noexcept {}
+  } ;
+
+  struct promise_type
+  {
+    Executor *executor ;
+    promise_type *next ;                // in the ready or woken list of the executor
+    std::coroutine_handle<> caller ;    // the coroutine awaiting this one, if any
+
+    promise_type() : executor(NULL), next(NULL) {}
+
+    Coroutine get_return_object() { return Coroutine(Handle::from_promise(*this)) ; }
+    static Coroutine get_return_object_on_allocation_failure() { return Coroutine() ; }
+
+    // the coroutine starts once spawned or awaited
+    std::suspend_always initial_suspend() noexcept { return std::suspend_always() ; }
+    FinalAwaiter final_suspend() noexcept { return FinalAwaiter() ; }
+
+    void return_void() {}
+    void unhandled_exception() { abort() ; }
+
+    static void *operator new(size_t size) noexcept
+    {
+      void *frame = ::operator new(size) ;
+
+      if (frame != NULL) {
+        taskENTER_CRITICAL() ;
+        coroutineStats.frames++ ;
+        coroutineStats.bytes += size ;
+        if (coroutineStats.bytes > coroutineStats.maxBytes) {
+          coroutineStats.maxBytes = coroutineStats.bytes ;
+        }
+        taskEXIT_CRITICAL() ;
+      }
+      return frame ;
+    }
+
+    static void operator delete(void *frame, size_t size) noexcept
+    {
+      taskENTER_CRITICAL() ;
+      coroutineStats.frames-- ;
+      coroutineStats.bytes -= size ;
+      taskEXIT_CRITICAL() ;
+      ::operator delete(frame) ;
+    }
+  } ;
+
+  // co_await of a coroutine: runs it in place of the caller, until it returns.
+  struct Awaiter
+  {
+    Handle callee ;
+
+    bool await_ready() noexcept { return !callee ; }
+
+    std::coroutine_handle<> await_suspend(Handle caller) noexcept
+    {
+      callee.promise().caller = caller ;
+      callee.promise().executor = caller.promise().executor ;
+      return callee ;
+    }
+
+    // false if the frame could not be allocated
+    bool await_resume() noexcept { return (bool) callee ; }
+  } ;
+
+  Coroutine() : _handle(nullptr) {}
+  Coroutine(Coroutine &&other) : _handle(other._handle) { other._handle = nullptr ; }
+
+  // A coroutine that was neither spawned nor awaited is freed unrun.
+  ~Coroutine()
+  {
+    if (_handle) {
+      _handle.destroy() ;
+    }
+  }
+
+  Awaiter operator co_await() && noexcept { return Awaiter { _handle } ; }
+
+private:
+  explicit Coroutine(Handle handle) : _handle(handle) {}
+  Coroutine(const Coroutine &) ;
+  Coroutine &operator=(const Coroutine &) ;
+
+  Handle _handle ;
+
+  friend class Executor ;
+} ;
+
+/* A coroutine suspended on a timer, an event, or both. */
+struct Waiter
+{
+  Coroutine::promise_type *coroutine ;
+  WaitList *list ;        // the event the waiter is on, until it is woken
+  Waiter *next ;          // in the list of that event
+  Waiter *prev ;
+  Waiter *timerNext ;     // in the timers of the executor
+  portTickType wakeTick ;
+  bool event ;            // waits for an event, maybe also for a timer
+  bool timed ;            // on the timers
+  bool result ;           // false if the time ran out first
+  void *item ;            // for queues, the item to receive into or to send
+
+  Waiter() : coroutine(NULL), list(NULL), event(false), timed(false), result(false), item(NULL) {}
+} ;
+
+/* The coroutines waiting for an event, first come first served.  Callers
+   hold the lock of the event: a critical section, or the interrupt. */
+class WaitList
+{
+public:
+  WaitList() : _first(NULL), _last(NULL) {}
+
+  Waiter *first(void) const { return _first ; }
+
+  void append(Waiter *waiter)
+  {
+    waiter->list = this ;
+    waiter->next = NULL ;
+    waiter->prev = _last ;
+    if (_last != NULL) {
+      _last->next = waiter ;
+    }
+    else {
+      _first = waiter ;
+    }
+    _last = waiter ;
+  }
+
+  void remove(Waiter *waiter)
+  {
+    if (waiter->prev != NULL) {
+      waiter->prev->next = waiter->next ;
+    }
+    else {
+      _first = waiter->next ;
+    }
+    if (waiter->next != NULL) {
+      waiter->next->prev = waiter->prev ;
+    }
+    else {
+      _last = waiter->prev ;
+    }
+    waiter->list = NULL ;
+  }
+
+private:
+  Waiter *_first ;
+  Waiter *_last ;
+} ;
+
+class Executor
+{
+public:
+  Executor() : _task(NULL), _ready(NULL), _readyLast(NULL), _woken(NULL), _wokenLast(NULL),
+               _timers(NULL) {}
+
+  // Starts a coroutine, from any task.  False if its frame could not be
+  // allocated.
+  bool spawn(Coroutine &&coroutine)
+  {
+    Coroutine::Handle handle = coroutine._handle ;
+
+    if (!handle) {
+      return false ;
+    }
+    coroutine._handle = nullptr ;
+    handle.promise().executor = this ;
+    wake(&handle.promise()) ;
+    return true ;
+  }
+
+  // Runs the coroutines that are ready, then waits for the next timer or
+  // wake up.  The body of the executor task: never returns.
+  void run(void)
+  {
+    for (;;) {
+      _wake.take(poll()) ;
+    }
+  }
+
+  static void taskCode(void *executor)
+  {
+    ((Executor *) executor)->run() ;
+  }
+
+  // Runs the coroutines until none is ready, without blocking.  Returns the
+  // ticks until the next timer, or portMAX_DELAY if there is none.
+  portTickType poll(void)
+  {
+    portTickType now ;
+
+    _task = xTaskGetCurrentTaskHandle() ;
+    for (;;) {
+      takeWoken() ;
+      now = xTaskGetTickCount() ;
+      expireTimers(now) ;
+      if (_ready == NULL) {
+        break ;
+      }
+      while (_ready != NULL) {
+        Coroutine::promise_type *coroutine = _ready ;
+
+        _ready = coroutine->next ;
+        Coroutine::Handle::from_promise(*coroutine).resume() ;
+      }
+    }
+    return _timers != NULL ? (portTickType) (_timers->wakeTick - now) : portMAX_DELAY ;
+  }
+
+  // Makes a suspended coroutine ready, from a task.
+  void wake(Coroutine::promise_type *coroutine)
+  {
+    if (xTaskGetCurrentTaskHandle() == _task) {
+      schedule(coroutine) ;
+      return ;
+    }
+    taskENTER_CRITICAL() ;
+    appendWoken(coroutine) ;
+    taskEXIT_CRITICAL() ;
+    _wake.give() ;
+  }
+
+  // Makes a suspended coroutine ready, from an interrupt.
+  void wakeFromISR(Coroutine::promise_type *coroutine, signed portBASE_TYPE *woken)
+  {
+    unsigned portBASE_TYPE mask = portSET_INTERRUPT_MASK_FROM_ISR() ;
+
+    appendWoken(coroutine) ;
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(mask) ;
+    _wake.giveFromISR(woken) ;
+  }
+
+  // The following are for awaiters, in the executor task.
+
+  void schedule(Coroutine::promise_type *coroutine)
+  {
+    coroutine->next = NULL ;
+    if (_ready != NULL) {
+      _readyLast->next = coroutine ;
+    }
+    else {
+      _ready = coroutine ;
+    }
+    _readyLast = coroutine ;
+  }
+
+  void addTimer(Waiter *waiter, portTickType ticks)
+  {
+    portTickType now = xTaskGetTickCount() ;
+    Waiter **link = &_timers ;
+
+    // after the timers due before or with it, across the wrap of the tick count
+    waiter->wakeTick = now + ticks ;
+    while (*link != NULL
+           && (portTickType) (waiter->wakeTick - (*link)->wakeTick) <= portMAX_DELAY / 2) {
+      link = &(*link)->timerNext ;
+    }
+    waiter->timerNext = *link ;
+    waiter->timed = true ;
+    *link = waiter ;
+  }
+
+  void cancelTimer(Waiter *waiter)
+  {
+    Waiter **link = &_timers ;
+
+    while (*link != waiter) {
+      link = &(*link)->timerNext ;
+    }
+    *link = waiter->timerNext ;
+    waiter->timed = false ;
+  }
+
+private:
+  Executor(const Executor &) ;
+  Executor &operator=(const Executor &) ;
+
+  void appendWoken(Coroutine::promise_type *coroutine)
+  {
+    coroutine->next = NULL ;
+    if (_woken != NULL) {
+      _wokenLast->next = coroutine ;
+    }
+    else {
+      _woken = coroutine ;
+    }
+    _wokenLast = coroutine ;
+  }
+
+  // Moves the coroutines woken by other tasks and interrupts to the ready list.
+  void takeWoken(void)
+  {
+    Coroutine::promise_type *woken ;
+    Coroutine::promise_type *wokenLast ;
+
+    taskENTER_CRITICAL() ;
+    woken = _woken ;
+    wokenLast = _wokenLast ;
+    _woken = NULL ;
+    taskEXIT_CRITICAL() ;
+    if (woken == NULL) {
+      return ;
+    }
+    if (_ready != NULL) {
+      _readyLast->next = woken ;
+    }
+    else {
+      _ready = woken ;
+    }
+    _readyLast = wokenLast ;
+  }
+
+  void expireTimers(portTickType now)
+  {
+    while (_timers != NULL && (portTickType) (now - _timers->wakeTick) <= portMAX_DELAY / 2) {
+      Waiter *waiter = _timers ;
+
+      _timers = waiter->timerNext ;
+      waiter->timed = false ;
+      if (waiter->event) {
+        // unless the event came first: then the coroutine is already on
+        // its way to the ready list
+        bool waiting ;
+
+        taskENTER_CRITICAL() ;
+        waiting = waiter->list != NULL ;
+        if (waiting) {
+          waiter->list->remove(waiter) ;
+        }
+        taskEXIT_CRITICAL() ;
+        if (!waiting) {
+          continue ;
+        }
+      }
+      schedule(waiter->coroutine) ;
+    }
+  }
+
+  xTaskHandle _task ;
+  Coroutine::promise_type *_ready ;
+  Coroutine::promise_type *_readyLast ;
+  // woken by other tasks and interrupts, under a critical section
+  Coroutine::promise_type *volatile _woken ;
+  Coroutine::promise_type *_wokenLast ;
+  Waiter *_timers ;
+  Semaphore _wake ;
+} ;
+
+/* co_await delay(ticks): resumes after the given ticks. */
+class Delay
+{
+public:
+  explicit Delay(portTickType ticks) : _ticks(ticks) {}
+
+  bool await_ready() noexcept { return false ; }
+
+  void await_suspend(Coroutine::Handle handle) noexcept
+  {
+    Executor *executor = handle.promise().executor ;
+
+    _waiter.coroutine = &handle.promise() ;
+    if (_ticks == 0) {
+      executor->schedule(_waiter.coroutine) ;
+    }
+    else {
+      executor->addTimer(&_waiter, _ticks) ;
+    }
+  }
+
+  void await_resume() noexcept {}
+
+private:
+  portTickType _ticks ;
+  Waiter _waiter ;
+} ;
+
+inline Delay delay(portTickType ticks)
+{
+  return Delay(ticks) ;
+}
+
+// co_await yield(): lets the other ready coroutines run first.
+inline Delay yield(void)
+{
+  return Delay(0) ;
+}
+
+/* The completion of an asynchronous Media or USB transfer:
+
+     Completion done ;
+
+     if (USBD_Read(bulkOut, buffer, size, Completion::callback, &done)
+         == USBD_STATUS_SUCCESS) {
+       co_await done ;
+       ... done.status, done.transferred
+     }
+
+   The callback may come from an interrupt or from a task, and also before
+   the coroutine awaits it.  A Completion is for one transfer at a time; reset()
+   makes it ready for the next. */
+class Completion
+{
+public:
+  Completion() : status(0), transferred(0), remaining(0), _done(false), _coroutine(NULL) {}
+
+  // A MediaCallback and a TransferCallback, with the Completion as argument.
+  static void callback(void *completion, unsigned char status, unsigned int transferred,
+                       unsigned int remaining)
+  {
+    Completion *self = (Completion *) completion ;
+    Coroutine::promise_type *coroutine ;
+    unsigned portBASE_TYPE mask = portSET_INTERRUPT_MASK_FROM_ISR() ;
+
+    self->status = status ;
+    self->transferred = transferred ;
+    self->remaining = remaining ;
+    self->_done = true ;
+    coroutine = self->_coroutine ;
+    self->_coroutine = NULL ;
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(mask) ;
+
+    if (coroutine != NULL) {
+      signed portBASE_TYPE woken = pdFALSE ;
+
+      coroutine->executor->wakeFromISR(coroutine, &woken) ;
+      portEND_SWITCHING_ISR(woken) ;
+    }
+  }
+
+  void reset(void) { _done = false ; }
+
+  bool await_ready() noexcept { return _done ; }
+
+  bool await_suspend(Coroutine::Handle handle) noexcept
+  {
+    bool wait ;
+
+    taskENTER_CRITICAL() ;
+    wait = !_done ;
+    if (wait) {
+      _coroutine = &handle.promise() ;
+    }
+    taskEXIT_CRITICAL() ;
+    return wait ;
+  }
+
+  // the status given to the callback
+  unsigned char await_resume() noexcept { return status ; }
+
+  unsigned char status ;
+  unsigned int transferred ;
+  unsigned int remaining ;
+
+private:
+  Completion(const Completion &) ;
+  Completion &operator=(const Completion &) ;
+
+  volatile bool _done ;
+  Coroutine::promise_type *_coroutine ;
+} ;
+
+/* The part of AsyncQueue<T, N> that does not depend on T.  The items go
+   through the kernel queue, as with a Queue<T, N>; coroutines that cannot
+   send or receive wait in a list of the AsyncQueue, and whoever makes room or
+   brings an item then moves it for them (settle()).  Tasks that block do
+   so in the kernel queue, as usual. */
+class AsyncQueueBase
+{
+public:
+  // co_await of receive() or send(): true once done, false on timeout.
+  class [[nodiscard]] Wait
+  {
+  public:
+    Wait(AsyncQueueBase &queue, void *item, portTickType ticks, bool send)
+      : _queue(queue), _ticks(ticks), _send(send)
+    {
+      _waiter.item = item ;
+    }
+
+    // decided under the lock, in await_suspend()
+    bool await_ready() noexcept { return false ; }
+
+    bool await_suspend(Coroutine::Handle handle) noexcept
+    {
+      bool done ;
+
+      taskENTER_CRITICAL() ;
+      done = _queue.tryOperation(_send, _waiter.item) ;
+      if (!done && _ticks != 0) {
+        _waiter.coroutine = &handle.promise() ;
+        _waiter.event = true ;
+        (_send ? _queue._senders : _queue._receivers).append(&_waiter) ;
+      }
+      taskEXIT_CRITICAL() ;
+
+      _waiter.result = done ;
+      if (done) {
+        _queue.settle() ;
+        return false ;
+      }
+      if (_ticks == 0) {
+        return false ;
+      }
+      if (_ticks != portMAX_DELAY) {
+        handle.promise().executor->addTimer(&_waiter, _ticks) ;
+      }
+      return true ;
+    }
+
+    bool await_resume() noexcept
+    {
+      if (_waiter.timed) {
+        _waiter.coroutine->executor->cancelTimer(&_waiter) ;
+      }
+      return _waiter.result ;
+    }
+
+  private:
+    AsyncQueueBase &_queue ;
+    portTickType _ticks ;
+    bool _send ;
+    Waiter _waiter ;
+  } ;
+
+  unsigned portBASE_TYPE waiting(void) const
+  {
+    return uxQueueMessagesWaiting(_handle) ;
+  }
+
+protected:
+  AsyncQueueBase() : _handle(NULL) {}
+
+  bool tryOperation(bool send, void *item)
+  {
+    if (send) {
+      return xQueueGenericSend(_handle, item, 0, queueSEND_TO_BACK) == pdPASS ;
+    }
+    return xQueueGenericReceive(_handle, item, 0, pdFALSE) == pdPASS ;
+  }
+
+  // Gives the waiting coroutines the items, or the room, that are there.
+  void settle(void)
+  {
+    Waiter *waiter ;
+    bool moved ;
+
+    taskENTER_CRITICAL() ;
+    do {
+      moved = false ;
+      while ((waiter = _receivers.first()) != NULL
+             && xQueueGenericReceive(_handle, waiter->item, 0, pdFALSE) == pdPASS) {
+        wakeWaiter(&_receivers, waiter) ;
+        moved = true ;
+      }
+      while ((waiter = _senders.first()) != NULL
+             && xQueueGenericSend(_handle, waiter->item, 0, queueSEND_TO_BACK) == pdPASS) {
+        wakeWaiter(&_senders, waiter) ;
+        moved = true ;
+      }
+    } while (moved) ;
+    taskEXIT_CRITICAL() ;
+  }
+
+  // The same from an interrupt, which the tasks cannot preempt.  Calls from
+  // interrupts of different priorities must not share a queue.
+  void settleFromISR(signed portBASE_TYPE *woken)
+  {
+    Waiter *waiter ;
+    bool moved ;
+
+    do {
+      moved = false ;
+      while ((waiter = _receivers.first()) != NULL
+             && xQueueReceiveFromISR(_handle, waiter->item, woken) == pdPASS) {
+        _receivers.remove(waiter) ;
+        waiter->result = true ;
+        waiter->coroutine->executor->wakeFromISR(waiter->coroutine, woken) ;
+        moved = true ;
+      }
+      while ((waiter = _senders.first()) != NULL
+             && xQueueGenericSendFromISR(_handle, waiter->item, woken, queueSEND_TO_BACK) == pdPASS) {
+        _senders.remove(waiter) ;
+        waiter->result = true ;
+        waiter->coroutine->executor->wakeFromISR(waiter->coroutine, woken) ;
+        moved = true ;
+      }
+    } while (moved) ;
+  }
+
+  xQueueHandle _handle ;
+
+private:
+  AsyncQueueBase(const AsyncQueueBase &) ;
+  AsyncQueueBase &operator=(const AsyncQueueBase &) ;
+
+  static void wakeWaiter(WaitList *list, Waiter *waiter)
+  {
+    list->remove(waiter) ;
+    waiter->result = true ;
+    waiter->coroutine->executor->wake(waiter->coroutine) ;
+  }
+
+  WaitList _receivers ;
+  WaitList _senders ;
+} ;
+
+/* A queue of N items of the plain type T, shared by coroutines, tasks and
+   interrupts.  Its handle must not be used directly, or the coroutines that
+   wait would not learn of the items and room it makes. */
+template <class T, unsigned portBASE_TYPE N>
+class AsyncQueue : public AsyncQueueBase
+{
+public:
+  AsyncQueue() { _handle = _queue.handle() ; }
+
+  // For coroutines: co_await queue.receive(item, ticks).
+  Wait receive(T &item, portTickType ticks = portMAX_DELAY)
+  {
+    return Wait(*this, &item, ticks, false) ;
+  }
+
+  Wait send(const T &item, portTickType ticks = portMAX_DELAY)
+  {
+    return Wait(*this, (void *) &item, ticks, true) ;
+  }
+
+  // For tasks, which block in the kernel queue.
+  bool receiveFromTask(T &item, portTickType ticks = portMAX_DELAY)
+  {
+    if (!_queue.receive(item, ticks)) {
+      return false ;
+    }
+    settle() ;
+    return true ;
+  }
+
+  bool sendFromTask(const T &item, portTickType ticks = portMAX_DELAY)
+  {
+    if (!_queue.send(item, ticks)) {
+      return false ;
+    }
+    settle() ;
+    return true ;
+  }
+
+  // For interrupts; *woken is set if a task of higher priority was woken.
+  bool receiveFromISR(T &item, signed portBASE_TYPE *woken)
+  {
+    if (!_queue.receiveFromISR(item, woken)) {
+      return false ;
+    }
+    settleFromISR(woken) ;
+    return true ;
+  }
+
+  bool sendFromISR(const T &item, signed portBASE_TYPE *woken)
+  {
+    if (!_queue.sendFromISR(item, woken)) {
+      return false ;
+    }
+    settleFromISR(woken) ;
+    return true ;
+  }
+
+private:
+  Queue<T, N> _queue ;
+} ;
+
+#endif
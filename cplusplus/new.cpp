@@ -1,18 +1,390 @@
 #include <new.h>
 
+#include <stdint.h>
+
+#if defined(__arm__)
+
+extern "C" {
+#include <FreeRTOS.h>
+#include <task.h>
+}
+
+#define newLock() taskENTER_CRITICAL()
+#define newUnlock() taskEXIT_CRITICAL()
+#define heapAlloc(size) pvPortMalloc(size)
+#define heapFree(ptr) vPortFree(ptr)
+
+#else
+
+// Host builds, for the core benchmarks, are single threaded.
+#define newLock()
+#define newUnlock()
+#define heapAlloc(size) malloc(size)
+#define heapFree(ptr) free(ptr)
+
+#endif // __arm__
+
+// Blocks of the pools, and of the heap, are aligned to 8 bytes.
+#define NEW_ALIGN 8
+
+#if NEW_POOL_SIZE > 0
+
+#define NEW_POOL_PAGES (NEW_POOL_SIZE / NEW_POOL_PAGE)
+#define NEW_POOL_CLASSES 6
+
+#if NEW_POOL_PAGES > 255
+#error "NEW_POOL_SIZE / NEW_POOL_PAGE must be at most 255 pages"
+#endif
+
+struct Block
+{
+  Block *next ;
+} ;
+
+// A page of the arena.  Its freed blocks are on its own list, so that the
+// page can go back to the arena when the last of them comes back, and the
+// blocks never given out yet are cut from the top, so that taking a page
+// costs nothing.  Pages are linked by number plus one, 0 ending a list.
+struct Page
+{
+  Block *free ;     // freed blocks
+  uint16_t top ;    // offset of the first block never given out
+  uint16_t live ;   // blocks given out
+  uint8_t cls ;     // size class plus one, 0 while the page is free
+  uint8_t prev ;    // in the list of the pages of the class that have room,
+  uint8_t next ;    // or in the list of the free pages
+} ;
+
+static const uint8_t classSizes[NEW_POOL_CLASSES] = { 8, 16, 24, 32, 48, 64 } ;
+
+// Size class of (size + 7) / 8.
+static const uint8_t classOf[NEW_POOL_MAX / 8 + 1] = { 0, 0, 1, 2, 3, 4, 4, 5, 5 } ;
+
+static uint8_t arena[NEW_POOL_PAGES * NEW_POOL_PAGE] __attribute__((aligned(NEW_ALIGN))) ;
+
+// delete has no size to go by, so the class of a block is found from its page.
+static Page pages[NEW_POOL_PAGES] ;
+static uint8_t roomy[NEW_POOL_CLASSES] ;  // pages of each class that have room
+static uint8_t freePages ;                // pages given back
+static unsigned int pagesTouched ;        // pages above are still untouched
+static unsigned int pagesUsed ;
+static size_t bytesInUse ;
+
+static void unlinkRoomy(unsigned int n)
+{
+  Page *page = &pages[n - 1] ;
+
+  if (page->prev != 0) {
+    pages[page->prev - 1].next = page->next ;
+  }
+  else {
+    roomy[page->cls - 1] = page->next ;
+  }
+  if (page->next != 0) {
+    pages[page->next - 1].prev = page->prev ;
+  }
+}
+
+static void linkRoomy(unsigned int n)
+{
+  Page *page = &pages[n - 1] ;
+  unsigned int c = page->cls - 1 ;
+
+  page->prev = 0 ;
+  page->next = roomy[c] ;
+  if (roomy[c] != 0) {
+    pages[roomy[c] - 1].prev = n ;
+  }
+  roomy[c] = n ;
+}
+
+#endif // NEW_POOL_SIZE
+
+static size_t heapAllocations ;
+static size_t poolMisses ;
+
+static void *allocate(size_t size)
+{
+#if NEW_POOL_SIZE > 0
+  if (size <= NEW_POOL_MAX) {
+    unsigned int c = classOf[(size + 7) >> 3] ;
+    unsigned int n ;
+    Page *page ;
+    void *block ;
+
+    newLock() ;
+    n = roomy[c] ;
+    if (n == 0) {
+      // give the class a free page, or the next untouched one
+      if (freePages != 0) {
+        n = freePages ;
+        freePages = pages[n - 1].next ;
+      }
+      else if (pagesTouched < NEW_POOL_PAGES) {
+        n = ++pagesTouched ;
+      }
+      if (n != 0) {
+        page = &pages[n - 1] ;
+        page->free = NULL ;
+        page->top = 0 ;
+        page->live = 0 ;
+        page->cls = c + 1 ;
+        linkRoomy(n) ;
+        pagesUsed++ ;
+      }
+    }
+    if (n != 0) {
+      page = &pages[n - 1] ;
+      if (page->free != NULL) {
+        block = page->free ;
+        page->free = page->free->next ;
+      }
+      else {
+        block = arena + (n - 1) * NEW_POOL_PAGE + page->top ;
+        page->top += classSizes[c] ;
+      }
+      page->live++ ;
+      if (page->free == NULL && page->top + classSizes[c] > NEW_POOL_PAGE) {
+        unlinkRoomy(n) ;
+      }
+      bytesInUse += classSizes[c] ;
+      newUnlock() ;
+      return block ;
+    }
+    poolMisses++ ;
+    newUnlock() ;
+  }
+#endif
+  newLock() ;
+  heapAllocations++ ;
+  newUnlock() ;
+  return heapAlloc(size) ;
+}
+
+static void deallocate(void *ptr)
+{
+#if NEW_POOL_SIZE > 0
+  uintptr_t offset = (uintptr_t) ptr - (uintptr_t) arena ;
+
+  // also false for NULL, and anything below the arena
+  if (offset < sizeof(arena)) {
+    unsigned int n = offset / NEW_POOL_PAGE + 1 ;
+    Page *page = &pages[n - 1] ;
+    unsigned int c = page->cls - 1 ;
+    Block *block = (Block *) ptr ;
+
+    newLock() ;
+    if (page->free == NULL && page->top + classSizes[c] > NEW_POOL_PAGE) {
+      linkRoomy(n) ;  // it was full
+    }
+    block->next = page->free ;
+    page->free = block ;
+    bytesInUse -= classSizes[c] ;
+    if (--page->live == 0) {
+      // empty: back to the arena, for any class
+      unlinkRoomy(n) ;
+      page->cls = 0 ;
+      page->next = freePages ;
+      freePages = n ;
+      pagesUsed-- ;
+    }
+    newUnlock() ;
+    return ;
+  }
+#endif
+  heapFree(ptr) ;
+}
+
+void newPoolStats(NewPoolStats *stats)
+{
+  newLock() ;
+#if NEW_POOL_SIZE > 0
+  stats->pagesUsed = pagesUsed ;
+  stats->bytesInUse = bytesInUse ;
+#else
+  stats->pagesUsed = 0 ;
+  stats->bytesInUse = 0 ;
+#endif
+  stats->heapAllocations = heapAllocations ;
+  stats->poolMisses = poolMisses ;
+  newUnlock() ;
+}
+
+// There is no libsupc++ to throw std::bad_alloc: all forms of new give NULL
+// when memory runs out. _GLIBCXX_USE_NOEXCEPT, from <new>, is noexcept in
+// C++11 and later, and throw() before, as the declarations in <new>.
+
 void * operator new(size_t size)
 {
-  return malloc(size);
+  return allocate(size) ;
 }
 
-void operator delete(void * ptr)
+void * operator new[](size_t size)
 {
-  free(ptr);
-} 
+  return allocate(size) ;
+}
 
-int __cxa_guard_acquire(__guard *g) {return !*(char *)(g);};
-void __cxa_guard_release (__guard *g) {*(char *)g = 1;};
-void __cxa_guard_abort (__guard *) {}; 
+void * operator new(size_t size, const std::nothrow_t &) _GLIBCXX_USE_NOEXCEPT
+{
+  return allocate(size) ;
+}
 
-void __cxa_pure_virtual(void) {};
+void * operator new[](size_t size, const std::nothrow_t &) _GLIBCXX_USE_NOEXCEPT
+{
+  return allocate(size) ;
+}
+
+void operator delete(void * ptr) _GLIBCXX_USE_NOEXCEPT
+{
+  deallocate(ptr) ;
+}
+
+void operator delete[](void * ptr) _GLIBCXX_USE_NOEXCEPT
+{
+  deallocate(ptr) ;
+}
 
+// Called instead of the above by C++14 code for complete types; the size is
+// not needed, since the page gives the size class.
+void operator delete(void * ptr, size_t) _GLIBCXX_USE_NOEXCEPT
+{
+  deallocate(ptr) ;
+}
+
+void operator delete[](void * ptr, size_t) _GLIBCXX_USE_NOEXCEPT
+{
+  deallocate(ptr) ;
+}
+
+// The pairs of the nothrow new, which code that allocates with it may call.
+void operator delete(void * ptr, const std::nothrow_t &) _GLIBCXX_USE_NOEXCEPT
+{
+  deallocate(ptr) ;
+}
+
+void operator delete[](void * ptr, const std::nothrow_t &) _GLIBCXX_USE_NOEXCEPT
+{
+  deallocate(ptr) ;
+}
+
+#if __cpp_aligned_new
+
+// Over-aligned types (C++17). The heap only aligns to 8 bytes, so more is
+// allocated, and the pointer the heap gave is kept in front of the object.
+
+static void *allocateAligned(size_t size, size_t alignment)
+{
+  uint8_t *raw ;
+  uintptr_t aligned ;
+
+  if (alignment <= NEW_ALIGN) {
+    return allocate(size) ;
+  }
+  newLock() ;
+  heapAllocations++ ;
+  newUnlock() ;
+  raw = (uint8_t *) heapAlloc(size + alignment + sizeof(void *)) ;
+  if (raw == NULL) {
+    return NULL ;
+  }
+  aligned = ((uintptr_t) raw + sizeof(void *) + alignment - 1) & ~(uintptr_t) (alignment - 1) ;
+  ((void **) aligned)[-1] = raw ;
+  return (void *) aligned ;
+}
+
+static void deallocateAligned(void *ptr, size_t alignment)
+{
+  if (alignment <= NEW_ALIGN) {
+    deallocate(ptr) ;
+  }
+  else if (ptr != NULL) {
+    heapFree(((void **) ptr)[-1]) ;
+  }
+}
+
+void * operator new(size_t size, std::align_val_t alignment)
+{
+  return allocateAligned(size, (size_t) alignment) ;
+}
+
+void * operator new[](size_t size, std::align_val_t alignment)
+{
+  return allocateAligned(size, (size_t) alignment) ;
+}
+
+void operator delete(void * ptr, std::align_val_t alignment) _GLIBCXX_USE_NOEXCEPT
+{
+  deallocateAligned(ptr, (size_t) alignment) ;
+}
+
+void operator delete[](void * ptr, std::align_val_t alignment) _GLIBCXX_USE_NOEXCEPT
+{
+  deallocateAligned(ptr, (size_t) alignment) ;
+}
+
+void operator delete(void * ptr, size_t, std::align_val_t alignment) _GLIBCXX_USE_NOEXCEPT
+{
+  deallocateAligned(ptr, (size_t) alignment) ;
+}
+
+void operator delete[](void * ptr, size_t, std::align_val_t alignment) _GLIBCXX_USE_NOEXCEPT
+{
+  deallocateAligned(ptr, (size_t) alignment) ;
+}
+
+#endif // __cpp_aligned_new
+
+// Guards of function-local statics. Byte 0 is set once the object is
+// constructed; the compiler checks it inline, and only calls
+// __cxa_guard_acquire() while it is clear. Byte 1 is set while a task runs
+// the constructor: other tasks that reach the static then sleep until it is
+// done, or until it failed and they may try themselves.
+
+int __cxa_guard_acquire(__guard *g)
+{
+  volatile uint8_t *state = (volatile uint8_t *) g ;
+
+  for (;;) {
+    newLock() ;
+    if (state[0]) {
+      newUnlock() ;
+      return 0 ;
+    }
+    if (!state[1]) {
+      state[1] = 1 ;
+      newUnlock() ;
+      return 1 ;
+    }
+    newUnlock() ;
+#if defined(__arm__)
+    // unless other tasks can run, the constructor is our own caller
+    if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) {
+      abort() ;
+    }
+    vTaskDelay(1) ;
+#else
+    abort() ;
+#endif
+  }
+}
+
+void __cxa_guard_release(__guard *g)
+{
+  volatile uint8_t *state = (volatile uint8_t *) g ;
+
+  newLock() ;
+  state[0] = 1 ;
+  state[1] = 0 ;
+  newUnlock() ;
+}
+
+void __cxa_guard_abort(__guard *g)
+{
+  volatile uint8_t *state = (volatile uint8_t *) g ;
+
+  newLock() ;
+  state[1] = 0 ;
+  newUnlock() ;
+}
+
+void __cxa_pure_virtual(void) {};
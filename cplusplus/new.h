@@ -1,22 +1,53 @@
-/* Header to define new/delete operators as they aren't provided by avr-gcc by default
-   Taken from http://www.avrfreaks.net/index.php?name=PNphpBB2&file=viewtopic&t=59453 
+/* C++ runtime support: new/delete operators, static initialization guards and
+   pure virtual calls, which would otherwise come from libsupc++.
+
+   Allocations of up to NEW_POOL_MAX bytes are served from a static arena of
+   NEW_POOL_SIZE bytes, cut into pages of NEW_POOL_PAGE bytes.  A page is given
+   to a size class (8, 16, 24, 32, 48 or 64 bytes) the first time that class
+   runs out of blocks; freed blocks go back on the free list of their page,
+   and a page whose blocks have all come back returns to the arena, for any
+   class to take.  Small objects that come and go, such as String buffers and
+   container nodes, then neither fragment the heap nor pay for its search.
+   Larger allocations, and small ones once the arena is used up, go to the
+   RTOS heap.  Define NEW_POOL_SIZE as 0 to send everything to the heap.
+
+   Both the pools and the guards are locked with taskENTER_CRITICAL(), so
+   new and delete may be called from any task, but not from interrupts.
  */
 
 #ifndef NEW_H
 #define NEW_H
 
+#include <new>
 #include <stdlib.h>
 
-void * operator new(size_t size);
-void operator delete(void * ptr); 
+#ifndef NEW_POOL_SIZE
+#define NEW_POOL_SIZE 4096
+#endif
+
+#ifndef NEW_POOL_PAGE
+#define NEW_POOL_PAGE 256
+#endif
+
+#define NEW_POOL_MAX 64
+
+/* Pool usage, for sizing NEW_POOL_SIZE. */
+struct NewPoolStats
+{
+  size_t pagesUsed ;        // pages holding blocks given out
+  size_t bytesInUse ;       // bytes of the blocks allocated from the pools
+  size_t heapAllocations ;  // allocations that went to the heap
+  size_t poolMisses ;       // of which small ones, as the arena was full
+} ;
+
+extern void newPoolStats( NewPoolStats *stats ) ;
 
 __extension__ typedef int __guard __attribute__((mode (__DI__)));
 
 extern "C" int __cxa_guard_acquire(__guard *);
 extern "C" void __cxa_guard_release (__guard *);
-extern "C" void __cxa_guard_abort (__guard *); 
+extern "C" void __cxa_guard_abort (__guard *);
 
 extern "C" void __cxa_pure_virtual(void);
 
 #endif
-
@@ -0,0 +1,207 @@
+/* Typed C++ wrappers of the FreeRTOS queues, semaphores, mutexes and tasks.
+
+   Each object holds the memory of its kernel object, so that a static object
+   is allocated at compile time: a Queue<T, N> holds its queue structure and N
+   items of storage, a Task<StackWords> its stack.  Only the control block of a
+   task still comes from the heap.  Queues, semaphores and mutexes are created
+   by their constructors, which may run before main(); a task is created by
+   create(), once the things it uses are set up.
+
+   Items are queued by copy, so T must be a plain type: it is stored in a
+   union, which does not accept types with constructors.  The item size is a
+   constant of each Queue<T, N>, and queue.c copies items of 1, 2, 4 and 8
+   bytes with a single load and store, instead of memcpy().
+
+   The objects are meant to live for the whole program: there is no
+   destructor, and a task must not be passed to vTaskDelete(), which would
+   free its stack.  Times are in ticks; the default is to wait forever.
+ */
+
+#ifndef RTOS_H
+#define RTOS_H
+
+extern "C" {
+#include <FreeRTOS.h>
+#include <queue.h>
+#include <semphr.h>
+#include <task.h>
+}
+
+template <class T, unsigned portBASE_TYPE N>
+class Queue
+{
+public:
+  Queue()
+  {
+    _handle = xQueueGenericCreateStatic(N, sizeof(T), _storage.bytes, &_queue,
+                                        queueQUEUE_TYPE_BASE) ;
+  }
+
+  bool send(const T &item, portTickType ticks = portMAX_DELAY)
+  {
+    return xQueueGenericSend(_handle, &item, ticks, queueSEND_TO_BACK) == pdPASS ;
+  }
+
+  bool sendToFront(const T &item, portTickType ticks = portMAX_DELAY)
+  {
+    return xQueueGenericSend(_handle, &item, ticks, queueSEND_TO_FRONT) == pdPASS ;
+  }
+
+  bool receive(T &item, portTickType ticks = portMAX_DELAY)
+  {
+    return xQueueGenericReceive(_handle, &item, ticks, pdFALSE) == pdPASS ;
+  }
+
+  bool peek(T &item, portTickType ticks = portMAX_DELAY)
+  {
+    return xQueueGenericReceive(_handle, &item, ticks, pdTRUE) == pdPASS ;
+  }
+
+  // From interrupts; *woken is set if a task of higher priority was woken.
+  bool sendFromISR(const T &item, signed portBASE_TYPE *woken)
+  {
+    return xQueueGenericSendFromISR(_handle, &item, woken, queueSEND_TO_BACK) == pdPASS ;
+  }
+
+  bool receiveFromISR(T &item, signed portBASE_TYPE *woken)
+  {
+    return xQueueReceiveFromISR(_handle, &item, woken) == pdPASS ;
+  }
+
+  unsigned portBASE_TYPE waiting(void) const
+  {
+    return uxQueueMessagesWaiting(_handle) ;
+  }
+
+  unsigned portBASE_TYPE spaces(void) const
+  {
+    return N - uxQueueMessagesWaiting(_handle) ;
+  }
+
+  xQueueHandle handle(void) const { return _handle ; }
+
+private:
+  Queue(const Queue &) ;
+  Queue &operator=(const Queue &) ;
+
+  xQueueHandle _handle ;
+  xStaticQueue _queue ;
+  // aligned for T; the queue uses one byte more than it holds
+  union
+  {
+    T items[N] ;
+    unsigned char bytes[N * sizeof(T) + 1] ;
+  } _storage ;
+} ;
+
+// A counting semaphore: a binary one by default, created empty.
+class Semaphore
+{
+public:
+  Semaphore(unsigned portBASE_TYPE maxCount = 1, unsigned portBASE_TYPE initialCount = 0)
+  {
+    _handle = xQueueGenericCreateStatic(maxCount, 0, NULL, &_queue,
+                                        maxCount == 1 ? queueQUEUE_TYPE_BINARY_SEMAPHORE
+                                                      : queueQUEUE_TYPE_COUNTING_SEMAPHORE) ;
+    while (initialCount--) {
+      give() ;
+    }
+  }
+
+  bool take(portTickType ticks = portMAX_DELAY)
+  {
+    return xSemaphoreTake(_handle, ticks) == pdPASS ;
+  }
+
+  bool give(void)
+  {
+    return xSemaphoreGive(_handle) == pdPASS ;
+  }
+
+  bool giveFromISR(signed portBASE_TYPE *woken)
+  {
+    return xSemaphoreGiveFromISR(_handle, woken) == pdPASS ;
+  }
+
+  unsigned portBASE_TYPE count(void) const
+  {
+    return uxQueueMessagesWaiting(_handle) ;
+  }
+
+  xSemaphoreHandle handle(void) const { return _handle ; }
+
+private:
+  Semaphore(const Semaphore &) ;
+  Semaphore &operator=(const Semaphore &) ;
+
+  xSemaphoreHandle _handle ;
+  xStaticQueue _queue ;
+} ;
+
+// A mutex with priority inheritance, created free.  Not for interrupts.
+class Mutex
+{
+public:
+  Mutex()
+  {
+    _handle = xQueueCreateMutexStatic(queueQUEUE_TYPE_MUTEX, &_queue) ;
+  }
+
+  bool take(portTickType ticks = portMAX_DELAY)
+  {
+    return xSemaphoreTake(_handle, ticks) == pdPASS ;
+  }
+
+  bool give(void)
+  {
+    return xSemaphoreGive(_handle) == pdPASS ;
+  }
+
+  xSemaphoreHandle handle(void) const { return _handle ; }
+
+private:
+  Mutex(const Mutex &) ;
+  Mutex &operator=(const Mutex &) ;
+
+  xSemaphoreHandle _handle ;
+  xStaticQueue _queue ;
+} ;
+
+// Holds a mutex for the scope it is declared in.
+class MutexLock
+{
+public:
+  explicit MutexLock(Mutex &mutex) : _mutex(mutex) { _mutex.take() ; }
+  ~MutexLock() { _mutex.give() ; }
+
+private:
+  MutexLock(const MutexLock &) ;
+  MutexLock &operator=(const MutexLock &) ;
+
+  Mutex &_mutex ;
+} ;
+
+template <unsigned short StackWords>
+class Task
+{
+public:
+  Task() : _handle(NULL) {}
+
+  bool create(pdTASK_CODE code, const char *name, unsigned portBASE_TYPE priority,
+              void *parameters = NULL)
+  {
+    return xTaskGenericCreate(code, (const signed char *) name, StackWords,
+                              parameters, priority, &_handle, _stack, NULL) == pdPASS ;
+  }
+
+  xTaskHandle handle(void) const { return _handle ; }
+
+private:
+  Task(const Task &) ;
+  Task &operator=(const Task &) ;
+
+  xTaskHandle _handle ;
+  portSTACK_TYPE _stack[StackWords] __attribute__((aligned(portBYTE_ALIGNMENT))) ;
+} ;
+
+#endif
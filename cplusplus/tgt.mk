@@ -3,5 +3,7 @@ libs += cplusplus
 
 cplusplus_path := $(CPLUSPLUS)
 cplusplus_objs := new.o
-cplusplus_cflags := -I$(CPLUSPLUS)
+cplusplus_cflags := -I$(CPLUSPLUS) \
+	-I$(FREERTOS)/include \
+	-I$(FREERTOS_PORT)
 
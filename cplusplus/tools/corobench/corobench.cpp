@@ -0,0 +1,428 @@
+//------------------------------------------------------------------------------
+// Coroutine benchmark: the RAM and the switch cost of the coroutines of coro.h.
+//
+// SESSIONS coroutines run the loop of a protocol session: receive a request
+// from a shared AsyncQueue, start a transfer that completes through a
+// Completion, and wait a tick. The frame bytes per session are reported
+// next to a task of rtos-ex-serial, with its 400 words of stack and its TCB.
+// The coroutines all share the stack of the executor task.
+//
+// The switch costs are the time to go from one coroutine to the next
+// through co_await yield(), through a pair of AsyncQueues (ping-pong), and
+// from a Completion called back from an interrupt. For reference, the last
+// line is a send and receive pair on a kernel queue, which a task handoff
+// does on top of its context switch; the context switch itself (PendSV and
+// vTaskSwitchContext()) does not run on the host.
+//
+// First, delays, timeouts, queue waits from both sides, completions and
+// awaited coroutines are checked, and all frames must be freed at the end.
+// The frames come from the operator new of new.cpp, as on the target.
+//
+// The times are in ns on the host, and host frames hold 8 byte pointers:
+// the frames of the target are smaller, and the smallest fit the pools of
+// new.cpp, while on the host they all exceed NEW_POOL_MAX and go to the heap.
+//
+//   ./corobench
+//------------------------------------------------------------------------------
+
+#include <coro.h>
+#include <new.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Switches per test.
+#define ITERATIONS      2000000
+
+/// Sessions, and the requests they serve.
+#define SESSIONS        32
+#define REQUESTS        (SESSIONS * 100)
+
+/// A task of rtos-ex-serial: 400 words of stack, and the tskTCB of the
+/// target's FreeRTOSConfig.h (MPU guard, trace, mutexes and run time stats).
+#define TASK_STACK      (400 * 4)
+#define TASK_TCB        112
+
+struct Request {
+    uint32_t id;
+    uint32_t length;
+};
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+static unsigned int errors;
+
+/// The tick count of the host, which the benchmark advances.
+static portTickType ticks;
+
+static Executor executor;
+
+static AsyncQueue<Request, 4> requests;
+static AsyncQueue<uint32_t, 2> ping;
+static AsyncQueue<uint32_t, 2> pong;
+
+/// Transfers in progress, completed by Complete().
+static Completion *transfers[SESSIONS];
+static unsigned int transferCount;
+
+static unsigned int served;
+static unsigned int order[3];
+static unsigned int orderCount;
+
+//------------------------------------------------------------------------------
+//         Local functions
+//------------------------------------------------------------------------------
+
+extern "C" portTickType xTaskGetTickCount(void)
+{
+    return ticks;
+}
+
+/// Host time in ns.
+static unsigned long long GetTime(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static void Report(const char *label, unsigned long long start,
+                   unsigned int count)
+{
+    printf("%-30s %7.2f ns\n", label, (double) (GetTime() - start) / count);
+}
+
+static void Error(const char *message)
+{
+    printf("%s\n", message);
+    errors++;
+}
+
+/// Completes the transfers in progress, as the interrupt of a driver would.
+static void Complete(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < transferCount; i++) {
+
+        Completion::callback(transfers[i], 0, 64, 0);
+    }
+    transferCount = 0;
+}
+
+static Coroutine Sleeper(portTickType delayTicks, unsigned int id)
+{
+    co_await delay(delayTicks);
+    order[orderCount++] = id;
+}
+
+static Coroutine Add(uint32_t *pValue, uint32_t addend)
+{
+    co_await yield();
+    *pValue += addend;
+}
+
+static Coroutine Checker(bool *pDone)
+{
+    Request request;
+    Completion done;
+    uint32_t value = 1;
+    portTickType start = ticks;
+
+    // nothing comes: the receive times out after 5 ticks
+    if (co_await requests.receive(request, 5)) {
+
+        Error("AsyncQueue: received from an empty queue");
+    }
+    if (ticks - start != 5) {
+
+        Error("AsyncQueue: timeout after the wrong ticks");
+    }
+
+    // a task, then an interrupt, send while the coroutine waits
+    if (!co_await requests.receive(request) || request.id != 1) {
+
+        Error("AsyncQueue: item from a task not received");
+    }
+    if (!co_await requests.receive(request, 100) || request.id != 2) {
+
+        Error("AsyncQueue: item from an interrupt not received");
+    }
+
+    // a completion before, then after, the co_await
+    Completion::callback(&done, 3, 10, 0);
+    if (co_await done != 3 || done.transferred != 10) {
+
+        Error("Completion: early callback lost");
+    }
+    done.reset();
+    transfers[transferCount++] = &done;
+    if (co_await done != 0 || done.transferred != 64) {
+
+        Error("Completion: callback from an interrupt lost");
+    }
+
+    // awaited coroutines run to their end first
+    if (!co_await Add(&value, 2) || !co_await Add(&value, 3) || value != 6) {
+
+        Error("Coroutine: awaited coroutine did not run");
+    }
+    *pDone = true;
+}
+
+/// Fills a queue of two beyond its room, then takes the items back.
+static Coroutine Producer(unsigned int count)
+{
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+
+        co_await ping.send(i);
+    }
+}
+
+static Coroutine Consumer(unsigned int count, bool *pDone)
+{
+    uint32_t i;
+    uint32_t value;
+
+    for (i = 0; i < count; i++) {
+
+        if (!co_await ping.receive(value) || value != i) {
+
+            Error("AsyncQueue: items out of order between coroutines");
+            break;
+        }
+    }
+    *pDone = true;
+}
+
+static void Check(void)
+{
+    bool checked = false;
+    bool consumed = false;
+    Request request;
+    signed portBASE_TYPE woken = pdFALSE;
+    NewPoolStats pools;
+    unsigned int i;
+
+    // timers fire in the order of their ticks
+    executor.spawn(Sleeper(3, 3));
+    executor.spawn(Sleeper(1, 1));
+    executor.spawn(Sleeper(2, 2));
+    for (i = 0; i < 4; i++) {
+
+        executor.poll();
+        ticks++;
+    }
+    if (orderCount != 3 || order[0] != 1 || order[1] != 2 || order[2] != 3) {
+
+        Error("delay(): timers out of order");
+    }
+
+    executor.spawn(Checker(&checked));
+    for (i = 0; i < 6; i++) {
+
+        executor.poll();
+        ticks++;
+    }
+    request.id = 1;
+    requests.sendFromTask(request, 0);
+    executor.poll();
+    request.id = 2;
+    requests.sendFromISR(request, &woken);
+    executor.poll();
+    Complete();
+    executor.poll();
+    if (!checked) {
+
+        Error("Checker: did not finish");
+    }
+
+    executor.spawn(Producer(10));
+    executor.spawn(Consumer(10, &consumed));
+    executor.poll();
+    if (!consumed) {
+
+        Error("Consumer: did not finish");
+    }
+    if (coroutineStats.frames != 0) {
+
+        Error("Coroutine: frames left allocated");
+    }
+    newPoolStats(&pools);
+    if (pools.heapAllocations + pools.pagesUsed == 0) {
+
+        Error("new.cpp: frames not allocated by its operator new");
+    }
+    if (pools.bytesInUse != 0) {
+
+        Error("new.cpp: pool blocks left allocated");
+    }
+}
+
+static Coroutine Session(void)
+{
+    Request request;
+    Completion done;
+
+    while (co_await requests.receive(request)) {
+
+        done.reset();
+        transfers[transferCount++] = &done;
+        co_await done;
+        co_await delay(1);
+        served++;
+    }
+}
+
+static void RunSessions(void)
+{
+    Request request;
+    unsigned int sent = 0;
+    unsigned int i;
+    size_t bytes;
+    unsigned long long start;
+    NewPoolStats before;
+    NewPoolStats after;
+
+    newPoolStats(&before);
+    for (i = 0; i < SESSIONS; i++) {
+
+        executor.spawn(Session());
+    }
+    executor.poll();
+    newPoolStats(&after);
+    bytes = coroutineStats.bytes / SESSIONS;
+    printf("%u sessions: %zu bytes of frame each, a task %u bytes (%.0fx)\n",
+           SESSIONS, bytes, TASK_STACK + TASK_TCB,
+           (double) (TASK_STACK + TASK_TCB) / bytes);
+    printf("new.cpp: %zu frames from the heap, %zu bytes from the pools\n",
+           after.heapAllocations - before.heapAllocations,
+           after.bytesInUse - before.bytesInUse);
+
+    start = GetTime();
+    while (served < REQUESTS) {
+
+        while (sent < REQUESTS && requests.waiting() < 4) {
+
+            request.id = sent++;
+            requests.sendFromTask(request, 0);
+            executor.poll();
+        }
+        Complete();
+        executor.poll();
+        ticks++;
+        executor.poll();
+    }
+    Report("session request", start, REQUESTS);
+}
+
+static Coroutine Yielder(unsigned int count)
+{
+    unsigned int i;
+
+    for (i = 0; i < count; i++) {
+
+        co_await yield();
+    }
+}
+
+static Coroutine Pinger(unsigned int count)
+{
+    uint32_t i;
+    uint32_t value;
+
+    for (i = 0; i < count; i++) {
+
+        co_await ping.send(i);
+        co_await pong.receive(value);
+    }
+}
+
+static Coroutine Ponger(unsigned int count)
+{
+    uint32_t i;
+    uint32_t value;
+
+    for (i = 0; i < count; i++) {
+
+        co_await ping.receive(value);
+        co_await pong.send(value);
+    }
+}
+
+static Coroutine Transfers(unsigned int count, Completion *pDone)
+{
+    unsigned int i;
+
+    for (i = 0; i < count; i++) {
+
+        pDone->reset();
+        co_await *pDone;
+    }
+}
+
+static void RunSwitches(void)
+{
+    Completion done;
+    xQueueHandle raw = xQueueCreate(2, sizeof(uint32_t));
+    uint32_t value = 0;
+    unsigned long long start;
+    unsigned int i;
+
+    executor.spawn(Yielder(ITERATIONS / 2));
+    executor.spawn(Yielder(ITERATIONS / 2));
+    start = GetTime();
+    executor.poll();
+    Report("yield()", start, ITERATIONS);
+
+    // two switches per round trip
+    executor.spawn(Pinger(ITERATIONS / 2));
+    executor.spawn(Ponger(ITERATIONS / 2));
+    start = GetTime();
+    executor.poll();
+    Report("AsyncQueue ping-pong", start, ITERATIONS);
+
+    executor.spawn(Transfers(ITERATIONS, &done));
+    executor.poll();
+    start = GetTime();
+    for (i = 0; i < ITERATIONS; i++) {
+
+        Completion::callback(&done, 0, 0, 0);
+        executor.poll();
+    }
+    Report("Completion from an interrupt", start, ITERATIONS);
+
+    start = GetTime();
+    for (i = 0; i < ITERATIONS; i++) {
+
+        xQueueSend(raw, &value, 0);
+        xQueueReceive(raw, &value, 0);
+    }
+    Report("kernel queue send and receive", start, ITERATIONS);
+    vQueueDelete(raw);
+}
+
+//------------------------------------------------------------------------------
+//         Main function
+//------------------------------------------------------------------------------
+
+int main(void)
+{
+    Check();
+    printf("coro.h, %u errors\n", errors);
+
+    RunSessions();
+    RunSwitches();
+
+    return errors ? 1 : 0;
+}
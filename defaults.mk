@@ -7,6 +7,8 @@ BOARD := at91sam3u-ek
 
 AT91LIB  := $(TOP)/at91lib
 TRACE_LEVEL := 4
+TRACE_DEFERRED := 0
+STACK_GUARD := 1
 FREERTOS := $(TOP)/freertos
 FREERTOS_PORT := $(FREERTOS)/portable/GCC/ARM_CM3
 CMSIS := $(TOP)/cmsis
@@ -0,0 +1,63 @@
+/*
+ * Task running the deferred interrupt work of at91lib, see defer_task.h.
+ */
+
+#include "defer_task.h"
+#include "semphr.h"
+
+/*-----------------------------------------------------------*/
+
+/* Given when work is scheduled. */
+static xSemaphoreHandle xDeferWake = NULL;
+
+/*-----------------------------------------------------------*/
+
+/* Wake up function of the deferred work, invoked by DEFER_Schedule(). */
+static void prvWakeUp( void )
+{
+portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+	if( portIS_INSIDE_INTERRUPT() != pdFALSE )
+	{
+		xSemaphoreGiveFromISR( xDeferWake, &xHigherPriorityTaskWoken );
+		portEND_SWITCHING_ISR( xHigherPriorityTaskWoken );
+	}
+	else
+	{
+		xSemaphoreGive( xDeferWake );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvDeferTask( void *pvParameters )
+{
+	( void ) pvParameters;
+
+	for( ;; )
+	{
+		/* Work scheduled while DEFER_Run() runs is run by the same call, the
+		semaphore then only causes one extra empty pass. */
+		xSemaphoreTake( xDeferWake, portMAX_DELAY );
+		DEFER_Run();
+	}
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Creates the task running the deferred work.  Work scheduled before it is
+ * created runs when the scheduler starts.  Returns pdPASS, or
+ * errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY.
+ */
+portBASE_TYPE xDeferTaskCreate( unsigned short usStackDepth, unsigned portBASE_TYPE uxPriority, xTaskHandle *pxCreatedTask )
+{
+	/* The semaphore is created given, so the task makes a first pass. */
+	vSemaphoreCreateBinary( xDeferWake );
+	if( xDeferWake == NULL )
+	{
+		return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+	}
+
+	DEFER_SetWakeUp( prvWakeUp );
+
+	return xTaskCreate( prvDeferTask, ( const signed char * ) "defer", usStackDepth, NULL, uxPriority, pxCreatedTask );
+}
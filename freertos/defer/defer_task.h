@@ -0,0 +1,36 @@
+/*
+ * Task running the deferred interrupt work of at91lib (utility/defer.h).
+ *
+ * The interrupt handlers split with USBD_DEFERRED or MCI_DEFERRED only
+ * acknowledge their peripheral and schedule a bottom half; the task created
+ * by xDeferTaskCreate() then runs it.  DEFER_Schedule() wakes the task
+ * through a binary semaphore, given from the interrupt with
+ * xSemaphoreGiveFromISR(), so the bottom half runs as soon as the interrupt
+ * returns if the task has the highest ready priority.
+ *
+ * The task priority must be above that of the tasks calling the drivers
+ * whose work it runs, which see the bottom halves as they used to see the
+ * interrupt handlers.  The interrupts scheduling work must have a priority
+ * at or below configMAX_SYSCALL_INTERRUPT_PRIORITY.  DEFER_Run() must not be
+ * called elsewhere once the task is created.
+ */
+
+#ifndef DEFER_TASK_H
+#define DEFER_TASK_H
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <utility/defer.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+portBASE_TYPE xDeferTaskCreate( unsigned short usStackDepth, unsigned portBASE_TYPE uxPriority, xTaskHandle *pxCreatedTask );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DEFER_TASK_H */
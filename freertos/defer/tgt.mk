@@ -0,0 +1,12 @@
+
+libs += freertos_defer
+freertos_defer_path := $(FREERTOS)/defer
+freertos_defer_objs := defer_task.o
+freertos_defer_cflags := \
+	-I$(FREERTOS)/defer \
+	-I$(FREERTOS)/include \
+	-I$(FREERTOS_PORT) \
+	-I$(AT91LIB) \
+	-I$(AT91LIB)/peripherals \
+	-I$(AT91LIB)/boards/$(BOARD) \
+	-I$(TOP)
@@ -164,6 +164,10 @@ typedef portBASE_TYPE (*pdTASK_HOOK_CODE)( void * );
 	#define configUSE_COUNTING_SEMAPHORES 0
 #endif
 
+#ifndef configQUEUE_COPY_BY_SIZE
+	#define configQUEUE_COPY_BY_SIZE 1
+#endif
+
 #ifndef configUSE_ALTERNATIVE_API
 	#define configUSE_ALTERNATIVE_API 0
 #endif
@@ -272,6 +276,17 @@ typedef portBASE_TYPE (*pdTASK_HOOK_CODE)( void * );
 	#define traceTASK_SWITCHED_OUT()
 #endif
 
+#ifndef traceISR_ENTER
+	/* Called on entry to an interrupt handler that wishes to have its execution
+	time accounted for separately from the task it interrupted. */
+	#define traceISR_ENTER()
+#endif
+
+#ifndef traceISR_EXIT
+	/* Called on exit from an interrupt handler that called traceISR_ENTER(). */
+	#define traceISR_EXIT()
+#endif
+
 #ifndef traceTASK_PRIORITY_INHERIT
 	/* Called when a task attempts to take a mutex that is already held by a
 	lower priority task.  pxTCBOfMutexHolder is a pointer to the TCB of the task
@@ -473,10 +488,27 @@ typedef portBASE_TYPE (*pdTASK_HOOK_CODE)( void * );
 	#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
 #endif
 
+#ifndef portRUN_TIME_COUNTER_TYPE
+	/* The type used to hold run time counter values.  Ports that extend a
+	hardware counter beyond 32 bits can define this as unsigned long long. */
+	#define portRUN_TIME_COUNTER_TYPE unsigned long
+#endif
+
+#ifndef portGET_RUN_TIME_ISR_COUNTER_VALUE
+	/* Returns the accumulated run time spent in instrumented interrupts (see
+	traceISR_ENTER() and traceISR_EXIT()).  That time is not charged to the
+	task that was interrupted. */
+	#define portGET_RUN_TIME_ISR_COUNTER_VALUE() 0
+#endif
+
 #ifndef configUSE_MALLOC_FAILED_HOOK
 	#define configUSE_MALLOC_FAILED_HOOK 0
 #endif
 
+#ifndef portUSING_MPU_STACK_GUARD
+	#define portUSING_MPU_STACK_GUARD 0
+#endif
+
 #ifndef portPRIVILEGE_BIT
 	#define portPRIVILEGE_BIT ( ( unsigned portBASE_TYPE ) 0x00 )
 #endif
@@ -485,6 +517,12 @@ typedef portBASE_TYPE (*pdTASK_HOOK_CODE)( void * );
 	#define portYIELD_WITHIN_API portYIELD
 #endif
 
+#ifndef portIS_INSIDE_INTERRUPT
+	/* Ports that cannot tell report task context, so callers take the task
+	path of the API. */
+	#define portIS_INSIDE_INTERRUPT() pdFALSE
+#endif
+
 #ifndef pvPortMallocAligned
 	#define pvPortMallocAligned( x, puxStackBuffer ) ( ( ( puxStackBuffer ) == NULL ) ? ( pvPortMalloc( ( x ) ) ) : ( puxStackBuffer ) )
 #endif
@@ -493,5 +531,24 @@ typedef portBASE_TYPE (*pdTASK_HOOK_CODE)( void * );
 	#define vPortFreeAligned( pvBlockToFree ) vPortFree( pvBlockToFree )
 #endif
 
+#include "list.h"
+
+/*
+ * Memory for a queue structure, given to xQueueGenericCreateStatic() or
+ * xQueueCreateMutexStatic() so that the queue is not allocated from the heap.
+ * It has the size and alignment of the structure used within queue.c, whose
+ * members are kept private; queue.c checks that the two agree.
+ */
+typedef struct xSTATIC_QUEUE
+{
+	void *pvDummy1[ 4 ];
+	xList xDummy2[ 2 ];
+	unsigned portBASE_TYPE uxDummy3[ 3 ];
+	signed portBASE_TYPE xDummy4[ 2 ];
+	#if ( configUSE_TRACE_FACILITY == 1 )
+		unsigned char ucDummy5[ 2 ];
+	#endif
+} xStaticQueue;
+
 #endif /* INC_FREERTOS_H */
 
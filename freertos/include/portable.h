@@ -382,6 +382,43 @@ void vPortEndScheduler( void ) PRIVILEGED_FUNCTION;
 	void vPortStoreTaskMPUSettings( xMPU_SETTINGS *xMPUSettings, const struct xMEMORY_REGION * const xRegions, portSTACK_TYPE *pxBottomOfStack, unsigned short usStackDepth ) PRIVILEGED_FUNCTION;
 #endif
 
+/*
+ * Fills the xStackGuard structure with the MPU region that guards the bottom
+ * of a task's stack.  Up to 2 * portSTACK_GUARD_SIZE - portBYTE_ALIGNMENT
+ * bytes at the bottom of the stack become unusable.
+ */
+#if( portUSING_MPU_STACK_GUARD == 1 )
+	void vPortStoreTaskStackGuard( xMPU_STACK_GUARD *pxStackGuard, portSTACK_TYPE *pxBottomOfStack ) PRIVILEGED_FUNCTION;
+#endif
+
+/*
+ * Stack profile of all the tasks and of the main (interrupt) stack.  See
+ * portable/Common/stack_profile.c.  vPortStackProfileInit() must be called
+ * at the start of main(), before the scheduler is started.
+ * vPortStackProfileReport() passes the report to pxWriteLine() one line at a
+ * time, each line overwriting the previous one.
+ */
+#if( INCLUDE_uxTaskGetStackHighWaterMark == 1 )
+	void vPortStackProfileInit( void ) PRIVILEGED_FUNCTION;
+	unsigned long ulPortGetMainStackSize( void ) PRIVILEGED_FUNCTION;
+	unsigned long ulPortGetMainStackHighWaterMark( void ) PRIVILEGED_FUNCTION;
+	void vPortStackProfileReport( void ( *pxWriteLine )( const signed char *pcLine ) ) PRIVILEGED_FUNCTION;
+#endif
+
+/*
+ * Cycle counter used as the run time statistics time base.  The hardware
+ * counter is extended to 64 bits in software, so it must be read at least
+ * once per hardware counter period; the tick interrupt does this through
+ * traceISR_ENTER().  See portable/Common/run_time_stats.c.
+ */
+#if( configGENERATE_RUN_TIME_STATS == 1 )
+	void vPortRunTimeCounterInit( void ) PRIVILEGED_FUNCTION;
+	unsigned long long ullPortGetRunTimeCounterValue( void ) PRIVILEGED_FUNCTION;
+	unsigned long long ullPortGetRunTimeISRCounterValue( void ) PRIVILEGED_FUNCTION;
+	void vPortRunTimeISREnter( void ) PRIVILEGED_FUNCTION;
+	void vPortRunTimeISRExit( void ) PRIVILEGED_FUNCTION;
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -1264,6 +1264,17 @@ portBASE_TYPE xQueueGiveMutexRecursive( xQueueHandle pxMutex );
  */
 xQueueHandle xQueueGenericCreate( unsigned portBASE_TYPE uxQueueLength, unsigned portBASE_TYPE uxItemSize, unsigned char ucQueueType );
 
+/*
+ * Versions of xQueueGenericCreate() and xQueueCreateMutex() that use the
+ * memory they are given instead of allocating it.  pucQueueStorage must hold
+ * ( uxQueueLength * uxItemSize ) + 1 bytes, and is not used when uxItemSize
+ * is 0.  The memory must stay valid for as long as the queue is used, and
+ * such a queue must not be passed to vQueueDelete().  The typed C++ wrappers
+ * in rtos.h allocate both at compile time.
+ */
+xQueueHandle xQueueGenericCreateStatic( unsigned portBASE_TYPE uxQueueLength, unsigned portBASE_TYPE uxItemSize, unsigned char *pucQueueStorage, xStaticQueue *pxStaticQueue, unsigned char ucQueueType );
+xQueueHandle xQueueCreateMutexStatic( unsigned char ucQueueType, xStaticQueue *pxStaticQueue );
+
 /* 
  * Not a public API function, hence the 'Restricted' in the name. 
  */
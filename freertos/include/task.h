@@ -117,6 +117,44 @@ typedef struct xTASK_PARAMTERS
 	xMemoryRegion xRegions[ portNUM_CONFIGURABLE_REGIONS ];
 } xTaskParameters;
 
+/*
+ * Run time figures for a single task, as returned by uxTaskGetRunTimeStatus().
+ * Times are in units of the run time counter.
+ */
+typedef struct xTASK_RUN_TIME_STATUS
+{
+	xTaskHandle xHandle;
+	const signed char *pcTaskName;
+	unsigned portBASE_TYPE uxPriority;
+	portRUN_TIME_COUNTER_TYPE ulRunTimeCounter;	/*< Total time the task has run for. */
+	portRUN_TIME_COUNTER_TYPE ulLongestRunTime;	/*< Longest time the task has run for before another task was selected. */
+	unsigned long ulSwitchInCount;				/*< Number of times the task has been switched in. */
+	unsigned long ulPermille;					/*< Share of the total run time, in tenths of a percent. */
+} xTaskRunTimeStatus;
+
+/*
+ * System wide run time figures, as returned by uxTaskGetRunTimeStatus().
+ */
+typedef struct xSYSTEM_RUN_TIME_STATUS
+{
+	portRUN_TIME_COUNTER_TYPE ulTotalRunTime;	/*< Run time counter value when the figures were taken. */
+	portRUN_TIME_COUNTER_TYPE ulISRRunTime;		/*< Time spent in interrupts that use traceISR_ENTER()/traceISR_EXIT(). */
+	unsigned long ulContextSwitchCount;			/*< Number of times a different task has been selected to run. */
+	unsigned long ulISRPermille;				/*< Share of the total run time spent in interrupts, in tenths of a percent. */
+} xSystemRunTimeStatus;
+
+/*
+ * Stack figures for a single task, as returned by uxTaskGetStackStatus().
+ * Sizes are in words, as passed to xTaskCreate().
+ */
+typedef struct xTASK_STACK_STATUS
+{
+	xTaskHandle xHandle;
+	const signed char *pcTaskName;
+	unsigned short usStackDepth;		/*< The size of the stack. */
+	unsigned short usHighWaterMark;		/*< The amount of stack that has never been used. */
+} xTaskStackStatus;
+
 /*
  * Defines the priority used by the idle task.  This must not be modified.
  *
@@ -1071,6 +1109,38 @@ void vTaskList( signed char *pcWriteBuffer ) PRIVILEGED_FUNCTION;
  */
 void vTaskGetRunTimeStats( signed char *pcWriteBuffer ) PRIVILEGED_FUNCTION;
 
+/**
+ * task. h
+ * <PRE>unsigned portBASE_TYPE uxTaskGetRunTimeStatus( xTaskRunTimeStatus *pxTaskStatusArray, unsigned portBASE_TYPE uxArraySize, xSystemRunTimeStatus *pxSystemStatus );</PRE>
+ *
+ * configGENERATE_RUN_TIME_STATS must be defined as 1 for this function
+ * to be available.
+ *
+ * Binary equivalent of vTaskGetRunTimeStats().  For each task the total run
+ * time, share of the CPU, number of times the task was switched in and the
+ * longest time the task ran for before another task was selected are copied
+ * into pxTaskStatusArray.  Time spent in interrupts that are bracketed with
+ * traceISR_ENTER() and traceISR_EXIT() is reported separately in
+ * pxSystemStatus rather than being charged to the interrupted task.
+ *
+ * The scheduler is suspended, but interrupts are left enabled, while the
+ * figures are copied.
+ *
+ * @param pxTaskStatusArray Array into which the per task figures are written.
+ *
+ * @param uxArraySize The number of entries in pxTaskStatusArray.  Tasks that
+ * do not fit are not reported.
+ *
+ * @param pxSystemStatus Structure into which the system wide figures are
+ * written.  Can be NULL.
+ *
+ * @return The number of entries written to pxTaskStatusArray.
+ *
+ * \page uxTaskGetRunTimeStatus uxTaskGetRunTimeStatus
+ * \ingroup TaskUtils
+ */
+unsigned portBASE_TYPE uxTaskGetRunTimeStatus( xTaskRunTimeStatus *pxTaskStatusArray, unsigned portBASE_TYPE uxArraySize, xSystemRunTimeStatus *pxSystemStatus ) PRIVILEGED_FUNCTION;
+
 /**
  * task. h
  * <PRE>void vTaskStartTrace( char * pcBuffer, unsigned portBASE_TYPE uxBufferSize );</PRE>
@@ -1125,6 +1195,31 @@ unsigned long ulTaskEndTrace( void ) PRIVILEGED_FUNCTION;
  */
 unsigned portBASE_TYPE uxTaskGetStackHighWaterMark( xTaskHandle xTask ) PRIVILEGED_FUNCTION;
 
+/**
+ * task.h
+ * <PRE>unsigned portBASE_TYPE uxTaskGetStackStatus( xTaskStackStatus *pxTaskStatusArray, unsigned portBASE_TYPE uxArraySize );</PRE>
+ *
+ * INCLUDE_uxTaskGetStackHighWaterMark must be set to 1 in FreeRTOSConfig.h for
+ * this function to be available.
+ *
+ * Returns the stack size and high water mark of every task in one call, as
+ * used by the stack profile report in portable/Common/stack_profile.c.  The
+ * scheduler is suspended, but interrupts are left enabled, while the stacks
+ * are scanned.  Tasks that have been deleted but not yet freed by the idle
+ * task are not reported.
+ *
+ * @param pxTaskStatusArray Array into which the per task figures are written.
+ *
+ * @param uxArraySize The number of entries in pxTaskStatusArray.  Tasks that
+ * do not fit are not reported.
+ *
+ * @return The number of entries written to pxTaskStatusArray.
+ *
+ * \page uxTaskGetStackStatus uxTaskGetStackStatus
+ * \ingroup TaskUtils
+ */
+unsigned portBASE_TYPE uxTaskGetStackStatus( xTaskStackStatus *pxTaskStatusArray, unsigned portBASE_TYPE uxArraySize ) PRIVILEGED_FUNCTION;
+
 /* When using trace macros it is sometimes necessary to include tasks.h before
 FreeRTOS.h.  When this is done pdTASK_HOOK_CODE will not yet have been defined,
 so the following two prototypes will cause a compilation error.  This can be
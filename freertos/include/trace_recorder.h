@@ -0,0 +1,200 @@
+/*
+ * Binary kernel event trace recorder.
+ *
+ * When configUSE_TRACE_RECORDER is set to 1 in FreeRTOSConfig.h this header
+ * is included from there and maps the kernel trace macros onto the recorder.
+ * Each event is stored as a fixed size 8 byte record in a RAM ring buffer
+ * using a single atomic increment to claim a slot, so events can be recorded
+ * from tasks, from interrupts and from within the kernel's critical sections
+ * without taking a lock.  The buffer runs as a flight recorder - old events
+ * are overwritten when it fills - and is drained with ulTraceRecorderDrain(),
+ * typically from a low priority task writing to the DBGU or a USB CDC port.
+ *
+ * tools/tracedecode.py turns the drained byte stream into a Chrome trace
+ * (chrome://tracing) timeline.
+ *
+ * This header is included by FreeRTOSConfig.h so it must not include any
+ * other kernel header.
+ */
+
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The number of events held by the ring buffer.  Must be a power of two.  Each
+event takes 8 bytes of RAM. */
+#ifndef configTRACE_RECORDER_BUFFER_EVENTS
+	#define configTRACE_RECORDER_BUFFER_EVENTS	256
+#endif
+
+#if ( ( configTRACE_RECORDER_BUFFER_EVENTS & ( configTRACE_RECORDER_BUFFER_EVENTS - 1 ) ) != 0 )
+	#error configTRACE_RECORDER_BUFFER_EVENTS must be a power of two.
+#endif
+
+/* Event codes.  These are part of the stream format, see tools/tracedecode.py. */
+#define trcEVT_TASK_SWITCHED_IN			( 0x01U )
+#define trcEVT_TASK_CREATE				( 0x02U )
+#define trcEVT_TASK_DELETE				( 0x03U )
+#define trcEVT_TASK_DELAY				( 0x04U )
+#define trcEVT_TASK_DELAY_UNTIL			( 0x05U )
+#define trcEVT_TASK_SUSPEND				( 0x06U )
+#define trcEVT_TASK_RESUME				( 0x07U )
+#define trcEVT_ISR_ENTER				( 0x10U )
+#define trcEVT_ISR_EXIT					( 0x11U )
+#define trcEVT_QUEUE_CREATE				( 0x20U )
+#define trcEVT_QUEUE_SEND				( 0x21U )
+#define trcEVT_QUEUE_SEND_FAILED		( 0x22U )
+#define trcEVT_QUEUE_RECEIVE			( 0x23U )
+#define trcEVT_QUEUE_RECEIVE_FAILED		( 0x24U )
+#define trcEVT_QUEUE_PEEK				( 0x25U )
+#define trcEVT_QUEUE_SEND_FROM_ISR		( 0x26U )
+#define trcEVT_QUEUE_RECEIVE_FROM_ISR	( 0x27U )
+#define trcEVT_BLOCKING_ON_QUEUE_SEND	( 0x28U )
+#define trcEVT_BLOCKING_ON_QUEUE_RECEIVE ( 0x29U )
+#define trcEVT_QUEUE_DELETE				( 0x2aU )
+#define trcEVT_USER						( 0x80U )
+
+/* A single recorded event.  ucTask is the task that was running when the event
+was recorded (or the subject task for task events).  usObject identifies the
+queue, the exception number for interrupt events, or is user defined. */
+typedef struct xTRACE_EVENT
+{
+	unsigned long ulTimestamp;
+	unsigned char ucEvent;
+	unsigned char ucTask;
+	unsigned short usObject;
+} xTraceEvent;
+
+/* Called to write drained trace data.  Must not return until the data has been
+consumed, as the same buffer is reused for the next chunk. */
+typedef void ( *pdTRACE_WRITE_FUNCTION )( const unsigned char *pucData, unsigned long ulLength );
+
+extern xTraceEvent xTraceRecorderBuffer[ configTRACE_RECORDER_BUFFER_EVENTS ];
+extern volatile unsigned long ulTraceRecorderHead;
+extern volatile unsigned char ucTraceRecorderCurrentTask;
+extern volatile unsigned char ucTraceRecorderEnabled;
+
+/*
+ * Starts recording.  Enables the DWT cycle counter used for time stamps if it
+ * is not already running.
+ */
+void vTraceRecorderStart( void );
+
+/*
+ * Stops recording.  Recorded events are kept until drained.
+ */
+void vTraceRecorderStop( void );
+
+/*
+ * Records the name of a task so the decoder can label its timeline.
+ */
+void vTraceRecorderTaskCreate( unsigned char ucTask, const signed char *pcName );
+
+/*
+ * Writes a stream header, the task name table and any events recorded since
+ * the previous call through pxWrite.  For example, to drain over the DBGU:
+ *
+ *     static void prvWriteDBGU( const unsigned char *pucData, unsigned long ulLength )
+ *     {
+ *         while( ulLength-- ) DBGU_PutChar( *pucData++ );
+ *     }
+ *
+ *     ulTraceRecorderDrain( prvWriteDBGU );
+ *
+ * A USB CDC writer passes the data to CDCDSerialDriver_Write() and waits for
+ * the completion callback before returning.  If events were overwritten before they
+ * could be drained, their number is written in the lost count of the frame header.
+ *
+ * Events that are being recorded while the buffer is drained may be torn, so
+ * drain from a low priority task or while the recorder is stopped.
+ *
+ * Returns the number of events written.
+ */
+unsigned long ulTraceRecorderDrain( pdTRACE_WRITE_FUNCTION pxWrite );
+
+/* The time stamp is the raw 32 bit cycle counter - the decoder unwraps it.  It
+is read after the record is claimed, so a record whose writer was interrupted in
+between is stamped later than the records of the interrupt that follow it. */
+#if defined( __arm__ )
+	#define traceRECORDER_TIMESTAMP()	( *( ( volatile unsigned long * ) 0xe0001004 ) )
+#else
+	unsigned long ulTraceRecorderHostTimestamp( void );
+	#define traceRECORDER_TIMESTAMP()	ulTraceRecorderHostTimestamp()
+#endif
+
+static inline void vTraceRecorderEvent( unsigned char ucEvent, unsigned char ucTask, unsigned short usObject )
+{
+xTraceEvent *pxEvent;
+
+	if( ucTraceRecorderEnabled != 0U )
+	{
+		pxEvent = &( xTraceRecorderBuffer[ __sync_fetch_and_add( &ulTraceRecorderHead, 1UL ) & ( configTRACE_RECORDER_BUFFER_EVENTS - 1UL ) ] );
+		pxEvent->ulTimestamp = traceRECORDER_TIMESTAMP();
+		pxEvent->ucEvent = ucEvent;
+		pxEvent->ucTask = ucTask;
+		pxEvent->usObject = usObject;
+	}
+}
+
+/* Records a user event from application code. */
+#define vTraceRecorderUserEvent( ucCode, usValue )	vTraceRecorderEvent( ( unsigned char ) ( trcEVT_USER | ( ucCode ) ), ucTraceRecorderCurrentTask, ( usValue ) )
+
+/* Queues are identified by the low bits of their address. */
+#define traceRECORDER_OBJECT( pxObject )	( ( unsigned short ) ( ( ( unsigned long ) ( pxObject ) ) >> 2 ) )
+#define traceRECORDER_QUEUE_EVENT( ucEvent, pxQueue )	vTraceRecorderEvent( ( ucEvent ), ucTraceRecorderCurrentTask, traceRECORDER_OBJECT( pxQueue ) )
+
+#if defined( __arm__ )
+	static inline unsigned short usTraceRecorderExceptionNumber( void )
+	{
+	unsigned long ulIPSR;
+
+		__asm volatile ( "mrs %0, ipsr" : "=r" ( ulIPSR ) );
+		return ( unsigned short ) ulIPSR;
+	}
+#else
+	#define usTraceRecorderExceptionNumber()	( ( unsigned short ) 0U )
+#endif
+
+#define traceRECORDER_ISR_ENTER()	vTraceRecorderEvent( trcEVT_ISR_ENTER, ucTraceRecorderCurrentTask, usTraceRecorderExceptionNumber() )
+#define traceRECORDER_ISR_EXIT()	vTraceRecorderEvent( trcEVT_ISR_EXIT, ucTraceRecorderCurrentTask, usTraceRecorderExceptionNumber() )
+
+/* Kernel trace macros.  The task macros are only used within tasks.c where the
+TCB structure is visible. */
+#define traceTASK_SWITCHED_IN()								\
+	{														\
+		ucTraceRecorderCurrentTask = ( unsigned char ) pxCurrentTCB->uxTCBNumber;	\
+		vTraceRecorderEvent( trcEVT_TASK_SWITCHED_IN, ucTraceRecorderCurrentTask, 0U );	\
+	}
+#define traceTASK_CREATE( pxNewTCB )						\
+	{														\
+		vTraceRecorderTaskCreate( ( unsigned char ) ( pxNewTCB )->uxTCBNumber, ( pxNewTCB )->pcTaskName );	\
+		vTraceRecorderEvent( trcEVT_TASK_CREATE, ( unsigned char ) ( pxNewTCB )->uxTCBNumber, ( unsigned short ) ( pxNewTCB )->uxPriority );	\
+	}
+#define traceTASK_DELETE( pxTCB )			vTraceRecorderEvent( trcEVT_TASK_DELETE, ( unsigned char ) ( pxTCB )->uxTCBNumber, 0U )
+#define traceTASK_DELAY()					vTraceRecorderEvent( trcEVT_TASK_DELAY, ucTraceRecorderCurrentTask, ( unsigned short ) xTicksToDelay )
+#define traceTASK_DELAY_UNTIL()				vTraceRecorderEvent( trcEVT_TASK_DELAY_UNTIL, ucTraceRecorderCurrentTask, 0U )
+#define traceTASK_SUSPEND( pxTCB )			vTraceRecorderEvent( trcEVT_TASK_SUSPEND, ( unsigned char ) ( pxTCB )->uxTCBNumber, 0U )
+#define traceTASK_RESUME( pxTCB )			vTraceRecorderEvent( trcEVT_TASK_RESUME, ( unsigned char ) ( pxTCB )->uxTCBNumber, 0U )
+#define traceTASK_RESUME_FROM_ISR( pxTCB )	vTraceRecorderEvent( trcEVT_TASK_RESUME, ( unsigned char ) ( pxTCB )->uxTCBNumber, 1U )
+
+#define traceQUEUE_CREATE( pxNewQueue )					traceRECORDER_QUEUE_EVENT( trcEVT_QUEUE_CREATE, pxNewQueue )
+#define traceCREATE_MUTEX( pxNewQueue )					traceRECORDER_QUEUE_EVENT( trcEVT_QUEUE_CREATE, pxNewQueue )
+#define traceQUEUE_SEND( pxQueue )						traceRECORDER_QUEUE_EVENT( trcEVT_QUEUE_SEND, pxQueue )
+#define traceQUEUE_SEND_FAILED( pxQueue )				traceRECORDER_QUEUE_EVENT( trcEVT_QUEUE_SEND_FAILED, pxQueue )
+#define traceQUEUE_RECEIVE( pxQueue )					traceRECORDER_QUEUE_EVENT( trcEVT_QUEUE_RECEIVE, pxQueue )
+#define traceQUEUE_RECEIVE_FAILED( pxQueue )			traceRECORDER_QUEUE_EVENT( trcEVT_QUEUE_RECEIVE_FAILED, pxQueue )
+#define traceQUEUE_PEEK( pxQueue )						traceRECORDER_QUEUE_EVENT( trcEVT_QUEUE_PEEK, pxQueue )
+#define traceQUEUE_SEND_FROM_ISR( pxQueue )				traceRECORDER_QUEUE_EVENT( trcEVT_QUEUE_SEND_FROM_ISR, pxQueue )
+#define traceQUEUE_RECEIVE_FROM_ISR( pxQueue )			traceRECORDER_QUEUE_EVENT( trcEVT_QUEUE_RECEIVE_FROM_ISR, pxQueue )
+#define traceBLOCKING_ON_QUEUE_SEND( pxQueue )			traceRECORDER_QUEUE_EVENT( trcEVT_BLOCKING_ON_QUEUE_SEND, pxQueue )
+#define traceBLOCKING_ON_QUEUE_RECEIVE( pxQueue )		traceRECORDER_QUEUE_EVENT( trcEVT_BLOCKING_ON_QUEUE_RECEIVE, pxQueue )
+#define traceQUEUE_DELETE( pxQueue )					traceRECORDER_QUEUE_EVENT( trcEVT_QUEUE_DELETE, pxQueue )
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACE_RECORDER_H */
@@ -0,0 +1,179 @@
+/*
+ * Run time statistics time base.
+ *
+ * On the Cortex-M3 the counter is the DWT cycle counter (CYCCNT), which counts
+ * core clock cycles and wraps every 2^32 cycles (about 89 seconds at 48MHz).
+ * It is extended to 64 bits here by counting wraps, so it must be read at
+ * least once per wrap period - the tick interrupt does this through
+ * traceISR_ENTER()/traceISR_EXIT().
+ *
+ * Host builds use the monotonic clock, scaled to configCPU_CLOCK_HZ so that
+ * figures are in the same units as on the target.
+ *
+ * Interrupts that call traceISR_ENTER() on entry and traceISR_EXIT() on exit
+ * have their execution time accumulated separately, so that it is not charged
+ * to the task that happened to be running.
+ */
+
+#include "FreeRTOS.h"
+
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+
+#if defined( __arm__ )
+
+/* Constants required to access the DWT cycle counter. */
+#define portDEMCR					( ( volatile unsigned long * ) 0xe000edfc )
+#define portDWT_CTRL				( ( volatile unsigned long * ) 0xe0001000 )
+#define portDWT_CYCCNT				( ( volatile unsigned long * ) 0xe0001004 )
+#define portDEMCR_TRCENA			0x01000000
+#define portDWT_CTRL_CYCCNTENA		0x00000001
+
+/* PRIMASK rather than BASEPRI is used so that the counter can be read from
+interrupts above configMAX_SYSCALL_INTERRUPT_PRIORITY, and from inside
+critical sections without disturbing the critical nesting. */
+static inline unsigned long prvDisableInterrupts( void )
+{
+unsigned long ulPrimask;
+
+	__asm volatile ( "mrs %0, primask	\n"
+					 "cpsid i			\n" : "=r" ( ulPrimask ) :: "memory" );
+	return ulPrimask;
+}
+
+static inline void prvRestoreInterrupts( unsigned long ulPrimask )
+{
+	__asm volatile ( "msr primask, %0	\n" :: "r" ( ulPrimask ) : "memory" );
+}
+
+static unsigned long ulCycleCountHigh = 0UL;
+static unsigned long ulLastCycleCount = 0UL;
+
+#else
+
+#include <time.h>
+
+#define prvDisableInterrupts()		0UL
+#define prvRestoreInterrupts( x )	( void ) ( x )
+
+static struct timespec xStartTime;
+
+#endif /* __arm__ */
+
+static unsigned long long ullISRTime = 0ULL;
+static unsigned long long ullISREntryTime = 0ULL;
+static unsigned long ulISRNesting = 0UL;
+
+/*-----------------------------------------------------------*/
+
+void vPortRunTimeCounterInit( void )
+{
+	#if defined( __arm__ )
+	{
+		*( portDEMCR ) |= portDEMCR_TRCENA;
+		*( portDWT_CYCCNT ) = 0UL;
+		*( portDWT_CTRL ) |= portDWT_CTRL_CYCCNTENA;
+
+		ulCycleCountHigh = 0UL;
+		ulLastCycleCount = 0UL;
+	}
+	#else
+	{
+		clock_gettime( CLOCK_MONOTONIC, &xStartTime );
+	}
+	#endif
+
+	ullISRTime = 0ULL;
+	ulISRNesting = 0UL;
+}
+/*-----------------------------------------------------------*/
+
+static unsigned long long prvReadCounter( void )
+{
+	#if defined( __arm__ )
+	{
+	unsigned long ulNow = *( portDWT_CYCCNT );
+
+		/* Must be called with interrupts disabled. */
+		if( ulNow < ulLastCycleCount )
+		{
+			ulCycleCountHigh++;
+		}
+		ulLastCycleCount = ulNow;
+
+		return ( ( unsigned long long ) ulCycleCountHigh << 32 ) | ulNow;
+	}
+	#else
+	{
+	struct timespec xNow;
+	unsigned long long ullNanoseconds;
+
+		clock_gettime( CLOCK_MONOTONIC, &xNow );
+		ullNanoseconds = ( unsigned long long ) ( xNow.tv_sec - xStartTime.tv_sec ) * 1000000000ULL;
+		ullNanoseconds += ( unsigned long long ) xNow.tv_nsec;
+		ullNanoseconds -= ( unsigned long long ) xStartTime.tv_nsec;
+
+		return ( ullNanoseconds * ( configCPU_CLOCK_HZ / 1000000UL ) ) / 1000ULL;
+	}
+	#endif
+}
+/*-----------------------------------------------------------*/
+
+unsigned long long ullPortGetRunTimeCounterValue( void )
+{
+unsigned long ulMask;
+unsigned long long ullReturn;
+
+	ulMask = prvDisableInterrupts();
+	ullReturn = prvReadCounter();
+	prvRestoreInterrupts( ulMask );
+
+	return ullReturn;
+}
+/*-----------------------------------------------------------*/
+
+unsigned long long ullPortGetRunTimeISRCounterValue( void )
+{
+unsigned long ulMask;
+unsigned long long ullReturn;
+
+	ulMask = prvDisableInterrupts();
+	ullReturn = ullISRTime;
+	prvRestoreInterrupts( ulMask );
+
+	return ullReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortRunTimeISREnter( void )
+{
+unsigned long ulMask;
+
+	ulMask = prvDisableInterrupts();
+	{
+		/* Nested interrupts are accounted for by the outermost one. */
+		if( ulISRNesting == 0UL )
+		{
+			ullISREntryTime = prvReadCounter();
+		}
+		ulISRNesting++;
+	}
+	prvRestoreInterrupts( ulMask );
+}
+/*-----------------------------------------------------------*/
+
+void vPortRunTimeISRExit( void )
+{
+unsigned long ulMask;
+
+	ulMask = prvDisableInterrupts();
+	{
+		ulISRNesting--;
+		if( ulISRNesting == 0UL )
+		{
+			ullISRTime += prvReadCounter() - ullISREntryTime;
+		}
+	}
+	prvRestoreInterrupts( ulMask );
+}
+
+#endif /* configGENERATE_RUN_TIME_STATS */
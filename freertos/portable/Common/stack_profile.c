@@ -0,0 +1,201 @@
+/*
+ * System wide stack profile.
+ *
+ * Reports the size, peak use and a recommended size for the stack of every
+ * task and for the main stack, which is used by main() before the scheduler
+ * starts and by all interrupts afterwards.  Task stacks are measured with
+ * uxTaskGetStackStatus().  The main stack is the region between the linker
+ * symbols _sstack and _estack (STACK_SIZE in cxx_flash.ld); it is filled with
+ * a known value by vPortStackProfileInit(), which must be called early in
+ * main(), and measured the same way as the task stacks.
+ *
+ * The recommended size is the peak use plus configSTACK_PROFILE_HEADROOM
+ * percent, plus the bytes lost to the MPU stack guard where that is used.
+ * Peak use is only as good as the test run that produced it, so the report
+ * should be taken after the application has been exercised.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#if ( INCLUDE_uxTaskGetStackHighWaterMark == 1 )
+
+/* Extra space recommended on top of the peak use, in percent. */
+#ifndef configSTACK_PROFILE_HEADROOM
+	#define configSTACK_PROFILE_HEADROOM	25
+#endif
+
+/* The number of tasks that fit in the report. */
+#ifndef configSTACK_PROFILE_MAX_TASKS
+	#define configSTACK_PROFILE_MAX_TASKS	16
+#endif
+
+/* The value the main stack is filled with.  Matches the task stacks. */
+#define portSTACK_PROFILE_FILL_BYTE			( 0xa5U )
+
+/* Space left untouched below the stack pointer of the caller of
+vPortStackProfileInit(). */
+#define portSTACK_PROFILE_MARGIN			( 32UL )
+
+/* Stack that is allocated to a task but cannot be used. */
+#if ( portUSING_MPU_STACK_GUARD == 1 )
+	#define portSTACK_PROFILE_OVERHEAD		( ( 2UL * portSTACK_GUARD_SIZE ) - portBYTE_ALIGNMENT )
+#else
+	#define portSTACK_PROFILE_OVERHEAD		( 0UL )
+#endif
+
+#if defined( __arm__ )
+	/* Main stack limits, defined by the linker script. */
+	extern unsigned long _sstack;
+	extern unsigned long _estack;
+#endif
+
+/* Width of the name column, and room for a line of the report. */
+#define portSTACK_PROFILE_NAME_WIDTH		( 12U )
+#define portSTACK_PROFILE_LINE_SIZE			( 64U )
+
+static xTaskStackStatus xTaskStatus[ configSTACK_PROFILE_MAX_TASKS ];
+static signed char cLine[ portSTACK_PROFILE_LINE_SIZE ];
+
+/*-----------------------------------------------------------*/
+
+void vPortStackProfileInit( void )
+{
+	#if defined( __arm__ )
+	{
+	unsigned long ulPrimask, ulStackPointer;
+	volatile unsigned char *pucByte;
+
+		/* Interrupts are masked so that no exception frame is stacked below the
+		stack pointer while the unused part of the stack is being filled. */
+		__asm volatile ( "mrs %0, primask	\n"
+						 "cpsid i			\n"
+						 "mov %1, sp		\n" : "=r" ( ulPrimask ), "=r" ( ulStackPointer ) :: "memory" );
+
+		for( pucByte = ( unsigned char * ) &_sstack; ( unsigned long ) pucByte < ( ulStackPointer - portSTACK_PROFILE_MARGIN ); pucByte++ )
+		{
+			*pucByte = portSTACK_PROFILE_FILL_BYTE;
+		}
+
+		__asm volatile ( "msr primask, %0	\n" :: "r" ( ulPrimask ) : "memory" );
+	}
+	#endif
+}
+/*-----------------------------------------------------------*/
+
+unsigned long ulPortGetMainStackSize( void )
+{
+	#if defined( __arm__ )
+		return ( unsigned long ) &_estack - ( unsigned long ) &_sstack;
+	#else
+		return 0UL;
+	#endif
+}
+/*-----------------------------------------------------------*/
+
+unsigned long ulPortGetMainStackHighWaterMark( void )
+{
+unsigned long ulFree = 0UL;
+
+	#if defined( __arm__ )
+	{
+	const unsigned char *pucByte = ( const unsigned char * ) &_sstack;
+
+		while( ( pucByte < ( const unsigned char * ) &_estack ) && ( *pucByte == portSTACK_PROFILE_FILL_BYTE ) )
+		{
+			pucByte++;
+			ulFree++;
+		}
+	}
+	#endif
+
+	return ulFree;
+}
+/*-----------------------------------------------------------*/
+
+static unsigned long prvRecommendedSize( unsigned long ulUsed, unsigned long ulOverhead )
+{
+unsigned long ulSize;
+
+	ulSize = ( ( ulUsed * ( 100UL + configSTACK_PROFILE_HEADROOM ) ) + 99UL ) / 100UL;
+	ulSize += ulOverhead;
+
+	/* Round up to the stack alignment. */
+	return ( ulSize + portBYTE_ALIGNMENT_MASK ) & ~( ( unsigned long ) portBYTE_ALIGNMENT_MASK );
+}
+/*-----------------------------------------------------------*/
+
+/* Writes the name padded to the width of the name column.  The printf() of
+at91lib has neither the '-' flag nor the 'l' modifier, so the lines are
+padded here and the figures, which fit in 32 bits, printed with %u. */
+static signed char *prvWriteName( signed char *pcLine, const signed char *pcName )
+{
+size_t xLength;
+
+	strncpy( ( char * ) pcLine, ( const char * ) pcName, portSTACK_PROFILE_NAME_WIDTH );
+	for( xLength = strlen( ( char * ) pcLine ); xLength < portSTACK_PROFILE_NAME_WIDTH; xLength++ )
+	{
+		pcLine[ xLength ] = ' ';
+	}
+
+	return pcLine + portSTACK_PROFILE_NAME_WIDTH;
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteLine( void ( *pxWriteLine )( const signed char *pcLine ), const signed char *pcName, unsigned long ulSize, unsigned long ulUsed, unsigned long ulRecommended )
+{
+	sprintf( ( char * ) prvWriteName( cLine, pcName ), "\t%6u\t%6u\t%6u\t%6u\r\n", ( unsigned int ) ulSize, ( unsigned int ) ulUsed, ( unsigned int ) ( ulSize - ulUsed ), ( unsigned int ) ulRecommended );
+	pxWriteLine( cLine );
+}
+/*-----------------------------------------------------------*/
+
+void vPortStackProfileReport( void ( *pxWriteLine )( const signed char *pcLine ) )
+{
+unsigned portBASE_TYPE uxTasks, ux;
+unsigned long ulSize, ulUsed, ulRecommended, ulTotal = 0UL, ulTotalRecommended = 0UL;
+
+	/* The report is one header line, one line per task, one line for the
+	main stack and a total line.  Each line is passed to pxWriteLine() as
+	soon as it is built, in a buffer that the next line reuses.  Free stack
+	that is lost to the MPU guard is counted as used. */
+	pxWriteLine( ( const signed char * ) "Stack (bytes)\t  Size\t  Used\t  Free\t Recom\r\n" );
+
+	uxTasks = uxTaskGetStackStatus( xTaskStatus, configSTACK_PROFILE_MAX_TASKS );
+
+	for( ux = 0U; ux < uxTasks; ux++ )
+	{
+		ulSize = ( unsigned long ) xTaskStatus[ ux ].usStackDepth * sizeof( portSTACK_TYPE );
+		ulUsed = ulSize - ( ( unsigned long ) xTaskStatus[ ux ].usHighWaterMark * sizeof( portSTACK_TYPE ) );
+		ulRecommended = prvRecommendedSize( ulUsed, portSTACK_PROFILE_OVERHEAD );
+
+		ulUsed += portSTACK_PROFILE_OVERHEAD;
+		if( ulUsed > ulSize )
+		{
+			ulUsed = ulSize;
+		}
+
+		prvWriteLine( pxWriteLine, xTaskStatus[ ux ].pcTaskName, ulSize, ulUsed, ulRecommended );
+		ulTotal += ulSize;
+		ulTotalRecommended += ulRecommended;
+	}
+
+	ulSize = ulPortGetMainStackSize();
+	if( ulSize > 0UL )
+	{
+		ulUsed = ulSize - ulPortGetMainStackHighWaterMark();
+		ulRecommended = prvRecommendedSize( ulUsed, 0UL );
+
+		prvWriteLine( pxWriteLine, ( const signed char * ) "main/ISR", ulSize, ulUsed, ulRecommended );
+		ulTotal += ulSize;
+		ulTotalRecommended += ulRecommended;
+	}
+
+	sprintf( ( char * ) prvWriteName( cLine, ( const signed char * ) "Total" ), "\t%6u\t\t\t%6u\r\n", ( unsigned int ) ulTotal, ( unsigned int ) ulTotalRecommended );
+	pxWriteLine( cLine );
+}
+/*-----------------------------------------------------------*/
+
+#endif /* INCLUDE_uxTaskGetStackHighWaterMark */
@@ -80,12 +80,28 @@
 #define configUSE_CO_ROUTINES 			0
 #define configUSE_MUTEXES				1
 #define configUSE_RECURSIVE_MUTEXES		1
-#define configCHECK_FOR_STACK_OVERFLOW	2
+#ifndef configUSE_MPU_STACK_GUARD
+	#define configUSE_MPU_STACK_GUARD	1
+#endif
+#if ( configUSE_MPU_STACK_GUARD == 1 )
+	#define configCHECK_FOR_STACK_OVERFLOW	0
+#else
+	#define configCHECK_FOR_STACK_OVERFLOW	2
+#endif
+#define configGENERATE_RUN_TIME_STATS	1
+#define configUSE_TRACE_RECORDER		0
 
 #define configMAX_PRIORITIES		( ( unsigned portBASE_TYPE ) 5 )
 #define configMAX_CO_ROUTINE_PRIORITIES ( 2 )
 #define configQUEUE_REGISTRY_SIZE			10
 
+/* Software timers.  Used among others by the USB serial port to flush
+partially filled packets. */
+#define configUSE_TIMERS				1
+#define configTIMER_TASK_PRIORITY		( configMAX_PRIORITIES - 1 )
+#define configTIMER_QUEUE_LENGTH		5
+#define configTIMER_TASK_STACK_DEPTH	( configMINIMAL_STACK_SIZE * 2 )
+
 /* Set the following definitions to 1 to include the API function, or zero
 to exclude the API function. */
 
@@ -97,8 +113,36 @@ to exclude the API function. */
 #define INCLUDE_vTaskDelayUntil				1
 #define INCLUDE_vTaskDelay					1
 #define INCLUDE_uxTaskGetStackHighWaterMark	1
-
-
+#define INCLUDE_xTaskGetCurrentTaskHandle	1
+#define INCLUDE_pcTaskGetTaskName			1
+
+
+
+/* Stack overflows are caught by an MPU guard region at the bottom of the
+running task's stack (see portmacro.h) instead of being checked for on every
+context switch.  A write into the guard raises a memory management fault, and
+vPortMemManageHandler() calls vApplicationStackOverflowHook().  Build with
+STACK_GUARD=0 to check the stack on every context switch instead. */
+
+/* Run time statistics are clocked from the DWT cycle counter, extended to 64
+bits.  Interrupt handlers that bracket their body with traceISR_ENTER() and
+traceISR_EXIT() have their time reported separately from the tasks. */
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()	vPortRunTimeCounterInit()
+#define portGET_RUN_TIME_COUNTER_VALUE()			ullPortGetRunTimeCounterValue()
+#define portGET_RUN_TIME_ISR_COUNTER_VALUE()		ullPortGetRunTimeISRCounterValue()
+#define portRUN_TIME_COUNTER_TYPE					unsigned long long
+#define traceISR_ENTER()							{ vPortRunTimeISREnter(); traceRECORDER_ISR_ENTER(); }
+#define traceISR_EXIT()								{ traceRECORDER_ISR_EXIT(); vPortRunTimeISRExit(); }
+
+/* The binary trace recorder takes over the kernel trace macros.  See
+trace_recorder.h. */
+#if ( configUSE_TRACE_RECORDER == 1 )
+	#define configTRACE_RECORDER_BUFFER_EVENTS		256
+	#include "trace_recorder.h"
+#else
+	#define traceRECORDER_ISR_ENTER()
+	#define traceRECORDER_ISR_EXIT()
+#endif
 
 #define configKERNEL_INTERRUPT_PRIORITY 		( 0x0f << 4 )	/* Priority 15, or 255 as only the top four bits are implemented.  This is the lowest priority. */
 #define configMAX_SYSCALL_INTERRUPT_PRIORITY 	( 5 << 4 )  	/* Priority 5, or 80 as only the top four bits are implemented. */
@@ -69,18 +69,50 @@ FreeRTOS.org versions prior to V4.4.0 did not include this definition. */
 /* Constants required to manipulate the NVIC. */
 #define portNVIC_SYSTICK_CTRL		( ( volatile unsigned long *) 0xe000e010 )
 #define portNVIC_SYSTICK_LOAD		( ( volatile unsigned long *) 0xe000e014 )
+#define portNVIC_SYSTICK_CURRENT	( ( volatile unsigned long *) 0xe000e018 )
 #define portNVIC_INT_CTRL			( ( volatile unsigned long *) 0xe000ed04 )
 #define portNVIC_SYSPRI2			( ( volatile unsigned long *) 0xe000ed20 )
 #define portNVIC_SYSTICK_CLK		0x00000004
 #define portNVIC_SYSTICK_INT		0x00000002
 #define portNVIC_SYSTICK_ENABLE		0x00000001
 #define portNVIC_PENDSVSET			0x10000000
+#define portNVIC_PENDSTSET			0x04000000
 #define portNVIC_PENDSV_PRI			( ( ( unsigned long ) configKERNEL_INTERRUPT_PRIORITY ) << 16 )
 #define portNVIC_SYSTICK_PRI		( ( ( unsigned long ) configKERNEL_INTERRUPT_PRIORITY ) << 24 )
 
 /* Constants required to set up the initial stack. */
 #define portINITIAL_XPSR			( 0x01000000 )
 
+/* Constants required to manipulate the MPU stack guard. */
+#define portMPU_TYPE							( ( volatile unsigned long * ) 0xe000ed90 )
+#define portMPU_CTRL							( ( volatile unsigned long * ) 0xe000ed94 )
+#define portNVIC_SYS_HANDLER_CTRL				( ( volatile unsigned long * ) 0xe000ed24 )
+#define portNVIC_MEM_FAULT_STATUS				( ( volatile unsigned char * ) 0xe000ed28 )
+#define portEXPECTED_MPU_TYPE_VALUE				( 8UL << 8UL ) /* 8 regions, unified. */
+#define portMPU_ENABLE							( 0x01UL )
+#define portMPU_BACKGROUND_ENABLE				( 1UL << 2UL )
+#define portNVIC_MEM_FAULT_ENABLE				( 1UL << 16UL )
+#define portMPU_REGION_VALID					( 0x10UL )
+#define portMPU_REGION_ENABLE					( 0x01UL )
+#define portMPU_REGION_PRIVILEGED_READ_ONLY		( 0x05UL << 24UL )
+#define portMPU_REGION_EXECUTE_NEVER			( 0x01UL << 28UL )
+#define portMPU_REGION_CACHEABLE_BUFFERABLE		( 0x07UL << 16UL )
+#define portMPU_REGION_SIZE_32_BYTES			( 4UL << 1UL ) /* Region size is 2 ^ ( field + 1 ) bytes. */
+#define portMEM_FAULT_DATA_ACCESS				( 0x02U )
+#define portMEM_FAULT_STACKING					( 0x10U )
+
+/* Writes the stack guard of the task pointed to by r1 to the MPU.  The guard
+is the second member of the TCB.  r1, r2 and r12 are clobbered. */
+#if( portUSING_MPU_STACK_GUARD == 1 )
+	#define portRESTORE_STACK_GUARD									\
+	"	ldrd r1, r2, [r1, #4]				\n"						\
+	"	movw r12, #0xed9c					\n" /* Region Base Address register. */	\
+	"	movt r12, #0xe000					\n"						\
+	"	stmia r12, {r1, r2}					\n" /* Base address and attribute of the guard region. */
+#else
+	#define portRESTORE_STACK_GUARD
+#endif
+
 /* The priority used by the kernel is assigned to a variable to make access
 from inline assembler easier. */
 const unsigned long ulKernelPriority = configKERNEL_INTERRUPT_PRIORITY;
@@ -89,17 +121,31 @@ const unsigned long ulKernelPriority = configKERNEL_INTERRUPT_PRIORITY;
 variable. */
 static unsigned portBASE_TYPE uxCriticalNesting = 0xaaaaaaaa;
 
+/* Ticks counted by the tick interrupt for the monotonic time base.  The
+kernel's own count stops while the scheduler is suspended. */
+static volatile unsigned long ulTickCount = 0UL;
+
 /*
  * Setup the timer to generate the tick interrupts.
  */
 static void prvSetupTimerInterrupt( void );
 
+/*
+ * Enable the MPU and the memory management fault used by the stack guard.
+ */
+#if( portUSING_MPU_STACK_GUARD == 1 )
+	static void prvSetupStackGuard( void );
+#endif
+
 /*
  * Exception handlers.
  */
 void xPortPendSVHandler( void ) __attribute__ (( naked ));
 void xPortSysTickHandler( void );
 void vPortSVCHandler( void ) __attribute__ (( naked ));
+#if( portUSING_MPU_STACK_GUARD == 1 )
+	void vPortMemManageHandler( void );
+#endif
 
 /*
  * Start first task is a separate function so it can be tested in isolation.
@@ -135,6 +181,7 @@ void vPortSVCHandler( void )
 					"	ldr	r3, pxCurrentTCBConst2		\n" /* Restore the context. */
 					"	ldr r1, [r3]					\n" /* Use pxCurrentTCBConst to get the pxCurrentTCB address. */
 					"	ldr r0, [r1]					\n" /* The first item in pxCurrentTCB is the task top of stack. */
+					portRESTORE_STACK_GUARD
 					"	ldmia r0!, {r4-r11}				\n" /* Pop the registers that are not automatically saved on exception entry and the critical nesting count. */
 					"	msr psp, r0						\n" /* Restore the task stack pointer. */
 					"	mov r0, #0 						\n"
@@ -175,6 +222,13 @@ portBASE_TYPE xPortStartScheduler( void )
 	here already. */
 	prvSetupTimerInterrupt();
 
+	#if( portUSING_MPU_STACK_GUARD == 1 )
+	{
+		/* The guard region of the first task is loaded by the SVC handler. */
+		prvSetupStackGuard();
+	}
+	#endif
+
 	/* Initialise the critical nesting count ready for the first task. */
 	uxCriticalNesting = 0;
 
@@ -241,6 +295,7 @@ void xPortPendSVHandler( void )
 	"										\n"	/* Restore the context, including the critical nesting count. */
 	"	ldr r1, [r3]						\n"
 	"	ldr r0, [r1]						\n" /* The first item in pxCurrentTCB is the task top of stack. */
+	portRESTORE_STACK_GUARD
 	"	ldmia r0!, {r4-r11}					\n" /* Pop the registers. */
 	"	msr psp, r0							\n"
 	"	bx r14								\n"
@@ -256,6 +311,8 @@ void xPortSysTickHandler( void )
 {
 unsigned long ulDummy;
 
+	traceISR_ENTER();
+
 	/* If using preemption, also force a context switch. */
 	#if configUSE_PREEMPTION == 1
 		*(portNVIC_INT_CTRL) = portNVIC_PENDSVSET;
@@ -263,9 +320,48 @@ unsigned long ulDummy;
 
 	ulDummy = portSET_INTERRUPT_MASK_FROM_ISR();
 	{
+		ulTickCount++;
 		vTaskIncrementTick();
 	}
 	portCLEAR_INTERRUPT_MASK_FROM_ISR( ulDummy );
+
+	traceISR_EXIT();
+}
+/*-----------------------------------------------------------*/
+
+unsigned long ulPortGetMicroseconds( void )
+{
+unsigned long ulTicks, ulCount, ulPrimask;
+
+	/* PRIMASK rather than BASEPRI so that the time can be read from any
+	interrupt, and from inside critical sections. */
+	__asm volatile ( "mrs %0, primask	\n"
+					 "cpsid i			\n" : "=r" ( ulPrimask ) :: "memory" );
+	{
+		ulTicks = ulTickCount;
+		ulCount = *(portNVIC_SYSTICK_CURRENT);
+
+		/* If the tick interrupt is pending the counter has reloaded, maybe
+		after it was read: count the tick, and read the counter again now
+		that it is known to be in the new period. */
+		if( ( *(portNVIC_INT_CTRL) & portNVIC_PENDSTSET ) != 0UL )
+		{
+			ulTicks++;
+			ulCount = *(portNVIC_SYSTICK_CURRENT);
+		}
+	}
+	__asm volatile ( "msr primask, %0	\n" :: "r" ( ulPrimask ) : "memory" );
+
+	return ( ulTicks * ( 1000000UL / configTICK_RATE_HZ ) ) +
+		   ( ( *(portNVIC_SYSTICK_LOAD) - ulCount ) / ( configCPU_CLOCK_HZ / 1000000UL ) );
+}
+/*-----------------------------------------------------------*/
+
+unsigned long ulPortGetMilliseconds( void )
+{
+	/* A single aligned load, so no masking is needed.  The resolution is one
+	tick. */
+	return ulTickCount * portTICK_RATE_MS;
 }
 /*-----------------------------------------------------------*/
 
@@ -281,3 +377,65 @@ void prvSetupTimerInterrupt( void )
 }
 /*-----------------------------------------------------------*/
 
+#if( portUSING_MPU_STACK_GUARD == 1 )
+
+	static void prvSetupStackGuard( void )
+	{
+		/* Check the expected MPU is present. */
+		if( *portMPU_TYPE == portEXPECTED_MPU_TYPE_VALUE )
+		{
+			/* The guard is the only region used.  The background region keeps
+			the default memory map for everything else, as all tasks run
+			privileged. */
+			*portNVIC_SYS_HANDLER_CTRL |= portNVIC_MEM_FAULT_ENABLE;
+			*portMPU_CTRL = portMPU_ENABLE | portMPU_BACKGROUND_ENABLE;
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+	void vPortStoreTaskStackGuard( xMPU_STACK_GUARD *pxStackGuard, portSTACK_TYPE *pxBottomOfStack )
+	{
+	unsigned long ulBase;
+
+		/* MPU regions must be aligned to their size, so the guard starts at the
+		first suitably aligned address within the stack.  The region is read
+		only rather than no access so the stack high water mark can still be
+		measured. */
+		ulBase = ( ( unsigned long ) pxBottomOfStack + ( portSTACK_GUARD_SIZE - 1UL ) ) & ~( portSTACK_GUARD_SIZE - 1UL );
+
+		pxStackGuard->ulRegionBaseAddress =	ulBase |
+											portMPU_REGION_VALID |
+											portSTACK_GUARD_REGION;
+
+		pxStackGuard->ulRegionAttribute =	portMPU_REGION_PRIVILEGED_READ_ONLY |
+											portMPU_REGION_EXECUTE_NEVER |
+											portMPU_REGION_CACHEABLE_BUFFERABLE |
+											portMPU_REGION_SIZE_32_BYTES |
+											portMPU_REGION_ENABLE;
+	}
+	/*-----------------------------------------------------------*/
+
+	void vPortMemManageHandler( void )
+	{
+	extern void vApplicationStackOverflowHook( xTaskHandle pxTask, signed char *pcTaskName );
+	signed char *pcTaskName = NULL;
+
+		/* A data access or exception stacking violation can only come from a
+		write to the guard region of the running task. */
+		if( ( *portNVIC_MEM_FAULT_STATUS & ( portMEM_FAULT_DATA_ACCESS | portMEM_FAULT_STACKING ) ) != 0U )
+		{
+			#if( INCLUDE_pcTaskGetTaskName == 1 )
+			{
+				pcTaskName = pcTaskGetTaskName( NULL );
+			}
+			#endif
+
+			vApplicationStackOverflowHook( xTaskGetCurrentTaskHandle(), pcTaskName );
+		}
+
+		/* The task cannot be resumed. */
+		for( ;; );
+	}
+	/*-----------------------------------------------------------*/
+
+#endif /* portUSING_MPU_STACK_GUARD */
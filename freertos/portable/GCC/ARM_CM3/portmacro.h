@@ -93,6 +93,28 @@ extern "C" {
 #define portBYTE_ALIGNMENT			8
 /*-----------------------------------------------------------*/	
 
+/* MPU stack guard.  When configUSE_MPU_STACK_GUARD is 1 the lowest
+portSTACK_GUARD_SIZE aligned bytes of the running task's stack are mapped
+read only, so an overflow raises a memory management fault on the offending
+write instead of being looked for at the next context switch.  The region
+settings are kept in the TCB and written to the MPU by the PendSV handler. */
+#ifndef configUSE_MPU_STACK_GUARD
+	#define configUSE_MPU_STACK_GUARD	0
+#endif
+
+#if( configUSE_MPU_STACK_GUARD == 1 )
+	#define portUSING_MPU_STACK_GUARD	1
+	#define portSTACK_GUARD_SIZE		( 32UL ) /* The smallest MPU region. */
+	#define portSTACK_GUARD_REGION		( 7UL )	 /* The highest priority region. */
+
+	typedef struct MPU_STACK_GUARD
+	{
+		unsigned portLONG ulRegionBaseAddress;
+		unsigned portLONG ulRegionAttribute;
+	} xMPU_STACK_GUARD;
+#endif
+/*-----------------------------------------------------------*/
+
 
 /* Scheduler utilities. */
 extern void vPortYieldFromISR( void );
@@ -100,6 +122,27 @@ extern void vPortYieldFromISR( void );
 #define portYIELD()					vPortYieldFromISR()
 
 #define portEND_SWITCHING_ISR( xSwitchRequired ) if( xSwitchRequired ) vPortYieldFromISR()
+
+/* pdTRUE when called from an interrupt handler: IPSR holds the number of the
+active exception, and is 0 in thread mode. */
+static inline portBASE_TYPE xPortIsInsideInterrupt( void )
+{
+unsigned portLONG ulIPSR;
+
+	__asm volatile ( "mrs %0, ipsr" : "=r" ( ulIPSR ) );
+	return ( ulIPSR != 0UL ) ? pdTRUE : pdFALSE;
+}
+
+#define portIS_INSIDE_INTERRUPT()	xPortIsInsideInterrupt()
+/*-----------------------------------------------------------*/
+
+
+/* Monotonic time base.  The tick interrupt counts its own ticks, so unlike
+xTaskGetTickCount() the time keeps running while the scheduler is suspended,
+and the SysTick counter gives the time within the current tick.  Both values
+wrap around at 2^32, and may be read from any task or interrupt. */
+extern unsigned long ulPortGetMicroseconds( void );
+extern unsigned long ulPortGetMilliseconds( void );
 /*-----------------------------------------------------------*/
 
 
@@ -151,6 +151,8 @@ signed portBASE_TYPE xQueueGenericSendFromISR( xQueueHandle pxQueue, const void
 signed portBASE_TYPE xQueueGenericReceive( xQueueHandle pxQueue, void * const pvBuffer, portTickType xTicksToWait, portBASE_TYPE xJustPeeking ) PRIVILEGED_FUNCTION;
 signed portBASE_TYPE xQueueReceiveFromISR( xQueueHandle pxQueue, void * const pvBuffer, signed portBASE_TYPE *pxTaskWoken ) PRIVILEGED_FUNCTION;
 xQueueHandle xQueueCreateMutex( unsigned char ucQueueType ) PRIVILEGED_FUNCTION;
+xQueueHandle xQueueGenericCreateStatic( unsigned portBASE_TYPE uxQueueLength, unsigned portBASE_TYPE uxItemSize, unsigned char *pucQueueStorage, xStaticQueue *pxStaticQueue, unsigned char ucQueueType ) PRIVILEGED_FUNCTION;
+xQueueHandle xQueueCreateMutexStatic( unsigned char ucQueueType, xStaticQueue *pxStaticQueue ) PRIVILEGED_FUNCTION;
 xQueueHandle xQueueCreateCountingSemaphore( unsigned portBASE_TYPE uxCountValue, unsigned portBASE_TYPE uxInitialCount ) PRIVILEGED_FUNCTION;
 portBASE_TYPE xQueueTakeMutexRecursive( xQueueHandle xMutex, portTickType xBlockTime ) PRIVILEGED_FUNCTION;
 portBASE_TYPE xQueueGiveMutexRecursive( xQueueHandle xMutex ) PRIVILEGED_FUNCTION;
@@ -235,6 +237,34 @@ static void prvCopyDataToQueue( xQUEUE *pxQueue, const void *pvItemToQueue, port
  * Copies an item out of a queue.
  */
 static void prvCopyDataFromQueue( xQUEUE * const pxQueue, const void *pvBuffer ) PRIVILEGED_FUNCTION;
+
+/*
+ * Copies one item.  Items of 1, 2, 4 and 8 bytes - characters, words such as
+ * pointers, and pairs of words - are copied inline, rather than by a call to
+ * memcpy() that loops over a size only known at run time.
+ */
+#if ( configQUEUE_COPY_BY_SIZE == 1 )
+	static void prvCopyItem( void *pvTo, const void *pvFrom, unsigned portBASE_TYPE uxItemSize ) PRIVILEGED_FUNCTION;
+#else
+	#define prvCopyItem( pvTo, pvFrom, uxItemSize ) memcpy( ( pvTo ), ( pvFrom ), ( unsigned ) ( uxItemSize ) )
+#endif
+
+/*
+ * Sets up a queue structure, whether allocated by xQueueGenericCreate() or
+ * given to xQueueGenericCreateStatic(), with its storage area.
+ */
+static void prvInitialiseNewQueue( xQUEUE *pxNewQueue, unsigned portBASE_TYPE uxQueueLength, unsigned portBASE_TYPE uxItemSize, signed char *pcQueueStorage, unsigned char ucQueueType ) PRIVILEGED_FUNCTION;
+
+#if ( configUSE_MUTEXES == 1 )
+	/*
+	 * Sets up a queue structure as a mutex, and gives the mutex.
+	 */
+	static void prvInitialiseMutex( xQUEUE *pxNewQueue, unsigned char ucQueueType ) PRIVILEGED_FUNCTION;
+#endif
+
+/* xStaticQueue is declared in FreeRTOS.h with the same layout as xQUEUE, without
+making the members visible.  This fails to compile if the two differ. */
+typedef char prvStaticQueueSizeCheck[ ( sizeof( xStaticQueue ) == sizeof( xQUEUE ) ) ? 1 : -1 ];
 /*-----------------------------------------------------------*/
 
 /*
@@ -265,12 +295,9 @@ xQueueHandle xQueueGenericCreate( unsigned portBASE_TYPE uxQueueLength, unsigned
 {
 xQUEUE *pxNewQueue;
 size_t xQueueSizeInBytes;
+signed char *pcQueueStorage;
 xQueueHandle xReturn = NULL;
 
-	/* Remove compiler warnings about unused parameters should 
-	configUSE_TRACE_FACILITY not be set to 1. */
-	( void ) ucQueueType;
-
 	/* Allocate the new queue structure. */
 	if( uxQueueLength > ( unsigned portBASE_TYPE ) 0 )
 	{
@@ -281,30 +308,10 @@ xQueueHandle xReturn = NULL;
 			longer than asked for to make wrap checking easier/faster. */
 			xQueueSizeInBytes = ( size_t ) ( uxQueueLength * uxItemSize ) + ( size_t ) 1;
 
-			pxNewQueue->pcHead = ( signed char * ) pvPortMalloc( xQueueSizeInBytes );
-			if( pxNewQueue->pcHead != NULL )
+			pcQueueStorage = ( signed char * ) pvPortMalloc( xQueueSizeInBytes );
+			if( pcQueueStorage != NULL )
 			{
-				/* Initialise the queue members as described above where the
-				queue type is defined. */
-				pxNewQueue->pcTail = pxNewQueue->pcHead + ( uxQueueLength * uxItemSize );
-				pxNewQueue->uxMessagesWaiting = ( unsigned portBASE_TYPE ) 0U;
-				pxNewQueue->pcWriteTo = pxNewQueue->pcHead;
-				pxNewQueue->pcReadFrom = pxNewQueue->pcHead + ( ( uxQueueLength - ( unsigned portBASE_TYPE ) 1U ) * uxItemSize );
-				pxNewQueue->uxLength = uxQueueLength;
-				pxNewQueue->uxItemSize = uxItemSize;
-				pxNewQueue->xRxLock = queueUNLOCKED;
-				pxNewQueue->xTxLock = queueUNLOCKED;
-				#if ( configUSE_TRACE_FACILITY == 1 )
-				{
-					pxNewQueue->ucQueueType = ucQueueType;
-				}
-				#endif /* configUSE_TRACE_FACILITY */
-
-				/* Likewise ensure the event queues start with the correct state. */
-				vListInitialise( &( pxNewQueue->xTasksWaitingToSend ) );
-				vListInitialise( &( pxNewQueue->xTasksWaitingToReceive ) );
-
-				traceQUEUE_CREATE( pxNewQueue );
+				prvInitialiseNewQueue( pxNewQueue, uxQueueLength, uxItemSize, pcQueueStorage, ucQueueType );
 				xReturn = pxNewQueue;
 			}
 			else
@@ -321,52 +328,69 @@ xQueueHandle xReturn = NULL;
 }
 /*-----------------------------------------------------------*/
 
+xQueueHandle xQueueGenericCreateStatic( unsigned portBASE_TYPE uxQueueLength, unsigned portBASE_TYPE uxItemSize, unsigned char *pucQueueStorage, xStaticQueue *pxStaticQueue, unsigned char ucQueueType )
+{
+xQUEUE *pxNewQueue = ( xQUEUE * ) pxStaticQueue;
+
+	configASSERT( pxStaticQueue );
+	configASSERT( uxQueueLength > ( unsigned portBASE_TYPE ) 0 );
+
+	/* Semaphores have no storage, but the head must not be NULL, which marks a
+	mutex.  Nothing is ever copied to or from it. */
+	if( uxItemSize == ( unsigned portBASE_TYPE ) 0 )
+	{
+		pucQueueStorage = ( unsigned char * ) pxStaticQueue;
+	}
+	configASSERT( pucQueueStorage );
+
+	prvInitialiseNewQueue( pxNewQueue, uxQueueLength, uxItemSize, ( signed char * ) pucQueueStorage, ucQueueType );
+
+	return pxNewQueue;
+}
+/*-----------------------------------------------------------*/
+
+static void prvInitialiseNewQueue( xQUEUE *pxNewQueue, unsigned portBASE_TYPE uxQueueLength, unsigned portBASE_TYPE uxItemSize, signed char *pcQueueStorage, unsigned char ucQueueType )
+{
+	/* Remove compiler warnings about unused parameters should 
+	configUSE_TRACE_FACILITY not be set to 1. */
+	( void ) ucQueueType;
+
+	/* Initialise the queue members as described above where the
+	queue type is defined. */
+	pxNewQueue->pcHead = pcQueueStorage;
+	pxNewQueue->pcTail = pxNewQueue->pcHead + ( uxQueueLength * uxItemSize );
+	pxNewQueue->uxMessagesWaiting = ( unsigned portBASE_TYPE ) 0U;
+	pxNewQueue->pcWriteTo = pxNewQueue->pcHead;
+	pxNewQueue->pcReadFrom = pxNewQueue->pcHead + ( ( uxQueueLength - ( unsigned portBASE_TYPE ) 1U ) * uxItemSize );
+	pxNewQueue->uxLength = uxQueueLength;
+	pxNewQueue->uxItemSize = uxItemSize;
+	pxNewQueue->xRxLock = queueUNLOCKED;
+	pxNewQueue->xTxLock = queueUNLOCKED;
+	#if ( configUSE_TRACE_FACILITY == 1 )
+	{
+		pxNewQueue->ucQueueType = ucQueueType;
+	}
+	#endif /* configUSE_TRACE_FACILITY */
+
+	/* Likewise ensure the event queues start with the correct state. */
+	vListInitialise( &( pxNewQueue->xTasksWaitingToSend ) );
+	vListInitialise( &( pxNewQueue->xTasksWaitingToReceive ) );
+
+	traceQUEUE_CREATE( pxNewQueue );
+}
+/*-----------------------------------------------------------*/
+
 #if ( configUSE_MUTEXES == 1 )
 
 	xQueueHandle xQueueCreateMutex( unsigned char ucQueueType )
 	{
 	xQUEUE *pxNewQueue;
 
-		/* Prevent compiler warnings about unused parameters if
-		configUSE_TRACE_FACILITY does not equal 1. */
-		( void ) ucQueueType;
-	
 		/* Allocate the new queue structure. */
 		pxNewQueue = ( xQUEUE * ) pvPortMalloc( sizeof( xQUEUE ) );
 		if( pxNewQueue != NULL )
 		{
-			/* Information required for priority inheritance. */
-			pxNewQueue->pxMutexHolder = NULL;
-			pxNewQueue->uxQueueType = queueQUEUE_IS_MUTEX;
-
-			/* Queues used as a mutex no data is actually copied into or out
-			of the queue. */
-			pxNewQueue->pcWriteTo = NULL;
-			pxNewQueue->pcReadFrom = NULL;
-
-			/* Each mutex has a length of 1 (like a binary semaphore) and
-			an item size of 0 as nothing is actually copied into or out
-			of the mutex. */
-			pxNewQueue->uxMessagesWaiting = ( unsigned portBASE_TYPE ) 0U;
-			pxNewQueue->uxLength = ( unsigned portBASE_TYPE ) 1U;
-			pxNewQueue->uxItemSize = ( unsigned portBASE_TYPE ) 0U;
-			pxNewQueue->xRxLock = queueUNLOCKED;
-			pxNewQueue->xTxLock = queueUNLOCKED;
-			
-			#if ( configUSE_TRACE_FACILITY == 1 )
-			{
-				pxNewQueue->ucQueueType = ucQueueType;
-			}
-			#endif
-
-			/* Ensure the event queues start with the correct state. */
-			vListInitialise( &( pxNewQueue->xTasksWaitingToSend ) );
-			vListInitialise( &( pxNewQueue->xTasksWaitingToReceive ) );
-
-			traceCREATE_MUTEX( pxNewQueue );
-
-			/* Start with the semaphore in the expected state. */
-			xQueueGenericSend( pxNewQueue, NULL, ( portTickType ) 0U, queueSEND_TO_BACK );
+			prvInitialiseMutex( pxNewQueue, ucQueueType );
 		}
 		else
 		{
@@ -376,6 +400,57 @@ xQueueHandle xReturn = NULL;
 		configASSERT( pxNewQueue );
 		return pxNewQueue;
 	}
+	/*-----------------------------------------------------------*/
+
+	xQueueHandle xQueueCreateMutexStatic( unsigned char ucQueueType, xStaticQueue *pxStaticQueue )
+	{
+		configASSERT( pxStaticQueue );
+
+		prvInitialiseMutex( ( xQUEUE * ) pxStaticQueue, ucQueueType );
+
+		return ( xQUEUE * ) pxStaticQueue;
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvInitialiseMutex( xQUEUE *pxNewQueue, unsigned char ucQueueType )
+	{
+		/* Prevent compiler warnings about unused parameters if
+		configUSE_TRACE_FACILITY does not equal 1. */
+		( void ) ucQueueType;
+
+		/* Information required for priority inheritance. */
+		pxNewQueue->pxMutexHolder = NULL;
+		pxNewQueue->uxQueueType = queueQUEUE_IS_MUTEX;
+
+		/* Queues used as a mutex no data is actually copied into or out
+		of the queue. */
+		pxNewQueue->pcWriteTo = NULL;
+		pxNewQueue->pcReadFrom = NULL;
+
+		/* Each mutex has a length of 1 (like a binary semaphore) and
+		an item size of 0 as nothing is actually copied into or out
+		of the mutex. */
+		pxNewQueue->uxMessagesWaiting = ( unsigned portBASE_TYPE ) 0U;
+		pxNewQueue->uxLength = ( unsigned portBASE_TYPE ) 1U;
+		pxNewQueue->uxItemSize = ( unsigned portBASE_TYPE ) 0U;
+		pxNewQueue->xRxLock = queueUNLOCKED;
+		pxNewQueue->xTxLock = queueUNLOCKED;
+		
+		#if ( configUSE_TRACE_FACILITY == 1 )
+		{
+			pxNewQueue->ucQueueType = ucQueueType;
+		}
+		#endif
+
+		/* Ensure the event queues start with the correct state. */
+		vListInitialise( &( pxNewQueue->xTasksWaitingToSend ) );
+		vListInitialise( &( pxNewQueue->xTasksWaitingToReceive ) );
+
+		traceCREATE_MUTEX( pxNewQueue );
+
+		/* Start with the semaphore in the expected state. */
+		xQueueGenericSend( pxNewQueue, NULL, ( portTickType ) 0U, queueSEND_TO_BACK );
+	}
 
 #endif /* configUSE_MUTEXES */
 /*-----------------------------------------------------------*/
@@ -1149,6 +1224,26 @@ void vQueueDelete( xQueueHandle pxQueue )
 #endif
 /*-----------------------------------------------------------*/
 
+#if ( configQUEUE_COPY_BY_SIZE == 1 )
+
+	static void prvCopyItem( void *pvTo, const void *pvFrom, unsigned portBASE_TYPE uxItemSize )
+	{
+		/* memcpy() with a constant size is expanded to loads and stores, and
+		the Cortex-M3 allows unaligned halfword and word accesses, so these
+		cases are a single load and store whatever the alignment. */
+		switch( uxItemSize )
+		{
+			case 1U:	memcpy( pvTo, pvFrom, 1U ); break;
+			case 2U:	memcpy( pvTo, pvFrom, 2U ); break;
+			case 4U:	memcpy( pvTo, pvFrom, 4U ); break;
+			case 8U:	memcpy( pvTo, pvFrom, 8U ); break;
+			default:	memcpy( pvTo, pvFrom, ( unsigned ) uxItemSize ); break;
+		}
+	}
+
+#endif
+/*-----------------------------------------------------------*/
+
 static void prvCopyDataToQueue( xQUEUE *pxQueue, const void *pvItemToQueue, portBASE_TYPE xPosition )
 {
 	if( pxQueue->uxItemSize == ( unsigned portBASE_TYPE ) 0 )
@@ -1166,7 +1261,7 @@ static void prvCopyDataToQueue( xQUEUE *pxQueue, const void *pvItemToQueue, port
 	}
 	else if( xPosition == queueSEND_TO_BACK )
 	{
-		memcpy( ( void * ) pxQueue->pcWriteTo, pvItemToQueue, ( unsigned ) pxQueue->uxItemSize );
+		prvCopyItem( ( void * ) pxQueue->pcWriteTo, pvItemToQueue, pxQueue->uxItemSize );
 		pxQueue->pcWriteTo += pxQueue->uxItemSize;
 		if( pxQueue->pcWriteTo >= pxQueue->pcTail )
 		{
@@ -1175,7 +1270,7 @@ static void prvCopyDataToQueue( xQUEUE *pxQueue, const void *pvItemToQueue, port
 	}
 	else
 	{
-		memcpy( ( void * ) pxQueue->pcReadFrom, pvItemToQueue, ( unsigned ) pxQueue->uxItemSize );
+		prvCopyItem( ( void * ) pxQueue->pcReadFrom, pvItemToQueue, pxQueue->uxItemSize );
 		pxQueue->pcReadFrom -= pxQueue->uxItemSize;
 		if( pxQueue->pcReadFrom < pxQueue->pcHead )
 		{
@@ -1196,7 +1291,7 @@ static void prvCopyDataFromQueue( xQUEUE * const pxQueue, const void *pvBuffer )
 		{
 			pxQueue->pcReadFrom = pxQueue->pcHead;
 		}
-		memcpy( ( void * ) pvBuffer, ( void * ) pxQueue->pcReadFrom, ( unsigned ) pxQueue->uxItemSize );
+		prvCopyItem( ( void * ) pvBuffer, ( void * ) pxQueue->pcReadFrom, pxQueue->uxItemSize );
 	}
 }
 /*-----------------------------------------------------------*/
@@ -1423,7 +1518,7 @@ signed portBASE_TYPE xReturn;
 				pxQueue->pcReadFrom = pxQueue->pcHead;
 			}
 			--( pxQueue->uxMessagesWaiting );
-			memcpy( ( void * ) pvBuffer, ( void * ) pxQueue->pcReadFrom, ( unsigned ) pxQueue->uxItemSize );
+			prvCopyItem( ( void * ) pvBuffer, ( void * ) pxQueue->pcReadFrom, pxQueue->uxItemSize );
 
 			xReturn = pdPASS;
 
@@ -1498,7 +1593,7 @@ signed portBASE_TYPE xReturn;
 			pxQueue->pcReadFrom = pxQueue->pcHead;
 		}
 		--( pxQueue->uxMessagesWaiting );
-		memcpy( ( void * ) pvBuffer, ( void * ) pxQueue->pcReadFrom, ( unsigned ) pxQueue->uxItemSize );
+		prvCopyItem( ( void * ) pvBuffer, ( void * ) pxQueue->pcReadFrom, pxQueue->uxItemSize );
 
 		if( ( *pxCoRoutineWoken ) == pdFALSE )
 		{
@@ -35,3 +35,73 @@ BetterStream::txspace(void)
         // by default claim that there is always space in transmit buffer
         return(INT_MAX);
 }
+
+
+uint8_t *
+BetterStream::txAcquire(size_t *space)
+{
+        // no buffer to lend; printf writes from the stack
+        *space = 0;
+        return(NULL);
+}
+
+
+void
+BetterStream::txRelease(size_t used)
+{
+}
+
+
+// Formats with the conversions of the checked printf, parsing the format as
+// it goes.  The first argument, a program memory flag on AVR, is unused.
+void
+BetterStream::_vprintf(unsigned char, const char *fmt, va_list ap)
+{
+        FormatSink      sink(*this);
+        FormatSpec      spec;
+
+        for (;;) {
+                FormatArg       arg;
+
+                fmt = formatParse(fmt, &spec);
+                sink.put(spec.text, spec.length);
+                switch (spec.conversion) {
+                case 'd': case 'i':
+                        if (spec.flags & FORMAT_LONGLONG)
+                                arg = FormatArg((long)va_arg(ap, long long));
+                        else if (spec.flags & FORMAT_LONG)
+                                arg = FormatArg(va_arg(ap, long));
+                        else if (spec.flags & FORMAT_SHORT)
+                                arg = FormatArg((short)va_arg(ap, int));
+                        else
+                                arg = FormatArg(va_arg(ap, int));
+                        break;
+                case 'u': case 'o': case 'x': case 'X': case 'c':
+                        if (spec.flags & FORMAT_LONGLONG)
+                                arg = FormatArg((unsigned long)va_arg(ap, unsigned long long));
+                        else if (spec.flags & FORMAT_LONG)
+                                arg = FormatArg(va_arg(ap, unsigned long));
+                        else if (spec.flags & FORMAT_SHORT)
+                                arg = FormatArg((unsigned short)va_arg(ap, unsigned int));
+                        else
+                                arg = FormatArg(va_arg(ap, unsigned int));
+                        break;
+                case 's':
+                        arg = FormatArg(va_arg(ap, const char *));
+                        break;
+                case 'p':
+                        arg = FormatArg(va_arg(ap, const void *));
+                        break;
+                case 'f': case 'F': case 'e': case 'E':
+                        arg = FormatArg(va_arg(ap, double));
+                        break;
+                case '%':
+                        break;
+                default:
+                        // end of the format, or a conversion we cannot
+                        // take the argument of
+                        return;
+                }
+                formatConvert(sink, spec, arg);
+        }
+}
@@ -17,6 +17,7 @@
 
 #include <cstdarg>
 #include <Stream.h>
+#include "Format.h"
 // #include "../AP_Common/AP_Common.h"
 
 class BetterStream : public Stream {
@@ -28,12 +29,56 @@ public:
         void            printf(const char *, ...)
                 __attribute__ ((format(__printf__, 2, 3)));
 
+#if __cplusplus >= 201402L
+        // printf with the format given through FMT(): the format is parsed
+        // at compile time, and the arguments checked against it.
+        template <class F, class... Args>
+        auto            printf(F, const Args &...)
+                -> decltype(F::get(), void());
+#endif
+
         virtual int     txspace(void);
 
+        // Lends the free part of the transmit buffer, so that printf can
+        // format in place; space is set to its size.  Returns NULL if the
+        // stream has no buffer to lend, which is the default.  The stream
+        // stays reserved to the caller until txRelease().
+        virtual uint8_t *txAcquire(size_t *space);
+
+        // Takes back the lent buffer, with its first used bytes filled in.
+        virtual void    txRelease(size_t used);
+
 private:
         void            _vprintf(unsigned char, const char *, va_list)
                 __attribute__ ((format(__printf__, 3, 0)));
 };
 
+#if __cplusplus >= 201402L
+template <class F, class... Args>
+inline auto
+BetterStream::printf(F, const Args &... args)
+        -> decltype(F::get(), void())
+{
+        static constexpr unsigned int n = formatSpecs(F::get());
+        static constexpr FormatTable<n> table = formatTable<n>(F::get());
+        static constexpr uint8_t types[] = {
+                FormatArgType<Args>::value..., FORMAT_ARG_UNSUPPORTED
+        };
+        static constexpr int check = formatCheck(table, types, sizeof...(Args));
+
+        static_assert(check != FORMAT_INVALID,
+                      "printf: unsupported conversion in the format");
+        static_assert(check != FORMAT_TOO_FEW,
+                      "printf: missing argument for the format");
+        static_assert(check != FORMAT_TOO_MANY,
+                      "printf: extra argument for the format");
+        static_assert(check != FORMAT_MISMATCH,
+                      "printf: argument of the wrong type for its conversion");
+
+        const FormatArg argv[] = { FormatArg(args)..., FormatArg() };
+        formatWrite(*this, table.spec, argv);
+}
+#endif
+
 #endif // __BETTERSTREAM_H
 
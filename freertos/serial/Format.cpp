@@ -0,0 +1,384 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: t -*-
+//
+// printf-style formatting for BetterStream, parsed and checked at compile
+// time.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+
+#include <string.h>
+#include <WString.h>
+#include <numfmt.h>
+#include "BetterStream.h"
+#include "Format.h"
+
+// Constructors ////////////////////////////////////////////////////////////////
+
+FormatArg::FormatArg(const String &v) :
+	type(FORMAT_ARG_STRING)
+{
+	u.s.p = v.c_str();
+	u.s.length = v.length();
+}
+
+FormatSink::FormatSink(BetterStream &stream) :
+	_stream(stream),
+	_begin(_buffer),
+	_p(_buffer),
+	_end(_buffer),			// empty until the first byte
+	_lent(false),
+	_written(0)
+{
+}
+
+// Public Methods //////////////////////////////////////////////////////////////
+
+void FormatSink::put(const char *s, size_t n)
+{
+	while (n > 0) {
+		size_t count;
+
+		if (_p == _end)
+			_next();
+		count = _end - _p;
+		if (count > n)
+			count = n;
+		memcpy(_p, s, count);
+		_p += count;
+		s += count;
+		n -= count;
+	}
+}
+
+void FormatSink::fill(char c, unsigned int n)
+{
+	while (n > 0) {
+		size_t count;
+
+		if (_p == _end)
+			_next();
+		count = _end - _p;
+		if (count > n)
+			count = n;
+		memset(_p, c, count);
+		_p += count;
+		n -= count;
+	}
+}
+
+size_t FormatSink::finish(void)
+{
+	_hand();
+	_begin = _p = _end = _buffer;
+	return _written;
+}
+
+// Private Methods /////////////////////////////////////////////////////////////
+
+// Passes on what was collected.
+void FormatSink::_hand(void)
+{
+	size_t used = _p - _begin;
+
+	if (_lent) {
+		_stream.txRelease(used);
+		_written += used;
+		_lent = false;
+	} else if (used > 0) {
+		_written += _stream.write((const uint8_t *)_begin, used);
+	}
+	_p = _begin;
+}
+
+// Passes on a full buffer and gets more space, from the stream if it lends
+// its transmit buffer.
+void FormatSink::_next(void)
+{
+	size_t space = 0;
+	uint8_t *buffer;
+
+	_hand();
+	buffer = _stream.txAcquire(&space);
+	if (buffer && space > 0) {
+		_lent = true;
+		_begin = _p = (char *)buffer;
+		_end = _begin + space;
+	} else {
+		if (buffer)
+			_stream.txRelease(0);
+		_begin = _p = _buffer;
+		_end = _buffer + sizeof(_buffer);
+	}
+}
+
+// Conversions /////////////////////////////////////////////////////////////////
+
+static const uint32_t powers[10] = {
+	1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+/// Most digits of precision that %e computes, and that %f computes for a
+/// FixedPoint; more are printed as zeroes.
+static const int maxPrecision = 9;
+
+// Writes a field: the sign or prefix, the zeroes, the body, the trailing
+// zeroes and the suffix, padded with spaces to the width, or with zeroes
+// after the prefix for numbers with the '0' flag.
+static void formatField(FormatSink &sink, const FormatSpec &spec, bool numeric,
+						const char *prefix, unsigned int prefixLength,
+						unsigned int zeroes, const char *body,
+						unsigned int length, unsigned int trailing,
+						const char *suffix = 0, unsigned int suffixLength = 0)
+{
+	unsigned int total = prefixLength + zeroes + length + trailing + suffixLength;
+	unsigned int pad = spec.width > total ? spec.width - total : 0;
+
+	if (numeric && (spec.flags & (FORMAT_ZERO | FORMAT_LEFT)) == FORMAT_ZERO) {
+		zeroes += pad;
+		pad = 0;
+	}
+	if (!(spec.flags & FORMAT_LEFT))
+		sink.fill(' ', pad);
+	sink.put(prefix, prefixLength);
+	sink.fill('0', zeroes);
+	sink.put(body, length);
+	sink.fill('0', trailing);
+	sink.put(suffix, suffixLength);
+	if (spec.flags & FORMAT_LEFT)
+		sink.fill(' ', pad);
+}
+
+static const char *formatSign(const FormatSpec &spec, bool negative)
+{
+	if (negative)
+		return "-";
+	if (spec.flags & FORMAT_PLUS)
+		return "+";
+	if (spec.flags & FORMAT_SPACE)
+		return " ";
+	return "";
+}
+
+static void formatInteger(FormatSink &sink, const FormatSpec &spec, const FormatArg &arg)
+{
+	char buffer[12];
+	char *end = buffer + sizeof(buffer);
+	char *p = end;
+	const char *prefix = "";
+	uint32_t v = arg.u.u;
+	unsigned int base = 10;
+	unsigned int length;
+	unsigned int zeroes = 0;
+
+	switch (spec.conversion) {
+	case 'd':
+	case 'i':
+		prefix = formatSign(spec, arg.u.i < 0);
+		if (arg.u.i < 0)
+			v = -v;
+		break;
+	case 'o':
+		base = 8;
+		break;
+	case 'x':
+	case 'X':
+		base = 16;
+		break;
+	}
+	// an explicit precision of 0 prints nothing for 0
+	if (v != 0 || spec.precision != 0)
+		p = numfmt_radix(v, end, base, spec.conversion == 'X');
+	length = end - p;
+	if (spec.precision > (int)length)
+		zeroes = spec.precision - length;
+	formatField(sink, spec, spec.precision < 0, prefix, strlen(prefix),
+				zeroes, p, length, 0);
+}
+
+// Writes mantissa digits and an exponent, from x >= 0.
+static void formatExponent(FormatSink &sink, const FormatSpec &spec, const char *sign,
+						   double x, int precision)
+{
+	static const double scales[9] = { 1e256, 1e128, 1e64, 1e32, 1e16, 1e8, 1e4, 1e2, 1e1 };
+	static const int16_t exponents[9] = { 256, 128, 64, 32, 16, 8, 4, 2, 1 };
+	int digits = precision > maxPrecision ? maxPrecision : precision;
+	char buffer[16];
+	char *end = buffer + sizeof(buffer);
+	char exponentBuffer[8];
+	char *exponentEnd = exponentBuffer + sizeof(exponentBuffer);
+	char *p;
+	char *e;
+	int exponent = 0;
+	uint64_t mantissa;
+	int i;
+
+	// bring x to [1, 10)
+	if (x >= 10) {
+		for (i = 0; i < 9; i++)
+			if (x >= scales[i]) {
+				x /= scales[i];
+				exponent += exponents[i];
+			}
+	} else if (x > 0 && x < 1) {
+		for (i = 0; i < 9; i++)
+			if (x * scales[i] < 10) {
+				x *= scales[i];
+				exponent -= exponents[i];
+			}
+	}
+	mantissa = (uint64_t)(x * powers[digits] + 0.5);
+	if (mantissa >= (uint64_t)powers[digits] * 10) {
+		mantissa /= 10;
+		exponent++;
+	}
+
+	i = exponent < 0 ? -exponent : exponent;
+	e = numfmt_dec(i, exponentEnd);
+	if (i < 10)
+		*--e = '0';
+	*--e = exponent < 0 ? '-' : '+';
+	*--e = spec.conversion == 'E' ? 'E' : 'e';
+
+	p = end;
+	if (digits > 0) {
+		p = numfmt_dec_width((uint32_t)(mantissa % powers[digits]), p, digits);
+		*--p = '.';
+	}
+	*--p = '0' + (char)(mantissa / powers[digits]);
+	formatField(sink, spec, true, sign, strlen(sign), 0, p, end - p,
+				precision - digits, e, exponentEnd - e);
+}
+
+static void formatDouble(FormatSink &sink, const FormatSpec &spec, double x)
+{
+	int precision = spec.precision < 0 ? 6 : spec.precision;
+	const char *sign = formatSign(spec, x < 0 || (x == 0 && 1 / x < 0));
+	char buffer[NUMFMT_FIXED_SIZE];
+	char *end = buffer + sizeof(buffer);
+	char *p = 0;
+	unsigned int zeroes = 0;
+
+	if (x < 0)
+		x = -x;
+	if (x != x || x > 1.7976931348623157e308) {
+		formatField(sink, spec, false, sign, strlen(sign), 0,
+					x != x ? "nan" : "inf", 3, 0);
+		return;
+	}
+	if (spec.conversion == 'f' || spec.conversion == 'F')
+		p = numfmt_fixed(x, precision, end, &zeroes);
+	if (!p) {
+		// %e, or too large for %f
+		formatExponent(sink, spec, sign, x, precision);
+		return;
+	}
+	formatField(sink, spec, true, sign, strlen(sign), 0, p, end - p, zeroes);
+}
+
+static void formatFixed(FormatSink &sink, const FormatSpec &spec, int32_t value, uint8_t bits)
+{
+	int precision = spec.precision < 0 ? 6 : spec.precision;
+	int digits = precision > maxPrecision ? maxPrecision : precision;
+	const char *sign = formatSign(spec, value < 0);
+	uint32_t magnitude = value < 0 ? -(uint32_t)value : value;
+	uint32_t integer = bits ? magnitude >> bits : magnitude;
+	uint32_t fraction = 0;
+	char buffer[24];
+	char *end = buffer + sizeof(buffer);
+	char *p = end;
+
+	if (bits) {
+		uint64_t f = (uint64_t)(magnitude & ((1UL << bits) - 1)) * powers[digits];
+
+		// round to the nearest last digit
+		fraction = (uint32_t)((f + (1ULL << (bits - 1))) >> bits);
+		if (fraction >= powers[digits]) {
+			fraction -= powers[digits];
+			integer++;
+		}
+	}
+	if (digits > 0) {
+		p = numfmt_dec_width(fraction, p, digits);
+		*--p = '.';
+	}
+	p = numfmt_dec(integer, p);
+	formatField(sink, spec, true, sign, strlen(sign), 0, p, end - p,
+				precision - digits);
+}
+
+void formatConvert(FormatSink &sink, const FormatSpec &spec, const FormatArg &arg)
+{
+	switch (spec.conversion) {
+	case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+		formatInteger(sink, spec, arg);
+		break;
+
+	case 'c': {
+		char c = (char)arg.u.i;
+		formatField(sink, spec, false, "", 0, 0, &c, 1, 0);
+		break;
+	}
+
+	case 's': {
+		const char *s = arg.u.s.p ? arg.u.s.p : "(null)";
+		unsigned int length;
+
+		if (arg.type == FORMAT_ARG_STRING && arg.u.s.p && arg.u.s.length >= 0) {
+			length = arg.u.s.length;
+			if (spec.precision >= 0 && length > (unsigned int)spec.precision)
+				length = spec.precision;
+		} else {
+			// do not look past the precision for the end of the string
+			for (length = 0; s[length]; length++)
+				if (spec.precision >= 0 && length == (unsigned int)spec.precision)
+					break;
+		}
+		formatField(sink, spec, false, "", 0, 0, s, length, 0);
+		break;
+	}
+
+	case 'p': {
+		char buffer[8];
+		char *end = buffer + sizeof(buffer);
+		char *p = numfmt_radix((uint32_t)(uintptr_t)arg.u.p, end, 16, 0);
+
+		formatField(sink, spec, false, "0x", 2, 0, p, end - p, 0);
+		break;
+	}
+
+	case 'f': case 'F': case 'e': case 'E':
+		if (arg.type == FORMAT_ARG_FIXED) {
+			if (spec.conversion == 'f' || spec.conversion == 'F')
+				formatFixed(sink, spec, arg.u.q.value, arg.u.q.bits);
+			else
+				formatDouble(sink, spec, arg.u.q.value / (double)(1ULL << arg.u.q.bits));
+		} else {
+			formatDouble(sink, spec, arg.u.d);
+		}
+		break;
+
+	case '%':
+		sink.put('%');
+		break;
+	}
+}
+
+size_t formatWrite(BetterStream &stream, const FormatSpec *spec, const FormatArg *arg)
+{
+	FormatSink sink(stream);
+
+	for (;; spec++) {
+		sink.put(spec->text, spec->length);
+		if (!spec->conversion)
+			break;
+		if (spec->conversion == '%')
+			sink.put('%');
+		else
+			formatConvert(sink, *spec, *arg++);
+	}
+	return sink.finish();
+}
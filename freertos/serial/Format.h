@@ -0,0 +1,339 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: t -*-
+//
+// printf-style formatting for BetterStream, parsed and checked at compile
+// time.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+
+#ifndef __FORMAT_H__
+#define __FORMAT_H__
+
+#include <inttypes.h>
+#include <stddef.h>
+
+class BetterStream;
+class String;
+
+
+/// @file	Format.h
+/// @brief	The conversion engine behind BetterStream::printf.
+///
+/// A format is cut into specs, each holding the literal text up to a
+/// conversion and the parsed conversion itself; the last spec holds the
+/// trailing text and no conversion.  The arguments are handed over as an
+/// array of FormatArg, one per conversion, that carry their type.
+///
+/// The checked printf (see BetterStream.h) builds the spec table at compile
+/// time and rejects formats whose arguments are missing, extra or of the
+/// wrong type; the variadic printf parses the format as it goes.  Both
+/// share the conversions, which write straight into the transmit buffer the
+/// stream lends, or else through a small stack buffer; neither allocates.
+///
+/// Supported: %d %i %u %o %x %X %c %s %p %f %e %E and %%, the flags
+/// '-', '0', '+' and ' ', a width and a precision of up to 255.  '*' and
+/// %n are not supported.  Integers are converted on 32 bits.  %f computes
+/// up to 19 decimals and falls back to %e past 2^64; %e computes 9 digits
+/// of precision.  Further digits print as zeroes.  A FixedPoint
+/// argument prints with %f without any floating point arithmetic.
+///
+
+#if __cplusplus >= 201402L
+# define FORMAT_CONSTEXPR constexpr
+#else
+# define FORMAT_CONSTEXPR inline
+#endif
+
+/// Flags of a conversion.
+enum {
+	FORMAT_LEFT		= 0x01,		///< '-': pad on the right
+	FORMAT_ZERO		= 0x02,		///< '0': pad numbers with zeroes
+	FORMAT_PLUS		= 0x04,		///< '+': sign positive numbers
+	FORMAT_SPACE	= 0x08,		///< ' ': space before positive numbers
+	FORMAT_SHORT	= 0x10,		///< 'h' length modifier
+	FORMAT_LONG		= 0x20,		///< 'l' length modifier
+	FORMAT_LONGLONG	= 0x40		///< 'll' or 'j' length modifier
+};
+
+/// A run of literal text followed by one conversion.
+struct FormatSpec {
+	const char	*text;			///< literal text before the conversion
+	uint16_t	length;			///< length of the text
+	char		conversion;		///< conversion character, 0 for the last spec,
+								///< '?' for an invalid conversion
+	uint8_t		flags;
+	uint8_t		width;
+	int16_t		precision;		///< -1 if not given
+};
+
+/// A fixed point number in Q format, worth value / 2^fractionBits.
+struct FixedPoint {
+	FixedPoint(int32_t v, uint8_t bits) : value(v), fractionBits(bits) {}
+
+	int32_t		value;
+	uint8_t		fractionBits;	///< 0 to 31
+};
+
+/// Argument types, as checked against the conversions.
+enum {
+	FORMAT_ARG_UNSUPPORTED = 0,
+	FORMAT_ARG_INT,
+	FORMAT_ARG_UNSIGNED,
+	FORMAT_ARG_DOUBLE,
+	FORMAT_ARG_FIXED,
+	FORMAT_ARG_STRING,
+	FORMAT_ARG_POINTER
+};
+
+/// One argument of a conversion, with its type.
+class FormatArg {
+public:
+	FormatArg(void) : type(FORMAT_ARG_UNSUPPORTED) { u.i = 0; }
+	FormatArg(char v) : type(FORMAT_ARG_INT) { u.i = v; }
+	FormatArg(signed char v) : type(FORMAT_ARG_INT) { u.i = v; }
+	FormatArg(unsigned char v) : type(FORMAT_ARG_INT) { u.i = v; }
+	FormatArg(short v) : type(FORMAT_ARG_INT) { u.i = v; }
+	FormatArg(unsigned short v) : type(FORMAT_ARG_INT) { u.i = v; }
+	FormatArg(bool v) : type(FORMAT_ARG_INT) { u.i = v; }
+	FormatArg(int v) : type(FORMAT_ARG_INT) { u.i = v; }
+	FormatArg(long v) : type(FORMAT_ARG_INT) { u.i = (int32_t)v; }
+	FormatArg(unsigned int v) : type(FORMAT_ARG_UNSIGNED) { u.u = v; }
+	FormatArg(unsigned long v) : type(FORMAT_ARG_UNSIGNED) { u.u = (uint32_t)v; }
+	FormatArg(float v) : type(FORMAT_ARG_DOUBLE) { u.d = v; }
+	FormatArg(double v) : type(FORMAT_ARG_DOUBLE) { u.d = v; }
+	FormatArg(const FixedPoint &v) : type(FORMAT_ARG_FIXED) { u.q.value = v.value; u.q.bits = v.fractionBits; }
+	FormatArg(const char *v) : type(FORMAT_ARG_STRING) { u.s.p = v; u.s.length = -1; }
+	FormatArg(const String &v);
+	FormatArg(const void *v) : type(FORMAT_ARG_POINTER) { u.p = v; }
+
+	uint8_t		type;
+	union {
+		int32_t		i;
+		uint32_t	u;
+		double		d;
+		struct { int32_t value; uint8_t bits; } q;
+		struct { const char *p; int length; } s;	///< length -1 if unknown
+		const void	*p;
+	} u;
+};
+
+/// Collects formatted output in the transmit buffer lent by the stream, or
+/// in a stack buffer handed over with write(), and passes it on whenever
+/// the space runs out.
+class FormatSink {
+public:
+	FormatSink(BetterStream &stream);
+	~FormatSink() { finish(); }
+
+	void put(char c) {
+		if (_p == _end)
+			_next();
+		*_p++ = c;
+	}
+	void put(const char *s, size_t n);
+	void fill(char c, unsigned int n);
+
+	/// Passes on the pending output and returns the bytes written so far.
+	size_t finish(void);
+
+private:
+	BetterStream	&_stream;
+	char			*_begin;
+	char			*_p;
+	char			*_end;
+	bool			_lent;			///< _begin is the stream's buffer
+	size_t			_written;
+	char			_buffer[64];
+
+	void	_next(void);
+	void	_hand(void);
+};
+
+/// Parses the text and conversion at f into spec, and returns the next one.
+FORMAT_CONSTEXPR const char *formatParse(const char *f, FormatSpec *spec)
+{
+	const char *text = f;
+
+	while (*f && *f != '%')
+		f++;
+	spec->text = text;
+	spec->length = (uint16_t)(f - text);
+	spec->conversion = 0;
+	spec->flags = 0;
+	spec->width = 0;
+	spec->precision = -1;
+	if (!*f)
+		return f;
+
+	for (f++;; f++) {
+		if (*f == '-')
+			spec->flags |= FORMAT_LEFT;
+		else if (*f == '0')
+			spec->flags |= FORMAT_ZERO;
+		else if (*f == '+')
+			spec->flags |= FORMAT_PLUS;
+		else if (*f == ' ')
+			spec->flags |= FORMAT_SPACE;
+		else if (*f != '#')
+			break;
+	}
+	unsigned int width = 0;
+	for (; *f >= '0' && *f <= '9'; f++)
+		width = width * 10 + (*f - '0');
+	if (*f == '.') {
+		unsigned int precision = 0;
+		for (f++; *f >= '0' && *f <= '9'; f++)
+			precision = precision * 10 + (*f - '0');
+		spec->precision = (int16_t)(precision > 255 ? 255 : precision);
+	}
+	spec->width = (uint8_t)(width > 255 ? 255 : width);
+
+	if (*f == 'h') {
+		spec->flags |= FORMAT_SHORT;
+		if (*++f == 'h')
+			f++;
+	} else if (*f == 'l') {
+		spec->flags |= FORMAT_LONG;
+		if (*++f == 'l') {
+			spec->flags |= FORMAT_LONGLONG;
+			f++;
+		}
+	} else if (*f == 'j') {
+		spec->flags |= FORMAT_LONGLONG;
+		f++;
+	} else if (*f == 'z' || *f == 't' || *f == 'L') {
+		f++;
+	}
+
+	switch (*f) {
+	case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+	case 'c': case 's': case 'p': case 'f': case 'F': case 'e': case 'E':
+	case '%':
+		spec->conversion = *f++;
+		break;
+	default:
+		// '*', %n, unknown or missing conversion
+		spec->conversion = '?';
+		if (*f)
+			f++;
+		break;
+	}
+	return f;
+}
+
+/// Tells if a conversion accepts an argument type.
+FORMAT_CONSTEXPR bool formatAccepts(char conversion, uint8_t type)
+{
+	switch (conversion) {
+	case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+		return type == FORMAT_ARG_INT || type == FORMAT_ARG_UNSIGNED;
+	case 's':
+		return type == FORMAT_ARG_STRING;
+	case 'p':
+		return type == FORMAT_ARG_POINTER || type == FORMAT_ARG_STRING;
+	case 'f': case 'F': case 'e': case 'E':
+		return type == FORMAT_ARG_DOUBLE || type == FORMAT_ARG_FIXED;
+	}
+	return false;
+}
+
+/// Writes the texts and conversions of a spec table, up to and including the
+/// spec without a conversion.  Returns the bytes written.
+size_t formatWrite(BetterStream &stream, const FormatSpec *spec, const FormatArg *arg);
+
+/// Writes one conversion.
+void formatConvert(FormatSink &sink, const FormatSpec &spec, const FormatArg &arg);
+
+#if __cplusplus >= 201402L
+
+/// Wraps a format string literal in a type, for the checked printf:
+///
+///	Serial.printf(FMT("%lu: %5d mV, %.2f C\r\n"), millis(), mv, temperature);
+///
+#define FMT(s) ([] { struct FormatString { static constexpr const char *get(void) { return s; } }; return FormatString(); }())
+
+template <class T> struct FormatArgType { enum { value = FORMAT_ARG_UNSUPPORTED }; };
+template <class T> struct FormatArgType<const T> : FormatArgType<T> {};
+template <class T> struct FormatArgType<T *> { enum { value = FORMAT_ARG_POINTER }; };
+template <> struct FormatArgType<char *> { enum { value = FORMAT_ARG_STRING }; };
+template <> struct FormatArgType<const char *> { enum { value = FORMAT_ARG_STRING }; };
+template <size_t N> struct FormatArgType<char[N]> { enum { value = FORMAT_ARG_STRING }; };
+template <> struct FormatArgType<String> { enum { value = FORMAT_ARG_STRING }; };
+template <> struct FormatArgType<FixedPoint> { enum { value = FORMAT_ARG_FIXED }; };
+template <> struct FormatArgType<float> { enum { value = FORMAT_ARG_DOUBLE }; };
+template <> struct FormatArgType<double> { enum { value = FORMAT_ARG_DOUBLE }; };
+template <> struct FormatArgType<char> { enum { value = FORMAT_ARG_INT }; };
+template <> struct FormatArgType<signed char> { enum { value = FORMAT_ARG_INT }; };
+template <> struct FormatArgType<unsigned char> { enum { value = FORMAT_ARG_INT }; };
+template <> struct FormatArgType<short> { enum { value = FORMAT_ARG_INT }; };
+template <> struct FormatArgType<unsigned short> { enum { value = FORMAT_ARG_INT }; };
+template <> struct FormatArgType<bool> { enum { value = FORMAT_ARG_INT }; };
+template <> struct FormatArgType<int> { enum { value = FORMAT_ARG_INT }; };
+template <> struct FormatArgType<long> { enum { value = FORMAT_ARG_INT }; };
+template <> struct FormatArgType<unsigned int> { enum { value = FORMAT_ARG_UNSIGNED }; };
+template <> struct FormatArgType<unsigned long> { enum { value = FORMAT_ARG_UNSIGNED }; };
+
+/// The specs of a format, built at compile time.
+template <unsigned int N>
+struct FormatTable {
+	FormatSpec	spec[N];
+};
+
+/// Results of formatCheck().
+enum {
+	FORMAT_OK = 0,
+	FORMAT_INVALID,				///< unsupported conversion
+	FORMAT_TOO_FEW,				///< more conversions than arguments
+	FORMAT_TOO_MANY,			///< more arguments than conversions
+	FORMAT_MISMATCH				///< an argument does not suit its conversion
+};
+
+/// Counts the specs of a format.
+constexpr unsigned int formatSpecs(const char *f)
+{
+	FormatSpec spec {};
+	unsigned int n = 1;
+
+	while ((f = formatParse(f, &spec)), spec.conversion)
+		n++;
+	return n;
+}
+
+template <unsigned int N>
+constexpr FormatTable<N> formatTable(const char *f)
+{
+	FormatTable<N> table {};
+
+	for (unsigned int i = 0; i < N; i++)
+		f = formatParse(f, &table.spec[i]);
+	return table;
+}
+
+/// Checks the argument types against the conversions of a table.
+template <unsigned int N>
+constexpr int formatCheck(const FormatTable<N> &table, const uint8_t *types, unsigned int count)
+{
+	unsigned int n = 0;
+
+	for (unsigned int i = 0; i < N - 1; i++) {
+		char conversion = table.spec[i].conversion;
+
+		if (conversion == '?')
+			return FORMAT_INVALID;
+		if (conversion == '%')
+			continue;
+		if (n == count)
+			return FORMAT_TOO_FEW;
+		if (!formatAccepts(conversion, types[n++]))
+			return FORMAT_MISMATCH;
+	}
+	return n < count ? FORMAT_TOO_MANY : FORMAT_OK;
+}
+
+#endif // __cplusplus >= 201402L
+
+#endif // __FORMAT_H__
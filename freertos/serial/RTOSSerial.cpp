@@ -56,6 +56,12 @@ xQueueHandle __RTOSSerial__rxQueue[FS_MAX_PORTS];
 xQueueHandle __RTOSSerial__txQueue[FS_MAX_PORTS];
 uint8_t RTOSSerial::_serialInitialized = 0;
 
+// Milliseconds to ticks, rounded up so that a wait is never cut short.
+static portTickType msToTicks(unsigned long ms)
+{
+	return ms / portTICK_RATE_MS + (ms % portTICK_RATE_MS != 0);
+}
+
 // Constructor /////////////////////////////////////////////////////////////////
 
 RTOSSerial::RTOSSerial(const uint8_t portNumber, volatile uint8_t *ubrrh, volatile uint8_t *ubrrl,
@@ -183,6 +189,16 @@ int RTOSSerial::peek(void)
   return (-1);
 }
 
+// A blocking peek sleeps until the receive interrupt queues a byte, or the
+// timeout expires.
+bool RTOSSerial::waitAvailable(unsigned long timeout)
+{
+  uint8_t c;
+
+  if (!_open) return false;
+  return xQueuePeek(*_rxQueue, &c, msToTicks(timeout)) != errQUEUE_EMPTY;
+}
+
 void RTOSSerial::flush(void)
 {
   // Replaced with a no-op. Hopefully this does not cause problems.
@@ -190,15 +206,27 @@ void RTOSSerial::flush(void)
 
 size_t RTOSSerial::write(uint8_t c)
 {
-	uint16_t i;
+	return write(&c, 1);
+}
+
+size_t RTOSSerial::write(const uint8_t *buffer, size_t size)
+{
+	size_t i;
 
 	if (!_open) // drop bytes if not open
 		return 0;
 
-  xQueueSendToBack(*_txQueue, (void *) &c, portMAX_DELAY );
+	// Queue the span without blocking while there is room, and only start
+	// the transmitter before waiting for it to drain some, so that a whole
+	// line costs one call and one interrupt enable.
+	for (i = 0; i < size; i++) {
+		if (xQueueSendToBack(*_txQueue, (void *) &buffer[i], 0) != pdPASS) {
+			*_ucsrb |= _portTxBits;
+			xQueueSendToBack(*_txQueue, (void *) &buffer[i], portMAX_DELAY);
+		}
+	}
 
 	// enable the data-ready interrupt, as it may be off if the buffer is empty
 	*_ucsrb |= _portTxBits;
-  return 1;
+	return size;
 }
-
@@ -122,8 +122,10 @@ public:
 	virtual int txspace(void);
 	virtual int read(void);
 	virtual int peek(void);
+	virtual bool waitAvailable(unsigned long timeout);
 	virtual void flush(void);
 	virtual size_t write(uint8_t c);
+	virtual size_t write(const uint8_t *buffer, size_t size);
 	using BetterStream::write;
 	//@}
 
@@ -0,0 +1,555 @@
+// -*-  tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: t -*-
+//
+// USB CDC ACM serial port, for use with the FreeRTOS kernel.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later version.
+//
+
+#include <string.h>
+
+#include "USBSerial.h"
+extern "C" {
+#include <task.h>
+#include <board.h>
+#include <usb/device/core/USBD.h>
+#include <usb/device/cdc-serial/CDCDSerialDriver.h>
+#include <usb/device/cdc-serial/CDCDSerialDriverDescriptors.h>
+
+// from irq/irq.h, which brings in the CMSIS core header that C++ rejects
+void IRQ_ConfigureIT(unsigned int source, unsigned int mode, void (*handler)(void));
+void IRQ_EnableIT(unsigned int source);
+}
+
+// Milliseconds to ticks, rounded up so that a wait is never cut short.
+static portTickType msToTicks(unsigned long ms)
+{
+	return ms / portTICK_RATE_MS + (ms % portTICK_RATE_MS != 0);
+}
+
+USBSerial *USBSerial::_port;
+
+// Constructor /////////////////////////////////////////////////////////////////
+
+USBSerial::USBSerial(void) :
+	_open(false),
+	_flushTimeout(_default_flush_timeout),
+	_writeTimeout(_default_write_timeout),
+	_txMutex(NULL),
+	_txDone(NULL),
+	_rxReady(NULL),
+	_flushTimer(NULL)
+{
+}
+
+// Public Methods //////////////////////////////////////////////////////////////
+
+void USBSerial::begin(long baud)
+{
+	// the baud rate is whatever the host asks for, and has no effect
+	if (_open)
+		return;
+
+	if (_txMutex == NULL) {
+		_txMutex = xSemaphoreCreateMutex();
+		vSemaphoreCreateBinary(_txDone);
+		vSemaphoreCreateBinary(_rxReady);
+		_flushTimer = xTimerCreate((const signed char *) "usbflush", _flushTimeout,
+								   pdFALSE, this, _flushCallback);
+		if (_txMutex == NULL || _txDone == NULL || _rxReady == NULL || _flushTimer == NULL)
+			return; // couldn't allocate - fatal
+		xSemaphoreTake(_txDone, 0);
+		xSemaphoreTake(_rxReady, 0);
+	}
+
+	_txLength[0] = _txLength[1] = 0;
+	_txBusy[0] = _txBusy[1] = false;
+	_txFill = _txNext = 0;
+	_txZlp = _txLocked = _txFailed = false;
+	_rxState[0] = _rxState[1] = RX_IDLE;
+	_rxHead = 0;
+	_rxPos = 0;
+	_port = this;
+
+	CDCDSerialDriver_Initialize();
+
+	// The USB driver installs its interrupt at the highest priority, where it
+	// may not use the FreeRTOS API; move it down to the highest priority that
+	// can.  The completion callbacks below run in that interrupt.
+	IRQ_ConfigureIT(AT91C_ID_UDPHS, configMAX_SYSCALL_INTERRUPT_PRIORITY >> 4, UDPD_IrqHandler);
+	IRQ_EnableIT(AT91C_ID_UDPHS);
+
+	_open = true;
+	USBD_Connect();
+}
+
+void USBSerial::end()
+{
+	_open = false;
+	USBD_Disconnect();
+}
+
+bool USBSerial::connected(void)
+{
+	return _open && USBD_GetState() == USBD_STATE_CONFIGURED;
+}
+
+int USBSerial::available(void)
+{
+	int count = 0;
+
+	if (!_open)
+		return (-1);
+
+	taskENTER_CRITICAL();
+	_rxPoll();
+	if (_rxState[_rxHead] == RX_FULL) {
+		count = _rxLength[_rxHead] - _rxPos;
+		if (_rxState[_rxHead ^ 1] == RX_FULL)
+			count += _rxLength[_rxHead ^ 1];
+	}
+	taskEXIT_CRITICAL();
+	return count;
+}
+
+int USBSerial::txspace(void)
+{
+	int space = 0;
+
+	if (!_open)
+		return (-1);
+	for (uint8_t i = 0; i < 2; i++)
+		if (!_txBusy[i])
+			space += _buffer_size - _txLength[i];
+	return space;
+}
+
+int USBSerial::read(void)
+{
+	int c = -1;
+
+	if (!_open)
+		return (-1);
+
+	taskENTER_CRITICAL();
+	_rxPoll();
+	taskEXIT_CRITICAL();
+
+	// a full buffer is not touched by the driver until it is re-armed
+	if (_rxState[_rxHead] == RX_FULL && _rxPos < _rxLength[_rxHead])
+		c = _rxData[_rxHead][_rxPos++];
+	return c;
+}
+
+int USBSerial::peek(void)
+{
+	int c = -1;
+
+	if (!_open)
+		return (-1);
+
+	taskENTER_CRITICAL();
+	_rxPoll();
+	taskEXIT_CRITICAL();
+
+	if (_rxState[_rxHead] == RX_FULL && _rxPos < _rxLength[_rxHead])
+		c = _rxData[_rxHead][_rxPos];
+	return c;
+}
+
+// Sleeps until a receive buffer completes, or the timeout expires.  The
+// semaphore may have been given for data that was read since, so the caller
+// reads again.
+bool USBSerial::waitAvailable(unsigned long timeout)
+{
+	if (!_open)
+		return false;
+	if (available() > 0)
+		return true;
+	return xSemaphoreTake(_rxReady, msToTicks(timeout)) == pdTRUE;
+}
+
+// Lends the unread part of the read buffer.  Like read(), this assumes a
+// single reader.
+const uint8_t *USBSerial::rxAcquire(size_t *count)
+{
+	if (!_open)
+		return NULL;
+
+	taskENTER_CRITICAL();
+	_rxPoll();
+	taskEXIT_CRITICAL();
+
+	if (_rxState[_rxHead] == RX_FULL && _rxPos < _rxLength[_rxHead]) {
+		*count = _rxLength[_rxHead] - _rxPos;
+		return &_rxData[_rxHead][_rxPos];
+	}
+	return NULL;
+}
+
+void USBSerial::rxRelease(size_t used)
+{
+	_rxPos += used;
+
+	// re-arm a drained buffer at once
+	taskENTER_CRITICAL();
+	_rxPoll();
+	taskEXIT_CRITICAL();
+}
+
+void USBSerial::flush(void)
+{
+	if (!connected())
+		return;
+	if (xSemaphoreTake(_txMutex, _writeTimeout) != pdTRUE)
+		return;
+	_txLocked = true;
+
+	// send what is pending, then wait for everything to leave
+	while (!_txSend())
+		if (!_txWait())
+			break;
+	while (_txBusy[0] || _txBusy[1] || _txZlp)
+		if (!_txWait())
+			break;
+
+	_txLocked = false;
+	xSemaphoreGive(_txMutex);
+}
+
+size_t USBSerial::write(uint8_t c)
+{
+	return write(&c, 1);
+}
+
+size_t USBSerial::write(const uint8_t *buffer, size_t size)
+{
+	size_t written = 0;
+	bool ok = true;
+
+	if (!connected()) { // drop bytes if nobody is listening
+		setWriteError();
+		return 0;
+	}
+	if (xSemaphoreTake(_txMutex, _writeTimeout) != pdTRUE) {
+		setWriteError();
+		return 0;
+	}
+	_txLocked = true;
+
+	while (ok && written < size) {
+		uint8_t i = _txFill;
+		unsigned int count;
+
+		if (_txBusy[i]) {
+			ok = _txWait();
+			continue;
+		}
+
+		count = _buffer_size - _txLength[i];
+		if (count > size - written)
+			count = size - written;
+
+		// the first byte in an empty buffer starts the flush timeout
+		if (_txLength[i] == 0)
+			xTimerChangePeriod(_flushTimer, _flushTimeout, 0);
+
+		memcpy(&_txData[i][_txLength[i]], buffer + written, count);
+		_txLength[i] += count;
+		written += count;
+
+		if (_txLength[i] == _buffer_size) {
+			while (ok && !_txSend())
+				ok = _txWait();
+		}
+	}
+
+	if (_txFailed) {
+		_txFailed = false;
+		setWriteError();
+	}
+
+	_txLocked = false;
+	xSemaphoreGive(_txMutex);
+	return written;
+}
+
+// Lends the free part of the fill buffer, keeping the writers out until
+// txRelease().
+uint8_t *USBSerial::txAcquire(size_t *space)
+{
+	*space = 0;
+	if (!connected())
+		return NULL;
+	if (xSemaphoreTake(_txMutex, _writeTimeout) != pdTRUE)
+		return NULL;
+	_txLocked = true;
+
+	for (;;) {
+		uint8_t i = _txFill;
+
+		if (_txBusy[i]) {
+			if (!_txWait())
+				break;
+		} else if (_txLength[i] == _buffer_size) {
+			// left full by a write that timed out
+			if (!_txSend() && !_txWait())
+				break;
+		} else {
+			*space = _buffer_size - _txLength[i];
+			return &_txData[i][_txLength[i]];
+		}
+	}
+
+	_txLocked = false;
+	xSemaphoreGive(_txMutex);
+	return NULL;
+}
+
+void USBSerial::txRelease(size_t used)
+{
+	uint8_t i = _txFill;
+	bool ok = true;
+
+	// the first byte in an empty buffer starts the flush timeout
+	if (used > 0 && _txLength[i] == 0)
+		xTimerChangePeriod(_flushTimer, _flushTimeout, 0);
+	_txLength[i] += used;
+
+	if (_txLength[i] == _buffer_size) {
+		while (ok && !_txSend())
+			ok = _txWait();
+	}
+
+	if (_txFailed) {
+		_txFailed = false;
+		setWriteError();
+	}
+
+	_txLocked = false;
+	xSemaphoreGive(_txMutex);
+}
+
+// Private Methods /////////////////////////////////////////////////////////////
+
+// Queues the fill buffer on the IN endpoint.  Called with the USB interrupt
+// masked.  Returns false if the buffer has to wait for the endpoint.
+bool USBSerial::_txSubmit(void)
+{
+	uint8_t i = _txFill;
+
+	if (_txLength[i] == 0)
+		return true;
+	if (_txBusy[i] || _txZlp)
+		return false;
+
+	_txBusy[i] = true;
+	if (CDCDSerialDriver_QueueWrite(_txData[i], _txLength[i], _txCallback, this)
+		!= USBD_STATUS_SUCCESS) {
+		// not configured or reset; the data is lost
+		_txBusy[i] = false;
+		_txLength[i] = 0;
+		_txFailed = true;
+		return true;
+	}
+	_txFill = i ^ 1;
+	return true;
+}
+
+bool USBSerial::_txSend(void)
+{
+	bool sent;
+
+	taskENTER_CRITICAL();
+	sent = _txSubmit();
+	taskEXIT_CRITICAL();
+	return sent;
+}
+
+// Waits for a transmit completion.  Returns false on timeout, after flagging
+// the write error.
+bool USBSerial::_txWait(void)
+{
+	if (!connected() || xSemaphoreTake(_txDone, _writeTimeout) != pdTRUE) {
+		setWriteError();
+		return false;
+	}
+	return true;
+}
+
+void USBSerial::_txComplete(unsigned char status, unsigned int transferred)
+{
+	signed portBASE_TYPE yieldWhenComplete = pdFALSE;
+	uint8_t i = _txNext;
+	unsigned int packetSize = USBD_IsHighSpeed() ? 512 : 64;
+
+	// transfers complete in the order they were queued
+	_txBusy[i] = false;
+	_txLength[i] = 0;
+	_txNext = i ^ 1;
+
+	if (status == USBD_STATUS_SUCCESS) {
+		if (!_txLocked && !_txBusy[_txFill] && _txLength[_txFill] > 0) {
+			// more data is waiting and no writer is adding to it
+			_txSubmit();
+		} else if (transferred > 0 && (transferred % packetSize) == 0
+				   && !_txBusy[i ^ 1] && _txLength[_txFill] == 0) {
+			// the host needs a short packet to see the end of the data
+			_txZlp = true;
+			if (USBD_Write(CDCDSerialDriverDescriptors_DATAIN, 0, 0, _zlpCallback, this)
+				!= USBD_STATUS_SUCCESS)
+				_txZlp = false;
+		}
+	} else {
+		// aborted by a reset or a configuration change; the data is lost
+		_txFailed = true;
+	}
+
+	xSemaphoreGiveFromISR(_txDone, &yieldWhenComplete);
+	portEND_SWITCHING_ISR(yieldWhenComplete);
+}
+
+void USBSerial::_zlpComplete(unsigned char status)
+{
+	signed portBASE_TYPE yieldWhenComplete = pdFALSE;
+
+	// a reset ends the packet while it resets the endpoints; queueing on them
+	// now would be lost
+	_txZlp = false;
+	if (status == USBD_STATUS_SUCCESS && !_txLocked)
+		_txSubmit();
+
+	xSemaphoreGiveFromISR(_txDone, &yieldWhenComplete);
+	portEND_SWITCHING_ISR(yieldWhenComplete);
+}
+
+// Queues an idle receive buffer on the OUT endpoint.  Called with the USB
+// interrupt masked.
+void USBSerial::_rxArm(uint8_t i)
+{
+	if (_rxState[i] != RX_IDLE)
+		return;
+
+	_rxState[i] = RX_QUEUED;
+	if (CDCDSerialDriver_QueueRead(_rxData[i], _buffer_size, i ? _rxCallback1 : _rxCallback0, this)
+		!= USBD_STATUS_SUCCESS)
+		_rxState[i] = RX_IDLE;
+}
+
+// Releases the consumed buffer and keeps both buffers queued.  Buffers are
+// armed starting from the read buffer, so they always complete in the order
+// they are read.  Called with the USB interrupt masked.
+void USBSerial::_rxPoll(void)
+{
+	while (_rxState[_rxHead] == RX_FULL && _rxPos >= _rxLength[_rxHead]) {
+		_rxState[_rxHead] = RX_IDLE;
+		_rxHead ^= 1;
+		_rxPos = 0;
+	}
+
+	if (USBD_GetState() == USBD_STATE_CONFIGURED) {
+		_rxArm(_rxHead);
+		_rxArm(_rxHead ^ 1);
+	}
+}
+
+void USBSerial::_rxComplete(uint8_t i, unsigned char status, unsigned int transferred)
+{
+	signed portBASE_TYPE yieldWhenComplete = pdFALSE;
+
+	if (status == USBD_STATUS_SUCCESS) {
+		_rxLength[i] = transferred;
+		_rxState[i] = RX_FULL;
+		xSemaphoreGiveFromISR(_rxReady, &yieldWhenComplete);
+	} else {
+		// aborted by a reset or a configuration change
+		_rxState[i] = RX_IDLE;
+	}
+	portEND_SWITCHING_ISR(yieldWhenComplete);
+}
+
+// Puts the buffers back to idle after a bus reset or a configuration change,
+// which end every transfer on the data endpoints; not all of them are called
+// back (unconfiguring the device drops the queued ones), and a buffer left
+// busy would hold the writers and the reader for good.  Data in flight is
+// lost.  Once configured, the receive buffers are queued again without
+// waiting for the reader to poll.  Runs in the USB interrupt.
+void USBSerial::_usbReset(bool configured)
+{
+	signed portBASE_TYPE yieldWhenComplete = pdFALSE;
+
+	for (uint8_t i = 0; i < 2; i++) {
+		if (_txBusy[i]) {
+			_txBusy[i] = false;
+			_txLength[i] = 0;
+			_txFailed = true;
+		}
+		if (_rxState[i] == RX_QUEUED)
+			_rxState[i] = RX_IDLE;
+	}
+	_txNext = _txFill;
+	_txZlp = false;
+
+	if (configured) {
+		_rxArm(_rxHead);
+		_rxArm(_rxHead ^ 1);
+	}
+
+	// wake a writer waiting for a buffer
+	xSemaphoreGiveFromISR(_txDone, &yieldWhenComplete);
+	portEND_SWITCHING_ISR(yieldWhenComplete);
+}
+
+void USBSerial::_txCallback(void *arg, unsigned char status, unsigned int transferred, unsigned int remaining)
+{
+	((USBSerial *) arg)->_txComplete(status, transferred);
+}
+
+void USBSerial::_zlpCallback(void *arg, unsigned char status, unsigned int transferred, unsigned int remaining)
+{
+	((USBSerial *) arg)->_zlpComplete(status);
+}
+
+void USBSerial::_rxCallback0(void *arg, unsigned char status, unsigned int transferred, unsigned int remaining)
+{
+	((USBSerial *) arg)->_rxComplete(0, status, transferred);
+}
+
+void USBSerial::_rxCallback1(void *arg, unsigned char status, unsigned int transferred, unsigned int remaining)
+{
+	((USBSerial *) arg)->_rxComplete(1, status, transferred);
+}
+
+// Sends a partially filled buffer once the flush timeout expires.  Runs in the
+// timer task, which must not block; if a writer holds the buffer, try again
+// later.
+void USBSerial::_flushCallback(xTimerHandle timer)
+{
+	USBSerial *port = (USBSerial *) pvTimerGetTimerID(timer);
+
+	if (xSemaphoreTake(port->_txMutex, 0) != pdTRUE) {
+		xTimerChangePeriod(timer, port->_flushTimeout, 0);
+		return;
+	}
+	port->_txLocked = true;
+	if (!port->_txSend())
+		xTimerChangePeriod(timer, port->_flushTimeout, 0);
+	port->_txLocked = false;
+	xSemaphoreGive(port->_txMutex);
+}
+
+// USB core callbacks //////////////////////////////////////////////////////////
+
+void USBDCallbacks_Reset(void)
+{
+	if (USBSerial::_port != NULL)
+		USBSerial::_port->_usbReset(false);
+}
+
+void USBDDriverCallbacks_ConfigurationChanged(unsigned char cfgnum)
+{
+	if (USBSerial::_port != NULL)
+		USBSerial::_port->_usbReset(cfgnum != 0);
+}
@@ -0,0 +1,160 @@
+// -*- tab-width: 4; Mode: C++; c-basic-offset: 4; indent-tabs-mode: t -*-
+//
+// USB CDC ACM serial port, for use with the FreeRTOS kernel.
+//
+//      This library is free software; you can redistribute it and/or
+//      modify it under the terms of the GNU Lesser General Public
+//      License as published by the Free Software Foundation; either
+//      version 2.1 of the License, or (at your option) any later
+//      version.
+//
+
+#ifndef __USB_SERIAL_H__
+#define __USB_SERIAL_H__
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+extern "C" {
+#include <FreeRTOS.h>
+#include <semphr.h>
+#include <timers.h>
+
+// USB core callbacks, through which the port learns of a bus reset or of a
+// configuration change
+void USBDCallbacks_Reset(void);
+void USBDDriverCallbacks_ConfigurationChanged(unsigned char cfgnum);
+}
+#include "BetterStream.h"
+
+
+/// @file	USBSerial.h
+/// @brief	A serial port over the USB CDC ACM class driver.
+///
+/// Both directions are double buffered with packet sized buffers that are
+/// queued on the bulk endpoints, so the DMA moves one buffer while the
+/// application fills or drains the other.
+///
+/// Transmitted data is collected in the current buffer and sent when the
+/// buffer is full, when flush() is called, or when the flush timeout expires
+/// after the first byte was written into an empty buffer.  A transfer that
+/// ends on a packet boundary is followed by a zero length packet when no
+/// more data is pending, so that the host's read completes.  printf formats
+/// in place in the current buffer, which the port lends with txAcquire().
+///
+/// A task waiting for input in the Stream timed reads sleeps until a receive
+/// buffer completes, rather than polling.  find() scans the receive buffer in
+/// place, which the port lends with rxAcquire().
+///
+/// Writes block while both buffers are in flight, for at most the write
+/// timeout; data that cannot be sent in time, or while the host has not
+/// configured the device, is dropped and flagged with setWriteError().
+///
+/// A bus reset or a new configuration ends the transfers in flight: their
+/// data is dropped, and the receive buffers are queued again as soon as the
+/// host configures the device.
+///
+/// @note	The software timers (configUSE_TIMERS) must be enabled, and only
+///			one instance may exist as it owns the CDC class driver and the
+///			USB core callbacks; freertos_serial is linked before the USB
+///			device library so that they replace its defaults.
+///
+class USBSerial: public BetterStream {
+public:
+
+	/// Constructor
+	USBSerial(void);
+
+	/// @name 	Serial API
+	//@{
+	virtual void begin(long baud);
+	virtual void end(void);
+	virtual int available(void);
+	virtual int txspace(void);
+	virtual int read(void);
+	virtual int peek(void);
+	virtual bool waitAvailable(unsigned long timeout);
+	virtual const uint8_t *rxAcquire(size_t *count);
+	virtual void rxRelease(size_t used);
+	virtual void flush(void);
+	virtual size_t write(uint8_t c);
+	virtual size_t write(const uint8_t *buffer, size_t size);
+	using BetterStream::write;
+	virtual uint8_t *txAcquire(size_t *space);
+	virtual void txRelease(size_t used);
+	//@}
+
+	/// Sets how long a partially filled buffer is held back waiting for
+	/// more data, in ticks.
+	void setFlushTimeout(portTickType ticks) { _flushTimeout = ticks ? ticks : 1; }
+
+	/// Sets how long a write blocks waiting for a free buffer, in ticks.
+	void setWriteTimeout(portTickType ticks) { _writeTimeout = ticks; }
+
+	/// Tell if the host has configured the device
+	bool connected(void);
+
+private:
+
+	enum { RX_IDLE, RX_QUEUED, RX_FULL };
+
+	/// size of each transmit and receive buffer; a multiple of the bulk
+	/// endpoint packet size at both full and high speed
+	static const unsigned int	_buffer_size = 512;
+
+	/// default flush timeout, in ticks
+	static const portTickType	_default_flush_timeout = 2;
+
+	/// default write timeout, in ticks
+	static const portTickType	_default_write_timeout = 100;
+
+	bool				_open;
+	portTickType		_flushTimeout;
+	portTickType		_writeTimeout;
+
+	xSemaphoreHandle	_txMutex;			///< serializes the writers
+	xSemaphoreHandle	_txDone;			///< given on every transmit completion
+	xSemaphoreHandle	_rxReady;			///< given on every receive completion
+	xTimerHandle		_flushTimer;
+
+	// transmit buffers
+	uint8_t				_txData[2][_buffer_size] __attribute__((aligned(4)));
+	volatile unsigned int _txLength[2];
+	volatile bool		_txBusy[2];
+	volatile uint8_t	_txFill;			///< buffer being filled
+	volatile uint8_t	_txNext;			///< oldest buffer in flight
+	volatile bool		_txZlp;				///< zero length packet in flight
+	volatile bool		_txLocked;			///< a writer owns the fill buffer
+	volatile bool		_txFailed;			///< a buffer was dropped
+
+	// receive buffers
+	uint8_t				_rxData[2][_buffer_size] __attribute__((aligned(4)));
+	volatile unsigned int _rxLength[2];
+	volatile uint8_t	_rxState[2];
+	uint8_t				_rxHead;			///< buffer being read
+	unsigned int		_rxPos;				///< read position in _rxHead
+
+	static USBSerial	*_port;				///< the instance begin() was called on
+
+	bool	_txSubmit(void);
+	bool	_txSend(void);
+	bool	_txWait(void);
+	void	_txComplete(unsigned char status, unsigned int transferred);
+	void	_zlpComplete(unsigned char status);
+	void	_rxArm(uint8_t i);
+	void	_rxPoll(void);
+	void	_rxComplete(uint8_t i, unsigned char status, unsigned int transferred);
+	void	_usbReset(bool configured);
+
+	// driver callbacks
+	static void _txCallback(void *arg, unsigned char status, unsigned int transferred, unsigned int remaining);
+	static void _zlpCallback(void *arg, unsigned char status, unsigned int transferred, unsigned int remaining);
+	static void _rxCallback0(void *arg, unsigned char status, unsigned int transferred, unsigned int remaining);
+	static void _rxCallback1(void *arg, unsigned char status, unsigned int transferred, unsigned int remaining);
+	static void _flushCallback(xTimerHandle timer);
+
+	friend void USBDCallbacks_Reset(void);
+	friend void USBDDriverCallbacks_ConfigurationChanged(unsigned char cfgnum);
+};
+
+#endif // __USB_SERIAL_H__
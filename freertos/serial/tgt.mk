@@ -1,11 +1,14 @@
 
 libs += freertos_serial
 freertos_serial_path := $(FREERTOS)/serial
-freertos_serial_objs := BetterStream.o RTOSSerial.o
+freertos_serial_objs := BetterStream.o Format.o RTOSSerial.o USBSerial.o wiring.o
 freertos_serial_cflags := \
 	-I$(FREERTOS)/serial \
 	-I$(FREERTOS)/include \
 	-I$(FREERTOS_PORT) \
 	-I$(CPLUSPLUS) \
-	-I$(ARDUINOCORE)
-
+	-I$(ARDUINOCORE) \
+	-I$(AT91LIB) \
+	-I$(AT91LIB)/peripherals \
+	-I$(AT91LIB)/boards/$(BOARD) \
+	-I$(TOP)
@@ -0,0 +1,313 @@
+//------------------------------------------------------------------------------
+// USBSerial benchmark on the simulated UDPHS controller.
+//
+// The device echoes what it receives through USBSerial, from the main loop
+// that the virtual host runs after every transaction, and the host measures
+// the round trip of 100 bytes, which the flush timeout holds back.
+//
+// Then the host enumerates the device again while both transmit buffers are
+// in flight, as the host never reads them, and both receive buffers are
+// queued; and again with a SET_CONFIGURATION of 0 then 1. Each time, the
+// transmit buffers must be free again, a transfer from the host received
+// without the device calling the port, and the echo must work again. At
+// full speed, the data that was in flight must be flagged with a write
+// error; at high speed, the banks of the controller may have taken all of it
+// before the reset, and the port never sees that it was lost.
+//
+// The kernel is the host port of the queue benchmark, whose blocking waits
+// time out at once, so the device writes only when both buffers are free.
+// The flush timer of the port runs from the main loop, on the bus time.
+//
+//   ./serialbench [fs]
+//------------------------------------------------------------------------------
+
+#include <USBSerial.h>
+#include <wiring.h>
+
+extern "C" {
+#include "simboard.h"
+#include "vhost.h"
+
+#include <board.h>
+#include <usb/device/cdc-serial/CDCDSerialDriverDescriptors.h>
+}
+
+#include <stdio.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Round trips of the echo test, and their size.
+#define PINGS               50
+#define PINGSIZE            100
+
+/// Data written with the transmit buffers in flight.
+#define PENDINGSIZE         1024
+
+/// Endpoints seen from the host.
+#define DATAOUT             CDCDSerialDriverDescriptors_DATAOUT
+#define DATAIN              (0x80 | CDCDSerialDriverDescriptors_DATAIN)
+
+/// One second of bus time, in ns.
+#define TIMEOUT             1000000000ULL
+
+/// The software timer of the port.
+struct Timer {
+    tmrTIMER_CALLBACK callback;
+    void *pId;
+    portTickType period;
+    portTickType start;
+    bool active;
+};
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+static USBSerial port;
+static Timer timer;
+
+/// The device echoes what it receives.
+static bool echo;
+
+static unsigned char pending[PENDINGSIZE];
+
+//------------------------------------------------------------------------------
+//         Kernel and board
+//------------------------------------------------------------------------------
+
+/// Ticks of the bus time.
+static portTickType Ticks(void)
+{
+    return (portTickType) (VHost_GetTime() / 1000000);
+}
+
+extern "C" xTimerHandle xTimerCreate(const signed char *pcTimerName,
+                                     portTickType xTimerPeriodInTicks,
+                                     unsigned portBASE_TYPE uxAutoReload,
+                                     void *pvTimerID,
+                                     tmrTIMER_CALLBACK pxCallbackFunction)
+{
+    timer.callback = pxCallbackFunction;
+    timer.pId = pvTimerID;
+    timer.period = xTimerPeriodInTicks;
+    return &timer;
+}
+
+extern "C" void *pvTimerGetTimerID(xTimerHandle xTimer)
+{
+    return ((Timer *) xTimer)->pId;
+}
+
+extern "C" portBASE_TYPE xTimerGenericCommand(xTimerHandle xTimer,
+                                              portBASE_TYPE xCommandID,
+                                              portTickType xOptionalValue,
+                                              signed portBASE_TYPE *pxHigherPriorityTaskWoken,
+                                              portTickType xBlockTime)
+{
+    Timer *pTimer = (Timer *) xTimer;
+
+    if (xCommandID == tmrCOMMAND_CHANGE_PERIOD) {
+
+        pTimer->period = xOptionalValue;
+    }
+    pTimer->start = Ticks();
+    pTimer->active = (xCommandID != tmrCOMMAND_STOP)
+                     && (xCommandID != tmrCOMMAND_DELETE);
+    return pdPASS;
+}
+
+/// The interrupt is hooked by USBDCallbacks_Initialized() in simboard.c.
+extern "C" void IRQ_ConfigureIT(unsigned int source,
+                                unsigned int mode,
+                                void (*handler)(void))
+{
+}
+
+// The time base of the core, from the bus time.
+unsigned long millis(void)
+{
+    return (unsigned long) (VHost_GetTime() / 1000000);
+}
+
+unsigned long micros(void)
+{
+    return (unsigned long) (VHost_GetTime() / 1000);
+}
+
+//------------------------------------------------------------------------------
+//         Device
+//------------------------------------------------------------------------------
+
+/// Main loop of the device: expires the timer, and echoes what came in.
+static void Loop(void)
+{
+    const uint8_t *pData;
+    size_t count;
+
+    if (timer.active && (portTickType) (Ticks() - timer.start) >= timer.period) {
+
+        timer.active = false;
+        timer.callback(&timer);
+    }
+    if (!echo) {
+
+        return;
+    }
+    pData = port.rxAcquire(&count);
+    if ((pData != NULL) && (port.txspace() == PENDINGSIZE)) {
+
+        if (count > PINGSIZE) {
+
+            count = PINGSIZE;
+        }
+        port.write(pData, count);
+        port.rxRelease(count);
+    }
+}
+
+//------------------------------------------------------------------------------
+//         Host
+//------------------------------------------------------------------------------
+
+static unsigned char Ping(const char *label)
+{
+    unsigned char out[PINGSIZE];
+    unsigned char in[512];
+    VHostTransfer outTransfer;
+    VHostTransfer inTransfer;
+    unsigned long long total = 0;
+    unsigned int i;
+
+    SimBoard_Begin();
+    for (i = 0; i < PINGS; i++) {
+
+        memset(out, i, sizeof(out));
+        memset(&outTransfer, 0, sizeof(outTransfer));
+        outTransfer.endpoint = DATAOUT;
+        outTransfer.pData = out;
+        outTransfer.length = sizeof(out);
+        memset(&inTransfer, 0, sizeof(inTransfer));
+        inTransfer.endpoint = DATAIN;
+        inTransfer.pData = in;
+        inTransfer.length = sizeof(in);
+        VHost_Submit(&outTransfer);
+        VHost_Submit(&inTransfer);
+        if ((VHost_Wait(&inTransfer, TIMEOUT) != VHOST_DONE)
+            || (inTransfer.actual != sizeof(out))
+            || (memcmp(in, out, sizeof(out)) != 0)) {
+
+            printf("%s: ping %u failed\n", label, i);
+            return 0;
+        }
+        total += inTransfer.completed - outTransfer.submitted;
+    }
+    SimBoard_End(label, 2ULL * PINGS * PINGSIZE);
+    printf("%-24s %8.1f us average round trip\n", "", total / 1000.0 / PINGS);
+    return 1;
+}
+
+static unsigned char Unconfigure(void)
+{
+    return (VHost_Control(0x00, 0x09, 0, 0, 0, 0) == 0)
+           && (VHost_Control(0x00, 0x09, 1, 0, 0, 0) == 0);
+}
+
+/// Enumerates or configures the device again with transfers in flight.
+static unsigned char Reenumerate(const char *label, unsigned char (*restart)(void))
+{
+    unsigned char out[PINGSIZE];
+    VHostTransfer outTransfer;
+    int space;
+    int count;
+
+    // both transmit buffers in flight, both receive buffers queued
+    echo = false;
+    port.clearWriteError();
+    if ((port.write(pending, sizeof(pending)) != sizeof(pending))
+        || (port.txspace() != 0) || (port.available() != 0)) {
+
+        printf("%s: transfers not in flight\n", label);
+        return 0;
+    }
+
+    if (!restart()) {
+
+        printf("%s: failed\n", label);
+        return 0;
+    }
+    space = port.txspace();
+
+    // received with no call to the port
+    memset(out, 0x5A, sizeof(out));
+    memset(&outTransfer, 0, sizeof(outTransfer));
+    outTransfer.endpoint = DATAOUT;
+    outTransfer.pData = out;
+    outTransfer.length = sizeof(out);
+    VHost_Submit(&outTransfer);
+    VHost_Wait(&outTransfer, TIMEOUT);
+    count = port.available();
+
+    printf("%s: %d of %u transmit bytes free, %d bytes received\n",
+           label, space, PENDINGSIZE, count);
+    if ((space != PENDINGSIZE) || (outTransfer.status != VHOST_DONE)
+        || (count != PINGSIZE)) {
+
+        return 0;
+    }
+    port.rxRelease(count);
+
+    echo = true;
+    if (!Ping(label)) {
+
+        return 0;
+    }
+    // flagged on the first write after the loss
+    if (!VHost_IsHighSpeed() && !port.getWriteError()) {
+
+        printf("%s: the data in flight was dropped silently\n", label);
+        return 0;
+    }
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+//         Main function
+//------------------------------------------------------------------------------
+
+int main(int argc, char **argv)
+{
+    unsigned char highSpeed = 1;
+
+    if ((argc > 1) && (strcmp(argv[1], "fs") == 0)) {
+
+        highSpeed = 0;
+    }
+
+    SimBoard_Initialize(highSpeed, Loop);
+    port.begin(115200);
+    if (!VHost_Enumerate()) {
+
+        return 1;
+    }
+    printf("USBSerial, %s speed\n", VHost_IsHighSpeed() ? "high" : "full");
+
+    echo = true;
+    if (!Ping("echo")) {
+
+        return 1;
+    }
+    if (port.getWriteError()) {
+
+        printf("echo: write error\n");
+        return 1;
+    }
+    if (!Reenumerate("bus reset", VHost_Enumerate)
+        || !Reenumerate("configuration 0 then 1", Unconfigure)) {
+
+        return 1;
+    }
+    return 0;
+}
@@ -83,6 +83,8 @@ typedef struct tskTaskControlBlock
 
 	#if ( portUSING_MPU_WRAPPERS == 1 )
 		xMPU_SETTINGS xMPUSettings;				/*< The MPU settings are defined as part of the port layer.  THIS MUST BE THE SECOND MEMBER OF THE STRUCT. */
+	#elif ( portUSING_MPU_STACK_GUARD == 1 )
+		xMPU_STACK_GUARD xStackGuard;			/*< The MPU region guarding the bottom of the stack, defined as part of the port layer.  THIS MUST BE THE SECOND MEMBER OF THE STRUCT. */
 	#endif	
 	
 	xListItem				xGenericListItem;	/*< List item used to place the TCB in ready and blocked queues. */
@@ -95,6 +97,10 @@ typedef struct tskTaskControlBlock
 		portSTACK_TYPE *pxEndOfStack;			/*< Used for stack overflow checking on architectures where the stack grows up from low memory. */
 	#endif
 
+	#if ( INCLUDE_uxTaskGetStackHighWaterMark == 1 )
+		unsigned short usStackDepth;			/*< The size of the stack in words, as passed to xTaskCreate(). */
+	#endif
+
 	#if ( portCRITICAL_NESTING_IN_TCB == 1 )
 		unsigned portBASE_TYPE uxCriticalNesting;
 	#endif
@@ -113,7 +119,9 @@ typedef struct tskTaskControlBlock
 	#endif
 
 	#if ( configGENERATE_RUN_TIME_STATS == 1 )
-		unsigned long ulRunTimeCounter;		/*< Used for calculating how much CPU time each task is utilising. */
+		portRUN_TIME_COUNTER_TYPE ulRunTimeCounter;	/*< Used for calculating how much CPU time each task is utilising. */
+		portRUN_TIME_COUNTER_TYPE ulLongestRunTime;	/*< The longest period the task has run for before another task was selected. */
+		unsigned long ulSwitchInCount;				/*< The number of times the task has been switched in. */
 	#endif
 
 } tskTCB;
@@ -174,8 +182,13 @@ PRIVILEGED_DATA static portTickType xNextTaskUnblockTime						= ( portTickType )
 #if ( configGENERATE_RUN_TIME_STATS == 1 )
 
 	PRIVILEGED_DATA static char pcStatsString[ 50 ] ;
-	PRIVILEGED_DATA static unsigned long ulTaskSwitchedInTime = 0UL;	/*< Holds the value of a timer/counter the last time a task was switched in. */
-	static void prvGenerateRunTimeStatsForTasksInList( const signed char *pcWriteBuffer, xList *pxList, unsigned long ulTotalRunTime ) PRIVILEGED_FUNCTION;
+	PRIVILEGED_DATA static portRUN_TIME_COUNTER_TYPE ulTaskSwitchedInTime = 0UL;	/*< Holds the value of a timer/counter the last time a task was switched in. */
+	PRIVILEGED_DATA static portRUN_TIME_COUNTER_TYPE ulTaskSwitchedInISRTime = 0UL;	/*< Holds the accumulated interrupt time the last time a task was switched in. */
+	PRIVILEGED_DATA static portRUN_TIME_COUNTER_TYPE ulCurrentRunTime = 0UL;		/*< The time the current task has run for since another task was last selected. */
+	PRIVILEGED_DATA static unsigned long ulContextSwitchCount = 0UL;				/*< The number of times a different task has been selected to run. */
+	static void prvWriteRunTimeCounter( char *pcBuffer, portRUN_TIME_COUNTER_TYPE ulCounter ) PRIVILEGED_FUNCTION;
+	static void prvGenerateRunTimeStatsForTasksInList( const signed char *pcWriteBuffer, xList *pxList, portRUN_TIME_COUNTER_TYPE ulTotalRunTime ) PRIVILEGED_FUNCTION;
+	static unsigned portBASE_TYPE prvGetRunTimeStatusForTasksInList( xTaskRunTimeStatus *pxTaskStatusArray, unsigned portBASE_TYPE uxIndex, unsigned portBASE_TYPE uxArraySize, xList *pxList, portRUN_TIME_COUNTER_TYPE ulTotalRunTime ) PRIVILEGED_FUNCTION;
 
 #endif
 
@@ -282,7 +295,7 @@ portTickType xItemValue;																\
 #define prvGetTCBFromHandle( pxHandle ) ( ( ( pxHandle ) == NULL ) ? ( tskTCB * ) pxCurrentTCB : ( tskTCB * ) ( pxHandle ) )
 
 /* Callback function prototypes. --------------------------*/
-extern void vApplicationStackOverflowHook( xTaskHandle *pxTask, signed char *pcTaskName );
+extern void vApplicationStackOverflowHook( xTaskHandle pxTask, signed char *pcTaskName );
 extern void vApplicationTickHook( void );
 		
 /* File private functions. --------------------------------*/
@@ -370,6 +383,12 @@ static tskTCB *prvAllocateTCBAndStack( unsigned short usStackDepth, portSTACK_TY
 
 #endif
 
+#if ( INCLUDE_uxTaskGetStackHighWaterMark == 1 )
+
+	static unsigned portBASE_TYPE prvGetStackStatusForTasksInList( xTaskStackStatus *pxTaskStatusArray, unsigned portBASE_TYPE uxIndex, unsigned portBASE_TYPE uxArraySize, xList *pxList ) PRIVILEGED_FUNCTION;
+
+#endif
+
 
 /*lint +e956 */
 
@@ -1329,7 +1348,7 @@ unsigned portBASE_TYPE uxTaskGetNumberOfTasks( void )
 	void vTaskGetRunTimeStats( signed char *pcWriteBuffer )
 	{
 	unsigned portBASE_TYPE uxQueue;
-	unsigned long ulTotalRunTime;
+	portRUN_TIME_COUNTER_TYPE ulTotalRunTime;
 
 		/* This is a VERY costly function that should be used for debug only.
 		It leaves interrupts disabled for a LONG time. */
@@ -1399,6 +1418,83 @@ unsigned portBASE_TYPE uxTaskGetNumberOfTasks( void )
 #endif
 /*----------------------------------------------------------*/
 
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+
+	unsigned portBASE_TYPE uxTaskGetRunTimeStatus( xTaskRunTimeStatus *pxTaskStatusArray, unsigned portBASE_TYPE uxArraySize, xSystemRunTimeStatus *pxSystemStatus )
+	{
+	unsigned portBASE_TYPE uxQueue, uxTask = 0U;
+	portRUN_TIME_COUNTER_TYPE ulTotalRunTime, ulISRRunTime;
+
+		vTaskSuspendAll();
+		{
+			#ifdef portALT_GET_RUN_TIME_COUNTER_VALUE
+				portALT_GET_RUN_TIME_COUNTER_VALUE( ulTotalRunTime );
+			#else
+				ulTotalRunTime = portGET_RUN_TIME_COUNTER_VALUE();
+			#endif
+			ulISRRunTime = portGET_RUN_TIME_ISR_COUNTER_VALUE();
+
+			if( pxSystemStatus != NULL )
+			{
+				pxSystemStatus->ulTotalRunTime = ulTotalRunTime;
+				pxSystemStatus->ulISRRunTime = ulISRRunTime;
+				pxSystemStatus->ulContextSwitchCount = ulContextSwitchCount;
+				pxSystemStatus->ulISRPermille = 0UL;
+
+				if( ulTotalRunTime > 0UL )
+				{
+					pxSystemStatus->ulISRPermille = ( unsigned long ) ( ( ulISRRunTime * 1000UL ) / ulTotalRunTime );
+				}
+			}
+
+			uxQueue = uxTopUsedPriority + ( unsigned portBASE_TYPE ) 1U;
+
+			do
+			{
+				uxQueue--;
+
+				if( listLIST_IS_EMPTY( &( pxReadyTasksLists[ uxQueue ] ) ) == pdFALSE )
+				{
+					uxTask = prvGetRunTimeStatusForTasksInList( pxTaskStatusArray, uxTask, uxArraySize, ( xList * ) &( pxReadyTasksLists[ uxQueue ] ), ulTotalRunTime );
+				}
+			}while( uxQueue > ( unsigned short ) tskIDLE_PRIORITY );
+
+			if( listLIST_IS_EMPTY( pxDelayedTaskList ) == pdFALSE )
+			{
+				uxTask = prvGetRunTimeStatusForTasksInList( pxTaskStatusArray, uxTask, uxArraySize, ( xList * ) pxDelayedTaskList, ulTotalRunTime );
+			}
+
+			if( listLIST_IS_EMPTY( pxOverflowDelayedTaskList ) == pdFALSE )
+			{
+				uxTask = prvGetRunTimeStatusForTasksInList( pxTaskStatusArray, uxTask, uxArraySize, ( xList * ) pxOverflowDelayedTaskList, ulTotalRunTime );
+			}
+
+			#if ( INCLUDE_vTaskDelete == 1 )
+			{
+				if( listLIST_IS_EMPTY( &xTasksWaitingTermination ) == pdFALSE )
+				{
+					uxTask = prvGetRunTimeStatusForTasksInList( pxTaskStatusArray, uxTask, uxArraySize, &xTasksWaitingTermination, ulTotalRunTime );
+				}
+			}
+			#endif
+
+			#if ( INCLUDE_vTaskSuspend == 1 )
+			{
+				if( listLIST_IS_EMPTY( &xSuspendedTaskList ) == pdFALSE )
+				{
+					uxTask = prvGetRunTimeStatusForTasksInList( pxTaskStatusArray, uxTask, uxArraySize, &xSuspendedTaskList, ulTotalRunTime );
+				}
+			}
+			#endif
+		}
+		xTaskResumeAll();
+
+		return uxTask;
+	}
+
+#endif
+/*----------------------------------------------------------*/
+
 #if ( INCLUDE_xTaskGetIdleTaskHandle == 1 )
 
 	xTaskHandle xTaskGetIdleTaskHandle( void )
@@ -1580,6 +1676,10 @@ tskTCB * pxTCB;
 
 void vTaskSwitchContext( void )
 {
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+	tskTCB *pxPreviousTCB = pxCurrentTCB;
+#endif
+
 	if( uxSchedulerSuspended != ( unsigned portBASE_TYPE ) pdFALSE )
 	{
 		/* The scheduler is currently suspended - do not allow a context
@@ -1592,21 +1692,27 @@ void vTaskSwitchContext( void )
 	
 		#if ( configGENERATE_RUN_TIME_STATS == 1 )
 		{
-			unsigned long ulTempCounter;
+			portRUN_TIME_COUNTER_TYPE ulTempCounter, ulTempISRCounter, ulSlice;
 			
 				#ifdef portALT_GET_RUN_TIME_COUNTER_VALUE
 					portALT_GET_RUN_TIME_COUNTER_VALUE( ulTempCounter );
 				#else
 					ulTempCounter = portGET_RUN_TIME_COUNTER_VALUE();
 				#endif
+				ulTempISRCounter = portGET_RUN_TIME_ISR_COUNTER_VALUE();
 	
 				/* Add the amount of time the task has been running to the accumulated
 				time so far.  The time the task started running was stored in
-				ulTaskSwitchedInTime.  Note that there is no overflow protection here
-				so count values are only valid until the timer overflows.  Generally
-				this will be about 1 hour assuming a 1uS timer increment. */
-				pxCurrentTCB->ulRunTimeCounter += ( ulTempCounter - ulTaskSwitchedInTime );
+				ulTaskSwitchedInTime.  Time spent in instrumented interrupts while
+				the task was running is not charged to the task.  Note that there
+				is no overflow protection here so count values are only valid until
+				the timer overflows, unless portRUN_TIME_COUNTER_TYPE is wide
+				enough for that never to happen. */
+				ulSlice = ( ulTempCounter - ulTaskSwitchedInTime ) - ( ulTempISRCounter - ulTaskSwitchedInISRTime );
+				pxCurrentTCB->ulRunTimeCounter += ulSlice;
+				ulCurrentRunTime += ulSlice;
 				ulTaskSwitchedInTime = ulTempCounter;
+				ulTaskSwitchedInISRTime = ulTempISRCounter;
 		}
 		#endif
 	
@@ -1623,6 +1729,24 @@ void vTaskSwitchContext( void )
 		/* listGET_OWNER_OF_NEXT_ENTRY walks through the list, so the tasks of the
 		same priority get an equal share of the processor time. */
 		listGET_OWNER_OF_NEXT_ENTRY( pxCurrentTCB, &( pxReadyTasksLists[ uxTopReadyPriority ] ) );
+
+		#if ( configGENERATE_RUN_TIME_STATS == 1 )
+		{
+			/* A run ends when a different task is selected, not at every tick,
+			so the longest run reflects how long a task held the processor. */
+			if( pxCurrentTCB != pxPreviousTCB )
+			{
+				if( ulCurrentRunTime > pxPreviousTCB->ulLongestRunTime )
+				{
+					pxPreviousTCB->ulLongestRunTime = ulCurrentRunTime;
+				}
+				ulCurrentRunTime = 0UL;
+
+				( pxCurrentTCB->ulSwitchInCount )++;
+				ulContextSwitchCount++;
+			}
+		}
+		#endif
 	
 		traceTASK_SWITCHED_IN();
 	}
@@ -1981,9 +2105,17 @@ static void prvInitialiseTCBVariables( tskTCB *pxTCB, const signed char * const
 	}
 	#endif
 
+	#if ( INCLUDE_uxTaskGetStackHighWaterMark == 1 )
+	{
+		pxTCB->usStackDepth = usStackDepth;
+	}
+	#endif
+
 	#if ( configGENERATE_RUN_TIME_STATS == 1 )
 	{
 		pxTCB->ulRunTimeCounter = 0UL;
+		pxTCB->ulLongestRunTime = 0UL;
+		pxTCB->ulSwitchInCount = 0UL;
 	}
 	#endif
 
@@ -1997,6 +2129,12 @@ static void prvInitialiseTCBVariables( tskTCB *pxTCB, const signed char * const
 		( void ) usStackDepth;
 	}
 	#endif
+
+	#if ( portUSING_MPU_STACK_GUARD == 1 )
+	{
+		vPortStoreTaskStackGuard( &( pxTCB->xStackGuard ), pxTCB->pxStack );
+	}
+	#endif
 }
 /*-----------------------------------------------------------*/
 
@@ -2178,10 +2316,28 @@ tskTCB *pxNewTCB;
 
 #if ( configGENERATE_RUN_TIME_STATS == 1 )
 
-	static void prvGenerateRunTimeStatsForTasksInList( const signed char *pcWriteBuffer, xList *pxList, unsigned long ulTotalRunTime )
+	static void prvWriteRunTimeCounter( char *pcBuffer, portRUN_TIME_COUNTER_TYPE ulCounter )
+	{
+		/* The counter may be 64 bits wide, but neither the reduced printf()
+		libraries nor the one of at91lib know the ll modifier.  It is
+		printed as two parts of 32 bits instead: the billions, then the
+		other nine digits. */
+		if( ulCounter >= 1000000000UL )
+		{
+			sprintf( pcBuffer, ( char * ) "%u%09u", ( unsigned int ) ( ulCounter / 1000000000UL ), ( unsigned int ) ( ulCounter % 1000000000UL ) );
+		}
+		else
+		{
+			sprintf( pcBuffer, ( char * ) "%u", ( unsigned int ) ulCounter );
+		}
+	}
+	/*-----------------------------------------------------------*/
+
+	static void prvGenerateRunTimeStatsForTasksInList( const signed char *pcWriteBuffer, xList *pxList, portRUN_TIME_COUNTER_TYPE ulTotalRunTime )
 	{
 	volatile tskTCB *pxNextTCB, *pxFirstTCB;
 	unsigned long ulStatsAsPercentage;
+	char pcCounterString[ 24 ];
 
 		/* Write the run time stats of all the TCB's in pxList into the buffer. */
 		listGET_OWNER_OF_NEXT_ENTRY( pxFirstTCB, pxList );
@@ -2204,19 +2360,20 @@ tskTCB *pxNewTCB;
 					/* What percentage of the total run time has the task used?
 					This will always be rounded down to the nearest integer.
 					ulTotalRunTime has already been divided by 100. */
-					ulStatsAsPercentage = pxNextTCB->ulRunTimeCounter / ulTotalRunTime;
+					ulStatsAsPercentage = ( unsigned long ) ( pxNextTCB->ulRunTimeCounter / ulTotalRunTime );
+					prvWriteRunTimeCounter( pcCounterString, pxNextTCB->ulRunTimeCounter );
 
 					if( ulStatsAsPercentage > 0UL )
 					{
 						#ifdef portLU_PRINTF_SPECIFIER_REQUIRED
 						{
-							sprintf( pcStatsString, ( char * ) "%s\t\t%lu\t\t%lu%%\r\n", pxNextTCB->pcTaskName, pxNextTCB->ulRunTimeCounter, ulStatsAsPercentage );							
+							sprintf( pcStatsString, ( char * ) "%s\t\t%s\t\t%lu%%\r\n", pxNextTCB->pcTaskName, pcCounterString, ulStatsAsPercentage );							
 						}
 						#else
 						{
 							/* sizeof( int ) == sizeof( long ) so a smaller
 							printf() library can be used. */
-							sprintf( pcStatsString, ( char * ) "%s\t\t%u\t\t%u%%\r\n", pxNextTCB->pcTaskName, ( unsigned int ) pxNextTCB->ulRunTimeCounter, ( unsigned int ) ulStatsAsPercentage );
+							sprintf( pcStatsString, ( char * ) "%s\t\t%s\t\t%u%%\r\n", pxNextTCB->pcTaskName, pcCounterString, ( unsigned int ) ulStatsAsPercentage );
 						}
 						#endif
 					}
@@ -2226,13 +2383,13 @@ tskTCB *pxNewTCB;
 						consumed less than 1% of the total run time. */
 						#ifdef portLU_PRINTF_SPECIFIER_REQUIRED
 						{
-							sprintf( pcStatsString, ( char * ) "%s\t\t%lu\t\t<1%%\r\n", pxNextTCB->pcTaskName, pxNextTCB->ulRunTimeCounter );							
+							sprintf( pcStatsString, ( char * ) "%s\t\t%s\t\t<1%%\r\n", pxNextTCB->pcTaskName, pcCounterString );							
 						}
 						#else
 						{
 							/* sizeof( int ) == sizeof( long ) so a smaller
 							printf() library can be used. */
-							sprintf( pcStatsString, ( char * ) "%s\t\t%u\t\t<1%%\r\n", pxNextTCB->pcTaskName, ( unsigned int ) pxNextTCB->ulRunTimeCounter );
+							sprintf( pcStatsString, ( char * ) "%s\t\t%s\t\t<1%%\r\n", pxNextTCB->pcTaskName, pcCounterString );
 						}
 						#endif
 					}
@@ -2247,6 +2404,53 @@ tskTCB *pxNewTCB;
 #endif
 /*-----------------------------------------------------------*/
 
+#if ( configGENERATE_RUN_TIME_STATS == 1 )
+
+	static unsigned portBASE_TYPE prvGetRunTimeStatusForTasksInList( xTaskRunTimeStatus *pxTaskStatusArray, unsigned portBASE_TYPE uxIndex, unsigned portBASE_TYPE uxArraySize, xList *pxList, portRUN_TIME_COUNTER_TYPE ulTotalRunTime )
+	{
+	volatile tskTCB *pxNextTCB, *pxFirstTCB;
+	xTaskRunTimeStatus *pxStatus;
+
+		/* Copy the run time figures of all the TCB's in pxList into the array,
+		stopping when the array is full. */
+		listGET_OWNER_OF_NEXT_ENTRY( pxFirstTCB, pxList );
+		do
+		{
+			listGET_OWNER_OF_NEXT_ENTRY( pxNextTCB, pxList );
+
+			if( uxIndex < uxArraySize )
+			{
+				pxStatus = &( pxTaskStatusArray[ uxIndex ] );
+				pxStatus->xHandle = ( xTaskHandle ) pxNextTCB;
+				pxStatus->pcTaskName = ( const signed char * ) pxNextTCB->pcTaskName;
+				pxStatus->uxPriority = pxNextTCB->uxPriority;
+				pxStatus->ulRunTimeCounter = pxNextTCB->ulRunTimeCounter;
+				pxStatus->ulLongestRunTime = pxNextTCB->ulLongestRunTime;
+				pxStatus->ulSwitchInCount = pxNextTCB->ulSwitchInCount;
+				pxStatus->ulPermille = 0UL;
+
+				/* The run of the calling task is still in progress. */
+				if( ( pxNextTCB == pxCurrentTCB ) && ( ulCurrentRunTime > pxStatus->ulLongestRunTime ) )
+				{
+					pxStatus->ulLongestRunTime = ulCurrentRunTime;
+				}
+
+				if( ulTotalRunTime > 0UL )
+				{
+					pxStatus->ulPermille = ( unsigned long ) ( ( pxNextTCB->ulRunTimeCounter * 1000UL ) / ulTotalRunTime );
+				}
+
+				uxIndex++;
+			}
+
+		} while( pxNextTCB != pxFirstTCB );
+
+		return uxIndex;
+	}
+
+#endif
+/*-----------------------------------------------------------*/
+
 #if ( ( configUSE_TRACE_FACILITY == 1 ) || ( INCLUDE_uxTaskGetStackHighWaterMark == 1 ) )
 
 	static unsigned short usTaskCheckFreeStackSpace( const unsigned char * pucStackByte )
@@ -2295,6 +2499,91 @@ tskTCB *pxNewTCB;
 #endif
 /*-----------------------------------------------------------*/
 
+#if ( INCLUDE_uxTaskGetStackHighWaterMark == 1 )
+
+	unsigned portBASE_TYPE uxTaskGetStackStatus( xTaskStackStatus *pxTaskStatusArray, unsigned portBASE_TYPE uxArraySize )
+	{
+	unsigned portBASE_TYPE uxQueue, uxTask = 0U;
+
+		vTaskSuspendAll();
+		{
+			uxQueue = uxTopUsedPriority + ( unsigned portBASE_TYPE ) 1U;
+
+			do
+			{
+				uxQueue--;
+
+				if( listLIST_IS_EMPTY( &( pxReadyTasksLists[ uxQueue ] ) ) == pdFALSE )
+				{
+					uxTask = prvGetStackStatusForTasksInList( pxTaskStatusArray, uxTask, uxArraySize, ( xList * ) &( pxReadyTasksLists[ uxQueue ] ) );
+				}
+			}while( uxQueue > ( unsigned short ) tskIDLE_PRIORITY );
+
+			if( listLIST_IS_EMPTY( pxDelayedTaskList ) == pdFALSE )
+			{
+				uxTask = prvGetStackStatusForTasksInList( pxTaskStatusArray, uxTask, uxArraySize, ( xList * ) pxDelayedTaskList );
+			}
+
+			if( listLIST_IS_EMPTY( pxOverflowDelayedTaskList ) == pdFALSE )
+			{
+				uxTask = prvGetStackStatusForTasksInList( pxTaskStatusArray, uxTask, uxArraySize, ( xList * ) pxOverflowDelayedTaskList );
+			}
+
+			#if ( INCLUDE_vTaskSuspend == 1 )
+			{
+				if( listLIST_IS_EMPTY( &xSuspendedTaskList ) == pdFALSE )
+				{
+					uxTask = prvGetStackStatusForTasksInList( pxTaskStatusArray, uxTask, uxArraySize, &xSuspendedTaskList );
+				}
+			}
+			#endif
+		}
+		xTaskResumeAll();
+
+		return uxTask;
+	}
+	/*-----------------------------------------------------------*/
+
+	static unsigned portBASE_TYPE prvGetStackStatusForTasksInList( xTaskStackStatus *pxTaskStatusArray, unsigned portBASE_TYPE uxIndex, unsigned portBASE_TYPE uxArraySize, xList *pxList )
+	{
+	volatile tskTCB *pxNextTCB, *pxFirstTCB;
+	xTaskStackStatus *pxStatus;
+
+		/* Copy the stack figures of all the TCB's in pxList into the array,
+		stopping when the array is full. */
+		listGET_OWNER_OF_NEXT_ENTRY( pxFirstTCB, pxList );
+		do
+		{
+			listGET_OWNER_OF_NEXT_ENTRY( pxNextTCB, pxList );
+
+			if( uxIndex < uxArraySize )
+			{
+				pxStatus = &( pxTaskStatusArray[ uxIndex ] );
+				pxStatus->xHandle = ( xTaskHandle ) pxNextTCB;
+				pxStatus->pcTaskName = ( const signed char * ) pxNextTCB->pcTaskName;
+				pxStatus->usStackDepth = pxNextTCB->usStackDepth;
+
+				#if portSTACK_GROWTH < 0
+				{
+					pxStatus->usHighWaterMark = usTaskCheckFreeStackSpace( ( unsigned char * ) pxNextTCB->pxStack );
+				}
+				#else
+				{
+					pxStatus->usHighWaterMark = usTaskCheckFreeStackSpace( ( unsigned char * ) pxNextTCB->pxEndOfStack );
+				}
+				#endif
+
+				uxIndex++;
+			}
+
+		} while( pxNextTCB != pxFirstTCB );
+
+		return uxIndex;
+	}
+
+#endif
+/*-----------------------------------------------------------*/
+
 #if ( INCLUDE_vTaskDelete == 1 )
 
 	static void prvDeleteTCB( tskTCB *pxTCB )
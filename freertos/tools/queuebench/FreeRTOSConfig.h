@@ -0,0 +1,33 @@
+/*
+ * Kernel configuration of the host build of queue.c, with the queue, mutex
+ * and trace settings of the target's FreeRTOSConfig.h.
+ */
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#define configUSE_PREEMPTION			1
+#define configUSE_IDLE_HOOK				0
+#define configUSE_TICK_HOOK				0
+#define configCPU_CLOCK_HZ				( ( unsigned long ) 48000000 )
+#define configTICK_RATE_HZ				( ( portTickType ) 1000 )
+#define configMINIMAL_STACK_SIZE		( ( unsigned short ) 70 )
+#define configMAX_TASK_NAME_LEN			( 12 )
+#define configUSE_TRACE_FACILITY		1
+#define configUSE_16_BIT_TICKS			0
+#define configUSE_CO_ROUTINES 			0
+#define configUSE_MUTEXES				1
+#define configUSE_RECURSIVE_MUTEXES		1
+#define configMAX_PRIORITIES		( ( unsigned portBASE_TYPE ) 5 )
+#define configQUEUE_REGISTRY_SIZE		10
+#define configUSE_TIMERS				0
+
+#define INCLUDE_vTaskPrioritySet			0
+#define INCLUDE_uxTaskPriorityGet			0
+#define INCLUDE_vTaskDelete					0
+#define INCLUDE_vTaskSuspend				0
+#define INCLUDE_vTaskDelayUntil				0
+#define INCLUDE_vTaskDelay					0
+#define INCLUDE_xTaskGetCurrentTaskHandle	1
+
+#endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,105 @@
+/*
+ * The scheduler functions that queue.c calls, for a single task that never
+ * blocks: the queues are only used with a block time of 0, or when they can
+ * complete at once.  A call that would block aborts.  The heap is the C
+ * library's, as with syscalls/rtos_heap.c on the target.
+ */
+
+#include <stdlib.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+static int iTask;
+
+/* The stack the last task was created with, for queuebench to check. */
+portSTACK_TYPE *puxHostTaskStack = NULL;
+/*-----------------------------------------------------------*/
+
+void *pvPortMalloc( size_t xSize )
+{
+	return malloc( xSize );
+}
+
+void vPortFree( void *pv )
+{
+	free( pv );
+}
+/*-----------------------------------------------------------*/
+
+signed portBASE_TYPE xTaskGenericCreate( pdTASK_CODE pxTaskCode, const signed char * const pcName, unsigned short usStackDepth, void *pvParameters, unsigned portBASE_TYPE uxPriority, xTaskHandle *pxCreatedTask, portSTACK_TYPE *puxStackBuffer, const xMemoryRegion * const xRegions )
+{
+	( void ) pxTaskCode;
+	( void ) pcName;
+	( void ) usStackDepth;
+	( void ) pvParameters;
+	( void ) uxPriority;
+	( void ) xRegions;
+
+	puxHostTaskStack = puxStackBuffer;
+	if( pxCreatedTask != NULL )
+	{
+		*pxCreatedTask = &iTask;
+	}
+	return pdPASS;
+}
+
+xTaskHandle xTaskGetCurrentTaskHandle( void )
+{
+	return &iTask;
+}
+
+void vTaskSuspendAll( void )
+{
+}
+
+signed portBASE_TYPE xTaskResumeAll( void )
+{
+	return pdFALSE;
+}
+
+void vTaskPlaceOnEventList( const xList * const pxEventList, portTickType xTicksToWait )
+{
+	( void ) pxEventList;
+	( void ) xTicksToWait;
+	abort();
+}
+
+void vTaskPlaceOnEventListRestricted( const xList * const pxEventList, portTickType xTicksToWait )
+{
+	( void ) pxEventList;
+	( void ) xTicksToWait;
+	abort();
+}
+
+signed portBASE_TYPE xTaskRemoveFromEventList( const xList * const pxEventList )
+{
+	( void ) pxEventList;
+	return pdFALSE;
+}
+
+void vTaskSetTimeOutState( xTimeOutType * const pxTimeOut )
+{
+	( void ) pxTimeOut;
+}
+
+portBASE_TYPE xTaskCheckForTimeOut( xTimeOutType * const pxTimeOut, portTickType * const pxTicksToWait )
+{
+	( void ) pxTimeOut;
+	( void ) pxTicksToWait;
+	return pdTRUE;
+}
+
+void vTaskMissedYield( void )
+{
+}
+
+void vTaskPriorityInherit( xTaskHandle * const pxMutexHolder )
+{
+	( void ) pxMutexHolder;
+}
+
+void vTaskPriorityDisinherit( xTaskHandle * const pxMutexHolder )
+{
+	( void ) pxMutexHolder;
+}
@@ -0,0 +1,263 @@
+//------------------------------------------------------------------------------
+// Queue benchmark: the typed wrappers of rtos.h against the C queue API.
+//
+// queue.c and list.c are built for the host, with a scheduler reduced to a
+// single task that never blocks (hosttask.c). For items of 1 to 32 bytes, a
+// value is sent to a queue of 16 and received back, once through
+// xQueueSend()/xQueueReceive() on a queue created with xQueueCreate(), and
+// once through a static Queue<T, 16>. The same is done for a binary
+// semaphore and a mutex. Each test reports the time per send and receive
+// pair.
+//
+// queuebench-memcpy is built with configQUEUE_COPY_BY_SIZE at 0, so that
+// queue.c copies every item with memcpy() of the item size, as before.
+//
+// First, the order of the items through the wrappers, with sendToFront() and
+// peek(), is checked against the C API, and the task stack is checked to be
+// the one in the Task object.
+//
+//   ./queuebench
+//   ./queuebench-memcpy
+//------------------------------------------------------------------------------
+
+#include <rtos.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+//------------------------------------------------------------------------------
+//         Local definitions
+//------------------------------------------------------------------------------
+
+/// Send and receive pairs per test.
+#define ITERATIONS      10000000
+
+/// Length of the queues.
+#define LENGTH          16
+
+template <unsigned int Size>
+struct Item
+{
+    uint8_t bytes[Size];
+};
+
+//------------------------------------------------------------------------------
+//         Local variables
+//------------------------------------------------------------------------------
+
+extern "C" portSTACK_TYPE *puxHostTaskStack;
+
+static unsigned int errors;
+
+static Queue<Item<1>, LENGTH> queue1;
+static Queue<Item<2>, LENGTH> queue2;
+static Queue<Item<4>, LENGTH> queue4;
+static Queue<Item<8>, LENGTH> queue8;
+static Queue<Item<16>, LENGTH> queue16;
+static Queue<Item<32>, LENGTH> queue32;
+static Semaphore semaphore;
+static Mutex mutex;
+static Task<200> task;
+
+//------------------------------------------------------------------------------
+//         Local functions
+//------------------------------------------------------------------------------
+
+/// Host time in ns.
+static unsigned long long GetTime(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static void Report(const char *label, unsigned long long start)
+{
+    printf("%-28s %7.2f ns\n", label,
+           (double) (GetTime() - start) / ITERATIONS);
+}
+
+template <unsigned int Size>
+static void Fill(Item<Size> &item, unsigned int i)
+{
+    memset(item.bytes, i, Size);
+}
+
+template <unsigned int Size>
+static void Run(Queue<Item<Size>, LENGTH> &queue)
+{
+    xQueueHandle raw = xQueueCreate(LENGTH, sizeof(Item<Size>));
+    Item<Size> in;
+    Item<Size> out;
+    unsigned long long start;
+    unsigned int wrong = 0;
+    unsigned int i;
+    char label[32];
+
+    // keep a few items queued, so that the copies wrap around the storage
+    for (i = 0; i < 3; i++) {
+
+        Fill(in, i - 3);
+        xQueueSend(raw, &in, 0);
+        queue.send(in, 0);
+    }
+
+    start = GetTime();
+    for (i = 0; i < ITERATIONS; i++) {
+
+        Fill(in, i);
+        xQueueSend(raw, &in, 0);
+        xQueueReceive(raw, &out, 0);
+        wrong += out.bytes[0] != (uint8_t) (i - 3);
+    }
+    snprintf(label, sizeof(label), "%2u bytes, C API", Size);
+    Report(label, start);
+
+    start = GetTime();
+    for (i = 0; i < ITERATIONS; i++) {
+
+        Fill(in, i);
+        queue.send(in, 0);
+        queue.receive(out, 0);
+        wrong += out.bytes[0] != (uint8_t) (i - 3);
+    }
+    snprintf(label, sizeof(label), "%2u bytes, Queue<T, N>", Size);
+    Report(label, start);
+
+    if (wrong) {
+
+        printf("%u bytes: %u items received out of order\n", Size, wrong);
+        errors++;
+    }
+    vQueueDelete(raw);
+}
+
+static void Check(void)
+{
+    xQueueHandle raw = xQueueCreate(4, sizeof(uint32_t));
+    Queue<uint32_t, 4> queue;
+    uint32_t a;
+    uint32_t b;
+    unsigned int i;
+
+    // back, front, and full: both queues must give the same items
+    for (i = 0; i < 6; i++) {
+
+        a = i;
+        if (i % 2) {
+
+            xQueueSendToFront(raw, &a, 0);
+            queue.sendToFront(a, 0);
+        } else {
+
+            xQueueSendToBack(raw, &a, 0);
+            queue.send(a, 0);
+        }
+    }
+    if (queue.waiting() != 4 || queue.spaces() != 0) {
+
+        printf("Queue<T, N>: %lu waiting, %lu spaces\n",
+               (unsigned long) queue.waiting(), (unsigned long) queue.spaces());
+        errors++;
+    }
+    queue.peek(b, 0);
+    xQueuePeek(raw, &a, 0);
+    for (i = 0; i < 5; i++) {
+
+        bool gotRaw = xQueueReceive(raw, &a, 0) == pdPASS;
+        bool got = queue.receive(b, 0);
+
+        if (got != gotRaw || (got && a != b)) {
+
+            printf("Queue<T, N>: item %u is %lu, expected %lu\n", i,
+                   (unsigned long) b, (unsigned long) a);
+            errors++;
+        }
+    }
+    vQueueDelete(raw);
+
+    if (semaphore.take(0) || !semaphore.give() || semaphore.give()
+        || !semaphore.take(0)) {
+
+        printf("Semaphore: not binary\n");
+        errors++;
+    }
+    if (!mutex.take(0) || !mutex.give()) {
+
+        printf("Mutex: not free\n");
+        errors++;
+    }
+    if (!task.create(0, "task", 1) || puxHostTaskStack == 0
+        || (uintptr_t) puxHostTaskStack < (uintptr_t) &task
+        || (uintptr_t) puxHostTaskStack >= (uintptr_t) (&task + 1)) {
+
+        printf("Task<StackWords>: stack not in the object\n");
+        errors++;
+    }
+}
+
+static void RunSemaphores(void)
+{
+    xSemaphoreHandle rawSemaphore;
+    xSemaphoreHandle rawMutex = xSemaphoreCreateMutex();
+    unsigned long long start;
+    unsigned int i;
+
+    vSemaphoreCreateBinary(rawSemaphore);
+    start = GetTime();
+    for (i = 0; i < ITERATIONS; i++) {
+
+        xSemaphoreTake(rawSemaphore, 0);
+        xSemaphoreGive(rawSemaphore);
+    }
+    Report("semaphore, C API", start);
+
+    semaphore.give();
+    start = GetTime();
+    for (i = 0; i < ITERATIONS; i++) {
+
+        semaphore.take(0);
+        semaphore.give();
+    }
+    Report("semaphore, Semaphore", start);
+
+    start = GetTime();
+    for (i = 0; i < ITERATIONS; i++) {
+
+        xSemaphoreTake(rawMutex, 0);
+        xSemaphoreGive(rawMutex);
+    }
+    Report("mutex, C API", start);
+
+    start = GetTime();
+    for (i = 0; i < ITERATIONS; i++) {
+
+        MutexLock lock(mutex);
+    }
+    Report("mutex, MutexLock", start);
+}
+
+//------------------------------------------------------------------------------
+//         Main function
+//------------------------------------------------------------------------------
+
+int main(void)
+{
+    Check();
+    printf("rtos.h, %u errors\n", errors);
+    printf("queue.c copying %s\n", configQUEUE_COPY_BY_SIZE
+           ? "items of 1, 2, 4 and 8 bytes inline" : "with memcpy()");
+
+    Run(queue1);
+    Run(queue2);
+    Run(queue4);
+    Run(queue8);
+    Run(queue16);
+    Run(queue32);
+    RunSemaphores();
+
+    return errors ? 1 : 0;
+}
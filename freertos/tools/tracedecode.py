@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+#
+# Decodes the byte stream written by ulTraceRecorderDrain() (see
+# freertos/trace_recorder.c) into a Chrome trace JSON file that can be loaded
+# in chrome://tracing or https://ui.perfetto.dev.
+#
+# usage: tracedecode.py <capture.bin> [<output.json>]
+#
+# Task run periods are shown as slices on one row per task, instrumented
+# interrupts on an "Interrupts" row, and queue and delay operations as instant
+# events on the row of the task that performed them.
+
+import json
+import struct
+import sys
+
+EVENTS = {
+    0x01: 'TaskSwitchedIn',
+    0x02: 'TaskCreate',
+    0x03: 'TaskDelete',
+    0x04: 'TaskDelay',
+    0x05: 'TaskDelayUntil',
+    0x06: 'TaskSuspend',
+    0x07: 'TaskResume',
+    0x10: 'IsrEnter',
+    0x11: 'IsrExit',
+    0x20: 'QueueCreate',
+    0x21: 'QueueSend',
+    0x22: 'QueueSendFailed',
+    0x23: 'QueueReceive',
+    0x24: 'QueueReceiveFailed',
+    0x25: 'QueuePeek',
+    0x26: 'QueueSendFromISR',
+    0x27: 'QueueReceiveFromISR',
+    0x28: 'BlockingOnQueueSend',
+    0x29: 'BlockingOnQueueReceive',
+    0x2a: 'QueueDelete',
+}
+
+PID = 1
+ISR_TID = 0x10000
+
+
+class Decoder(object):
+
+    def __init__(self):
+        self.out = []
+        self.names = {}
+        self.hz = None
+        self.epoch = 0        # accumulated wraps of the 32 bit time stamp
+        self.last = None      # last raw time stamp
+        self.running = None   # (task, start time in us)
+
+    def us(self, raw):
+        # A record is stamped after it is claimed, so the record of a writer
+        # that an interrupt preempted in between is stamped later than the
+        # interrupt's records that follow it: a small step back follows such a
+        # record, only a step back of more than half the range is a wrap.
+        # Steps are taken modulo 2^32, so a gap of more than half the range
+        # between two events reads as a step back.
+        epoch = self.epoch
+        if self.last is not None:
+            step = (raw - self.last) & 0xffffffff
+            if step < 1 << 31:
+                if raw < self.last:
+                    self.epoch += 1 << 32
+                    epoch = self.epoch
+                self.last = raw
+            elif raw > self.last:
+                # stamped before the wrap that the previous record followed
+                epoch -= 1 << 32
+        else:
+            self.last = raw
+        return (epoch + raw) * 1e6 / self.hz
+
+    def close_slice(self, now):
+        if self.running is not None:
+            task, start = self.running
+            self.out.append({'name': self.names.get(task, 'task %d' % task),
+                             'ph': 'X', 'pid': PID, 'tid': task,
+                             'ts': start, 'dur': now - start})
+            self.running = None
+
+    def event(self, ts, code, task, obj):
+        now = self.us(ts)
+        if code == 0x01:
+            if self.running is None or self.running[0] != task:
+                self.close_slice(now)
+                self.running = (task, now)
+        elif code == 0x10:
+            self.out.append({'name': 'IRQ %d' % obj, 'ph': 'B', 'pid': PID,
+                             'tid': ISR_TID, 'ts': now})
+        elif code == 0x11:
+            self.out.append({'name': 'IRQ %d' % obj, 'ph': 'E', 'pid': PID,
+                             'tid': ISR_TID, 'ts': now})
+        else:
+            if code & 0x80:
+                name = 'User %d' % (code & 0x7f)
+            else:
+                name = EVENTS.get(code, 'Event 0x%02x' % code)
+            self.out.append({'name': name, 'ph': 'i', 's': 't', 'pid': PID,
+                             'tid': task, 'ts': now,
+                             'args': {'object': '0x%04x' % obj}})
+
+    def frame(self, data, pos):
+        magic, version, size, count, hz = struct.unpack_from('<4sBBHI', data, pos)
+        if magic != b'FRTR' or version != 1:
+            raise ValueError('bad frame header at offset %d' % pos)
+        pos += 12
+        self.hz = hz
+        for _ in range(count):
+            task = data[pos]
+            name = data[pos + 1:pos + 16].split(b'\0', 1)[0]
+            self.names[task] = name.decode('ascii', 'replace')
+            pos += 16
+        lost, records = struct.unpack_from('<II', data, pos)
+        pos += 8
+        if lost:
+            self.running = None
+            self.out.append({'name': 'lost %d events' % lost, 'ph': 'i',
+                             's': 'g', 'pid': PID, 'tid': 0,
+                             'ts': self.us(self.last or 0)})
+        # Host builds have a 64 bit time stamp field and padding, so the
+        # record layout is taken from the record size in the header.
+        ts_size = 8 if size >= 16 else 4
+        for _ in range(records):
+            ts = int.from_bytes(data[pos:pos + ts_size], 'little') & 0xffffffff
+            code, task, obj = struct.unpack_from('<BBH', data, pos + ts_size)
+            self.event(ts, code, task, obj)
+            pos += size
+        return pos
+
+    def decode(self, data):
+        pos = 0
+        while pos + 12 <= len(data):
+            pos = self.frame(data, pos)
+        if self.last is not None:
+            self.close_slice(self.us(self.last))
+        for task, name in sorted(self.names.items()):
+            self.out.append({'name': 'thread_name', 'ph': 'M', 'pid': PID,
+                             'tid': task, 'args': {'name': name}})
+        self.out.append({'name': 'thread_name', 'ph': 'M', 'pid': PID,
+                         'tid': ISR_TID, 'args': {'name': 'Interrupts'}})
+        return {'traceEvents': self.out, 'displayTimeUnit': 'ns'}
+
+
+def main(argv):
+    if len(argv) < 2:
+        sys.stderr.write('usage: %s <capture.bin> [<output.json>]\n' % argv[0])
+        return 1
+    with open(argv[1], 'rb') as f:
+        trace = Decoder().decode(f.read())
+    if len(argv) > 2:
+        with open(argv[2], 'w') as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,186 @@
+/*
+ * Binary kernel event trace recorder.  See trace_recorder.h.
+ *
+ * Stream format, all values little endian.  Each call to ulTraceRecorderDrain()
+ * writes one frame:
+ *
+ *   "FRTR"           magic
+ *   u8               format version (1)
+ *   u8               event record size in bytes (8)
+ *   u16              number of task name entries
+ *   u32              time stamp clock frequency in Hz
+ *   name entries     u8 task number followed by 15 bytes of NUL padded name
+ *   u32              number of events lost since the previous frame
+ *   u32              number of event records that follow
+ *   event records    u32 time stamp, u8 event, u8 task, u16 object
+ */
+
+#include <string.h>
+
+#include "FreeRTOS.h"
+
+#if ( configUSE_TRACE_RECORDER == 1 )
+
+#ifndef configTRACE_RECORDER_MAX_TASKS
+	#define configTRACE_RECORDER_MAX_TASKS	16
+#endif
+
+#define trcFORMAT_VERSION		( 1U )
+#define trcNAME_ENTRY_SIZE		( 16U )
+
+/* Constants required to start the DWT cycle counter. */
+#define trcDEMCR				( ( volatile unsigned long * ) 0xe000edfc )
+#define trcDWT_CTRL				( ( volatile unsigned long * ) 0xe0001000 )
+#define trcDEMCR_TRCENA			0x01000000
+#define trcDWT_CTRL_CYCCNTENA	0x00000001
+
+typedef struct xTRACE_TASK_NAME
+{
+	unsigned char ucTask;
+	signed char pcName[ trcNAME_ENTRY_SIZE - 1U ];
+} xTraceTaskName;
+
+xTraceEvent xTraceRecorderBuffer[ configTRACE_RECORDER_BUFFER_EVENTS ];
+volatile unsigned long ulTraceRecorderHead = 0UL;
+volatile unsigned char ucTraceRecorderCurrentTask = 0U;
+volatile unsigned char ucTraceRecorderEnabled = 0U;
+
+static unsigned long ulTraceRecorderTail = 0UL;
+static xTraceTaskName xTaskNames[ configTRACE_RECORDER_MAX_TASKS ];
+static unsigned portBASE_TYPE uxTaskNameCount = 0U;
+
+/*-----------------------------------------------------------*/
+
+static void prvPutLong( unsigned char *pucBuffer, unsigned long ulValue )
+{
+	pucBuffer[ 0 ] = ( unsigned char ) ulValue;
+	pucBuffer[ 1 ] = ( unsigned char ) ( ulValue >> 8 );
+	pucBuffer[ 2 ] = ( unsigned char ) ( ulValue >> 16 );
+	pucBuffer[ 3 ] = ( unsigned char ) ( ulValue >> 24 );
+}
+/*-----------------------------------------------------------*/
+
+void vTraceRecorderStart( void )
+{
+	#if defined( __arm__ )
+	{
+		*( trcDEMCR ) |= trcDEMCR_TRCENA;
+		*( trcDWT_CTRL ) |= trcDWT_CTRL_CYCCNTENA;
+	}
+	#endif
+
+	ucTraceRecorderEnabled = 1U;
+}
+/*-----------------------------------------------------------*/
+
+void vTraceRecorderStop( void )
+{
+	ucTraceRecorderEnabled = 0U;
+}
+/*-----------------------------------------------------------*/
+
+void vTraceRecorderTaskCreate( unsigned char ucTask, const signed char *pcName )
+{
+unsigned portBASE_TYPE ux;
+xTraceTaskName *pxEntry = NULL;
+
+	/* Called from within the kernel with interrupts masked.  Task numbers
+	are reused once they wrap, in which case the entry is updated. */
+	for( ux = 0U; ux < uxTaskNameCount; ux++ )
+	{
+		if( xTaskNames[ ux ].ucTask == ucTask )
+		{
+			pxEntry = &( xTaskNames[ ux ] );
+			break;
+		}
+	}
+
+	if( ( pxEntry == NULL ) && ( uxTaskNameCount < configTRACE_RECORDER_MAX_TASKS ) )
+	{
+		pxEntry = &( xTaskNames[ uxTaskNameCount ] );
+		uxTaskNameCount++;
+	}
+
+	if( pxEntry != NULL )
+	{
+		pxEntry->ucTask = ucTask;
+		strncpy( ( char * ) pxEntry->pcName, ( const char * ) pcName, sizeof( pxEntry->pcName ) );
+	}
+}
+/*-----------------------------------------------------------*/
+
+unsigned long ulTraceRecorderDrain( pdTRACE_WRITE_FUNCTION pxWrite )
+{
+unsigned char ucHeader[ 12 ];
+unsigned long ulHead, ulCount, ulLost = 0UL, ulStart, ulFirst;
+unsigned portBASE_TYPE ux;
+
+	ulHead = ulTraceRecorderHead;
+	ulCount = ulHead - ulTraceRecorderTail;
+
+	/* Anything older than one buffer length has been overwritten. */
+	if( ulCount > configTRACE_RECORDER_BUFFER_EVENTS )
+	{
+		ulLost = ulCount - configTRACE_RECORDER_BUFFER_EVENTS;
+		ulCount = configTRACE_RECORDER_BUFFER_EVENTS;
+	}
+
+	memcpy( ucHeader, "FRTR", 4 );
+	ucHeader[ 4 ] = trcFORMAT_VERSION;
+	ucHeader[ 5 ] = ( unsigned char ) sizeof( xTraceEvent );
+	ucHeader[ 6 ] = ( unsigned char ) uxTaskNameCount;
+	ucHeader[ 7 ] = 0U;
+	prvPutLong( &( ucHeader[ 8 ] ), configCPU_CLOCK_HZ );
+	pxWrite( ucHeader, sizeof( ucHeader ) );
+
+	for( ux = 0U; ux < uxTaskNameCount; ux++ )
+	{
+		pxWrite( ( const unsigned char * ) &( xTaskNames[ ux ] ), trcNAME_ENTRY_SIZE );
+	}
+
+	prvPutLong( &( ucHeader[ 0 ] ), ulLost );
+	prvPutLong( &( ucHeader[ 4 ] ), ulCount );
+	pxWrite( ucHeader, 8U );
+
+	/* The records are written straight out of the ring, in at most two
+	contiguous pieces. */
+	ulStart = ( ulHead - ulCount ) & ( configTRACE_RECORDER_BUFFER_EVENTS - 1UL );
+	ulFirst = configTRACE_RECORDER_BUFFER_EVENTS - ulStart;
+	if( ulFirst > ulCount )
+	{
+		ulFirst = ulCount;
+	}
+
+	if( ulFirst > 0UL )
+	{
+		pxWrite( ( const unsigned char * ) &( xTraceRecorderBuffer[ ulStart ] ), ulFirst * sizeof( xTraceEvent ) );
+	}
+
+	if( ulCount > ulFirst )
+	{
+		pxWrite( ( const unsigned char * ) &( xTraceRecorderBuffer[ 0 ] ), ( ulCount - ulFirst ) * sizeof( xTraceEvent ) );
+	}
+
+	ulTraceRecorderTail = ulHead;
+
+	return ulCount;
+}
+/*-----------------------------------------------------------*/
+
+#if !defined( __arm__ )
+
+	#include <time.h>
+
+	unsigned long ulTraceRecorderHostTimestamp( void )
+	{
+	struct timespec xNow;
+
+		/* Nanoseconds scaled to the configured core clock, so host traces are
+		decoded in the same units as target traces. */
+		clock_gettime( CLOCK_MONOTONIC, &xNow );
+		return ( unsigned long ) ( ( ( unsigned long long ) xNow.tv_sec * 1000000000ULL + ( unsigned long long ) xNow.tv_nsec ) * ( configCPU_CLOCK_HZ / 1000000UL ) / 1000ULL );
+	}
+
+#endif
+
+#endif /* configUSE_TRACE_RECORDER */
@@ -0,0 +1,83 @@
+/*
+ * Composite USB device functions run as FreeRTOS tasks, see
+ * composite_tasks.h.
+ */
+
+#include "composite_tasks.h"
+
+/*-----------------------------------------------------------*/
+
+/* Wake up method of the functions, invoked by COMPOSITEDScheduler_Signal(). */
+static void prvWakeUp( COMPOSITEDFunction *pxFunction )
+{
+xCompositeTask *pxTask = ( xCompositeTask * ) pxFunction->pTask;
+portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+	if( portIS_INSIDE_INTERRUPT() != pdFALSE )
+	{
+		xSemaphoreGiveFromISR( pxTask->xWake, &xHigherPriorityTaskWoken );
+		portEND_SWITCHING_ISR( xHigherPriorityTaskWoken );
+	}
+	else
+	{
+		xSemaphoreGive( pxTask->xWake );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvCompositeTask( void *pvParameters )
+{
+xCompositeTask *pxTask = ( xCompositeTask * ) pvParameters;
+COMPOSITEDFunction *pxFunction = pxTask->pxFunction;
+unsigned char ucSteps;
+
+	for( ;; )
+	{
+		/* A signal given while the function ran has already been seen, the
+		semaphore then only causes one extra step. */
+		if( pxFunction->signaled == 0 )
+		{
+			xSemaphoreTake( pxTask->xWake, portMAX_DELAY );
+		}
+
+		ucSteps = 0;
+		while( COMPOSITEDScheduler_Step( pxFunction ) != 0 )
+		{
+			/* Let the functions of the same priority have their turn. */
+			if( ++ucSteps >= pxFunction->share )
+			{
+				ucSteps = 0;
+				taskYIELD();
+			}
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Creates the task running a function already registered in the composite
+ * scheduler.  Returns pdPASS, or errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY.
+ */
+portBASE_TYPE xCompositeTaskCreate( xCompositeTask *pxTask, COMPOSITEDFunction *pxFunction, const signed char * const pcName, unsigned short usStackDepth, unsigned portBASE_TYPE uxBasePriority )
+{
+unsigned portBASE_TYPE uxPriority = uxBasePriority + pxFunction->priority;
+
+	if( uxPriority >= configMAX_PRIORITIES )
+	{
+		uxPriority = configMAX_PRIORITIES - 1;
+	}
+
+	pxTask->pxFunction = pxFunction;
+	vSemaphoreCreateBinary( pxTask->xWake );
+	if( pxTask->xWake == NULL )
+	{
+		return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+	}
+
+	/* The task starts by running the function once, as it is signaled when
+	registered. */
+	pxFunction->pTask = pxTask;
+	pxFunction->wakeUp = prvWakeUp;
+
+	return xTaskCreate( prvCompositeTask, pcName, usStackDepth, pxTask, uxPriority, &( pxTask->xHandle ) );
+}
@@ -0,0 +1,46 @@
+/*
+ * Composite USB device functions run as FreeRTOS tasks.
+ *
+ * Each function registered in the composite scheduler of at91lib
+ * (usb/device/composite/COMPOSITEDScheduler.h) gets a task of its own, whose
+ * priority is the base priority given to xCompositeTaskCreate() plus the
+ * priority of the function.  The task blocks on a binary semaphore that
+ * COMPOSITEDScheduler_Signal() gives, from a task or from the USB interrupt,
+ * and then runs the function as long as it stays signaled, yielding to the
+ * tasks of the same priority every share steps.  A function of higher
+ * priority, such as a CDC port, thereby preempts the MSD state machine in the
+ * middle of a long media operation.
+ *
+ * COMPOSITEDScheduler_Run() must not be called when the functions run as
+ * tasks.  The UDPHS interrupt priority must be at or below
+ * configMAX_SYSCALL_INTERRUPT_PRIORITY, since the signal is given from it.
+ */
+
+#ifndef COMPOSITE_TASKS_H
+#define COMPOSITE_TASKS_H
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include <usb/device/composite/COMPOSITEDScheduler.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Task running a function, the storage is provided by the application. */
+typedef struct xCOMPOSITE_TASK
+{
+	COMPOSITEDFunction *pxFunction;
+	xSemaphoreHandle xWake;
+	xTaskHandle xHandle;
+} xCompositeTask;
+
+portBASE_TYPE xCompositeTaskCreate( xCompositeTask *pxTask, COMPOSITEDFunction *pxFunction, const signed char * const pcName, unsigned short usStackDepth, unsigned portBASE_TYPE uxBasePriority );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COMPOSITE_TASKS_H */
@@ -0,0 +1,12 @@
+
+libs += freertos_usb
+freertos_usb_path := $(FREERTOS)/usb
+freertos_usb_objs := composite_tasks.o
+freertos_usb_cflags := \
+	-I$(FREERTOS)/usb \
+	-I$(FREERTOS)/include \
+	-I$(FREERTOS_PORT) \
+	-I$(AT91LIB) \
+	-I$(AT91LIB)/peripherals \
+	-I$(AT91LIB)/boards/$(BOARD) \
+	-I$(TOP)
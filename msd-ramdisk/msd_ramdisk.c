@@ -0,0 +1,161 @@
+
+// Mass storage throughput benchmark.
+//
+// Exposes two RAM disk LUNs of the same size in the PSRAM of the board. LUN 0
+// uses the mapped path: the USB DMA moves the data directly between the host
+// and the disk. LUN 1 has the mapped flags cleared and copies every block
+// through the MSD FIFO, as the other media do. Run the same transfer on both
+// disks from the host, e.g.
+//
+//   dd if=/dev/sdX of=/dev/null bs=64k iflag=direct
+//   dd if=/dev/zero of=/dev/sdX bs=64k count=4 oflag=direct
+//
+// and compare the figures printed on the DBGU every second: the throughput of
+// each LUN and the share of the CPU spent moving the data, which is the time
+// spent in the USB interrupt plus the time spent copying blocks in and out of
+// the disk.
+
+#include <stdio.h>
+
+#include <board.h>
+#include <board_memories.h>
+#include <utility/trace.h>
+#include <memories/MEDRamDisk.h>
+#include <usb/device/core/USBD.h>
+#include <usb/device/massstorage/MSDDriver.h>
+#include <usb/device/massstorage/MSDLun.h>
+
+#ifndef RAMDISK_SIZE
+#define RAMDISK_SIZE      (256 * 1024)  // per LUN, in bytes
+#endif
+#define RAMDISK_BLOCK     512
+#define MSD_BUFFER_SIZE   (16 * RAMDISK_BLOCK)
+
+#define DEMCR       (*(volatile unsigned int *) 0xE000EDFC)
+#define DWT_CTRL    (*(volatile unsigned int *) 0xE0001000)
+#define DWT_CYCCNT  (*(volatile unsigned int *) 0xE0001004)
+
+Media medias[2];
+
+static MSDLun luns[2];
+static unsigned char msdBuffer[2][MSD_BUFFER_SIZE];
+
+// Copy path of the RAM disk, wrapped to measure it
+static Media_read ramDiskRead;
+static Media_write ramDiskWrite;
+
+// Statistics of the current period
+static unsigned int readBytes[2];
+static unsigned int writeBytes[2];
+static volatile unsigned int busyCycles;
+
+void BenchUsbIrqHandler(void) {
+  unsigned int start = DWT_CYCCNT;
+
+  UDPD_IrqHandler();
+  busyCycles += DWT_CYCCNT - start;
+}
+
+static unsigned char TimedRead(Media *media, unsigned int address, void *data,
+                               unsigned int length, MediaCallback callback,
+                               void *argument) {
+  unsigned int start = DWT_CYCCNT;
+  unsigned char status;
+
+  status = ramDiskRead(media, address, data, length, callback, argument);
+  __sync_fetch_and_add(&busyCycles, DWT_CYCCNT - start);
+  return status;
+}
+
+static unsigned char TimedWrite(Media *media, unsigned int address, void *data,
+                                unsigned int length, MediaCallback callback,
+                                void *argument) {
+  unsigned int start = DWT_CYCCNT;
+  unsigned char status;
+
+  status = ramDiskWrite(media, address, data, length, callback, argument);
+  __sync_fetch_and_add(&busyCycles, DWT_CYCCNT - start);
+  return status;
+}
+
+static void Count(int lun, unsigned char isRead, unsigned int length) {
+  if (isRead)
+    readBytes[lun] += length;
+  else
+    writeBytes[lun] += length;
+}
+
+static void MonitorMapped(unsigned char isRead, unsigned int length,
+                          unsigned int nullCount, unsigned int fullCount) {
+  Count(0, isRead, length);
+}
+
+static void MonitorCopy(unsigned char isRead, unsigned int length,
+                        unsigned int nullCount, unsigned int fullCount) {
+  Count(1, isRead, length);
+}
+
+// Bytes per period of `cycles` to KB/s
+static unsigned int Rate(unsigned int bytes, unsigned int cycles) {
+  return (unsigned int) (((unsigned long long) bytes * BOARD_MCK) / cycles / 1024);
+}
+
+static void Report(unsigned int cycles) {
+  unsigned int busy = __sync_fetch_and_and(&busyCycles, 0);
+
+  printf("mapped R %5u W %5u KB/s | copy R %5u W %5u KB/s | CPU %3u%%\n\r",
+         Rate(readBytes[0], cycles), Rate(writeBytes[0], cycles),
+         Rate(readBytes[1], cycles), Rate(writeBytes[1], cycles),
+         (unsigned int) (((unsigned long long) busy * 100) / cycles));
+  readBytes[0] = readBytes[1] = 0;
+  writeBytes[0] = writeBytes[1] = 0;
+}
+
+void main(void) {
+  unsigned int base = BOARD_EBI_PSRAM / RAMDISK_BLOCK;
+  unsigned int blocks = RAMDISK_SIZE / RAMDISK_BLOCK;
+  unsigned int last;
+
+  TRACE_CONFIGURE(TRACE_DBGU, 115200, BOARD_MCK);
+  TRACE_INFO("MSD RAM disk benchmark, %u KB per LUN\n\r", RAMDISK_SIZE / 1024);
+
+  DEMCR |= 1 << 24;     // TRCENA
+  DWT_CTRL |= 1;        // CYCCNTENA
+
+  BOARD_ConfigurePsram();
+  if (!MEDRamDisk_Initialize(&medias[0], RAMDISK_BLOCK, base, blocks)
+      || !MEDRamDisk_Initialize(&medias[1], RAMDISK_BLOCK, base + blocks, blocks)) {
+    TRACE_ERROR("PSRAM not available\n\r");
+    while (1);
+  }
+  numMedias = 2;
+
+  // Both LUNs time the copies (LUN 0 only copies when it is not mapped); LUN
+  // 1 is forced through the MSD FIFO.
+  ramDiskRead = medias[0].read;
+  ramDiskWrite = medias[0].write;
+  medias[0].read = medias[1].read = TimedRead;
+  medias[0].write = medias[1].write = TimedWrite;
+  medias[1].mappedRD = 0;
+  medias[1].mappedWR = 0;
+
+  LUN_Init(&luns[0], &medias[0], msdBuffer[0], MSD_BUFFER_SIZE,
+           0, 0, 1, 0, MonitorMapped);
+  LUN_Init(&luns[1], &medias[1], msdBuffer[1], MSD_BUFFER_SIZE,
+           0, 0, 1, 0, MonitorCopy);
+
+  MSDDriver_Initialize(luns, 2);
+  USBD_Connect();
+
+  last = DWT_CYCCNT;
+  while (1) {
+    MSDDriver_StateMachine();
+
+    if (DWT_CYCCNT - last >= BOARD_MCK) {
+      unsigned int now = DWT_CYCCNT;
+
+      Report(now - last);
+      last = now;
+    }
+  }
+}
@@ -1,5 +1,6 @@
 
 #include <stdint.h>
+#include <stdio.h>
 
 extern "C" {
 #include <utility/trace.h>
@@ -19,11 +20,35 @@ void fib_task_func(void *);
 void * rad_task_handle;
 void rad_task_func(void *);
 
+void * stack_task_handle;
+void stack_task_func(void *);
+
+void * switch_task_handle;
+void switch_task_func(void *);
+
+#if (TRACE_DEFERRED == 1)
+void * log_task_handle;
+void log_task_func(void *);
+#endif
+
+#define DEMCR      (*(volatile uint32_t *) 0xE000EDFC)
+#define DWT_CTRL   (*(volatile uint32_t *) 0xE0001000)
+#define DWT_CYCCNT (*(volatile uint32_t *) 0xE0001004)
+
+#define SWITCH_SAMPLES 1000
+
 extern "C" {
   int main (void) {
-    
+    vPortStackProfileInit(); /* Before anything else uses the main stack. */
+
     TRACE_CONFIGURE(TRACE_DBGU, 115200, BOARD_MCK);
+    /* Starts the DWT cycle counter, for the trace timing below. */
+    DEMCR |= 1 << 24;
+    DWT_CTRL |= 1;
+    uint32_t start = DWT_CYCCNT;
     TRACE_INFO("entered main\n\n\n");
+    uint32_t cycles = DWT_CYCCNT - start;
+    TRACE_INFO("trace took %u cycles\n", (unsigned) cycles);
 
     vSemaphoreCreateBinary(printing_semphr);
 
@@ -33,6 +58,17 @@ extern "C" {
     xTaskCreate(rad_task_func, (signed portCHAR *)"radt", 400,
                 NULL, 1, &rad_task_handle);
 
+    xTaskCreate(stack_task_func, (signed portCHAR *)"stkt", 200,
+                NULL, tskIDLE_PRIORITY, &stack_task_handle);
+
+    xTaskCreate(switch_task_func, (signed portCHAR *)"swt", 200,
+                NULL, configMAX_PRIORITIES - 2, &switch_task_handle);
+
+#if (TRACE_DEFERRED == 1)
+    xTaskCreate(log_task_func, (signed portCHAR *)"logt", 200,
+                NULL, tskIDLE_PRIORITY, &log_task_handle);
+#endif
+
     vTaskStartScheduler();
   }
 }
@@ -97,6 +133,55 @@ void rad_task_func (void * args) {
   }
 }
 
+static void stack_line (const signed char * line) {
+  /* Printed at once, not traced: the line is overwritten by the next one,
+     which a deferred trace of it would print instead. */
+  printf("%s", (const char *) line);
+}
+
+void stack_task_func (void * args) {
+  /* Prints the stack profile of the whole system every 10 seconds. */
+  while (1) {
+    vTaskDelay(10000);
+    if ( xSemaphoreTake( printing_semphr, PRINTING_TIMEOUT ) == pdTRUE ) {
+      vPortStackProfileReport(stack_line);
+      xSemaphoreGive( printing_semphr );
+    }
+  }
+}
+
+void switch_task_func (void * args) {
+  /* Times a context switch once, before the other tasks run.  With no other
+     task ready at this priority, a yield goes through PendSV, saves this
+     task, switches context and restores it again.  The least count leaves
+     out the samples hit by an interrupt.  Build with STACK_GUARD=0 to
+     compare with the stack check. */
+  uint32_t least = 0xFFFFFFFF;
+  for (uint16_t i = 0; i < SWITCH_SAMPLES; i++) {
+    uint32_t start = DWT_CYCCNT;
+    taskYIELD();
+    uint32_t cycles = DWT_CYCCNT - start;
+    if (cycles < least) least = cycles;
+  }
+
+  if ( xSemaphoreTake( printing_semphr, PRINTING_TIMEOUT ) == pdTRUE ) {
+    TRACE_INFO("context switch took %u cycles (stack guard %u, check %u)\n",
+               (unsigned) least, (unsigned) configUSE_MPU_STACK_GUARD,
+               (unsigned) configCHECK_FOR_STACK_OVERFLOW);
+    xSemaphoreGive( printing_semphr );
+  }
+  vTaskDelete(NULL);
+}
+
+#if (TRACE_DEFERRED == 1)
+void log_task_func (void * args) {
+  /* Prints the traces buffered by the other tasks and the tick hook. */
+  while (1) {
+    TRACE_DeferredFlush();
+    vTaskDelay(10);
+  }
+}
+#endif
 
 extern "C" {
   /* FreeRTOS Callbacks */
@@ -104,11 +189,12 @@ extern "C" {
     static int i = 0;
     if (i >= 1000) {
       i = 0; 
-      TRACE_INFO("tick\n"); /* This is unsafe! */
+      TRACE_INFO("tick\n"); /* This is unsafe unless TRACE_DEFERRED=1! */
     } else i++;
   }
 
-  void vApplicationStackOverflowHook(void) {
+  void vApplicationStackOverflowHook(xTaskHandle pxTask,
+                                     signed char *pcTaskName) {
     TRACE_ERROR("Stack Overflow!\n")
     for(;;);
   }
@@ -15,6 +15,7 @@ extern unsigned int _estack;
 extern void xPortPendSVHandler(void);
 extern void xPortSysTickHandler(void);
 extern void vPortSVCHandler(void);
+extern void vPortMemManageHandler(void);
 
 extern void ResetException(void);
 
@@ -31,7 +32,7 @@ IntFunc exception_table[] = {
 
     NMI_Handler,
     HardFault_Handler,
-    MemManage_Handler,
+    vPortMemManageHandler,
     BusFault_Handler,
     UsageFault_Handler,
     0, 0, 0, 0,             // Reserved
@@ -1,5 +1,10 @@
 
+
 #include <stdlib.h>
+#include <reent.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
 
 void *pvPortMalloc(size_t s) {
   return malloc(s); 
@@ -10,3 +15,17 @@ void vPortFree(void *p) {
   return free(p);
 }
 
+/* newlib calls these around every heap operation. Suspending the scheduler
+   keeps tasks from interleaving in the heap, without masking interrupts for
+   the length of a search. It nests, so newlib may take the lock recursively.
+   Before the scheduler starts there is only one thread. */
+
+void __malloc_lock(struct _reent *r) {
+  if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED)
+    vTaskSuspendAll();
+}
+
+void __malloc_unlock(struct _reent *r) {
+  if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED)
+    xTaskResumeAll();
+}
@@ -20,11 +20,15 @@ OPTIMIZATION = -Os
 CFLAGS := -Wall -mthumb -mcpu=cortex-m3 \
           -mlong-calls -ffunction-sections -g \
           $(OPTIMIZATION) $(INCLUDES) -D$(CHIP) \
-          -DTRACE_LEVEL=$(TRACE_LEVEL)
+          -DTRACE_LEVEL=$(TRACE_LEVEL) -DTRACE_DEFERRED=$(TRACE_DEFERRED) \
+          -DconfigUSE_MPU_STACK_GUARD=$(STACK_GUARD)
+# No libsupc++ is linked: cplusplus/new.cpp gives NULL instead of throwing.
 CXXFLAGS := -Wall -mthumb -mcpu=cortex-m3 \
           -mlong-calls -ffunction-sections -g \
+          -fno-exceptions -fcheck-new \
           $(OPTIMIZATION) $(INCLUDES) -D$(CHIP) \
-          -DTRACE_LEVEL=$(TRACE_LEVEL)
+          -DTRACE_LEVEL=$(TRACE_LEVEL) -DTRACE_DEFERRED=$(TRACE_DEFERRED) \
+          -DconfigUSE_MPU_STACK_GUARD=$(STACK_GUARD)
 
 ASFLAGS := -mcpu=cortex-m3 -mthumb -Wall -g \
            $(OPTIMIZATION) $(INCLUDES) \